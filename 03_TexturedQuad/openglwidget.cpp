@@ -6,10 +6,11 @@
 #include <QDir>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLVertexArrayObject>
-#include <QOpenGLTexture>
 #include <QKeyEvent>
+#include "assetpack.h"
 
-// IMPORTANT: Place an image named 'texture.png' in the same directory as your executable.
+// IMPORTANT: Place an image named 'texture.png' in the same directory as your executable,
+// or pack it into assets.pak there with tools/assetpacker.
 const QString TARGET_IMAGE_NAME = "texture.png";
 
 // ==========================================================
@@ -44,7 +45,8 @@ const char *vertexShaderSource =
     "void main()\n"
     "{\n"
     "    gl_Position = vec4(aPos, 1.0);\n"
-    "    TexCoord = aTexCoord;\n"
+    // The texture is uploaded top row first (no mirrored() copy), so flip v here instead
+    "    TexCoord = vec2(aTexCoord.x, 1.0 - aTexCoord.y);\n"
     "}\0";
 
 // === 4. Fragment Shader === (Color input removed)
@@ -64,7 +66,7 @@ const char *fragmentShaderSource =
 // ==========================================================
 // 5. Constructor and Destructor
 // ==========================================================
-OpenGLWidget::OpenGLWidget(QWidget *parent) : QOpenGLWidget(parent), ebo(0), texture(nullptr) {}
+OpenGLWidget::OpenGLWidget(QWidget *parent) : QOpenGLWidget(parent), ebo(0), texture(0) {}
 
 OpenGLWidget::~OpenGLWidget() {
     makeCurrent();
@@ -75,8 +77,9 @@ OpenGLWidget::~OpenGLWidget() {
     }
     delete program;
     if (texture) {
-        delete texture;
+        glDeleteTextures(1, &texture);
     }
+    uploader.release();
     doneCurrent();
 }
 
@@ -85,24 +88,28 @@ OpenGLWidget::~OpenGLWidget() {
 // ==========================================================
 void OpenGLWidget::loadTexture(const QString& relativePath)
 {
+    // --- Prefer the asset pack next to the executable (see tools/assetpacker) ---
+    AssetPack assets;
+    const QByteArray packed = assets.open(AssetPack::defaultPath()) ? assets.data(relativePath) : QByteArray();
+
     // --- Construct Absolute Path: Use the executable's directory as the base ---
     QString appDir = QCoreApplication::applicationDirPath();
     QString absolutePath = QDir(appDir).filePath(relativePath);
 
     // Clean up old texture
     if (texture) {
-        delete texture;
-        texture = nullptr;
+        glDeleteTextures(1, &texture);
+        texture = 0;
     }
 
-    QImage image;
-    // Attempt to load the texture from the absolute path
-    bool loaded = image.load(absolutePath);
+    // Attempt to load the texture from the absolute path.
+    // The image is decoded straight into a staging buffer and uploaded in the layout
+    // the decoder produced: no QImage copy, no mirrored() pass, no format conversion.
+    texture = packed.isEmpty() ? uploader.uploadFile(absolutePath, false) : uploader.uploadData(packed, false);
 
-    if (loaded && !image.isNull()) {
-        qDebug() << "Texture loaded successfully from absolute path:" << absolutePath;
-        // Mirror Y axis to match OpenGL coordinate system (Qt loads images flipped)
-        texture = new QOpenGLTexture(image.mirrored());
+    if (texture != 0) {
+        qDebug() << "Texture loaded successfully from" << (packed.isEmpty() ? absolutePath : assets.filePath());
+        qDebug().noquote() << uploader.report();
     } else {
         qDebug() << "=========================================================================";
         qDebug() << "WARNING: Texture loading failed! Using checkerboard texture as fallback.";
@@ -120,14 +127,14 @@ void OpenGLWidget::loadTexture(const QString& relativePath)
             }
         }
 
-        texture = new QOpenGLTexture(checkerboardImage.mirrored());
+        texture = uploader.uploadImage(checkerboardImage, false);
     }
 
-    // Configure texture parameters
+    // Configure texture parameters (the uploader already set linear magnification and repeat wrapping)
     if (texture) {
-        texture->setMinificationFilter(QOpenGLTexture::Nearest);
-        texture->setMagnificationFilter(QOpenGLTexture::Linear);
-        texture->setWrapMode(QOpenGLTexture::Repeat);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
     }
 }
 
@@ -185,6 +192,7 @@ void OpenGLWidget::initializeGL()
     program->setAttributeBuffer(2, GL_FLOAT, 3 * sizeof(float), 2, stride);
 
     // --- Texture Loading ---
+    uploader.initialize();
     loadTexture(TARGET_IMAGE_NAME);
 
     // Set uniform sampler to texture unit 0
@@ -209,7 +217,8 @@ void OpenGLWidget::paintGL()
 
     // Bind texture to unit 0
     if (texture) {
-        texture->bind(0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
     }
 
     // Crucial fix: Explicitly re-bind EBO (for Qt compatibility)
@@ -221,7 +230,7 @@ void OpenGLWidget::paintGL()
     // Unbind resources
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     if (texture) {
-        texture->release();
+        glBindTexture(GL_TEXTURE_2D, 0);
     }
     program->release();
 }
@@ -6,7 +6,7 @@
 #include <QOpenGLBuffer>
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLShaderProgram>
-#include <QOpenGLTexture>
+#include "textureupload.h"
 
 class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
 {
@@ -28,7 +28,8 @@ private:
     unsigned int ebo = 0; // Raw OpenGL ID for EBO
     bool m_firstPaint; // <--- flag
     void loadTexture(const QString& filePath);
-    QOpenGLTexture *texture = nullptr;
+    GLuint texture = 0;
+    TextureUploader uploader;
 };
 
 #endif // OPENGLWIDGET_H
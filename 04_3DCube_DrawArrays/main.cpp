@@ -1,8 +1,11 @@
 #include <QApplication>
+#include "gldiag.h"
 #include "openglwidget.h"
 
 int main(int argc, char *argv[])
 {
+    GL_DIAG_REQUEST_CONTEXT(); // Debug builds: KHR_debug messages need a debug context
+
     QApplication app(argc, argv);
 
     OpenGLWidget widget;
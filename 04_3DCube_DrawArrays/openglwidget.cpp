@@ -3,64 +3,15 @@
 #include <QTimer>
 #include <QVector3D>
 #include <QMatrix4x4>
+#include "gldiag.h"
+#include "meshgen.h"
 
-// 36 vertices (12 triangles * 3 vertices each)
-static const float vertices[] = {
-    // Positions (XYZ)          // Colors (RGB)
-    // Front face (2 triangles)
-    -0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,  // Front bottom left, Red
-    0.5f, -0.5f,  0.5f,  0.0f, 1.0f, 0.0f,  // Front bottom right, Green
-    0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  // Front top right, Blue
-
-    0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  // Front top right, Blue
-    -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,  // Front top left, Yellow
-    -0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,  // Front bottom left, Red
-
-    // Back face (2 triangles)
-    0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 1.0f,  // Back bottom right, Cyan
-    -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 1.0f,  // Back bottom left, Magenta
-    -0.5f,  0.5f, -0.5f,  1.0f, 0.5f, 0.0f,  // Back top left, Orange
-
-    -0.5f,  0.5f, -0.5f,  1.0f, 0.5f, 0.0f,  // Back top left, Orange
-    0.5f,  0.5f, -0.5f,  0.5f, 0.5f, 0.5f,  // Back top right, Gray
-    0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 1.0f,  // Back bottom right, Cyan
-
-    // Right face (2 triangles)
-    0.5f, -0.5f,  0.5f,  0.0f, 1.0f, 0.0f,  // Front bottom right, Green
-    0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 1.0f,  // Back bottom right, Cyan
-    0.5f,  0.5f, -0.5f,  0.5f, 0.5f, 0.5f,  // Back top right, Gray
-
-    0.5f,  0.5f, -0.5f,  0.5f, 0.5f, 0.5f,  // Back top right, Gray
-    0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  // Front top right, Blue
-    0.5f, -0.5f,  0.5f,  0.0f, 1.0f, 0.0f,  // Front bottom right, Green
-
-    // Left face (2 triangles)
-    -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 1.0f,  // Back bottom left, Magenta
-    -0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,  // Front bottom left, Red
-    -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,  // Front top left, Yellow
-
-    -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,  // Front top left, Yellow
-    -0.5f,  0.5f, -0.5f,  1.0f, 0.5f, 0.0f,  // Back top left, Orange
-    -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 1.0f,  // Back bottom left, Magenta
-
-    // Top face (2 triangles)
-    -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,  // Front top left, Yellow
-    0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  // Front top right, Blue
-    0.5f,  0.5f, -0.5f,  0.5f, 0.5f, 0.5f,  // Back top right, Gray
-
-    0.5f,  0.5f, -0.5f,  0.5f, 0.5f, 0.5f,  // Back top right, Gray
-    -0.5f,  0.5f, -0.5f,  1.0f, 0.5f, 0.0f,  // Back top left, Orange
-    -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,  // Front top left, Yellow
-
-    // Bottom face (2 triangles)
-    -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 1.0f,  // Back bottom left, Magenta
-    0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 1.0f,  // Back bottom right, Cyan
-    0.5f, -0.5f,  0.5f,  0.0f, 1.0f, 0.0f,  // Front bottom right, Green
-
-    0.5f, -0.5f,  0.5f,  0.0f, 1.0f, 0.0f,  // Front bottom right, Green
-    -0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,  // Front bottom left, Red
-    -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 1.0f   // Back bottom left, Magenta
-};
+// 36 vertices (12 triangles * 3 vertices each): position XYZ + color RGB, generated at compile time
+// (common/meshgen.h) by expanding the indexed 8-corner cube. Each corner's color is its position mapped to [0, 1].
+static constexpr auto vertices = meshgen::unindexed(meshgen::cubeCorners<meshgen::PosColor>());
+
+// Per-vertex color, transformed by projection * view * model
+static constexpr ShaderFeatures cubeFeatures = vertexFeatures<meshgen::PosColor>() | ShaderFeatures::Transform;
 
 OpenGLWidget::OpenGLWidget(QWidget *parent)
     : QOpenGLWidget(parent), program(nullptr), rotationAngle(0.0f)
@@ -72,15 +23,17 @@ OpenGLWidget::OpenGLWidget(QWidget *parent)
 OpenGLWidget::~OpenGLWidget()
 {
     makeCurrent();
+    GL_DIAG_DETACH();
     vao.destroy();
     vbo.destroy();
-    delete program;
+    shaderVariants.release();
     doneCurrent();
 }
 
 void OpenGLWidget::initializeGL()
 {
     initializeOpenGLFunctions();
+    GL_DIAG_ATTACH(context());
     glEnable(GL_DEPTH_TEST);
 
     qDebug() << "Initializing OpenGL cube with glDrawArrays...";
@@ -95,75 +48,43 @@ void OpenGLWidget::initializeGL()
 
 void OpenGLWidget::setupShaders()
 {
-    program = new QOpenGLShaderProgram(this);
-
-    // Vertex shader - uses per-vertex colors
-    const char* vertexShader =
-        "#version 330 core\n"
-        "layout (location = 0) in vec3 aPos;\n"
-        "layout (location = 1) in vec3 aColor;\n"
-        "out vec3 ourColor;\n"
-        "uniform mat4 model;\n"
-        "uniform mat4 view;\n"
-        "uniform mat4 projection;\n"
-        "void main()\n"
-        "{\n"
-        "    gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
-        "    ourColor = aColor;\n"
-        "}\n";
-
-    // Fragment shader
-    const char* fragmentShader =
-        "#version 330 core\n"
-        "out vec4 FragColor;\n"
-        "in vec3 ourColor;\n"
-        "void main()\n"
-        "{\n"
-        "    FragColor = vec4(ourColor, 1.0);\n"
-        "}\n";
-
-    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader)) {
-        qDebug() << "Vertex shader compilation error:" << program->log();
-        return;
-    }
-    if (!program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShader)) {
-        qDebug() << "Fragment shader compilation error:" << program->log();
-        return;
-    }
-    if (!program->link()) {
-        qDebug() << "Shader program link error:" << program->log();
-        return;
+    // Specialized from the shared annotated source (common/shadervariants.cpp)
+    cubeVariant = shaderVariants.variant(cubeFeatures);
+    if (!cubeVariant) {
+        return; // ShaderVariantCache already logged the compiler output
     }
+    program = cubeVariant->program;
 
+    GL_DIAG_LABEL(GL_PROGRAM, program->programId(), "cube program");
     qDebug() << "Shaders compiled and linked successfully";
 }
 
 void OpenGLWidget::setupCubeData()
 {
-    // Bind program before setting attributes
-    program->bind();
-
     vao.create();
     vao.bind();
 
     // Setup Vertex Buffer Object (VBO)
     vbo.create();
     vbo.bind();
-    vbo.allocate(vertices, sizeof(vertices));
-    qDebug() << "VBO allocated:" << sizeof(vertices) << "bytes";
+    vbo.allocate(vertices.data(), int(vertices.size() * sizeof(float)));
+    qDebug() << "VBO allocated:" << vertices.size() * sizeof(float) << "bytes";
 
-    // Set up vertex attributes
+    // Set up vertex attributes at the locations every shader variant uses; they are
+    // VAO state, so no program needs to be bound
     // Position attribute (location = 0)
-    program->enableAttributeArray(0);
-    program->setAttributeBuffer(0, GL_FLOAT, 0, 3, 6 * sizeof(float));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
 
     // Color attribute (location = 1)
-    program->enableAttributeArray(1);
-    program->setAttributeBuffer(1, GL_FLOAT, 3 * sizeof(float), 3, 6 * sizeof(float));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                          reinterpret_cast<const void *>(3 * sizeof(float)));
 
     vao.release();
-    program->release();
 
+    GL_DIAG_LABEL(GL_VERTEX_ARRAY, vao.objectId(), "cube VAO");
+    GL_DIAG_LABEL(GL_BUFFER, vbo.bufferId(), "cube VBO");
     qDebug() << "Cube vertex data setup complete";
 }
 
@@ -172,30 +93,33 @@ void OpenGLWidget::resizeGL(int w, int h)
     glViewport(0, 0, w, h);
     projection.setToIdentity();
     projection.perspective(45.0f, float(w)/float(h), 0.1f, 100.0f);
-    qDebug() << "Viewport resized to:" << w << "x" << h;
+    GL_DIAG_TRACE() << "Viewport resized to:" << w << "x" << h;
 }
 
 void OpenGLWidget::paintGL()
 {
+    // Driver messages queued since the last frame; no GL query in the frame itself
+    GL_DIAG_DRAIN();
+
     // Clear buffers with light gray background
     glClearColor(0.9f, 0.9f, 0.9f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    if (!program || !program->isLinked()) {
-        qDebug() << "Shader program not ready, skipping draw call";
-        return;
+    if (!cubeVariant) {
+        return; // setupShaders() already said why
     }
 
+    GL_DIAG_GROUP("cube");
     program->bind();
     vao.bind();
 
     // Set transformation matrices
-    program->setUniformValue("projection", projection);
+    program->setUniformValue(cubeVariant->projection, projection);
 
     // View matrix - camera positioned at (0,0,-3) looking at origin
     view.setToIdentity();
     view.translate(0.0f, 0.0f, -3.0f);
-    program->setUniformValue("view", view);
+    program->setUniformValue(cubeVariant->view, view);
 
     // Model matrix - apply continuous rotation
     model.setToIdentity();
@@ -204,16 +128,13 @@ void OpenGLWidget::paintGL()
     if (rotationAngle >= 360.0f) {
         rotationAngle = 0.0f;
     }
-    program->setUniformValue("model", model);
+    program->setUniformValue(cubeVariant->model, model);
 
     // Draw the cube using glDrawArrays
     glDrawArrays(GL_TRIANGLES, 0, 36);
 
-    // Check for OpenGL errors
-    GLenum error = glGetError();
-    if (error != GL_NO_ERROR) {
-        qDebug() << "OpenGL draw error:" << error;
-    }
+    // Only polls glGetError() in diagnostics builds without KHR_debug
+    GL_DIAG_CHECK("cube draw");
 
     vao.release();
     program->release();
@@ -9,6 +9,7 @@
 #include <QTimer>
 #include <QVector3D>
 #include <QMatrix4x4>  //
+#include "shadervariants.h"
 
 class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
@@ -27,6 +28,8 @@ private slots:
     void updateAnimation();
 
 private:
+    ShaderVariantCache shaderVariants;
+    const ShaderVariant *cubeVariant = nullptr;
     QOpenGLShaderProgram *program;
     QOpenGLBuffer vbo;
     QOpenGLVertexArrayObject vao;
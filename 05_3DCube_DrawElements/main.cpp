@@ -1,14 +1,30 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include "gldiag.h"
 #include "openglwidget.h"
+#include "startupprofiler.h"
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler &startup = StartupProfiler::instance();
+    startup.mark("main()");
+    GL_DIAG_REQUEST_CONTEXT(); // Debug builds: KHR_debug messages need a debug context
+
     QApplication app(argc, argv);
+    startup.mark("QApplication created");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption meshOption("mesh", "Draw this mesh file (tools/meshconv) instead of the cube.", "file");
+    parser.addOption(meshOption);
+    parser.process(app);
 
     OpenGLWidget widget;
+    widget.setMeshFile(parser.value(meshOption));
     widget.resize(800, 600);
     widget.setWindowTitle("3DCube_DrawElements - Qt OpenGL");
     widget.show();
+    startup.mark("window shown");
 
     return app.exec();
 }
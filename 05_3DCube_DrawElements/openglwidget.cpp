@@ -3,204 +3,314 @@
 #include <QTimer>
 #include <QVector3D>
 #include <QMatrix4x4>
+#include <QKeyEvent>
+#include <QFontDatabase>
+#include "gldiag.h"
+#include "meshfile.h"
+#include "meshgen.h"
 
-// 8 unique vertices for the cube
-static const float vertices[] = {
-    // Positions (XYZ)          // Colors (RGB)
-    // Front face vertices
-    -0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,  // 0: Front bottom left, Red
-    0.5f, -0.5f,  0.5f,  0.0f, 1.0f, 0.0f,  // 1: Front bottom right, Green
-    0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  // 2: Front top right, Blue
-    -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,  // 3: Front top left, Yellow
-
-    // Back face vertices
-    -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 1.0f,  // 4: Back bottom left, Magenta
-    0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 1.0f,  // 5: Back bottom right, Cyan
-    0.5f,  0.5f, -0.5f,  0.5f, 0.5f, 0.5f,  // 6: Back top right, Gray
-    -0.5f,  0.5f, -0.5f,  1.0f, 0.5f, 0.0f   // 7: Back top left, Orange
-};
-
-// Index data - 12 triangles (36 indices)
-static const unsigned int indices[] = {
-    // Front face
-    0, 1, 2,  0, 2, 3,
-    // Back face
-    5, 4, 7,  5, 7, 6,
-    // Right face
-    1, 5, 6,  1, 6, 2,
-    // Left face
-    4, 0, 3,  4, 3, 7,
-    // Top face
-    3, 2, 6,  3, 6, 7,
-    // Bottom face
-    4, 5, 1,  4, 1, 0
-};
+// 8 unique corner vertices (position XYZ + color RGB) and 36 indices, generated at compile time
+// (common/meshgen.h). Each corner's color is its position mapped to [0, 1]: (-,-,-) black ... (+,+,+) white.
+static constexpr auto cubeMesh = meshgen::cubeCorners<meshgen::PosColor>();
+
+// Per-vertex color, transformed by projection * view * model; mesh files bind their color or normal to the same slot
+static constexpr ShaderFeatures cubeFeatures = vertexFeatures<meshgen::PosColor>() | ShaderFeatures::Transform;
 
 OpenGLWidget::OpenGLWidget(QWidget *parent)
     : QOpenGLWidget(parent), program(nullptr), rotationAngle(0.0f), ebo(0)
 {
     animationTimer = new QTimer(this);
     connect(animationTimer, &QTimer::timeout, this, &OpenGLWidget::updateAnimation);
+    setFocusPolicy(Qt::StrongFocus); // Receive the 'S' key for the stats overlay
 }
 
 OpenGLWidget::~OpenGLWidget()
 {
     makeCurrent();
+    GL_DIAG_DETACH();
     vao.destroy();
     vbo.destroy();
     if (ebo != 0) {
         glDeleteBuffers(1, &ebo);
     }
-    delete program;
+    GpuMemoryTracker::instance().release(vboMemory);
+    GpuMemoryTracker::instance().release(eboMemory);
+    hudText.release();
+    shaderVariants.release();
     doneCurrent();
 }
 
 void OpenGLWidget::initializeGL()
 {
-    initializeOpenGLFunctions();
-    glEnable(GL_DEPTH_TEST);
+    StartupProfiler &startup = StartupProfiler::instance();
+    startup.mark("initializeGL()");
+    {
+        StartupProfiler::Scope phase("initializeOpenGLFunctions");
+        initializeOpenGLFunctions();
+    }
+    GL_DIAG_ATTACH(context());
 
     qDebug() << "Initializing EBO cube...";
-    setupShaders();
-    setupCubeData();
+    {
+        StartupProfiler::Scope phase("shaders");
+        setupShaders();
+    }
+    {
+        StartupProfiler::Scope phase("cube data");
+        if (meshPath.isEmpty() || !setupMeshFile()) {
+            setupCubeData();
+        }
+    }
+
+    // Nothing is deferred in this stage: the first frame is also the fully initialized one
+    connect(this, &QOpenGLWidget::frameSwapped, this, []() {
+        StartupProfiler &startup = StartupProfiler::instance();
+        startup.markFirstFrame();
+        startup.markFullyInitialized();
+        qDebug().noquote() << startup.report();
+    }, Qt::SingleShotConnection);
 
     animationTimer->start(16); // ~60 FPS
 
     qDebug() << "EBO Cube initialized successfully";
-    qDebug() << "Unique vertices: 8, Total indices: 36";
+    qDebug() << "Total indices:" << drawIndexCount;
+#ifdef GL_COUNTERS_ENABLED
+    qDebug().noquote() << "Setup GL calls:" << glcounters::format(glcounters::current());
+#endif
 }
 
 void OpenGLWidget::setupShaders()
 {
-    program = new QOpenGLShaderProgram(this);
-
-    // Vertex shader - uses per-vertex colors
-    const char* vertexShader =
-        "#version 330 core\n"
-        "layout (location = 0) in vec3 aPos;\n"
-        "layout (location = 1) in vec3 aColor;\n"
-        "out vec3 ourColor;\n"
-        "uniform mat4 model;\n"
-        "uniform mat4 view;\n"
-        "uniform mat4 projection;\n"
-        "void main()\n"
-        "{\n"
-        "    gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
-        "    ourColor = aColor;\n"
-        "}\n";
-
-    // Fragment shader
-    const char* fragmentShader =
-        "#version 330 core\n"
-        "out vec4 FragColor;\n"
-        "in vec3 ourColor;\n"
-        "void main()\n"
-        "{\n"
-        "    FragColor = vec4(ourColor, 1.0);\n"
-        "}\n";
-
-    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader)) {
-        qDebug() << "Vertex shader compilation error:" << program->log();
-        return;
-    }
-    if (!program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShader)) {
-        qDebug() << "Fragment shader compilation error:" << program->log();
-        return;
-    }
-    if (!program->link()) {
-        qDebug() << "Shader program link error:" << program->log();
-        return;
+    // Specialized from the shared annotated source (common/shadervariants.cpp)
+    cubeVariant = shaderVariants.variant(cubeFeatures);
+    if (!cubeVariant) {
+        return; // ShaderVariantCache already logged the compiler output
     }
+    program = cubeVariant->program;
 
+    GL_DIAG_LABEL(GL_PROGRAM, program->programId(), "cube program");
     qDebug() << "Shaders compiled and linked successfully";
 }
 
 void OpenGLWidget::setupCubeData()
 {
-    // Bind program before setting attributes
-    program->bind();
-
     vao.create();
     vao.bind();
 
     // Setup Vertex Buffer Object (VBO)
     vbo.create();
     vbo.bind();
-    vbo.allocate(vertices, sizeof(vertices));
-    qDebug() << "VBO allocated:" << sizeof(vertices) << "bytes";
+    vbo.allocate(cubeMesh.vertices.data(), int(cubeMesh.vertexBytes()));
+    GL_COUNT_BUFFER_BIND();
+    GL_COUNT_UPLOAD(cubeMesh.vertexBytes());
 
     // Setup Element Buffer Object (EBO) using native OpenGL API
     glGenBuffers(1, &ebo); // Generate EBO ID
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo); // Bind EBO
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW); // Allocate data
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cubeMesh.indexBytes(), cubeMesh.indices.data(), GL_STATIC_DRAW); // Allocate data
+    GL_COUNT_BUFFER_BIND();
+    GL_COUNT_UPLOAD(cubeMesh.indexBytes());
 
-    qDebug() << "EBO allocated:" << sizeof(indices) << "bytes";
+    const QString owner = QString("05_3DCube_DrawElements@%1").arg(quintptr(this), 0, 16);
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    vboMemory = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, qint64(cubeMesh.vertexBytes()), owner, "cube VBO");
+    eboMemory = memory.registerAllocation(GpuMemoryTracker::Category::IndexBuffer, qint64(cubeMesh.indexBytes()), owner, "cube EBO");
 
-    // Set up vertex attributes
+    // Set up vertex attributes at the locations every shader variant uses; they are
+    // VAO state, so no program needs to be bound
     // Position attribute (location = 0)
-    program->enableAttributeArray(0);
-    program->setAttributeBuffer(0, GL_FLOAT, 0, 3, 6 * sizeof(float));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
 
     // Color attribute (location = 1)
-    program->enableAttributeArray(1);
-    program->setAttributeBuffer(1, GL_FLOAT, 3 * sizeof(float), 3, 6 * sizeof(float));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                          reinterpret_cast<const void *>(3 * sizeof(float)));
 
     vao.release();
-    program->release();
 
+    GL_DIAG_LABEL(GL_VERTEX_ARRAY, vao.objectId(), "cube VAO");
+    GL_DIAG_LABEL(GL_BUFFER, vbo.bufferId(), "cube VBO");
+    GL_DIAG_LABEL(GL_BUFFER, ebo, "cube EBO");
     qDebug() << "Cube data setup complete";
 }
 
+bool OpenGLWidget::setupMeshFile()
+{
+    using namespace meshfile;
+    MeshFile mesh;
+    if (!mesh.open(meshPath)) {
+        qWarning() << "Cannot load" << meshPath << "- drawing the cube instead";
+        return false;
+    }
+    const VertexAttribute *position = mesh.attribute(Semantic::Position);
+    if (!position) {
+        qWarning() << meshPath << "has no positions - drawing the cube instead";
+        return false;
+    }
+    const VertexAttribute *color = mesh.colorAttribute();
+
+    vao.create();
+    vao.bind();
+
+    // Straight from the mapping (or the decoded copy) into the buffers: no intermediate copy
+    vbo.create();
+    vbo.bind();
+    vbo.allocate(mesh.vertexData(), int(mesh.vertexDataSize()));
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexDataSize(), mesh.indexData(), GL_STATIC_DRAW);
+    GL_COUNT_UPLOAD(mesh.vertexDataSize() + mesh.indexDataSize());
+
+    const QString owner = QString("05_3DCube_DrawElements@%1").arg(quintptr(this), 0, 16);
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    vboMemory = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, mesh.vertexDataSize(), owner,
+                                          "mesh VBO");
+    eboMemory = memory.registerAllocation(GpuMemoryTracker::Category::IndexBuffer, mesh.indexDataSize(), owner,
+                                          "mesh EBO");
+
+    mesh.bindAttribute<QOpenGLFunctions>(this, 0, *position);
+    if (color) {
+        mesh.bindAttribute<QOpenGLFunctions>(this, 1, *color);
+    } else {
+        glVertexAttrib3f(1, 0.6f, 0.6f, 0.6f);
+    }
+    vao.release();
+
+    drawIndexType = mesh.glIndexType();
+    drawIndexCount = int(mesh.drawIndexCount());
+    meshFit = mesh.fitTransform(1.2f);
+
+    GL_DIAG_LABEL(GL_VERTEX_ARRAY, vao.objectId(), "mesh VAO");
+    GL_DIAG_LABEL(GL_BUFFER, vbo.bufferId(), "mesh VBO");
+    GL_DIAG_LABEL(GL_BUFFER, ebo, "mesh EBO");
+    qDebug() << "Loaded" << meshPath << ":" << mesh.header().vertexCount << "vertices," << drawIndexCount / 3
+             << "triangles";
+    return true;
+}
+
 void OpenGLWidget::resizeGL(int w, int h)
 {
     glViewport(0, 0, w, h);
     projection.setToIdentity();
     projection.perspective(45.0f, float(w)/float(h), 0.1f, 100.0f);
-    qDebug() << "Viewport resized to:" << w << "x" << h;
+    GL_DIAG_TRACE() << "Viewport resized to:" << w << "x" << h;
 }
 
 void OpenGLWidget::paintGL()
 {
+    GL_COUNTERS_BEGIN_FRAME();
+    // Driver messages queued since the last frame; no GL query in the frame itself
+    GL_DIAG_DRAIN();
+
+    // The stats overlay turns depth testing off while it draws and back on afterwards
+    glEnable(GL_DEPTH_TEST);
+
     // Clear buffers with light gray background
     glClearColor(0.9f, 0.9f, 0.9f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    if (!program || !program->isLinked()) {
-        qDebug() << "Shader program not ready, skipping draw call";
+    if (!cubeVariant) {
+        // setupShaders() already said why; the counter frame still ends and the overlay still shows it
+        GL_COUNTERS_END_FRAME();
+        if (showStats) {
+            GL_DIAG_GROUP("stats overlay");
+            drawStatsOverlay();
+        }
         return;
     }
 
+    GL_COUNTERS_BEGIN_PASS("cube");
+    GL_DIAG_PUSH_GROUP("cube");
+
     program->bind();
     vao.bind();
+    GL_COUNT_PROGRAM_BIND();
+    GL_COUNT_VAO_BIND();
 
     // Set transformation matrices
-    program->setUniformValue("projection", projection);
+    program->setUniformValue(cubeVariant->projection, projection);
+    GL_COUNT_UNIFORM();
 
     // View matrix - camera positioned at (0,0,-3) looking at origin
     view.setToIdentity();
     view.translate(0.0f, 0.0f, -3.0f);
-    program->setUniformValue("view", view);
+    program->setUniformValue(cubeVariant->view, view);
+    GL_COUNT_UNIFORM();
 
     // Model matrix - apply continuous rotation
     model.setToIdentity();
     model.rotate(rotationAngle, QVector3D(0.5f, 1.0f, 0.0f));
+    model *= meshFit;
     rotationAngle += 1.0f;
     if (rotationAngle >= 360.0f) {
         rotationAngle = 0.0f;
     }
-    program->setUniformValue("model", model);
+    program->setUniformValue(cubeVariant->model, model);
+    GL_COUNT_UNIFORM();
 
     // Draw the cube using EBO (glDrawElements)
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, drawIndexCount, drawIndexType, 0);
+    GL_COUNT_DRAW(GL_TRIANGLES, drawIndexCount);
 
-    // Check for OpenGL errors
-    GLenum error = glGetError();
-    if (error != GL_NO_ERROR) {
-        qDebug() << "OpenGL draw error:" << error;
-    }
+    // Only polls glGetError() in diagnostics builds without KHR_debug
+    GL_DIAG_CHECK("cube draw");
 
     vao.release();
     program->release();
+
+    GL_DIAG_POP_GROUP();
+    GL_COUNTERS_END_PASS();
+    GL_COUNTERS_END_FRAME();
+
+    if (showStats) {
+        GL_DIAG_GROUP("stats overlay");
+        drawStatsOverlay();
+    }
+}
+
+void OpenGLWidget::drawStatsOverlay()
+{
+#ifdef GL_COUNTERS_ENABLED
+    QStringList lines;
+    lines << QString("Frame: %1").arg(glcounters::format(glcounters::lastFrame()));
+    const auto passes = glcounters::lastFramePasses();
+    for (const glcounters::PassCounters &pass : passes) {
+        lines << QString("  %1: %2 draws, %3 primitives")
+                     .arg(pass.name)
+                     .arg(pass.counters[glcounters::DrawCalls])
+                     .arg(pass.counters[glcounters::Primitives]);
+    }
+#else
+    QStringList lines{ "GL counters are compiled out (configure with -DGL_COUNTERS=ON)" };
+#endif
+    lines << GpuMemoryTracker::instance().report().split('\n');
+
+    // Built on first use: the atlas costs a few milliseconds nobody needs at startup
+    if (!hudText.isInitialized()) {
+        if (!hudFont.isValid()) {
+            hudFont.build(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        }
+        if (!hudText.initialize(&hudFont)) {
+            showStats = false;
+            return;
+        }
+        hudText.setOutline(1.5f, QColor(255, 255, 255, 200));
+    }
+
+    const qreal ratio = devicePixelRatio();
+    hudText.addText(lines.join('\n'), QPointF(8.0 * ratio, 8.0 * ratio), float(13.0 * ratio), Qt::black);
+    hudText.flush(QSize(int(width() * ratio), int(height() * ratio)));
+}
+
+void OpenGLWidget::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() == Qt::Key_S) {
+        showStats = !showStats;
+        update();
+        return;
+    }
+    QOpenGLWidget::keyPressEvent(event);
 }
 
 void OpenGLWidget::updateAnimation()
@@ -9,6 +9,11 @@
 #include <QTimer>
 #include <QVector3D>
 #include <QMatrix4x4>  //
+#include "glcounters.h"
+#include "gpumemory.h"
+#include "sdftext.h"
+#include "shadervariants.h"
+#include "startupprofiler.h"
 
 class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
@@ -18,30 +23,50 @@ public:
     OpenGLWidget(QWidget *parent = nullptr);
     ~OpenGLWidget();
 
+    /**
+     * @brief Draws this mesh file (tools/meshconv) instead of the cube; must be called before initializeGL().
+     */
+    void setMeshFile(const QString &filePath) { meshPath = filePath; }
+
 protected:
     void initializeGL() override;
     void resizeGL(int w, int h) override;
     void paintGL() override;
+    void keyPressEvent(QKeyEvent *event) override;
 
 private slots:
     void updateAnimation();
 
 private:
+    ShaderVariantCache shaderVariants;
+    const ShaderVariant *cubeVariant = nullptr;
     QOpenGLShaderProgram *program;
     QOpenGLBuffer vbo;
     QOpenGLVertexArrayObject vao;
     //QOpenGLBuffer ebo;        //
     GLuint ebo;
     QTimer *animationTimer;
+    GpuMemoryTracker::Handle vboMemory = 0;
+    GpuMemoryTracker::Handle eboMemory = 0;
 
     QMatrix4x4 projection;
     QMatrix4x4 view;
     QMatrix4x4 model;
+    QMatrix4x4 meshFit;         // Centers a loaded mesh and scales it into the unit cube
+
+    QString meshPath;
+    int drawIndexCount = 36;
+    GLenum drawIndexType = GL_UNSIGNED_INT;
 
     float rotationAngle = 0.0f;
+    bool showStats = false; // Toggled with the 'S' key
+    SdfFontAtlas hudFont;
+    TextRenderer hudText;   // Draws the stats overlay in one call
 
     void setupCubeData();
+    bool setupMeshFile();
     void setupShaders();
+    void drawStatsOverlay();
 };
 
 #endif
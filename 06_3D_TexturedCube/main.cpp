@@ -1,14 +1,99 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QTimer>
 #include "openglwidget.h"
+#include "perftrace.h"
+#include "startupprofiler.h"
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler &startup = StartupProfiler::instance();
+    startup.mark("main()");
+
     QApplication app(argc, argv);
+    startup.mark("QApplication created");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption captureOption("capture", "Record frames into <dir>.", "dir");
+    QCommandLineOption formatOption("capture-format", "Capture encoding: png, rgb or yuv.", "format", "png");
+    QCommandLineOption framesOption("capture-frames", "Quit after capturing <n> frames.", "n", "0");
+    QCommandLineOption sizeOption("size", "Window size, e.g. 1920x1080.", "WxH", "800x600");
+    QCommandLineOption traceOption("trace", "Record the GL command stream into <file> for glreplay.", "file");
+    QCommandLineOption traceFramesOption("trace-frames", "Number of frames to record.", "n", "120");
+    QCommandLineOption budgetOption("gpu-budget", "Evict reloadable textures above <MB> of GPU memory.", "MB", "0");
+    QCommandLineOption memoryJsonOption("memory-json", "Keep a live GPU memory report in <file>.", "file");
+    QCommandLineOption startupJsonOption("startup-json", "Write the startup phase timings to <file> on exit.", "file");
+    QCommandLineOption perfTraceOption("perf-trace", "Write a CPU/GPU timeline (Chrome trace JSON) to <file> on exit.", "file");
+    QCommandLineOption perfTraceFramesOption("perf-trace-frames", "Quit after <n> frames of timeline trace (0 = run until closed).", "n", "0");
+    QCommandLineOption texturePoolOption("texture-pool", "Stream face mip levels within <MB> of GPU memory (0 = load everything).", "MB", "64");
+    parser.addOptions({ captureOption, formatOption, framesOption, sizeOption, traceOption, traceFramesOption,
+                        budgetOption, memoryJsonOption, texturePoolOption, startupJsonOption, perfTraceOption,
+                        perfTraceFramesOption });
+    parser.process(app);
+
+    if (parser.isSet(perfTraceOption)) {
+#ifndef PERFTRACE_ENABLED
+        qWarning() << "Zones are compiled out of this build (configure with -DPERFTRACE=ON): the trace will be empty";
+#endif
+        perftrace::start();
+    }
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    memory.setBudget(qint64(parser.value(budgetOption).toDouble() * 1024 * 1024));
+
+    const QStringList size = parser.value(sizeOption).split('x');
+    const int width = size.value(0).toInt();
+    const int height = size.value(1).toInt();
 
     OpenGLWidget widget;
-    widget.resize(800, 600);
+    widget.resize(width > 0 ? width : 800, height > 0 ? height : 600);
+
+    if (parser.isSet(captureOption)) {
+        FrameCapture::Format format;
+        if (!FrameCapture::parseFormat(parser.value(formatOption), &format)) {
+            qWarning() << "Unknown capture format:" << parser.value(formatOption);
+            return 1;
+        }
+        widget.enableCapture(parser.value(captureOption), format, parser.value(framesOption).toInt());
+    }
+
+    widget.setTexturePool(qint64(parser.value(texturePoolOption).toDouble() * 1024 * 1024));
+
+    if (parser.isSet(traceOption)) {
+        widget.enableTrace(parser.value(traceOption), parser.value(traceFramesOption).toInt());
+    }
+
+    if (parser.isSet(perfTraceOption)) {
+        widget.enablePerfTrace(parser.value(perfTraceFramesOption).toInt());
+    }
+
     widget.setWindowTitle("3D_TexturedCube - Qt OpenGL");
     widget.show();
+    startup.mark("window shown");
+
+    // Live report: rewritten every two seconds so dashboards can be watched while they run
+    QTimer memoryReportTimer;
+    if (parser.isSet(memoryJsonOption)) {
+        const QString path = parser.value(memoryJsonOption);
+        QObject::connect(&memoryReportTimer, &QTimer::timeout, [&memory, path]() { memory.dumpJson(path); });
+        memoryReportTimer.start(2000);
+    }
+
+    const int result = app.exec();
 
-    return app.exec();
+    qDebug().noquote() << memory.report();
+    if (parser.isSet(memoryJsonOption)) {
+        memory.dumpJson(parser.value(memoryJsonOption));
+    }
+    if (parser.isSet(startupJsonOption)) {
+        startup.dumpJson(parser.value(startupJsonOption));
+    }
+    if (parser.isSet(perfTraceOption)) {
+        widget.finishPerfTrace();
+        perftrace::stop();
+        perftrace::writeJson(parser.value(perfTraceOption));
+    }
+    return result;
 }
@@ -1,4 +1,5 @@
 #include "openglwidget.h"
+#include "meshgen.h"
 #include <QDebug>
 #include <QFile>
 #include <QImage>
@@ -6,104 +7,19 @@
 #include <QFont>
 #include <QMessageBox>
 #include <QtMath>
+#include <QCoreApplication>
+#include <QVector4D>
+#include <limits>
 
-// ------------------- Shader Source Code (Embedded) -------------------
-// Vertex Shader Source
-const char *vertexShaderSource = R"glsl(
-#version 330 core
-layout (location = 0) in vec3 position; // Vertex position
-layout (location = 1) in vec2 texCoord;   // Texture coordinates
-
-out vec2 TexCoord;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-    gl_Position = projection * view * model * vec4(position, 1.0);
-    TexCoord = texCoord;
-}
-)glsl";
-
-// Fragment Shader Source
-const char *fragmentShaderSource = R"glsl(
-#version 330 core
-out vec4 FragColor;
-
-in vec2 TexCoord;
-
-uniform sampler2D textureSampler; // Texture sampler
-
-void main()
-{
-    // Sample color from the texture
-    FragColor = texture(textureSampler, TexCoord);
-}
-)glsl";
 // ------------------- Vertex and Index Data -------------------
-// 3D Dice Cube Data (Position (x, y, z) + Texture Coords (u, v))
-float cubeVertices[] = {
-    // Face 1: Front (+Z) - Corresponds to face '1'
-    // Vertex Position (3)  // Texture Coordinates (2)
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-    0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-    0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-
-    // Face 2: Back (-Z) - Corresponds to face '6'
-    -0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-    0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-    0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-
-    // Face 3: Top (+Y) - Corresponds to face '5'
-    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-    0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-
-    // Face 4: Bottom (-Y) - Corresponds to face '2'
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-    0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-    0.5f, -0.5f,  0.5f,  1.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 1.0f,
-
-    // Face 5: Right (+X) - Corresponds to face '3'
-    0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-    0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-    0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-
-    // Face 6: Left (-X) - Corresponds to face '4'
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-    -0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
-};
-
-// 6 faces, 6 indices per face (2 triangles)
-unsigned int cubeIndices[] = {
-    // Face 1 (+Z) - Indices 0 to 5
-    0, 1, 2,
-    2, 3, 0,
-    // Face 2 (-Z) - Indices 6 to 11
-    4, 5, 6,
-    6, 7, 4,
-    // Face 3 (+Y) - Indices 12 to 17
-    8, 9, 10,
-    10, 11, 8,
-    // Face 4 (-Y) - Indices 18 to 23
-    12, 13, 14,
-    14, 15, 12,
-    // Face 5 (+X) - Indices 24 to 29
-    16, 17, 18,
-    18, 19, 16,
-    // Face 6 (-X) - Indices 30 to 35
-    20, 21, 22,
-    22, 23, 20
-};
+// 3D dice cube generated at compile time (common/meshgen.h): position (x, y, z) + texture coords (u, v).
+// 4 vertices and 6 indices per face, faces in the order +Z (1), -Z (6), +Y (5), -Y (2), +X (3), -X (4).
+static constexpr auto cubeMesh = meshgen::cube<meshgen::PosUv>();
+
+// Textured, transformed by projection * view * model. Textures are uploaded top row first
+// (no mirrored() copy), so v runs top-down: FlipV
+static constexpr ShaderFeatures cubeFeatures =
+    vertexFeatures<meshgen::PosUv>() | ShaderFeatures::Transform | ShaderFeatures::FlipV;
 
 // ------------------- Constructor and Destructor -------------------
 
@@ -111,9 +27,17 @@ OpenGLWidget::OpenGLWidget(QWidget *parent)
     : QOpenGLWidget(parent),
     rotationAngle(0.0f)
 {
-    // Initialize textures array pointers to nullptr
+    // Initialize texture names to 0 (no texture)
     for (int i = 0; i < 6; ++i) {
-        textures[i] = nullptr;
+        textures[i] = 0;
+    }
+
+    // One mapped archive instead of a file open per asset; loose files are the fallback
+    {
+        StartupProfiler::Scope phase("asset pack");
+        if (!assets.open(AssetPack::defaultPath())) {
+            qDebug() << "No asset pack at" << AssetPack::defaultPath() << "- loading loose files";
+        }
     }
 
     // Setup timer for animation
@@ -127,18 +51,37 @@ OpenGLWidget::~OpenGLWidget()
     // Destructor: Ensure resources are released before destroying the OpenGL Context
     makeCurrent();
 
-    if (program) {
-        delete program;
-        program = nullptr;
+    if (capture.isActive()) {
+        capture.finish(); // Drain in-flight PBOs and wait for the encoders
+        qDebug().noquote() << capture.report();
+    }
+
+    shaderVariants.release();
+    program = nullptr;
+
+    if (texturePoolBytes > 0) {
+        qDebug().noquote() << streamer.report();
+        streamer.release();
     }
+    gpuTimeline.release();
 
-    // Delete the 6 texture pointers
+    // Delete the 6 textures
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
     for (int i = 0; i < 6; ++i) {
         if (textures[i]) {
-            delete textures[i];
-            textures[i] = nullptr;
+            glDeleteTextures(1, &textures[i]);
+            textures[i] = 0;
         }
+        memory.release(textureMemory[i]);
     }
+    if (placeholderTexture) {
+        glDeleteTextures(1, &placeholderTexture);
+        placeholderTexture = 0;
+    }
+    memory.release(placeholderMemory);
+    memory.release(vboMemory);
+    memory.release(eboMemory);
+    uploader.release();
 
     vbo.destroy();
     vao.destroy();
@@ -155,16 +98,88 @@ OpenGLWidget::~OpenGLWidget()
 
 void OpenGLWidget::initializeGL()
 {
-    initializeOpenGLFunctions();
+    PERFTRACE_SCOPE("initializeGL");
+    StartupProfiler::instance().mark("initializeGL()");
+    {
+        StartupProfiler::Scope phase("initializeOpenGLFunctions");
+        initializeOpenGLFunctions();
+    }
     qDebug() << "OpenGL version: " << (char*)glGetString(GL_VERSION);
 
+    if (perfTrace && !gpuTimeline.initialize()) {
+        qWarning() << "Timeline trace without GPU spans";
+    }
+
+    // Start before any resource is created so the trace can rebuild them on replay
+    if (!tracePath.isEmpty()) {
+        startTrace(tracePath, traceFrames);
+    }
+
     glEnable(GL_DEPTH_TEST);
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 
-    setupShaders();
-    setupCubeData();
+    // A trace must contain every resource before its first frame, and captured
+    // frames should show the real textures rather than placeholders
+    deferInit = tracePath.isEmpty() && captureDir.isEmpty();
+
+    // Only what the first frame draws runs before it; the face textures follow over the next frames
+    initQueue.add("shaders", InitQueue::Priority::Critical, [this]() { setupShaders(); return true; });
+    initQueue.add("cube data", InitQueue::Priority::Critical, [this]() { setupCubeData(); return true; });
+    initQueue.add("placeholder texture", InitQueue::Priority::Critical, [this]() {
+        uploader.initialize();
+        setupPlaceholderTexture();
+        return true;
+    });
+    loadTextures(); // Queue the textures
+    if (!captureDir.isEmpty()) {
+        initQueue.add("frame capture", InitQueue::Priority::Critical, [this]() {
+            capture.initialize(captureDir, captureFormat);
+            return true;
+        });
+    }
+
+    connect(this, &QOpenGLWidget::frameSwapped, this, []() { StartupProfiler::instance().markFirstFrame(); },
+            Qt::SingleShotConnection);
 
-    loadTextures(); // Load textures
+    if (deferInit) {
+        initQueue.runCritical();
+    } else {
+        initQueue.runAll();
+        StartupProfiler::instance().markFullyInitialized();
+    }
+}
+
+void OpenGLWidget::enableCapture(const QString& outputDir, FrameCapture::Format format, int maxFrames)
+{
+    captureDir = outputDir;
+    captureFormat = format;
+    captureMaxFrames = maxFrames;
+}
+
+void OpenGLWidget::setTexturePool(qint64 bytes)
+{
+    texturePoolBytes = bytes;
+}
+
+void OpenGLWidget::enableTrace(const QString& filePath, int frames)
+{
+    tracePath = filePath;
+    traceFrames = frames;
+}
+
+void OpenGLWidget::enablePerfTrace(int frames)
+{
+    perfTrace = true;
+    perfTraceFrames = frames;
+}
+
+void OpenGLWidget::finishPerfTrace()
+{
+    if (gpuTimeline.isInitialized()) {
+        makeCurrent();
+        gpuTimeline.flush();
+        doneCurrent();
+    }
 }
 
 void OpenGLWidget::resizeGL(int w, int h)
@@ -175,10 +190,42 @@ void OpenGLWidget::resizeGL(int w, int h)
 
 void OpenGLWidget::paintGL()
 {
+    PERFTRACE_SCOPE("paintGL");
+    gpuTimeline.collect(); // Spans of earlier frames that the GPU has finished
+    PERFTRACE_GPU_SCOPE(gpuTimeline, "frame");
+
+    const qreal dpr = devicePixelRatioF();
+    traceFrameBegin(int(width() * dpr), int(height() * dpr));
+    GL_COUNTERS_BEGIN_FRAME();
+
+    // Evict least-recently-used textures of this share group if we are over the GPU memory budget
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    memory.beginFrame();
+    memory.enforceBudget();
+
+    // Deferred initialization: a slice of the remaining load work before drawing
+    StartupProfiler &startup = StartupProfiler::instance();
+    if (!initQueue.isDone() && initQueue.runFor(InitBudgetMs)) {
+        startup.markFullyInitialized();
+    }
+    if (!startupReported && startup.isFullyInitialized()) {
+        startupReported = true;
+        qDebug().noquote() << startup.report();
+    }
+
+    if (texturePoolBytes > 0) {
+        streamer.update(); // Upload finished mip levels and request the next ones
+    }
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    program->bind();
-    vao.bind();
+    if (!program) {
+        finishFrame(); // Still counts toward --capture-frames and --perf-trace-frames, so headless runs end
+        return;        // setupShaders() already said why
+    }
+
+    tracedBind(program);
+    tracedBind(vao);
 
     // View Matrix (Camera)
     view.setToIdentity();
@@ -186,143 +233,319 @@ void OpenGLWidget::paintGL()
                 QVector3D(0.0f, 0.0f, 0.0f),
                 QVector3D(0.0f, 1.0f, 0.0f));
 
-    program->setUniformValue("view", view);
-    program->setUniformValue("projection", projection);
+    tracedSetUniformValue(program, "view", view);
+    tracedSetUniformValue(program, "projection", projection);
 
     // Model Matrix (Rotation Animation)
     model.setToIdentity();
     model.rotate(rotationAngle, 0.0f, 1.0f, 0.0f); // Rotate around Y-axis
     model.rotate(rotationAngle / 2.0f, 1.0f, 0.0f, 0.0f); // Rotate around X-axis
-    program->setUniformValue("model", model);
+    tracedSetUniformValue(program, "model", model);
 
     // Bind EBO (Element Buffer Object)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 
     // Draw 6 faces, binding the corresponding texture for each face
-    for (int i = 0; i < 6; ++i)
-    {
-        if (textures[i]) {
-            glActiveTexture(GL_TEXTURE0);
-            textures[i]->bind();
-            program->setUniformValue("textureSampler", 0);
+    GL_COUNTERS_BEGIN_PASS("faces");
+    PERFTRACE_GPU_BEGIN(gpuTimeline, "faces");
+    if (texturePoolBytes > 0) {
+        const QMatrix4x4 mvp = projection * view * model;
+        glActiveTexture(GL_TEXTURE0);
+        tracedSetUniformValue(program, "textureSampler", 0);
+        for (int i = 0; i < 6; ++i) {
+            streamer.requestScreenSize(streamedFaces[i], faceScreenSize(i, mvp, int(width() * dpr), int(height() * dpr)));
+
+            GLuint texture = streamer.textureId(streamedFaces[i]);
+            if (texture == 0) {
+                texture = placeholderTexture; // Tail not decoded yet
+            }
+            if (texture != 0) {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(i * 6 * sizeof(unsigned int)));
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    } else {
+        for (int i = 0; i < 6; ++i) {
+            if (initQueue.isDone()) {
+                ensureTexture(i); // Reload after an eviction; the first load is an init task
+            }
+            memory.touch(textureMemory[i]);
+            const GLuint texture = textures[i] ? textures[i] : placeholderTexture;
+            if (texture) {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, texture);
+                tracedSetUniformValue(program, "textureSampler", 0);
+
+                // Draw the i-th face (6 indices per face)
+                // Offset i * 6 * sizeof(unsigned int)
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(i * 6 * sizeof(unsigned int)));
+
+                glBindTexture(GL_TEXTURE_2D, 0);
+            }
+        }
+    }
+    PERFTRACE_GPU_END(gpuTimeline);
+    GL_COUNTERS_END_PASS();
+
+    tracedRelease(vao);
+    tracedRelease(program);
 
-            // Draw the i-th face (6 indices per face)
-            // Offset i * 6 * sizeof(unsigned int)
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(i * 6 * sizeof(unsigned int)));
+    finishFrame();
+}
 
-            textures[i]->release();
+void OpenGLWidget::finishFrame()
+{
+    GL_COUNTERS_END_FRAME();
+    traceFrameEnd();
+
+    if (capture.isActive()) {
+        // Read back the frame we just drew; returns without waiting for the GPU. Only frames that will
+        // reach the disk count: ring-full drops are refused here, encoder drops show up in the stats.
+        const quint64 kept = capturedFrames - capture.stats().droppedNoBuffer;
+        if (captureMaxFrames <= 0 || kept < quint64(captureMaxFrames)) {
+            if (capture.captureFrame(defaultFramebufferObject(), int(width() * dpr), int(height() * dpr))) {
+                ++capturedFrames;
+                if (captureMaxFrames > 0 && kept + 1 == quint64(captureMaxFrames)) {
+                    QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+                }
+            }
         }
     }
 
-    vao.release();
-    program->release();
+    if (perfTrace && perfTraceFrames > 0 && ++perfTracedFrames == perfTraceFrames) {
+        QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+    }
 }
 
 // ------------------- Shader and Data Setup -------------------
 
 void OpenGLWidget::setupShaders()
 {
-    program = new QOpenGLShaderProgram(this);
+    PERFTRACE_SCOPE("setupShaders");
+    // Specialized from the shared annotated source (common/shadervariants.cpp);
+    // ShaderVariantCache logs the compiler output of a variant that does not build
+    program = shaderVariants.program(cubeFeatures);
 
-    // Compile using embedded string source code
-    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource))
-        qDebug() << "Vertex shader compilation failed:" << program->log();
-
-    if (!program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource))
-        qDebug() << "Fragment shader compilation failed:" << program->log();
-
-    if (!program->link())
-        qDebug() << "Shader program linking failed:" << program->log();
+    traceProgram(program);
 }
 
 void OpenGLWidget::setupCubeData()
 {
+    PERFTRACE_SCOPE("setupCubeData");
     vao.create();
-    vao.bind();
+    tracedBind(vao);
 
     vbo.create();
-    vbo.bind();
-    vbo.allocate(cubeVertices, sizeof(cubeVertices));
+    tracedBind(vbo);
+    tracedAllocate(vbo, cubeMesh.vertices.data(), int(cubeMesh.vertexBytes()));
 
     // Create and bind EBO (Element Buffer Object)
     glGenBuffers(1, &ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cubeMesh.indexBytes(), cubeMesh.indices.data(), GL_STATIC_DRAW);
+
+    const QString owner = QString("06_3D_TexturedCube@%1").arg(quintptr(this), 0, 16);
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    vboMemory = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, qint64(cubeMesh.vertexBytes()), owner, "cube VBO");
+    eboMemory = memory.registerAllocation(GpuMemoryTracker::Category::IndexBuffer, qint64(cubeMesh.indexBytes()), owner, "cube EBO");
 
     // Vertex position (location 0, defined in GLSL)
-    program->enableAttributeArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, cubeMesh.stride(), (void*)0);
 
-    // Texture coordinates (location 1, defined in GLSL)
-    program->enableAttributeArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    // Texture coordinates (location 2, defined in GLSL)
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, cubeMesh.stride(), (void*)(meshgen::PosUv::UvOffset * sizeof(float)));
 
-    vao.release();
-    vbo.release();
+    tracedRelease(vao);
+    tracedRelease(vbo);
 }
 
 // ------------------- Texture Loading Helper Function -------------------
 
+/**
+ * @brief Light gray 256x256 image with @p text drawn in red, shown when a face texture is missing.
+ *
+ * Also called from the texture streaming workers, so it must not touch GL or widget state.
+ */
+static QImage makeFallbackImage(const QString& text)
+{
+    const int size = 256;
+    QImage fallbackImage(size, size, QImage::Format_RGBA8888);
+    fallbackImage.fill(QColor(240, 240, 240)); // Light gray background
+
+    QPainter painter(&fallbackImage);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // Draw the number/text
+    QFont font("Arial", size / 2, QFont::Bold);
+    painter.setFont(font);
+    painter.setPen(Qt::red);
+
+    // Draw text centered
+    painter.drawText(fallbackImage.rect(), Qt::AlignCenter, text);
+
+    painter.end();
+    return fallbackImage;
+}
+
 /**
  * @brief Tries to load a single texture from a file path, generates a fallback texture with text if failed.
+ *
+ * The file is decoded straight into the uploader's staging buffer: no QImage copy, no
+ * mirrored() pass and no RGBA conversion. Rows stay top-down; the vertex shader flips v.
  */
-QOpenGLTexture* OpenGLWidget::loadSingleTextureOrFallback(const QString& filePath, const QString& fallbackText)
+GLuint OpenGLWidget::loadSingleTextureOrFallback(const QString& filePath, const QString& fallbackText, QSize* size)
 {
-    QOpenGLTexture* newTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
-    QImage image;
-
-    // 1. Try to load from file (relies on Qt Resource System)
-    if (image.load(filePath)) {
-        // Flip vertically to match OpenGL/Qt coordinate systems
-        // Use explicit bools to avoid C4305 warning in some Qt versions
-        image = image.mirrored(false, true);
-        newTexture->setData(image);
-        qDebug() << "Successfully loaded texture:" << filePath;
+    PERFTRACE_SCOPE("loadSingleTextureOrFallback");
+    // 1. Try the asset pack, then the loose file (relative to the working directory)
+    const QByteArray packed = assets.data(filePath);
+    GLuint texture = packed.isEmpty() ? uploader.uploadFile(filePath, true, size)
+                                      : uploader.uploadData(packed, true, size);
+    if (texture != 0) {
+        qDebug() << "Successfully loaded texture:" << filePath << (packed.isEmpty() ? "" : "(packed)") << "decode"
+                 << uploader.stats().lastDecodeMs << "ms, upload" << uploader.stats().lastUploadMs << "ms";
+        if (isTracing()) {
+            // Only the trace needs the pixels on the CPU side
+            traceTexture(texture, packed.isEmpty() ? QImage(filePath) : QImage::fromData(packed), true);
+        }
     } else {
         // 2. Failed to load, generate fallback texture
         qWarning() << "Failed to load texture:" << filePath << ". Generating fallback texture.";
 
-        const int size = 256;
-        QImage fallbackImage(size, size, QImage::Format_RGBA8888);
-        fallbackImage.fill(QColor(240, 240, 240)); // Light gray background
+        const QImage image = makeFallbackImage(fallbackText);
+        texture = uploader.uploadImage(image, true);
+        if (size) {
+            *size = image.size();
+        }
+        traceTexture(texture, image, true);
+    }
 
-        QPainter painter(&fallbackImage);
-        painter.setRenderHint(QPainter::Antialiasing);
+    return texture;
+}
 
-        // Draw the number/text
-        QFont font("Arial", size / 2, QFont::Bold);
-        painter.setFont(font);
-        painter.setPen(Qt::red);
+void OpenGLWidget::loadTextures()
+{
+    PERFTRACE_SCOPE("loadTextures");
+    // Load 6 textures according to the face order in cubeVertices (opposite sides add to 7)
+    // Note: These names are looked up in assets.pak next to the executable (built by tools/assetpacker),
+    // then as loose files relative to the working directory. If the images are missing, the red fallback numbers will be shown.
+    const char *faces[6][2] = {
+        { "textures/dice_face_1.png", "1" }, // +Z Face (1)
+        { "textures/dice_face_6.png", "6" }, // -Z Face (6)
+        { "textures/dice_face_5.png", "5" }, // +Y Face (5)
+        { "textures/dice_face_2.png", "2" }, // -Y Face (2)
+        { "textures/dice_face_3.png", "3" }, // +X Face (3)
+        { "textures/dice_face_4.png", "4" }  // -X Face (4)
+    };
+    for (int i = 0; i < 6; ++i) {
+        texturePaths[i] = faces[i][0];
+        textureFallbackText[i] = faces[i][1];
+    }
 
-        // Draw text centered
-        painter.drawText(fallbackImage.rect(), Qt::AlignCenter, fallbackText);
+    if (texturePoolBytes > 0 && !tracePath.isEmpty()) {
+        // The streamer's uploads bypass the recorder, so a trace would replay without textures
+        qDebug() << "Texture streaming disabled while tracing";
+        texturePoolBytes = 0;
+    }
 
-        painter.end();
+    if (texturePoolBytes > 0) {
+        // Starting the decoders is cheap and lets them work while the first frames are drawn
+        initQueue.add("texture streamer", InitQueue::Priority::Critical, [this]() {
+            streamer.initialize(texturePoolBytes);
+            for (int i = 0; i < 6; ++i) {
+                const QString text = textureFallbackText[i];
+                streamedFaces[i] = streamer.addTexture(texturePaths[i], [text]() { return makeFallbackImage(text); },
+                                                       assets.data(texturePaths[i]));
+            }
+            return true;
+        });
+        // Only the low-resolution tails; finer levels follow as the faces are drawn
+        initQueue.add("texture tails", InitQueue::Priority::High, [this]() {
+            if (!deferInit) {
+                streamer.waitForTails();
+                return true;
+            }
+            // streamer.update() uploads them as they are decoded
+            for (int i = 0; i < 6; ++i) {
+                if (streamer.residentLevel(streamedFaces[i]) < 0) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        return;
+    }
 
-        // Flip the fallback image vertically
-        newTexture->setData(fallbackImage.mirrored(false, true));
+    // One face per task: each is a decode + upload, usually one per frame within the budget
+    for (int i = 0; i < 6; ++i) {
+        initQueue.add("texture " + texturePaths[i], InitQueue::Priority::High, [this, i]() {
+            ensureTexture(i);
+            return true;
+        });
     }
+}
 
-    // 3. Configure texture parameters
-    newTexture->setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
-    newTexture->setMagnificationFilter(QOpenGLTexture::Linear);
-    newTexture->setWrapMode(QOpenGLTexture::DirectionS, QOpenGLTexture::Repeat);
-    newTexture->setWrapMode(QOpenGLTexture::DirectionT, QOpenGLTexture::Repeat);
-    newTexture->generateMipMaps();
+void OpenGLWidget::setupPlaceholderTexture()
+{
+    QImage image(1, 1, QImage::Format_RGBA8888);
+    image.fill(QColor(200, 200, 200));
+    placeholderTexture = uploader.uploadImage(image, false);
+    traceTexture(placeholderTexture, image, false);
+
+    const QString owner = QString("06_3D_TexturedCube@%1").arg(quintptr(this), 0, 16);
+    placeholderMemory = GpuMemoryTracker::instance().registerAllocation(
+        GpuMemoryTracker::Category::Texture, GpuMemoryTracker::textureBytes(1, 1, 4, false), owner, "placeholder");
+}
 
-    return newTexture;
+float OpenGLWidget::faceScreenSize(int face, const QMatrix4x4& mvp, int viewportWidth, int viewportHeight) const
+{
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+
+    // The face's texture coordinates span [0, 1], so its on-screen extent is the texture's
+    for (int k = 0; k < 4; ++k) {
+        const float *p = &cubeMesh.vertices[(face * 4 + k) * meshgen::PosUv::Floats];
+        const QVector4D clip = mvp * QVector4D(p[0], p[1], p[2], 1.0f);
+        if (clip.w() <= 0.0f) {
+            // Crosses the camera plane: as large as the view gets
+            return float(qMax(viewportWidth, viewportHeight));
+        }
+        const float x = (clip.x() / clip.w() * 0.5f + 0.5f) * viewportWidth;
+        const float y = (clip.y() / clip.w() * 0.5f + 0.5f) * viewportHeight;
+        minX = qMin(minX, x);
+        maxX = qMax(maxX, x);
+        minY = qMin(minY, y);
+        maxY = qMax(maxY, y);
+    }
+    return qMax(maxX - minX, maxY - minY);
 }
 
-void OpenGLWidget::loadTextures()
+void OpenGLWidget::ensureTexture(int face)
 {
-    // Load 6 textures according to the face order in cubeVertices (opposite sides add to 7)
-    // Note: These paths rely on your project's Qt resource file (.qrc). If the images are missing, the red fallback numbers will be shown.
-    textures[0] = loadSingleTextureOrFallback("textures/dice_face_1.png", "1"); // +Z Face (1)
-    textures[1] = loadSingleTextureOrFallback("textures/dice_face_6.png", "6"); // -Z Face (6)
-    textures[2] = loadSingleTextureOrFallback("textures/dice_face_5.png", "5"); // +Y Face (5)
-    textures[3] = loadSingleTextureOrFallback("textures/dice_face_2.png", "2"); // -Y Face (2)
-    textures[4] = loadSingleTextureOrFallback("textures/dice_face_3.png", "3"); // +X Face (3)
-    textures[5] = loadSingleTextureOrFallback("textures/dice_face_4.png", "4"); // -X Face (4)
+    if (textures[face]) {
+        return;
+    }
+
+    QSize size;
+    textures[face] = loadSingleTextureOrFallback(texturePaths[face], textureFallbackText[face], &size);
+    const qint64 bytes = GpuMemoryTracker::textureBytes(size.width(), size.height(), 4, true);
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    if (textureMemory[face] == 0) {
+        // Textures come from disk, so they can be evicted under memory pressure and reloaded on use
+        const QString owner = QString("06_3D_TexturedCube@%1").arg(quintptr(this), 0, 16);
+        textureMemory[face] = memory.registerAllocation(
+            GpuMemoryTracker::Category::Texture, bytes, owner, texturePaths[face], [this, face]() {
+                glDeleteTextures(1, &textures[face]);
+                textures[face] = 0;
+            });
+    } else {
+        memory.markResident(textureMemory[face], bytes);
+    }
 }
 
 // ------------------- Animation Slot Function -------------------
@@ -2,15 +2,22 @@
 #define OPENGLWIDGET_H
 
 #include <QOpenGLWidget>
-#include <QOpenGLFunctions_3_3_Core>
 #include <QOpenGLBuffer>
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLShaderProgram>
-#include <QOpenGLTexture> // 引入 QOpenGLTexture
 #include <QMatrix4x4>   // 引入 QMatrix4x4 (用于 Model, View, Projection 矩阵)
 #include <QTimer>       // 引入 QTimer (用于动画)
+#include "assetpack.h"
+#include "framecapture.h"
+#include "gltrace.h"
+#include "gpumemory.h"
+#include "perftrace.h"
+#include "shadervariants.h"
+#include "startupprofiler.h"
+#include "texturestreamer.h"
+#include "textureupload.h"
 
-class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+class OpenGLWidget : public QOpenGLWidget, protected GLTraceFunctions
 {
     Q_OBJECT
 
@@ -18,6 +25,37 @@ public:
     explicit OpenGLWidget(QWidget *parent = nullptr);
     ~OpenGLWidget();
 
+    /**
+     * @brief Records every rendered frame through the asynchronous PBO readback path.
+     * @param outputDir Directory receiving the captured frames.
+     * @param format Encoding used by the capture workers.
+     * @param maxFrames Quit the application after this many frames (0 = run until closed).
+     */
+    void enableCapture(const QString& outputDir, FrameCapture::Format format, int maxFrames = 0);
+
+    /**
+     * @brief Records the GL command stream (setup plus @p frames frames) for tools/glreplay.
+     */
+    void enableTrace(const QString& filePath, int frames);
+
+    /**
+     * @brief Streams the face textures mip level by mip level within @p bytes of GPU memory.
+     *
+     * 0 uploads every face at full resolution up front. Must be called before initializeGL().
+     */
+    void setTexturePool(qint64 bytes);
+
+    /**
+     * @brief Adds GPU spans to the perftrace timeline and quits after @p frames frames (0 = run until closed).
+     *
+     * The trace itself is started by the caller; must be called before initializeGL().
+     */
+    void enablePerfTrace(int frames);
+    /**
+     * @brief Waits for the GPU spans still in flight so they reach the trace; call before writing it.
+     */
+    void finishPerfTrace();
+
 protected:
     void initializeGL() override;
     void resizeGL(int w, int h) override;
@@ -33,18 +71,56 @@ private:
      * @brief 尝试从文件路径加载单个纹理，失败时生成带有文本的回退纹理。
      * @param filePath 纹理文件的相对路径。
      * @param fallbackText 加载失败时显示在纹理上的文本。
-     * @return QOpenGLTexture* 指针。
+     * @param size 返回纹理尺寸。
+     * @return 纹理名称 (GLuint)。
      */
-    QOpenGLTexture* loadSingleTextureOrFallback(const QString& filePath, const QString& fallbackText);
-    void loadTextures(); // 加载所有 6 个骰子面的纹理
+    GLuint loadSingleTextureOrFallback(const QString& filePath, const QString& fallbackText, QSize* size);
+    void loadTextures(); // 将 6 个骰子面的纹理加入初始化队列
+    /**
+     * @brief 1x1 gray texture drawn on faces whose texture is not loaded yet.
+     */
+    void setupPlaceholderTexture();
+    /**
+     * @brief (Re)loads face @p face if it is not resident, e.g. after the memory budget evicted it.
+     */
+    void ensureTexture(int face);
+    /**
+     * @brief Larger side, in device pixels, of the screen-space bounding box of face @p face.
+     */
+    float faceScreenSize(int face, const QMatrix4x4& mvp, int viewportWidth, int viewportHeight) const;
+    /**
+     * @brief Closes the frame for the counters and traces, captures it and runs the quit countdowns.
+     */
+    void finishFrame();
 
 private:
+    ShaderVariantCache shaderVariants;
     QOpenGLShaderProgram *program = nullptr;
     QOpenGLBuffer vbo;
     QOpenGLVertexArrayObject vao;
     unsigned int ebo = 0; // 保持 EBO 为原始 OpenGL ID
 
-    QOpenGLTexture *textures[6]; // 6 个纹理指针数组
+    GLuint textures[6]; // 6 个纹理名称数组 (由 TextureUploader 创建)
+    TextureUploader uploader;
+    AssetPack assets; // Mapped for the widget's lifetime: streamed textures decode straight from it
+    QString texturePaths[6];      // Source of each face, used to reload evicted textures
+    QString textureFallbackText[6];
+    GpuMemoryTracker::Handle textureMemory[6] = {};
+    GpuMemoryTracker::Handle vboMemory = 0;
+    GpuMemoryTracker::Handle eboMemory = 0;
+
+    // Mip streaming of the face textures (replaces textures[] when texturePoolBytes > 0)
+    TextureStreamer streamer;
+    int streamedFaces[6] = { -1, -1, -1, -1, -1, -1 };
+    qint64 texturePoolBytes = 0;
+
+    // Startup: only the Critical init tasks run before the first frame, the rest within a per-frame budget
+    static constexpr double InitBudgetMs = 4.0;
+    InitQueue initQueue;
+    bool deferInit = true;        // false when tracing or capturing: everything is loaded before the first frame
+    bool startupReported = false;
+    GLuint placeholderTexture = 0;
+    GpuMemoryTracker::Handle placeholderMemory = 0;
 
     QMatrix4x4 view;
     QMatrix4x4 projection;
@@ -52,6 +128,23 @@ private:
     float rotationAngle;
 
     QTimer *animationTimer;
+
+    // Frame capture (disabled unless enableCapture() was called before initializeGL())
+    FrameCapture capture;
+    QString captureDir;
+    FrameCapture::Format captureFormat = FrameCapture::Format::Png;
+    int captureMaxFrames = 0;
+    quint64 capturedFrames = 0;     // Accepted by captureFrame()
+
+    // GL command trace (disabled unless enableTrace() was called before initializeGL())
+    QString tracePath;
+    int traceFrames = 0;
+
+    // Timeline trace (GPU spans only while perftrace is recording)
+    perftrace::GpuTimeline gpuTimeline;
+    bool perfTrace = false;
+    int perfTraceFrames = 0;
+    int perfTracedFrames = 0;
 };
 
 #endif // OPENGLWIDGET_H
@@ -0,0 +1,65 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QSurfaceFormat>
+#include "countarg.h"
+#include "openglwidget.h"
+
+int main(int argc, char *argv[])
+{
+    // Transform feedback and instancing need a 3.3 core context
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QApplication app(argc, argv);
+
+    ParticleSystem::Params params;
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption countOption("particles", "Number of particle slots, e.g. 1M.", "n", "1M");
+    QCommandLineOption rateOption("emit-rate", "Particles emitted per second (default: particles / mean lifetime).", "n");
+    QCommandLineOption lifetimeOption("lifetime", "Particle lifetime range in seconds.", "min,max",
+                                      QString("%1,%2").arg(params.lifetimeMin).arg(params.lifetimeMax));
+    QCommandLineOption speedOption("speed", "Emission speed range.", "min,max",
+                                   QString("%1,%2").arg(params.speedMin).arg(params.speedMax));
+    QCommandLineOption spreadOption("spread", "Half-angle of the emission cone in degrees.", "deg",
+                                    QString::number(params.spreadDegrees));
+    QCommandLineOption gravityOption("gravity", "Downward acceleration.", "g", QString::number(-params.gravity.y()));
+    QCommandLineOption dragOption("drag", "Velocity fraction lost per second.", "d", QString::number(params.drag));
+    QCommandLineOption sizeOption("particle-size", "Billboard half-size in world units.", "s",
+                                  QString::number(params.particleSize));
+    parser.addOptions({ countOption, rateOption, lifetimeOption, speedOption, spreadOption, gravityOption, dragOption,
+                        sizeOption });
+    parser.process(app);
+
+    params.maxParticles = parseCount(parser.value(countOption));
+    if (params.maxParticles <= 0) {
+        qWarning() << "Invalid particle count:" << parser.value(countOption);
+        return 1;
+    }
+    const QStringList lifetime = parser.value(lifetimeOption).split(',');
+    params.lifetimeMin = lifetime.value(0).toFloat();
+    params.lifetimeMax = lifetime.value(1, lifetime.value(0)).toFloat();
+    const QStringList speed = parser.value(speedOption).split(',');
+    params.speedMin = speed.value(0).toFloat();
+    params.speedMax = speed.value(1, speed.value(0)).toFloat();
+    params.spreadDegrees = parser.value(spreadOption).toFloat();
+    params.gravity = QVector3D(0.0f, -parser.value(gravityOption).toFloat(), 0.0f);
+    params.drag = parser.value(dragOption).toFloat();
+    params.particleSize = parser.value(sizeOption).toFloat();
+    // By default every slot is in use once the fountain reaches steady state
+    params.emitRate = parser.isSet(rateOption)
+                          ? float(parseCount(parser.value(rateOption)))
+                          : params.maxParticles / qMax(0.1f, 0.5f * (params.lifetimeMin + params.lifetimeMax));
+
+    OpenGLWidget widget;
+    widget.setParticleParams(params);
+    widget.resize(1280, 720);
+    widget.setWindowTitle("GPU Particles - Qt OpenGL");
+    widget.show();
+
+    return app.exec();
+}
@@ -0,0 +1,100 @@
+#include "openglwidget.h"
+#include <QDebug>
+#include <QKeyEvent>
+
+// ------------------- Constructor and Destructor -------------------
+
+OpenGLWidget::OpenGLWidget(QWidget *parent)
+    : QOpenGLWidget(parent)
+{
+    animationTimer = new QTimer(this);
+    connect(animationTimer, &QTimer::timeout, this, QOverload<>::of(&OpenGLWidget::update));
+    setFocusPolicy(Qt::StrongFocus); // Space pauses the simulation
+}
+
+OpenGLWidget::~OpenGLWidget()
+{
+    makeCurrent();
+    particles.release();
+    doneCurrent();
+}
+
+void OpenGLWidget::setParticleParams(const ParticleSystem::Params &params)
+{
+    particleParams = params;
+}
+
+// ------------------- GL Core Functions -------------------
+
+void OpenGLWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+    qDebug() << "OpenGL version: " << (char*)glGetString(GL_VERSION);
+
+    glClearColor(0.02f, 0.02f, 0.05f, 1.0f);
+
+    if (!particles.initialize(particleParams)) {
+        qWarning() << "Particle system initialization failed";
+        return;
+    }
+    qDebug() << "Particle system ready:" << particles.capacity() << "particles,"
+             << particleParams.emitRate << "emitted per second";
+
+    frameClock.start();
+    reportClock.start();
+    animationTimer->start(0); // As fast as vsync allows
+}
+
+void OpenGLWidget::resizeGL(int w, int h)
+{
+    projection.setToIdentity();
+    projection.perspective(45.0f, float(w) / float(qMax(1, h)), 0.05f, 100.0f);
+}
+
+void OpenGLWidget::paintGL()
+{
+    // Clamped so a stall (window drag, breakpoint) does not fling every particle at once
+    const float dt = qMin(frameClock.restart() / 1000.0f, 0.05f);
+    if (!paused) {
+        particles.update(dt);
+        cameraAngle += 6.0f * dt;
+    }
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    QMatrix4x4 view;
+    view.lookAt(QVector3D(0.0f, 0.4f, 3.0f), QVector3D(0.0f, 0.2f, 0.0f), QVector3D(0.0f, 1.0f, 0.0f));
+    view.rotate(cameraAngle, 0.0f, 1.0f, 0.0f);
+    particles.render(view, projection);
+
+    ++reportedFrames;
+    reportRate();
+}
+
+void OpenGLWidget::reportRate()
+{
+    const qint64 elapsed = reportClock.elapsed();
+    if (elapsed < 1000) {
+        return;
+    }
+
+    const quint64 simulated = particles.stats().particlesSimulated;
+    const double perSecond = (simulated - reportedSimulated) * 1000.0 / elapsed;
+    setWindowTitle(QString("GPU Particles - %1 particles, %2 fps, %3 M particles/s")
+                       .arg(particles.capacity())
+                       .arg(reportedFrames * 1000.0 / elapsed, 0, 'f', 1)
+                       .arg(perSecond / 1.0e6, 0, 'f', 1));
+
+    reportedSimulated = simulated;
+    reportedFrames = 0;
+    reportClock.restart();
+}
+
+void OpenGLWidget::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() == Qt::Key_Space) {
+        paused = !paused;
+        return;
+    }
+    QOpenGLWidget::keyPressEvent(event);
+}
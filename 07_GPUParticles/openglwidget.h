@@ -0,0 +1,47 @@
+#ifndef OPENGLWIDGET_H
+#define OPENGLWIDGET_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QTimer>
+#include "particlesystem.h"
+
+class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+{
+    Q_OBJECT
+
+public:
+    explicit OpenGLWidget(QWidget *parent = nullptr);
+    ~OpenGLWidget();
+
+    /**
+     * @brief Particle parameters; must be called before initializeGL().
+     */
+    void setParticleParams(const ParticleSystem::Params &params);
+
+protected:
+    void initializeGL() override;
+    void resizeGL(int w, int h) override;
+    void paintGL() override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    void reportRate();
+
+    ParticleSystem particles;
+    ParticleSystem::Params particleParams;
+
+    QMatrix4x4 projection;
+    float cameraAngle = 0.0f;   // Slow orbit around the fountain
+    bool paused = false;        // Toggled with the space bar
+
+    QTimer *animationTimer;
+    QElapsedTimer frameClock;    // dt between frames
+    QElapsedTimer reportClock;   // Window title refresh
+    quint64 reportedSimulated = 0;
+    int reportedFrames = 0;
+};
+
+#endif // OPENGLWIDGET_H
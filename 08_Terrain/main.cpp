@@ -0,0 +1,116 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFileInfo>
+#include <QSurfaceFormat>
+#include "openglwidget.h"
+
+int main(int argc, char *argv[])
+{
+    // glDrawElementsBaseVertex and gl_VertexID need a 3.3 core context
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QApplication app(argc, argv);
+
+    TerrainRenderer::Params params;
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption heightmapOption("heightmap", "Raw 16-bit little-endian heightmap (.r16 / .raw).", "file",
+                                       "terrain_4097.r16");
+    QCommandLineOption mapSizeOption("heightmap-size", "Size of a non-square heightmap.", "WxH");
+    QCommandLineOption generateOption("generate", "Write a <n> x <n> test terrain to the heightmap path first "
+                                      "(done automatically when the default file is missing).", "n");
+    QCommandLineOption spacingOption("spacing", "Meters between samples.", "m", QString::number(params.sampleSpacing));
+    QCommandLineOption heightOption("height-scale", "Meters spanned by the 16-bit range.", "m",
+                                    QString::number(params.heightScale));
+    QCommandLineOption chunkOption("chunk", "Vertices per chunk edge (17, 33, 65 or 129).", "n",
+                                   QString::number(params.chunkSize));
+    QCommandLineOption lodOption("lods", "Number of LODs.", "n", QString::number(params.lodCount));
+    QCommandLineOption errorOption("pixel-error", "Largest screen-space error of a LOD, in pixels.", "px",
+                                   QString::number(params.pixelError));
+    QCommandLineOption stitchOption("stitching", "Crack filling between LODs: skirts or variants.", "mode", "skirts");
+    QCommandLineOption distanceOption("load-distance", "Chunks closer than this are streamed in.", "m",
+                                      QString::number(params.loadDistance));
+    QCommandLineOption poolOption("pool", "Chunk vertex pool in MiB.", "MB",
+                                  QString::number(params.poolBytes / (1024 * 1024)));
+    QCommandLineOption uploadsOption("uploads-per-frame", "Chunks uploaded per frame.", "n",
+                                     QString::number(params.uploadsPerFrame));
+    QCommandLineOption speedOption("speed", "Camera speed in m/s (Up / Down double or halve it).", "m/s", "100");
+    QCommandLineOption flyOption("fly-speeds", "Fly at each of these speeds, print the numbers and quit.", "list");
+    QCommandLineOption flySecondsOption("fly-seconds", "Seconds per --fly-speeds leg.", "s", "10");
+    parser.addOptions({ heightmapOption, mapSizeOption, generateOption, spacingOption, heightOption, chunkOption,
+                        lodOption, errorOption, stitchOption, distanceOption, poolOption, uploadsOption, speedOption,
+                        flyOption, flySecondsOption });
+    parser.process(app);
+
+    const QString mapPath = parser.value(heightmapOption);
+    int generateSize = parser.value(generateOption).toInt();
+    if (!parser.isSet(generateOption) && !parser.isSet(heightmapOption) && !QFileInfo::exists(mapPath)) {
+        generateSize = 4097;
+    }
+    if (generateSize > 0) {
+        qInfo() << "Generating a" << generateSize << "x" << generateSize << "test terrain in" << mapPath;
+        if (!Heightmap::generate(mapPath, generateSize)) {
+            return 1;
+        }
+    }
+
+    int mapWidth = 0;
+    int mapHeight = 0;
+    if (parser.isSet(mapSizeOption)) {
+        const QStringList size = parser.value(mapSizeOption).split('x');
+        mapWidth = size.value(0).toInt();
+        mapHeight = size.value(1).toInt();
+    }
+    Heightmap heightmap;
+    if (!heightmap.open(mapPath, mapWidth, mapHeight)) {
+        return 1;
+    }
+
+    params.sampleSpacing = parser.value(spacingOption).toFloat();
+    params.heightScale = parser.value(heightOption).toFloat();
+    params.chunkSize = parser.value(chunkOption).toInt();
+    params.lodCount = parser.value(lodOption).toInt();
+    params.pixelError = parser.value(errorOption).toFloat();
+    const QString stitching = parser.value(stitchOption);
+    if (stitching == "skirts") {
+        params.stitching = TerrainRenderer::Stitching::Skirts;
+    } else if (stitching == "variants") {
+        params.stitching = TerrainRenderer::Stitching::EdgeVariants;
+    } else {
+        qWarning() << "Invalid stitching (expected skirts or variants):" << stitching;
+        return 1;
+    }
+    params.loadDistance = parser.value(distanceOption).toFloat();
+    params.unloadDistance = params.loadDistance * 1.2f;
+    params.poolBytes = parser.value(poolOption).toLongLong() * 1024 * 1024;
+    params.uploadsPerFrame = qMax(1, parser.value(uploadsOption).toInt());
+
+    QVector<float> flySpeeds;
+    if (parser.isSet(flyOption)) {
+        for (const QString &text : parser.value(flyOption).split(',')) {
+            const float speed = text.toFloat();
+            if (speed <= 0.0f) {
+                qWarning() << "Invalid speed:" << text;
+                return 1;
+            }
+            flySpeeds.append(speed);
+        }
+    }
+
+    OpenGLWidget widget;
+    widget.setTerrain(&heightmap, params);
+    widget.setCameraSpeed(parser.value(speedOption).toFloat());
+    if (!flySpeeds.isEmpty()) {
+        widget.setFlightBenchmark(flySpeeds, qMax(1.0f, parser.value(flySecondsOption).toFloat()));
+    }
+    widget.resize(1280, 720);
+    widget.setWindowTitle("Terrain - Qt OpenGL");
+    widget.show();
+
+    return app.exec();
+}
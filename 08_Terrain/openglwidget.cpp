@@ -0,0 +1,428 @@
+#include "openglwidget.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QKeyEvent>
+#include <QOpenGLShaderProgram>
+#include <QtMath>
+#include <cmath>
+
+// Longest wait for the start area before the first leg runs anyway (pool smaller than the load radius)
+static const float MaxSettleSeconds = 30.0f;
+
+// ------------------- Shader Source Code (Embedded) -------------------
+
+// One triangle covering the viewport; uv is 0..1 over the visible part
+static const char *fullscreenVertexShaderSource = R"glsl(
+#version 330 core
+out vec2 uv;
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)glsl";
+
+// Depth buffer to linear distance over the far plane
+static const char *depthViewFragmentShaderSource = R"glsl(
+#version 330 core
+in vec2 uv;
+out float linearDepth;
+uniform sampler2D depthTexture;
+uniform vec2 uvScale;
+uniform float nearPlane;
+uniform float farPlane;
+void main()
+{
+    float z = texture(depthTexture, uv * uvScale).r * 2.0 - 1.0;
+    float distance = 2.0 * nearPlane * farPlane / (farPlane + nearPlane - z * (farPlane - nearPlane));
+    linearDepth = distance / farPlane;
+}
+)glsl";
+
+static const char *compositeFragmentShaderSource = R"glsl(
+#version 330 core
+in vec2 uv;
+out vec4 fragColor;
+uniform sampler2D sceneColor;
+uniform vec2 sceneScale;
+uniform sampler2D depthView;
+uniform vec2 depthScale;
+uniform bool depthInset;
+void main()
+{
+    vec3 color = texture(sceneColor, uv * sceneScale).rgb;
+    // Slight vignette
+    vec2 centered = uv * 2.0 - 1.0;
+    color *= 1.0 - 0.125 * dot(centered, centered);
+
+    // Lower right quarter: the linear depth of the whole frame
+    const vec2 insetOrigin = vec2(0.7, 0.0);
+    const float insetSize = 0.3;
+    vec2 inset = (uv - insetOrigin) / insetSize;
+    if (depthInset && all(greaterThanEqual(inset, vec2(0.0))) && all(lessThanEqual(inset, vec2(1.0)))) {
+        color = vec3(texture(depthView, inset * depthScale).r);
+    }
+    fragColor = vec4(color, 1.0);
+}
+)glsl";
+
+// ------------------- Constructor and Destructor -------------------
+
+OpenGLWidget::OpenGLWidget(QWidget *parent)
+    : QOpenGLWidget(parent)
+{
+    animationTimer = new QTimer(this);
+    connect(animationTimer, &QTimer::timeout, this, QOverload<>::of(&OpenGLWidget::update));
+    setFocusPolicy(Qt::StrongFocus); // Arrow keys steer the camera
+}
+
+OpenGLWidget::~OpenGLWidget()
+{
+    makeCurrent();
+    if (terrain.isInitialized()) {
+        qInfo().noquote() << terrain.report();
+        qInfo().noquote() << frameGraph.report();
+    }
+    terrain.release();
+    frameGraph.release();
+    delete depthViewProgram;
+    delete compositeProgram;
+    if (fullscreenVao != 0) {
+        glDeleteVertexArrays(1, &fullscreenVao);
+    }
+    doneCurrent();
+}
+
+void OpenGLWidget::setTerrain(const Heightmap *map, const TerrainRenderer::Params &params)
+{
+    heightmap = map;
+    terrainParams = params;
+}
+
+void OpenGLWidget::setFlightBenchmark(const QVector<float> &speeds, float seconds)
+{
+    benchmarkSpeeds = speeds;
+    benchmarkSeconds = seconds;
+}
+
+// ------------------- GL Core Functions -------------------
+
+void OpenGLWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+    qDebug() << "OpenGL version: " << (char*)glGetString(GL_VERSION);
+
+    glClearColor(0.62f, 0.72f, 0.85f, 1.0f);   // Matches the terrain fog
+    glEnable(GL_DEPTH_TEST);
+
+    if (!terrain.initialize(heightmap, terrainParams)) {
+        qWarning() << "Terrain initialization failed";
+        return;
+    }
+    if (!buildPostPrograms() || !frameGraph.initialize()) {
+        qWarning() << "Post-processing initialization failed";
+        terrain.release();
+        return;
+    }
+
+    // Start over the middle of the map
+    const QVector3D extent = terrain.extent();
+    cameraPosition = QVector3D(extent.x() * 0.5f, 0.0f, extent.z() * 0.5f);
+    cameraPosition.setY(terrain.heightAt(cameraPosition.x(), cameraPosition.z()) + cameraClearance);
+
+    if (!benchmarkSpeeds.isEmpty()) {
+        settling = true;
+        qInfo() << "Flight benchmark: waiting for the start area to load";
+    }
+
+    frameClock.start();
+    reportClock.start();
+    animationTimer->start(0); // As fast as vsync allows
+}
+
+void OpenGLWidget::resizeGL(int w, int h)
+{
+    projection.setToIdentity();
+    // The far plane sits just past the streaming radius, where the fog is opaque
+    farPlane = terrainParams.loadDistance * 1.1f;
+    projection.perspective(FovY, float(w) / float(qMax(1, h)), NearPlane, farPlane);
+    // Nothing else to do: the frame graph pool absorbs the new size
+}
+
+void OpenGLWidget::paintGL()
+{
+    // Clamped so a stall (window drag, breakpoint) does not teleport the camera
+    const float dt = qMin(frameClock.restart() / 1000.0f, 0.1f);
+    if (!terrain.isInitialized()) {
+        return;
+    }
+
+    if (!paused && !settling) {
+        moveCamera(dt);
+    }
+    terrain.update(cameraPosition);
+
+    const QVector3D forward(cameraHeading.x(), -0.25f, cameraHeading.y());
+    QMatrix4x4 view;
+    view.lookAt(cameraPosition, cameraPosition + forward, QVector3D(0.0f, 1.0f, 0.0f));
+    terrain.setWireframe(wireframe);
+    terrain.setLodTint(lodTint);
+
+    // terrain -> [depth view] -> composite; the depth view is culled while its inset is hidden
+    const QSize pixels = size() * devicePixelRatio();
+    const FrameGraph::Resource backbuffer = frameGraph.importFramebuffer("widget", defaultFramebufferObject(), pixels);
+    FrameGraph::Resource sceneColor = -1;
+    FrameGraph::Resource sceneDepth = -1;
+    FrameGraph::Resource linearDepth = -1;
+
+    frameGraph.addPass(
+        "terrain",
+        [&](FrameGraph::Builder &builder) {
+            sceneColor = builder.create("scene color", { pixels, GL_RGBA8 });
+            sceneDepth = builder.create("scene depth", { pixels, GL_DEPTH24_STENCIL8 });
+        },
+        [&](const FrameGraph::PassContext &) {
+            glEnable(GL_DEPTH_TEST);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            terrain.render(view, projection, cameraPosition, pixels.height(), FovY);
+        });
+
+    frameGraph.addPass(
+        "depth view",
+        [&](FrameGraph::Builder &builder) {
+            builder.read(sceneDepth);
+            linearDepth = builder.create("linear depth", { pixels / 2, GL_R16F });
+        },
+        [&](const FrameGraph::PassContext &context) {
+            glDisable(GL_DEPTH_TEST);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.texture(sceneDepth));
+            depthViewProgram->bind();
+            depthViewProgram->setUniformValue("depthTexture", 0);
+            depthViewProgram->setUniformValue("uvScale", context.uvScale(sceneDepth));
+            depthViewProgram->setUniformValue("nearPlane", NearPlane);
+            depthViewProgram->setUniformValue("farPlane", farPlane);
+            glBindVertexArray(fullscreenVao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glBindVertexArray(0);
+            depthViewProgram->release();
+        });
+
+    frameGraph.addPass(
+        "composite",
+        [&](FrameGraph::Builder &builder) {
+            builder.read(sceneColor);
+            if (depthInset) {
+                builder.read(linearDepth);
+            }
+            builder.write(backbuffer);
+        },
+        [&](const FrameGraph::PassContext &context) {
+            glDisable(GL_DEPTH_TEST);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.texture(sceneColor));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, depthInset ? context.texture(linearDepth) : 0);
+            compositeProgram->bind();
+            compositeProgram->setUniformValue("sceneColor", 0);
+            compositeProgram->setUniformValue("sceneScale", context.uvScale(sceneColor));
+            compositeProgram->setUniformValue("depthView", 1);
+            compositeProgram->setUniformValue("depthScale", context.uvScale(linearDepth));
+            compositeProgram->setUniformValue("depthInset", GLint(depthInset));
+            glBindVertexArray(fullscreenVao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glBindVertexArray(0);
+            compositeProgram->release();
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glEnable(GL_DEPTH_TEST);
+        });
+
+    frameGraph.execute();
+
+    recordBenchmarkFrame(dt);
+    ++reportedFrames;
+    reportRate();
+}
+
+bool OpenGLWidget::buildPostPrograms()
+{
+    depthViewProgram = new QOpenGLShaderProgram;
+    compositeProgram = new QOpenGLShaderProgram;
+    const bool ok = depthViewProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, fullscreenVertexShaderSource)
+                    && depthViewProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, depthViewFragmentShaderSource)
+                    && depthViewProgram->link()
+                    && compositeProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, fullscreenVertexShaderSource)
+                    && compositeProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, compositeFragmentShaderSource)
+                    && compositeProgram->link();
+    if (!ok) {
+        qWarning() << "Post-processing shaders failed:" << depthViewProgram->log() << compositeProgram->log();
+        return false;
+    }
+    // Core profile draws need a bound VAO even without attributes
+    glGenVertexArrays(1, &fullscreenVao);
+    return true;
+}
+
+// ------------------- Camera -------------------
+
+void OpenGLWidget::moveCamera(float dt)
+{
+    const float speed = benchmarkLeg >= 0 ? benchmarkSpeeds[benchmarkLeg] : cameraSpeed;
+    QVector2D position(cameraPosition.x(), cameraPosition.z());
+    position += cameraHeading * speed * dt;
+
+    // Bounce off the map border
+    const QVector3D extent = terrain.extent();
+    if (position.x() < 0.0f || position.x() > extent.x()) {
+        cameraHeading.setX(-cameraHeading.x());
+        position.setX(qBound(0.0f, position.x(), extent.x()));
+    }
+    if (position.y() < 0.0f || position.y() > extent.z()) {
+        cameraHeading.setY(-cameraHeading.y());
+        position.setY(qBound(0.0f, position.y(), extent.z()));
+    }
+
+    // Follow the terrain, looking two seconds ahead so ridges are climbed before they are reached
+    const QVector2D ahead = position + cameraHeading * speed * 2.0f;
+    const float ground = qMax(terrain.heightAt(position.x(), position.y()), terrain.heightAt(ahead.x(), ahead.y()));
+    const float target = ground + cameraClearance;
+    float y = cameraPosition.y() + (target - cameraPosition.y()) * qMin(1.0f, 2.0f * dt);
+    y = qMax(y, terrain.heightAt(position.x(), position.y()) + 5.0f);
+
+    cameraPosition = QVector3D(position.x(), y, position.y());
+}
+
+void OpenGLWidget::keyPressEvent(QKeyEvent *event)
+{
+    const float turn = qDegreesToRadians(10.0f);
+    switch (event->key()) {
+    case Qt::Key_Space:
+        paused = !paused;
+        return;
+    case Qt::Key_W:
+        wireframe = !wireframe;
+        return;
+    case Qt::Key_L:
+        lodTint = !lodTint;
+        return;
+    case Qt::Key_D:
+        depthInset = !depthInset;
+        return;
+    case Qt::Key_Up:
+        cameraSpeed *= 2.0f;
+        return;
+    case Qt::Key_Down:
+        cameraSpeed = qMax(1.0f, cameraSpeed * 0.5f);
+        return;
+    case Qt::Key_Left:
+    case Qt::Key_Right: {
+        const float angle = event->key() == Qt::Key_Left ? -turn : turn;
+        const float c = std::cos(angle);
+        const float s = std::sin(angle);
+        cameraHeading = QVector2D(c * cameraHeading.x() - s * cameraHeading.y(),
+                                  s * cameraHeading.x() + c * cameraHeading.y());
+        return;
+    }
+    default:
+        break;
+    }
+    QOpenGLWidget::keyPressEvent(event);
+}
+
+// ------------------- Statistics -------------------
+
+void OpenGLWidget::recordBenchmarkFrame(float dt)
+{
+    if (benchmarkSpeeds.isEmpty()) {
+        return;
+    }
+    const TerrainRenderer::Stats stats = terrain.stats();
+
+    if (settling) {
+        leg.seconds += dt;
+        if ((stats.pendingLoads > 0 || terrain.frameStats().chunksMissing > 0) && leg.seconds < MaxSettleSeconds) {
+            return;
+        }
+        settling = false;
+        benchmarkLeg = 0;
+        leg = Leg();
+        leg.speed = benchmarkSpeeds[0];
+        leg.loadedAtStart = stats.chunksLoaded;
+        leg.evictedAtStart = stats.chunksEvicted;
+        qInfo().noquote() << QString("%1 chunks resident at the start (%2 MiB)")
+                                 .arg(stats.chunksResident)
+                                 .arg(stats.residentBytes / (1024.0 * 1024.0), 0, 'f', 1);
+        qInfo().noquote() << "  speed m/s | fps    | triangles/frame avg / max | chunks drawn | missing | "
+                             "resident MiB avg / peak | loads/s | evictions/s";
+        return;
+    }
+    if (benchmarkLeg < 0) {
+        return;
+    }
+
+    const TerrainRenderer::FrameStats frame = terrain.frameStats();
+    ++leg.frames;
+    leg.seconds += dt;
+    leg.triangles += frame.triangles;
+    leg.maxTriangles = qMax(leg.maxTriangles, frame.triangles);
+    leg.chunksDrawn += frame.chunksDrawn;
+    leg.chunksMissing += frame.chunksMissing;
+    leg.residentBytes += stats.residentBytes;
+    leg.peakResidentBytes = qMax(leg.peakResidentBytes, stats.residentBytes);
+
+    if (leg.seconds < benchmarkSeconds) {
+        return;
+    }
+
+    const double mib = 1024.0 * 1024.0;
+    qInfo().noquote() << QString("  %1 | %2 | %3 / %4 | %5 | %6 | %7 / %8 | %9 | %10")
+                             .arg(leg.speed, 9, 'f', 0)
+                             .arg(leg.frames / leg.seconds, 6, 'f', 1)
+                             .arg(leg.triangles / leg.frames, 13, 'f', 0)
+                             .arg(leg.maxTriangles, 11)
+                             .arg(leg.chunksDrawn / leg.frames, 12, 'f', 1)
+                             .arg(leg.chunksMissing / leg.frames, 7, 'f', 2)
+                             .arg(leg.residentBytes / leg.frames / mib, 12, 'f', 1)
+                             .arg(leg.peakResidentBytes / mib, 10, 'f', 1)
+                             .arg((stats.chunksLoaded - leg.loadedAtStart) / leg.seconds, 7, 'f', 1)
+                             .arg((stats.chunksEvicted - leg.evictedAtStart) / leg.seconds, 11, 'f', 1);
+
+    if (++benchmarkLeg >= benchmarkSpeeds.size()) {
+        benchmarkLeg = -1;
+        benchmarkSpeeds.clear();
+        QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+        return;
+    }
+    leg = Leg();
+    leg.speed = benchmarkSpeeds[benchmarkLeg];
+    leg.loadedAtStart = stats.chunksLoaded;
+    leg.evictedAtStart = stats.chunksEvicted;
+}
+
+void OpenGLWidget::reportRate()
+{
+    const qint64 elapsed = reportClock.elapsed();
+    if (elapsed < 1000) {
+        return;
+    }
+
+    const TerrainRenderer::FrameStats frame = terrain.frameStats();
+    const TerrainRenderer::Stats stats = terrain.stats();
+    const FrameGraph::FrameStats targets = frameGraph.frameStats();
+    const float speed = benchmarkLeg >= 0 ? benchmarkSpeeds[benchmarkLeg] : cameraSpeed;
+    setWindowTitle(QString("Terrain - %1 fps, %2 m/s, %3 k triangles, %4 chunks (%5 missing), %6 MiB resident, "
+                           "%7 MiB render targets")
+                       .arg(reportedFrames * 1000.0 / elapsed, 0, 'f', 1)
+                       .arg(paused || settling ? 0.0f : speed, 0, 'f', 0)
+                       .arg(frame.triangles / 1000.0, 0, 'f', 1)
+                       .arg(frame.chunksDrawn)
+                       .arg(frame.chunksMissing)
+                       .arg(stats.residentBytes / (1024.0 * 1024.0), 0, 'f', 1)
+                       .arg(targets.peakBytes / (1024.0 * 1024.0), 0, 'f', 1));
+
+    reportedFrames = 0;
+    reportClock.restart();
+}
@@ -0,0 +1,97 @@
+#ifndef OPENGLWIDGET_H
+#define OPENGLWIDGET_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QTimer>
+#include <QVector>
+#include <QVector2D>
+#include "framegraph.h"
+#include "heightmap.h"
+#include "terrain.h"
+
+class QOpenGLShaderProgram;
+
+class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+{
+    Q_OBJECT
+
+public:
+    explicit OpenGLWidget(QWidget *parent = nullptr);
+    ~OpenGLWidget();
+
+    /**
+     * @brief Terrain to draw; must be called before initializeGL(). @p heightmap must outlive the widget.
+     */
+    void setTerrain(const Heightmap *heightmap, const TerrainRenderer::Params &params);
+    void setCameraSpeed(float metersPerSecond) { cameraSpeed = metersPerSecond; }
+
+    /**
+     * @brief Flies @p seconds at each of @p speeds, prints the streaming and LOD numbers of each, then quits.
+     */
+    void setFlightBenchmark(const QVector<float> &speeds, float seconds);
+
+protected:
+    void initializeGL() override;
+    void resizeGL(int w, int h) override;
+    void paintGL() override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    bool buildPostPrograms();
+    void moveCamera(float dt);
+    void recordBenchmarkFrame(float dt);
+    void reportRate();
+
+    const Heightmap *heightmap = nullptr;
+    TerrainRenderer terrain;
+    TerrainRenderer::Params terrainParams;
+
+    // The terrain is drawn into transient targets and composited into the widget's framebuffer
+    FrameGraph frameGraph;
+    QOpenGLShaderProgram *depthViewProgram = nullptr;
+    QOpenGLShaderProgram *compositeProgram = nullptr;
+    GLuint fullscreenVao = 0;               // Empty: the fullscreen triangle comes from gl_VertexID
+
+    QMatrix4x4 projection;
+    static constexpr float FovY = 60.0f;
+    static constexpr float NearPlane = 1.0f;
+    float farPlane = 1000.0f;
+    QVector3D cameraPosition;
+    QVector2D cameraHeading = QVector2D(1.0f, 0.6f).normalized();
+    float cameraSpeed = 100.0f;             // Meters per second
+    float cameraClearance = 120.0f;         // Height above the terrain ahead
+    bool paused = false;                    // Toggled with the space bar
+    bool wireframe = false;                 // W
+    bool lodTint = false;                   // L
+    bool depthInset = false;                // D: linear depth in the lower right corner
+
+    // Flight benchmark: one leg per speed
+    struct Leg {
+        float speed = 0.0f;
+        int frames = 0;
+        float seconds = 0.0f;
+        double triangles = 0.0;
+        qint64 maxTriangles = 0;
+        double chunksDrawn = 0.0;
+        double chunksMissing = 0.0;
+        double residentBytes = 0.0;
+        qint64 peakResidentBytes = 0;
+        quint64 loadedAtStart = 0;
+        quint64 evictedAtStart = 0;
+    };
+    QVector<float> benchmarkSpeeds;
+    float benchmarkSeconds = 0.0f;
+    int benchmarkLeg = -1;                  // -1: interactive
+    bool settling = false;                  // Waiting for the start area to load before the first leg
+    Leg leg;
+
+    QTimer *animationTimer;
+    QElapsedTimer frameClock;               // dt between frames
+    QElapsedTimer reportClock;              // Window title refresh
+    int reportedFrames = 0;
+};
+
+#endif // OPENGLWIDGET_H
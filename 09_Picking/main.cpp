@@ -0,0 +1,47 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QSurfaceFormat>
+#include "openglwidget.h"
+
+int main(int argc, char *argv[])
+{
+    // Integer render targets, fences and pixel pack buffers need a 3.3 core context
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption instancesOption("instances", "Number of objects.", "n", "100000");
+    QCommandLineOption backendOption("backend", "Picking backend: gpu (id buffer) or cpu (ray BVH); B switches.",
+                                     "name", "gpu");
+    QCommandLineOption benchmarkOption("pick-benchmark", "Measure both backends, print the numbers and quit.");
+    parser.addOptions({ instancesOption, backendOption, benchmarkOption });
+    parser.process(app);
+
+    const int instances = parser.value(instancesOption).toInt();
+    if (instances <= 0) {
+        qWarning() << "Invalid instance count:" << parser.value(instancesOption);
+        return 1;
+    }
+    const QString backend = parser.value(backendOption);
+    if (backend != "gpu" && backend != "cpu") {
+        qWarning() << "Unknown backend:" << backend;
+        return 1;
+    }
+
+    OpenGLWidget widget;
+    widget.setInstanceCount(instances);
+    widget.setBackend(backend == "gpu" ? OpenGLWidget::Backend::Gpu : OpenGLWidget::Backend::Cpu);
+    widget.setPickBenchmark(parser.isSet(benchmarkOption));
+    widget.resize(1280, 720);
+    widget.setWindowTitle("Picking - Qt OpenGL");
+    widget.show();
+
+    return app.exec();
+}
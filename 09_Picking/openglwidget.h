@@ -0,0 +1,161 @@
+#ifndef OPENGLWIDGET_H
+#define OPENGLWIDGET_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMatrix4x4>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QVector>
+#include "picking.h"
+
+class QOpenGLShaderProgram;
+
+class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+{
+    Q_OBJECT
+
+public:
+    enum class Backend {
+        Gpu,                                // Id buffer, read back asynchronously
+        Cpu                                 // Ray cast against the instance and triangle BVHs
+    };
+
+    explicit OpenGLWidget(QWidget *parent = nullptr);
+    ~OpenGLWidget();
+
+    /**
+     * @brief Number of objects; must be called before initializeGL().
+     */
+    void setInstanceCount(int count) { instanceCount = count; }
+    void setBackend(Backend value) { backend = value; }
+    /**
+     * @brief Times pixel and rectangle picks with both backends, prints the numbers, then quits.
+     */
+    void setPickBenchmark(bool enabled) { benchmarkEnabled = enabled; }
+
+protected:
+    void initializeGL() override;
+    void resizeGL(int w, int h) override;
+    void paintGL() override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+
+private:
+    // Objects of one mesh occupy a contiguous range of instances, drawn with one instanced call
+    struct MeshDraw {
+        GLuint vao = 0;
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+        int indexCount = 0;
+        int firstInstance = 0;
+        int instanceCount = 0;
+    };
+
+    // A click or drag waiting for the next frame's matrices
+    struct Selection {
+        QRect rect;                         // Device pixels; 1 x 1 for a click
+        bool add = false;                   // Shift held: add to the selection instead of replacing it
+        bool click = false;
+    };
+
+    bool buildPrograms();
+    void buildScene();
+    void drawObjects(QOpenGLShaderProgram *program, const QMatrix4x4 &viewProjection);
+    void drawRubberBand();
+    void issuePicks();
+    void collectGpuResults();
+    void applySelection(const Selection &selection, quint32 centerId, const QVector<quint32> &ids);
+    void uploadSelection();
+    QPoint devicePixel(const QPointF &position) const;
+    QSize viewportPixels() const { return size() * devicePixelRatio(); }
+
+    void benchmarkFrame();
+    void recordBenchmarkResult(const GpuPicker::Result &result);
+    void printBenchmark();
+    void reportRate();
+
+    int instanceCount = 100000;
+    Backend backend = Backend::Gpu;
+
+    QVector<MeshDraw> meshDraws;
+    GLuint instanceBuffer = 0;              // mat4 model per instance
+    GLuint selectionBuffer = 0;             // One byte per instance, 1 when selected
+    GpuMemoryTracker::Handle meshMemory = 0;
+    GpuMemoryTracker::Handle instanceMemory = 0;
+    QVector<QMatrix4x4> models;
+    QVector<int> instanceMeshes;
+    QVector<quint8> selectedFlags;
+    int selectedCount = 0;
+    bool selectionDirty = false;
+    QOpenGLShaderProgram *colorProgram = nullptr;
+    QOpenGLShaderProgram *idProgram = nullptr;
+
+    CpuPicker cpuPicker;
+    GpuPicker gpuPicker;
+    quint32 hoveredId = 0;
+    double lastPickMilliseconds = 0.0;      // CPU: time of the query; GPU: request to result
+    int lastPickFrames = 0;
+
+    // Mouse state; hover picks are coalesced to one per frame
+    QPoint hoverPixel;
+    bool mouseInside = false;
+    bool hoverDirty = false;
+    bool dragging = false;
+    QPoint dragStart;
+    QPoint dragCurrent;
+    QVector<Selection> pendingSelections;
+    quint64 hoverRequest = 0;               // Newest GPU hover request; older ones are ignored
+    QHash<quint64, Selection> selectionRequests;
+
+    QMatrix4x4 projection;
+    QMatrix4x4 viewProjection;
+    float sceneRadius = 1.0f;
+    float orbitAngle = 0.0f;
+    bool paused = false;                    // Toggled with the space bar
+
+    // Pick benchmark: pixel picks, then rectangle picks with the GPU backend, then the CPU backend
+    struct PickSeries {
+        int issued = 0;
+        int completed = 0;
+        double latencyMilliseconds = 0.0;
+        double maxLatencyMilliseconds = 0.0;
+        double latencyFrames = 0.0;
+        double issueMilliseconds = 0.0;     // CPU time spent in pick()
+        qint64 ids = 0;
+        qint64 cpuIds = 0;                  // CpuPicker::pickRect() over the same rectangles
+        int agreements = 0;                 // Pixel picks where both backends return the same object
+        qint64 firstIssueNs = -1;
+        qint64 lastResultNs = 0;
+    };
+    enum class BenchmarkPhase {
+        Off,
+        PixelPicks,
+        RectanglePicks,
+        Draining
+    };
+    bool benchmarkEnabled = false;
+    BenchmarkPhase benchmarkPhase = BenchmarkPhase::Off;
+    PickSeries pixelSeries;
+    PickSeries rectangleSeries;
+    struct Expected {
+        bool rectangle = false;
+        quint32 id = 0;                     // CPU pick of the same pixel
+        int ids = 0;                        // CPU rectangle pick of the same rectangle
+    };
+    QHash<quint64, Expected> benchmarkRequests;
+    QElapsedTimer benchmarkClock;
+    QRandomGenerator random{ 1 };
+
+    QTimer *animationTimer;
+    QElapsedTimer frameClock;               // dt between frames
+    QElapsedTimer reportClock;              // Window title refresh
+    int reportedFrames = 0;
+};
+
+#endif // OPENGLWIDGET_H
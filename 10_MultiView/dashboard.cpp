@@ -0,0 +1,207 @@
+#include "dashboard.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEvent>
+#include <QFile>
+#include <QGridLayout>
+#include <QMouseEvent>
+#include <QVBoxLayout>
+#include <cmath>
+#include "viewwidget.h"
+
+// VmRSS from /proc/self/status in KiB, -1 where unavailable
+static qint64 residentKiB()
+{
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+    return -1;
+}
+
+// ------------------- Constructor and Destructor -------------------
+
+Dashboard::Dashboard(Mode viewMode, int views, QWidget *parent)
+    : QWidget(parent), mode(viewMode), viewCount(views)
+{
+    frozenAt.fill(-1.0f, views);
+    cameraDelay.fill(0.0f, views);
+
+    const int columns = qMax(1, int(std::ceil(std::sqrt(double(views)))));
+    QGridLayout *grid = new QGridLayout;
+    grid->setContentsMargins(0, 0, 0, 0);
+    grid->setSpacing(2);
+
+    if (mode == Mode::Single) {
+        // One framebuffer, one context, one copy of the scene; the views are placeholders in its layout
+        multiView = new MultiViewWidget(this);
+        MultiViewWidget::Callbacks callbacks;
+        callbacks.initialize = [this] { return sharedScene.initialize("MultiViewWidget"); };
+        callbacks.beginFrame = [this] { sharedScene.beginFrame(sceneTime()); };
+        callbacks.renderView = [this](const MultiViewWidget::ViewContext &view) {
+            sharedScene.renderView(viewProjection(view.index, view.aspect()));
+        };
+        callbacks.endFrame = [this] { sharedScene.endFrame(); };
+        callbacks.release = [this] { sharedScene.release(); };
+        multiView->setCallbacks(callbacks);
+        for (int i = 0; i < views; ++i) {
+            QWidget *slot = multiView->addView();
+            slot->installEventFilter(this);
+            grid->addWidget(slot, i / columns, i % columns);
+        }
+        multiView->setLayout(grid);
+        QVBoxLayout *layout = new QVBoxLayout(this);
+        layout->setContentsMargins(0, 0, 0, 0);
+        layout->addWidget(multiView);
+        connect(multiView, &QOpenGLWidget::frameSwapped, this, &Dashboard::frameSwapped);
+    } else {
+        for (int i = 0; i < views; ++i) {
+            ViewWidget *view = new ViewWidget(i, this, this);
+            viewWidgets.append(view);
+            grid->addWidget(view, i / columns, i % columns);
+        }
+        setLayout(grid);
+        // All widgets of a window are composited together: one signal per frame is enough
+        connect(viewWidgets.first(), &QOpenGLWidget::frameSwapped, this, &Dashboard::frameSwapped);
+    }
+
+    animationTimer = new QTimer(this);
+    connect(animationTimer, &QTimer::timeout, this, [this] {
+        if (multiView) {
+            multiView->update();
+        }
+        for (QOpenGLWidget *view : std::as_const(viewWidgets)) {
+            view->update();
+        }
+    });
+    animationTimer->start(0); // As fast as vsync allows
+
+    clock.start();
+    frameClock.start();
+    reportClock.start();
+}
+
+Dashboard::~Dashboard()
+{
+    // Before sharedScene goes: the widget releases it from its destructor
+    delete multiView;
+    qDeleteAll(viewWidgets);
+}
+
+// ------------------- Views -------------------
+
+QMatrix4x4 Dashboard::viewProjection(int index, float aspect) const
+{
+    const float time = frozenAt[index] >= 0.0f ? frozenAt[index] : sceneTime() - cameraDelay[index];
+    return DemoScene::camera(index, time, aspect);
+}
+
+void Dashboard::toggleFrozen(int index)
+{
+    if (index < 0 || index >= viewCount) {
+        return;
+    }
+    if (frozenAt[index] < 0.0f) {
+        frozenAt[index] = sceneTime() - cameraDelay[index];
+    } else {
+        cameraDelay[index] = sceneTime() - frozenAt[index];
+        frozenAt[index] = -1.0f;
+    }
+}
+
+bool Dashboard::eventFilter(QObject *watched, QEvent *event)
+{
+    // The placeholders are plain widgets: they get the clicks on their view
+    if (multiView && event->type() == QEvent::MouseButtonPress
+        && static_cast<QMouseEvent *>(event)->button() == Qt::LeftButton) {
+        const int index = multiView->indexOf(qobject_cast<QWidget *>(watched));
+        if (index >= 0) {
+            toggleFrozen(index);
+            return true;
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+// ------------------- Statistics -------------------
+
+qint64 Dashboard::framebufferBytes() const
+{
+    // Every QOpenGLWidget renders into its own RGBA8 + depth/stencil framebuffer (plus a resolve target if multisampled)
+    QVector<QOpenGLWidget *> widgets = viewWidgets;
+    if (multiView) {
+        widgets.append(multiView);
+    }
+    qint64 bytes = 0;
+    for (const QOpenGLWidget *widget : std::as_const(widgets)) {
+        const QSize pixels = widget->size() * widget->devicePixelRatioF();
+        const int samples = widget->format().samples();
+        const qint64 perPixel = 8 * qMax(1, samples) + (samples > 1 ? 4 : 0);
+        bytes += qint64(pixels.width()) * pixels.height() * perPixel;
+    }
+    return bytes;
+}
+
+void Dashboard::frameSwapped()
+{
+    const double frameMs = frameClock.nsecsElapsed() / 1.0e6;
+    frameClock.restart();
+    const double paintMs = multiView ? multiView->frameStats().cpuMilliseconds : paintMilliseconds;
+    paintMilliseconds = 0.0;
+    ++reportedFrames;
+    reportedPaintMilliseconds += paintMs;
+
+    if (measureSeconds > 0.0f) {
+        if (warmupFrames > 0) {
+            --warmupFrames;
+        } else {
+            ++frames;
+            frameMilliseconds += frameMs;
+            maxFrameMilliseconds = qMax(maxFrameMilliseconds, frameMs);
+            totalPaintMilliseconds += paintMs;
+            if (frameMilliseconds >= measureSeconds * 1000.0) {
+                measureSeconds = 0.0f;
+                printResult();
+                QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+            }
+        }
+    }
+
+    const qint64 elapsed = reportClock.elapsed();
+    if (elapsed < 1000) {
+        return;
+    }
+    setWindowTitle(QString("MultiView - %1 views (%2), %3 fps, %4 ms in paintGL per frame, %5 MiB widget framebuffers")
+                       .arg(viewCount)
+                       .arg(QLatin1String(mode == Mode::Single ? "one widget" : "one widget each"))
+                       .arg(reportedFrames * 1000.0 / elapsed, 0, 'f', 1)
+                       .arg(reportedPaintMilliseconds / reportedFrames, 0, 'f', 2)
+                       .arg(framebufferBytes() / (1024.0 * 1024.0), 0, 'f', 1));
+    reportedFrames = 0;
+    reportedPaintMilliseconds = 0.0;
+    reportClock.restart();
+}
+
+void Dashboard::printResult()
+{
+    // One machine-readable line; main.cpp --compare collects them from child processes
+    const int n = qMax(1, frames);
+    const qint64 rss = residentKiB();
+    qInfo().noquote() << QString("result mode=%1 views=%2 frames=%3 frameMs=%4 maxFrameMs=%5 paintMs=%6 "
+                                 "contexts=%7 framebufferMiB=%8 sceneKiB=%9 rssMiB=%10")
+                             .arg(QLatin1String(mode == Mode::Single ? "single" : "widgets"))
+                             .arg(viewCount)
+                             .arg(frames)
+                             .arg(frameMilliseconds / n, 0, 'f', 3)
+                             .arg(maxFrameMilliseconds, 0, 'f', 3)
+                             .arg(totalPaintMilliseconds / n, 0, 'f', 3)
+                             .arg(mode == Mode::Single ? 1 : viewCount)
+                             .arg(framebufferBytes() / (1024.0 * 1024.0), 0, 'f', 1)
+                             .arg(GpuMemoryTracker::instance().residentBytes() / 1024.0, 0, 'f', 1)
+                             .arg(rss >= 0 ? QString::number(rss / 1024.0, 'f', 1) : QString("n/a"));
+}
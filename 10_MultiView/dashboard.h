@@ -0,0 +1,79 @@
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include <QWidget>
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QTimer>
+#include <QVector>
+#include "multiview.h"
+#include "scene.h"
+
+class QOpenGLWidget;
+
+/**
+ * @brief A grid of views, drawn by one MultiViewWidget or by one QOpenGLWidget per view.
+ *
+ * Clicking a view freezes or resumes its camera. In measurement mode the
+ * dashboard renders as fast as it can for a while, prints one "result" line
+ * with frame time, paint time and memory, and quits.
+ */
+class Dashboard : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum class Mode {
+        Single,                             // One MultiViewWidget, views are placeholders in its layout
+        Widgets                             // One QOpenGLWidget per view
+    };
+
+    Dashboard(Mode mode, int views, QWidget *parent = nullptr);
+    ~Dashboard();
+
+    /**
+     * @brief Measures for @p seconds after a warm-up, prints the result line, then quits.
+     */
+    void setMeasurement(float seconds) { measureSeconds = seconds; }
+
+    // For the views
+    float sceneTime() const { return clock.elapsed() / 1000.0f; }
+    QMatrix4x4 viewProjection(int index, float aspect) const;
+    void addPaintTime(double milliseconds) { paintMilliseconds += milliseconds; }
+    void toggleFrozen(int index);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void frameSwapped();
+    void printResult();
+    qint64 framebufferBytes() const;
+
+    Mode mode;
+    int viewCount;
+    MultiViewWidget *multiView = nullptr;
+    QVector<QOpenGLWidget *> viewWidgets;   // Widgets mode
+    DemoScene sharedScene;                  // Single mode
+    QVector<float> frozenAt;                // Camera time a view stopped at, negative while it moves
+    QVector<float> cameraDelay;             // Time spent frozen, so a resumed camera continues where it stopped
+
+    QTimer *animationTimer;
+    QElapsedTimer clock;
+
+    // Per frame, between frameSwapped() signals
+    double paintMilliseconds = 0.0;
+    QElapsedTimer frameClock;
+
+    float measureSeconds = 0.0f;
+    int warmupFrames = 60;
+    int frames = 0;
+    double frameMilliseconds = 0.0;         // Sum over the measured frames
+    double maxFrameMilliseconds = 0.0;
+    double totalPaintMilliseconds = 0.0;
+    QElapsedTimer reportClock;              // Window title refresh
+    int reportedFrames = 0;
+    double reportedPaintMilliseconds = 0.0;
+};
+
+#endif // DASHBOARD_H
@@ -0,0 +1,110 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QHash>
+#include <QProcess>
+#include <QSurfaceFormat>
+#include "dashboard.h"
+
+// Runs every view count and mode in its own process (so the RSS of one does not
+// leak into the next) and prints their result lines as a table
+static int compare(const QStringList &counts, const QString &seconds, const QString &size)
+{
+    qInfo().noquote() << "  views | mode    | frame ms avg / max | paintGL ms | contexts | widget FBOs MiB | "
+                         "scene KiB | RSS MiB";
+    for (const QString &count : counts) {
+        for (const QString &mode : { QString("single"), QString("widgets") }) {
+            QProcess child;
+            child.start(QCoreApplication::applicationFilePath(),
+                        { "--views", count, "--mode", mode, "--measure", seconds, "--size", size });
+            if (!child.waitForFinished(-1) || child.exitCode() != 0) {
+                qWarning().noquote() << QString("  %1 | %2 | failed").arg(count, 5).arg(mode, -7);
+                continue;
+            }
+            QHash<QString, QString> result;
+            for (const QString &line : QString::fromLocal8Bit(child.readAllStandardError()).split('\n')) {
+                if (!line.startsWith("result ")) {
+                    continue;
+                }
+                for (const QString &field : line.mid(7).split(' ', Qt::SkipEmptyParts)) {
+                    result.insert(field.section('=', 0, 0), field.section('=', 1));
+                }
+            }
+            if (result.isEmpty()) {
+                qWarning().noquote() << QString("  %1 | %2 | no result").arg(count, 5).arg(mode, -7);
+                continue;
+            }
+            qInfo().noquote() << QString("  %1 | %2 | %3 / %4 | %5 | %6 | %7 | %8 | %9")
+                                     .arg(count, 5)
+                                     .arg(mode, -7)
+                                     .arg(result.value("frameMs"), 10)
+                                     .arg(result.value("maxFrameMs"), 7)
+                                     .arg(result.value("paintMs"), 10)
+                                     .arg(result.value("contexts"), 8)
+                                     .arg(result.value("framebufferMiB"), 15)
+                                     .arg(result.value("sceneKiB"), 9)
+                                     .arg(result.value("rssMiB"), 7);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    // The format must be set before QApplication; measurements run without vsync so the frame time is the real cost
+    bool measuring = false;
+    for (int i = 1; i < argc; ++i) {
+        measuring = measuring || qstrcmp(argv[i], "--measure") == 0;
+    }
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    if (measuring) {
+        format.setSwapInterval(0);
+    }
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption viewsOption("views", "Number of views.", "n", "16");
+    QCommandLineOption modeOption("mode", "single: one MultiViewWidget; widgets: one QOpenGLWidget per view.", "mode",
+                                  "single");
+    QCommandLineOption sizeOption("size", "Window size.", "WxH", "1600x900");
+    QCommandLineOption measureOption("measure", "Render unthrottled for this long, print a result line and quit.",
+                                     "s");
+    QCommandLineOption compareOption("compare", "Measure both modes at each view count, e.g. 4,16,64.", "list");
+    parser.addOptions({ viewsOption, modeOption, sizeOption, measureOption, compareOption });
+    parser.process(app);
+
+    const QStringList size = parser.value(sizeOption).split('x');
+    const int width = size.value(0).toInt();
+    const int height = size.value(1).toInt();
+    if (width <= 0 || height <= 0) {
+        qWarning() << "Invalid size:" << parser.value(sizeOption);
+        return 1;
+    }
+    if (parser.isSet(compareOption)) {
+        const QString seconds = parser.isSet(measureOption) ? parser.value(measureOption) : QString("5");
+        return compare(parser.value(compareOption).split(','), seconds, parser.value(sizeOption));
+    }
+
+    const int views = parser.value(viewsOption).toInt();
+    const QString mode = parser.value(modeOption);
+    if (views <= 0 || (mode != "single" && mode != "widgets")) {
+        qWarning() << "Invalid --views or --mode";
+        return 1;
+    }
+
+    Dashboard dashboard(mode == "single" ? Dashboard::Mode::Single : Dashboard::Mode::Widgets, views);
+    if (parser.isSet(measureOption)) {
+        dashboard.setMeasurement(qMax(0.5f, parser.value(measureOption).toFloat()));
+    }
+    dashboard.resize(width, height);
+    dashboard.setWindowTitle("MultiView - Qt OpenGL");
+    dashboard.show();
+
+    return app.exec();
+}
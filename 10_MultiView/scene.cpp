@@ -0,0 +1,141 @@
+#include "scene.h"
+#include <QDebug>
+#include <QOpenGLShaderProgram>
+#include <cmath>
+#include "meshgen.h"
+
+static constexpr auto sphereMesh = meshgen::icoSphere<meshgen::Pos, 2>();
+
+// ------------------- Shader Source Code (Embedded) -------------------
+
+// Instances sit on a Fibonacci sphere and bob along their direction
+static const char *vertexShaderSource = R"glsl(
+#version 330 core
+layout(location = 0) in vec3 position;
+uniform mat4 viewProjection;
+uniform float time;
+uniform int instanceCount;
+out vec3 worldPosition;
+flat out vec3 color;
+void main()
+{
+    float i = float(gl_InstanceID);
+    float z = 1.0 - 2.0 * (i + 0.5) / float(instanceCount);
+    float r = sqrt(max(0.0, 1.0 - z * z));
+    float phi = i * 2.39996323;
+    vec3 direction = vec3(r * cos(phi), z, r * sin(phi));
+    vec3 center = direction * (10.0 + 1.5 * sin(time * 1.3 + i * 0.37));
+    worldPosition = center + position * 0.7;
+    color = 0.5 + 0.5 * direction;
+    gl_Position = viewProjection * vec4(worldPosition, 1.0);
+}
+)glsl";
+
+// Flat shading from screen-space derivatives: the mesh carries positions only
+static const char *fragmentShaderSource = R"glsl(
+#version 330 core
+in vec3 worldPosition;
+flat in vec3 color;
+out vec4 fragColor;
+void main()
+{
+    vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+    float light = 0.3 + 0.7 * abs(dot(normal, normalize(vec3(0.4, 0.8, 0.45))));
+    fragColor = vec4(color * light, 1.0);
+}
+)glsl";
+
+// ------------------- Setup -------------------
+
+bool DemoScene::initialize(const QString &owner)
+{
+    initializeOpenGLFunctions();
+
+    program = new QOpenGLShaderProgram;
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource)
+        || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource)
+        || !program->link()) {
+        qWarning() << "Scene shaders failed:" << program->log();
+        delete program;
+        program = nullptr;
+        return false;
+    }
+    viewProjectionLocation = program->uniformLocation("viewProjection");
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sphereMesh.vertexBytes(), sphereMesh.vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sphereMesh.stride(), (void*)0);
+    glEnableVertexAttribArray(0);
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereMesh.indexBytes(), sphereMesh.indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    vboMemory = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, qint64(sphereMesh.vertexBytes()),
+                                          owner, "sphere VBO");
+    eboMemory = memory.registerAllocation(GpuMemoryTracker::Category::IndexBuffer, qint64(sphereMesh.indexBytes()),
+                                          owner, "sphere EBO");
+    return true;
+}
+
+void DemoScene::release()
+{
+    if (!program) {
+        return;
+    }
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    vao = vbo = ebo = 0;
+    delete program;
+    program = nullptr;
+    GpuMemoryTracker::instance().release(vboMemory);
+    GpuMemoryTracker::instance().release(eboMemory);
+    vboMemory = eboMemory = 0;
+}
+
+// ------------------- Drawing -------------------
+
+void DemoScene::beginFrame(float seconds)
+{
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    program->bind();
+    program->setUniformValue("time", seconds);
+    program->setUniformValue("instanceCount", Instances);
+    glBindVertexArray(vao);
+}
+
+void DemoScene::renderView(const QMatrix4x4 &viewProjection)
+{
+    program->setUniformValue(viewProjectionLocation, viewProjection);
+    glDrawElementsInstanced(GL_TRIANGLES, GLsizei(sphereMesh.indexCount()), GL_UNSIGNED_INT, nullptr, Instances);
+}
+
+void DemoScene::endFrame()
+{
+    glBindVertexArray(0);
+    program->release();
+    glDisable(GL_CULL_FACE);
+}
+
+QMatrix4x4 DemoScene::camera(int index, float seconds, float aspect)
+{
+    // Golden-ratio offsets spread the views' angles, speeds and heights without repeating
+    const float offset = std::fmod(index * 0.618034f, 1.0f);
+    const float angle = offset * 6.2831853f + seconds * (0.15f + 0.35f * offset);
+    const float height = (offset - 0.5f) * 30.0f;
+    const float distance = 32.0f + 10.0f * offset;
+
+    QMatrix4x4 projection;
+    projection.perspective(45.0f, aspect, 0.5f, 100.0f);
+    QMatrix4x4 view;
+    view.lookAt(QVector3D(distance * std::sin(angle), height, distance * std::cos(angle)), QVector3D(0.0f, 0.0f, 0.0f),
+                QVector3D(0.0f, 1.0f, 0.0f));
+    return projection * view;
+}
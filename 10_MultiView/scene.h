@@ -0,0 +1,52 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QMatrix4x4>
+#include <QString>
+#include "gpumemory.h"
+
+class QOpenGLShaderProgram;
+
+/**
+ * @brief The dashboard's test scene: a pulsing shell of instanced spheres.
+ *
+ * Instance positions come from gl_InstanceID, so the only buffers are one
+ * sphere mesh. beginFrame() binds the program and VAO and sets the time, and
+ * renderView() only sets the camera and draws, so views rendered between one
+ * beginFrame() / endFrame() pair share all of that state.
+ */
+class DemoScene : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    static constexpr int Instances = 1024;
+
+    DemoScene() = default;
+
+    /**
+     * @brief Builds the program and buffers in the current context; @p owner names them in GpuMemoryTracker.
+     */
+    bool initialize(const QString &owner);
+    void release();
+    bool isInitialized() const { return program != nullptr; }
+
+    void beginFrame(float seconds);
+    void renderView(const QMatrix4x4 &viewProjection);
+    void endFrame();
+
+    /**
+     * @brief Camera of view @p index at @p seconds: each view orbits at its own speed and height.
+     */
+    static QMatrix4x4 camera(int index, float seconds, float aspect);
+
+private:
+    QOpenGLShaderProgram *program = nullptr;
+    int viewProjectionLocation = -1;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    GpuMemoryTracker::Handle vboMemory = 0;
+    GpuMemoryTracker::Handle eboMemory = 0;
+};
+
+#endif // SCENE_H
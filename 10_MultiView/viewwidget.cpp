@@ -0,0 +1,47 @@
+#include "viewwidget.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMouseEvent>
+#include <QOpenGLFunctions>
+#include "dashboard.h"
+
+ViewWidget::ViewWidget(int viewIndex, Dashboard *owner, QWidget *parent)
+    : QOpenGLWidget(parent), index(viewIndex), dashboard(owner)
+{
+}
+
+ViewWidget::~ViewWidget()
+{
+    makeCurrent();
+    scene.release();
+    doneCurrent();
+}
+
+void ViewWidget::initializeGL()
+{
+    if (!scene.initialize(QString("view %1").arg(index))) {
+        qWarning() << "View" << index << "failed to initialize";
+    }
+}
+
+void ViewWidget::paintGL()
+{
+    QElapsedTimer timer;
+    timer.start();
+    QOpenGLFunctions *gl = context()->functions();
+    gl->glClearColor(20 / 255.0f, 24 / 255.0f, 30 / 255.0f, 1.0f);
+    gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (scene.isInitialized()) {
+        scene.beginFrame(dashboard->sceneTime());
+        scene.renderView(dashboard->viewProjection(index, float(width()) / float(qMax(1, height()))));
+        scene.endFrame();
+    }
+    dashboard->addPaintTime(timer.nsecsElapsed() / 1.0e6);
+}
+
+void ViewWidget::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        dashboard->toggleFrozen(index);
+    }
+}
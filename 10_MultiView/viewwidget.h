@@ -0,0 +1,33 @@
+#ifndef VIEWWIDGET_H
+#define VIEWWIDGET_H
+
+#include <QOpenGLWidget>
+#include "scene.h"
+
+class Dashboard;
+
+/**
+ * @brief One view as its own QOpenGLWidget, with its own framebuffer and copy of the scene.
+ *
+ * This is how the earlier stages draw; the dashboard uses it for comparison with MultiViewWidget.
+ */
+class ViewWidget : public QOpenGLWidget
+{
+    Q_OBJECT
+
+public:
+    ViewWidget(int index, Dashboard *dashboard, QWidget *parent = nullptr);
+    ~ViewWidget();
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private:
+    int index;
+    Dashboard *dashboard;
+    DemoScene scene;
+};
+
+#endif // VIEWWIDGET_H
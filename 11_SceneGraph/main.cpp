@@ -0,0 +1,44 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QSurfaceFormat>
+#include "openglwidget.h"
+
+int main(int argc, char *argv[])
+{
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption entitiesOption("entities", "Number of entities.", "n", "250000");
+    QCommandLineOption branchingOption("branching", "Children per entity.", "n", "8");
+    QCommandLineOption changingOption("changing", "Fraction of the entities re-oriented every frame.", "fraction",
+                                      "0.1");
+    QCommandLineOption threadsOption("threads", "Update threads, including the GUI thread; 0 uses all cores.", "n",
+                                     "0");
+    parser.addOptions({ entitiesOption, branchingOption, changingOption, threadsOption });
+    parser.process(app);
+
+    const int entities = parser.value(entitiesOption).toInt();
+    const int branching = parser.value(branchingOption).toInt();
+    const float changing = parser.value(changingOption).toFloat();
+    if (entities <= 0 || branching <= 0 || changing < 0.0f || changing > 1.0f) {
+        qWarning() << "Invalid --entities, --branching or --changing";
+        return 1;
+    }
+
+    OpenGLWidget widget(qMax(0, parser.value(threadsOption).toInt()));
+    widget.setEntityCount(entities, branching);
+    widget.setChangingFraction(changing);
+    widget.resize(1280, 720);
+    widget.setWindowTitle("SceneGraph - Qt OpenGL");
+    widget.show();
+
+    return app.exec();
+}
@@ -0,0 +1,385 @@
+#include "openglwidget.h"
+#include <QDebug>
+#include <QKeyEvent>
+#include <QOpenGLShaderProgram>
+#include <QtMath>
+#include <cmath>
+#include "meshgen.h"
+
+// Moved slots closer than this are uploaded as one range: fewer glBufferSubData calls for a few unchanged bytes
+static const int UploadGapSlots = 256;
+
+// ------------------- Meshes -------------------
+
+static constexpr auto cubeMesh = meshgen::cubeCorners<meshgen::Pos>();
+static constexpr auto sphereMesh = meshgen::icoSphere<meshgen::Pos, 2>();
+
+struct MeshSource {
+    const float *vertices;
+    int vertexCount;
+    const unsigned int *indices;
+    int indexCount;
+};
+
+static const MeshSource meshSources[] = {
+    { cubeMesh.vertices.data(), int(cubeMesh.vertexCount()), cubeMesh.indices.data(), int(cubeMesh.indexCount()) },
+    { sphereMesh.vertices.data(), int(sphereMesh.vertexCount()), sphereMesh.indices.data(),
+      int(sphereMesh.indexCount()) },
+};
+static const int MeshCount = int(sizeof(meshSources) / sizeof(meshSources[0]));
+
+// Material id -> color
+static const QVector3D materialColors[] = {
+    QVector3D(0.95f, 0.65f, 0.25f),
+    QVector3D(0.35f, 0.65f, 0.95f),
+    QVector3D(0.55f, 0.85f, 0.45f),
+    QVector3D(0.85f, 0.45f, 0.75f),
+};
+static const int MaterialCount = int(sizeof(materialColors) / sizeof(materialColors[0]));
+
+// ------------------- Shader Source Code (Embedded) -------------------
+
+// The world transform arrives as the three affine rows SceneGraph stores, one vec4 attribute each
+static const char *vertexShaderSource = R"glsl(
+#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 row0;
+layout(location = 2) in vec4 row1;
+layout(location = 3) in vec4 row2;
+uniform mat4 viewProjection;
+out vec3 worldPosition;
+void main()
+{
+    vec4 local = vec4(position, 1.0);
+    worldPosition = vec3(dot(row0, local), dot(row1, local), dot(row2, local));
+    gl_Position = viewProjection * vec4(worldPosition, 1.0);
+}
+)glsl";
+
+// Flat shading from screen-space derivatives: the meshes carry positions only
+static const char *fragmentShaderSource = R"glsl(
+#version 330 core
+in vec3 worldPosition;
+uniform vec3 color;
+out vec4 fragColor;
+void main()
+{
+    vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+    float light = 0.3 + 0.7 * abs(dot(normal, normalize(vec3(0.4, 0.8, 0.45))));
+    fragColor = vec4(color * light, 1.0);
+}
+)glsl";
+
+// ------------------- Constructor and Destructor -------------------
+
+static SceneGraph::Params sceneParams(int threads)
+{
+    SceneGraph::Params params;
+    params.workerThreads = threads;
+    return params;
+}
+
+OpenGLWidget::OpenGLWidget(int updateThreads, QWidget *parent)
+    : QOpenGLWidget(parent), scene(sceneParams(updateThreads))
+{
+    animationTimer = new QTimer(this);
+    connect(animationTimer, &QTimer::timeout, this, QOverload<>::of(&OpenGLWidget::update));
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+OpenGLWidget::~OpenGLWidget()
+{
+    makeCurrent();
+    for (MeshDraw &mesh : meshDraws) {
+        glDeleteVertexArrays(1, &mesh.vao);
+        glDeleteBuffers(1, &mesh.vertexBuffer);
+        glDeleteBuffers(1, &mesh.indexBuffer);
+    }
+    if (transformBuffer != 0) {
+        glDeleteBuffers(1, &transformBuffer);
+    }
+    GpuMemoryTracker::instance().release(meshMemory);
+    GpuMemoryTracker::instance().release(transformMemory);
+    delete program;
+    doneCurrent();
+}
+
+// ------------------- GL Core Functions -------------------
+
+void OpenGLWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+    qDebug() << "OpenGL version: " << (char*)glGetString(GL_VERSION);
+
+    glClearColor(0.08f, 0.09f, 0.12f, 1.0f);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    if (!buildProgram()) {
+        return;
+    }
+    glGenBuffers(1, &transformBuffer);
+    buildMeshes();
+    buildScene();
+
+    frameClock.start();
+    reportClock.start();
+    animationTimer->start(0); // As fast as vsync allows
+}
+
+void OpenGLWidget::resizeGL(int w, int h)
+{
+    projection.setToIdentity();
+    projection.perspective(45.0f, float(w) / float(qMax(1, h)), 0.5f, sceneRadius * 6.0f);
+}
+
+void OpenGLWidget::paintGL()
+{
+    const float dt = qMin(frameClock.restart() / 1000.0f, 0.1f);
+    if (!program) {
+        return;
+    }
+
+    if (!paused) {
+        sceneTime += dt;
+        orbitAngle += dt * 0.05f;
+        animate(sceneTime);
+    }
+    const SceneGraph::UpdateStats stats = scene.update();
+    if (stats.rebuilt) {
+        qDebug() << "Scene sorted in" << stats.rebuildMilliseconds << "ms:" << scene.slotCount() << "slots,"
+                 << stats.levels << "levels," << scene.batches().size() << "batches";
+    }
+
+    QElapsedTimer uploadTimer;
+    uploadTimer.start();
+    uploadTransforms(stats.rebuilt || stats.entitiesChanged > scene.slotCount() / 4);
+    reportedUploadMilliseconds += uploadTimer.nsecsElapsed() / 1.0e6;
+    reportedUpdateMilliseconds += stats.updateMilliseconds;
+    reportedMoved += stats.entitiesChanged;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    drawBatches();
+
+    ++frame;
+    ++reportedFrames;
+    reportRate();
+}
+
+void OpenGLWidget::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() == Qt::Key_Space) {
+        paused = !paused;
+        return;
+    }
+    QOpenGLWidget::keyPressEvent(event);
+}
+
+bool OpenGLWidget::buildProgram()
+{
+    program = new QOpenGLShaderProgram;
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource)
+        || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource) || !program->link()) {
+        qWarning() << "SceneGraph shaders failed:" << program->log();
+        delete program;
+        program = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// ------------------- Scene -------------------
+
+void OpenGLWidget::buildMeshes()
+{
+    qint64 meshBytes = 0;
+    meshDraws.resize(MeshCount);
+    for (int m = 0; m < MeshCount; ++m) {
+        const MeshSource &source = meshSources[m];
+        MeshDraw &mesh = meshDraws[m];
+        mesh.indexCount = source.indexCount;
+
+        glGenVertexArrays(1, &mesh.vao);
+        glBindVertexArray(mesh.vao);
+        glGenBuffers(1, &mesh.vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, source.vertexCount * meshgen::Pos::Floats * qint64(sizeof(float)),
+                     source.vertices, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, meshgen::Pos::Floats * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glGenBuffers(1, &mesh.indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, source.indexCount * qint64(sizeof(unsigned int)), source.indices,
+                     GL_STATIC_DRAW);
+        meshBytes += source.vertexCount * meshgen::Pos::Floats * qint64(sizeof(float))
+                     + source.indexCount * qint64(sizeof(unsigned int));
+
+        // The rows are re-pointed at each batch's first slot in drawBatches()
+        for (int row = 0; row < 3; ++row) {
+            glVertexAttribDivisor(1 + row, 1);
+            glEnableVertexAttribArray(1 + row);
+        }
+        glBindVertexArray(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    meshMemory = GpuMemoryTracker::instance().registerAllocation(GpuMemoryTracker::Category::VertexBuffer, meshBytes,
+                                                                 "SceneGraph", "mesh vertices and indices");
+}
+
+void OpenGLWidget::buildScene()
+{
+    // Trees four levels deep: entity i past the roots hangs under entity (i - roots) / branching
+    const double treeSize = 1.0 + branching + double(branching) * branching + std::pow(double(branching), 3.0);
+    rootCount = qMax(1, int(entityCount / treeSize));
+    const int side = qMax(1, int(std::ceil(std::sqrt(double(rootCount)))));
+    const float spacing = 8.0f;
+    sceneRadius = side * spacing * 0.5f * std::sqrt(2.0f) + spacing;
+
+    scene.reserve(entityCount);
+    entities.resize(entityCount);
+    spinSpeeds.resize(entityCount);
+    const float center = (side - 1) * 0.5f;
+    for (int i = 0; i < entityCount; ++i) {
+        SceneGraph::Transform transform;
+        SceneGraph::Entity parent = SceneGraph::NoEntity;
+        int depth = 0;
+        if (i < rootCount) {
+            transform.translation = QVector3D((i % side - center) * spacing, 0.0f, (i / side - center) * spacing);
+            transform.scale = QVector3D(2.0f, 2.0f, 2.0f);
+        } else {
+            // Children on a ring around their parent, in the parent's space
+            const int parentIndex = (i - rootCount) / branching;
+            const int sibling = (i - rootCount) % branching;
+            const float angle = 2.0f * float(M_PI) * sibling / branching;
+            parent = entities[parentIndex];
+            for (int p = parentIndex; p >= rootCount; p = (p - rootCount) / branching) {
+                ++depth;
+            }
+            ++depth;
+            transform.translation = QVector3D(1.6f * std::cos(angle), 0.3f * ((sibling & 1) ? 1.0f : -1.0f),
+                                              1.6f * std::sin(angle));
+            transform.scale = QVector3D(0.32f, 0.32f, 0.32f);
+        }
+        entities[i] = scene.create(parent, i % MeshCount, depth % MaterialCount);
+        scene.setTransform(entities[i], transform);
+        scene.setLocalBounds(entities[i], { QVector3D(), QVector3D(0.5f, 0.5f, 0.5f) });
+        spinSpeeds[i] = (20.0f + float((i * 2654435761u) % 60)) * ((i & 1) ? 1.0f : -1.0f);
+    }
+    qDebug() << entityCount << "entities in" << rootCount << "trees," << scene.memoryBytes() / (1024 * 1024)
+             << "MiB of components";
+}
+
+void OpenGLWidget::animate(float time)
+{
+    // Every step-th entity gets a new orientation, shifted each frame so all of them turn in turn
+    if (changingFraction <= 0.0f) {
+        return;
+    }
+    const int step = qMax(1, int(std::lround(1.0 / changingFraction)));
+    for (int i = frame % step; i < entityCount; i += step) {
+        scene.setRotation(entities[i], QQuaternion::fromAxisAndAngle(0.0f, 1.0f, 0.0f, time * spinSpeeds[i]));
+    }
+}
+
+// ------------------- Rendering -------------------
+
+void OpenGLWidget::uploadTransforms(bool everything)
+{
+    const int slots = scene.slotCount();
+    const qint64 stride = sizeof(SceneGraph::WorldTransform);
+    const char *data = reinterpret_cast<const char *>(scene.worldTransforms());
+    glBindBuffer(GL_ARRAY_BUFFER, transformBuffer);
+    if (slots > transformCapacity) {
+        transformCapacity = slots;
+        glBufferData(GL_ARRAY_BUFFER, slots * stride, data, GL_DYNAMIC_DRAW);
+        GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+        if (transformMemory == 0) {
+            transformMemory = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, slots * stride,
+                                                        "SceneGraph", "world transforms");
+        } else {
+            memory.resize(transformMemory, slots * stride);
+        }
+        reportedUploadBytes += slots * stride;
+    } else if (everything) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, slots * stride, data);
+        reportedUploadBytes += slots * stride;
+    } else {
+        // Runs of moved slots, merged across short gaps
+        const quint8 *changed = scene.changedFlags();
+        int s = 0;
+        while (s < slots) {
+            if (!changed[s]) {
+                ++s;
+                continue;
+            }
+            const int first = s;
+            int last = s;
+            for (++s; s < slots && s - last <= UploadGapSlots; ++s) {
+                if (changed[s]) {
+                    last = s;
+                }
+            }
+            const qint64 bytes = (last - first + 1) * stride;
+            glBufferSubData(GL_ARRAY_BUFFER, first * stride, bytes, data + first * stride);
+            reportedUploadBytes += bytes;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OpenGLWidget::drawBatches()
+{
+    const float distance = sceneRadius * 1.6f;
+    QMatrix4x4 view;
+    view.lookAt(QVector3D(distance * std::sin(orbitAngle), distance * 0.45f, distance * std::cos(orbitAngle)),
+                QVector3D(0.0f, 0.0f, 0.0f), QVector3D(0.0f, 1.0f, 0.0f));
+
+    program->bind();
+    program->setUniformValue("viewProjection", projection * view);
+    glBindBuffer(GL_ARRAY_BUFFER, transformBuffer);
+    const qint64 stride = sizeof(SceneGraph::WorldTransform);
+    for (const SceneGraph::Batch &batch : scene.batches()) {
+        if (batch.mesh < 0 || batch.mesh >= MeshCount) {
+            continue;
+        }
+        const MeshDraw &mesh = meshDraws[batch.mesh];
+        glBindVertexArray(mesh.vao);
+        // GL 3.3 has no base instance: the rows start at the batch's first slot instead
+        for (int row = 0; row < 3; ++row) {
+            glVertexAttribPointer(1 + row, 4, GL_FLOAT, GL_FALSE, stride,
+                                  (void*)(batch.first * stride + row * 4 * qint64(sizeof(float))));
+        }
+        program->setUniformValue("color", materialColors[qBound(0, batch.material, MaterialCount - 1)]);
+        glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, nullptr, batch.count);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    program->release();
+}
+
+void OpenGLWidget::reportRate()
+{
+    const qint64 elapsed = reportClock.elapsed();
+    if (elapsed < 1000) {
+        return;
+    }
+
+    const double frames = qMax(1, reportedFrames);
+    setWindowTitle(QString("SceneGraph - %1 fps, %2 entities, %3 moved/frame, update %4 ms, upload %5 ms "
+                           "(%6 KiB), %7 levels, %8 batches")
+                       .arg(reportedFrames * 1000.0 / elapsed, 0, 'f', 1)
+                       .arg(entityCount)
+                       .arg(qint64(reportedMoved / frames))
+                       .arg(reportedUpdateMilliseconds / frames, 0, 'f', 2)
+                       .arg(reportedUploadMilliseconds / frames, 0, 'f', 2)
+                       .arg(reportedUploadBytes / frames / 1024.0, 0, 'f', 0)
+                       .arg(scene.depthCount())
+                       .arg(scene.batches().size()));
+
+    reportedFrames = 0;
+    reportedUpdateMilliseconds = 0.0;
+    reportedUploadMilliseconds = 0.0;
+    reportedMoved = 0;
+    reportedUploadBytes = 0;
+    reportClock.restart();
+}
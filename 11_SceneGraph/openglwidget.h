@@ -0,0 +1,91 @@
+#ifndef OPENGLWIDGET_H
+#define OPENGLWIDGET_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QTimer>
+#include <QVector>
+#include "gpumemory.h"
+#include "scenegraph.h"
+
+class QOpenGLShaderProgram;
+
+/**
+ * @brief Draws a SceneGraph forest straight from its arrays, one instanced draw per batch.
+ *
+ * Every frame a fraction of the entities turns; SceneGraph::update()
+ * propagates the change down their subtrees and only the moved slots of the
+ * world transform array are uploaded.
+ */
+class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+{
+    Q_OBJECT
+
+public:
+    explicit OpenGLWidget(int updateThreads = 0, QWidget *parent = nullptr);
+    ~OpenGLWidget();
+
+    /**
+     * @brief Size of the forest; must be called before initializeGL().
+     */
+    void setEntityCount(int count, int children) { entityCount = count; branching = children; }
+    void setChangingFraction(float fraction) { changingFraction = fraction; }
+
+protected:
+    void initializeGL() override;
+    void resizeGL(int w, int h) override;
+    void paintGL() override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    struct MeshDraw {
+        GLuint vao = 0;
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+        int indexCount = 0;
+    };
+
+    bool buildProgram();
+    void buildMeshes();
+    void buildScene();
+    void animate(float time);
+    void uploadTransforms(bool everything);
+    void drawBatches();
+    void reportRate();
+
+    int entityCount = 250000;
+    int branching = 8;
+    float changingFraction = 0.1f;
+
+    SceneGraph scene;
+    QVector<SceneGraph::Entity> entities;   // Creation order: entity i's parent is (i - roots) / branching
+    QVector<float> spinSpeeds;              // Degrees per second around the local y axis
+    int rootCount = 0;
+    int frame = 0;
+
+    QVector<MeshDraw> meshDraws;
+    GLuint transformBuffer = 0;             // SceneGraph::worldTransforms(), three vec4 rows per slot
+    int transformCapacity = 0;              // Slots
+    GpuMemoryTracker::Handle meshMemory = 0;
+    GpuMemoryTracker::Handle transformMemory = 0;
+    QOpenGLShaderProgram *program = nullptr;
+
+    QMatrix4x4 projection;
+    float sceneRadius = 1.0f;
+    float orbitAngle = 0.0f;
+    float sceneTime = 0.0f;
+    bool paused = false;                    // Toggled with the space bar
+
+    QTimer *animationTimer;
+    QElapsedTimer frameClock;               // dt between frames
+    QElapsedTimer reportClock;              // Window title refresh
+    int reportedFrames = 0;
+    double reportedUpdateMilliseconds = 0.0;
+    double reportedUploadMilliseconds = 0.0;
+    qint64 reportedMoved = 0;
+    qint64 reportedUploadBytes = 0;
+};
+
+#endif // OPENGLWIDGET_H
@@ -0,0 +1,38 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include "dicefaces.h"
+#include "rhiwidget.h"
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption apiOption("api", "QRhi backend: opengl, or null to record without executing anything.",
+                                 "name", "opengl");
+    QCommandLineOption cubesOption("cubes", "Number of cubes, alternately colored (05) and textured (06).", "n",
+                                   "100");
+    QCommandLineOption texturesOption("textures", "Directory with the dice_face_N.png files of 06.", "dir",
+                                      "../06_3D_TexturedCube/textures");
+    parser.addOptions({ apiOption, cubesOption, texturesOption });
+    parser.process(app);
+
+    const QString api = parser.value(apiOption).toLower();
+    const int cubes = parser.value(cubesOption).toInt();
+    if ((api != "opengl" && api != "null") || cubes <= 0) {
+        qWarning() << "Invalid --api or --cubes";
+        return 1;
+    }
+
+    RhiWidget widget;
+    widget.setApi(api == "null" ? QRhiWidget::Api::Null : QRhiWidget::Api::OpenGL);
+    widget.setCubeCount(cubes);
+    widget.setFaceImages(loadDiceFaces(parser.value(texturesOption)));
+    widget.resize(1280, 720);
+    widget.setWindowTitle("RhiCubes - Qt RHI");
+    widget.show();
+
+    return app.exec();
+}
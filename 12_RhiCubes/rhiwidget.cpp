@@ -0,0 +1,122 @@
+#include "rhiwidget.h"
+#include <QDebug>
+#include <QtMath>
+#include <cmath>
+
+static const float CubeSpacing = 2.0f;
+
+RhiWidget::RhiWidget(QWidget *parent) : QRhiWidget(parent)
+{
+    setCubeCount(1);
+}
+
+void RhiWidget::setCubeCount(int count)
+{
+    count = qMax(1, count);
+    gridSize = int(std::ceil(std::sqrt(double(count))));
+    cubeList.resize(count);
+    for (int i = 0; i < count; ++i) {
+        // Checkerboard of the two pipelines, so both draw every frame
+        const int row = i / gridSize;
+        const int column = i % gridSize;
+        cubeList[i].pipeline = (row + column) % 2 == 0 ? RhiCubeRenderer::Pipeline::Colored
+                                                       : RhiCubeRenderer::Pipeline::Textured;
+    }
+}
+
+void RhiWidget::setFaceImages(const QVector<QImage> &faces)
+{
+    cubes.setFaceImages(faces);
+}
+
+// ------------------- QRhiWidget -------------------
+
+void RhiWidget::initialize(QRhiCommandBuffer *commandBuffer)
+{
+    Q_UNUSED(commandBuffer);
+    // Called again on every resize; the pipelines stay compatible with the new render target
+    if (initializedRhi == rhi()) {
+        return;
+    }
+    initializedRhi = nullptr;
+    if (!cubes.initialize(rhi(), renderTarget()->renderPassDescriptor(), sampleCount())) {
+        qWarning() << "RhiCubes: cannot create the cube pipelines";
+        return;
+    }
+    initializedRhi = rhi();
+    clock.start();
+    reportClock.start();
+}
+
+void RhiWidget::render(QRhiCommandBuffer *commandBuffer)
+{
+    if (!initializedRhi) {
+        return;
+    }
+    const QSize outputSize = renderTarget()->pixelSize();
+    const float time = clock.elapsed() / 1000.0f;
+
+    // Same framing as 06, pulled back until the whole grid fits
+    const float extent = gridSize * CubeSpacing;
+    QMatrix4x4 viewProjection;
+    viewProjection.perspective(45.0f, float(outputSize.width()) / float(qMax(1, outputSize.height())), 0.1f,
+                               extent * 4.0f);
+    viewProjection.lookAt(QVector3D(0.0f, 0.0f, qMax(3.0f, extent * 1.3f)), QVector3D(0.0f, 0.0f, 0.0f),
+                          QVector3D(0.0f, 1.0f, 0.0f));
+
+    const float origin = -(gridSize - 1) * CubeSpacing * 0.5f;
+    for (int i = 0; i < cubeList.size(); ++i) {
+        const float angle = time * 50.0f + i * 7.0f;
+        QMatrix4x4 &model = cubeList[i].model;
+        model.setToIdentity();
+        model.translate(origin + (i % gridSize) * CubeSpacing, origin + (i / gridSize) * CubeSpacing, 0.0f);
+        model.rotate(angle, 0.0f, 1.0f, 0.0f);
+        model.rotate(angle / 2.0f, 1.0f, 0.0f, 0.0f);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QRhiResourceUpdateBatch *batch = rhi()->nextResourceUpdateBatch();
+    cubes.prepare(batch, viewProjection, cubeList);
+    reportedPrepareMilliseconds += timer.nsecsElapsed() / 1.0e6;
+
+    timer.restart();
+    commandBuffer->beginPass(renderTarget(), QColor::fromRgbF(0.2f, 0.3f, 0.3f, 1.0f), { 1.0f, 0 }, batch);
+    cubes.record(commandBuffer, outputSize);
+    commandBuffer->endPass();
+    reportedRecordMilliseconds += timer.nsecsElapsed() / 1.0e6;
+
+    reportRate(cubes.stats());
+    update(); // Continuous animation
+}
+
+void RhiWidget::releaseResources()
+{
+    cubes.release();
+    initializedRhi = nullptr;
+}
+
+void RhiWidget::reportRate(const RhiCubeRenderer::FrameStats &stats)
+{
+    ++reportedFrames;
+    const qint64 elapsed = reportClock.elapsed();
+    if (elapsed < 1000) {
+        return;
+    }
+
+    const double frames = qMax(1, reportedFrames);
+    setWindowTitle(QString("RhiCubes (%1) - %2 fps, %3 cubes, %4 draws, %5 pipeline binds, prepare %6 ms, "
+                           "record %7 ms")
+                       .arg(QString::fromLatin1(rhi()->backendName()))
+                       .arg(reportedFrames * 1000.0 / elapsed, 0, 'f', 1)
+                       .arg(cubeList.size())
+                       .arg(stats.draws)
+                       .arg(stats.pipelineBinds)
+                       .arg(reportedPrepareMilliseconds / frames, 0, 'f', 2)
+                       .arg(reportedRecordMilliseconds / frames, 0, 'f', 2));
+
+    reportedFrames = 0;
+    reportedPrepareMilliseconds = 0.0;
+    reportedRecordMilliseconds = 0.0;
+    reportClock.restart();
+}
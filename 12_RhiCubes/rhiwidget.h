@@ -0,0 +1,52 @@
+#ifndef RHIWIDGET_H
+#define RHIWIDGET_H
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMatrix4x4>
+#include <QRhiWidget>
+#include <QVector>
+#include "rhicube.h"
+
+/**
+ * @brief A grid of the cubes of 05 and 06, drawn through QRhi instead of direct GL calls.
+ *
+ * Alternating cubes use the colored and the textured pipeline. Each frame is
+ * one resource update batch (all matrices) handed to beginPass(), then the
+ * state-sorted draws of RhiCubeRenderer. The backend is chosen with setApi()
+ * before the widget is shown.
+ */
+class RhiWidget : public QRhiWidget
+{
+    Q_OBJECT
+
+public:
+    explicit RhiWidget(QWidget *parent = nullptr);
+
+    /**
+     * @brief Number of cubes; may be changed at any time.
+     */
+    void setCubeCount(int count);
+    void setFaceImages(const QVector<QImage> &faces);
+
+protected:
+    void initialize(QRhiCommandBuffer *commandBuffer) override;
+    void render(QRhiCommandBuffer *commandBuffer) override;
+    void releaseResources() override;
+
+private:
+    void reportRate(const RhiCubeRenderer::FrameStats &stats);
+
+    RhiCubeRenderer cubes;
+    QRhi *initializedRhi = nullptr;         // Pipelines are rebuilt when the widget gets another QRhi
+    QVector<RhiCubeRenderer::Cube> cubeList;
+    int gridSize = 1;                       // Cubes per row
+
+    QElapsedTimer clock;                    // Animation time
+    QElapsedTimer reportClock;              // Window title refresh
+    int reportedFrames = 0;
+    double reportedPrepareMilliseconds = 0.0;
+    double reportedRecordMilliseconds = 0.0;
+};
+
+#endif // RHIWIDGET_H
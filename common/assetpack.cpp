@@ -0,0 +1,153 @@
+#include "assetpack.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <cstring>
+
+AssetPack::~AssetPack()
+{
+    close();
+}
+
+QString AssetPack::defaultPath()
+{
+    const QString fromEnvironment = qEnvironmentVariable("ASSET_PACK");
+    if (!fromEnvironment.isEmpty()) {
+        return fromEnvironment;
+    }
+    return QDir(QCoreApplication::applicationDirPath()).filePath("assets.pak");
+}
+
+// ------------------- Opening -------------------
+
+bool AssetPack::open(const QString &filePath)
+{
+    using namespace assetpack;
+    close();
+
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    mappedSize = file.size();
+    if (mappedSize < qint64(sizeof(PackHeader))) {
+        qWarning() << "AssetPack:" << filePath << "is too small";
+        close();
+        return false;
+    }
+    begin = file.map(0, mappedSize);
+    if (!begin) {
+        qWarning() << "AssetPack: cannot map" << filePath;
+        close();
+        return false;
+    }
+
+    std::memcpy(&header, begin, sizeof(header));
+    if (header.magic != Magic || header.version != Version || header.fileSize != quint64(mappedSize)) {
+        qWarning() << "AssetPack:" << filePath << "is not a version" << Version << "asset pack";
+        close();
+        return false;
+    }
+
+    // Validate the index once so lookups can trust it; this touches the index pages only
+    const quint64 entriesEnd = sizeof(PackHeader) + quint64(header.entryCount) * sizeof(PackEntry);
+    const quint64 bucketsEnd = entriesEnd + quint64(header.bucketCount) * sizeof(quint32);
+    const bool bucketsOk = header.bucketCount != 0 && (header.bucketCount & (header.bucketCount - 1)) == 0
+                           && header.bucketCount > header.entryCount;
+    if (!bucketsOk || bucketsEnd > header.namesOffset || header.namesOffset + header.namesSize > header.fileSize) {
+        qWarning() << "AssetPack: corrupt index in" << filePath;
+        close();
+        return false;
+    }
+
+    entries = reinterpret_cast<const PackEntry *>(begin + sizeof(PackHeader));
+    buckets = reinterpret_cast<const quint32 *>(begin + entriesEnd);
+    names = reinterpret_cast<const char *>(begin + header.namesOffset);
+
+    for (quint32 i = 0; i < header.entryCount; ++i) {
+        const PackEntry &entry = entries[i];
+        if (quint64(entry.nameOffset) + entry.nameSize > header.namesSize
+            || entry.offset + entry.size > header.fileSize || entry.offset % BlobAlignment != 0) {
+            qWarning() << "AssetPack: corrupt entry" << i << "in" << filePath;
+            close();
+            return false;
+        }
+    }
+    quint32 emptyBuckets = 0;
+    for (quint32 b = 0; b < header.bucketCount; ++b) {
+        if (buckets[b] == EmptyBucket) {
+            ++emptyBuckets;
+        } else if (buckets[b] >= header.entryCount) {
+            qWarning() << "AssetPack: corrupt bucket" << b << "in" << filePath;
+            close();
+            return false;
+        }
+    }
+    if (emptyBuckets == 0) {
+        qWarning() << "AssetPack: hash index without an empty bucket in" << filePath;
+        close();
+        return false;
+    }
+
+    qDebug() << "AssetPack: mapped" << filePath << "with" << header.entryCount << "assets";
+    return true;
+}
+
+void AssetPack::close()
+{
+    if (begin) {
+        file.unmap(const_cast<uchar *>(begin));
+    }
+    file.close();
+    begin = nullptr;
+    mappedSize = 0;
+    header = assetpack::PackHeader();
+    entries = nullptr;
+    buckets = nullptr;
+    names = nullptr;
+}
+
+// ------------------- Lookup -------------------
+
+const assetpack::PackEntry *AssetPack::find(const QString &name) const
+{
+    using namespace assetpack;
+    if (!begin) {
+        return nullptr;
+    }
+
+    const QByteArray key = name.toUtf8();
+    const quint64 hash = hashName(key.constData(), key.size());
+    const quint32 mask = header.bucketCount - 1;
+
+    // open() made sure the table has an empty bucket; the step limit is a second guard
+    quint32 b = quint32(hash) & mask;
+    for (quint32 step = 0; step < header.bucketCount; ++step, b = (b + 1) & mask) {
+        const quint32 index = buckets[b];
+        if (index == EmptyBucket) {
+            return nullptr;
+        }
+        const PackEntry &entry = entries[index];
+        if (entry.nameHash == hash && entry.nameSize == quint32(key.size())
+            && std::memcmp(names + entry.nameOffset, key.constData(), size_t(key.size())) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+QByteArray AssetPack::data(const QString &name) const
+{
+    const assetpack::PackEntry *entry = find(name);
+    if (!entry) {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(begin + entry->offset), qsizetype(entry->size));
+}
+
+assetpack::Type AssetPack::type(const QString &name) const
+{
+    const assetpack::PackEntry *entry = find(name);
+    return entry ? entry->type : assetpack::Type::Other;
+}
@@ -0,0 +1,57 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include "assetpackformat.h"
+
+/**
+ * @brief Read-only view of an asset pack written by tools/assetpacker.
+ *
+ * open() maps the whole file once and validates the index; no blob is read.
+ * data() hashes the name, probes the index and returns a QByteArray that
+ * points straight into the mapping (QByteArray::fromRawData), so an asset is
+ * paged in by the OS the first time its bytes are actually touched. Views
+ * stay valid until close(); they must not outlive the pack.
+ *
+ * Lookups are const and lock-free, so decoder threads may read concurrently.
+ */
+class AssetPack
+{
+public:
+    AssetPack() = default;
+    ~AssetPack();
+
+    bool open(const QString &filePath);
+    void close();
+    bool isOpen() const { return begin != nullptr; }
+
+    /**
+     * @brief Zero-copy view of asset @p name (e.g. "textures/dice_face_1.png"), empty if missing.
+     */
+    QByteArray data(const QString &name) const;
+    bool contains(const QString &name) const { return find(name) != nullptr; }
+    assetpack::Type type(const QString &name) const;
+
+    int size() const { return int(header.entryCount); }
+    QString filePath() const { return file.fileName(); }
+
+    /**
+     * @brief "assets.pak" next to the executable, or $ASSET_PACK if set.
+     */
+    static QString defaultPath();
+
+private:
+    const assetpack::PackEntry *find(const QString &name) const;
+
+    QFile file;
+    const uchar *begin = nullptr;
+    qint64 mappedSize = 0;
+    assetpack::PackHeader header;
+    const assetpack::PackEntry *entries = nullptr;
+    const quint32 *buckets = nullptr;
+    const char *names = nullptr;
+};
+
+#endif // ASSETPACK_H
@@ -0,0 +1,70 @@
+#ifndef ASSETPACKFORMAT_H
+#define ASSETPACKFORMAT_H
+
+#include <QtGlobal>
+
+// ------------------- Asset Pack Format -------------------
+//
+// File layout (little endian):
+//   PackHeader
+//   PackEntry[entryCount]              (sorted by name)
+//   u32 buckets[bucketCount]           (open-addressing hash index -> entry number)
+//   names                              (UTF-8, not terminated)
+//   blobs                              (each starts on a BlobAlignment boundary)
+//
+// bucketCount is a power of two, at least twice entryCount; an entry lives in the
+// first free bucket at or after (nameHash & (bucketCount - 1)), EmptyBucket marks
+// free ones. Everything up to the blobs is a few KiB even for thousands of assets,
+// so opening a pack only pages in the index; blob pages are touched on first use.
+
+namespace assetpack {
+
+constexpr quint32 Magic = 0x4b415041;   // "APAK"
+constexpr quint32 Version = 1;
+constexpr quint32 BlobAlignment = 64;
+constexpr quint32 EmptyBucket = 0xffffffffu;
+
+enum class Type : quint32 {
+    Other = 0,
+    Texture,
+    Shader,
+    Mesh
+};
+
+struct PackHeader {
+    quint32 magic = Magic;
+    quint32 version = Version;
+    quint32 entryCount = 0;
+    quint32 bucketCount = 0;
+    quint64 namesOffset = 0;
+    quint64 namesSize = 0;
+    quint64 fileSize = 0;
+};
+
+struct PackEntry {
+    quint64 nameHash = 0;
+    quint64 offset = 0;      // From the start of the file
+    quint64 size = 0;
+    quint32 nameOffset = 0;  // Into the names block
+    quint32 nameSize = 0;
+    Type type = Type::Other;
+    quint32 reserved = 0;
+};
+
+static_assert(sizeof(PackHeader) == 40, "PackHeader layout changed");
+static_assert(sizeof(PackEntry) == 40, "PackEntry layout changed");
+
+// 64-bit FNV-1a over the UTF-8 name
+inline quint64 hashName(const char *data, qsizetype size)
+{
+    quint64 hash = 14695981039346656037ull;
+    for (qsizetype i = 0; i < size; ++i) {
+        hash ^= quint8(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace assetpack
+
+#endif // ASSETPACKFORMAT_H
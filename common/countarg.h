@@ -0,0 +1,26 @@
+#ifndef COUNTARG_H
+#define COUNTARG_H
+
+#include <QString>
+
+/**
+ * @brief Parses a count from the command line: plain numbers and k / M suffixes, e.g. 500k or 2M.
+ * @return The count, or 0 if @p text is not a positive count below 2e9.
+ */
+inline int parseCount(const QString &text)
+{
+    double scale = 1.0;
+    QString digits = text.trimmed();
+    if (digits.endsWith('k', Qt::CaseInsensitive)) {
+        scale = 1.0e3;
+        digits.chop(1);
+    } else if (digits.endsWith('M')) {
+        scale = 1.0e6;
+        digits.chop(1);
+    }
+    bool ok = false;
+    const double value = digits.toDouble(&ok) * scale;
+    return ok && value > 0.0 && value < 2.0e9 ? int(value) : 0;
+}
+
+#endif // COUNTARG_H
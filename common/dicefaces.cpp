@@ -0,0 +1,26 @@
+#include "dicefaces.h"
+#include <QColor>
+#include <QDir>
+#include <QFont>
+#include <QPainter>
+
+QVector<QImage> loadDiceFaces(const QString &directory)
+{
+    static const int numbers[6] = { 1, 6, 5, 2, 3, 4 };
+    QVector<QImage> faces;
+    for (int number : numbers) {
+        QImage image(QDir(directory).filePath(QString("dice_face_%1.png").arg(number)));
+        if (image.isNull()) {
+            image = QImage(256, 256, QImage::Format_RGBA8888);
+            image.fill(QColor::fromHsv(number * 60, 160, 230));
+            QPainter painter(&image);
+            QFont font = painter.font();
+            font.setPixelSize(160);
+            painter.setFont(font);
+            painter.setPen(Qt::black);
+            painter.drawText(image.rect(), Qt::AlignCenter, QString::number(number));
+        }
+        faces.append(image);
+    }
+    return faces;
+}
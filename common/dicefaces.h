@@ -0,0 +1,17 @@
+#ifndef DICEFACES_H
+#define DICEFACES_H
+
+#include <QImage>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The six dice face images of 06_3D_TexturedCube, in its face order (+Z, -Z, +Y, -Y, +X, -X).
+ *
+ * Faces are read from dice_face_<n>.png in @p directory; a face whose file
+ * is missing or unreadable is painted instead as its number on a colored
+ * background, so callers always get six images.
+ */
+QVector<QImage> loadDiceFaces(const QString &directory);
+
+#endif // DICEFACES_H
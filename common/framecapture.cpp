@@ -0,0 +1,414 @@
+#include "framecapture.h"
+#include <QDebug>
+#include <QDir>
+#include <QImage>
+#include <QMutexLocker>
+#include <QThread>
+#include <cstring>
+
+// ------------------- Construction -------------------
+
+FrameCapture::FrameCapture() = default;
+
+FrameCapture::~FrameCapture()
+{
+    // GL objects must have been released through finish() while the context was current.
+    // Here we only make sure no encoder is still touching our buffers.
+    encoders.waitForDone();
+    qDeleteAll(freeBuffers);
+}
+
+bool FrameCapture::parseFormat(const QString &name, Format *format)
+{
+    const QString key = name.toLower();
+    if (key == "png") {
+        *format = Format::Png;
+    } else if (key == "rgb") {
+        *format = Format::RawRgb;
+    } else if (key == "yuv" || key == "i420") {
+        *format = Format::RawYuv420;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool FrameCapture::initialize(const QString &dir, Format fmt, int ringSize, int encoderThreads)
+{
+    initializeOpenGLFunctions();
+
+    if (!QDir().mkpath(dir)) {
+        qWarning() << "FrameCapture: cannot create output directory" << dir;
+        return false;
+    }
+    outputDir = dir;
+    format = fmt;
+
+    if (format != Format::Png) {
+        stream.setFileName(QDir(dir).filePath(format == Format::RawRgb ? "capture.rgb" : "capture.yuv"));
+        if (!stream.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning() << "FrameCapture: cannot open" << stream.fileName();
+            return false;
+        }
+    }
+
+    // At least two slots, otherwise every read would be mapped in the same frame it was issued
+    ring.resize(qMax(2, ringSize));
+    for (Slot &slot : ring) {
+        glGenBuffers(1, &slot.pbo);
+    }
+
+    if (encoderThreads <= 0) {
+        encoderThreads = qMax(1, QThread::idealThreadCount() - 1);
+    }
+    encoders.setMaxThreadCount(encoderThreads);
+
+    // One buffer per encoder plus headroom for frames waiting in the queue
+    maxBuffers = encoderThreads * 2 + ring.size();
+
+    clock.start();
+    active = true;
+    qDebug() << "FrameCapture: writing to" << dir << "with" << ring.size() << "PBOs and"
+             << encoderThreads << "encoder threads";
+    return true;
+}
+
+// ------------------- GL Side (render thread) -------------------
+
+bool FrameCapture::captureFrame(GLuint fbo, int width, int height)
+{
+    if (!active || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    ++paintCount;
+    {
+        QMutexLocker locker(&statsMutex);
+        ++counters.framesRequested;
+    }
+
+    // Map whatever the GPU has already finished before claiming a new slot
+    retireReadySlots(false);
+
+    if (inFlight == ring.size()) {
+        // The oldest read is still pending on the GPU; waiting here would stall paintGL()
+        QMutexLocker locker(&statsMutex);
+        ++counters.droppedRingFull;
+        return false;
+    }
+
+    Slot &slot = ring[writeSlot];
+    const qsizetype bytes = qsizetype(width) * height * 4;
+
+    GLint previousReadFbo = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFbo);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.capacity != bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        slot.capacity = bytes;
+
+        GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+        if (slot.memory == 0) {
+            slot.memory = memory.registerAllocation(GpuMemoryTracker::Category::PixelBuffer, bytes,
+                                                    "FrameCapture", "readback PBO");
+        } else {
+            memory.resize(slot.memory, bytes);
+        }
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // With a PBO bound the last argument is an offset, so this returns without waiting
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(previousReadFbo));
+
+    slot.width = width;
+    slot.height = height;
+    slot.issuedFrame = paintCount;
+    slot.issuedNs = clock.nsecsElapsed();
+
+    writeSlot = (writeSlot + 1) % ring.size();
+    ++inFlight;
+    return true;
+}
+
+void FrameCapture::retireReadySlots(bool wait)
+{
+    while (inFlight > 0) {
+        Slot &slot = ring[readSlot];
+
+        // Frames must leave the ring in order, so stop at the first one that is not ready
+        const GLuint64 timeout = wait ? GLuint64(1000000000) : 0;
+        const GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            if (wait) {
+                continue;
+            }
+            break;
+        }
+        if (status == GL_WAIT_FAILED) {
+            qWarning() << "FrameCapture: glClientWaitSync failed, discarding frame";
+        } else {
+            retireSlot(slot, wait);
+        }
+
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        readSlot = (readSlot + 1) % ring.size();
+        --inFlight;
+    }
+}
+
+void FrameCapture::retireSlot(Slot &slot, bool wait)
+{
+    const qint64 mappedNs = clock.nsecsElapsed();
+    const double readbackMs = (mappedNs - slot.issuedNs) / 1.0e6;
+    {
+        QMutexLocker locker(&statsMutex);
+        ++counters.framesRead;
+        readbackMsTotal += readbackMs;
+        readbackFramesTotal += double(paintCount - slot.issuedFrame);
+        counters.maxReadbackMs = qMax(counters.maxReadbackMs, readbackMs);
+    }
+
+    const qsizetype rowBytes = qsizetype(slot.width) * 4;
+    QByteArray *buffer = acquireBuffer(rowBytes * slot.height);
+    if (!buffer && wait) {
+        // finish() may block: let the encoders hand their buffers back instead of dropping the frame
+        encoders.waitForDone();
+        buffer = acquireBuffer(rowBytes * slot.height);
+    }
+    if (!buffer) {
+        QMutexLocker locker(&statsMutex);
+        ++counters.droppedNoBuffer;
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const auto *src = static_cast<const uchar *>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.capacity, GL_MAP_READ_BIT));
+    if (!src) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        releaseBuffer(buffer);
+        qWarning() << "FrameCapture: glMapBufferRange failed";
+        return;
+    }
+
+    // GL rows are bottom-up; reversing them during the one unavoidable copy
+    // spares the encoders a separate mirrored() pass.
+    uchar *dst = reinterpret_cast<uchar *>(buffer->data());
+    for (int y = 0; y < slot.height; ++y) {
+        std::memcpy(dst + rowBytes * y, src + rowBytes * (slot.height - 1 - y), size_t(rowBytes));
+    }
+
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    const int width = slot.width;
+    const int height = slot.height;
+    const qint64 issuedNs = slot.issuedNs;
+    const quint64 sequence = nextSequence++;
+    encoders.start([this, buffer, width, height, sequence, issuedNs]() {
+        encode(buffer, width, height, sequence, issuedNs);
+    });
+}
+
+void FrameCapture::finish()
+{
+    if (!active) {
+        return;
+    }
+
+    retireReadySlots(true);
+    encoders.waitForDone();
+
+    for (Slot &slot : ring) {
+        if (slot.pbo != 0) {
+            glDeleteBuffers(1, &slot.pbo);
+            slot.pbo = 0;
+        }
+        GpuMemoryTracker::instance().release(slot.memory);
+    }
+    ring.clear();
+
+    if (stream.isOpen()) {
+        stream.close();
+    }
+    active = false;
+}
+
+// ------------------- Buffer Pool -------------------
+
+QByteArray *FrameCapture::acquireBuffer(qsizetype size)
+{
+    QMutexLocker locker(&poolMutex);
+
+    QByteArray *buffer = nullptr;
+    if (!freeBuffers.isEmpty()) {
+        buffer = freeBuffers.takeLast();
+    } else if (allocatedBuffers < maxBuffers) {
+        buffer = new QByteArray;
+        ++allocatedBuffers;
+    } else {
+        return nullptr;
+    }
+
+    // resize() keeps the existing allocation when the size does not change
+    buffer->resize(size);
+    return buffer;
+}
+
+void FrameCapture::releaseBuffer(QByteArray *buffer)
+{
+    QMutexLocker locker(&poolMutex);
+    freeBuffers.append(buffer);
+}
+
+// ------------------- Encoding (worker threads) -------------------
+
+static QByteArray rgbaToRgb(const uchar *src, int width, int height)
+{
+    QByteArray out(qsizetype(width) * height * 3, Qt::Uninitialized);
+    uchar *dst = reinterpret_cast<uchar *>(out.data());
+    const qsizetype pixels = qsizetype(width) * height;
+    for (qsizetype i = 0; i < pixels; ++i) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst += 3;
+        src += 4;
+    }
+    return out;
+}
+
+// BT.601 limited range, 2x2 chroma subsampling (odd edges are clamped)
+static QByteArray rgbaToI420(const uchar *src, int width, int height)
+{
+    const int chromaW = (width + 1) / 2;
+    const int chromaH = (height + 1) / 2;
+    const qsizetype lumaSize = qsizetype(width) * height;
+    const qsizetype chromaSize = qsizetype(chromaW) * chromaH;
+
+    QByteArray out(lumaSize + chromaSize * 2, Qt::Uninitialized);
+    uchar *yPlane = reinterpret_cast<uchar *>(out.data());
+    uchar *uPlane = yPlane + lumaSize;
+    uchar *vPlane = uPlane + chromaSize;
+
+    for (int y = 0; y < height; ++y) {
+        const uchar *row = src + qsizetype(y) * width * 4;
+        uchar *yRow = yPlane + qsizetype(y) * width;
+        for (int x = 0; x < width; ++x) {
+            const int r = row[x * 4 + 0];
+            const int g = row[x * 4 + 1];
+            const int b = row[x * 4 + 2];
+            yRow[x] = uchar(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+
+    for (int cy = 0; cy < chromaH; ++cy) {
+        const int y0 = cy * 2;
+        const int y1 = qMin(y0 + 1, height - 1);
+        for (int cx = 0; cx < chromaW; ++cx) {
+            const int x0 = cx * 2;
+            const int x1 = qMin(x0 + 1, width - 1);
+            const uchar *p[4] = {
+                src + (qsizetype(y0) * width + x0) * 4, src + (qsizetype(y0) * width + x1) * 4,
+                src + (qsizetype(y1) * width + x0) * 4, src + (qsizetype(y1) * width + x1) * 4
+            };
+            const int r = (p[0][0] + p[1][0] + p[2][0] + p[3][0] + 2) / 4;
+            const int g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) / 4;
+            const int b = (p[0][2] + p[1][2] + p[2][2] + p[3][2] + 2) / 4;
+            uPlane[qsizetype(cy) * chromaW + cx] = uchar(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            vPlane[qsizetype(cy) * chromaW + cx] = uchar(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    return out;
+}
+
+void FrameCapture::encode(QByteArray *pixels, int width, int height, quint64 sequence, qint64 issuedNs)
+{
+    const auto *data = reinterpret_cast<const uchar *>(pixels->constData());
+
+    if (format == Format::Png) {
+        // QImage only wraps the pooled buffer here, no copy is made
+        const QImage image(data, width, height, width * 4, QImage::Format_RGBA8888);
+        const QString path = QDir(outputDir).filePath(QString("frame_%1.png").arg(sequence, 6, 10, QChar('0')));
+        // Low compression: the encoders, not the disk, are the bottleneck at 1080p
+        if (!image.save(path, "PNG", 80)) {
+            qWarning() << "FrameCapture: failed to write" << path;
+        }
+        releaseBuffer(pixels);
+        recordWritten(issuedNs);
+        return;
+    }
+
+    const QByteArray converted = format == Format::RawRgb ? rgbaToRgb(data, width, height)
+                                                          : rgbaToI420(data, width, height);
+    releaseBuffer(pixels);
+    writeOrdered(sequence, converted, issuedNs);
+}
+
+void FrameCapture::writeOrdered(quint64 sequence, const QByteArray &bytes, qint64 issuedNs)
+{
+    QMutexLocker locker(&streamMutex);
+    pendingWrites.insert(sequence, bytes);
+    pendingIssued.insert(sequence, issuedNs);
+
+    // Whoever completes the next expected frame flushes every contiguous frame after it
+    while (!pendingWrites.isEmpty() && pendingWrites.firstKey() == nextToWrite) {
+        const QByteArray frame = pendingWrites.take(nextToWrite);
+        const qint64 issued = pendingIssued.take(nextToWrite);
+        if (stream.write(frame) != frame.size()) {
+            qWarning() << "FrameCapture: short write to" << stream.fileName();
+        }
+        recordWritten(issued);
+        ++nextToWrite;
+    }
+}
+
+void FrameCapture::recordWritten(qint64 issuedNs)
+{
+    const double endToEndMs = (clock.nsecsElapsed() - issuedNs) / 1.0e6;
+    QMutexLocker locker(&statsMutex);
+    ++counters.framesWritten;
+    endToEndMsTotal += endToEndMs;
+    counters.maxEndToEndMs = qMax(counters.maxEndToEndMs, endToEndMs);
+}
+
+// ------------------- Reporting -------------------
+
+FrameCapture::Stats FrameCapture::stats() const
+{
+    QMutexLocker locker(&statsMutex);
+    Stats result = counters;
+    if (counters.framesRead > 0) {
+        result.avgReadbackMs = readbackMsTotal / counters.framesRead;
+        result.avgReadbackFrames = readbackFramesTotal / counters.framesRead;
+    }
+    if (counters.framesWritten > 0) {
+        result.avgEndToEndMs = endToEndMsTotal / counters.framesWritten;
+    }
+    return result;
+}
+
+QString FrameCapture::report() const
+{
+    const Stats s = stats();
+    return QString("FrameCapture: %1 requested, %2 written, %3 dropped (ring full %4, encoders busy %5)\n"
+                   "  readback latency: avg %6 ms (%7 frames), max %8 ms\n"
+                   "  end-to-end latency: avg %9 ms, max %10 ms")
+        .arg(s.framesRequested)
+        .arg(s.framesWritten)
+        .arg(s.droppedRingFull + s.droppedNoBuffer)
+        .arg(s.droppedRingFull)
+        .arg(s.droppedNoBuffer)
+        .arg(s.avgReadbackMs, 0, 'f', 2)
+        .arg(s.avgReadbackFrames, 0, 'f', 2)
+        .arg(s.maxReadbackMs, 0, 'f', 2)
+        .arg(s.avgEndToEndMs, 0, 'f', 2)
+        .arg(s.maxEndToEndMs, 0, 'f', 2);
+}
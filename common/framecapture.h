@@ -0,0 +1,142 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include "gpumemory.h"
+
+/**
+ * @brief Asynchronous framebuffer readback for frame capture / recording.
+ *
+ * Each captured frame is read with glReadPixels() into one of a ring of
+ * GL_PIXEL_PACK_BUFFER objects, so the call returns immediately instead of
+ * stalling the GPU. A fence is inserted after the read; a few frames later,
+ * once the fence has signalled, the PBO is mapped, copied (and flipped to
+ * top-down row order) into a pooled CPU buffer and handed to a worker pool
+ * that encodes it to disk.
+ *
+ * If the ring is still full of in-flight reads, or the encoders have fallen
+ * behind and no CPU buffer is free, the frame is dropped rather than blocking
+ * paintGL(). Drops and latencies are reported by report().
+ *
+ * All GL calls must be made with the owning context current.
+ */
+class FrameCapture : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    enum class Format {
+        Png,       // One PNG file per frame: frame_000000.png, ...
+        RawRgb,    // Single RGB24 stream: capture.rgb
+        RawYuv420  // Single planar I420 (BT.601) stream: capture.yuv
+    };
+
+    struct Stats {
+        quint64 framesRequested = 0;
+        quint64 framesRead = 0;        // Retired from the PBO ring
+        quint64 framesWritten = 0;     // Encoded and on disk
+        quint64 droppedRingFull = 0;   // GPU readback not finished in time
+        quint64 droppedNoBuffer = 0;   // Encoders could not keep up
+        double avgReadbackMs = 0.0;    // glReadPixels issue -> PBO mapped
+        double maxReadbackMs = 0.0;
+        double avgReadbackFrames = 0.0;
+        double avgEndToEndMs = 0.0;    // glReadPixels issue -> written to disk
+        double maxEndToEndMs = 0.0;
+    };
+
+    FrameCapture();
+    ~FrameCapture();
+
+    /**
+     * @brief Creates the PBO ring and the encoder pool. Context must be current.
+     * @param outputDir Directory receiving the frames (created if missing).
+     * @param format Output encoding.
+     * @param ringSize Number of PBOs; a frame is mapped ringSize - 1 frames after it was read.
+     * @param encoderThreads Worker threads; 0 picks QThread::idealThreadCount() - 1.
+     */
+    bool initialize(const QString &outputDir, Format format, int ringSize = 3, int encoderThreads = 0);
+
+    /**
+     * @brief Queues a readback of the colour buffer of @p fbo. Call at the end of paintGL().
+     * @param fbo Framebuffer to read (e.g. QOpenGLWidget::defaultFramebufferObject()).
+     * @param width Width in device pixels.
+     * @param height Height in device pixels.
+     * @return false if the frame was dropped because the ring is full. A frame read now can still be
+     * dropped when it is retired, if no CPU buffer is free (Stats::droppedNoBuffer).
+     */
+    bool captureFrame(GLuint fbo, int width, int height);
+
+    /**
+     * @brief Blocks until every in-flight frame has been retired and written, then frees GL objects.
+     *
+     * In-flight frames are not dropped for lack of a CPU buffer here: it waits for the encoders instead.
+     */
+    void finish();
+
+    bool isActive() const { return active; }
+    Stats stats() const;
+    QString report() const;
+
+    static bool parseFormat(const QString &name, Format *format);
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        int width = 0;
+        int height = 0;
+        qsizetype capacity = 0;
+        quint64 issuedFrame = 0;
+        qint64 issuedNs = 0;
+        GpuMemoryTracker::Handle memory = 0;
+    };
+
+    void retireReadySlots(bool wait);
+    void retireSlot(Slot &slot, bool wait);
+    QByteArray *acquireBuffer(qsizetype size);
+    void releaseBuffer(QByteArray *buffer);
+    void encode(QByteArray *pixels, int width, int height, quint64 sequence, qint64 issuedNs);
+    void writeOrdered(quint64 sequence, const QByteArray &bytes, qint64 issuedNs);
+    void recordWritten(qint64 issuedNs);
+
+    bool active = false;
+    Format format = Format::Png;
+    QString outputDir;
+
+    QVector<Slot> ring;
+    int writeSlot = 0;        // Next slot receiving a glReadPixels
+    int readSlot = 0;         // Oldest in-flight slot
+    int inFlight = 0;
+    quint64 nextSequence = 0;  // Assigned to frames that reach the encoders
+    quint64 paintCount = 0;
+
+    QThreadPool encoders;
+    QElapsedTimer clock;
+
+    // Pooled CPU-side frame buffers, shared with the encoder threads
+    mutable QMutex poolMutex;
+    QVector<QByteArray *> freeBuffers;
+    int allocatedBuffers = 0;
+    int maxBuffers = 0;
+
+    // Raw streams must be written in frame order even though encoding is parallel
+    QMutex streamMutex;
+    QFile stream;
+    QMap<quint64, QByteArray> pendingWrites;
+    QMap<quint64, qint64> pendingIssued;
+    quint64 nextToWrite = 0;
+
+    mutable QMutex statsMutex;
+    Stats counters;
+    double readbackMsTotal = 0.0;
+    double readbackFramesTotal = 0.0;
+    double endToEndMsTotal = 0.0;
+};
+
+#endif // FRAMECAPTURE_H
@@ -0,0 +1,559 @@
+#include "framegraph.h"
+#include <QDebug>
+#include <QSet>
+#include <algorithm>
+
+// ------------------- Target Formats -------------------
+
+namespace {
+
+struct FormatInfo {
+    GLenum format = 0;
+    GLenum type = 0;
+    qint64 bytes = 0;
+    GLenum attachment = 0;                 // 0: color
+    bool integer = false;
+};
+
+bool formatInfo(GLenum internalFormat, FormatInfo *info)
+{
+    switch (internalFormat) {
+    case GL_RGBA8:              *info = { GL_RGBA, GL_UNSIGNED_BYTE, 4 }; return true;
+    case GL_RGB10_A2:           *info = { GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 4 }; return true;
+    case GL_R11F_G11F_B10F:     *info = { GL_RGB, GL_FLOAT, 4 }; return true;
+    case GL_RGBA16F:            *info = { GL_RGBA, GL_HALF_FLOAT, 8 }; return true;
+    case GL_RGBA32F:            *info = { GL_RGBA, GL_FLOAT, 16 }; return true;
+    case GL_R8:                 *info = { GL_RED, GL_UNSIGNED_BYTE, 1 }; return true;
+    case GL_RG8:                *info = { GL_RG, GL_UNSIGNED_BYTE, 2 }; return true;
+    case GL_R16F:               *info = { GL_RED, GL_HALF_FLOAT, 2 }; return true;
+    case GL_RG16F:              *info = { GL_RG, GL_HALF_FLOAT, 4 }; return true;
+    case GL_R32F:               *info = { GL_RED, GL_FLOAT, 4 }; return true;
+    case GL_R32UI:              *info = { GL_RED_INTEGER, GL_UNSIGNED_INT, 4, 0, true }; return true;
+    case GL_DEPTH_COMPONENT24:  *info = { GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4, GL_DEPTH_ATTACHMENT }; return true;
+    case GL_DEPTH_COMPONENT32F: *info = { GL_DEPTH_COMPONENT, GL_FLOAT, 4, GL_DEPTH_ATTACHMENT }; return true;
+    case GL_DEPTH24_STENCIL8:
+        *info = { GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4, GL_DEPTH_STENCIL_ATTACHMENT };
+        return true;
+    case GL_DEPTH32F_STENCIL8:
+        *info = { GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, 8, GL_DEPTH_STENCIL_ATTACHMENT };
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+qint64 FrameGraph::bytesPerPixel(GLenum format)
+{
+    FormatInfo info;
+    return formatInfo(format, &info) ? info.bytes : 0;
+}
+
+// ------------------- Setup -------------------
+
+bool FrameGraph::initialize(const Params &params)
+{
+    if (initialized) {
+        release();
+    }
+    initializeOpenGLFunctions();
+    parameters = params;
+    parameters.sizeGranularity = qMax(1, parameters.sizeGranularity);
+    parameters.evictAfterFrames = qMax(1, parameters.evictAfterFrames);
+    counters = Stats();
+    lastFrame = FrameStats();
+    lastDescription.clear();
+    frame = 0;
+    initialized = true;
+    return true;
+}
+
+void FrameGraph::release()
+{
+    if (!initialized) {
+        return;
+    }
+    for (GLuint fbo : std::as_const(framebuffers)) {
+        glDeleteFramebuffers(1, &fbo);
+    }
+    framebuffers.clear();
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    for (const PoolTexture &entry : std::as_const(pool)) {
+        glDeleteTextures(1, &entry.texture);
+        memory.release(entry.memory);
+    }
+    pool.clear();
+    passes.clear();
+    resources.clear();
+    initialized = false;
+}
+
+// ------------------- Declaration -------------------
+
+FrameGraph::Resource FrameGraph::importFramebuffer(const QString &name, GLuint framebuffer, const QSize &size)
+{
+    ResourceNode node;
+    node.name = name;
+    node.desc.size = size;
+    node.imported = true;
+    node.importedFramebuffer = framebuffer;
+    resources.append(node);
+    return resources.size() - 1;
+}
+
+FrameGraph::Resource FrameGraph::importTexture(const QString &name, GLuint texture, const QSize &size)
+{
+    ResourceNode node;
+    node.name = name;
+    node.desc.size = size;
+    node.imported = true;
+    node.importedTexture = texture;
+    resources.append(node);
+    return resources.size() - 1;
+}
+
+void FrameGraph::addPass(const QString &name, SetupFunction setup, ExecuteFunction execute)
+{
+    PassNode pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes.append(pass);
+
+    Builder builder(this, passes.size() - 1);
+    setup(builder);
+}
+
+FrameGraph::Resource FrameGraph::Builder::create(const QString &name, const TargetDesc &desc)
+{
+    if (desc.size.isEmpty() || bytesPerPixel(desc.format) == 0) {
+        qWarning() << "FrameGraph: pass" << graph->passes[pass].name << "declares an invalid target" << name
+                   << desc.size << Qt::hex << desc.format;
+        return -1;
+    }
+    ResourceNode node;
+    node.name = name;
+    node.desc = desc;
+    node.writers.append(pass);
+    graph->resources.append(node);
+    const Resource resource = graph->resources.size() - 1;
+    graph->passes[pass].writes.append(resource);
+    return resource;
+}
+
+FrameGraph::Resource FrameGraph::Builder::read(Resource resource)
+{
+    if (!graph->isValid(resource)) {
+        qWarning() << "FrameGraph: pass" << graph->passes[pass].name << "reads an invalid resource";
+        return -1;
+    }
+    PassNode &node = graph->passes[pass];
+    if (!node.reads.contains(resource)) {
+        node.reads.append(resource);
+        graph->resources[resource].readers.append(pass);
+    }
+    return resource;
+}
+
+FrameGraph::Resource FrameGraph::Builder::write(Resource resource)
+{
+    if (!graph->isValid(resource)) {
+        qWarning() << "FrameGraph: pass" << graph->passes[pass].name << "writes an invalid resource";
+        return -1;
+    }
+    PassNode &node = graph->passes[pass];
+    ResourceNode &target = graph->resources[resource];
+    if (!node.writes.contains(resource)) {
+        node.writes.append(resource);
+        target.writers.append(pass);
+    }
+    // Nothing in the graph reads an imported target, so its writers are the roots that keep everything alive
+    if (target.imported) {
+        node.sideEffect = true;
+    }
+    return resource;
+}
+
+void FrameGraph::Builder::setSideEffect()
+{
+    graph->passes[pass].sideEffect = true;
+}
+
+// ------------------- Compilation -------------------
+
+void FrameGraph::cull()
+{
+    // Reference counting from the unread resources backwards: a pass whose
+    // outputs all end up unread is culled, which may leave its inputs unread
+    QVector<Resource> unread;
+    for (int i = 0; i < resources.size(); ++i) {
+        resources[i].refCount = resources[i].readers.size();
+        if (resources[i].refCount == 0 && !resources[i].imported) {
+            unread.append(i);
+        }
+    }
+    for (PassNode &pass : passes) {
+        pass.refCount = pass.writes.size();
+        pass.culled = false;
+    }
+
+    while (!unread.isEmpty()) {
+        const Resource resource = unread.takeLast();
+        for (int writer : std::as_const(resources[resource].writers)) {
+            PassNode &pass = passes[writer];
+            if (--pass.refCount > 0 || pass.sideEffect || pass.culled) {
+                continue;
+            }
+            pass.culled = true;
+            for (Resource input : std::as_const(pass.reads)) {
+                if (--resources[input].refCount == 0 && !resources[input].imported) {
+                    unread.append(input);
+                }
+            }
+        }
+    }
+
+    // A pass that writes nothing and has no side effect has no reason to run
+    for (PassNode &pass : passes) {
+        if (pass.writes.isEmpty() && !pass.sideEffect) {
+            pass.culled = true;
+        }
+    }
+}
+
+QSize FrameGraph::allocationSize(const QSize &size) const
+{
+    const int g = parameters.sizeGranularity;
+    return QSize((size.width() + g - 1) / g * g, (size.height() + g - 1) / g * g);
+}
+
+int FrameGraph::acquire(const TargetDesc &desc)
+{
+    const QSize size = allocationSize(desc.size);
+    for (int i = 0; i < pool.size(); ++i) {
+        PoolTexture &entry = pool[i];
+        if (!entry.inUse && entry.format == desc.format && entry.allocatedSize == size) {
+            entry.inUse = true;
+            entry.lastUsedFrame = frame;
+            return i;
+        }
+    }
+
+    FormatInfo info;
+    formatInfo(desc.format, &info);
+
+    PoolTexture entry;
+    entry.allocatedSize = size;
+    entry.format = desc.format;
+    entry.bytes = qint64(size.width()) * size.height() * info.bytes;
+
+    // Allocation is the only place a GL error is expected (GL_OUT_OF_MEMORY for large targets).
+    // Bounded, since a lost context keeps returning GL_CONTEXT_LOST.
+    for (int i = 0; i < 32 && glGetError() != GL_NO_ERROR; ++i) {
+    }
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.format, size.width(), size.height(), 0, info.format, info.type, nullptr);
+    const GLint filter = info.integer || info.attachment != 0 ? GL_NEAREST : GL_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (glGetError() == GL_OUT_OF_MEMORY) {
+        qWarning() << "FrameGraph: out of GPU memory for a" << size << "render target";
+        glDeleteTextures(1, &entry.texture);
+        return -1;
+    }
+
+    entry.inUse = true;
+    entry.lastUsedFrame = frame;
+    entry.memory = GpuMemoryTracker::instance().registerAllocation(
+        GpuMemoryTracker::Category::RenderTarget, entry.bytes, "FrameGraph",
+        QString("transient %1x%2").arg(size.width()).arg(size.height()));
+    pool.append(entry);
+    ++counters.allocations;
+    ++lastFrame.allocations;
+    return pool.size() - 1;
+}
+
+GLuint FrameGraph::framebufferFor(const PassNode &pass, QSize *size)
+{
+    QVector<GLuint> colors;
+    GLuint depth = 0;
+    GLenum depthAttachment = 0;
+    for (Resource resource : pass.writes) {
+        const ResourceNode &node = resources[resource];
+        if (node.imported) {
+            if (node.importedFramebuffer != 0 || node.importedTexture == 0) {
+                if (pass.writes.size() > 1) {
+                    qWarning() << "FrameGraph: pass" << pass.name << "writes" << node.name
+                               << "and other targets; only" << node.name << "is bound";
+                }
+                *size = node.desc.size;
+                return node.importedFramebuffer;
+            }
+            qWarning() << "FrameGraph: pass" << pass.name << "writes the imported texture" << node.name
+                       << "which cannot be attached";
+            continue;
+        }
+        if (node.poolIndex < 0) {
+            return 0;
+        }
+        if (size->isEmpty()) {
+            *size = node.desc.size;
+        } else if (*size != node.desc.size) {
+            qWarning() << "FrameGraph: pass" << pass.name << "writes targets of different sizes";
+        }
+        FormatInfo info;
+        formatInfo(node.desc.format, &info);
+        if (info.attachment != 0) {
+            depth = pool[node.poolIndex].texture;
+            depthAttachment = info.attachment;
+        } else {
+            colors.append(pool[node.poolIndex].texture);
+        }
+    }
+
+    // Same attachments, same framebuffer: the key is the texture names, depth last
+    QVector<GLuint> names = colors;
+    names.append(depth);
+    const QByteArray key(reinterpret_cast<const char *>(names.constData()), names.size() * int(sizeof(GLuint)));
+    const auto cached = framebuffers.constFind(key);
+    if (cached != framebuffers.constEnd()) {
+        return *cached;
+    }
+
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    QVector<GLenum> drawBuffers;
+    for (int i = 0; i < colors.size(); ++i) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colors[i], 0);
+        drawBuffers.append(GL_COLOR_ATTACHMENT0 + i);
+    }
+    if (depth != 0) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+    }
+    if (drawBuffers.isEmpty()) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    } else {
+        glDrawBuffers(drawBuffers.size(), drawBuffers.constData());
+    }
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        qWarning() << "FrameGraph: framebuffer of pass" << pass.name << "is incomplete:" << Qt::hex << status;
+    }
+    framebuffers.insert(key, fbo);
+    ++counters.framebuffersCreated;
+    return fbo;
+}
+
+// ------------------- Execution -------------------
+
+void FrameGraph::execute()
+{
+    if (!initialized) {
+        qWarning() << "FrameGraph: execute() before initialize()";
+        passes.clear();
+        resources.clear();
+        return;
+    }
+
+    ++frame;
+    lastFrame = FrameStats();
+    lastFrame.passes = passes.size();
+    cull();
+
+    // Lifetimes, in pass indices
+    for (int i = 0; i < passes.size(); ++i) {
+        if (passes[i].culled) {
+            ++lastFrame.culledPasses;
+            continue;
+        }
+        QVector<Resource> used = passes[i].reads;
+        used += passes[i].writes;
+        for (Resource resource : std::as_const(used)) {
+            ResourceNode &node = resources[resource];
+            if (node.firstUse < 0) {
+                node.firstUse = i;
+                if (!node.imported && passes[i].reads.contains(resource)) {
+                    qWarning() << "FrameGraph: pass" << passes[i].name << "reads" << node.name
+                               << "before any pass writes it";
+                }
+            }
+            node.lastUse = i;
+        }
+    }
+
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    QSet<int> texturesUsed;
+    qint64 liveBytes = 0;
+    QStringList order;
+    for (int i = 0; i < passes.size(); ++i) {
+        PassNode &pass = passes[i];
+        if (pass.culled) {
+            order.append(pass.name + " (culled)");
+            continue;
+        }
+        order.append(pass.name);
+
+        // Targets come out of the pool at their first use...
+        QVector<Resource> used = pass.reads;
+        used += pass.writes;
+        bool allocated = true;
+        for (Resource resource : std::as_const(used)) {
+            ResourceNode &node = resources[resource];
+            if (node.imported || node.firstUse != i) {
+                continue;
+            }
+            node.poolIndex = acquire(node.desc);
+            if (node.poolIndex < 0) {
+                allocated = false;
+                continue;
+            }
+            liveBytes += pool[node.poolIndex].bytes;
+            texturesUsed.insert(node.poolIndex);
+            ++lastFrame.transientTargets;
+            lastFrame.unaliasedBytes += pool[node.poolIndex].bytes;
+        }
+        lastFrame.peakBytes = qMax(lastFrame.peakBytes, liveBytes);
+
+        PassContext context;
+        context.graph = this;
+        if (allocated && !pass.writes.isEmpty()) {
+            context.fbo = framebufferFor(pass, &context.target);
+            glBindFramebuffer(GL_FRAMEBUFFER, context.fbo);
+            glViewport(0, 0, context.target.width(), context.target.height());
+        }
+        if (allocated) {
+            pass.execute(context);
+        } else {
+            qWarning() << "FrameGraph: pass" << pass.name << "skipped, its targets could not be allocated";
+        }
+
+        // ...and go back after their last one, free for a later target of the same bucket
+        for (Resource resource : std::as_const(used)) {
+            ResourceNode &node = resources[resource];
+            if (node.imported || node.lastUse != i || node.poolIndex < 0) {
+                continue;
+            }
+            pool[node.poolIndex].inUse = false;
+            liveBytes -= pool[node.poolIndex].bytes;
+            node.poolIndex = -1;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previousFramebuffer));
+
+    lastFrame.texturesUsed = texturesUsed.size();
+    lastDescription = order.join(" -> ");
+    counters.peakFrameBytes = qMax(counters.peakFrameBytes, lastFrame.peakBytes);
+    ++counters.frames;
+
+    passes.clear();
+    resources.clear();
+    evictIdle();
+}
+
+void FrameGraph::evictIdle()
+{
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    for (int i = pool.size() - 1; i >= 0; --i) {
+        const PoolTexture &entry = pool[i];
+        if (entry.inUse || frame - entry.lastUsedFrame < quint64(parameters.evictAfterFrames)) {
+            continue;
+        }
+        deleteFramebuffersUsing(entry.texture);
+        glDeleteTextures(1, &entry.texture);
+        memory.release(entry.memory);
+        pool.remove(i);
+        ++counters.evictions;
+    }
+}
+
+void FrameGraph::deleteFramebuffersUsing(GLuint texture)
+{
+    for (auto it = framebuffers.begin(); it != framebuffers.end();) {
+        const GLuint *names = reinterpret_cast<const GLuint *>(it.key().constData());
+        const GLuint *end = names + it.key().size() / int(sizeof(GLuint));
+        if (std::find(names, end, texture) != end) {
+            glDeleteFramebuffers(1, &it.value());
+            it = framebuffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// ------------------- Pass Context -------------------
+
+GLuint FrameGraph::PassContext::texture(Resource resource) const
+{
+    if (!graph->isValid(resource)) {
+        return 0;
+    }
+    const ResourceNode &node = graph->resources[resource];
+    if (node.imported) {
+        return node.importedTexture;
+    }
+    return node.poolIndex >= 0 ? graph->pool[node.poolIndex].texture : 0;
+}
+
+QSize FrameGraph::PassContext::size(Resource resource) const
+{
+    return graph->isValid(resource) ? graph->resources[resource].desc.size : QSize();
+}
+
+QVector2D FrameGraph::PassContext::uvScale(Resource resource) const
+{
+    if (!graph->isValid(resource)) {
+        return QVector2D(1.0f, 1.0f);
+    }
+    const ResourceNode &node = graph->resources[resource];
+    if (node.imported || node.poolIndex < 0) {
+        return QVector2D(1.0f, 1.0f);
+    }
+    const QSize allocated = graph->pool[node.poolIndex].allocatedSize;
+    return QVector2D(float(node.desc.size.width()) / allocated.width(),
+                     float(node.desc.size.height()) / allocated.height());
+}
+
+// ------------------- Statistics -------------------
+
+FrameGraph::Stats FrameGraph::stats() const
+{
+    Stats s = counters;
+    s.poolTextures = pool.size();
+    s.poolBytes = 0;
+    for (const PoolTexture &entry : pool) {
+        s.poolBytes += entry.bytes;
+    }
+    return s;
+}
+
+QString FrameGraph::report() const
+{
+    const Stats s = stats();
+    const double mib = 1024.0 * 1024.0;
+    return QString("FrameGraph: last frame %1 passes (%2 culled), %3 targets in %4 textures, peak %5 MiB "
+                   "(%6 MiB unaliased); largest frame peak %7 MiB; pool %8 textures / %9 MiB, %10 allocations, "
+                   "%11 evictions over %12 frames")
+        .arg(lastFrame.passes)
+        .arg(lastFrame.culledPasses)
+        .arg(lastFrame.transientTargets)
+        .arg(lastFrame.texturesUsed)
+        .arg(lastFrame.peakBytes / mib, 0, 'f', 2)
+        .arg(lastFrame.unaliasedBytes / mib, 0, 'f', 2)
+        .arg(s.peakFrameBytes / mib, 0, 'f', 2)
+        .arg(s.poolTextures)
+        .arg(s.poolBytes / mib, 0, 'f', 2)
+        .arg(s.allocations)
+        .arg(s.evictions)
+        .arg(s.frames);
+}
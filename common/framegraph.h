@@ -0,0 +1,211 @@
+#ifndef FRAMEGRAPH_H
+#define FRAMEGRAPH_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QByteArray>
+#include <QHash>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <QVector2D>
+#include <functional>
+#include "gpumemory.h"
+
+/**
+ * @brief Per-frame render graph with pooled, aliased transient render targets.
+ *
+ * Every frame, passes are added with a setup function that declares the
+ * targets they create, read and write, and an execute function that issues
+ * the GL calls. execute() then:
+ * - culls passes whose results nobody reads (passes that write an imported
+ *   target, such as the widget's framebuffer, or call setSideEffect() are
+ *   always kept),
+ * - runs the rest in declaration order, binding a framebuffer with the
+ *   targets each pass writes and setting the viewport to their size,
+ * - takes each transient target from the pool just before its first use and
+ *   gives it back right after its last one, so targets whose lifetimes do not
+ *   overlap share one texture.
+ *
+ * GL has no memory heaps, so aliasing is per texture: targets alias when they
+ * land in the same pool bucket (allocated size and format). Allocated sizes
+ * are rounded up to sizeGranularity pixels. An interactive resize therefore
+ * reuses the same textures until the window crosses a bucket boundary,
+ * instead of reallocating every frame. Passes see the exact size; readers
+ * scale their texture coordinates by uvScale(). Pool textures unused for
+ * evictAfterFrames frames are deleted.
+ *
+ * All GL calls must be made with the owning context current.
+ */
+class FrameGraph : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    using Resource = int;                  // -1 is never valid
+
+    struct TargetDesc {
+        QSize size;
+        GLenum format = GL_RGBA8;          // Sized internal format; depth formats become the depth attachment
+    };
+
+    struct Params {
+        int sizeGranularity = 64;          // Pixels; 1 allocates exact sizes
+        int evictAfterFrames = 120;
+    };
+
+    // Counters of the last execute()
+    struct FrameStats {
+        int passes = 0;
+        int culledPasses = 0;
+        int transientTargets = 0;
+        int texturesUsed = 0;              // Distinct pool textures behind those targets
+        int allocations = 0;               // Pool misses this frame
+        qint64 peakBytes = 0;              // Largest total of live transient targets at any pass
+        qint64 unaliasedBytes = 0;         // What the targets would take with one texture each
+    };
+
+    struct Stats {
+        int poolTextures = 0;
+        qint64 poolBytes = 0;
+        qint64 peakFrameBytes = 0;         // Largest FrameStats::peakBytes so far
+        quint64 allocations = 0;
+        quint64 evictions = 0;
+        quint64 framebuffersCreated = 0;
+        quint64 frames = 0;
+    };
+
+    class Builder
+    {
+    public:
+        /**
+         * @brief Declares a transient target written by this pass.
+         */
+        Resource create(const QString &name, const TargetDesc &desc);
+        Resource read(Resource resource);
+        Resource write(Resource resource);
+        /**
+         * @brief Keeps the pass even if nothing reads what it writes.
+         */
+        void setSideEffect();
+
+    private:
+        friend class FrameGraph;
+        Builder(FrameGraph *graph, int pass) : graph(graph), pass(pass) {}
+        FrameGraph *graph;
+        int pass;
+    };
+
+    class PassContext
+    {
+    public:
+        GLuint texture(Resource resource) const;
+        QSize size(Resource resource) const;          // As declared
+        QVector2D uvScale(Resource resource) const;   // Declared size over allocated size
+        GLuint framebuffer() const { return fbo; }
+        QSize targetSize() const { return target; }
+
+    private:
+        friend class FrameGraph;
+        const FrameGraph *graph = nullptr;
+        GLuint fbo = 0;
+        QSize target;
+    };
+
+    using SetupFunction = std::function<void(Builder &)>;
+    using ExecuteFunction = std::function<void(const PassContext &)>;
+
+    FrameGraph() = default;
+
+    bool initialize() { return initialize(Params()); }
+    bool initialize(const Params &params);
+    /**
+     * @brief Deletes the pool and the framebuffers; call with the context current.
+     */
+    void release();
+
+    /**
+     * @brief Makes an existing framebuffer (e.g. QOpenGLWidget::defaultFramebufferObject()) writable by passes.
+     */
+    Resource importFramebuffer(const QString &name, GLuint framebuffer, const QSize &size);
+    /**
+     * @brief Makes an existing texture readable by passes.
+     */
+    Resource importTexture(const QString &name, GLuint texture, const QSize &size);
+
+    /**
+     * @brief Declares a pass; @p setup runs immediately, @p execute during execute().
+     */
+    void addPass(const QString &name, SetupFunction setup, ExecuteFunction execute);
+
+    /**
+     * @brief Culls, allocates and runs this frame's passes, then clears them for the next frame.
+     *
+     * Restores the draw framebuffer that was bound when it was called.
+     */
+    void execute();
+
+    FrameStats frameStats() const { return lastFrame; }
+    Stats stats() const;
+    QString report() const;
+    /**
+     * @brief Passes of the last frame in execution order, culled ones marked.
+     */
+    QString describeLastFrame() const { return lastDescription; }
+
+    static qint64 bytesPerPixel(GLenum format);
+
+private:
+    struct ResourceNode {
+        QString name;
+        TargetDesc desc;
+        bool imported = false;
+        GLuint importedFramebuffer = 0;
+        GLuint importedTexture = 0;
+        QVector<int> writers;
+        QVector<int> readers;
+        int refCount = 0;
+        int firstUse = -1;
+        int lastUse = -1;
+        int poolIndex = -1;                // While allocated
+    };
+
+    struct PassNode {
+        QString name;
+        ExecuteFunction execute;
+        QVector<Resource> reads;
+        QVector<Resource> writes;
+        bool sideEffect = false;
+        int refCount = 0;
+        bool culled = false;
+    };
+
+    struct PoolTexture {
+        GLuint texture = 0;
+        QSize allocatedSize;
+        GLenum format = GL_RGBA8;
+        qint64 bytes = 0;
+        bool inUse = false;
+        quint64 lastUsedFrame = 0;
+        GpuMemoryTracker::Handle memory = 0;
+    };
+
+    bool isValid(Resource resource) const { return resource >= 0 && resource < resources.size(); }
+    void cull();
+    QSize allocationSize(const QSize &size) const;
+    int acquire(const TargetDesc &desc);
+    GLuint framebufferFor(const PassNode &pass, QSize *size);
+    void evictIdle();
+    void deleteFramebuffersUsing(GLuint texture);
+
+    bool initialized = false;
+    Params parameters;
+    QVector<PassNode> passes;
+    QVector<ResourceNode> resources;
+    QVector<PoolTexture> pool;
+    QHash<QByteArray, GLuint> framebuffers;   // Keyed by the attached texture names
+    quint64 frame = 0;
+
+    FrameStats lastFrame;
+    Stats counters;
+    QString lastDescription;
+};
+
+#endif // FRAMEGRAPH_H
@@ -0,0 +1,141 @@
+#include "glcounters.h"
+#include <QStringList>
+#include <cstring>
+
+namespace glcounters {
+
+quint64 primitiveCount(GLenum mode, qint64 vertexCount)
+{
+    if (vertexCount <= 0) {
+        return 0;
+    }
+    switch (mode) {
+    case GL_POINTS:
+        return quint64(vertexCount);
+    case GL_LINES:
+        return quint64(vertexCount / 2);
+    case GL_LINE_STRIP:
+        return quint64(qMax<qint64>(0, vertexCount - 1));
+    case GL_LINE_LOOP:
+        return quint64(vertexCount);
+    case GL_TRIANGLES:
+        return quint64(vertexCount / 3);
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+        return quint64(qMax<qint64>(0, vertexCount - 2));
+    default:
+        return 0;
+    }
+}
+
+void beginFrame()
+{
+    ThreadSlot &slot = threadSlot;
+    slot.passes[0] = PassCounters();
+    slot.passCount = 1;
+    slot.current = 0;
+    slot.depth = 0;
+    slot.overflow = 0;
+}
+
+void endFrame()
+{
+    ThreadSlot &slot = threadSlot;
+
+    Counters total;
+    slot.lastFramePasses.clear();
+    for (int i = 0; i < slot.passCount; ++i) {
+        total += slot.passes[i].counters;
+        if (i > 0) {
+            slot.lastFramePasses.append(slot.passes[i]);
+        }
+    }
+    slot.lastFrame = total;
+    ++slot.framesCompleted;
+
+    beginFrame();
+}
+
+void beginPass(const char *name)
+{
+    ThreadSlot &slot = threadSlot;
+    if (slot.depth == MaxPasses) {
+        ++slot.overflow; // Too deep: keep counting into the current pass, the matching endPass() pops nothing
+        return;
+    }
+    slot.stack[slot.depth++] = slot.current;
+
+    // A pass entered several times in one frame accumulates into the same entry
+    for (int i = 1; i < slot.passCount; ++i) {
+        if (slot.passes[i].name == name || std::strcmp(slot.passes[i].name, name) == 0) {
+            slot.current = i;
+            return;
+        }
+    }
+    if (slot.passCount == MaxPasses) {
+        return; // Out of slots: keep counting into the enclosing pass
+    }
+    slot.passes[slot.passCount] = PassCounters();
+    slot.passes[slot.passCount].name = name;
+    slot.current = slot.passCount++;
+}
+
+void endPass()
+{
+    ThreadSlot &slot = threadSlot;
+    if (slot.overflow > 0) {
+        --slot.overflow;
+    } else if (slot.depth > 0) {
+        slot.current = slot.stack[--slot.depth];
+    }
+}
+
+Counters lastFrame()
+{
+    return threadSlot.lastFrame;
+}
+
+QVector<PassCounters> lastFramePasses()
+{
+    return threadSlot.lastFramePasses;
+}
+
+Counters current()
+{
+    Counters total;
+    for (int i = 0; i < threadSlot.passCount; ++i) {
+        total += threadSlot.passes[i].counters;
+    }
+    return total;
+}
+
+quint64 framesCompleted()
+{
+    return threadSlot.framesCompleted;
+}
+
+const char *counterName(Counter counter)
+{
+    switch (counter) {
+    case DrawCalls: return "draws";
+    case Primitives: return "primitives";
+    case ProgramBinds: return "program binds";
+    case VertexArrayBinds: return "VAO binds";
+    case TextureBinds: return "texture binds";
+    case BufferBinds: return "buffer binds";
+    case UniformUploads: return "uniforms";
+    case BytesUploaded: return "bytes uploaded";
+    default: return "?";
+    }
+}
+
+QString format(const Counters &counters)
+{
+    QStringList parts;
+    for (int i = 0; i < CounterCount; ++i) {
+        parts << QString("%1 %2").arg(counters.values[i]).arg(counterName(Counter(i)));
+    }
+    return parts.join(", ");
+}
+
+} // namespace glcounters
@@ -0,0 +1,137 @@
+#ifndef GLCOUNTERS_H
+#define GLCOUNTERS_H
+
+#include <qopengl.h>
+#include <QString>
+#include <QVector>
+
+// ------------------- GL Call Counters -------------------
+//
+// Per-frame / per-pass counts of draw calls, primitives, binds, uniform
+// uploads and uploaded bytes. Every GL_COUNT_* macro is a thread_local
+// increment when GL_COUNTERS_ENABLED is defined and expands to nothing
+// otherwise, so instrumented call sites cost nothing in Release builds.
+// (The stage CMakeLists define GL_COUNTERS_ENABLED for non-Release builds,
+// or always with -DGL_COUNTERS=ON for soak tests.)
+//
+// Counters live in one slot per thread; frames and passes are delimited on
+// the thread that issues the GL calls, and the query functions return the
+// calling thread's last completed frame.
+
+namespace glcounters {
+
+enum Counter {
+    DrawCalls,
+    Primitives,
+    ProgramBinds,
+    VertexArrayBinds,
+    TextureBinds,
+    BufferBinds,
+    UniformUploads,
+    BytesUploaded,
+    CounterCount
+};
+
+struct Counters {
+    quint64 values[CounterCount] = {};
+
+    quint64 operator[](Counter c) const { return values[c]; }
+    Counters &operator+=(const Counters &other)
+    {
+        for (int i = 0; i < CounterCount; ++i) {
+            values[i] += other.values[i];
+        }
+        return *this;
+    }
+};
+
+struct PassCounters {
+    const char *name = nullptr;
+    Counters counters;
+};
+
+constexpr int MaxPasses = 16;
+
+struct ThreadSlot {
+    PassCounters passes[MaxPasses];   // passes[0] collects calls made outside any named pass
+    int passCount = 1;
+    int current = 0;
+    int stack[MaxPasses] = {};
+    int depth = 0;
+    int overflow = 0;                 // beginPass() calls nested deeper than MaxPasses, not on the stack
+
+    Counters lastFrame;
+    QVector<PassCounters> lastFramePasses;
+    quint64 framesCompleted = 0;
+};
+
+inline thread_local ThreadSlot threadSlot;
+
+inline void add(Counter counter, quint64 amount = 1)
+{
+    threadSlot.passes[threadSlot.current].counters.values[counter] += amount;
+}
+
+quint64 primitiveCount(GLenum mode, qint64 vertexCount);
+
+void beginFrame();
+void endFrame();
+void beginPass(const char *name);
+void endPass();
+
+// Query API (calling thread's slot)
+Counters lastFrame();
+QVector<PassCounters> lastFramePasses();
+Counters current();               // Accumulated since the last beginFrame()
+quint64 framesCompleted();
+
+const char *counterName(Counter counter);
+QString format(const Counters &counters);
+
+struct PassScope {
+    explicit PassScope(const char *name) { beginPass(name); }
+    ~PassScope() { endPass(); }
+    PassScope(const PassScope &) = delete;
+    PassScope &operator=(const PassScope &) = delete;
+};
+
+} // namespace glcounters
+
+#ifdef GL_COUNTERS_ENABLED
+#define GL_COUNTERS_CONCAT_(a, b) a##b
+#define GL_COUNTERS_CONCAT(a, b) GL_COUNTERS_CONCAT_(a, b)
+
+#define GL_COUNT_DRAW(mode, count) \
+    (glcounters::add(glcounters::DrawCalls), \
+     glcounters::add(glcounters::Primitives, glcounters::primitiveCount((mode), (count))))
+#define GL_COUNT_DRAW_INSTANCED(mode, count, instances) \
+    (glcounters::add(glcounters::DrawCalls), \
+     glcounters::add(glcounters::Primitives, glcounters::primitiveCount((mode), (count)) * quint64(instances)))
+#define GL_COUNT_PROGRAM_BIND() glcounters::add(glcounters::ProgramBinds)
+#define GL_COUNT_VAO_BIND() glcounters::add(glcounters::VertexArrayBinds)
+#define GL_COUNT_TEXTURE_BIND() glcounters::add(glcounters::TextureBinds)
+#define GL_COUNT_BUFFER_BIND() glcounters::add(glcounters::BufferBinds)
+#define GL_COUNT_UNIFORM() glcounters::add(glcounters::UniformUploads)
+#define GL_COUNT_UPLOAD(bytes) glcounters::add(glcounters::BytesUploaded, quint64(bytes))
+#define GL_COUNTERS_BEGIN_FRAME() glcounters::beginFrame()
+#define GL_COUNTERS_END_FRAME() glcounters::endFrame()
+#define GL_COUNTERS_BEGIN_PASS(name) glcounters::beginPass(name)
+#define GL_COUNTERS_END_PASS() glcounters::endPass()
+#define GL_COUNTERS_PASS(name) glcounters::PassScope GL_COUNTERS_CONCAT(glCountersPass_, __LINE__)(name)
+#else
+#define GL_COUNT_DRAW(mode, count) ((void)0)
+#define GL_COUNT_DRAW_INSTANCED(mode, count, instances) ((void)0)
+#define GL_COUNT_PROGRAM_BIND() ((void)0)
+#define GL_COUNT_VAO_BIND() ((void)0)
+#define GL_COUNT_TEXTURE_BIND() ((void)0)
+#define GL_COUNT_BUFFER_BIND() ((void)0)
+#define GL_COUNT_UNIFORM() ((void)0)
+#define GL_COUNT_UPLOAD(bytes) ((void)0)
+#define GL_COUNTERS_BEGIN_FRAME() ((void)0)
+#define GL_COUNTERS_END_FRAME() ((void)0)
+#define GL_COUNTERS_BEGIN_PASS(name) ((void)0)
+#define GL_COUNTERS_END_PASS() ((void)0)
+#define GL_COUNTERS_PASS(name) ((void)0)
+#endif
+
+#endif // GLCOUNTERS_H
@@ -0,0 +1,353 @@
+#include "gldiag.h"
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLDebugLogger>
+#include <QOpenGLFunctions>
+#include <QSurfaceFormat>
+#include <atomic>
+#include <cstring>
+
+#ifndef GL_DEBUG_SOURCE_APPLICATION
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#endif
+
+namespace gldiag {
+
+namespace {
+
+// ------------------- Message Ring -------------------
+
+struct Message {
+    Severity severity = Severity::Notification;
+    QOpenGLDebugMessage::Source source = QOpenGLDebugMessage::InvalidSource;
+    QOpenGLDebugMessage::Type type = QOpenGLDebugMessage::InvalidType;
+    GLuint id = 0;
+    char text[240] = {};
+};
+
+// Bounded multi-producer ring (sequence number per slot): the driver may call
+// back from several threads at once, and a full ring drops instead of blocking
+class MessageRing
+{
+public:
+    static constexpr quint32 Capacity = 256;   // Power of two
+
+    MessageRing()
+    {
+        for (quint32 i = 0; i < Capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(const Message &message)
+    {
+        quint32 position = head.load(std::memory_order_relaxed);
+        Slot *slot = nullptr;
+        for (;;) {
+            slot = &slots[position & (Capacity - 1)];
+            const quint32 sequence = slot->sequence.load(std::memory_order_acquire);
+            const qint32 difference = qint32(sequence - position);
+            if (difference == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+        slot->message = message;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Single consumer: the thread calling drain()
+    bool pop(Message *message)
+    {
+        Slot &slot = slots[tail & (Capacity - 1)];
+        if (qint32(slot.sequence.load(std::memory_order_acquire) - (tail + 1)) < 0) {
+            return false;
+        }
+        *message = slot.message;
+        slot.sequence.store(tail + Capacity, std::memory_order_release);
+        ++tail;
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<quint32> sequence{ 0 };
+        Message message;
+    };
+
+    Slot slots[Capacity];
+    std::atomic<quint32> head{ 0 };
+    quint32 tail = 0;
+};
+
+typedef void (QOPENGLF_APIENTRYP ObjectLabelFunction)(GLenum identifier, GLuint name, GLsizei length,
+                                                      const char *label);
+typedef void (QOPENGLF_APIENTRYP PushDebugGroupFunction)(GLenum source, GLuint id, GLsizei length,
+                                                         const char *message);
+typedef void (QOPENGLF_APIENTRYP PopDebugGroupFunction)();
+
+struct State {
+    QOpenGLDebugLogger *logger = nullptr;
+    QOpenGLContext *context = nullptr;
+    ObjectLabelFunction objectLabel = nullptr;
+    PushDebugGroupFunction pushDebugGroup = nullptr;
+    PopDebugGroupFunction popDebugGroup = nullptr;
+
+    MessageRing ring;
+    std::atomic<quint64> received{ 0 };
+    std::atomic<quint64> dropped{ 0 };
+    quint64 logged = 0;
+    quint64 bySeverity[4] = {};
+    quint64 polledErrors = 0;
+};
+
+State state;
+
+Severity severityOf(QOpenGLDebugMessage::Severity severity)
+{
+    switch (severity) {
+    case QOpenGLDebugMessage::HighSeverity:
+        return Severity::High;
+    case QOpenGLDebugMessage::MediumSeverity:
+        return Severity::Medium;
+    case QOpenGLDebugMessage::LowSeverity:
+        return Severity::Low;
+    default:
+        return Severity::Notification;
+    }
+}
+
+const char *severityName(Severity severity)
+{
+    static const char *names[] = { "note", "low", "medium", "high" };
+    return names[int(severity)];
+}
+
+const char *sourceName(QOpenGLDebugMessage::Source source)
+{
+    switch (source) {
+    case QOpenGLDebugMessage::APISource: return "api";
+    case QOpenGLDebugMessage::WindowSystemSource: return "window system";
+    case QOpenGLDebugMessage::ShaderCompilerSource: return "shader compiler";
+    case QOpenGLDebugMessage::ThirdPartySource: return "third party";
+    case QOpenGLDebugMessage::ApplicationSource: return "application";
+    default: return "other";
+    }
+}
+
+const char *typeName(QOpenGLDebugMessage::Type type)
+{
+    switch (type) {
+    case QOpenGLDebugMessage::ErrorType: return "error";
+    case QOpenGLDebugMessage::DeprecatedBehaviorType: return "deprecated";
+    case QOpenGLDebugMessage::UndefinedBehaviorType: return "undefined behavior";
+    case QOpenGLDebugMessage::PortabilityType: return "portability";
+    case QOpenGLDebugMessage::PerformanceType: return "performance";
+    case QOpenGLDebugMessage::MarkerType: return "marker";
+    default: return "other";
+    }
+}
+
+// Runs on whichever thread the driver reports from: copy and return
+void enqueue(const QOpenGLDebugMessage &debugMessage)
+{
+    Message message;
+    message.severity = severityOf(debugMessage.severity());
+    message.source = debugMessage.source();
+    message.type = debugMessage.type();
+    message.id = debugMessage.id();
+    const QByteArray text = debugMessage.message().toUtf8();
+    const size_t length = qMin(size_t(text.size()), sizeof(message.text) - 1);
+    std::memcpy(message.text, text.constData(), length);
+    message.text[length] = '\0';
+
+    if (state.ring.push(message)) {
+        state.received.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        state.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+// ------------------- Setup -------------------
+
+void requestDebugContext()
+{
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setOption(QSurfaceFormat::DebugContext);
+    QSurfaceFormat::setDefaultFormat(format);
+}
+
+bool attach(QOpenGLContext *context, Severity minimum)
+{
+    detach();
+    if (!context) {
+        return false;
+    }
+    state.context = context;
+
+    // Labels and groups work with KHR_debug even when the context is not a debug context
+    if (context->hasExtension("GL_KHR_debug") || context->format().version() >= qMakePair(4, 3)) {
+        const bool es = context->isOpenGLES();
+        state.objectLabel = reinterpret_cast<ObjectLabelFunction>(
+            context->getProcAddress(es ? "glObjectLabelKHR" : "glObjectLabel"));
+        state.pushDebugGroup = reinterpret_cast<PushDebugGroupFunction>(
+            context->getProcAddress(es ? "glPushDebugGroupKHR" : "glPushDebugGroup"));
+        state.popDebugGroup = reinterpret_cast<PopDebugGroupFunction>(
+            context->getProcAddress(es ? "glPopDebugGroupKHR" : "glPopDebugGroup"));
+        if (!state.pushDebugGroup || !state.popDebugGroup) {
+            state.pushDebugGroup = nullptr;
+            state.popDebugGroup = nullptr;
+        }
+    }
+
+    state.logger = new QOpenGLDebugLogger;
+    if (!state.logger->initialize()) {
+        qWarning() << "gldiag: no debug context or KHR_debug, falling back to glGetError() checks";
+        delete state.logger;
+        state.logger = nullptr;
+        return false;
+    }
+
+    // Filter in the driver: disabled messages are never generated, let alone queued
+    QOpenGLDebugMessage::Severities below;
+    if (minimum > Severity::Notification) {
+        below |= QOpenGLDebugMessage::NotificationSeverity;
+    }
+    if (minimum > Severity::Low) {
+        below |= QOpenGLDebugMessage::LowSeverity;
+    }
+    if (minimum > Severity::Medium) {
+        below |= QOpenGLDebugMessage::MediumSeverity;
+    }
+    if (below) {
+        state.logger->disableMessages(QOpenGLDebugMessage::AnySource, QOpenGLDebugMessage::AnyType, below);
+    }
+    state.logger->disableMessages(QOpenGLDebugMessage::AnySource,
+                                  QOpenGLDebugMessage::GroupPushType | QOpenGLDebugMessage::GroupPopType);
+
+    QObject::connect(state.logger, &QOpenGLDebugLogger::messageLogged, state.logger, &enqueue,
+                     Qt::DirectConnection);
+    state.logger->startLogging(QOpenGLDebugLogger::AsynchronousLogging);
+    qDebug() << "gldiag: KHR_debug logging from" << severityName(minimum) << "severity";
+    return true;
+}
+
+void detach()
+{
+    if (state.logger) {
+        state.logger->stopLogging();
+        delete state.logger;
+        state.logger = nullptr;
+    }
+    drain();
+    state.context = nullptr;
+    state.objectLabel = nullptr;
+    state.pushDebugGroup = nullptr;
+    state.popDebugGroup = nullptr;
+}
+
+// ------------------- Per Frame -------------------
+
+int drain()
+{
+    int count = 0;
+    Message message;
+    while (state.ring.pop(&message)) {
+        ++count;
+        ++state.logged;
+        ++state.bySeverity[int(message.severity)];
+        const QString line = QString("GL %1 %2 %3 #%4: %5")
+                                 .arg(QLatin1String(severityName(message.severity)),
+                                      QLatin1String(sourceName(message.source)), QLatin1String(typeName(message.type)))
+                                 .arg(message.id)
+                                 .arg(QString::fromUtf8(message.text));
+        if (message.severity >= Severity::Medium) {
+            qWarning().noquote() << line;
+        } else {
+            qDebug().noquote() << line;
+        }
+    }
+    return count;
+}
+
+void label(GLenum identifier, GLuint name, const char *text)
+{
+    if (state.objectLabel && name != 0) {
+        state.objectLabel(identifier, name, -1, text);
+    }
+}
+
+void pushGroup(const char *name)
+{
+    if (state.pushDebugGroup) {
+        state.pushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    }
+}
+
+void popGroup()
+{
+    if (state.popDebugGroup) {
+        state.popDebugGroup();
+    }
+}
+
+void checkError(const char *where)
+{
+    if (state.logger) {
+        return;
+    }
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context) {
+        return;
+    }
+    QOpenGLFunctions *gl = context->functions();
+    // Bounded: a lost context can report errors forever
+    for (int i = 0; i < 8; ++i) {
+        const GLenum error = gl->glGetError();
+        if (error == GL_NO_ERROR) {
+            break;
+        }
+        ++state.polledErrors;
+        qWarning().noquote() << QString("GL error 0x%1 after %2").arg(error, 4, 16, QChar('0')).arg(where);
+    }
+}
+
+// ------------------- Statistics -------------------
+
+Stats stats()
+{
+    Stats s;
+    s.received = state.received.load(std::memory_order_relaxed);
+    s.dropped = state.dropped.load(std::memory_order_relaxed);
+    s.logged = state.logged;
+    for (int i = 0; i < 4; ++i) {
+        s.bySeverity[i] = state.bySeverity[i];
+    }
+    s.polledErrors = state.polledErrors;
+    s.active = state.logger != nullptr;
+    return s;
+}
+
+QString report()
+{
+    const Stats s = stats();
+    return QString("gldiag: %1, %2 messages (%3 high, %4 medium, %5 low, %6 notes), %7 dropped, %8 polled errors")
+        .arg(QLatin1String(s.active ? "KHR_debug" : "glGetError fallback"))
+        .arg(s.logged)
+        .arg(s.bySeverity[int(Severity::High)])
+        .arg(s.bySeverity[int(Severity::Medium)])
+        .arg(s.bySeverity[int(Severity::Low)])
+        .arg(s.bySeverity[int(Severity::Notification)])
+        .arg(s.dropped)
+        .arg(s.polledErrors);
+}
+
+} // namespace gldiag
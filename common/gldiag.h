@@ -0,0 +1,133 @@
+#ifndef GLDIAG_H
+#define GLDIAG_H
+
+#include <qopengl.h>
+#include <QString>
+#include <QtGlobal>
+
+class QOpenGLContext;
+
+// ------------------- GL Diagnostics -------------------
+//
+// KHR_debug based error reporting in place of glGetError() polling. The
+// driver reports errors, performance warnings and the like through
+// QOpenGLDebugLogger in asynchronous mode, possibly on its own threads; the
+// callback only copies the message into a fixed-size lock-free ring. drain(),
+// called once per frame on the GUI thread, prints what arrived. Messages below
+// the minimum severity are disabled in the driver, so they are never produced.
+//
+// Object labels and debug groups name the buffers, programs and passes in the
+// messages and in tools such as RenderDoc or apitrace.
+//
+// Every GL_DIAG_* macro expands to nothing unless GL_DIAGNOSTICS_ENABLED is
+// defined (the stage CMakeLists define it for non-Release builds, or always
+// with -DGL_DIAGNOSTICS=ON), so Release builds carry no per-frame error
+// checks, groups or logging. GL_DIAG_TRACE is qDebug() in diagnostics builds
+// and a no-op stream otherwise, for logging in the render path.
+//
+// Without a debug context or KHR_debug (e.g. macOS), GL_DIAG_CHECK falls back
+// to glGetError() in diagnostics builds.
+
+#ifndef GL_BUFFER
+#define GL_BUFFER 0x82E0
+#endif
+#ifndef GL_SHADER
+#define GL_SHADER 0x82E1
+#endif
+#ifndef GL_PROGRAM
+#define GL_PROGRAM 0x82E2
+#endif
+#ifndef GL_VERTEX_ARRAY
+#define GL_VERTEX_ARRAY 0x8074
+#endif
+
+namespace gldiag {
+
+enum class Severity {
+    Notification,
+    Low,
+    Medium,
+    High
+};
+
+struct Stats {
+    quint64 received = 0;             // Entered the ring
+    quint64 dropped = 0;              // Ring full
+    quint64 logged = 0;
+    quint64 bySeverity[4] = {};
+    quint64 polledErrors = 0;         // Found by the glGetError() fallback
+    bool active = false;              // Logger running
+};
+
+/**
+ * @brief Asks for debug contexts; call before the first context is created.
+ */
+void requestDebugContext();
+
+/**
+ * @brief Starts asynchronous logging on @p context, which must be current.
+ * @return false without a debug context or KHR_debug; GL_DIAG_CHECK then polls glGetError().
+ */
+bool attach(QOpenGLContext *context, Severity minimum = Severity::Low);
+/**
+ * @brief Stops logging and prints what is still queued; call with the context current.
+ */
+void detach();
+
+/**
+ * @brief Prints the queued messages on the calling thread.
+ * @return Number of messages printed.
+ */
+int drain();
+
+/**
+ * @brief Names a GL object (GL_BUFFER, GL_PROGRAM, GL_VERTEX_ARRAY, GL_TEXTURE, ...).
+ */
+void label(GLenum identifier, GLuint name, const char *text);
+void pushGroup(const char *name);
+void popGroup();
+/**
+ * @brief glGetError() after @p where, only when no logger is running.
+ */
+void checkError(const char *where);
+
+Stats stats();
+QString report();
+
+struct GroupScope {
+    explicit GroupScope(const char *name) { pushGroup(name); }
+    ~GroupScope() { popGroup(); }
+    GroupScope(const GroupScope &) = delete;
+    GroupScope &operator=(const GroupScope &) = delete;
+};
+
+} // namespace gldiag
+
+#ifdef GL_DIAGNOSTICS_ENABLED
+#define GL_DIAG_CONCAT_(a, b) a##b
+#define GL_DIAG_CONCAT(a, b) GL_DIAG_CONCAT_(a, b)
+
+#define GL_DIAG_REQUEST_CONTEXT() gldiag::requestDebugContext()
+#define GL_DIAG_ATTACH(context) gldiag::attach(context)
+#define GL_DIAG_DETACH() gldiag::detach()
+#define GL_DIAG_DRAIN() gldiag::drain()
+#define GL_DIAG_LABEL(identifier, name, text) gldiag::label((identifier), (name), (text))
+#define GL_DIAG_PUSH_GROUP(name) gldiag::pushGroup(name)
+#define GL_DIAG_POP_GROUP() gldiag::popGroup()
+#define GL_DIAG_GROUP(name) gldiag::GroupScope GL_DIAG_CONCAT(glDiagGroup_, __LINE__)(name)
+#define GL_DIAG_CHECK(where) gldiag::checkError(where)
+#define GL_DIAG_TRACE qDebug
+#else
+#define GL_DIAG_REQUEST_CONTEXT() ((void)0)
+#define GL_DIAG_ATTACH(context) ((void)0)
+#define GL_DIAG_DETACH() ((void)0)
+#define GL_DIAG_DRAIN() ((void)0)
+#define GL_DIAG_LABEL(identifier, name, text) ((void)0)
+#define GL_DIAG_PUSH_GROUP(name) ((void)0)
+#define GL_DIAG_POP_GROUP() ((void)0)
+#define GL_DIAG_GROUP(name) ((void)0)
+#define GL_DIAG_CHECK(where) ((void)0)
+#define GL_DIAG_TRACE QT_NO_QDEBUG_MACRO
+#endif
+
+#endif // GLDIAG_H
@@ -0,0 +1,550 @@
+#include "gltrace.h"
+#include "glcounters.h"
+#include <QDebug>
+#include <QFile>
+#include <QImage>
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+
+using gltrace::Op;
+
+GLTraceFunctions::~GLTraceFunctions()
+{
+    // A trace cut short (window closed early) is still written with the frames it has
+    if (tracing) {
+        closeTrace();
+    }
+}
+
+// ------------------- Recording Control -------------------
+
+bool GLTraceFunctions::startTrace(const QString &filePath, int frames)
+{
+    if (frames <= 0) {
+        return false;
+    }
+
+    tracePath = filePath;
+    framesRemaining = frames;
+    framesRecorded = 0;
+    strings.clear();
+    stream.clear();
+
+    gltrace::TraceHeader header;
+    stream.append(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    tracing = true;
+    qDebug() << "GLTrace: recording setup and" << frames << "frames to" << filePath;
+    return true;
+}
+
+void GLTraceFunctions::traceFrameBegin(int width, int height)
+{
+    if (!tracing) {
+        return;
+    }
+    frameStart = stream.size();
+    op(Op::FrameBegin);
+    put<quint32>(framesRecorded);
+    put<qint32>(width);
+    put<qint32>(height);
+    inFrame = true;
+}
+
+void GLTraceFunctions::traceFrameEnd()
+{
+    if (!tracing || !inFrame) {
+        return;
+    }
+    op(Op::FrameEnd);
+    inFrame = false;
+    ++framesRecorded;
+    if (--framesRemaining == 0) {
+        closeTrace();
+    }
+}
+
+void GLTraceFunctions::closeTrace()
+{
+    if (inFrame) {
+        // Drop the partial frame: replaying half a frame would skew the timings
+        stream.truncate(frameStart);
+        inFrame = false;
+    }
+    op(Op::End);
+
+    auto *header = reinterpret_cast<gltrace::TraceHeader *>(stream.data());
+    header->frameCount = framesRecorded;
+
+    QFile file(tracePath);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(stream) == stream.size()) {
+        qDebug() << "GLTrace: wrote" << framesRecorded << "frames," << stream.size() << "bytes to" << tracePath;
+    } else {
+        qWarning() << "GLTrace: failed to write" << tracePath;
+    }
+
+    tracing = false;
+    stream.clear();
+    stream.squeeze();
+}
+
+// ------------------- Stream Encoding -------------------
+
+void GLTraceFunctions::op(Op code)
+{
+    stream.append(char(code));
+}
+
+template <typename T>
+void GLTraceFunctions::put(T value)
+{
+    stream.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void GLTraceFunctions::putBlob(const void *data, qsizetype size)
+{
+    put<quint32>(quint32(size));
+    if (data) {
+        stream.append(static_cast<const char *>(data), size);
+    } else {
+        stream.append(size, '\0');
+    }
+}
+
+quint32 GLTraceFunctions::internString(const QByteArray &text)
+{
+    auto it = strings.constFind(text);
+    if (it != strings.constEnd()) {
+        return it.value();
+    }
+    const quint32 id = quint32(strings.size());
+    strings.insert(text, id);
+    op(Op::String);
+    put<quint32>(id);
+    putBlob(text.constData(), text.size());
+    return id;
+}
+
+// ------------------- Raw GL Entry Points -------------------
+
+void GLTraceFunctions::glBindBuffer(GLenum target, GLuint buffer)
+{
+    QOpenGLFunctions_3_3_Core::glBindBuffer(target, buffer);
+    GL_COUNT_BUFFER_BIND();
+    if (tracing) {
+        op(Op::BindBuffer);
+        put<quint32>(target);
+        put<quint32>(buffer);
+    }
+}
+
+void GLTraceFunctions::glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    QOpenGLFunctions_3_3_Core::glBufferData(target, size, data, usage);
+    GL_COUNT_UPLOAD(size);
+    if (tracing) {
+        op(Op::BufferData);
+        put<quint32>(target);
+        put<quint32>(usage);
+        putBlob(data, size);
+    }
+}
+
+void GLTraceFunctions::glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+    QOpenGLFunctions_3_3_Core::glBufferSubData(target, offset, size, data);
+    GL_COUNT_UPLOAD(size);
+    if (tracing) {
+        op(Op::BufferSubData);
+        put<quint32>(target);
+        put<quint64>(quint64(offset));
+        putBlob(data, size);
+    }
+}
+
+void GLTraceFunctions::glBindVertexArray(GLuint array)
+{
+    QOpenGLFunctions_3_3_Core::glBindVertexArray(array);
+    GL_COUNT_VAO_BIND();
+    if (tracing) {
+        op(Op::BindVertexArray);
+        put<quint32>(array);
+    }
+}
+
+void GLTraceFunctions::glEnableVertexAttribArray(GLuint index)
+{
+    QOpenGLFunctions_3_3_Core::glEnableVertexAttribArray(index);
+    if (tracing) {
+        op(Op::EnableVertexAttribArray);
+        put<quint32>(index);
+    }
+}
+
+void GLTraceFunctions::glDisableVertexAttribArray(GLuint index)
+{
+    QOpenGLFunctions_3_3_Core::glDisableVertexAttribArray(index);
+    if (tracing) {
+        op(Op::DisableVertexAttribArray);
+        put<quint32>(index);
+    }
+}
+
+void GLTraceFunctions::glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                             GLsizei stride, const void *pointer)
+{
+    QOpenGLFunctions_3_3_Core::glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    if (tracing) {
+        op(Op::VertexAttribPointer);
+        put<quint32>(index);
+        put<qint32>(size);
+        put<quint32>(type);
+        put<quint8>(normalized ? 1 : 0);
+        put<qint32>(stride);
+        put<quint64>(quint64(reinterpret_cast<quintptr>(pointer)));
+    }
+}
+
+void GLTraceFunctions::glActiveTexture(GLenum texture)
+{
+    QOpenGLFunctions_3_3_Core::glActiveTexture(texture);
+    if (tracing) {
+        op(Op::ActiveTexture);
+        put<quint32>(texture);
+    }
+}
+
+void GLTraceFunctions::glBindTexture(GLenum target, GLuint texture)
+{
+    QOpenGLFunctions_3_3_Core::glBindTexture(target, texture);
+    GL_COUNT_TEXTURE_BIND();
+    if (tracing) {
+        op(Op::BindTexture);
+        put<quint32>(target);
+        put<quint32>(texture);
+    }
+}
+
+void GLTraceFunctions::glTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+    QOpenGLFunctions_3_3_Core::glTexParameteri(target, pname, param);
+    if (tracing) {
+        op(Op::TexParameteri);
+        put<quint32>(target);
+        put<quint32>(pname);
+        put<qint32>(param);
+    }
+}
+
+void GLTraceFunctions::glGenerateMipmap(GLenum target)
+{
+    QOpenGLFunctions_3_3_Core::glGenerateMipmap(target);
+    if (tracing) {
+        op(Op::GenerateMipmap);
+        put<quint32>(target);
+    }
+}
+
+void GLTraceFunctions::glUseProgram(GLuint program)
+{
+    QOpenGLFunctions_3_3_Core::glUseProgram(program);
+    GL_COUNT_PROGRAM_BIND();
+    if (tracing) {
+        op(Op::UseProgram);
+        put<quint32>(program);
+    }
+}
+
+void GLTraceFunctions::glEnable(GLenum cap)
+{
+    QOpenGLFunctions_3_3_Core::glEnable(cap);
+    if (tracing) {
+        op(Op::Enable);
+        put<quint32>(cap);
+    }
+}
+
+void GLTraceFunctions::glDisable(GLenum cap)
+{
+    QOpenGLFunctions_3_3_Core::glDisable(cap);
+    if (tracing) {
+        op(Op::Disable);
+        put<quint32>(cap);
+    }
+}
+
+void GLTraceFunctions::glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    QOpenGLFunctions_3_3_Core::glClearColor(red, green, blue, alpha);
+    if (tracing) {
+        op(Op::ClearColor);
+        put<float>(red);
+        put<float>(green);
+        put<float>(blue);
+        put<float>(alpha);
+    }
+}
+
+void GLTraceFunctions::glClear(GLbitfield mask)
+{
+    QOpenGLFunctions_3_3_Core::glClear(mask);
+    if (tracing) {
+        op(Op::Clear);
+        put<quint32>(mask);
+    }
+}
+
+void GLTraceFunctions::glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    QOpenGLFunctions_3_3_Core::glViewport(x, y, width, height);
+    if (tracing) {
+        op(Op::Viewport);
+        put<qint32>(x);
+        put<qint32>(y);
+        put<qint32>(width);
+        put<qint32>(height);
+    }
+}
+
+void GLTraceFunctions::glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    QOpenGLFunctions_3_3_Core::glDrawArrays(mode, first, count);
+    GL_COUNT_DRAW(mode, count);
+    if (tracing) {
+        op(Op::DrawArrays);
+        put<quint32>(mode);
+        put<qint32>(first);
+        put<qint32>(count);
+    }
+}
+
+void GLTraceFunctions::glDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+    QOpenGLFunctions_3_3_Core::glDrawElements(mode, count, type, indices);
+    GL_COUNT_DRAW(mode, count);
+    if (tracing) {
+        op(Op::DrawElements);
+        put<quint32>(mode);
+        put<qint32>(count);
+        put<quint32>(type);
+        put<quint64>(quint64(reinterpret_cast<quintptr>(indices)));
+    }
+}
+
+// ------------------- Qt Wrapper Calls -------------------
+
+void GLTraceFunctions::traceProgram(QOpenGLShaderProgram *program)
+{
+    if (!tracing || !program) {
+        return;
+    }
+
+    QByteArray vertexSource;
+    QByteArray fragmentSource;
+    const auto shaders = program->shaders();
+    for (const QOpenGLShader *shader : shaders) {
+        if (shader->shaderType() & QOpenGLShader::Vertex) {
+            vertexSource = shader->sourceCode();
+        } else if (shader->shaderType() & QOpenGLShader::Fragment) {
+            fragmentSource = shader->sourceCode();
+        }
+    }
+
+    op(Op::Program);
+    put<quint32>(program->programId());
+    putBlob(vertexSource.constData(), vertexSource.size());
+    putBlob(fragmentSource.constData(), fragmentSource.size());
+}
+
+void GLTraceFunctions::tracedBind(QOpenGLShaderProgram *program)
+{
+    program->bind();
+    GL_COUNT_PROGRAM_BIND();
+    if (tracing) {
+        op(Op::UseProgram);
+        put<quint32>(program->programId());
+    }
+}
+
+void GLTraceFunctions::tracedRelease(QOpenGLShaderProgram *program)
+{
+    program->release();
+    if (tracing) {
+        op(Op::UseProgram);
+        put<quint32>(0);
+    }
+}
+
+void GLTraceFunctions::tracedSetUniformValue(QOpenGLShaderProgram *program, const char *name, const QMatrix4x4 &value)
+{
+    program->setUniformValue(name, value);
+    GL_COUNT_UNIFORM();
+    if (tracing) {
+        const quint32 id = internString(name);
+        op(Op::UniformMatrix4fv);
+        put<quint32>(id);
+        stream.append(reinterpret_cast<const char *>(value.constData()), 16 * sizeof(float));
+    }
+}
+
+void GLTraceFunctions::tracedSetUniformValue(QOpenGLShaderProgram *program, const char *name, GLint value)
+{
+    program->setUniformValue(name, value);
+    GL_COUNT_UNIFORM();
+    if (tracing) {
+        const quint32 id = internString(name);
+        op(Op::Uniform1i);
+        put<quint32>(id);
+        put<qint32>(value);
+    }
+}
+
+void GLTraceFunctions::tracedSetUniformValue(QOpenGLShaderProgram *program, const char *name, GLfloat value)
+{
+    program->setUniformValue(name, value);
+    GL_COUNT_UNIFORM();
+    if (tracing) {
+        const quint32 id = internString(name);
+        op(Op::Uniform1f);
+        put<quint32>(id);
+        put<float>(value);
+    }
+}
+
+void GLTraceFunctions::tracedBind(QOpenGLVertexArrayObject &vao)
+{
+    vao.bind();
+    GL_COUNT_VAO_BIND();
+    if (tracing) {
+        op(Op::BindVertexArray);
+        put<quint32>(vao.objectId());
+    }
+}
+
+void GLTraceFunctions::tracedRelease(QOpenGLVertexArrayObject &vao)
+{
+    vao.release();
+    if (tracing) {
+        op(Op::BindVertexArray);
+        put<quint32>(0);
+    }
+}
+
+void GLTraceFunctions::tracedBind(QOpenGLBuffer &buffer)
+{
+    buffer.bind();
+    GL_COUNT_BUFFER_BIND();
+    if (tracing) {
+        op(Op::BindBuffer);
+        put<quint32>(quint32(buffer.type()));
+        put<quint32>(buffer.bufferId());
+    }
+}
+
+void GLTraceFunctions::tracedRelease(QOpenGLBuffer &buffer)
+{
+    buffer.release();
+    if (tracing) {
+        op(Op::BindBuffer);
+        put<quint32>(quint32(buffer.type()));
+        put<quint32>(0);
+    }
+}
+
+void GLTraceFunctions::tracedAllocate(QOpenGLBuffer &buffer, const void *data, int count)
+{
+    buffer.allocate(data, count);
+    GL_COUNT_UPLOAD(count);
+    if (tracing) {
+        op(Op::BufferData);
+        put<quint32>(quint32(buffer.type()));
+        put<quint32>(quint32(buffer.usagePattern()));
+        putBlob(data, count);
+    }
+}
+
+void GLTraceFunctions::tracedBind(QOpenGLTexture *texture)
+{
+    texture->bind();
+    GL_COUNT_TEXTURE_BIND();
+    if (tracing) {
+        op(Op::BindTexture);
+        put<quint32>(quint32(texture->target()));
+        put<quint32>(texture->textureId());
+    }
+}
+
+void GLTraceFunctions::tracedRelease(QOpenGLTexture *texture)
+{
+    texture->release();
+    if (tracing) {
+        op(Op::BindTexture);
+        put<quint32>(quint32(texture->target()));
+        put<quint32>(0);
+    }
+}
+
+void GLTraceFunctions::traceTexture(QOpenGLTexture *texture, const QImage &image)
+{
+    if (!tracing || !texture) {
+        return;
+    }
+    recordTexture(texture->textureId(), image, GLint(texture->minificationFilter()),
+                  GLint(texture->magnificationFilter()), GLint(texture->wrapMode(QOpenGLTexture::DirectionS)),
+                  GLint(texture->wrapMode(QOpenGLTexture::DirectionT)), texture->mipLevels() > 1);
+}
+
+void GLTraceFunctions::traceTexture(GLuint texture, const QImage &image, bool mipmapped)
+{
+    if (!tracing || texture == 0) {
+        return;
+    }
+    // Same parameters as TextureUploader::createTexture()
+    recordTexture(texture, image, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR, GL_LINEAR,
+                  GL_REPEAT, GL_REPEAT, mipmapped);
+}
+
+void GLTraceFunctions::recordTexture(GLuint texture, const QImage &image, GLint minFilter, GLint magFilter,
+                                     GLint wrapS, GLint wrapT, bool mipmapped)
+{
+    // The pixels are stored as RGBA8888 whatever layout the live upload used
+    const QImage pixels = image.convertToFormat(QImage::Format_RGBA8888);
+    const quint32 target = GL_TEXTURE_2D;
+
+    op(Op::BindTexture);
+    put<quint32>(target);
+    put<quint32>(texture);
+
+    op(Op::TexImage2D);
+    put<quint32>(target);
+    put<qint32>(0);
+    put<qint32>(GL_RGBA8);
+    put<qint32>(pixels.width());
+    put<qint32>(pixels.height());
+    put<quint32>(GL_RGBA);
+    put<quint32>(GL_UNSIGNED_BYTE);
+    putBlob(pixels.constBits(), pixels.sizeInBytes());
+
+    const auto parameter = [this, target](GLenum pname, GLint value) {
+        op(Op::TexParameteri);
+        put<quint32>(target);
+        put<quint32>(pname);
+        put<qint32>(value);
+    };
+    parameter(GL_TEXTURE_MIN_FILTER, minFilter);
+    parameter(GL_TEXTURE_MAG_FILTER, magFilter);
+    parameter(GL_TEXTURE_WRAP_S, wrapS);
+    parameter(GL_TEXTURE_WRAP_T, wrapT);
+
+    if (mipmapped) {
+        op(Op::GenerateMipmap);
+        put<quint32>(target);
+    }
+
+    op(Op::BindTexture);
+    put<quint32>(target);
+    put<quint32>(0);
+}
@@ -0,0 +1,118 @@
+#ifndef GLTRACE_H
+#define GLTRACE_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include "gltraceformat.h"
+
+class QImage;
+class QMatrix4x4;
+class QOpenGLBuffer;
+class QOpenGLShaderProgram;
+class QOpenGLTexture;
+class QOpenGLVertexArrayObject;
+
+/**
+ * @brief QOpenGLFunctions_3_3_Core with an optional command recorder.
+ *
+ * Deriving from this class instead of QOpenGLFunctions_3_3_Core makes the
+ * GL entry points a stage actually uses (draws, binds, buffer uploads, state
+ * changes) record themselves into a binary trace while startTrace() is active.
+ * The overrides hide the base functions, so call sites stay plain glXxx().
+ *
+ * Calls that go through Qt wrappers (QOpenGLShaderProgram, QOpenGLBuffer,
+ * QOpenGLVertexArrayObject, QOpenGLTexture) cannot be intercepted; use the
+ * traced*() helpers for those, which perform the Qt call and record what it
+ * did in GL terms.
+ *
+ * Each override also feeds the GL_COUNT_* counters (glcounters.h), which
+ * compile away when GL_COUNTERS_ENABLED is not defined.
+ *
+ * When no trace is active every override is a single branch plus the GL call.
+ * The trace is replayed headless by tools/glreplay.
+ */
+class GLTraceFunctions : public QOpenGLFunctions_3_3_Core
+{
+public:
+    GLTraceFunctions() = default;
+    ~GLTraceFunctions();
+
+    /**
+     * @brief Starts recording. Call right after initializeOpenGLFunctions() so resource setup is captured.
+     * @param filePath Output trace file.
+     * @param frames Number of frames to record after setup; the file is closed after the last one.
+     */
+    bool startTrace(const QString &filePath, int frames);
+    bool isTracing() const { return tracing; }
+
+    void traceFrameBegin(int width, int height);
+    void traceFrameEnd();
+
+    // ---- Raw GL entry points (hide the QOpenGLFunctions_3_3_Core versions) ----
+    void glBindBuffer(GLenum target, GLuint buffer);
+    void glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+    void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+    void glBindVertexArray(GLuint array);
+    void glEnableVertexAttribArray(GLuint index);
+    void glDisableVertexAttribArray(GLuint index);
+    void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                               GLsizei stride, const void *pointer);
+    void glActiveTexture(GLenum texture);
+    void glBindTexture(GLenum target, GLuint texture);
+    void glTexParameteri(GLenum target, GLenum pname, GLint param);
+    void glGenerateMipmap(GLenum target);
+    void glUseProgram(GLuint program);
+    void glEnable(GLenum cap);
+    void glDisable(GLenum cap);
+    void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+    void glClear(GLbitfield mask);
+    void glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void glDrawArrays(GLenum mode, GLint first, GLsizei count);
+    void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices);
+
+    // ---- Qt wrapper calls ----
+    void traceProgram(QOpenGLShaderProgram *program); // Call once after link()
+    void tracedBind(QOpenGLShaderProgram *program);
+    void tracedRelease(QOpenGLShaderProgram *program);
+    void tracedSetUniformValue(QOpenGLShaderProgram *program, const char *name, const QMatrix4x4 &value);
+    void tracedSetUniformValue(QOpenGLShaderProgram *program, const char *name, GLint value);
+    void tracedSetUniformValue(QOpenGLShaderProgram *program, const char *name, GLfloat value);
+    void tracedBind(QOpenGLVertexArrayObject &vao);
+    void tracedRelease(QOpenGLVertexArrayObject &vao);
+    void tracedBind(QOpenGLBuffer &buffer);
+    void tracedRelease(QOpenGLBuffer &buffer);
+    void tracedAllocate(QOpenGLBuffer &buffer, const void *data, int count);
+    void tracedBind(QOpenGLTexture *texture);
+    void tracedRelease(QOpenGLTexture *texture);
+    /**
+     * @brief Records a QOpenGLTexture that was filled with setData(image) and fully configured.
+     * @param image The image exactly as passed to setData() (converted to RGBA8888 for the trace).
+     */
+    void traceTexture(QOpenGLTexture *texture, const QImage &image);
+    /**
+     * @brief Records a texture created by TextureUploader from @p image (top row first).
+     */
+    void traceTexture(GLuint texture, const QImage &image, bool mipmapped);
+
+private:
+    void recordTexture(GLuint texture, const QImage &image, GLint minFilter, GLint magFilter,
+                       GLint wrapS, GLint wrapT, bool mipmapped);
+    void op(gltrace::Op code);
+    template <typename T> void put(T value);
+    void putBlob(const void *data, qsizetype size);
+    quint32 internString(const QByteArray &text);
+    void closeTrace();
+
+    bool tracing = false;
+    bool inFrame = false;
+    QString tracePath;
+    QByteArray stream;          // Whole trace is kept in memory and written on close
+    qsizetype frameStart = 0;   // Offset of the current FrameBegin record
+    int framesRemaining = 0;
+    quint32 framesRecorded = 0;
+    QHash<QByteArray, quint32> strings;
+};
+
+#endif // GLTRACE_H
@@ -0,0 +1,72 @@
+#ifndef GLTRACEFORMAT_H
+#define GLTRACEFORMAT_H
+
+#include <QtGlobal>
+
+// ------------------- Binary GL Trace Format -------------------
+//
+// File layout (little endian):
+//   TraceHeader
+//   setup records ...            (everything issued before the first FrameBegin)
+//   FrameBegin, records ..., FrameEnd   (repeated frameCount times)
+//   End
+//
+// Every record starts with a one-byte GLTraceOp followed by its fixed fields.
+// Variable-length payloads (buffer/texture data, strings) are a u32 byte count
+// followed by the bytes. Object names (buffers, textures, VAOs, programs) are
+// the ids seen at record time; the replayer creates its own objects the first
+// time an id appears and translates from then on.
+
+namespace gltrace {
+
+constexpr quint32 Magic = 0x52544c47;   // "GLTR"
+constexpr quint32 Version = 1;
+
+struct TraceHeader {
+    quint32 magic = Magic;
+    quint32 version = Version;
+    quint32 frameCount = 0;   // Patched when the recorder closes the file
+    quint32 reserved = 0;
+};
+
+enum class Op : quint8 {
+    End = 0,
+    FrameBegin,               // u32 frame, i32 width, i32 height
+    FrameEnd,
+
+    String,                   // u32 id, blob text           (interned uniform / attribute names)
+    Program,                  // u32 program, blob vertexSrc, blob fragmentSrc (compiled + linked on replay)
+    UseProgram,               // u32 program
+    Uniform1i,                // u32 nameId, i32 value
+    Uniform1f,                // u32 nameId, f32 value
+    Uniform4f,                // u32 nameId, f32 x4
+    UniformMatrix4fv,         // u32 nameId, f32 x16 (column major)
+
+    BindBuffer,               // u32 target, u32 buffer
+    BufferData,               // u32 target, u32 usage, blob data (zero-filled when the source was null)
+    BufferSubData,            // u32 target, u64 offset, blob data
+    BindVertexArray,          // u32 vao
+    EnableVertexAttribArray,  // u32 index
+    DisableVertexAttribArray, // u32 index
+    VertexAttribPointer,      // u32 index, i32 size, u32 type, u8 normalized, i32 stride, u64 offset
+
+    ActiveTexture,            // u32 unit
+    BindTexture,              // u32 target, u32 texture
+    TexImage2D,               // u32 target, i32 level, i32 internalFormat, i32 w, i32 h, u32 format, u32 type, blob pixels
+    TexParameteri,            // u32 target, u32 pname, i32 value
+    GenerateMipmap,           // u32 target
+
+    Enable,                   // u32 cap
+    Disable,                  // u32 cap
+    ClearColor,               // f32 x4
+    Clear,                    // u32 mask
+    Viewport,                 // i32 x4
+    DrawArrays,               // u32 mode, i32 first, i32 count
+    DrawElements,             // u32 mode, i32 count, u32 type, u64 offset
+
+    Count
+};
+
+} // namespace gltrace
+
+#endif // GLTRACEFORMAT_H
@@ -0,0 +1,311 @@
+#include "gpumemory.h"
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QOpenGLContext>
+#include <QStringList>
+#include <QVector>
+#include <algorithm>
+
+GpuMemoryTracker &GpuMemoryTracker::instance()
+{
+    static GpuMemoryTracker tracker;
+    return tracker;
+}
+
+const char *GpuMemoryTracker::categoryName(Category category)
+{
+    switch (category) {
+    case Category::VertexBuffer: return "vertex buffer";
+    case Category::IndexBuffer: return "index buffer";
+    case Category::Texture: return "texture";
+    case Category::PixelBuffer: return "pixel buffer";
+    case Category::RenderTarget: return "render target";
+    default: return "other";
+    }
+}
+
+qint64 GpuMemoryTracker::textureBytes(int width, int height, int bytesPerPixel, bool mipmapped)
+{
+    qint64 total = 0;
+    for (;;) {
+        total += qint64(width) * height * bytesPerPixel;
+        if (!mipmapped || (width == 1 && height == 1)) {
+            break;
+        }
+        width = qMax(1, width / 2);
+        height = qMax(1, height / 2);
+    }
+    return total;
+}
+
+// ------------------- Registration -------------------
+
+GpuMemoryTracker::Handle GpuMemoryTracker::registerAllocation(Category category, qint64 bytes, const QString &owner,
+                                                              const QString &label, EvictFunction evict)
+{
+    QMutexLocker locker(&mutex);
+    const Handle handle = nextHandle++;
+
+    Allocation allocation;
+    allocation.category = category;
+    allocation.bytes = bytes;
+    allocation.owner = owner;
+    allocation.label = label;
+    allocation.evict = std::move(evict);
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    watchContext(context);
+    allocation.context = context;
+    allocation.group = context ? context->shareGroup() : nullptr;
+    allocation.lastUsedFrame = frames.value(context);
+    allocations.insert(handle, allocation);
+
+    resident += bytes;
+    residentByCategory[int(category)] += bytes;
+    peakResident = qMax(peakResident, resident);
+    return handle;
+}
+
+void GpuMemoryTracker::release(Handle handle)
+{
+    QMutexLocker locker(&mutex);
+    auto it = allocations.find(handle);
+    if (it == allocations.end()) {
+        return;
+    }
+    if (it->resident) {
+        resident -= it->bytes;
+        residentByCategory[int(it->category)] -= it->bytes;
+    }
+    allocations.erase(it);
+}
+
+void GpuMemoryTracker::resize(Handle handle, qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    auto it = allocations.find(handle);
+    if (it == allocations.end()) {
+        return;
+    }
+    if (it->resident) {
+        resident += bytes - it->bytes;
+        residentByCategory[int(it->category)] += bytes - it->bytes;
+        peakResident = qMax(peakResident, resident);
+    }
+    it->bytes = bytes;
+}
+
+void GpuMemoryTracker::markResident(Handle handle, qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    auto it = allocations.find(handle);
+    if (it == allocations.end() || it->resident) {
+        return;
+    }
+    it->resident = true;
+    it->bytes = bytes;
+    it->lastUsedFrame = frames.value(it->context);
+    resident += bytes;
+    residentByCategory[int(it->category)] += bytes;
+    peakResident = qMax(peakResident, resident);
+}
+
+void GpuMemoryTracker::touch(Handle handle)
+{
+    QMutexLocker locker(&mutex);
+    auto it = allocations.find(handle);
+    if (it != allocations.end()) {
+        it->lastUsedFrame = frames.value(it->context);
+    }
+}
+
+// ------------------- Budget -------------------
+
+void GpuMemoryTracker::beginFrame()
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QMutexLocker locker(&mutex);
+    watchContext(context);
+    ++frames[context];
+}
+
+void GpuMemoryTracker::watchContext(QOpenGLContext *context)
+{
+    // Called with the mutex held. A context gets its frame count on first sight and loses it when it
+    // goes away, so a new context at the same address starts from zero.
+    if (!context || frames.contains(context)) {
+        return;
+    }
+    frames.insert(context, 0);
+    QObject::connect(context, &QOpenGLContext::aboutToBeDestroyed, context, [this, context] {
+        QMutexLocker locker(&mutex);
+        frames.remove(context);
+        // Whatever its owners did not release can no longer be evicted or touched through it
+        for (Allocation &allocation : allocations) {
+            if (allocation.context == context) {
+                allocation.context = nullptr;
+                allocation.group = nullptr;
+                allocation.evict = EvictFunction();
+            }
+        }
+    });
+}
+
+void GpuMemoryTracker::setBudget(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    budgetBytes = qMax<qint64>(0, bytes);
+}
+
+qint64 GpuMemoryTracker::budget() const
+{
+    QMutexLocker locker(&mutex);
+    return budgetBytes;
+}
+
+qint64 GpuMemoryTracker::enforceBudget()
+{
+    QVector<EvictFunction> callbacks;
+    qint64 evicted = 0;
+    const QOpenGLContext *context = QOpenGLContext::currentContext();
+    const QOpenGLContextGroup *group = context ? context->shareGroup() : nullptr;
+    {
+        QMutexLocker locker(&mutex);
+        if (budgetBytes == 0 || resident <= budgetBytes) {
+            overBudgetWarned = false;
+            return 0;
+        }
+
+        // Only this share group's names can be deleted with the current context. Contexts count frames
+        // separately, so age is measured in frames of each allocation's own context.
+        auto age = [this](const Allocation &allocation) {
+            return frames.value(allocation.context) - allocation.lastUsedFrame;
+        };
+        QVector<Handle> candidates;
+        for (auto it = allocations.cbegin(); it != allocations.cend(); ++it) {
+            if (it->resident && it->evict && it->group == group && age(*it) > 0) {
+                candidates.append(it.key());
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [this, &age](Handle a, Handle b) {
+            return age(allocations[a]) > age(allocations[b]);
+        });
+
+        for (Handle handle : candidates) {
+            if (resident <= budgetBytes) {
+                break;
+            }
+            Allocation &allocation = allocations[handle];
+            allocation.resident = false;
+            resident -= allocation.bytes;
+            residentByCategory[int(allocation.category)] -= allocation.bytes;
+            evicted += allocation.bytes;
+            ++evictionCount;
+            callbacks.append(allocation.evict);
+        }
+        evictedBytesTotal += evicted;
+
+        // Once per stretch over budget: this runs every frame
+        if (resident <= budgetBytes) {
+            overBudgetWarned = false;
+        } else if (!overBudgetWarned) {
+            overBudgetWarned = true;
+            qWarning() << "GpuMemoryTracker: over budget by" << (resident - budgetBytes)
+                       << "bytes with nothing left to evict in this context";
+        }
+    }
+
+    // Outside the lock: owners may call back into the tracker while freeing
+    for (const EvictFunction &evict : callbacks) {
+        evict();
+    }
+    return evicted;
+}
+
+qint64 GpuMemoryTracker::residentBytes() const
+{
+    QMutexLocker locker(&mutex);
+    return resident;
+}
+
+qint64 GpuMemoryTracker::residentBytes(Category category) const
+{
+    QMutexLocker locker(&mutex);
+    return residentByCategory[int(category)];
+}
+
+// ------------------- Reporting -------------------
+
+static QString formatBytes(qint64 bytes)
+{
+    if (bytes >= 1024 * 1024) {
+        return QString("%1 MiB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 2);
+    }
+    return QString("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+}
+
+QString GpuMemoryTracker::report() const
+{
+    QMutexLocker locker(&mutex);
+    QStringList lines;
+    lines << QString("GPU memory: %1 resident (peak %2, budget %3), %4 allocations, %5 evictions (%6)")
+                 .arg(formatBytes(resident), formatBytes(peakResident),
+                      budgetBytes > 0 ? formatBytes(budgetBytes) : QString("none"))
+                 .arg(allocations.size())
+                 .arg(evictionCount)
+                 .arg(formatBytes(evictedBytesTotal));
+    for (int c = 0; c < int(Category::Count); ++c) {
+        if (residentByCategory[c] != 0) {
+            lines << QString("  %1: %2").arg(QString::fromLatin1(categoryName(Category(c))), -14).arg(formatBytes(residentByCategory[c]));
+        }
+    }
+    return lines.join('\n');
+}
+
+QByteArray GpuMemoryTracker::toJson() const
+{
+    QMutexLocker locker(&mutex);
+
+    QJsonObject categories;
+    for (int c = 0; c < int(Category::Count); ++c) {
+        categories.insert(QString::fromLatin1(categoryName(Category(c))), residentByCategory[c]);
+    }
+
+    QJsonArray list;
+    for (auto it = allocations.cbegin(); it != allocations.cend(); ++it) {
+        QJsonObject entry;
+        entry.insert("id", qint64(it.key()));
+        entry.insert("category", QString::fromLatin1(categoryName(it->category)));
+        entry.insert("owner", it->owner);
+        entry.insert("label", it->label);
+        entry.insert("bytes", it->bytes);
+        entry.insert("resident", it->resident);
+        entry.insert("evictable", bool(it->evict));
+        entry.insert("lastUsedFrame", qint64(it->lastUsedFrame));
+        list.append(entry);
+    }
+
+    QJsonObject root;
+    root.insert("contexts", frames.size());
+    root.insert("budgetBytes", budgetBytes);
+    root.insert("residentBytes", resident);
+    root.insert("peakResidentBytes", peakResident);
+    root.insert("evictions", qint64(evictionCount));
+    root.insert("evictedBytes", evictedBytesTotal);
+    root.insert("byCategory", categories);
+    root.insert("allocations", list);
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+bool GpuMemoryTracker::dumpJson(const QString &filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "GpuMemoryTracker: cannot write" << filePath;
+        return false;
+    }
+    return file.write(toJson()) >= 0;
+}
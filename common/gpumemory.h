@@ -0,0 +1,117 @@
+#ifndef GPUMEMORY_H
+#define GPUMEMORY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <functional>
+
+class QOpenGLContext;
+class QOpenGLContextGroup;
+
+/**
+ * @brief Process-wide accounting of GPU allocations with an optional budget.
+ *
+ * Every buffer, raw EBO and texture a widget creates is registered with its
+ * size, category and owner. Textures that can be rebuilt from disk register an
+ * eviction callback; when the resident total exceeds the budget,
+ * enforceBudget() evicts them in least-recently-used order. An evicted entry
+ * stays registered (resident = false) until the owner reloads it with
+ * markResident() or releases it.
+ *
+ * Each allocation belongs to the context current when it was registered, and
+ * each context counts its own frames: beginFrame() advances the current
+ * context and touch() stamps an allocation with its own context's frame, so
+ * several widgets do not age each other's textures. enforceBudget() only
+ * evicts allocations of the current context's share group, since their GL
+ * names mean nothing in another one; a widget over budget with nothing of its
+ * own left to evict waits for the others to evict theirs in their paintGL(),
+ * and the tracker warns once until the total drops under the budget again.
+ * A context's frame count is dropped when the context is destroyed.
+ *
+ * Allocations touched in the current frame are never evicted, so calling
+ * enforceBudget() at the start of paintGL() cannot pull a texture out from
+ * under a draw call. Eviction callbacks run on the calling thread, with the
+ * owning context current.
+ */
+class GpuMemoryTracker
+{
+public:
+    enum class Category {
+        VertexBuffer,
+        IndexBuffer,
+        Texture,
+        PixelBuffer,
+        RenderTarget,
+        Other,
+        Count
+    };
+
+    using Handle = quint64;               // 0 is never a valid handle
+    using EvictFunction = std::function<void()>;
+
+    static GpuMemoryTracker &instance();
+
+    /**
+     * @brief Registers an allocation owned by the current context (none if no context is current).
+     */
+    Handle registerAllocation(Category category, qint64 bytes, const QString &owner,
+                              const QString &label, EvictFunction evict = {});
+    void release(Handle handle);
+    void resize(Handle handle, qint64 bytes);
+    void markResident(Handle handle, qint64 bytes);   // After the owner reloaded an evicted resource
+    void touch(Handle handle);                        // Mark as used this frame of its context (LRU)
+
+    void beginFrame();                                // Of the current context
+    void setBudget(qint64 bytes);                     // 0 disables the budget
+    qint64 budget() const;
+    /**
+     * @brief Evicts LRU evictable allocations of the current share group until the resident total fits
+     * the budget.
+     * @return Number of bytes evicted.
+     */
+    qint64 enforceBudget();
+
+    qint64 residentBytes() const;
+    qint64 residentBytes(Category category) const;
+
+    QString report() const;
+    QByteArray toJson() const;
+    bool dumpJson(const QString &filePath) const;
+
+    static const char *categoryName(Category category);
+    // Bytes of a 2D texture with a full mip chain (or only level 0)
+    static qint64 textureBytes(int width, int height, int bytesPerPixel, bool mipmapped);
+
+private:
+    GpuMemoryTracker() = default;
+
+    void watchContext(QOpenGLContext *context);
+
+    struct Allocation {
+        Category category = Category::Other;
+        qint64 bytes = 0;
+        bool resident = true;
+        QString owner;
+        QString label;
+        EvictFunction evict;
+        const QOpenGLContext *context = nullptr;
+        const QOpenGLContextGroup *group = nullptr;   // Of context, when it was registered
+        quint64 lastUsedFrame = 0;                    // Frame of context
+    };
+
+    mutable QMutex mutex;
+    QHash<Handle, Allocation> allocations;
+    Handle nextHandle = 1;
+    QHash<const QOpenGLContext *, quint64> frames;    // Per live context
+    qint64 budgetBytes = 0;
+    qint64 resident = 0;
+    qint64 residentByCategory[int(Category::Count)] = {};
+    qint64 peakResident = 0;
+    quint64 evictionCount = 0;
+    qint64 evictedBytesTotal = 0;
+    bool overBudgetWarned = false;                    // Until the resident total is back under the budget
+};
+
+#endif // GPUMEMORY_H
@@ -0,0 +1,158 @@
+#include "heightmap.h"
+#include <QDebug>
+#include <QVector>
+#include <QtEndian>
+#include <cmath>
+
+Heightmap::~Heightmap()
+{
+    close();
+}
+
+// ------------------- Opening -------------------
+
+bool Heightmap::open(const QString &filePath, int width, int height)
+{
+    close();
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    // Samples are used straight from the mapping
+    qWarning() << "Heightmap: little-endian samples cannot be mapped on a big-endian host";
+    return false;
+#endif
+
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Heightmap: cannot open" << filePath;
+        return false;
+    }
+
+    const qint64 bytes = file.size();
+    if (width <= 0 || height <= 0) {
+        const qint64 side = qint64(std::llround(std::sqrt(double(bytes / 2))));
+        width = height = int(side);
+    }
+    if (width < 2 || height < 2 || qint64(width) * height * 2 != bytes) {
+        qWarning() << "Heightmap:" << filePath << "(" << bytes << "bytes) is not a" << width << "x" << height
+                   << "16-bit heightmap";
+        close();
+        return false;
+    }
+
+    uchar *mapped = file.map(0, bytes);
+    if (!mapped) {
+        qWarning() << "Heightmap: cannot map" << filePath;
+        close();
+        return false;
+    }
+    samples = reinterpret_cast<const quint16 *>(mapped);
+    columns = width;
+    rows = height;
+
+    qDebug() << "Heightmap: mapped" << filePath << columns << "x" << rows;
+    return true;
+}
+
+void Heightmap::close()
+{
+    if (samples) {
+        file.unmap(reinterpret_cast<uchar *>(const_cast<quint16 *>(samples)));
+    }
+    file.close();
+    samples = nullptr;
+    columns = 0;
+    rows = 0;
+}
+
+// ------------------- Sampling -------------------
+
+float Heightmap::interpolated(float x, float z) const
+{
+    const float fx = std::floor(x);
+    const float fz = std::floor(z);
+    const int x0 = int(fx);
+    const int z0 = int(fz);
+    const float tx = x - fx;
+    const float tz = z - fz;
+    const float top = value(x0, z0) + (value(x0 + 1, z0) - value(x0, z0)) * tx;
+    const float bottom = value(x0, z0 + 1) + (value(x0 + 1, z0 + 1) - value(x0, z0 + 1)) * tx;
+    return top + (bottom - top) * tz;
+}
+
+// ------------------- Test Terrain -------------------
+
+static quint32 latticeHash(int x, int z, quint32 seed)
+{
+    quint32 h = quint32(x) * 0x8da6b343u ^ quint32(z) * 0xd8163841u ^ seed * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+// Smoothly interpolated lattice noise in [0, 1]
+static double valueNoise(double x, double z, quint32 seed)
+{
+    const double fx = std::floor(x);
+    const double fz = std::floor(z);
+    const int x0 = int(fx);
+    const int z0 = int(fz);
+    double tx = x - fx;
+    double tz = z - fz;
+    tx = tx * tx * (3.0 - 2.0 * tx);
+    tz = tz * tz * (3.0 - 2.0 * tz);
+    const double scale = 1.0 / 4294967295.0;
+    const double a = latticeHash(x0, z0, seed) * scale;
+    const double b = latticeHash(x0 + 1, z0, seed) * scale;
+    const double c = latticeHash(x0, z0 + 1, seed) * scale;
+    const double d = latticeHash(x0 + 1, z0 + 1, seed) * scale;
+    return a + (b - a) * tx + (c - a) * tz + (a - b - c + d) * tx * tz;
+}
+
+bool Heightmap::generate(const QString &filePath, int size, quint32 seed)
+{
+    if (size < 2) {
+        qWarning() << "Heightmap: invalid size" << size;
+        return false;
+    }
+    QFile out(filePath);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Heightmap: cannot write" << filePath;
+        return false;
+    }
+
+    // Features scale with the map so a larger map is more terrain, not a blurrier one
+    const double baseFrequency = 8.0 / 4096.0;
+    const int octaves = 10;
+    QVector<quint16> row(size);
+    for (int z = 0; z < size; ++z) {
+        for (int x = 0; x < size; ++x) {
+            double frequency = baseFrequency;
+            double amplitude = 1.0;
+            double total = 0.0;
+            double norm = 0.0;
+            double weight = 1.0;
+            for (int o = 0; o < octaves; ++o) {
+                // Ridged: sharp crests, and each octave is damped where the previous one is low
+                double n = 1.0 - std::abs(2.0 * valueNoise(x * frequency, z * frequency, seed + quint32(o)) - 1.0);
+                n *= n * weight;
+                weight = qBound(0.0, n * 2.0, 1.0);
+                total += n * amplitude;
+                norm += amplitude;
+                frequency *= 2.0;
+                amplitude *= 0.5;
+            }
+            const double base = valueNoise(x * baseFrequency * 0.25, z * baseFrequency * 0.25, seed + 97u);
+            const double height = qBound(0.0, 0.65 * total / norm + 0.35 * base, 1.0);
+            row[x] = qToLittleEndian(quint16(height * 65535.0 + 0.5));
+        }
+        if (out.write(reinterpret_cast<const char *>(row.constData()), qint64(size) * 2) != qint64(size) * 2) {
+            qWarning() << "Heightmap: write failed for" << filePath;
+            return false;
+        }
+    }
+    qDebug() << "Heightmap: generated" << filePath << size << "x" << size;
+    return true;
+}
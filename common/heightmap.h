@@ -0,0 +1,69 @@
+#ifndef HEIGHTMAP_H
+#define HEIGHTMAP_H
+
+#include <QFile>
+#include <QString>
+
+/**
+ * @brief Read-only, memory-mapped 16-bit heightmap.
+ *
+ * The file is raw little-endian unsigned 16-bit samples, row-major, with no
+ * header (the .r16 / .raw layout terrain tools export). A square map's size
+ * is taken from the file size; other maps pass their size to open().
+ *
+ * open() maps the whole file and reads nothing, so a 16k x 16k map (512 MiB)
+ * costs no memory until chunks are built from it, and only the pages of the
+ * chunks actually built are ever read. Sampling is const and lock-free, so
+ * worker threads may read concurrently. The mapping stays valid until close().
+ */
+class Heightmap
+{
+public:
+    Heightmap() = default;
+    ~Heightmap();
+
+    /**
+     * @brief Maps @p filePath. @p width and @p height may be 0 for a square map.
+     */
+    bool open(const QString &filePath, int width = 0, int height = 0);
+    void close();
+    bool isOpen() const { return samples != nullptr; }
+
+    int width() const { return columns; }
+    int height() const { return rows; }
+    QString filePath() const { return file.fileName(); }
+
+    /**
+     * @brief Raw sample at (@p x, @p z), clamped to the map.
+     */
+    quint16 sample(int x, int z) const
+    {
+        x = x < 0 ? 0 : (x >= columns ? columns - 1 : x);
+        z = z < 0 ? 0 : (z >= rows ? rows - 1 : z);
+        return samples[qint64(z) * columns + x];
+    }
+    /**
+     * @brief Sample at (@p x, @p z) scaled to [0, 1].
+     */
+    float value(int x, int z) const { return sample(x, z) * (1.0f / 65535.0f); }
+    /**
+     * @brief Bilinearly interpolated value at a fractional sample position.
+     */
+    float interpolated(float x, float z) const;
+
+    /**
+     * @brief Writes a @p size x @p size fractal test terrain to @p filePath.
+     *
+     * Ridged value-noise octaves; deterministic for a given @p seed. Takes a
+     * few seconds at 4097 and scales with the sample count.
+     */
+    static bool generate(const QString &filePath, int size, quint32 seed = 1);
+
+private:
+    QFile file;
+    const quint16 *samples = nullptr;
+    int columns = 0;
+    int rows = 0;
+};
+
+#endif // HEIGHTMAP_H
@@ -0,0 +1,451 @@
+#include "impostor.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QOpenGLShaderProgram>
+#include <QtMath>
+#include <cmath>
+
+static const int TransformFloats = 12;      // Three vec4 rows per instance
+
+// ------------------- Shader Source Code (Embedded) -------------------
+
+// One quad per instance. The camera direction, taken into the object's frame, picks the nearest baked view; the
+// quad is laid out in that view's image plane, so the sampled cell lines up with it exactly.
+static const char *vertexShaderSource = R"glsl(
+#version 330 core
+layout(location = 0) in vec2 corner;
+layout(location = 1) in vec4 row0;
+layout(location = 2) in vec4 row1;
+layout(location = 3) in vec4 row2;
+uniform mat4 viewProjection;
+uniform vec3 cameraPosition;
+uniform vec3 center;
+uniform float radius;
+uniform float viewsPerSide;
+out vec2 atlasCoord;
+
+vec2 signs(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Octahedral mapping around +y; must match octahedralDirection() in impostor.cpp
+vec2 octahedralEncode(vec3 d)
+{
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    return d.y >= 0.0 ? d.xz : (1.0 - abs(d.zx)) * signs(d.xz);
+}
+
+vec3 octahedralDecode(vec2 p)
+{
+    vec3 n = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+    if (n.y < 0.0) {
+        n.xz = (1.0 - abs(n.zx)) * signs(n.xz);
+    }
+    return normalize(n);
+}
+
+vec3 transformPoint(vec3 p)
+{
+    vec4 local = vec4(p, 1.0);
+    return vec3(dot(row0, local), dot(row1, local), dot(row2, local));
+}
+
+void main()
+{
+    // With uniform scale the transpose takes world directions into object space
+    vec3 toCamera = mat3(row0.xyz, row1.xyz, row2.xyz) * (cameraPosition - transformPoint(center));
+    vec2 cell = clamp(floor((octahedralEncode(normalize(toCamera)) * 0.5 + 0.5) * viewsPerSide), 0.0,
+                      viewsPerSide - 1.0);
+    vec3 direction = octahedralDecode((cell + 0.5) / viewsPerSide * 2.0 - 1.0);
+
+    // The image plane of QMatrix4x4::lookAt() from center + direction, as baked
+    vec3 forward = -direction;
+    vec3 up = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 side = normalize(cross(forward, up));
+    vec3 upAxis = cross(side, forward);
+
+    gl_Position = viewProjection * vec4(transformPoint(center + (corner.x * side + corner.y * upAxis) * radius), 1.0);
+    atlasCoord = (cell + corner * 0.5 + 0.5) / viewsPerSide;
+}
+)glsl";
+
+// The atlas is cleared to transparent black and objects write alpha 1, so mip levels hold premultiplied color
+static const char *fragmentShaderSource = R"glsl(
+#version 330 core
+in vec2 atlasCoord;
+uniform sampler2DArray atlas;
+uniform float layer;
+out vec4 fragColor;
+void main()
+{
+    vec4 color = texture(atlas, vec3(atlasCoord, layer));
+    if (color.a < 0.5) {
+        discard;
+    }
+    fragColor = vec4(color.rgb / color.a, 1.0);
+}
+)glsl";
+
+// Direction of the view in cell (column, row); the CPU twin of the shader's decode
+static QVector3D octahedralDirection(int column, int row, int viewsPerSide)
+{
+    const float px = (column + 0.5f) / viewsPerSide * 2.0f - 1.0f;
+    const float pz = (row + 0.5f) / viewsPerSide * 2.0f - 1.0f;
+    QVector3D n(px, 1.0f - std::abs(px) - std::abs(pz), pz);
+    if (n.y() < 0.0f) {
+        const float x = (1.0f - std::abs(n.z())) * (n.x() >= 0.0f ? 1.0f : -1.0f);
+        const float z = (1.0f - std::abs(n.x())) * (n.z() >= 0.0f ? 1.0f : -1.0f);
+        n.setX(x);
+        n.setZ(z);
+    }
+    return n.normalized();
+}
+
+// ------------------- Setup -------------------
+
+bool ImpostorCache::buildProgram()
+{
+    program = new QOpenGLShaderProgram;
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource)
+        || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource) || !program->link()) {
+        qWarning() << "ImpostorCache: program failed:" << program->log();
+        return false;
+    }
+    return true;
+}
+
+bool ImpostorCache::initialize(const Params &params)
+{
+    initializeOpenGLFunctions();
+    release();
+
+    if (params.maxObjects <= 0 || params.viewsPerSide <= 0 || params.viewSize < 4
+        || (params.viewSize & (params.viewSize - 1)) != 0) {
+        qWarning() << "ImpostorCache: maxObjects and viewsPerSide must be positive, viewSize a power of two >= 4";
+        return false;
+    }
+    parameters = params;
+    if (!buildProgram()) {
+        release();
+        return false;
+    }
+
+    // Mip levels stop at 4 x 4 pixels per view: below that, neighbouring views would blend into each other
+    atlasSize = parameters.viewsPerSide * parameters.viewSize;
+    const int maxLevel = qMax(0, int(std::log2(parameters.viewSize)) - 2);
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, atlasSize, atlasSize, parameters.maxObjects, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, maxLevel);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, atlas, 0, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previousFramebuffer));
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        qWarning() << "ImpostorCache: atlas framebuffer incomplete" << Qt::hex << status;
+        release();
+        return false;
+    }
+
+    const float corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    glGenBuffers(1, &cornerBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glGenBuffers(1, &instanceBuffer);
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (int row = 0; row < 3; ++row) {
+        glEnableVertexAttribArray(GLuint(1 + row));
+        glVertexAttribPointer(GLuint(1 + row), 4, GL_FLOAT, GL_FALSE, TransformFloats * sizeof(float),
+                              (void*)(row * 4 * sizeof(float)));
+        glVertexAttribDivisor(GLuint(1 + row), 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instanceCapacity = 0;
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    const QString owner = QString("ImpostorCache@%1").arg(quintptr(this), 0, 16);
+    atlasMemory = memory.registerAllocation(GpuMemoryTracker::Category::Texture,
+                                            GpuMemoryTracker::textureBytes(atlasSize, atlasSize, 4, true)
+                                                * parameters.maxObjects,
+                                            owner, "impostor atlas");
+    depthMemory = memory.registerAllocation(GpuMemoryTracker::Category::RenderTarget,
+                                            qint64(atlasSize) * atlasSize * 4, owner, "impostor bake depth");
+
+    objects.clear();
+    bakedLastCall = 0;
+    bakeMilliseconds = 0.0;
+    quadsDrawn = 0;
+    initialized = true;
+    return true;
+}
+
+void ImpostorCache::release()
+{
+    delete program;
+    program = nullptr;
+
+    if (atlas != 0) {
+        glDeleteTextures(1, &atlas);
+        atlas = 0;
+    }
+    if (depthBuffer != 0) {
+        glDeleteRenderbuffers(1, &depthBuffer);
+        depthBuffer = 0;
+    }
+    if (framebuffer != 0) {
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+    }
+    if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+        vao = 0;
+    }
+    for (GLuint *buffer : { &cornerBuffer, &instanceBuffer }) {
+        if (*buffer != 0) {
+            glDeleteBuffers(1, buffer);
+            *buffer = 0;
+        }
+    }
+    instanceCapacity = 0;
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    for (GpuMemoryTracker::Handle *handle : { &atlasMemory, &depthMemory, &instanceMemory }) {
+        memory.release(*handle);
+        *handle = 0;
+    }
+    objects.clear();
+    initialized = false;
+}
+
+// ------------------- Objects -------------------
+
+int ImpostorCache::addObject(const QVector3D &center, float radius, const DrawFunction &draw)
+{
+    if (!initialized || objects.size() >= parameters.maxObjects || radius <= 0.0f || !draw) {
+        qWarning() << "ImpostorCache: cannot add an object (" << objects.size() << "of" << parameters.maxObjects
+                   << "layers used)";
+        return -1;
+    }
+    Object object;
+    object.center = center;
+    object.radius = radius;
+    object.draw = draw;
+    objects.append(object);
+    return objects.size() - 1;
+}
+
+void ImpostorCache::invalidate(int object)
+{
+    if (object >= 0 && object < objects.size()) {
+        objects[object].stale = true;
+        objects[object].requested = false;
+    }
+}
+
+// ------------------- Baking -------------------
+
+int ImpostorCache::bake()
+{
+    bakedLastCall = 0;
+    bakeMilliseconds = 0.0;
+    if (!initialized) {
+        return 0;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4] = {};
+    GLboolean scissorWasEnabled = GL_FALSE;
+    GLboolean depthTestWasEnabled = GL_FALSE;
+    for (int i = 0; i < objects.size() && bakedLastCall < parameters.bakesPerFrame; ++i) {
+        if (!objects[i].stale || !objects[i].requested) {
+            continue;
+        }
+        if (bakedLastCall == 0) {
+            glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+            glGetIntegerv(GL_VIEWPORT, previousViewport);
+            scissorWasEnabled = glIsEnabled(GL_SCISSOR_TEST);
+            depthTestWasEnabled = glIsEnabled(GL_DEPTH_TEST);
+            glDisable(GL_SCISSOR_TEST);
+            glEnable(GL_DEPTH_TEST);
+        }
+        bakeObject(i);
+        ++bakedLastCall;
+    }
+    if (bakedLastCall == 0) {
+        return 0;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previousFramebuffer));
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    if (scissorWasEnabled) {
+        glEnable(GL_SCISSOR_TEST);
+    }
+    if (!depthTestWasEnabled) {
+        glDisable(GL_DEPTH_TEST);
+    }
+    // One mip rebuild for everything baked in this call, on the caller's active unit
+    GLint previousTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previousTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, GLuint(previousTexture));
+
+    bakeMilliseconds = timer.nsecsElapsed() / 1.0e6;
+    return bakedLastCall;
+}
+
+void ImpostorCache::bakeObject(int index)
+{
+    Object &object = objects[index];
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, atlas, 0, index);
+    glViewport(0, 0, atlasSize, atlasSize);
+    // Transparent where the object does not cover a view; the caller's clear color is left alone
+    const GLfloat transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat farDepth = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, transparent);
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+    // An orthographic camera per view, two radii out: the bounding sphere fills the cell
+    const float radius = object.radius;
+    QMatrix4x4 projection;
+    projection.ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+    for (int row = 0; row < parameters.viewsPerSide; ++row) {
+        for (int column = 0; column < parameters.viewsPerSide; ++column) {
+            const QVector3D direction = octahedralDirection(column, row, parameters.viewsPerSide);
+            const QVector3D up = std::abs(direction.y()) > 0.999f ? QVector3D(0.0f, 0.0f, 1.0f)
+                                                                 : QVector3D(0.0f, 1.0f, 0.0f);
+            QMatrix4x4 view;
+            view.lookAt(object.center + direction * (2.0f * radius), object.center, up);
+            glViewport(column * parameters.viewSize, row * parameters.viewSize, parameters.viewSize,
+                       parameters.viewSize);
+            object.draw(projection * view);
+        }
+    }
+
+    object.baked = true;
+    object.stale = false;
+    object.requested = false;
+}
+
+// ------------------- Drawing -------------------
+
+void ImpostorCache::partition(int object, const float *transforms, int count, const QVector3D &camera,
+                              float distance, QVector<float> *nearTransforms, QVector<float> *farTransforms) const
+{
+    const QVector3D center = objects.value(object).center;
+    const float distanceSquared = distance * distance;
+    for (int i = 0; i < count; ++i) {
+        const float *rows = transforms + i * TransformFloats;
+        const QVector3D world(rows[0] * center.x() + rows[1] * center.y() + rows[2] * center.z() + rows[3],
+                              rows[4] * center.x() + rows[5] * center.y() + rows[6] * center.z() + rows[7],
+                              rows[8] * center.x() + rows[9] * center.y() + rows[10] * center.z() + rows[11]);
+        QVector<float> *target = (world - camera).lengthSquared() < distanceSquared ? nearTransforms : farTransforms;
+        target->append(rows, TransformFloats);
+    }
+}
+
+bool ImpostorCache::draw(int object, const QMatrix4x4 &viewProjection, const QVector3D &camera,
+                         const float *transforms, int count)
+{
+    if (!initialized || object < 0 || object >= objects.size()) {
+        return false;
+    }
+    Object &entry = objects[object];
+    if (entry.stale) {
+        entry.requested = true;
+    }
+    if (!entry.baked) {
+        return false;
+    }
+    if (count <= 0) {
+        return true;
+    }
+
+    // Orphaned every draw: the driver hands out fresh storage instead of waiting for the previous draw
+    const qint64 bytes = qint64(count) * TransformFloats * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (bytes > instanceCapacity) {
+        instanceCapacity = bytes + bytes / 2;
+        GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+        if (instanceMemory) {
+            memory.resize(instanceMemory, instanceCapacity);
+        } else {
+            instanceMemory = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, instanceCapacity,
+                                                       QString("ImpostorCache@%1").arg(quintptr(this), 0, 16),
+                                                       "impostor instances");
+        }
+    }
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, transforms);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    program->bind();
+    program->setUniformValue("viewProjection", viewProjection);
+    program->setUniformValue("cameraPosition", camera);
+    program->setUniformValue("center", entry.center);
+    program->setUniformValue("radius", entry.radius);
+    program->setUniformValue("viewsPerSide", float(parameters.viewsPerSide));
+    program->setUniformValue("layer", float(object));
+    program->setUniformValue("atlas", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    program->release();
+
+    quadsDrawn += count;
+    return true;
+}
+
+float ImpostorCache::switchDistance(float radius, float verticalFovDegrees, int viewportHeight, float pixels)
+{
+    // A sphere at distance d spans 2 r / (2 d tan(fov / 2)) of the viewport height
+    const float tanHalfFov = std::tan(qDegreesToRadians(verticalFovDegrees) * 0.5f);
+    return radius * float(viewportHeight) / (qMax(pixels, 1.0f) * tanHalfFov);
+}
+
+ImpostorCache::Stats ImpostorCache::stats() const
+{
+    Stats result;
+    result.objects = objects.size();
+    for (const Object &object : objects) {
+        result.baked += object.baked ? 1 : 0;
+        result.pending += object.stale && object.requested ? 1 : 0;
+    }
+    result.bakedLastCall = bakedLastCall;
+    result.bakeMilliseconds = bakeMilliseconds;
+    result.quadsDrawn = quadsDrawn;
+    result.atlasBytes = initialized ? GpuMemoryTracker::textureBytes(atlasSize, atlasSize, 4, true)
+                                          * parameters.maxObjects
+                                    : 0;
+    return result;
+}
@@ -0,0 +1,166 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QMatrix4x4>
+#include <QVector>
+#include <QVector3D>
+#include <functional>
+#include "gpumemory.h"
+
+class QOpenGLShaderProgram;
+
+/**
+ * @brief Octahedral impostors: distant instances of an object drawn as one textured quad each.
+ *
+ * Each registered object is rendered from viewsPerSide^2 directions spread
+ * over the whole sphere with an octahedral mapping, into one layer of a 2D
+ * texture array (a grid of views, one cell per direction). draw() then
+ * replaces every instance with a single quad facing the view direction
+ * nearest to the camera, as seen in the object's own frame, and samples
+ * that view. Lighting is whatever the object's draw function does while
+ * baking, so it is fixed in object space.
+ *
+ * Baking is lazy. An object is baked the first time draw() asks for it, and
+ * again after invalidate(), but only when a later bake() gets to it, so edits
+ * to objects that are not on screen as impostors cost nothing. Until its
+ * first bake an object is not drawn and draw() returns false: the caller
+ * keeps drawing its mesh.
+ *
+ *   int tree = impostors.addObject(center, radius, [&](const QMatrix4x4 &vp) { drawTree(vp); });
+ *   impostors.bake();                   // Once per frame, before drawing
+ *   impostors.partition(tree, transforms, count, camera, distance, &nearTransforms, &farTransforms);
+ *   drawTreeInstances(nearTransforms);
+ *   if (!impostors.draw(tree, viewProjection, camera, farTransforms.constData(), farTransforms.size() / 12))
+ *       drawTreeInstances(farTransforms);
+ *
+ * Instance transforms are 3 x 4 row-major affine matrices (three vec4 rows,
+ * as SceneGraph::worldTransforms() stores them), with uniform scale.
+ *
+ * All GL calls must be made with the owning context current.
+ */
+class ImpostorCache : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Params {
+        int maxObjects = 16;                // Layers of the atlas
+        int viewsPerSide = 8;               // Views per object: viewsPerSide^2
+        int viewSize = 64;                  // Pixels per view, a power of two
+        int bakesPerFrame = 4;              // Objects baked by one bake() call at most
+    };
+
+    /**
+     * @brief Draws the object in its own space with @p viewProjection; the program and state are the caller's.
+     *
+     * Runs inside bake() with the atlas framebuffer bound and the depth test
+     * enabled. Fragments must write alpha 1.
+     */
+    using DrawFunction = std::function<void(const QMatrix4x4 &viewProjection)>;
+
+    struct Stats {
+        int objects = 0;
+        int baked = 0;                      // Objects with an impostor, current or not
+        int pending = 0;                    // Requested by draw(), waiting for bake()
+        int bakedLastCall = 0;              // Objects baked by the last bake()
+        double bakeMilliseconds = 0.0;      // CPU time of the last bake()
+        qint64 quadsDrawn = 0;              // Since the last resetStats()
+        qint64 atlasBytes = 0;
+    };
+
+    ImpostorCache() = default;
+
+    /**
+     * @brief Creates the atlas, its framebuffer and the quad program.
+     * @return false if the program does not build or the atlas is incomplete.
+     */
+    bool initialize() { return initialize(Params()); }
+    bool initialize(const Params &params);
+    /**
+     * @brief Deletes all GL resources and objects; call with the context current before it goes away.
+     */
+    void release();
+    bool isInitialized() const { return initialized; }
+
+    /**
+     * @brief Registers an object bounded by the sphere (@p center, @p radius) in its own space.
+     * @return Its id, or -1 when all maxObjects layers are in use.
+     */
+    int addObject(const QVector3D &center, float radius, const DrawFunction &draw);
+    int objectCount() const { return objects.size(); }
+    /**
+     * @brief Marks the object's impostor stale; it is baked again once draw() has asked for it.
+     */
+    void invalidate(int object);
+    bool isBaked(int object) const { return object >= 0 && object < objects.size() && objects[object].baked; }
+
+    /**
+     * @brief Bakes up to bakesPerFrame requested objects that are missing or stale.
+     * @return The number of objects baked.
+     *
+     * Restores the framebuffer, viewport, scissor and depth test enables and the GL_TEXTURE_2D_ARRAY
+     * binding of the active texture unit. The atlas is cleared with glClearBuffer*(), so the clear
+     * color is untouched.
+     */
+    int bake();
+
+    /**
+     * @brief Splits @p count instance transforms of @p object at @p distance from @p camera.
+     *
+     * Instances whose bounding sphere center is closer than @p distance are
+     * appended to @p nearTransforms, the rest to @p farTransforms.
+     */
+    void partition(int object, const float *transforms, int count, const QVector3D &camera, float distance,
+                   QVector<float> *nearTransforms, QVector<float> *farTransforms) const;
+
+    /**
+     * @brief Draws @p count instances of @p object as impostors, one instanced draw.
+     * @return false if the object has no impostor yet; it is then requested for the next bake().
+     */
+    bool draw(int object, const QMatrix4x4 &viewProjection, const QVector3D &camera, const float *transforms,
+              int count);
+
+    /**
+     * @brief Distance beyond which a sphere of @p radius covers fewer than @p pixels vertically.
+     */
+    static float switchDistance(float radius, float verticalFovDegrees, int viewportHeight, float pixels);
+
+    Stats stats() const;
+    void resetStats() { quadsDrawn = 0; }
+
+private:
+    struct Object {
+        QVector3D center;
+        float radius = 1.0f;
+        DrawFunction draw;
+        bool baked = false;
+        bool stale = true;
+        bool requested = false;             // draw() wanted it since it became stale
+    };
+
+    bool buildProgram();
+    void bakeObject(int object);
+
+    Params parameters;
+    bool initialized = false;
+    QVector<Object> objects;
+
+    QOpenGLShaderProgram *program = nullptr;
+    GLuint atlas = 0;                       // GL_TEXTURE_2D_ARRAY, one layer per object
+    GLuint depthBuffer = 0;
+    GLuint framebuffer = 0;
+    GLuint vao = 0;
+    GLuint cornerBuffer = 0;
+    GLuint instanceBuffer = 0;              // Streamed: the transforms of one draw()
+    qint64 instanceCapacity = 0;            // Bytes
+    int atlasSize = 0;                      // viewsPerSide * viewSize
+
+    int bakedLastCall = 0;
+    double bakeMilliseconds = 0.0;
+    qint64 quadsDrawn = 0;
+
+    GpuMemoryTracker::Handle atlasMemory = 0;
+    GpuMemoryTracker::Handle depthMemory = 0;
+    GpuMemoryTracker::Handle instanceMemory = 0;
+};
+
+#endif // IMPOSTOR_H
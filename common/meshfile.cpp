@@ -0,0 +1,402 @@
+#include "meshfile.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MESHFILE_SSE2
+#endif
+
+// ------------------- Codec -------------------
+
+static quint64 alignUp(quint64 value, quint64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static quint32 readValue(const uchar *source, int bytes)
+{
+    if (bytes == 2) {
+        quint16 value;
+        std::memcpy(&value, source, 2);
+        return value;
+    }
+    quint32 value;
+    std::memcpy(&value, source, 4);
+    return value;
+}
+
+// Appends @p count values of each column: a mask byte and the non-zero byte planes per block of 16
+static void encodeColumns(const uchar *data, int count, int columns, int columnBytes, int stride, QByteArray *out)
+{
+    using meshfile::BlockValues;
+    for (int column = 0; column < columns; ++column) {
+        quint32 previous = 0;
+        for (int block = 0; block < count; block += BlockValues) {
+            quint8 planes[4][BlockValues] = {};
+            for (int k = 0; k < BlockValues && block + k < count; ++k) {
+                const quint32 value = readValue(data + qint64(block + k) * stride + column * columnBytes, columnBytes);
+                const quint32 delta = value - previous;
+                previous = value;
+                // Zigzag: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+                const quint32 zigzag = (delta << 1) ^ quint32(qint32(delta) >> 31);
+                for (int b = 0; b < 4; ++b) {
+                    planes[b][k] = quint8(zigzag >> (8 * b));
+                }
+            }
+            quint8 mask = 0;
+            for (int b = 0; b < 4; ++b) {
+                for (int k = 0; k < BlockValues; ++k) {
+                    if (planes[b][k] != 0) {
+                        mask |= quint8(1 << b);
+                        break;
+                    }
+                }
+            }
+            out->append(char(mask));
+            for (int b = 0; b < 4; ++b) {
+                if (mask & (1 << b)) {
+                    out->append(reinterpret_cast<const char *>(planes[b]), BlockValues);
+                }
+            }
+        }
+    }
+}
+
+// Turns one block back into 16 values, continuing the running sum from @p previous
+static void decodeBlock(const uchar *planes, quint8 mask, quint32 previous, quint32 *values)
+{
+#ifdef MESHFILE_SSE2
+    __m128i plane[4];
+    for (int b = 0; b < 4; ++b) {
+        if (mask & (1 << b)) {
+            plane[b] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(planes));
+            planes += meshfile::BlockValues;
+        } else {
+            plane[b] = _mm_setzero_si128();
+        }
+    }
+    // Interleave the planes back into 32-bit values: bytes 0+1 and 2+3 into 16-bit halves, then the halves
+    const __m128i low01 = _mm_unpacklo_epi8(plane[0], plane[1]);
+    const __m128i high01 = _mm_unpackhi_epi8(plane[0], plane[1]);
+    const __m128i low23 = _mm_unpacklo_epi8(plane[2], plane[3]);
+    const __m128i high23 = _mm_unpackhi_epi8(plane[2], plane[3]);
+    __m128i quads[4] = {
+        _mm_unpacklo_epi16(low01, low23),
+        _mm_unpackhi_epi16(low01, low23),
+        _mm_unpacklo_epi16(high01, high23),
+        _mm_unpackhi_epi16(high01, high23),
+    };
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i carry = _mm_set1_epi32(int(previous));
+    for (__m128i &v : quads) {
+        // Undo the zigzag, then a prefix sum over the four lanes plus the carry of the previous four
+        v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, carry);
+        carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    for (int q = 0; q < 4; ++q) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(values + 4 * q), quads[q]);
+    }
+#else
+    const uchar *plane[4] = {};
+    for (int b = 0; b < 4; ++b) {
+        if (mask & (1 << b)) {
+            plane[b] = planes;
+            planes += meshfile::BlockValues;
+        }
+    }
+    for (int k = 0; k < meshfile::BlockValues; ++k) {
+        quint32 zigzag = 0;
+        for (int b = 0; b < 4; ++b) {
+            if (plane[b]) {
+                zigzag |= quint32(plane[b][k]) << (8 * b);
+            }
+        }
+        previous += (zigzag >> 1) ^ (0u - (zigzag & 1u));
+        values[k] = previous;
+    }
+#endif
+}
+
+static bool decodeColumns(const uchar *in, qint64 size, uchar *out, int count, int columns, int columnBytes,
+                          int stride)
+{
+    using meshfile::BlockValues;
+    const uchar *cursor = in;
+    const uchar *end = in + size;
+    quint32 values[BlockValues];
+    for (int column = 0; column < columns; ++column) {
+        quint32 previous = 0;
+        for (int block = 0; block < count; block += BlockValues) {
+            if (cursor >= end || (*cursor & 0xf0) != 0) {
+                return false;
+            }
+            const quint8 mask = *cursor++;
+            const int stored = ((mask >> 0) & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+            if (end - cursor < stored * BlockValues) {
+                return false;
+            }
+            decodeBlock(cursor, mask, previous, values);
+            cursor += stored * BlockValues;
+            previous = values[BlockValues - 1];   // Padding past the last value adds zero
+
+            const int n = qMin(BlockValues, count - block);
+            uchar *target = out + qint64(block) * stride + column * columnBytes;
+            if (columnBytes == 4) {
+                for (int k = 0; k < n; ++k) {
+                    std::memcpy(target + qint64(k) * stride, &values[k], 4);
+                }
+            } else {
+                for (int k = 0; k < n; ++k) {
+                    const quint16 value = quint16(values[k]);
+                    std::memcpy(target + qint64(k) * stride, &value, 2);
+                }
+            }
+        }
+    }
+    return cursor == end;
+}
+
+// ------------------- Opening -------------------
+
+MeshFile::~MeshFile()
+{
+    close();
+}
+
+bool MeshFile::open(const QString &filePath)
+{
+    using namespace meshfile;
+    close();
+
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "MeshFile: cannot open" << filePath;
+        return false;
+    }
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(MeshHeader))) {
+        qWarning() << "MeshFile:" << filePath << "is too small";
+        close();
+        return false;
+    }
+    begin = file.map(0, size);
+    if (!begin) {
+        qWarning() << "MeshFile: cannot map" << filePath;
+        close();
+        return false;
+    }
+
+    std::memcpy(&fileHeader, begin, sizeof(fileHeader));
+    const MeshHeader &h = fileHeader;
+    if (h.magic != Magic || h.version != Version || h.fileSize != quint64(size)) {
+        qWarning() << "MeshFile:" << filePath << "is not a version" << Version << "mesh file";
+        close();
+        return false;
+    }
+
+    // Everything GL will be pointed at is checked here; index values are not (that would page in the stream)
+    const quint64 tablesEnd = sizeof(MeshHeader) + quint64(h.attributeCount) * sizeof(VertexAttribute)
+                              + quint64(h.lodCount) * sizeof(LodRange);
+    const auto streamOk = [&](const StreamHeader &stream, quint64 rawSize) {
+        return stream.rawSize == rawSize && stream.offset >= tablesEnd && stream.offset % StreamAlignment == 0
+               && stream.offset + stream.storedSize <= h.fileSize
+               && (stream.encoding == Encoding::DeltaZigzagPlanes
+                   || (stream.encoding == Encoding::Raw && stream.storedSize == stream.rawSize));
+    };
+    bool ok = h.vertexStride > 0 && (h.indexSize == 2 || h.indexSize == 4) && tablesEnd <= h.fileSize
+              && streamOk(h.vertices, quint64(h.vertexCount) * h.vertexStride)
+              && streamOk(h.indices, quint64(h.indexCount) * h.indexSize)
+              && (h.vertices.encoding == Encoding::Raw || h.vertexStride % 4 == 0);
+    if (ok) {
+        attributeList = reinterpret_cast<const VertexAttribute *>(begin + sizeof(MeshHeader));
+        lodList = reinterpret_cast<const LodRange *>(attributeList + h.attributeCount);
+        for (quint32 i = 0; ok && i < h.attributeCount; ++i) {
+            const VertexAttribute &a = attributeList[i];
+            ok = a.components >= 1 && a.components <= 4 && quint8(a.type) <= quint8(ComponentType::Int16)
+                 && a.offset + quint32(a.components) * componentBytes(a.type) <= h.vertexStride;
+        }
+        for (quint32 i = 0; ok && i < h.lodCount; ++i) {
+            ok = quint64(lodList[i].firstIndex) + lodList[i].indexCount <= h.indexCount;
+        }
+    }
+    if (!ok) {
+        qWarning() << "MeshFile: corrupt header in" << filePath;
+        close();
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    vertexBytes = begin + h.vertices.offset;
+    indexBytes = begin + h.indices.offset;
+    if (h.vertices.encoding != Encoding::Raw) {
+        if (!decode(h.vertices, int(h.vertexStride / 4), 4, int(h.vertexStride), &decodedVertices)) {
+            close();
+            return false;
+        }
+        vertexBytes = reinterpret_cast<const uchar *>(decodedVertices.constData());
+    }
+    if (h.indices.encoding != Encoding::Raw) {
+        if (!decode(h.indices, 1, int(h.indexSize), int(h.indexSize), &decodedIndices)) {
+            close();
+            return false;
+        }
+        indexBytes = reinterpret_cast<const uchar *>(decodedIndices.constData());
+    }
+    decodeTime = timer.nsecsElapsed() / 1.0e6;
+
+    if (isCompressed()) {
+        qDebug() << "MeshFile: mapped" << filePath << "with" << h.vertexCount << "vertices," << h.indexCount
+                 << "indices, decoded in" << decodeTime << "ms";
+    } else {
+        qDebug() << "MeshFile: mapped" << filePath << "with" << h.vertexCount << "vertices," << h.indexCount
+                 << "indices";
+    }
+    return true;
+}
+
+bool MeshFile::decode(const meshfile::StreamHeader &stream, int columns, int columnBytes, int stride,
+                      QByteArray *output)
+{
+    const int count = stride > 0 ? int(stream.rawSize / quint64(stride)) : 0;
+    output->resize(qsizetype(stream.rawSize));
+    if (!decodeColumns(begin + stream.offset, qint64(stream.storedSize), reinterpret_cast<uchar *>(output->data()),
+                       count, columns, columnBytes, stride)) {
+        qWarning() << "MeshFile: corrupt compressed stream in" << file.fileName();
+        output->clear();
+        return false;
+    }
+    return true;
+}
+
+void MeshFile::close()
+{
+    if (begin) {
+        file.unmap(const_cast<uchar *>(begin));
+    }
+    file.close();
+    begin = nullptr;
+    fileHeader = meshfile::MeshHeader();
+    attributeList = nullptr;
+    lodList = nullptr;
+    vertexBytes = nullptr;
+    indexBytes = nullptr;
+    decodedVertices.clear();
+    decodedIndices.clear();
+    decodeTime = 0.0;
+}
+
+// ------------------- Lookup -------------------
+
+const meshfile::VertexAttribute *MeshFile::attribute(meshfile::Semantic semantic) const
+{
+    for (int i = 0; i < attributeCount(); ++i) {
+        if (attributeList[i].semantic == semantic) {
+            return &attributeList[i];
+        }
+    }
+    return nullptr;
+}
+
+const meshfile::VertexAttribute *MeshFile::colorAttribute() const
+{
+    const meshfile::VertexAttribute *color = attribute(meshfile::Semantic::Color);
+    return color ? color : attribute(meshfile::Semantic::Normal);
+}
+
+QMatrix4x4 MeshFile::fitTransform(float size) const
+{
+    const QVector3D boundsMin(fileHeader.boundsMin[0], fileHeader.boundsMin[1], fileHeader.boundsMin[2]);
+    const QVector3D boundsMax(fileHeader.boundsMax[0], fileHeader.boundsMax[1], fileHeader.boundsMax[2]);
+    const QVector3D extent = boundsMax - boundsMin;
+    const float largest = qMax(extent.x(), qMax(extent.y(), extent.z()));
+    QMatrix4x4 fit;
+    fit.scale(largest > 0.0f ? size / largest : 1.0f);
+    fit.translate(-0.5f * (boundsMin + boundsMax));
+    return fit;
+}
+
+bool MeshFile::isCompressed() const
+{
+    return fileHeader.vertices.encoding != meshfile::Encoding::Raw
+           || fileHeader.indices.encoding != meshfile::Encoding::Raw;
+}
+
+// ------------------- Writing -------------------
+
+bool MeshFile::write(const QString &filePath, const MeshData &mesh, meshfile::Encoding encoding)
+{
+    using namespace meshfile;
+    if (mesh.vertexStride == 0 || quint64(mesh.vertices.size()) != quint64(mesh.vertexCount) * mesh.vertexStride
+        || (mesh.indexSize != 2 && mesh.indexSize != 4) || mesh.indices.size() % mesh.indexSize != 0) {
+        qWarning() << "MeshFile: inconsistent mesh for" << filePath;
+        return false;
+    }
+
+    MeshHeader header;
+    header.vertexCount = mesh.vertexCount;
+    header.vertexStride = mesh.vertexStride;
+    header.indexCount = mesh.indexCount();
+    header.indexSize = mesh.indexSize;
+    header.attributeCount = quint32(mesh.attributes.size());
+    QVector<LodRange> lods = mesh.lods;
+    if (lods.isEmpty()) {
+        lods.append({ 0, header.indexCount, 0.0f, 0 });
+    }
+    header.lodCount = quint32(lods.size());
+    std::memcpy(header.boundsMin, mesh.boundsMin, sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, mesh.boundsMax, sizeof(header.boundsMax));
+
+    // Vertices whose stride is not a whole number of words stay raw
+    QByteArray vertexStream = mesh.vertices;
+    QByteArray indexStream = mesh.indices;
+    header.vertices.encoding = Encoding::Raw;
+    header.indices.encoding = Encoding::Raw;
+    if (encoding == Encoding::DeltaZigzagPlanes) {
+        if (mesh.vertexStride % 4 == 0) {
+            vertexStream.clear();
+            encodeColumns(reinterpret_cast<const uchar *>(mesh.vertices.constData()), int(mesh.vertexCount),
+                          int(mesh.vertexStride / 4), 4, int(mesh.vertexStride), &vertexStream);
+            header.vertices.encoding = encoding;
+        }
+        indexStream.clear();
+        encodeColumns(reinterpret_cast<const uchar *>(mesh.indices.constData()), int(header.indexCount), 1,
+                      int(mesh.indexSize), int(mesh.indexSize), &indexStream);
+        header.indices.encoding = encoding;
+    }
+
+    const quint64 tablesEnd = sizeof(MeshHeader) + quint64(mesh.attributes.size()) * sizeof(VertexAttribute)
+                              + quint64(lods.size()) * sizeof(LodRange);
+    header.vertices.offset = alignUp(tablesEnd, StreamAlignment);
+    header.vertices.storedSize = quint64(vertexStream.size());
+    header.vertices.rawSize = quint64(mesh.vertices.size());
+    header.indices.offset = alignUp(header.vertices.offset + header.vertices.storedSize, StreamAlignment);
+    header.indices.storedSize = quint64(indexStream.size());
+    header.indices.rawSize = quint64(mesh.indices.size());
+    header.fileSize = header.indices.offset + header.indices.storedSize;
+
+    QSaveFile out(filePath);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << "MeshFile: cannot write" << filePath;
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(mesh.attributes.constData()),
+              qint64(mesh.attributes.size()) * sizeof(VertexAttribute));
+    out.write(reinterpret_cast<const char *>(lods.constData()), qint64(lods.size()) * sizeof(LodRange));
+    out.write(QByteArray(int(header.vertices.offset - tablesEnd), '\0'));
+    out.write(vertexStream);
+    out.write(QByteArray(int(header.indices.offset - header.vertices.offset - header.vertices.storedSize), '\0'));
+    out.write(indexStream);
+    if (!out.commit()) {
+        qWarning() << "MeshFile: cannot write" << filePath << ":" << out.errorString();
+        return false;
+    }
+    return true;
+}
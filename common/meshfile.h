@@ -0,0 +1,144 @@
+#ifndef MESHFILE_H
+#define MESHFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMatrix4x4>
+#include <QString>
+#include <QVector>
+#include <qopengl.h>
+#include "meshfileformat.h"
+
+namespace meshfile {
+
+/**
+ * @brief GL type of a vertex attribute component, for glVertexAttribPointer().
+ */
+inline GLenum glComponentType(ComponentType type)
+{
+    switch (type) {
+    case ComponentType::UInt8:
+        return GL_UNSIGNED_BYTE;
+    case ComponentType::Int8:
+        return GL_BYTE;
+    case ComponentType::UInt16:
+        return GL_UNSIGNED_SHORT;
+    case ComponentType::Int16:
+        return GL_SHORT;
+    default:
+        return GL_FLOAT;
+    }
+}
+
+} // namespace meshfile
+
+// ------------------- Mesh Data -------------------
+
+/**
+ * @brief A mesh in memory, as written by MeshFile::write().
+ */
+struct MeshData {
+    QVector<meshfile::VertexAttribute> attributes;
+    quint32 vertexStride = 0;
+    quint32 vertexCount = 0;
+    QByteArray vertices;                    // vertexCount * vertexStride bytes, interleaved
+    quint32 indexSize = 4;                  // 2 or 4
+    QByteArray indices;
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+    QVector<meshfile::LodRange> lods;       // Empty: one LOD covering every index
+
+    quint32 indexCount() const { return indexSize ? quint32(indices.size() / indexSize) : 0; }
+};
+
+// ------------------- Mesh File -------------------
+
+/**
+ * @brief Read-only view of a mesh container (common/meshfileformat.h), written by tools/meshconv.
+ *
+ * open() maps the file and validates the header. Raw streams are returned as
+ * pointers into the mapping, 64-byte aligned, ready for glBufferData(); the
+ * pages are read by the OS when GL copies them. Compressed streams are decoded
+ * once at open() into owned buffers, with SSE2 where available. Pointers stay
+ * valid until close().
+ */
+class MeshFile
+{
+public:
+    MeshFile() = default;
+    ~MeshFile();
+
+    bool open(const QString &filePath);
+    void close();
+    bool isOpen() const { return begin != nullptr; }
+
+    const meshfile::MeshHeader &header() const { return fileHeader; }
+    int attributeCount() const { return int(fileHeader.attributeCount); }
+    const meshfile::VertexAttribute *attributes() const { return attributeList; }
+    /**
+     * @brief First attribute with @p semantic, nullptr if the mesh has none.
+     */
+    const meshfile::VertexAttribute *attribute(meshfile::Semantic semantic) const;
+    /**
+     * @brief Vertex colors if the mesh has them, else its normals, which stand in for colors.
+     */
+    const meshfile::VertexAttribute *colorAttribute() const;
+    int lodCount() const { return int(fileHeader.lodCount); }
+    const meshfile::LodRange *lods() const { return lodList; }
+    /**
+     * @brief Indices of the finest LOD, or all of them if the file has no LODs.
+     */
+    quint32 drawIndexCount() const { return lodCount() > 0 ? lodList[0].indexCount : fileHeader.indexCount; }
+    GLenum glIndexType() const { return fileHeader.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+    /**
+     * @brief Centers the bounds on the origin and scales their largest extent to @p size.
+     */
+    QMatrix4x4 fitTransform(float size = 1.0f) const;
+
+    /**
+     * @brief Points @p location at @p attribute of the vertex stream and enables it.
+     *
+     * The buffer holding vertexData() must be bound to GL_ARRAY_BUFFER. @p gl
+     * is the caller's function table, e.g. this->glVertexAttribPointer() of a
+     * QOpenGLFunctions or QOpenGLFunctions_3_3_Core subclass.
+     */
+    template <typename Functions>
+    void bindAttribute(Functions *gl, GLuint location, const meshfile::VertexAttribute &attribute) const
+    {
+        gl->glVertexAttribPointer(location, attribute.components, meshfile::glComponentType(attribute.type),
+                                  attribute.normalized ? GL_TRUE : GL_FALSE, GLsizei(fileHeader.vertexStride),
+                                  reinterpret_cast<const void *>(quintptr(attribute.offset)));
+        gl->glEnableVertexAttribArray(location);
+    }
+
+    const uchar *vertexData() const { return vertexBytes; }
+    qint64 vertexDataSize() const { return qint64(fileHeader.vertices.rawSize); }
+    const uchar *indexData() const { return indexBytes; }
+    qint64 indexDataSize() const { return qint64(fileHeader.indices.rawSize); }
+
+    bool isCompressed() const;
+    double decodeMilliseconds() const { return decodeTime; }
+    QString filePath() const { return file.fileName(); }
+
+    /**
+     * @brief Writes @p mesh, with both streams in @p encoding.
+     */
+    static bool write(const QString &filePath, const MeshData &mesh, meshfile::Encoding encoding);
+
+private:
+    bool decode(const meshfile::StreamHeader &stream, int columns, int columnBytes, int stride,
+                QByteArray *output);
+
+    QFile file;
+    const uchar *begin = nullptr;
+    meshfile::MeshHeader fileHeader;
+    const meshfile::VertexAttribute *attributeList = nullptr;
+    const meshfile::LodRange *lodList = nullptr;
+    const uchar *vertexBytes = nullptr;
+    const uchar *indexBytes = nullptr;
+    QByteArray decodedVertices;
+    QByteArray decodedIndices;
+    double decodeTime = 0.0;
+};
+
+#endif // MESHFILE_H
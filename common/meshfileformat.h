@@ -0,0 +1,117 @@
+#ifndef MESHFILEFORMAT_H
+#define MESHFILEFORMAT_H
+
+#include <QtGlobal>
+
+// ------------------- Mesh File Format -------------------
+//
+// File layout (little endian):
+//   MeshHeader
+//   VertexAttribute[attributeCount]
+//   LodRange[lodCount]
+//   vertex stream                      (starts on a StreamAlignment boundary)
+//   index stream                       (starts on a StreamAlignment boundary)
+//
+// A Raw stream is the exact bytes glBufferData() takes: interleaved vertices of
+// vertexStride bytes, then indexSize-byte indices. Both streams start 64-byte
+// aligned in the file, so a mapping of it can be handed to GL as it is.
+//
+// A DeltaZigzagPlanes stream stores the same bytes transformed, column by column:
+// the vertices are cut into vertexStride / 4 columns of 32-bit words (the index
+// stream is a single column of indexSize-byte indices). Each value is replaced by
+// its difference to the previous value of the same column, zigzag-mapped so small
+// negative differences become small numbers, and every 16 values form a block
+// stored as byte planes: one mask byte whose bit b tells whether plane b (byte b
+// of the 16 values) is stored, followed by the stored planes of 16 bytes each.
+// Planes that are all zero, usually the high bytes, are left out.
+
+namespace meshfile {
+
+constexpr quint32 Magic = 0x48534d51;   // "QMSH"
+constexpr quint32 Version = 1;
+constexpr quint32 StreamAlignment = 64;
+constexpr int BlockValues = 16;
+
+enum class Semantic : quint8 {
+    Position = 0,
+    Normal,
+    Tangent,
+    TexCoord0,
+    TexCoord1,
+    Color,
+    Other
+};
+
+enum class ComponentType : quint8 {
+    Float32 = 0,
+    UInt8,
+    Int8,
+    UInt16,
+    Int16
+};
+
+enum class Encoding : quint32 {
+    Raw = 0,
+    DeltaZigzagPlanes
+};
+
+struct VertexAttribute {
+    Semantic semantic = Semantic::Other;
+    ComponentType type = ComponentType::Float32;
+    quint8 components = 0;
+    quint8 normalized = 0;   // Integer types only: 1 maps them to [0, 1] / [-1, 1]
+    quint32 offset = 0;      // Into a vertex
+};
+
+struct LodRange {
+    quint32 firstIndex = 0;
+    quint32 indexCount = 0;
+    float error = 0.0f;      // Object-space error against LOD 0
+    quint32 reserved = 0;
+};
+
+struct StreamHeader {
+    quint64 offset = 0;      // From the start of the file
+    quint64 storedSize = 0;  // Bytes in the file
+    quint64 rawSize = 0;     // Bytes once decoded
+    Encoding encoding = Encoding::Raw;
+    quint32 reserved = 0;
+};
+
+struct MeshHeader {
+    quint32 magic = Magic;
+    quint32 version = Version;
+    quint32 vertexCount = 0;
+    quint32 vertexStride = 0;
+    quint32 indexCount = 0;
+    quint32 indexSize = 0;   // 2 or 4
+    quint32 attributeCount = 0;
+    quint32 lodCount = 0;
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+    StreamHeader vertices;
+    StreamHeader indices;
+    quint64 fileSize = 0;
+};
+
+static_assert(sizeof(VertexAttribute) == 8, "VertexAttribute layout changed");
+static_assert(sizeof(LodRange) == 16, "LodRange layout changed");
+static_assert(sizeof(StreamHeader) == 32, "StreamHeader layout changed");
+static_assert(sizeof(MeshHeader) == 128, "MeshHeader layout changed");
+
+inline int componentBytes(ComponentType type)
+{
+    switch (type) {
+    case ComponentType::Float32:
+        return 4;
+    case ComponentType::UInt16:
+    case ComponentType::Int16:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+} // namespace meshfile
+
+#endif // MESHFILEFORMAT_H
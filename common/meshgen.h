@@ -0,0 +1,638 @@
+#ifndef MESHGEN_H
+#define MESHGEN_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// ------------------- Parametric Mesh Generators -------------------
+//
+// Header-only generators for cubes, UV / icosahedral spheres, plane grids and
+// tori. Every shape exists twice with the same parameters:
+//
+//   static constexpr auto sphere = meshgen::uvSphere<meshgen::PosUv, 32, 16>();  // compile time
+//   meshgen::Mesh<meshgen::PosUv> sphere = meshgen::makeUvSphere<meshgen::PosUv>(slices, stacks);
+//
+// The compile-time form returns a StaticMesh of std::arrays sized from the
+// template arguments; declared static constexpr, its data is emitted into
+// .rodata and nothing is built or allocated at startup. The runtime form
+// returns the same data in std::vectors for tessellations chosen at run time.
+// Both run the same builder code (including the constexpr sin/cos/sqrt
+// below), so they produce identical vertices.
+//
+// Shapes are unit sized and centered at the origin: the cube spans
+// [-0.5, 0.5], spheres have radius 0.5, the grid is a 1x1 plane at y = 0 and
+// the torus fits the same box. Scale them with the model matrix. Triangles
+// are counter-clockwise seen from outside; indices are unsigned int, as
+// passed to glDrawElements(GL_UNSIGNED_INT).
+//
+// The vertex layout is a template parameter: Pos, PosColor or PosUv below, or
+// any type with the same members.
+
+namespace meshgen {
+
+// ------------------- Vertex Layouts -------------------
+
+/**
+ * @brief Everything a generator knows about a vertex; a layout picks what it stores.
+ */
+struct Vertex {
+    float position[3] = {};
+    float normal[3] = {};
+    float uv[2] = {};
+};
+
+struct Pos {
+    static constexpr int Floats = 3;
+    static constexpr bool HasColor = false;
+    static constexpr bool HasUv = false;
+
+    static constexpr void write(float *out, const Vertex &v)
+    {
+        out[0] = v.position[0];
+        out[1] = v.position[1];
+        out[2] = v.position[2];
+    }
+};
+
+/**
+ * @brief Position + RGB color, the color being the position mapped from the unit box to [0, 1].
+ */
+struct PosColor {
+    static constexpr int Floats = 6;
+    static constexpr int ColorOffset = 3;
+    static constexpr bool HasColor = true;
+    static constexpr bool HasUv = false;
+
+    static constexpr void write(float *out, const Vertex &v)
+    {
+        for (int i = 0; i < 3; ++i) {
+            out[i] = v.position[i];
+            out[ColorOffset + i] = v.position[i] + 0.5f;
+        }
+    }
+};
+
+struct PosUv {
+    static constexpr int Floats = 5;
+    static constexpr int UvOffset = 3;
+    static constexpr bool HasColor = false;
+    static constexpr bool HasUv = true;
+
+    static constexpr void write(float *out, const Vertex &v)
+    {
+        out[0] = v.position[0];
+        out[1] = v.position[1];
+        out[2] = v.position[2];
+        out[UvOffset] = v.uv[0];
+        out[UvOffset + 1] = v.uv[1];
+    }
+};
+
+// ------------------- Mesh Containers -------------------
+
+template <typename Layout, std::size_t VertexCount, std::size_t IndexCount>
+struct StaticMesh {
+    using LayoutType = Layout;
+
+    std::array<float, VertexCount * Layout::Floats> vertices{};
+    std::array<unsigned int, IndexCount> indices{};
+
+    static constexpr std::size_t vertexCount() { return VertexCount; }
+    static constexpr std::size_t indexCount() { return IndexCount; }
+    static constexpr std::size_t vertexBytes() { return VertexCount * Layout::Floats * sizeof(float); }
+    static constexpr std::size_t indexBytes() { return IndexCount * sizeof(unsigned int); }
+    static constexpr int stride() { return Layout::Floats * int(sizeof(float)); }
+};
+
+template <typename Layout>
+struct Mesh {
+    using LayoutType = Layout;
+
+    Mesh() = default;
+    Mesh(std::size_t vertexCount, std::size_t indexCount)
+        : vertices(vertexCount * Layout::Floats), indices(indexCount)
+    {
+    }
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+
+    std::size_t vertexCount() const { return vertices.size() / Layout::Floats; }
+    std::size_t indexCount() const { return indices.size(); }
+    std::size_t vertexBytes() const { return vertices.size() * sizeof(float); }
+    std::size_t indexBytes() const { return indices.size() * sizeof(unsigned int); }
+    static constexpr int stride() { return Layout::Floats * int(sizeof(float)); }
+};
+
+// ------------------- Vertex / Index Counts -------------------
+
+constexpr std::size_t cubeVertexCount(int subdivisions) { return 6 * std::size_t(subdivisions + 1) * (subdivisions + 1); }
+constexpr std::size_t cubeIndexCount(int subdivisions) { return 36 * std::size_t(subdivisions) * subdivisions; }
+constexpr std::size_t uvSphereVertexCount(int slices, int stacks) { return std::size_t(slices + 1) * (stacks + 1); }
+constexpr std::size_t uvSphereIndexCount(int slices, int stacks) { return 6 * std::size_t(slices) * stacks; }
+constexpr std::size_t icoSphereVertexCount(int frequency) { return 20 * std::size_t(frequency + 1) * (frequency + 2) / 2; }
+constexpr std::size_t icoSphereIndexCount(int frequency) { return 60 * std::size_t(frequency) * frequency; }
+constexpr std::size_t gridVertexCount(int columns, int rows) { return std::size_t(columns + 1) * (rows + 1); }
+constexpr std::size_t gridIndexCount(int columns, int rows) { return 6 * std::size_t(columns) * rows; }
+constexpr std::size_t torusVertexCount(int rings, int sides) { return std::size_t(rings + 1) * (sides + 1); }
+constexpr std::size_t torusIndexCount(int rings, int sides) { return 6 * std::size_t(rings) * sides; }
+
+namespace detail {
+
+// ------------------- constexpr Math -------------------
+// <cmath> is not constexpr before C++26; these are accurate to float precision.
+
+constexpr double Pi = 3.14159265358979323846;
+
+constexpr double floorValue(double x)
+{
+    const double truncated = double((long long)x);
+    return x < truncated ? truncated - 1.0 : truncated;
+}
+
+constexpr double sinValue(double x)
+{
+    x -= 2.0 * Pi * floorValue((x + Pi) / (2.0 * Pi));   // [-pi, pi)
+    if (x > Pi / 2) {
+        x = Pi - x;
+    } else if (x < -Pi / 2) {
+        x = -Pi - x;
+    }
+    const double x2 = x * x;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 10; ++n) {
+        term *= -x2 / double((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cosValue(double x)
+{
+    return sinValue(x + Pi / 2);
+}
+
+constexpr double sqrtValue(double x)
+{
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    double guess = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 64; ++i) {
+        const double next = 0.5 * (guess + x / guess);
+        if (next == guess) {
+            break;
+        }
+        guess = next;
+    }
+    return guess;
+}
+
+constexpr double atanValue(double x)
+{
+    if (x < 0.0) {
+        return -atanValue(-x);
+    }
+    if (x > 1.0) {
+        return Pi / 2 - atanValue(1.0 / x);
+    }
+    // atan(x) = 2 atan(x / (1 + sqrt(1 + x^2))), twice: |x| <= tan(pi / 16) for a short series
+    for (int i = 0; i < 2; ++i) {
+        x = x / (1.0 + sqrtValue(1.0 + x * x));
+    }
+    const double x2 = x * x;
+    double power = x;
+    double sum = 0.0;
+    for (int n = 0; n < 12; ++n) {
+        sum += (n % 2 == 0 ? power : -power) / double(2 * n + 1);
+        power *= x2;
+    }
+    return 4.0 * sum;
+}
+
+constexpr double atan2Value(double y, double x)
+{
+    if (x > 0.0) {
+        return atanValue(y / x);
+    }
+    if (x < 0.0) {
+        return y >= 0.0 ? atanValue(y / x) + Pi : atanValue(y / x) - Pi;
+    }
+    return y > 0.0 ? Pi / 2 : (y < 0.0 ? -Pi / 2 : 0.0);
+}
+
+// ------------------- Builders -------------------
+// Shared by the compile-time and the runtime generators: MeshType is a
+// StaticMesh or a Mesh already sized from the counts above.
+
+template <typename Layout, typename MeshType>
+constexpr void emit(MeshType &mesh, std::size_t index, const Vertex &vertex)
+{
+    Layout::write(&mesh.vertices[index * Layout::Floats], vertex);
+}
+
+// Two counter-clockwise triangles for the quad a-b-c-d
+template <typename MeshType>
+constexpr void quad(MeshType &mesh, std::size_t &cursor, unsigned int a, unsigned int b, unsigned int c, unsigned int d)
+{
+    const unsigned int corners[6] = { a, b, c, c, d, a };
+    for (unsigned int corner : corners) {
+        mesh.indices[cursor++] = corner;
+    }
+}
+
+// Face order, and each face's (normal, u axis, v axis), as 06_3D_TexturedCube's dice:
+// +Z, -Z, +Y, -Y, +X, -X; u x v = normal so the faces wind counter-clockwise from outside.
+constexpr float CubeFaces[6][3][3] = {
+    { { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+    { { 0, 0, -1 }, { -1, 0, 0 }, { 0, 1, 0 } },
+    { { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+    { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+    { { 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } },
+    { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+};
+
+template <typename Layout, typename MeshType>
+constexpr void buildCube(MeshType &mesh, int subdivisions)
+{
+    const int n = subdivisions;
+    const unsigned int perFace = unsigned((n + 1) * (n + 1));
+    std::size_t cursor = 0;
+
+    for (int face = 0; face < 6; ++face) {
+        const auto &axes = CubeFaces[face];
+        const unsigned int first = unsigned(face) * perFace;
+        for (int j = 0; j <= n; ++j) {
+            for (int i = 0; i <= n; ++i) {
+                const float s = float(i) / float(n);
+                const float t = float(j) / float(n);
+                Vertex vertex;
+                for (int k = 0; k < 3; ++k) {
+                    vertex.position[k] = 0.5f * axes[0][k] + (s - 0.5f) * axes[1][k] + (t - 0.5f) * axes[2][k];
+                    vertex.normal[k] = axes[0][k];
+                }
+                vertex.uv[0] = s;
+                vertex.uv[1] = t;
+                emit<Layout>(mesh, first + unsigned(j * (n + 1) + i), vertex);
+            }
+        }
+        // Each face's indices are contiguous, so a face can be drawn on its own
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i < n; ++i) {
+                const unsigned int a = first + unsigned(j * (n + 1) + i);
+                quad(mesh, cursor, a, a + 1, a + unsigned(n + 1) + 1, a + unsigned(n + 1));
+            }
+        }
+    }
+}
+
+template <typename Layout, typename MeshType>
+constexpr void buildCubeCorners(MeshType &mesh)
+{
+    // Corner k has x, y, z = +0.5 where bit 0, 1, 2 of k is set
+    for (int k = 0; k < 8; ++k) {
+        Vertex vertex;
+        for (int axis = 0; axis < 3; ++axis) {
+            vertex.position[axis] = (k >> axis) & 1 ? 0.5f : -0.5f;
+            vertex.normal[axis] = vertex.position[axis] * float(2.0 / sqrtValue(3.0));
+        }
+        emit<Layout>(mesh, std::size_t(k), vertex);
+    }
+
+    auto corner = [](const float (&axes)[3][3], float s, float t) {
+        unsigned int index = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (0.5f * axes[0][axis] + s * axes[1][axis] + t * axes[2][axis] > 0.0f) {
+                index |= 1u << axis;
+            }
+        }
+        return index;
+    };
+    std::size_t cursor = 0;
+    for (const auto &axes : CubeFaces) {
+        quad(mesh, cursor, corner(axes, -0.5f, -0.5f), corner(axes, 0.5f, -0.5f), corner(axes, 0.5f, 0.5f),
+             corner(axes, -0.5f, 0.5f));
+    }
+}
+
+template <typename Layout, typename MeshType>
+constexpr void buildUvSphere(MeshType &mesh, int slices, int stacks)
+{
+    // Stack 0 is the north pole; the seam column is duplicated so u can run 0..1
+    for (int j = 0; j <= stacks; ++j) {
+        const double theta = Pi * j / stacks;
+        for (int i = 0; i <= slices; ++i) {
+            const double phi = 2.0 * Pi * i / slices;
+            const double direction[3] = { sinValue(theta) * sinValue(phi), cosValue(theta),
+                                          sinValue(theta) * cosValue(phi) };
+            Vertex vertex;
+            for (int k = 0; k < 3; ++k) {
+                vertex.position[k] = float(0.5 * direction[k]);
+                vertex.normal[k] = float(direction[k]);
+            }
+            vertex.uv[0] = float(i) / float(slices);
+            vertex.uv[1] = 1.0f - float(j) / float(stacks);
+            emit<Layout>(mesh, std::size_t(j) * (slices + 1) + i, vertex);
+        }
+    }
+
+    std::size_t cursor = 0;
+    for (int j = 0; j < stacks; ++j) {
+        for (int i = 0; i < slices; ++i) {
+            const unsigned int a = unsigned((j + 1) * (slices + 1) + i);   // Lower row
+            quad(mesh, cursor, a, a + 1, a + 1 - unsigned(slices + 1), a - unsigned(slices + 1));
+        }
+    }
+}
+
+template <typename Layout, typename MeshType>
+constexpr void buildIcoSphere(MeshType &mesh, int frequency)
+{
+    constexpr double t = 1.6180339887498948482;   // Golden ratio
+    constexpr double corners[12][3] = {
+        { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+        { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+        { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 },
+    };
+    constexpr int faces[20][3] = {
+        { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+        { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+        { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+        { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 },
+    };
+
+    // Every icosahedron face becomes a triangular grid of frequency^2 triangles, projected
+    // onto the sphere. Vertices on the original edges are duplicated between faces.
+    const int f = frequency;
+    const unsigned int perFace = unsigned((f + 1) * (f + 2) / 2);
+    auto gridIndex = [f](int row, int column) { return unsigned(row * (f + 1) - row * (row - 1) / 2 + column); };
+
+    std::size_t cursor = 0;
+    for (int face = 0; face < 20; ++face) {
+        const double *a = corners[faces[face][0]];
+        const double *b = corners[faces[face][1]];
+        const double *c = corners[faces[face][2]];
+        const unsigned int first = unsigned(face) * perFace;
+
+        for (int row = 0; row <= f; ++row) {
+            for (int column = 0; column <= f - row; ++column) {
+                double p[3] = {};
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = a[k] + (b[k] - a[k]) * column / f + (c[k] - a[k]) * row / f;
+                }
+                const double length = sqrtValue(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+                Vertex vertex;
+                for (int k = 0; k < 3; ++k) {
+                    vertex.normal[k] = float(p[k] / length);
+                    vertex.position[k] = 0.5f * vertex.normal[k];
+                }
+                // Same equirectangular mapping as uvSphere(); the seam is not split
+                double u = atan2Value(vertex.normal[0], vertex.normal[2]) / (2.0 * Pi);
+                if (u < 0.0) {
+                    u += 1.0;
+                }
+                const double y = vertex.normal[1];
+                vertex.uv[0] = float(u);
+                vertex.uv[1] = float(0.5 + atan2Value(y, sqrtValue(1.0 - y * y)) / Pi);
+                emit<Layout>(mesh, first + gridIndex(row, column), vertex);
+            }
+        }
+
+        for (int row = 0; row < f; ++row) {
+            for (int column = 0; column < f - row; ++column) {
+                const unsigned int up[3] = { gridIndex(row, column), gridIndex(row, column + 1), gridIndex(row + 1, column) };
+                for (unsigned int index : up) {
+                    mesh.indices[cursor++] = first + index;
+                }
+                if (column < f - row - 1) {
+                    const unsigned int down[3] = { gridIndex(row, column + 1), gridIndex(row + 1, column + 1),
+                                                   gridIndex(row + 1, column) };
+                    for (unsigned int index : down) {
+                        mesh.indices[cursor++] = first + index;
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename Layout, typename MeshType>
+constexpr void buildGrid(MeshType &mesh, int columns, int rows)
+{
+    // Plane at y = 0 facing +Y; u follows +X, v follows -Z like the cube's top face
+    for (int j = 0; j <= rows; ++j) {
+        for (int i = 0; i <= columns; ++i) {
+            const float s = float(i) / float(columns);
+            const float t = float(j) / float(rows);
+            Vertex vertex;
+            vertex.position[0] = s - 0.5f;
+            vertex.position[2] = 0.5f - t;
+            vertex.normal[1] = 1.0f;
+            vertex.uv[0] = s;
+            vertex.uv[1] = t;
+            emit<Layout>(mesh, std::size_t(j) * (columns + 1) + i, vertex);
+        }
+    }
+
+    std::size_t cursor = 0;
+    for (int j = 0; j < rows; ++j) {
+        for (int i = 0; i < columns; ++i) {
+            const unsigned int a = unsigned(j * (columns + 1) + i);
+            quad(mesh, cursor, a, a + 1, a + unsigned(columns + 1) + 1, a + unsigned(columns + 1));
+        }
+    }
+}
+
+template <typename Layout, typename MeshType>
+constexpr void buildTorus(MeshType &mesh, int rings, int sides)
+{
+    // Around the Y axis; major + minor radius = 0.5 so it fits the unit box like the other shapes
+    constexpr double major = 0.35;
+    constexpr double minor = 0.15;
+
+    for (int i = 0; i <= rings; ++i) {
+        const double phi = 2.0 * Pi * i / rings;
+        for (int j = 0; j <= sides; ++j) {
+            const double theta = 2.0 * Pi * j / sides;
+            const double normal[3] = { cosValue(theta) * sinValue(phi), sinValue(theta), cosValue(theta) * cosValue(phi) };
+            const double center[3] = { major * sinValue(phi), 0.0, major * cosValue(phi) };
+            Vertex vertex;
+            for (int k = 0; k < 3; ++k) {
+                vertex.position[k] = float(center[k] + minor * normal[k]);
+                vertex.normal[k] = float(normal[k]);
+            }
+            vertex.uv[0] = float(i) / float(rings);
+            vertex.uv[1] = float(j) / float(sides);
+            emit<Layout>(mesh, std::size_t(i) * (sides + 1) + j, vertex);
+        }
+    }
+
+    std::size_t cursor = 0;
+    for (int i = 0; i < rings; ++i) {
+        for (int j = 0; j < sides; ++j) {
+            const unsigned int a = unsigned(i * (sides + 1) + j);
+            quad(mesh, cursor, a, a + unsigned(sides + 1), a + unsigned(sides + 1) + 1, a + 1);
+        }
+    }
+}
+
+} // namespace detail
+
+// ------------------- Compile-Time Generators -------------------
+
+/**
+ * @brief Cube with 4 vertices per face (or a Subdivisions x Subdivisions grid per face).
+ *
+ * Faces are in 06's dice order (+Z, -Z, +Y, -Y, +X, -X), each with its own
+ * [0, 1] UVs and contiguous indices: face i is indices [i * 6 * N^2, (i + 1) * 6 * N^2).
+ */
+template <typename Layout, int Subdivisions = 1>
+constexpr auto cube()
+{
+    static_assert(Subdivisions >= 1, "a cube face needs at least one quad");
+    StaticMesh<Layout, cubeVertexCount(Subdivisions), cubeIndexCount(Subdivisions)> mesh{};
+    detail::buildCube<Layout>(mesh, Subdivisions);
+    return mesh;
+}
+
+/**
+ * @brief Cube sharing its 8 corners between faces (36 indices); no per-face UVs or normals.
+ */
+template <typename Layout>
+constexpr auto cubeCorners()
+{
+    static_assert(!Layout::HasUv, "shared corners cannot carry per-face texture coordinates; use cube()");
+    StaticMesh<Layout, 8, 36> mesh{};
+    detail::buildCubeCorners<Layout>(mesh);
+    return mesh;
+}
+
+template <typename Layout, int Slices, int Stacks>
+constexpr auto uvSphere()
+{
+    static_assert(Slices >= 3 && Stacks >= 2, "a sphere needs at least 3 slices and 2 stacks");
+    StaticMesh<Layout, uvSphereVertexCount(Slices, Stacks), uvSphereIndexCount(Slices, Stacks)> mesh{};
+    detail::buildUvSphere<Layout>(mesh, Slices, Stacks);
+    return mesh;
+}
+
+/**
+ * @brief Geodesic sphere: an icosahedron whose faces are split into Frequency^2 triangles.
+ *
+ * Frequency 2^n gives the same geometry as n recursive midpoint subdivisions.
+ */
+template <typename Layout, int Frequency = 1>
+constexpr auto icoSphere()
+{
+    static_assert(Frequency >= 1, "frequency must be at least 1");
+    StaticMesh<Layout, icoSphereVertexCount(Frequency), icoSphereIndexCount(Frequency)> mesh{};
+    detail::buildIcoSphere<Layout>(mesh, Frequency);
+    return mesh;
+}
+
+template <typename Layout, int Columns, int Rows>
+constexpr auto grid()
+{
+    static_assert(Columns >= 1 && Rows >= 1, "a grid needs at least one cell");
+    StaticMesh<Layout, gridVertexCount(Columns, Rows), gridIndexCount(Columns, Rows)> mesh{};
+    detail::buildGrid<Layout>(mesh, Columns, Rows);
+    return mesh;
+}
+
+template <typename Layout, int Rings, int Sides>
+constexpr auto torus()
+{
+    static_assert(Rings >= 3 && Sides >= 3, "a torus needs at least 3 rings and 3 sides");
+    StaticMesh<Layout, torusVertexCount(Rings, Sides), torusIndexCount(Rings, Sides)> mesh{};
+    detail::buildTorus<Layout>(mesh, Rings, Sides);
+    return mesh;
+}
+
+/**
+ * @brief Non-indexed copy of @p mesh (one vertex per index), for glDrawArrays.
+ */
+template <typename Layout, std::size_t VertexCount, std::size_t IndexCount>
+constexpr auto unindexed(const StaticMesh<Layout, VertexCount, IndexCount> &mesh)
+{
+    std::array<float, IndexCount * Layout::Floats> vertices{};
+    for (std::size_t i = 0; i < IndexCount; ++i) {
+        for (int k = 0; k < Layout::Floats; ++k) {
+            vertices[i * Layout::Floats + k] = mesh.vertices[mesh.indices[i] * Layout::Floats + k];
+        }
+    }
+    return vertices;
+}
+
+// ------------------- Runtime Generators -------------------
+// Same shapes and parameters as above, for tessellations known only at run time.
+// Invalid counts (below the compile-time minimums) return an empty mesh.
+
+template <typename Layout>
+Mesh<Layout> makeCube(int subdivisions = 1)
+{
+    if (subdivisions < 1) {
+        return {};
+    }
+    Mesh<Layout> mesh(cubeVertexCount(subdivisions), cubeIndexCount(subdivisions));
+    detail::buildCube<Layout>(mesh, subdivisions);
+    return mesh;
+}
+
+template <typename Layout>
+Mesh<Layout> makeCubeCorners()
+{
+    static_assert(!Layout::HasUv, "shared corners cannot carry per-face texture coordinates; use makeCube()");
+    Mesh<Layout> mesh(8, 36);
+    detail::buildCubeCorners<Layout>(mesh);
+    return mesh;
+}
+
+template <typename Layout>
+Mesh<Layout> makeUvSphere(int slices, int stacks)
+{
+    if (slices < 3 || stacks < 2) {
+        return {};
+    }
+    Mesh<Layout> mesh(uvSphereVertexCount(slices, stacks), uvSphereIndexCount(slices, stacks));
+    detail::buildUvSphere<Layout>(mesh, slices, stacks);
+    return mesh;
+}
+
+template <typename Layout>
+Mesh<Layout> makeIcoSphere(int frequency = 1)
+{
+    if (frequency < 1) {
+        return {};
+    }
+    Mesh<Layout> mesh(icoSphereVertexCount(frequency), icoSphereIndexCount(frequency));
+    detail::buildIcoSphere<Layout>(mesh, frequency);
+    return mesh;
+}
+
+template <typename Layout>
+Mesh<Layout> makeGrid(int columns, int rows)
+{
+    if (columns < 1 || rows < 1) {
+        return {};
+    }
+    Mesh<Layout> mesh(gridVertexCount(columns, rows), gridIndexCount(columns, rows));
+    detail::buildGrid<Layout>(mesh, columns, rows);
+    return mesh;
+}
+
+template <typename Layout>
+Mesh<Layout> makeTorus(int rings, int sides)
+{
+    if (rings < 3 || sides < 3) {
+        return {};
+    }
+    Mesh<Layout> mesh(torusVertexCount(rings, sides), torusIndexCount(rings, sides));
+    detail::buildTorus<Layout>(mesh, rings, sides);
+    return mesh;
+}
+
+} // namespace meshgen
+
+#endif // MESHGEN_H
@@ -0,0 +1,154 @@
+#include "multiview.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <cmath>
+#include <utility>
+
+// ------------------- Constructor and Destructor -------------------
+
+MultiViewWidget::MultiViewWidget(QWidget *parent)
+    : QOpenGLWidget(parent)
+{
+}
+
+MultiViewWidget::~MultiViewWidget()
+{
+    if (ready && hooks.release) {
+        makeCurrent();
+        hooks.release();
+        doneCurrent();
+    }
+    for (const QPointer<QWidget> &widget : std::as_const(views)) {
+        if (widget) {
+            widget->removeEventFilter(this);
+        }
+    }
+}
+
+// ------------------- Views -------------------
+
+QWidget *MultiViewWidget::addView(QWidget *widget)
+{
+    if (!widget) {
+        widget = new QWidget(this);
+    }
+    // Nothing is painted into the placeholder, so the GL content under it shows through
+    widget->setAttribute(Qt::WA_NoSystemBackground);
+    widget->setAutoFillBackground(false);
+    widget->installEventFilter(this);
+    views.append(widget);
+    update();
+    return widget;
+}
+
+void MultiViewWidget::removeView(QWidget *widget)
+{
+    const int index = indexOf(widget);
+    if (index < 0) {
+        return;
+    }
+    widget->removeEventFilter(this);
+    views.remove(index);
+    update();
+}
+
+int MultiViewWidget::indexOf(const QWidget *widget) const
+{
+    for (int i = 0; i < views.size(); ++i) {
+        if (views[i] == widget) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool MultiViewWidget::eventFilter(QObject *watched, QEvent *event)
+{
+    // A view that moves, resizes or changes visibility needs a new frame; the widget itself is untouched
+    switch (event->type()) {
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+    case QEvent::Hide:
+        update();
+        break;
+    default:
+        break;
+    }
+    return QOpenGLWidget::eventFilter(watched, event);
+}
+
+QRect MultiViewWidget::viewportOf(const QWidget *widget, qreal ratio, int framebufferHeight) const
+{
+    if (!widget || !widget->isVisibleTo(this) || !isAncestorOf(widget)) {
+        return QRect();
+    }
+    const QRect area = QRect(widget->mapTo(this, QPoint(0, 0)), widget->size()) & rect();
+    if (area.isEmpty()) {
+        return QRect();
+    }
+    // Rounded edges: adjacent views share their boundary pixel row exactly, without gaps or overlap
+    const int left = int(std::lround(area.left() * ratio));
+    const int right = int(std::lround((area.right() + 1) * ratio));
+    const int top = int(std::lround(area.top() * ratio));
+    const int bottom = int(std::lround((area.bottom() + 1) * ratio));
+    return QRect(left, framebufferHeight - bottom, right - left, bottom - top);
+}
+
+// ------------------- GL Core Functions -------------------
+
+void MultiViewWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+    ready = !hooks.initialize || hooks.initialize();
+    if (!ready) {
+        qWarning() << "MultiViewWidget: scene initialization failed";
+    }
+}
+
+void MultiViewWidget::paintGL()
+{
+    QElapsedTimer timer;
+    timer.start();
+    FrameStats frame;
+
+    const qreal ratio = devicePixelRatioF();
+    const int framebufferHeight = int(std::lround(height() * ratio));
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(background.redF(), background.greenF(), background.blueF(), 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (!ready || !hooks.renderView) {
+        return;
+    }
+
+    if (hooks.beginFrame) {
+        hooks.beginFrame();
+    }
+    // The scissor keeps each view's clear and draws inside its rectangle
+    glEnable(GL_SCISSOR_TEST);
+    for (int i = 0; i < views.size(); ++i) {
+        ViewContext view;
+        view.index = i;
+        view.widget = views[i];
+        view.viewport = viewportOf(view.widget, ratio, framebufferHeight);
+        if (view.viewport.isEmpty()) {
+            ++frame.viewsHidden;
+            continue;
+        }
+        glViewport(view.viewport.x(), view.viewport.y(), view.viewport.width(), view.viewport.height());
+        glScissor(view.viewport.x(), view.viewport.y(), view.viewport.width(), view.viewport.height());
+        glClearColor(viewClear.redF(), viewClear.greenF(), viewClear.blueF(), 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        hooks.renderView(view);
+        ++frame.viewsDrawn;
+    }
+    glDisable(GL_SCISSOR_TEST);
+    glViewport(0, 0, int(std::lround(width() * ratio)), framebufferHeight);
+    if (hooks.endFrame) {
+        hooks.endFrame();
+    }
+
+    frame.cpuMilliseconds = timer.nsecsElapsed() / 1.0e6;
+    lastFrame = frame;
+}
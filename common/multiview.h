@@ -0,0 +1,106 @@
+#ifndef MULTIVIEW_H
+#define MULTIVIEW_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QColor>
+#include <QPointer>
+#include <QRect>
+#include <QVector>
+#include <functional>
+
+// ------------------- Multi-View Widget -------------------
+
+/**
+ * @brief One QOpenGLWidget that renders many independent views.
+ *
+ * Every QOpenGLWidget renders into a private framebuffer that the top-level
+ * window composites, so a dashboard of N widgets pays N framebuffers, N
+ * composites and N paintGL() setups. MultiViewWidget renders all its views
+ * into its single framebuffer in one paintGL(): each view is a viewport and
+ * scissor rectangle, and GL resources and state are shared between views.
+ *
+ * Views stay ordinary widgets: addView() returns a transparent placeholder
+ * (or adopts the caller's widget) that is laid out in this widget's layout
+ * like any other child, receives mouse and key events, and decides where
+ * its view is drawn. Placeholders must be descendants of this widget, and
+ * should paint nothing so that the view shows through.
+ *
+ * The render callbacks run with the context current, the view's viewport
+ * and scissor set, and its color and depth already cleared. They must leave
+ * the scissor test enabled.
+ */
+class MultiViewWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+{
+    Q_OBJECT
+
+public:
+    struct ViewContext {
+        int index = 0;
+        QWidget *widget = nullptr;
+        QRect viewport;                     // Device pixels in GL convention (origin bottom-left)
+
+        float aspect() const { return float(viewport.width()) / float(qMax(1, viewport.height())); }
+    };
+
+    /**
+     * @brief Scene hooks; all but renderView are optional.
+     *
+     * beginFrame and endFrame run once per frame around the views, so state
+     * shared by every view (program, VAO, textures, per-frame uniforms) is set
+     * once instead of once per view.
+     */
+    struct Callbacks {
+        std::function<bool()> initialize;   // Shared resources; false stops rendering
+        std::function<void()> beginFrame;
+        std::function<void(const ViewContext &)> renderView;
+        std::function<void()> endFrame;
+        std::function<void()> release;      // From the destructor, with the context current
+    };
+
+    struct FrameStats {
+        int viewsDrawn = 0;
+        int viewsHidden = 0;                // Hidden, empty or outside this widget
+        double cpuMilliseconds = 0.0;       // paintGL() wall time
+    };
+
+    explicit MultiViewWidget(QWidget *parent = nullptr);
+    ~MultiViewWidget();
+
+    /**
+     * @brief Sets the scene hooks; must be called before initializeGL().
+     */
+    void setCallbacks(const Callbacks &callbacks) { hooks = callbacks; }
+
+    /**
+     * @brief Adds a view drawn under @p widget, or under a new empty placeholder.
+     * @return The widget, to be put in this widget's layout.
+     */
+    QWidget *addView(QWidget *widget = nullptr);
+    void removeView(QWidget *widget);
+    int viewCount() const { return views.size(); }
+    QWidget *view(int index) const { return views.value(index); }
+    int indexOf(const QWidget *widget) const;
+
+    void setBackground(const QColor &color) { background = color; }
+    void setViewClearColor(const QColor &color) { viewClear = color; }
+
+    FrameStats frameStats() const { return lastFrame; }
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    QRect viewportOf(const QWidget *widget, qreal ratio, int framebufferHeight) const;
+
+    Callbacks hooks;
+    QVector<QPointer<QWidget>> views;
+    QColor background = QColor(40, 40, 40);
+    QColor viewClear = QColor(20, 24, 30);
+    bool ready = false;
+    FrameStats lastFrame;
+};
+
+#endif // MULTIVIEW_H
@@ -0,0 +1,417 @@
+#include "particlesystem.h"
+#include <QDebug>
+#include <QOpenGLShaderProgram>
+#include <QVector2D>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+// ------------------- Shader Source Code (Embedded) -------------------
+
+// Simulation, emission and recycling: one vertex per particle, output captured by transform feedback
+static const char *updateVertexShaderSource = R"glsl(
+#version 330 core
+layout (location = 0) in vec4 inPositionAge;    // xyz position, w age (seconds)
+layout (location = 1) in vec4 inVelocityLife;   // xyz velocity, w lifetime; dead once age >= lifetime
+layout (location = 2) in uint inColor;          // RGBA8
+
+out vec4 outPositionAge;
+out vec4 outVelocityLife;
+flat out uint outColor;
+
+uniform bool reset;
+uniform float dt;
+uniform uint capacity;
+uniform uint emitStart;
+uniform uint emitCount;
+uniform uint frameSeed;
+
+uniform vec3 emitterPosition;
+uniform float emitterRadius;
+uniform vec3 emitDirection;
+uniform float cosSpread;
+uniform vec2 speedRange;
+uniform vec2 lifetimeRange;
+uniform vec3 gravity;
+uniform float drag;
+uniform float floorHeight;
+uniform float restitution;
+uniform vec4 colorStart;
+uniform vec4 colorEnd;
+
+uint hash(uint x)
+{
+    x ^= x >> 16u;
+    x *= 0x7feb352du;
+    x ^= x >> 15u;
+    x *= 0x846ca68bu;
+    x ^= x >> 16u;
+    return x;
+}
+
+float random01(inout uint state)
+{
+    state = hash(state);
+    return float(state >> 8u) * (1.0 / 16777216.0);
+}
+
+uint packColor(vec4 color)
+{
+    uvec4 bytes = uvec4(clamp(color, 0.0, 1.0) * 255.0 + 0.5);
+    return bytes.r | (bytes.g << 8u) | (bytes.b << 16u) | (bytes.a << 24u);
+}
+
+void main()
+{
+    if (reset) {
+        outPositionAge = vec4(0.0);
+        outVelocityLife = vec4(0.0);
+        outColor = 0u;
+        return;
+    }
+
+    uint slot = uint(gl_VertexID);
+    vec3 position = inPositionAge.xyz;
+    float age = inPositionAge.w;
+    vec3 velocity = inVelocityLife.xyz;
+    float lifetime = inVelocityLife.w;
+    uint color = inColor;
+
+    bool alive = age < lifetime;
+    bool emitting = (slot + capacity - emitStart) % capacity < emitCount;
+
+    if (!alive && emitting) {
+        uint state = hash(slot + hash(frameSeed));
+
+        // Uniform point in the emitter sphere
+        float z = random01(state) * 2.0 - 1.0;
+        float angle = 6.28318531 * random01(state);
+        vec3 offset = vec3(sqrt(1.0 - z * z) * vec2(cos(angle), sin(angle)), z);
+        position = emitterPosition + offset * emitterRadius * pow(random01(state), 1.0 / 3.0);
+
+        // Uniform direction in the cone around emitDirection
+        float cosTheta = mix(1.0, cosSpread, random01(state));
+        float sinTheta = sqrt(max(0.0, 1.0 - cosTheta * cosTheta));
+        float phi = 6.28318531 * random01(state);
+        vec3 tangent = normalize(cross(abs(emitDirection.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0),
+                                       emitDirection));
+        vec3 bitangent = cross(emitDirection, tangent);
+        vec3 direction = (tangent * cos(phi) + bitangent * sin(phi)) * sinTheta + emitDirection * cosTheta;
+
+        velocity = direction * mix(speedRange.x, speedRange.y, random01(state));
+        lifetime = mix(lifetimeRange.x, lifetimeRange.y, random01(state));
+        age = 0.0;
+        color = packColor(mix(colorStart, colorEnd, random01(state)));
+    } else if (alive) {
+        velocity += gravity * dt;
+        velocity *= max(0.0, 1.0 - drag * dt);
+        position += velocity * dt;
+        if (position.y < floorHeight && velocity.y < 0.0) {
+            position.y = floorHeight;
+            velocity.y = -velocity.y * restitution;
+        }
+        age += dt;
+    }
+
+    outPositionAge = vec4(position, age);
+    outVelocityLife = vec4(velocity, lifetime);
+    outColor = color;
+}
+)glsl";
+
+// Instanced billboards: the quad corners are per vertex, the particle state per instance
+static const char *renderVertexShaderSource = R"glsl(
+#version 330 core
+layout (location = 0) in vec2 corner;
+layout (location = 1) in vec4 positionAge;
+layout (location = 2) in vec4 velocityLife;
+layout (location = 3) in uint color;
+
+out vec2 spriteCoord;
+out vec4 particleColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float particleSize;
+
+void main()
+{
+    spriteCoord = corner;
+    if (positionAge.w >= velocityLife.w) {
+        // Dead: outside the clip volume, so the quad is culled before rasterization
+        particleColor = vec4(0.0);
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    vec4 rgba = vec4(uvec4(color, color >> 8u, color >> 16u, color >> 24u) & 0xffu) / 255.0;
+    particleColor = vec4(rgba.rgb, rgba.a * (1.0 - positionAge.w / velocityLife.w));
+
+    vec4 viewPosition = view * vec4(positionAge.xyz, 1.0);
+    viewPosition.xy += corner * particleSize;
+    gl_Position = projection * viewPosition;
+}
+)glsl";
+
+static const char *renderFragmentShaderSource = R"glsl(
+#version 330 core
+in vec2 spriteCoord;
+in vec4 particleColor;
+out vec4 FragColor;
+
+void main()
+{
+    float d = dot(spriteCoord, spriteCoord);
+    if (d > 1.0) {
+        discard;
+    }
+    FragColor = vec4(particleColor.rgb, particleColor.a * (1.0 - d));
+}
+)glsl";
+
+// position + age, velocity + lifetime, RGBA8 color
+static const int StateStride = 8 * sizeof(float) + sizeof(quint32);
+
+// ------------------- Setup -------------------
+
+bool ParticleSystem::buildPrograms()
+{
+    updateProgram = new QOpenGLShaderProgram;
+    if (!updateProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, updateVertexShaderSource)) {
+        qWarning() << "ParticleSystem: update shader compilation failed:" << updateProgram->log();
+        return false;
+    }
+    // Must be declared before linking
+    const char *varyings[] = { "outPositionAge", "outVelocityLife", "outColor" };
+    glTransformFeedbackVaryings(updateProgram->programId(), 3, varyings, GL_INTERLEAVED_ATTRIBS);
+    if (!updateProgram->link()) {
+        qWarning() << "ParticleSystem: update program linking failed:" << updateProgram->log();
+        return false;
+    }
+
+    renderProgram = new QOpenGLShaderProgram;
+    if (!renderProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, renderVertexShaderSource)
+        || !renderProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, renderFragmentShaderSource)
+        || !renderProgram->link()) {
+        qWarning() << "ParticleSystem: render program failed:" << renderProgram->log();
+        return false;
+    }
+    return true;
+}
+
+bool ParticleSystem::initialize(const Params &params)
+{
+    initializeOpenGLFunctions();
+    release();
+
+    if (params.maxParticles <= 0) {
+        qWarning() << "ParticleSystem: maxParticles must be positive";
+        return false;
+    }
+    parameters = params;
+    if (!buildPrograms()) {
+        release();
+        return false;
+    }
+
+    // Allocation is the only place a GL error is expected (GL_OUT_OF_MEMORY at 10M+ particles).
+    // The drain is bounded because a lost context reports an error on every call.
+    for (int i = 0; i < 32 && glGetError() != GL_NO_ERROR; ++i) {
+    }
+    const qint64 bytes = qint64(parameters.maxParticles) * StateStride;
+    glGenBuffers(2, stateBuffers);
+    for (GLuint buffer : stateBuffers) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_COPY);
+    }
+    if (glGetError() == GL_OUT_OF_MEMORY) {
+        qWarning() << "ParticleSystem: out of GPU memory for" << parameters.maxParticles << "particles ("
+                   << 2 * bytes / (1024 * 1024) << "MiB)";
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        release();
+        return false;
+    }
+
+    const float corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    glGenBuffers(1, &cornerBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+    glGenVertexArrays(2, updateVaos);
+    glGenVertexArrays(2, renderVaos);
+    for (int i = 0; i < 2; ++i) {
+        glBindVertexArray(updateVaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[i]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, StateStride, (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, StateStride, (void*)(4 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, StateStride, (void*)(8 * sizeof(float)));
+
+        glBindVertexArray(renderVaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[i]);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, StateStride, (void*)0);
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, StateStride, (void*)(4 * sizeof(float)));
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(3);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, StateStride, (void*)(8 * sizeof(float)));
+        glVertexAttribDivisor(3, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenTransformFeedbacks(1, &feedback);
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    const QString owner = QString("ParticleSystem@%1").arg(quintptr(this), 0, 16);
+    stateMemory[0] = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, bytes, owner, "particle state A");
+    stateMemory[1] = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, bytes, owner, "particle state B");
+
+    // The buffers start undefined: one pass writes every slot as dead
+    current = 0;
+    emitCursor = 0;
+    emitAccumulator = 0.0;
+    counters = Stats();
+    initialized = true;
+    runUpdate(0.0f, 0, true);
+    return true;
+}
+
+void ParticleSystem::release()
+{
+    delete updateProgram;
+    updateProgram = nullptr;
+    delete renderProgram;
+    renderProgram = nullptr;
+
+    if (stateBuffers[0] != 0) {
+        glDeleteBuffers(2, stateBuffers);
+        stateBuffers[0] = stateBuffers[1] = 0;
+    }
+    if (cornerBuffer != 0) {
+        glDeleteBuffers(1, &cornerBuffer);
+        cornerBuffer = 0;
+    }
+    if (updateVaos[0] != 0) {
+        glDeleteVertexArrays(2, updateVaos);
+        glDeleteVertexArrays(2, renderVaos);
+        updateVaos[0] = updateVaos[1] = 0;
+        renderVaos[0] = renderVaos[1] = 0;
+    }
+    if (feedback != 0) {
+        glDeleteTransformFeedbacks(1, &feedback);
+        feedback = 0;
+    }
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    for (GpuMemoryTracker::Handle &handle : stateMemory) {
+        memory.release(handle);
+        handle = 0;
+    }
+    initialized = false;
+}
+
+void ParticleSystem::setParams(const Params &params)
+{
+    const int maxParticles = parameters.maxParticles;
+    parameters = params;
+    parameters.maxParticles = maxParticles;
+}
+
+// ------------------- Simulation -------------------
+
+void ParticleSystem::update(float dt)
+{
+    if (!initialized) {
+        return;
+    }
+
+    // Whole particles this step; the remainder carries over so low rates still emit
+    emitAccumulator += double(parameters.emitRate) * dt;
+    const double whole = std::min(std::floor(emitAccumulator), double(parameters.maxParticles));
+    const quint32 emitCount = quint32(whole);
+    emitAccumulator = qMin(emitAccumulator - whole, double(parameters.maxParticles));
+
+    runUpdate(dt, emitCount, false);
+
+    emitCursor = quint32((quint64(emitCursor) + emitCount) % quint64(parameters.maxParticles));
+    ++counters.frames;
+    counters.particlesSimulated += quint64(parameters.maxParticles);
+    counters.particlesEmitted += emitCount;
+}
+
+void ParticleSystem::runUpdate(float dt, quint32 emitCount, bool reset)
+{
+    const Params &p = parameters;
+    updateProgram->bind();
+    updateProgram->setUniformValue("reset", reset ? 1 : 0);
+    updateProgram->setUniformValue("dt", dt);
+    updateProgram->setUniformValue("capacity", GLuint(p.maxParticles));
+    updateProgram->setUniformValue("emitStart", GLuint(emitCursor));
+    updateProgram->setUniformValue("emitCount", GLuint(emitCount));
+    updateProgram->setUniformValue("frameSeed", GLuint(p.seed * 0x9e3779b9u + quint32(counters.frames)));
+    updateProgram->setUniformValue("emitterPosition", p.emitterPosition);
+    updateProgram->setUniformValue("emitterRadius", p.emitterRadius);
+    updateProgram->setUniformValue("emitDirection", p.emitDirection.normalized());
+    updateProgram->setUniformValue("cosSpread", float(qCos(qDegreesToRadians(p.spreadDegrees))));
+    updateProgram->setUniformValue("speedRange", QVector2D(p.speedMin, p.speedMax));
+    updateProgram->setUniformValue("lifetimeRange", QVector2D(p.lifetimeMin, p.lifetimeMax));
+    updateProgram->setUniformValue("gravity", p.gravity);
+    updateProgram->setUniformValue("drag", p.drag);
+    updateProgram->setUniformValue("floorHeight", p.floorHeight);
+    updateProgram->setUniformValue("restitution", p.restitution);
+    updateProgram->setUniformValue("colorStart", p.colorStart);
+    updateProgram->setUniformValue("colorEnd", p.colorEnd);
+
+    // Nothing is drawn: the vertex shader's outputs go straight into the other buffer
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(updateVaos[current]);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, stateBuffers[1 - current]);
+
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, p.maxParticles);
+    glEndTransformFeedback();
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    updateProgram->release();
+
+    current = 1 - current;
+}
+
+// ------------------- Rendering -------------------
+
+void ParticleSystem::render(const QMatrix4x4 &view, const QMatrix4x4 &projection)
+{
+    if (!initialized) {
+        return;
+    }
+
+    // Additive, unsorted: order does not matter and no depth writes are needed
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    renderProgram->bind();
+    renderProgram->setUniformValue("view", view);
+    renderProgram->setUniformValue("projection", projection);
+    renderProgram->setUniformValue("particleSize", parameters.particleSize);
+
+    glBindVertexArray(renderVaos[current]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, parameters.maxParticles);
+    glBindVertexArray(0);
+
+    renderProgram->release();
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
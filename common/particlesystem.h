@@ -0,0 +1,122 @@
+#ifndef PARTICLESYSTEM_H
+#define PARTICLESYSTEM_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+#include "gpumemory.h"
+
+class QOpenGLShaderProgram;
+
+/**
+ * @brief GPU particle system: simulation, emission and recycling run in transform feedback.
+ *
+ * Particle state lives in two vertex buffers used in turn. update() draws the
+ * current buffer as GL_POINTS with rasterization discarded; the vertex shader
+ * integrates each particle and transform feedback writes the result into the
+ * other buffer. No particle data ever crosses the bus after initialize().
+ *
+ * Emission is a ring over the particle slots: each update emits the next
+ * emitRate * dt slots after the previous ones. A slot in that window is
+ * respawned if its particle is dead; a slot still alive there (lifetimes
+ * longer than capacity / emitRate) is skipped, so the emitter is limited by
+ * the free slots instead of overwriting live particles. Random numbers come
+ * from a hash of the slot index and the frame.
+ *
+ * render() draws one camera-facing quad per particle with glDrawArraysInstanced,
+ * reading the state buffer as per-instance attributes. Dead particles are
+ * moved outside the clip volume in the vertex shader.
+ *
+ * Every particle is 36 bytes (position + age, velocity + lifetime, RGBA8
+ * color), twice: 10M particles need about 690 MiB of GPU memory.
+ *
+ * All GL calls must be made with the owning context current.
+ */
+class ParticleSystem : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Params {
+        int maxParticles = 1000000;
+        float emitRate = 250000.0f;            // Particles per second
+        float lifetimeMin = 2.0f;              // Seconds
+        float lifetimeMax = 6.0f;
+        QVector3D emitterPosition = QVector3D(0.0f, -0.5f, 0.0f);
+        float emitterRadius = 0.05f;
+        QVector3D emitDirection = QVector3D(0.0f, 1.0f, 0.0f);
+        float spreadDegrees = 25.0f;           // Half-angle of the emission cone
+        float speedMin = 1.0f;
+        float speedMax = 2.5f;
+        QVector3D gravity = QVector3D(0.0f, -1.5f, 0.0f);
+        float drag = 0.1f;                     // Fraction of the velocity lost per second
+        float floorHeight = -0.5f;             // Particles bounce off this plane
+        float restitution = 0.4f;
+        float particleSize = 0.006f;           // Billboard half-size in world units
+        QVector4D colorStart = QVector4D(1.0f, 0.75f, 0.25f, 1.0f);   // Emission color range
+        QVector4D colorEnd = QVector4D(1.0f, 0.2f, 0.05f, 1.0f);
+        quint32 seed = 1;
+    };
+
+    struct Stats {
+        quint64 frames = 0;
+        quint64 particlesSimulated = 0;   // maxParticles per update, dead or alive
+        quint64 particlesEmitted = 0;     // Slots offered for emission
+    };
+
+    ParticleSystem() = default;
+
+    /**
+     * @brief Creates the buffers and programs and clears every slot to dead.
+     * @return false if a shader does not build or the buffers cannot be allocated.
+     */
+    bool initialize(const Params &params);
+    /**
+     * @brief Deletes the buffers and programs; call with the context current before it goes away.
+     */
+    void release();
+    bool isInitialized() const { return initialized; }
+
+    /**
+     * @brief Changes everything but maxParticles; takes effect at the next update().
+     */
+    void setParams(const Params &params);
+    Params params() const { return parameters; }
+    int capacity() const { return parameters.maxParticles; }
+
+    /**
+     * @brief Advances the simulation by @p dt seconds.
+     */
+    void update(float dt);
+
+    /**
+     * @brief Draws the particles additively into the bound framebuffer. Leaves blending disabled.
+     */
+    void render(const QMatrix4x4 &view, const QMatrix4x4 &projection);
+
+    Stats stats() const { return counters; }
+
+private:
+    bool buildPrograms();
+    void runUpdate(float dt, quint32 emitCount, bool reset);
+
+    Params parameters;
+    Stats counters;
+    bool initialized = false;
+
+    QOpenGLShaderProgram *updateProgram = nullptr;
+    QOpenGLShaderProgram *renderProgram = nullptr;
+
+    GLuint stateBuffers[2] = { 0, 0 };
+    GLuint updateVaos[2] = { 0, 0 };     // updateVaos[i] reads stateBuffers[i]
+    GLuint renderVaos[2] = { 0, 0 };
+    GLuint cornerBuffer = 0;             // The 4 corners of the billboard quad
+    GLuint feedback = 0;
+    int current = 0;                     // Buffer holding the latest state
+
+    quint32 emitCursor = 0;              // First slot of the next emission window
+    double emitAccumulator = 0.0;        // Fractional particles carried to the next update
+
+    GpuMemoryTracker::Handle stateMemory[2] = { 0, 0 };
+};
+
+#endif // PARTICLESYSTEM_H
@@ -0,0 +1,412 @@
+#include "perftrace.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <memory>
+
+namespace perftrace {
+
+namespace {
+
+constexpr int ChunkEvents = 4096;
+constexpr int MaxChunksPerThread = 1024;        // 4M events, about 200 MB, per thread
+
+// Written by one thread only: count is published with a release store after
+// the event, so a reader that acquires count sees complete events.
+struct Chunk {
+    Event events[ChunkEvents];
+    std::atomic<int> count{ 0 };
+    std::atomic<Chunk *> next{ nullptr };
+};
+
+struct ThreadBuffer {
+    int track = 0;
+    QString name;                               // Guarded by Registry::mutex
+    Chunk *head = nullptr;
+    Chunk *tail = nullptr;                      // Owning thread only
+    int chunks = 1;
+    std::atomic<qint64> dropped{ 0 };
+};
+
+struct Track {
+    int id = 0;
+    QString name;
+};
+
+// Buffers are never freed: a worker thread's events outlive the thread
+struct Registry {
+    QMutex mutex;
+    QVector<ThreadBuffer *> buffers;
+    QVector<Track> tracks;                      // addTrack() rows
+    QSet<QByteArray> names;                     // intern()
+    int nextTrack = 1;
+    qint64 startNs = 0;
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+ThreadBuffer *localBuffer()
+{
+    if (!threadBuffer) {
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->head = buffer->tail = new Chunk;
+        Registry &r = registry();
+        QMutexLocker locker(&r.mutex);
+        buffer->track = r.nextTrack++;
+        const QCoreApplication *app = QCoreApplication::instance();
+        buffer->name = app && app->thread() == QThread::currentThread() ? QString("main")
+                                                                        : QString("thread %1").arg(buffer->track);
+        threadBuffer = buffer.release();
+        r.buffers.append(threadBuffer);
+    }
+    return threadBuffer;
+}
+
+void appendEscaped(QByteArray *json, const char *text)
+{
+    json->append('"');
+    for (const char *c = text; *c; ++c) {
+        switch (*c) {
+        case '"': json->append("\\\""); break;
+        case '\\': json->append("\\\\"); break;
+        case '\n': json->append("\\n"); break;
+        case '\t': json->append("\\t"); break;
+        default:
+            if (uchar(*c) < 0x20) {
+                json->append(QByteArray::asprintf("\\u%04x", uchar(*c)));
+            } else {
+                json->append(*c);
+            }
+        }
+    }
+    json->append('"');
+}
+
+void appendMetadata(QByteArray *json, const char *kind, int track, const QString &value)
+{
+    json->append(QByteArray::asprintf("{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"args\":{\"name\":", track,
+                                      kind));
+    appendEscaped(json, value.toUtf8().constData());
+    json->append("}},\n");
+}
+
+} // namespace
+
+// ------------------- Recording -------------------
+
+void start()
+{
+    Registry &r = registry();
+    {
+        QMutexLocker locker(&r.mutex);
+        for (ThreadBuffer *buffer : r.buffers) {
+            // Keep the first chunk, free the rest
+            Chunk *chunk = buffer->head->next.load(std::memory_order_acquire);
+            while (chunk) {
+                Chunk *next = chunk->next.load(std::memory_order_acquire);
+                delete chunk;
+                chunk = next;
+            }
+            buffer->head->next.store(nullptr, std::memory_order_relaxed);
+            buffer->head->count.store(0, std::memory_order_release);
+            buffer->tail = buffer->head;
+            buffer->chunks = 1;
+            buffer->dropped.store(0, std::memory_order_relaxed);
+        }
+        r.startNs = nowNs();
+    }
+    recordingFlag.store(true, std::memory_order_release);
+}
+
+void stop()
+{
+    recordingFlag.store(false, std::memory_order_release);
+}
+
+void record(const Event &event)
+{
+    ThreadBuffer *buffer = localBuffer();
+    Chunk *chunk = buffer->tail;
+    int index = chunk->count.load(std::memory_order_relaxed);
+    if (index == ChunkEvents) {
+        if (buffer->chunks == MaxChunksPerThread) {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Chunk *next = new Chunk;
+        chunk->next.store(next, std::memory_order_release);
+        buffer->tail = chunk = next;
+        ++buffer->chunks;
+        index = 0;
+    }
+    chunk->events[index] = event;
+    chunk->count.store(index + 1, std::memory_order_release);
+}
+
+void setThreadName(const QString &name)
+{
+    ThreadBuffer *buffer = localBuffer();
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    buffer->name = name;
+}
+
+int addTrack(const QString &name)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    Track track;
+    track.id = r.nextTrack++;
+    track.name = name;
+    r.tracks.append(track);
+    return track.id;
+}
+
+const char *intern(const QString &name)
+{
+    const QByteArray utf8 = name.toUtf8();
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    auto it = r.names.constFind(utf8);
+    if (it == r.names.constEnd()) {
+        it = r.names.insert(utf8);
+    }
+    // The set's copy is never modified, so its data stays put when the set grows
+    return it->constData();
+}
+
+// ------------------- Export -------------------
+
+Stats stats()
+{
+    Stats result;
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    result.threads = r.buffers.size();
+    for (ThreadBuffer *buffer : r.buffers) {
+        for (Chunk *chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            result.events += chunk->count.load(std::memory_order_acquire);
+        }
+        result.dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+QByteArray toJson()
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+
+    // Chrome's trace-event format: timestamps and durations in microseconds
+    QByteArray json;
+    json.reserve(1 << 20);
+    json.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    const QString process = QCoreApplication::instance() ? QCoreApplication::applicationName() : QString("process");
+    json.append("{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":");
+    appendEscaped(&json, process.toUtf8().constData());
+    json.append("}},\n");
+    for (const ThreadBuffer *buffer : r.buffers) {
+        appendMetadata(&json, "thread_name", buffer->track, buffer->name);
+    }
+    for (const Track &track : r.tracks) {
+        appendMetadata(&json, "thread_name", track.id, track.name);
+        // Below every thread
+        json.append(QByteArray::asprintf("{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_sort_index\","
+                                         "\"args\":{\"sort_index\":%d}},\n",
+                                         track.id, 1000000 + track.id));
+    }
+
+    const qint64 origin = r.startNs;
+    for (const ThreadBuffer *buffer : r.buffers) {
+        for (const Chunk *chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            const int count = chunk->count.load(std::memory_order_acquire);
+            for (int i = 0; i < count; ++i) {
+                const Event &event = chunk->events[i];
+                const int track = event.track ? event.track : buffer->track;
+                json.append(QByteArray::asprintf("{\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,", char(event.phase),
+                                                 track, (event.startNs - origin) / 1000.0));
+                switch (event.phase) {
+                case Phase::Complete:
+                    json.append(QByteArray::asprintf("\"dur\":%.3f,", event.durationNs / 1000.0));
+                    break;
+                case Phase::Instant:
+                    json.append("\"s\":\"t\",");
+                    break;
+                case Phase::Counter:
+                    json.append(QByteArray::asprintf("\"args\":{\"value\":%.17g},", event.value));
+                    break;
+                }
+                json.append("\"cat\":");
+                appendEscaped(&json, event.category ? event.category : "cpu");
+                json.append(",\"name\":");
+                appendEscaped(&json, event.name ? event.name : "?");
+                json.append("},\n");
+            }
+        }
+    }
+
+    // The trailing comma of the last event is allowed by Chrome but not by strict JSON parsers
+    if (json.endsWith(",\n")) {
+        json.chop(2);
+    }
+    json.append("\n]}\n");
+    return json;
+}
+
+bool writeJson(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "perftrace: cannot write" << filePath;
+        return false;
+    }
+    const Stats counts = stats();
+    if (counts.dropped > 0) {
+        qWarning() << "perftrace:" << counts.dropped << "events dropped, buffers full";
+    }
+    return file.write(toJson()) >= 0;
+}
+
+// ------------------- GPU Timeline -------------------
+
+bool GpuTimeline::initialize(const Params &params)
+{
+    release();
+    initializeOpenGLFunctions();
+    for (int i = 0; i < 32 && glGetError() != GL_NO_ERROR; ++i) {
+        // Errors from before; only the queries' own count below. Bounded: a lost context never stops erroring
+    }
+
+    const int maxSpans = qMax(1, params.maxSpans);
+    queries.resize(maxSpans * 2);
+    glGenQueries(GLsizei(queries.size()), queries.data());
+    spans.resize(maxSpans);
+    head = 0;
+    count = 0;
+    open.clear();
+    droppedSpans = 0;
+    track = addTrack(params.trackName);
+    calibrate();
+
+    if (glGetError() != GL_NO_ERROR) {
+        qWarning() << "GpuTimeline: timestamp queries are not available";
+        release();
+        return false;
+    }
+    initialized = true;
+    return true;
+}
+
+void GpuTimeline::release()
+{
+    if (!queries.isEmpty()) {
+        glDeleteQueries(GLsizei(queries.size()), queries.constData());
+        queries.clear();
+    }
+    spans.clear();
+    open.clear();
+    head = 0;
+    count = 0;
+    initialized = false;
+}
+
+void GpuTimeline::begin(const char *name)
+{
+    if (!initialized) {
+        return;
+    }
+    if (!isRecording() || count == spans.size()) {
+        if (isRecording()) {
+            ++droppedSpans;
+        }
+        open.append(-1);
+        return;
+    }
+    const int slot = (head + count) % spans.size();
+    ++count;
+    Span &span = spans[slot];
+    span.name = name;
+    span.first = slot * 2;
+    span.closed = false;
+    glQueryCounter(queries[span.first], GL_TIMESTAMP);
+    open.append(slot);
+}
+
+void GpuTimeline::end()
+{
+    if (!initialized || open.isEmpty()) {
+        return;
+    }
+    const int slot = open.takeLast();
+    if (slot < 0) {
+        return;
+    }
+    glQueryCounter(queries[spans[slot].first + 1], GL_TIMESTAMP);
+    spans[slot].closed = true;
+}
+
+void GpuTimeline::calibrate()
+{
+    // The GL clock read is synchronous but does not wait for queued work
+    const qint64 before = nowNs();
+    GLint64 gpu = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu);
+    const qint64 after = nowNs();
+    gpuToCpuNs = before + (after - before) / 2 - gpu;
+}
+
+void GpuTimeline::recordSpan(const Span &span)
+{
+    GLuint64 start = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(queries[span.first], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(queries[span.first + 1], GL_QUERY_RESULT, &end);
+    complete(span.name, "gpu", qint64(start) + gpuToCpuNs, qint64(end - start), track);
+}
+
+void GpuTimeline::collect()
+{
+    if (!initialized || count == 0) {
+        return;
+    }
+    calibrate();
+    // Queries finish in submission order: stop at the first span still open or in flight
+    while (count > 0) {
+        const Span &span = spans[head];
+        if (!span.closed) {
+            break;
+        }
+        GLuint available = 0;
+        glGetQueryObjectuiv(queries[span.first + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        recordSpan(span);
+        head = (head + 1) % spans.size();
+        --count;
+    }
+}
+
+void GpuTimeline::flush()
+{
+    if (!initialized) {
+        return;
+    }
+    calibrate();
+    while (count > 0 && spans[head].closed) {
+        recordSpan(spans[head]);        // GL_QUERY_RESULT waits
+        head = (head + 1) % spans.size();
+        --count;
+    }
+}
+
+} // namespace perftrace
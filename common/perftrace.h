@@ -0,0 +1,267 @@
+#ifndef PERFTRACE_H
+#define PERFTRACE_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <chrono>
+
+// ------------------- Timeline Tracing -------------------
+//
+// Scoped CPU zones, instants and counters from any thread, plus GPU spans
+// measured with timestamp queries, on one timeline exported as Chrome
+// trace-event JSON (open it in ui.perfetto.dev or chrome://tracing).
+//
+// Every PERFTRACE_* macro expands to nothing unless PERFTRACE_ENABLED is
+// defined (the stage CMakeLists define it for non-Release builds, or always
+// with -DPERFTRACE=ON). Compiled in, a zone costs one relaxed atomic load
+// while no trace is recording, and two clock reads plus a store into the
+// calling thread's own buffer while one is: buffers are per thread and
+// single-writer, so recording takes no lock.
+//
+//   perftrace::start();
+//   { PERFTRACE_SCOPE("paintGL"); PERFTRACE_GPU_SCOPE(gpuTimeline, "faces"); ... }
+//   perftrace::writeJson("frame.json");
+//
+// Zone names must outlive the trace: string literals, or intern() for
+// names built at run time (PERFTRACE_SCOPE_STRING does that).
+
+namespace perftrace {
+
+enum class Phase : char {
+    Complete = 'X',         // A zone: start and duration
+    Instant = 'i',
+    Counter = 'C'
+};
+
+struct Event {
+    const char *name = nullptr;
+    const char *category = nullptr;
+    qint64 startNs = 0;     // nowNs() clock
+    qint64 durationNs = 0;  // Complete events
+    double value = 0.0;     // Counter events
+    int track = 0;          // 0: the recording thread, otherwise a track from addTrack()
+    Phase phase = Phase::Complete;
+};
+
+inline std::atomic<bool> recordingFlag{ false };
+
+inline bool isRecording()
+{
+    return recordingFlag.load(std::memory_order_relaxed);
+}
+
+inline qint64 nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Drops everything recorded so far and starts recording.
+ *
+ * Must not race with other threads still recording into a previous trace.
+ */
+void start();
+/**
+ * @brief Stops recording; the events stay available to writeJson().
+ */
+void stop();
+
+/**
+ * @brief Appends @p event to the calling thread's buffer (lock-free; dropped once the buffer is full).
+ */
+void record(const Event &event);
+
+inline void complete(const char *name, const char *category, qint64 startNs, qint64 durationNs, int track = 0)
+{
+    Event event;
+    event.name = name;
+    event.category = category;
+    event.startNs = startNs;
+    event.durationNs = durationNs;
+    event.track = track;
+    record(event);
+}
+
+inline void instant(const char *name, const char *category = "cpu")
+{
+    if (isRecording()) {
+        Event event;
+        event.name = name;
+        event.category = category;
+        event.startNs = nowNs();
+        event.phase = Phase::Instant;
+        record(event);
+    }
+}
+
+inline void counter(const char *name, double value)
+{
+    if (isRecording()) {
+        Event event;
+        event.name = name;
+        event.category = "counter";
+        event.startNs = nowNs();
+        event.value = value;
+        event.phase = Phase::Counter;
+        record(event);
+    }
+}
+
+/**
+ * @brief Names the calling thread's row in the trace viewer.
+ */
+void setThreadName(const QString &name);
+/**
+ * @brief Adds a row that is not a thread, e.g. a GPU queue; events recorded with its id land there.
+ */
+int addTrack(const QString &name);
+
+/**
+ * @brief A copy of @p name that lives until the process exits, for zone names built at run time.
+ */
+const char *intern(const QString &name);
+
+struct Stats {
+    qint64 events = 0;
+    qint64 dropped = 0;     // Recorded while a thread's buffer was full
+    int threads = 0;
+};
+Stats stats();
+
+QByteArray toJson();
+bool writeJson(const QString &filePath);
+
+/**
+ * @brief Times the enclosing block as one zone on the calling thread.
+ */
+class Scope
+{
+public:
+    explicit Scope(const char *name, const char *category = "cpu")
+        : name(name), category(category), startNs(isRecording() && name ? nowNs() : -1)
+    {
+    }
+    ~Scope()
+    {
+        if (startNs >= 0) {
+            complete(name, category, startNs, nowNs() - startNs);
+        }
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *name;
+    const char *category;
+    qint64 startNs;
+};
+
+/**
+ * @brief GPU spans from GL_TIMESTAMP queries, mapped onto the CPU clock and recorded on their own track.
+ *
+ * begin() and end() each issue one glQueryCounter(); collect(), once per
+ * frame, reads the spans whose queries are done without waiting for the
+ * rest, and re-measures the offset between the GL and CPU clocks with a
+ * synchronous GL_TIMESTAMP read. Spans nest like CPU zones. When every
+ * query is in flight further spans are dropped until collect() frees some.
+ *
+ * Does nothing while no trace is recording. All calls must be made with the
+ * owning context current.
+ */
+class GpuTimeline : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Params {
+        QString trackName = "GPU";
+        int maxSpans = 256;             // Spans in flight (two queries each)
+    };
+
+    GpuTimeline() = default;
+
+    bool initialize() { return initialize(Params()); }
+    bool initialize(const Params &params);
+    void release();
+    bool isInitialized() const { return initialized; }
+
+    void begin(const char *name);
+    void end();
+
+    /**
+     * @brief Records the finished spans; call once per frame.
+     */
+    void collect();
+    /**
+     * @brief Waits for every span in flight and records it, e.g. before writeJson().
+     */
+    void flush();
+
+    int dropped() const { return droppedSpans; }
+
+private:
+    struct Span {
+        const char *name = nullptr;
+        int first = 0;                  // Query index of begin(); end() uses first + 1
+        bool closed = false;
+    };
+
+    void calibrate();
+    void recordSpan(const Span &span);
+
+    bool initialized = false;
+    QVector<GLuint> queries;
+    QVector<Span> spans;                // Ring, oldest at head
+    int head = 0;
+    int count = 0;
+    QVector<int> open;                  // Ring slots of unfinished spans, innermost last; -1 if dropped
+    int track = 0;
+    qint64 gpuToCpuNs = 0;              // Added to a GL timestamp to get nowNs()
+    int droppedSpans = 0;
+};
+
+class GpuScope
+{
+public:
+    GpuScope(GpuTimeline &timeline, const char *name) : timeline(timeline) { timeline.begin(name); }
+    ~GpuScope() { timeline.end(); }
+    GpuScope(const GpuScope &) = delete;
+    GpuScope &operator=(const GpuScope &) = delete;
+
+private:
+    GpuTimeline &timeline;
+};
+
+} // namespace perftrace
+
+#ifdef PERFTRACE_ENABLED
+#define PERFTRACE_CONCAT_(a, b) a##b
+#define PERFTRACE_CONCAT(a, b) PERFTRACE_CONCAT_(a, b)
+
+#define PERFTRACE_SCOPE(name) perftrace::Scope PERFTRACE_CONCAT(perfTraceScope_, __LINE__)(name)
+#define PERFTRACE_SCOPE_CATEGORY(name, category) \
+    perftrace::Scope PERFTRACE_CONCAT(perfTraceScope_, __LINE__)(name, category)
+#define PERFTRACE_SCOPE_STRING(qstring) \
+    perftrace::Scope PERFTRACE_CONCAT(perfTraceScope_, __LINE__)( \
+        perftrace::isRecording() ? perftrace::intern(qstring) : nullptr)
+#define PERFTRACE_INSTANT(name) perftrace::instant(name)
+#define PERFTRACE_COUNTER(name, value) perftrace::counter(name, double(value))
+#define PERFTRACE_THREAD_NAME(name) perftrace::setThreadName(name)
+#define PERFTRACE_GPU_SCOPE(timeline, name) \
+    perftrace::GpuScope PERFTRACE_CONCAT(perfTraceGpuScope_, __LINE__)(timeline, name)
+#define PERFTRACE_GPU_BEGIN(timeline, name) (timeline).begin(name)
+#define PERFTRACE_GPU_END(timeline) (timeline).end()
+#else
+#define PERFTRACE_SCOPE(name) ((void)0)
+#define PERFTRACE_SCOPE_CATEGORY(name, category) ((void)0)
+#define PERFTRACE_SCOPE_STRING(qstring) ((void)0)
+#define PERFTRACE_INSTANT(name) ((void)0)
+#define PERFTRACE_COUNTER(name, value) ((void)0)
+#define PERFTRACE_THREAD_NAME(name) ((void)0)
+#define PERFTRACE_GPU_SCOPE(timeline, name) ((void)0)
+#define PERFTRACE_GPU_BEGIN(timeline, name) ((void)0)
+#define PERFTRACE_GPU_END(timeline) ((void)0)
+#endif
+
+#endif // PERFTRACE_H
@@ -0,0 +1,665 @@
+#include "picking.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QVector4D>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+// ------------------- Bounding Volume Hierarchy -------------------
+
+namespace {
+
+constexpr int BinCount = 16;
+
+void grow(Bvh::Box &box, const Bvh::Box &other)
+{
+    box.min = QVector3D(qMin(box.min.x(), other.min.x()), qMin(box.min.y(), other.min.y()),
+                        qMin(box.min.z(), other.min.z()));
+    box.max = QVector3D(qMax(box.max.x(), other.max.x()), qMax(box.max.y(), other.max.y()),
+                        qMax(box.max.z(), other.max.z()));
+}
+
+void grow(Bvh::Box &box, const QVector3D &point)
+{
+    grow(box, Bvh::Box{ point, point });
+}
+
+Bvh::Box emptyBox()
+{
+    const float big = std::numeric_limits<float>::max();
+    return Bvh::Box{ QVector3D(big, big, big), QVector3D(-big, -big, -big) };
+}
+
+float area(const Bvh::Box &box)
+{
+    const QVector3D d = box.max - box.min;
+    if (d.x() < 0.0f) {
+        return 0.0f;
+    }
+    return 2.0f * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+}
+
+// Maps the pixel rectangle onto the whole clip space, applied after the projection
+QMatrix4x4 rectangleMatrix(const QRect &rect, const QSize &viewport)
+{
+    const float w = float(viewport.width());
+    const float h = float(viewport.height());
+    // NDC extent of the rectangle, y up
+    const float x0 = 2.0f * rect.x() / w - 1.0f;
+    const float x1 = 2.0f * (rect.x() + rect.width()) / w - 1.0f;
+    const float y0 = 1.0f - 2.0f * (rect.y() + rect.height()) / h;
+    const float y1 = 1.0f - 2.0f * rect.y() / h;
+
+    QMatrix4x4 m;
+    m(0, 0) = 2.0f / (x1 - x0);
+    m(0, 3) = -(x1 + x0) / (x1 - x0);
+    m(1, 1) = 2.0f / (y1 - y0);
+    m(1, 3) = -(y1 + y0) / (y1 - y0);
+    return m;
+}
+
+} // namespace
+
+void Bvh::build(const QVector<Box> &boxes, int maxLeafSize)
+{
+    nodeList.clear();
+    treeDepth = 0;
+    const int count = boxes.size();
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0u);
+    if (count == 0) {
+        return;
+    }
+    maxLeafSize = qMax(1, maxLeafSize);
+
+    QVector<QVector3D> centroids(count);
+    for (int i = 0; i < count; ++i) {
+        centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+    }
+
+    nodeList.reserve(2 * count - 1);
+    nodeList.append(Node());
+
+    struct Task {
+        int node;
+        int first;
+        int count;
+        int depth;
+    };
+    QVector<Task> tasks;
+    tasks.append({ 0, 0, count, 1 });
+
+    while (!tasks.isEmpty()) {
+        const Task task = tasks.takeLast();
+        treeDepth = qMax(treeDepth, task.depth);
+
+        Box bounds = emptyBox();
+        Box centroidBounds = emptyBox();
+        for (int i = task.first; i < task.first + task.count; ++i) {
+            grow(bounds, boxes[order[i]]);
+            grow(centroidBounds, centroids[order[i]]);
+        }
+        Node &node = nodeList[task.node];
+        for (int k = 0; k < 3; ++k) {
+            node.min[k] = bounds.min[k];
+            node.max[k] = bounds.max[k];
+        }
+        node.first = quint32(task.first);
+        node.count = quint32(task.count);
+        if (task.count <= maxLeafSize || task.depth >= MaxDepth) {
+            continue;
+        }
+
+        // Binned SAH over all three axes; costs relative to one primitive test, one for the traversal step
+        int bestAxis = -1;
+        int bestSplit = 0;
+        float bestCost = float(task.count);
+        const float parentArea = qMax(area(bounds), 1e-30f);
+        for (int axis = 0; axis < 3; ++axis) {
+            const float lo = centroidBounds.min[axis];
+            const float extent = centroidBounds.max[axis] - lo;
+            if (extent <= 0.0f) {
+                continue;
+            }
+            Box binBoxes[BinCount];
+            int binCounts[BinCount] = {};
+            for (Box &box : binBoxes) {
+                box = emptyBox();
+            }
+            const float scale = BinCount / extent;
+            for (int i = task.first; i < task.first + task.count; ++i) {
+                const int bin = qMin(BinCount - 1, int((centroids[order[i]][axis] - lo) * scale));
+                ++binCounts[bin];
+                grow(binBoxes[bin], boxes[order[i]]);
+            }
+
+            // Right-to-left sweep stores the right side of every split, left-to-right evaluates it
+            float rightArea[BinCount];
+            int rightCount[BinCount];
+            Box right = emptyBox();
+            int rightSum = 0;
+            for (int b = BinCount - 1; b > 0; --b) {
+                grow(right, binBoxes[b]);
+                rightSum += binCounts[b];
+                rightArea[b] = area(right);
+                rightCount[b] = rightSum;
+            }
+            Box left = emptyBox();
+            int leftSum = 0;
+            for (int b = 0; b < BinCount - 1; ++b) {
+                grow(left, binBoxes[b]);
+                leftSum += binCounts[b];
+                if (leftSum == 0 || rightCount[b + 1] == 0) {
+                    continue;
+                }
+                const float cost = 1.0f + (area(left) * leftSum + rightArea[b + 1] * rightCount[b + 1]) / parentArea;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        int leftCount = 0;
+        if (bestAxis >= 0) {
+            const float lo = centroidBounds.min[bestAxis];
+            const float scale = BinCount / (centroidBounds.max[bestAxis] - lo);
+            quint32 *begin = order.data() + task.first;
+            quint32 *middle = std::partition(begin, begin + task.count, [&](quint32 primitive) {
+                return qMin(BinCount - 1, int((centroids[primitive][bestAxis] - lo) * scale)) <= bestSplit;
+            });
+            leftCount = int(middle - begin);
+        } else if (task.count > 4 * maxLeafSize) {
+            // SAH prefers a leaf, but a huge one would make every ray test it all: split at the median
+            int axis = 0;
+            const QVector3D extent = centroidBounds.max - centroidBounds.min;
+            if (extent.y() > extent[axis]) {
+                axis = 1;
+            }
+            if (extent.z() > extent[axis]) {
+                axis = 2;
+            }
+            if (extent[axis] <= 0.0f) {
+                continue;                  // Every centroid coincides: nothing separates them
+            }
+            leftCount = task.count / 2;
+            quint32 *begin = order.data() + task.first;
+            std::nth_element(begin, begin + leftCount, begin + task.count, [&](quint32 a, quint32 b) {
+                return centroids[a][axis] < centroids[b][axis];
+            });
+        } else {
+            continue;
+        }
+        if (leftCount == 0 || leftCount == task.count) {
+            continue;
+        }
+
+        const int leftNode = nodeList.size();
+        nodeList.append(Node());
+        nodeList.append(Node());
+        Node &parent = nodeList[task.node];
+        parent.first = quint32(leftNode);
+        parent.count = 0;
+        tasks.append({ leftNode, task.first, leftCount, task.depth + 1 });
+        tasks.append({ leftNode + 1, task.first + leftCount, task.count - leftCount, task.depth + 1 });
+    }
+}
+
+float Bvh::enter(const Node &node, const QVector3D &origin, const QVector3D &inverseDirection, float tMax)
+{
+    float t0 = 0.0f;
+    float t1 = tMax;
+    for (int k = 0; k < 3; ++k) {
+        float tNear = (node.min[k] - origin[k]) * inverseDirection[k];
+        float tFar = (node.max[k] - origin[k]) * inverseDirection[k];
+        if (tNear > tFar) {
+            std::swap(tNear, tFar);
+        }
+        // Written so a NaN (origin on a slab with a zero direction) leaves the interval alone
+        t0 = tNear > t0 ? tNear : t0;
+        t1 = tFar < t1 ? tFar : t1;
+        if (t0 > t1) {
+            return -1.0f;
+        }
+    }
+    return t0;
+}
+
+// ------------------- CPU Picking -------------------
+
+int CpuPicker::addMesh(const float *vertices, int vertexCount, int stride, const unsigned int *indices, int indexCount)
+{
+    MeshData mesh;
+    mesh.positions.resize(vertexCount);
+    mesh.bounds = emptyBox();
+    for (int i = 0; i < vertexCount; ++i) {
+        const float *v = vertices + qint64(i) * stride;
+        mesh.positions[i] = QVector3D(v[0], v[1], v[2]);
+        grow(mesh.bounds, mesh.positions[i]);
+    }
+    mesh.indices = QVector<quint32>(indices, indices + indexCount);
+
+    QVector<Bvh::Box> triangleBoxes(indexCount / 3);
+    for (int t = 0; t < triangleBoxes.size(); ++t) {
+        Bvh::Box box = emptyBox();
+        for (int k = 0; k < 3; ++k) {
+            grow(box, mesh.positions[mesh.indices[3 * t + k]]);
+        }
+        triangleBoxes[t] = box;
+    }
+    mesh.triangles.build(triangleBoxes, 4);
+    meshList.append(mesh);
+    return meshList.size() - 1;
+}
+
+void CpuPicker::setInstances(const QVector<QMatrix4x4> &models, const QVector<int> &meshes, quint32 firstId)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    idBase = firstId;
+    const int count = qMin(models.size(), meshes.size());
+    inverseModels.resize(count);
+    instanceMeshes = meshes.mid(0, count);
+    instanceBoxes.resize(count);
+    for (int i = 0; i < count; ++i) {
+        inverseModels[i] = models[i].inverted();
+        const Bvh::Box &local = meshList[meshes[i]].bounds;
+        Bvh::Box box = emptyBox();
+        for (int corner = 0; corner < 8; ++corner) {
+            const QVector3D p((corner & 1) ? local.max.x() : local.min.x(), (corner & 2) ? local.max.y() : local.min.y(),
+                              (corner & 4) ? local.max.z() : local.min.z());
+            grow(box, models[i].map(p));
+        }
+        instanceBoxes[i] = box;
+    }
+    instanceBvh.build(instanceBoxes, 2);
+    buildMs = timer.nsecsElapsed() / 1.0e6;
+}
+
+PickRay CpuPicker::rayThrough(const QPoint &pixel, const QMatrix4x4 &viewProjection, const QSize &viewport)
+{
+    const QMatrix4x4 inverse = viewProjection.inverted();
+    const float x = 2.0f * (pixel.x() + 0.5f) / viewport.width() - 1.0f;
+    const float y = 1.0f - 2.0f * (pixel.y() + 0.5f) / viewport.height();
+    QVector4D nearPoint = inverse * QVector4D(x, y, -1.0f, 1.0f);
+    QVector4D farPoint = inverse * QVector4D(x, y, 1.0f, 1.0f);
+    nearPoint /= nearPoint.w();
+    farPoint /= farPoint.w();
+    return PickRay{ nearPoint.toVector3D(), (farPoint - nearPoint).toVector3D() };
+}
+
+CpuPicker::Hit CpuPicker::pick(const QPoint &pixel, const QMatrix4x4 &viewProjection, const QSize &viewport,
+                               QueryStats *stats) const
+{
+    return intersect(rayThrough(pixel, viewProjection, viewport), stats);
+}
+
+CpuPicker::Hit CpuPicker::intersect(const PickRay &ray, QueryStats *stats) const
+{
+    QueryStats local;
+    Hit hit;
+    float tMax = 1.0f;
+    int hitInstance = -1;
+
+    local.nodesVisited += instanceBvh.intersect(ray, tMax, [&](quint32 instance, float &tInstance) {
+        ++local.instancesTested;
+        const MeshData &mesh = meshList[instanceMeshes[instance]];
+        const QMatrix4x4 &inverse = inverseModels[instance];
+        const PickRay objectRay{ inverse.map(ray.origin), inverse.mapVector(ray.direction) };
+
+        local.nodesVisited += mesh.triangles.intersect(objectRay, tInstance, [&](quint32 triangle, float &t) {
+            ++local.trianglesTested;
+            // Moller-Trumbore, two-sided
+            const QVector3D &a = mesh.positions[mesh.indices[3 * triangle]];
+            const QVector3D &b = mesh.positions[mesh.indices[3 * triangle + 1]];
+            const QVector3D &c = mesh.positions[mesh.indices[3 * triangle + 2]];
+            const QVector3D e1 = b - a;
+            const QVector3D e2 = c - a;
+            const QVector3D p = QVector3D::crossProduct(objectRay.direction, e2);
+            const float determinant = QVector3D::dotProduct(e1, p);
+            if (std::abs(determinant) < 1e-12f) {
+                return;
+            }
+            const float inverseDeterminant = 1.0f / determinant;
+            const QVector3D s = objectRay.origin - a;
+            const float u = QVector3D::dotProduct(s, p) * inverseDeterminant;
+            if (u < 0.0f || u > 1.0f) {
+                return;
+            }
+            const QVector3D q = QVector3D::crossProduct(s, e1);
+            const float v = QVector3D::dotProduct(objectRay.direction, q) * inverseDeterminant;
+            if (v < 0.0f || u + v > 1.0f) {
+                return;
+            }
+            const float distance = QVector3D::dotProduct(e2, q) * inverseDeterminant;
+            if (distance > 0.0f && distance < t) {
+                t = distance;
+                hitInstance = int(instance);
+                hit.triangle = int(triangle);
+            }
+        });
+    });
+
+    if (hitInstance >= 0) {
+        hit.id = idBase + quint32(hitInstance);
+        hit.position = ray.origin + ray.direction * tMax;
+        hit.distance = tMax * ray.direction.length();
+    } else {
+        hit.triangle = -1;
+    }
+    if (stats) {
+        *stats = local;
+    }
+    return hit;
+}
+
+QVector<quint32> CpuPicker::pickRect(const QRect &rect, const QMatrix4x4 &viewProjection, const QSize &viewport) const
+{
+    // Gribb-Hartmann planes of the rectangle's frustum; a box is outside when its most positive corner is behind one
+    const QMatrix4x4 m = rectangleMatrix(rect, viewport) * viewProjection;
+    const QVector4D row0 = m.row(0);
+    const QVector4D row1 = m.row(1);
+    const QVector4D row2 = m.row(2);
+    const QVector4D row3 = m.row(3);
+    const QVector4D planes[6] = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+    auto outside = [&planes](const float *min, const float *max) {
+        for (const QVector4D &plane : planes) {
+            const float x = plane.x() >= 0.0f ? max[0] : min[0];
+            const float y = plane.y() >= 0.0f ? max[1] : min[1];
+            const float z = plane.z() >= 0.0f ? max[2] : min[2];
+            if (plane.x() * x + plane.y() * y + plane.z() * z + plane.w() < 0.0f) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    QVector<quint32> ids;
+    instanceBvh.query([&](const Bvh::Node &node) { return !outside(node.min, node.max); },
+                      [&](quint32 instance) {
+                          const Bvh::Box &box = instanceBoxes[instance];
+                          const float min[3] = { box.min.x(), box.min.y(), box.min.z() };
+                          const float max[3] = { box.max.x(), box.max.y(), box.max.z() };
+                          if (!outside(min, max)) {
+                              ids.append(idBase + instance);
+                          }
+                      });
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+CpuPicker::Stats CpuPicker::stats() const
+{
+    Stats s;
+    s.meshes = meshList.size();
+    s.instances = instanceMeshes.size();
+    s.instanceBvhDepth = instanceBvh.depth();
+    s.buildMilliseconds = buildMs;
+    s.memoryBytes = instanceBvh.memoryBytes() + inverseModels.size() * qint64(sizeof(QMatrix4x4))
+                    + instanceBoxes.size() * qint64(sizeof(Bvh::Box)) + instanceMeshes.size() * qint64(sizeof(int));
+    for (const MeshData &mesh : meshList) {
+        s.triangles += mesh.indices.size() / 3;
+        s.memoryBytes += mesh.triangles.memoryBytes() + mesh.positions.size() * qint64(sizeof(QVector3D))
+                         + mesh.indices.size() * qint64(sizeof(quint32));
+    }
+    return s;
+}
+
+// ------------------- GPU Picking -------------------
+
+QMatrix4x4 GpuPicker::pickMatrix(const QRect &rect, const QSize &viewport)
+{
+    return rectangleMatrix(rect, viewport);
+}
+
+bool GpuPicker::initialize(int slotCount)
+{
+    if (initialized) {
+        release();
+    }
+    initializeOpenGLFunctions();
+
+    glGenFramebuffers(1, &framebuffer);
+    slots.resize(qMax(1, slotCount));
+    for (Slot &slot : slots) {
+        glGenBuffers(1, &slot.buffer);
+    }
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    targetMemory = memory.registerAllocation(GpuMemoryTracker::Category::RenderTarget, 0, "GpuPicker", "id buffer");
+    bufferMemory = memory.registerAllocation(GpuMemoryTracker::Category::PixelBuffer, 0, "GpuPicker",
+                                             "id readback buffers");
+    counters = Stats();
+    clock.start();
+    initialized = true;
+    return true;
+}
+
+void GpuPicker::release()
+{
+    if (!initialized) {
+        return;
+    }
+    for (Slot &slot : slots) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    slots.clear();
+    if (idTexture != 0) {
+        glDeleteTextures(1, &idTexture);
+        idTexture = 0;
+    }
+    if (depthBuffer != 0) {
+        glDeleteRenderbuffers(1, &depthBuffer);
+        depthBuffer = 0;
+    }
+    glDeleteFramebuffers(1, &framebuffer);
+    framebuffer = 0;
+    targetSize = QSize();
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    memory.release(targetMemory);
+    memory.release(bufferMemory);
+    targetMemory = bufferMemory = 0;
+    initialized = false;
+}
+
+bool GpuPicker::ensureTarget(const QSize &size)
+{
+    if (targetSize.width() >= size.width() && targetSize.height() >= size.height()) {
+        return true;
+    }
+    // Grown in 64-pixel steps and never shrunk: hover picks are 1 x 1, a drag selection grows it a few times at most
+    const QSize grown((qMax(size.width(), targetSize.width()) + 63) / 64 * 64,
+                      (qMax(size.height(), targetSize.height()) + 63) / 64 * 64);
+
+    if (idTexture == 0) {
+        glGenTextures(1, &idTexture);
+        glGenRenderbuffers(1, &depthBuffer);
+    }
+    GLint previousTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+    glBindTexture(GL_TEXTURE_2D, idTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, grown.width(), grown.height(), 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, GLuint(previousTexture));
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, grown.width(), grown.height());
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, idTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        qWarning() << "GpuPicker: id framebuffer is incomplete:" << Qt::hex << status;
+        return false;
+    }
+
+    targetSize = grown;
+    counters.targetBytes = qint64(grown.width()) * grown.height() * 8;
+    GpuMemoryTracker::instance().resize(targetMemory, counters.targetBytes);
+    return true;
+}
+
+quint64 GpuPicker::pick(const QRect &rect, const QSize &viewport, const DrawFunction &drawIds)
+{
+    const QRect area = rect & QRect(QPoint(0, 0), viewport);
+    if (!initialized || area.isEmpty()) {
+        return 0;
+    }
+    Slot *slot = nullptr;
+    for (Slot &candidate : slots) {
+        if (candidate.request == 0) {
+            slot = &candidate;
+            break;
+        }
+    }
+    if (!slot) {
+        ++counters.busy;
+        return 0;
+    }
+
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4] = {};
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+    const GLboolean scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+    GLint previousScissor[4] = {};
+    glGetIntegerv(GL_SCISSOR_BOX, previousScissor);
+    GLint previousPackBuffer = 0;
+    GLint previousPackAlignment = 4;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previousPackBuffer);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &previousPackAlignment);
+
+    if (!ensureTarget(area.size())) {
+        glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previousFramebuffer));
+        return 0;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, area.width(), area.height());
+
+    // Only the rectangle's corner of the target is cleared, drawn and read
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, area.width(), area.height());
+    const GLuint noObject[4] = { 0, 0, 0, 0 };
+    const GLfloat farDepth = 1.0f;
+    glClearBufferuiv(GL_COLOR, 0, noObject);
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    drawIds(pickMatrix(area, viewport));
+
+    const qint64 bytes = qint64(area.width()) * area.height() * qint64(sizeof(quint32));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    if (slot->capacity < bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        slot->capacity = bytes;
+        qint64 total = 0;
+        for (const Slot &s : std::as_const(slots)) {
+            total += s.capacity;
+        }
+        GpuMemoryTracker::instance().resize(bufferMemory, total);
+    }
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, area.width(), area.height(), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, previousPackAlignment);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, GLuint(previousPackBuffer));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previousFramebuffer));
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    if (!depthTest) {
+        glDisable(GL_DEPTH_TEST);
+    }
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+    glScissor(previousScissor[0], previousScissor[1], previousScissor[2], previousScissor[3]);
+    if (!scissorTest) {
+        glDisable(GL_SCISSOR_TEST);
+    }
+
+    slot->request = nextRequest++;
+    slot->rect = area;
+    slot->issuedNs = clock.nsecsElapsed();
+    slot->issuedFrame = frame;
+    ++counters.requests;
+    counters.readbackBytes += quint64(bytes);
+    return slot->request;
+}
+
+bool GpuPicker::takeResult(Result *result)
+{
+    // Oldest first, so results come back in request order
+    Slot *slot = nullptr;
+    for (Slot &candidate : slots) {
+        if (candidate.request != 0 && (!slot || candidate.request < slot->request)) {
+            slot = &candidate;
+        }
+    }
+    if (!slot) {
+        return false;
+    }
+    const GLenum status = glClientWaitSync(slot->fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    glDeleteSync(slot->fence);
+    slot->fence = nullptr;
+
+    Result r;
+    r.request = slot->request;
+    r.rect = slot->rect;
+    r.latencyMilliseconds = (clock.nsecsElapsed() - slot->issuedNs) / 1.0e6;
+    r.latencyFrames = int(frame - slot->issuedFrame);
+    slot->request = 0;
+    if (status == GL_WAIT_FAILED) {
+        qWarning() << "GpuPicker: waiting for a readback failed";
+        return false;
+    }
+
+    const int w = r.rect.width();
+    const int h = r.rect.height();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    const quint32 *ids = static_cast<const quint32 *>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, qint64(w) * h * qint64(sizeof(quint32)), GL_MAP_READ_BIT));
+    if (ids) {
+        // Rows are bottom-up; the center is that of the rectangle as seen on screen
+        r.id = ids[(h - 1 - h / 2) * w + w / 2];
+        quint32 previous = 0;
+        for (qint64 i = 0; i < qint64(w) * h; ++i) {
+            // Objects cover runs of pixels: skipping repeats keeps the sort small
+            if (ids[i] != 0 && ids[i] != previous) {
+                r.ids.append(ids[i]);
+            }
+            previous = ids[i];
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        std::sort(r.ids.begin(), r.ids.end());
+        r.ids.erase(std::unique(r.ids.begin(), r.ids.end()), r.ids.end());
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    ++counters.completed;
+    *result = r;
+    return true;
+}
+
+int GpuPicker::pending() const
+{
+    int count = 0;
+    for (const Slot &slot : slots) {
+        count += slot.request != 0 ? 1 : 0;
+    }
+    return count;
+}
@@ -0,0 +1,328 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+#include <QVector3D>
+#include <functional>
+#include <utility>
+#include "gpumemory.h"
+
+// ------------------- Bounding Volume Hierarchy -------------------
+
+struct PickRay {
+    QVector3D origin;
+    QVector3D direction;                   // Not normalized: t = 1 is the far plane
+};
+
+/**
+ * @brief Binned-SAH bounding volume hierarchy over axis-aligned boxes.
+ *
+ * Built top-down: every node is split at the best of 16 bins per axis by the
+ * surface area heuristic, or becomes a leaf when no split beats it. The two
+ * children of a node are adjacent in nodes(), and leaves reference a range of
+ * indices(), so traversal needs no pointers.
+ */
+class Bvh
+{
+public:
+    struct Box {
+        QVector3D min;
+        QVector3D max;
+    };
+
+    struct Node {
+        float min[3];
+        quint32 first;                     // Leaf: first index; interior: left child (right is first + 1)
+        float max[3];
+        quint32 count;                     // 0 for interior nodes
+    };
+
+    void build(const QVector<Box> &boxes, int maxLeafSize = 4);
+    bool isEmpty() const { return nodeList.isEmpty(); }
+    const QVector<Node> &nodes() const { return nodeList; }
+    const QVector<quint32> &indices() const { return order; }
+    int depth() const { return treeDepth; }
+    static constexpr int MaxDepth = 60;    // Deeper ranges become leaves; bounds the traversal stacks
+    qint64 memoryBytes() const { return nodeList.size() * qint64(sizeof(Node)) + order.size() * qint64(sizeof(quint32)); }
+
+    /**
+     * @brief Visits the primitives whose boxes the ray enters before @p tMax, nearer nodes first.
+     *
+     * @p test(primitive, tMax) checks one primitive and lowers tMax on a hit,
+     * which prunes everything behind it.
+     * @return Number of nodes visited.
+     */
+    template <typename TestFunction>
+    int intersect(const PickRay &ray, float &tMax, TestFunction &&test) const;
+
+    /**
+     * @brief Calls @p visit(primitive) for every leaf primitive under nodes accepted by @p overlaps(node).
+     */
+    template <typename OverlapFunction, typename VisitFunction>
+    void query(OverlapFunction &&overlaps, VisitFunction &&visit) const;
+
+    /**
+     * @brief Slab test; the entry distance, or a negative value on a miss.
+     */
+    static float enter(const Node &node, const QVector3D &origin, const QVector3D &inverseDirection, float tMax);
+
+private:
+    QVector<Node> nodeList;
+    QVector<quint32> order;
+    int treeDepth = 0;
+};
+
+template <typename TestFunction>
+int Bvh::intersect(const PickRay &ray, float &tMax, TestFunction &&test) const
+{
+    if (nodeList.isEmpty()) {
+        return 0;
+    }
+    const QVector3D inverse(1.0f / ray.direction.x(), 1.0f / ray.direction.y(), 1.0f / ray.direction.z());
+    if (enter(nodeList[0], ray.origin, inverse, tMax) < 0.0f) {
+        return 1;
+    }
+
+    quint32 stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    int visited = 0;
+    while (top > 0) {
+        const Node &node = nodeList[stack[--top]];
+        ++visited;
+        if (node.count > 0) {
+            for (quint32 i = 0; i < node.count; ++i) {
+                test(order[node.first + i], tMax);
+            }
+            continue;
+        }
+        // Push the farther child first so the nearer one is tested first and shrinks tMax for the other
+        const float left = enter(nodeList[node.first], ray.origin, inverse, tMax);
+        const float right = enter(nodeList[node.first + 1], ray.origin, inverse, tMax);
+        if (left >= 0.0f && right >= 0.0f) {
+            const bool leftFirst = left <= right;
+            stack[top++] = leftFirst ? node.first + 1 : node.first;
+            stack[top++] = leftFirst ? node.first : node.first + 1;
+        } else if (left >= 0.0f) {
+            stack[top++] = node.first;
+        } else if (right >= 0.0f) {
+            stack[top++] = node.first + 1;
+        }
+    }
+    return visited;
+}
+
+template <typename OverlapFunction, typename VisitFunction>
+void Bvh::query(OverlapFunction &&overlaps, VisitFunction &&visit) const
+{
+    if (nodeList.isEmpty()) {
+        return;
+    }
+    quint32 stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node &node = nodeList[stack[--top]];
+        if (!overlaps(node)) {
+            continue;
+        }
+        if (node.count > 0) {
+            for (quint32 i = 0; i < node.count; ++i) {
+                visit(order[node.first + i]);
+            }
+        } else {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+        }
+    }
+}
+
+// ------------------- CPU Picking -------------------
+
+/**
+ * @brief Ray-cast picking against instanced meshes.
+ *
+ * Two levels: one BVH over the world-space boxes of all instances, and one
+ * per mesh over its triangles in object space. A ray enters an instance by
+ * being transformed with its inverse model matrix (the direction is not
+ * renormalized, so distances along it stay comparable), and the nearest
+ * triangle hit over all instances wins.
+ *
+ * Rectangle selection returns every instance whose box intersects the
+ * rectangle's frustum, occluded or not; GpuPicker returns only what is
+ * visible. Ids are firstId + instance index; 0 means nothing.
+ */
+class CpuPicker
+{
+public:
+    struct Hit {
+        quint32 id = 0;
+        float distance = 0.0f;             // World units from the near plane
+        QVector3D position;
+        int triangle = -1;
+    };
+
+    struct QueryStats {
+        int nodesVisited = 0;              // Instance and triangle BVH nodes
+        int instancesTested = 0;
+        int trianglesTested = 0;
+    };
+
+    struct Stats {
+        int meshes = 0;
+        int instances = 0;
+        qint64 triangles = 0;              // In the meshes, not multiplied by instances
+        int instanceBvhDepth = 0;
+        qint64 memoryBytes = 0;
+        double buildMilliseconds = 0.0;    // Last setInstances()
+    };
+
+    /**
+     * @brief Adds a mesh; @p stride is in floats and the position comes first.
+     * @return Mesh index for setInstances().
+     */
+    int addMesh(const float *vertices, int vertexCount, int stride, const unsigned int *indices, int indexCount);
+    /**
+     * @brief Replaces the instances and rebuilds the instance BVH.
+     * @param meshes Mesh index of each instance.
+     */
+    void setInstances(const QVector<QMatrix4x4> &models, const QVector<int> &meshes, quint32 firstId = 1);
+
+    Hit pick(const QPoint &pixel, const QMatrix4x4 &viewProjection, const QSize &viewport,
+             QueryStats *stats = nullptr) const;
+    Hit intersect(const PickRay &ray, QueryStats *stats = nullptr) const;
+    /**
+     * @brief Ids of the instances whose boxes intersect the frustum of @p rect, ascending.
+     */
+    QVector<quint32> pickRect(const QRect &rect, const QMatrix4x4 &viewProjection, const QSize &viewport) const;
+
+    /**
+     * @brief Ray through the center of @p pixel (origin top-left) from the near to the far plane.
+     */
+    static PickRay rayThrough(const QPoint &pixel, const QMatrix4x4 &viewProjection, const QSize &viewport);
+
+    Stats stats() const;
+
+private:
+    struct MeshData {
+        QVector<QVector3D> positions;
+        QVector<quint32> indices;
+        Bvh triangles;
+        Bvh::Box bounds;
+    };
+
+    QVector<MeshData> meshList;
+    QVector<QMatrix4x4> inverseModels;
+    QVector<int> instanceMeshes;
+    QVector<Bvh::Box> instanceBoxes;
+    Bvh instanceBvh;
+    quint32 idBase = 1;
+    double buildMs = 0.0;
+};
+
+// ------------------- GPU Picking -------------------
+
+/**
+ * @brief Picking through an integer id buffer read back asynchronously.
+ *
+ * pick() renders only the requested rectangle: the draw function gets a pick
+ * matrix that maps the rectangle onto the whole clip space, to be applied
+ * after the projection, and writes each fragment's object id (0 is nothing)
+ * to a GL_R32UI target the size of the rectangle. The pixels are copied into
+ * a pixel pack buffer and fenced; takeResult() maps the buffer only once the
+ * fence has signalled, a frame or so later, so the CPU never waits for the GPU.
+ *
+ * A few readbacks can be in flight (slots); pick() returns 0 when all are busy.
+ * pick() restores the framebuffer, viewport, scissor, depth test, blending, the
+ * 2D texture and pixel pack buffer bindings and the pack alignment it changes.
+ * All GL calls must be made with the owning context current.
+ */
+class GpuPicker : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    using DrawFunction = std::function<void(const QMatrix4x4 &pickMatrix)>;
+
+    struct Result {
+        quint64 request = 0;
+        QRect rect;
+        quint32 id = 0;                    // At the center of the rectangle (the pixel of a single-pixel pick)
+        QVector<quint32> ids;              // Distinct non-zero ids in the rectangle, ascending
+        double latencyMilliseconds = 0.0;  // From pick() to the data being available
+        int latencyFrames = 0;             // newFrame() calls in between
+    };
+
+    struct Stats {
+        quint64 requests = 0;
+        quint64 completed = 0;
+        quint64 busy = 0;                  // pick() calls refused because every slot was in flight
+        quint64 readbackBytes = 0;
+        qint64 targetBytes = 0;
+    };
+
+    GpuPicker() = default;
+
+    bool initialize(int slots = 3);
+    /**
+     * @brief Deletes the target, buffers and fences; call with the context current.
+     */
+    void release();
+    bool isInitialized() const { return initialized; }
+
+    /**
+     * @brief Renders the ids inside @p rect (pixels, origin top-left) and queues their readback.
+     * @return Request number, or 0 if every slot is in flight or the rectangle is empty.
+     */
+    quint64 pick(const QRect &rect, const QSize &viewport, const DrawFunction &drawIds);
+    quint64 pickPixel(const QPoint &pixel, const QSize &viewport, const DrawFunction &drawIds)
+    {
+        return pick(QRect(pixel, QSize(1, 1)), viewport, drawIds);
+    }
+
+    /**
+     * @brief Oldest finished request, without blocking.
+     */
+    bool takeResult(Result *result);
+    int pending() const;
+    void newFrame() { ++frame; }
+
+    Stats stats() const { return counters; }
+
+    /**
+     * @brief Matrix that maps @p rect of @p viewport onto the whole clip space.
+     */
+    static QMatrix4x4 pickMatrix(const QRect &rect, const QSize &viewport);
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        qint64 capacity = 0;
+        GLsync fence = nullptr;
+        quint64 request = 0;               // 0: free
+        QRect rect;
+        qint64 issuedNs = 0;
+        quint64 issuedFrame = 0;
+    };
+
+    bool ensureTarget(const QSize &size);
+
+    bool initialized = false;
+    GLuint framebuffer = 0;
+    GLuint idTexture = 0;
+    GLuint depthBuffer = 0;
+    QSize targetSize;
+    QVector<Slot> slots;
+    quint64 nextRequest = 1;
+    quint64 frame = 0;
+    QElapsedTimer clock;
+    Stats counters;
+    GpuMemoryTracker::Handle targetMemory = 0;
+    GpuMemoryTracker::Handle bufferMemory = 0;
+};
+
+#endif // PICKING_H
@@ -0,0 +1,548 @@
+#include "pointcloud.h"
+#include "perftrace.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QVector3D>
+#include <QVector4D>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <queue>
+#include <utility>
+
+using namespace pointcloud;
+
+static const float Sqrt3 = 1.7320508f;
+
+// ------------------- Point Cloud File -------------------
+
+PointCloudFile::~PointCloudFile()
+{
+    close();
+}
+
+bool PointCloudFile::open(const QString &filePath)
+{
+    close();
+
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "PointCloudFile: cannot open" << filePath;
+        return false;
+    }
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(CloudHeader))) {
+        qWarning() << "PointCloudFile:" << filePath << "is too small";
+        close();
+        return false;
+    }
+    begin = file.map(0, size);
+    if (!begin) {
+        qWarning() << "PointCloudFile: cannot map" << filePath;
+        close();
+        return false;
+    }
+
+    std::memcpy(&fileHeader, begin, sizeof(fileHeader));
+    const CloudHeader &h = fileHeader;
+    if (h.magic != Magic || h.version != Version || h.fileSize != quint64(size)) {
+        qWarning() << "PointCloudFile:" << filePath << "is not a version" << Version << "point cloud";
+        close();
+        return false;
+    }
+
+    // The node table is checked completely; it is small next to the chunks, which are not read here
+    bool ok = h.nodeCount > 0 && h.nodeTableOffset >= sizeof(CloudHeader) && h.nodeTableOffset % 8 == 0
+              && h.nodeTableOffset + quint64(h.nodeCount) * sizeof(Node) <= h.fileSize && h.size > 0.0f;
+    quint64 points = 0;
+    if (ok) {
+        nodeList = reinterpret_cast<const Node *>(begin + h.nodeTableOffset);
+        for (quint32 i = 0; ok && i < h.nodeCount; ++i) {
+            const Node &n = nodeList[i];
+            const quint64 bytes = quint64(n.pointCount) * sizeof(Point);
+            ok = n.halfSize > 0.0f && n.offset % ChunkAlignment == 0 && n.offset >= sizeof(CloudHeader)
+                 && n.offset + bytes <= h.nodeTableOffset && n.pointCount <= h.maxNodePoints
+                 && (n.childMask == 0
+                     || (n.firstChild > i && quint64(n.firstChild) + childCount(n.childMask) <= h.nodeCount));
+            points += n.pointCount;
+        }
+        ok = ok && points == h.pointCount;
+    }
+    if (!ok) {
+        qWarning() << "PointCloudFile: corrupt node table in" << filePath;
+        close();
+        return false;
+    }
+
+    qDebug() << "PointCloudFile: mapped" << filePath << "with" << h.pointCount << "points in" << h.nodeCount
+             << "nodes," << h.depth + 1 << "levels";
+    return true;
+}
+
+void PointCloudFile::close()
+{
+    if (begin) {
+        file.unmap(const_cast<uchar *>(begin));
+    }
+    file.close();
+    begin = nullptr;
+    fileHeader = CloudHeader();
+    nodeList = nullptr;
+}
+
+// ------------------- Setup -------------------
+
+PointCloudRenderer::~PointCloudRenderer()
+{
+    // GL objects must have been released through release() while the context was current.
+    loaders.clear();
+    loaders.waitForDone();
+}
+
+bool PointCloudRenderer::initialize(const QString &filePath, const Params &params)
+{
+    if (initialized) {
+        release();
+    }
+    initializeOpenGLFunctions();
+
+    if (!file.open(filePath)) {
+        return false;
+    }
+    variant = shaderVariants.variant(ShaderFeatures::VertexColor | ShaderFeatures::Transform);
+    if (!variant) {
+        shaderVariants.release();
+        file.close();
+        return false;
+    }
+
+    settings = params;
+    settings.pointBudget = qMax<qint64>(1, settings.pointBudget);
+    const qint64 budgetBytes = settings.pointBudget * qint64(sizeof(Point));
+    if (settings.poolBytes < budgetBytes) {
+        qWarning() << "PointCloudRenderer: a" << settings.poolBytes / (1024 * 1024) << "MiB pool holds fewer than"
+                   << settings.pointBudget << "points; frames draw what fits";
+    }
+
+    // The attributes are pointed at each chunk's buffer in render()
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+
+    states.fill(NodeState(), file.nodeCount());
+    const int threads = qMax(1, settings.loaderThreads);
+    loaders.setMaxThreadCount(threads);
+    // Enough requests to keep every loader busy while the previous chunks are uploaded
+    maxInFlight = threads * 4;
+
+    memory = GpuMemoryTracker::instance().registerAllocation(GpuMemoryTracker::Category::VertexBuffer, 0,
+                                                             "PointCloudRenderer", QFileInfo(filePath).fileName());
+    counters = Stats();
+    counters.poolBytes = settings.poolBytes;
+    initialized = true;
+    return true;
+}
+
+// ------------------- Node Selection -------------------
+
+void PointCloudRenderer::select(const QMatrix4x4 &view, const QMatrix4x4 &projection, const QSize &viewportSize)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    ++frame;
+    selection.clear();
+
+    // Frustum planes (Gribb / Hartmann), normalized so a distance compares against a radius
+    const QMatrix4x4 viewProjection = projection * view;
+    QVector4D planes[6] = {
+        viewProjection.row(3) + viewProjection.row(0), viewProjection.row(3) - viewProjection.row(0),
+        viewProjection.row(3) + viewProjection.row(1), viewProjection.row(3) - viewProjection.row(1),
+        viewProjection.row(3) + viewProjection.row(2), viewProjection.row(3) - viewProjection.row(2)
+    };
+    for (QVector4D &plane : planes) {
+        plane /= plane.toVector3D().length();
+    }
+    const auto visible = [&planes](const QVector3D &center, float radius) {
+        for (const QVector4D &plane : planes) {
+            if (QVector3D::dotProduct(plane.toVector3D(), center) + plane.w() < -radius) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    const QVector3D eye = view.inverted().column(3).toVector3D();
+    // Pixels covered by one unit at distance one
+    const float pixelsPerUnit = projection(1, 1) * float(viewportSize.height()) * 0.5f;
+    const float nearest = file.header().size * 1.0e-6f;
+    const auto distanceTo = [&eye, nearest](const QVector3D &center, float radius) {
+        return qMax((center - eye).length() - radius, nearest);
+    };
+
+    // Largest on screen first
+    struct Candidate {
+        float pixels = 0.0f;
+        int node = 0;
+        bool operator<(const Candidate &other) const { return pixels < other.pixels; }
+    };
+    std::priority_queue<Candidate> candidates;
+    const Node &root = file.node(0);
+    const QVector3D rootCenter(root.center[0], root.center[1], root.center[2]);
+    if (visible(rootCenter, root.halfSize * Sqrt3)) {
+        candidates.push({ 0.0f, 0 });
+    }
+
+    qint64 points = 0;
+    while (!candidates.empty()) {
+        const int index = candidates.top().node;
+        candidates.pop();
+        const Node &node = file.node(index);
+        if (points + node.pointCount > settings.pointBudget) {
+            break;
+        }
+        points += node.pointCount;
+        selection.append(index);
+        states[index].lastSelectedFrame = frame;
+
+        const QVector3D center(node.center[0], node.center[1], node.center[2]);
+        if (node.childMask == 0 || node.spacing * pixelsPerUnit / distanceTo(center, node.halfSize * Sqrt3)
+                                       <= settings.pixelSpacing) {
+            continue;
+        }
+        const float childHalf = node.halfSize * 0.5f;
+        int child = int(node.firstChild);
+        for (int octant = 0; octant < 8; ++octant) {
+            if (!(node.childMask & (1 << octant))) {
+                continue;
+            }
+            const Node &c = file.node(child);
+            const QVector3D childCenter(c.center[0], c.center[1], c.center[2]);
+            if (visible(childCenter, childHalf * Sqrt3)) {
+                candidates.push({ childHalf * Sqrt3 * pixelsPerUnit / distanceTo(childCenter, childHalf * Sqrt3),
+                                  child });
+            }
+            ++child;
+        }
+    }
+
+    counters.selectedNodes = selection.size();
+    counters.selectedPoints = points;
+    counters.selectMilliseconds = timer.nsecsElapsed() / 1.0e6;
+}
+
+// ------------------- Streaming -------------------
+
+void PointCloudRenderer::update(const QMatrix4x4 &view, const QMatrix4x4 &projection, const QSize &viewportSize)
+{
+    if (!initialized) {
+        return;
+    }
+    PERFTRACE_SCOPE("PointCloudRenderer::update");
+
+    select(view, projection, viewportSize);
+    drainLoaded(settings.uploadBytesPerFrame);
+
+    // What the pool can give without touching this frame's selection, less what is already on its way
+    qint64 available = settings.poolBytes - poolUsed - inFlightBytes;
+    for (const PoolBuffer &free : std::as_const(freeBuffers)) {
+        available += free.capacity;
+    }
+    for (int node : std::as_const(residentList)) {
+        if (states[node].lastSelectedFrame != frame) {
+            available += states[node].capacity;
+        }
+    }
+
+    for (int node : std::as_const(selection)) {
+        if (inFlight >= maxInFlight) {
+            break;
+        }
+        const NodeState &state = states[node];
+        const qint64 bytes = file.chunkBytes(node);
+        if (state.buffer != 0 || state.loading || bytes == 0) {
+            continue;
+        }
+        // In priority order: a smaller chunk further down does not jump the queue
+        if (bytes > available) {
+            break;
+        }
+        available -= bytes;
+        requestLoad(node);
+    }
+}
+
+void PointCloudRenderer::requestLoad(int node)
+{
+    const qint64 bytes = file.chunkBytes(node);
+    states[node].loading = true;
+    ++inFlight;
+    inFlightBytes += bytes;
+
+    const char *source = reinterpret_cast<const char *>(file.chunk(node));
+    loaders.start([this, node, source, bytes]() {
+        PERFTRACE_SCOPE("load point chunk");
+        // The copy faults the pages in: a disk read if they are not cached
+        Loaded result;
+        result.node = node;
+        result.points = QByteArray(source, qsizetype(bytes));
+        QMutexLocker locker(&loadedMutex);
+        loaded.append(std::move(result));
+    });
+}
+
+void PointCloudRenderer::waitForLoads()
+{
+    loaders.waitForDone();
+    drainLoaded(-1);
+}
+
+void PointCloudRenderer::drainLoaded(qint64 budget)
+{
+    QVector<Loaded> ready;
+    {
+        QMutexLocker locker(&loadedMutex);
+        ready.swap(loaded);
+    }
+    if (ready.isEmpty()) {
+        return;
+    }
+
+    GLint previousBuffer = 0;
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousBuffer);
+
+    qint64 spent = 0;
+    int next = 0;
+    for (; next < ready.size(); ++next) {
+        const Loaded &result = ready[next];
+        const qint64 bytes = result.points.size();
+        // Always make progress, even if a single chunk is larger than the budget
+        if (budget >= 0 && spent > 0 && spent + bytes > budget) {
+            break;
+        }
+
+        states[result.node].loading = false;
+        --inFlight;
+        inFlightBytes -= bytes;
+        if (states[result.node].lastSelectedFrame == frame && upload(result.node, result.points)) {
+            spent += bytes;
+        } else {
+            ++counters.loadsDiscarded;
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, GLuint(previousBuffer));
+
+    if (next < ready.size()) {
+        // Over this frame's budget: keep the rest, ahead of anything finished meanwhile
+        QMutexLocker locker(&loadedMutex);
+        ready.remove(0, next);
+        ready.append(loaded);
+        loaded.swap(ready);
+    }
+}
+
+bool PointCloudRenderer::upload(int node, const QByteArray &points)
+{
+    const qint64 bytes = points.size();
+    PoolBuffer target;
+    if (!acquireBuffer(bytes, &target)) {
+        return false;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, target.buffer);
+    if (target.capacity == bytes) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(bytes), points.constData());
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(bytes), points.constData(), GL_STATIC_DRAW);
+        setPoolUsed(poolUsed + bytes - target.capacity);
+        target.capacity = bytes;
+    }
+
+    NodeState &state = states[node];
+    state.buffer = target.buffer;
+    state.capacity = target.capacity;
+    residentList.append(node);
+    ++counters.chunksLoaded;
+    counters.bytesStreamed += bytes;
+    return true;
+}
+
+bool PointCloudRenderer::acquireBuffer(qint64 bytes, PoolBuffer *result)
+{
+    for (;;) {
+        // A free buffer of exactly this size is reused as it is; leaves of the same cloud often match
+        for (int i = 0; i < freeBuffers.size(); ++i) {
+            if (freeBuffers[i].capacity == bytes) {
+                *result = freeBuffers.takeAt(i);
+                return true;
+            }
+        }
+        if (poolUsed + bytes <= settings.poolBytes) {
+            result->capacity = 0;
+            glGenBuffers(1, &result->buffer);
+            return true;
+        }
+        // Otherwise a free buffer is respecified to the new size, once the pool has room for the difference
+        if (!freeBuffers.isEmpty()) {
+            const auto largest = std::max_element(freeBuffers.begin(), freeBuffers.end(),
+                                                  [](const PoolBuffer &a, const PoolBuffer &b) {
+                                                      return a.capacity < b.capacity;
+                                                  });
+            if (poolUsed - largest->capacity + bytes <= settings.poolBytes) {
+                *result = *largest;
+                freeBuffers.erase(largest);
+                return true;
+            }
+            glDeleteBuffers(1, &largest->buffer);
+            setPoolUsed(poolUsed - largest->capacity);
+            freeBuffers.erase(largest);
+            continue;
+        }
+        // Then the least recently selected chunk goes, never one of this frame's
+        int victim = -1;
+        for (int node : std::as_const(residentList)) {
+            if (states[node].lastSelectedFrame != frame
+                && (victim < 0 || states[node].lastSelectedFrame < states[victim].lastSelectedFrame)) {
+                victim = node;
+            }
+        }
+        if (victim < 0) {
+            return false;
+        }
+        evict(victim);
+    }
+}
+
+void PointCloudRenderer::evict(int node)
+{
+    NodeState &state = states[node];
+    freeBuffers.append({ state.buffer, state.capacity });
+    state.buffer = 0;
+    state.capacity = 0;
+    residentList.removeOne(node);
+    ++counters.chunksEvicted;
+}
+
+void PointCloudRenderer::setPoolUsed(qint64 bytes)
+{
+    poolUsed = bytes;
+    GpuMemoryTracker::instance().resize(memory, poolUsed);
+}
+
+// ------------------- Drawing -------------------
+
+void PointCloudRenderer::render(const QMatrix4x4 &view, const QMatrix4x4 &projection)
+{
+    counters.renderedNodes = 0;
+    counters.renderedPoints = 0;
+    if (!initialized) {
+        return;
+    }
+
+    QOpenGLShaderProgram *program = variant->program;
+    program->bind();
+    program->setUniformValue(variant->model, QMatrix4x4());
+    program->setUniformValue(variant->view, view);
+    program->setUniformValue(variant->projection, projection);
+    glPointSize(settings.pointSize);
+
+    GLint previousBuffer = 0;
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousBuffer);
+    glBindVertexArray(vao);
+    for (int node : std::as_const(selection)) {
+        const NodeState &state = states[node];
+        if (state.buffer == 0) {
+            continue;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, state.buffer);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Point), nullptr);
+        glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Point),
+                              reinterpret_cast<void *>(offsetof(Point, color)));
+        const GLsizei count = GLsizei(file.node(node).pointCount);
+        glDrawArrays(GL_POINTS, 0, count);
+        ++counters.renderedNodes;
+        counters.renderedPoints += count;
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, GLuint(previousBuffer));
+    program->release();
+}
+
+// ------------------- Teardown -------------------
+
+void PointCloudRenderer::release()
+{
+    loaders.clear();
+    loaders.waitForDone();
+    {
+        QMutexLocker locker(&loadedMutex);
+        loaded.clear();
+    }
+    if (!initialized) {
+        return;
+    }
+
+    for (NodeState &state : states) {
+        if (state.buffer != 0) {
+            glDeleteBuffers(1, &state.buffer);
+        }
+    }
+    for (PoolBuffer &free : freeBuffers) {
+        glDeleteBuffers(1, &free.buffer);
+    }
+    if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+        vao = 0;
+    }
+    shaderVariants.release();
+    variant = nullptr;
+    GpuMemoryTracker::instance().release(memory);
+    memory = 0;
+    file.close();
+
+    states.clear();
+    selection.clear();
+    residentList.clear();
+    freeBuffers.clear();
+    poolUsed = 0;
+    inFlight = 0;
+    inFlightBytes = 0;
+    initialized = false;
+}
+
+// ------------------- Statistics -------------------
+
+PointCloudRenderer::Stats PointCloudRenderer::stats() const
+{
+    Stats result = counters;
+    result.residentNodes = residentList.size();
+    result.residentBytes = 0;
+    for (int node : residentList) {
+        result.residentBytes += states[node].capacity;
+    }
+    result.poolUsedBytes = poolUsed;
+    result.pendingLoads = inFlight;
+    return result;
+}
+
+QString PointCloudRenderer::report() const
+{
+    const Stats s = stats();
+    return QString("PointCloudRenderer: %1 / %2 points drawn in %3 nodes, %4 nodes resident (%5 / %6 MiB), "
+                   "%7 chunks loaded (%8 MiB), %9 evicted, %10 discarded, %11 pending")
+        .arg(s.renderedPoints)
+        .arg(s.selectedPoints)
+        .arg(s.renderedNodes)
+        .arg(s.residentNodes)
+        .arg(s.residentBytes / (1024.0 * 1024.0), 0, 'f', 2)
+        .arg(s.poolBytes / (1024.0 * 1024.0), 0, 'f', 2)
+        .arg(s.chunksLoaded)
+        .arg(s.bytesStreamed / (1024.0 * 1024.0), 0, 'f', 2)
+        .arg(s.chunksEvicted)
+        .arg(s.loadsDiscarded)
+        .arg(s.pendingLoads);
+}
@@ -0,0 +1,195 @@
+#ifndef POINTCLOUD_H
+#define POINTCLOUD_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QByteArray>
+#include <QFile>
+#include <QMatrix4x4>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include "gpumemory.h"
+#include "pointcloudformat.h"
+#include "shadervariants.h"
+
+// ------------------- Point Cloud File -------------------
+
+/**
+ * @brief Read-only view of a point cloud octree (common/pointcloudformat.h), written by tools/pointcloud.
+ *
+ * open() maps the whole file and validates the header and the node table;
+ * the chunks are not touched, so opening a cloud of billions of points reads
+ * a few pages. chunk() returns pointers into the mapping, valid until close().
+ * The mapping may be read from any thread.
+ */
+class PointCloudFile
+{
+public:
+    PointCloudFile() = default;
+    ~PointCloudFile();
+
+    bool open(const QString &filePath);
+    void close();
+    bool isOpen() const { return begin != nullptr; }
+
+    const pointcloud::CloudHeader &header() const { return fileHeader; }
+    int nodeCount() const { return int(fileHeader.nodeCount); }
+    const pointcloud::Node &node(int index) const { return nodeList[index]; }
+    const pointcloud::Point *chunk(int index) const
+    {
+        return reinterpret_cast<const pointcloud::Point *>(begin + nodeList[index].offset);
+    }
+    qint64 chunkBytes(int index) const
+    {
+        return qint64(nodeList[index].pointCount) * qint64(sizeof(pointcloud::Point));
+    }
+    QString filePath() const { return file.fileName(); }
+
+private:
+    QFile file;
+    const uchar *begin = nullptr;
+    pointcloud::CloudHeader fileHeader;
+    const pointcloud::Node *nodeList = nullptr;
+};
+
+// ------------------- Point Cloud Renderer -------------------
+
+/**
+ * @brief Draws a point cloud octree far larger than memory, streaming its chunks on demand.
+ *
+ * update() selects the nodes to draw: starting from the root, the nodes
+ * inside the frustum are visited largest projected size first, and a node's
+ * children are visited only while its sampling spacing covers more than
+ * pixelSpacing pixels on screen. Selection stops when the next node would
+ * take the frame over pointBudget points.
+ *
+ * Selected nodes that are not resident are read on a loader pool: a worker
+ * copies the chunk out of the file mapping, so the page faults (the actual
+ * disk reads) happen off the render thread. update() uploads finished chunks,
+ * up to uploadBytesPerFrame, into vertex buffers of a fixed-size pool. When
+ * the pool is full, the least recently selected chunks are evicted and their
+ * buffers reused; a chunk that would only fit by evicting one selected this
+ * frame is not requested.
+ *
+ * Points are position + normalized RGB, drawn as GL_POINTS with the
+ * VertexColor | Transform shader variant (position at location 0, color at 1).
+ * All GL calls must be made with the owning context current.
+ */
+class PointCloudRenderer : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Params {
+        qint64 pointBudget = 4000000;                  // Points drawn per frame, at most
+        qint64 poolBytes = 256ll * 1024 * 1024;        // Vertex buffers of all resident chunks
+        qint64 uploadBytesPerFrame = 16ll * 1024 * 1024;
+        float pixelSpacing = 2.0f;                     // Refine while a node's spacing covers more pixels
+        float pointSize = 2.0f;                        // In pixels
+        int loaderThreads = 2;                         // Disk bound, not CPU bound
+    };
+
+    struct Stats {
+        int selectedNodes = 0;                         // Last update()
+        qint64 selectedPoints = 0;
+        int renderedNodes = 0;                         // Last render(): selected and resident
+        qint64 renderedPoints = 0;
+        int residentNodes = 0;
+        qint64 residentBytes = 0;                      // Buffers of resident chunks
+        qint64 poolUsedBytes = 0;                      // Plus free buffers kept for reuse
+        qint64 poolBytes = 0;
+        quint64 chunksLoaded = 0;                      // Uploaded; the counters below are cumulative
+        quint64 chunksEvicted = 0;
+        quint64 loadsDiscarded = 0;                    // Read but no longer selected when they arrived
+        qint64 bytesStreamed = 0;                      // Uploaded
+        int pendingLoads = 0;
+        double selectMilliseconds = 0.0;               // CPU time of the last selection
+    };
+
+    PointCloudRenderer() = default;
+    ~PointCloudRenderer();
+
+    bool initialize(const QString &filePath) { return initialize(filePath, Params()); }
+    /**
+     * @brief Maps @p filePath and sets up the pool and the loaders. Context must be current.
+     */
+    bool initialize(const QString &filePath, const Params &params);
+    bool isInitialized() const { return initialized; }
+
+    /**
+     * @brief Selects the nodes for this view, uploads finished chunks and requests missing ones.
+     * @param viewportSize In device pixels.
+     */
+    void update(const QMatrix4x4 &view, const QMatrix4x4 &projection, const QSize &viewportSize);
+    /**
+     * @brief Draws the resident nodes of the last selection.
+     */
+    void render(const QMatrix4x4 &view, const QMatrix4x4 &projection);
+    /**
+     * @brief Blocks until every requested chunk has been read, then uploads them all.
+     */
+    void waitForLoads();
+
+    /**
+     * @brief Deletes the buffers, waits for the loaders and unmaps the file. Context must be current.
+     */
+    void release();
+
+    const PointCloudFile &cloud() const { return file; }
+    Stats stats() const;
+    QString report() const;
+
+private:
+    struct NodeState {
+        GLuint buffer = 0;
+        qint64 capacity = 0;                           // Of buffer
+        quint64 lastSelectedFrame = 0;
+        bool loading = false;
+    };
+
+    struct PoolBuffer {
+        GLuint buffer = 0;
+        qint64 capacity = 0;
+    };
+
+    struct Loaded {
+        int node = 0;
+        QByteArray points;
+    };
+
+    void select(const QMatrix4x4 &view, const QMatrix4x4 &projection, const QSize &viewportSize);
+    void requestLoad(int node);
+    void drainLoaded(qint64 budget);                   // budget < 0 uploads everything
+    bool upload(int node, const QByteArray &points);
+    bool acquireBuffer(qint64 bytes, PoolBuffer *result);
+    void evict(int node);
+    void setPoolUsed(qint64 bytes);
+
+    bool initialized = false;
+    Params settings;
+    PointCloudFile file;
+    ShaderVariantCache shaderVariants;
+    const ShaderVariant *variant = nullptr;
+    GLuint vao = 0;
+    GpuMemoryTracker::Handle memory = 0;
+
+    QVector<NodeState> states;
+    QVector<int> selection;                            // Nodes of the last update(), in priority order
+    QVector<int> residentList;
+    QVector<PoolBuffer> freeBuffers;                   // Of evicted chunks, reused before new ones are made
+    quint64 frame = 0;
+    qint64 poolUsed = 0;
+    int maxInFlight = 0;
+    int inFlight = 0;
+    qint64 inFlightBytes = 0;
+
+    QThreadPool loaders;
+
+    // Filled by the loaders, drained by update()
+    QMutex loadedMutex;
+    QVector<Loaded> loaded;
+
+    Stats counters;
+};
+
+#endif // POINTCLOUD_H
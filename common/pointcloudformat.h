@@ -0,0 +1,78 @@
+#ifndef POINTCLOUDFORMAT_H
+#define POINTCLOUDFORMAT_H
+
+#include <QtGlobal>
+
+// ------------------- Point Cloud File Format -------------------
+//
+// File layout (little endian):
+//   CloudHeader
+//   point chunks                       (each starts on a ChunkAlignment boundary)
+//   Node[nodeCount]                    (at nodeTableOffset)
+//
+// The nodes form an octree over the cube boundsMin .. boundsMin + size. Node 0
+// is the root; the children of a node are stored next to each other from
+// firstChild on, one per bit set in childMask, in octant order (bit 0: -x -y -z,
+// bit 1: +x, bit 2: +y, bit 4: +z). Parents precede their children.
+//
+// The levels are additive: every point of the cloud is stored in exactly one
+// node. A node holds a subsample of its cell with at most one point per grid
+// cell of side spacing, its children the points it did not take, so drawing
+// a node and any subset of its descendants never draws a point twice. A chunk
+// is pointCount Points, the exact bytes glBufferData() takes.
+
+namespace pointcloud {
+
+constexpr quint32 Magic = 0x4c435051;   // "QPCL"
+constexpr quint32 Version = 1;
+constexpr quint32 ChunkAlignment = 64;
+
+struct Point {
+    float position[3] = { 0.0f, 0.0f, 0.0f };
+    quint8 color[4] = { 0, 0, 0, 255 };     // RGB, normalized; the fourth byte is padding
+};
+
+struct Node {
+    float center[3] = { 0.0f, 0.0f, 0.0f };
+    float halfSize = 0.0f;                  // The cell is a cube
+    quint64 offset = 0;                     // Of the chunk, from the start of the file
+    quint32 pointCount = 0;
+    quint32 firstChild = 0;                 // Index of the first child; 0 if childMask is 0
+    quint8 childMask = 0;
+    quint8 level = 0;                       // Root: 0
+    quint16 reserved = 0;
+    float spacing = 0.0f;                   // Sampling grid cell of this node, in cloud units
+};
+
+struct CloudHeader {
+    quint32 magic = Magic;
+    quint32 version = Version;
+    quint64 pointCount = 0;
+    quint32 nodeCount = 0;
+    quint32 maxNodePoints = 0;              // Largest chunk
+    quint32 gridSize = 0;                   // Sampling grid cells per node side
+    quint32 depth = 0;                      // Deepest level
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float size = 0.0f;                      // Side of the root cube
+    float pointMin[3] = { 0.0f, 0.0f, 0.0f };   // Tight bounds of the points
+    float pointMax[3] = { 0.0f, 0.0f, 0.0f };
+    quint64 nodeTableOffset = 0;
+    quint64 fileSize = 0;
+};
+
+static_assert(sizeof(Point) == 16, "Point layout changed");
+static_assert(sizeof(Node) == 40, "Node layout changed");
+static_assert(sizeof(CloudHeader) == 88, "CloudHeader layout changed");
+
+inline int childCount(quint8 childMask)
+{
+    int count = 0;
+    for (; childMask; childMask &= quint8(childMask - 1)) {
+        ++count;
+    }
+    return count;
+}
+
+} // namespace pointcloud
+
+#endif // POINTCLOUDFORMAT_H
@@ -0,0 +1,372 @@
+#include "rhicube.h"
+#include <QDebug>
+#include <QFile>
+#include <cstring>
+#include "meshgen.h"
+
+// Same meshes as the GL stages, generated at compile time (common/meshgen.h)
+static constexpr auto coloredCube = meshgen::cubeCorners<meshgen::PosColor>();
+static constexpr auto texturedCube = meshgen::cube<meshgen::PosUv>();
+static constexpr int FaceCount = 6;
+static constexpr int IndicesPerFace = 6;
+static constexpr int MatrixBytes = 16 * sizeof(float);
+
+static QShader loadShader(const QString &name)
+{
+    QFile file(QStringLiteral(":/shaders/%1.qsb").arg(name));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "RhiCubeRenderer: missing shader" << file.fileName() << "(built by qt_add_shaders)";
+        return QShader();
+    }
+    return QShader::fromSerialized(file.readAll());
+}
+
+RhiCubeRenderer::~RhiCubeRenderer()
+{
+    release();
+}
+
+bool RhiCubeRenderer::initialize(QRhi *rhiInstance, QRhiRenderPassDescriptor *renderPass, int sampleCount)
+{
+    release();
+    if (!rhiInstance || !renderPass) {
+        qWarning() << "RhiCubeRenderer: no QRhi or render pass";
+        return false;
+    }
+    rhi = rhiInstance;
+
+    if (!createMesh(&coloredMesh, coloredCube.vertices.data(), qint64(coloredCube.vertexBytes()),
+                    coloredCube.indices.data(), int(coloredCube.indices.size()))
+        || !createMesh(&texturedMesh, texturedCube.vertices.data(), qint64(texturedCube.vertexBytes()),
+                       texturedCube.indices.data(), int(texturedCube.indices.size()))) {
+        release();
+        return false;
+    }
+    meshesUploaded = false;
+    const QString owner = QStringLiteral("RhiCubeRenderer");
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    meshMemory = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer,
+                                           coloredMesh.vertices.size() + coloredMesh.indices.size()
+                                               + texturedMesh.vertices.size() + texturedMesh.indices.size(),
+                                           owner, QStringLiteral("cube meshes"));
+
+    uniformSlot = rhi->ubufAligned(MatrixBytes);
+    if (!ensureUniformCapacity(64)) {
+        release();
+        return false;
+    }
+
+    sampler = rhi->newSampler(QRhiSampler::Linear, QRhiSampler::Linear, QRhiSampler::Linear, QRhiSampler::Repeat,
+                              QRhiSampler::Repeat);
+    sampler->create();
+    // 1x1 until the first prepare() uploads the faces, white ones if none were set
+    for (int face = 0; face < FaceCount; ++face) {
+        QRhiTexture *texture = rhi->newTexture(QRhiTexture::RGBA8, QSize(1, 1));
+        texture->create();
+        faceTextures.append(texture);
+    }
+    facesPending = true;
+    if (!createBindings()) {
+        release();
+        return false;
+    }
+
+    QRhiVertexInputLayout coloredLayout;
+    coloredLayout.setBindings({ QRhiVertexInputBinding(quint32(coloredCube.stride())) });
+    coloredLayout.setAttributes({
+        QRhiVertexInputAttribute(0, 0, QRhiVertexInputAttribute::Float3, 0),
+        QRhiVertexInputAttribute(0, 1, QRhiVertexInputAttribute::Float3,
+                                 quint32(meshgen::PosColor::ColorOffset * sizeof(float))),
+    });
+    QRhiVertexInputLayout texturedLayout;
+    texturedLayout.setBindings({ QRhiVertexInputBinding(quint32(texturedCube.stride())) });
+    texturedLayout.setAttributes({
+        QRhiVertexInputAttribute(0, 0, QRhiVertexInputAttribute::Float3, 0),
+        QRhiVertexInputAttribute(0, 1, QRhiVertexInputAttribute::Float2, quint32(3 * sizeof(float))),
+    });
+    // Any srb with the same layout will do for building; the draws switch between the face srbs
+    coloredPipeline = createPipeline(QStringLiteral("rhicube_colored.vert"), QStringLiteral("rhicube_colored.frag"),
+                                     coloredLayout, coloredBindings, renderPass, sampleCount);
+    texturedPipeline = createPipeline(QStringLiteral("rhicube_textured.vert"),
+                                      QStringLiteral("rhicube_textured.frag"), texturedLayout,
+                                      faceBindings.first(), renderPass, sampleCount);
+    if (!coloredPipeline || !texturedPipeline) {
+        release();
+        return false;
+    }
+
+    qDebug().noquote() << "RhiCubeRenderer: initialized on" << rhi->backendName() << "-"
+                       << rhi->driverInfo().deviceName;
+    return true;
+}
+
+bool RhiCubeRenderer::createMesh(Mesh *mesh, const void *vertices, qint64 vertexBytes, const quint32 *indices,
+                                 int indexCount)
+{
+    mesh->vertices = QByteArray(static_cast<const char *>(vertices), vertexBytes);
+    mesh->indices = QByteArray(reinterpret_cast<const char *>(indices), indexCount * qint64(sizeof(quint32)));
+    mesh->indexCount = indexCount;
+    mesh->vertexBuffer = rhi->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, quint32(vertexBytes));
+    mesh->indexBuffer = rhi->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::IndexBuffer,
+                                       quint32(mesh->indices.size()));
+    if (!mesh->vertexBuffer->create() || !mesh->indexBuffer->create()) {
+        qWarning() << "RhiCubeRenderer: cannot create the mesh buffers";
+        return false;
+    }
+    return true;
+}
+
+QRhiGraphicsPipeline *RhiCubeRenderer::createPipeline(const QString &vertexShader, const QString &fragmentShader,
+                                                      const QRhiVertexInputLayout &layout,
+                                                      QRhiShaderResourceBindings *srb,
+                                                      QRhiRenderPassDescriptor *renderPass, int sampleCount)
+{
+    const QShader vertex = loadShader(vertexShader);
+    const QShader fragment = loadShader(fragmentShader);
+    if (!vertex.isValid() || !fragment.isValid()) {
+        return nullptr;
+    }
+    QRhiGraphicsPipeline *pipeline = rhi->newGraphicsPipeline();
+    pipeline->setShaderStages({ { QRhiShaderStage::Vertex, vertex }, { QRhiShaderStage::Fragment, fragment } });
+    pipeline->setVertexInputLayout(layout);
+    pipeline->setShaderResourceBindings(srb);
+    pipeline->setRenderPassDescriptor(renderPass);
+    pipeline->setSampleCount(sampleCount);
+    // As the GL stages: depth test and write, no culling
+    pipeline->setDepthTest(true);
+    pipeline->setDepthWrite(true);
+    pipeline->setDepthOp(QRhiGraphicsPipeline::Less);
+    if (!pipeline->create()) {
+        qWarning() << "RhiCubeRenderer: cannot create the pipeline for" << vertexShader;
+        delete pipeline;
+        return nullptr;
+    }
+    return pipeline;
+}
+
+bool RhiCubeRenderer::createBindings()
+{
+    const auto object = [this]() {
+        return QRhiShaderResourceBinding::uniformBufferWithDynamicOffset(0, QRhiShaderResourceBinding::VertexStage,
+                                                                        uniformBuffer, MatrixBytes);
+    };
+    if (!coloredBindings) {
+        coloredBindings = rhi->newShaderResourceBindings();
+    }
+    coloredBindings->setBindings({ object() });
+    bool ok = coloredBindings->create();
+    for (int face = 0; face < FaceCount; ++face) {
+        if (faceBindings.size() <= face) {
+            faceBindings.append(rhi->newShaderResourceBindings());
+        }
+        faceBindings[face]->setBindings({
+            object(),
+            QRhiShaderResourceBinding::sampledTexture(1, QRhiShaderResourceBinding::FragmentStage,
+                                                      faceTextures[face], sampler),
+        });
+        ok = faceBindings[face]->create() && ok;
+    }
+    if (!ok) {
+        qWarning() << "RhiCubeRenderer: cannot create the shader resource bindings";
+    }
+    return ok;
+}
+
+bool RhiCubeRenderer::ensureUniformCapacity(int cubes)
+{
+    if (uniformBuffer && cubes <= uniformCapacity) {
+        return true;
+    }
+    // Grow by half again, so a slowly rising cube count does not rebuild every frame
+    const int capacity = qMax(cubes, uniformCapacity + uniformCapacity / 2);
+    const quint32 bytes = quint32(capacity) * quint32(uniformSlot);
+    if (!uniformBuffer) {
+        uniformBuffer = rhi->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::UniformBuffer, bytes);
+    } else {
+        uniformBuffer->setSize(bytes);
+    }
+    if (!uniformBuffer->create()) {
+        qWarning() << "RhiCubeRenderer: cannot create a" << bytes << "byte uniform buffer";
+        return false;
+    }
+    uniformCapacity = capacity;
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    if (uniformMemory) {
+        memory.resize(uniformMemory, bytes);
+    } else {
+        uniformMemory = memory.registerAllocation(GpuMemoryTracker::Category::Other, bytes,
+                                                  QStringLiteral("RhiCubeRenderer"), QStringLiteral("cube matrices"));
+    }
+    // The bindings reference the rebuilt buffer
+    return faceTextures.isEmpty() || createBindings();
+}
+
+void RhiCubeRenderer::setFaceImages(const QVector<QImage> &faces)
+{
+    faceImages = faces.mid(0, FaceCount);
+    facesPending = true;
+}
+
+void RhiCubeRenderer::prepare(QRhiResourceUpdateBatch *batch, const QMatrix4x4 &viewProjection,
+                              const QVector<Cube> &cubes)
+{
+    frameStats = FrameStats();
+    if (!rhi) {
+        return;
+    }
+
+    if (!meshesUploaded) {
+        for (const Mesh *mesh : { &coloredMesh, &texturedMesh }) {
+            batch->uploadStaticBuffer(mesh->vertexBuffer, mesh->vertices.constData());
+            batch->uploadStaticBuffer(mesh->indexBuffer, mesh->indices.constData());
+            frameStats.uploadBytes += mesh->vertices.size() + mesh->indices.size();
+        }
+        coloredMesh.vertices.clear();
+        coloredMesh.indices.clear();
+        texturedMesh.vertices.clear();
+        texturedMesh.indices.clear();
+        meshesUploaded = true;
+    }
+
+    if (facesPending) {
+        qint64 textureBytes = 0;
+        bool rebuilt = false;
+        QImage white(1, 1, QImage::Format_RGBA8888);
+        white.fill(Qt::white);
+        for (int face = 0; face < FaceCount; ++face) {
+            // Flipped like the GL stages' uploads, so the meshes' v = 0 samples the bottom row
+            const QImage source = face < faceImages.size() && !faceImages[face].isNull() ? faceImages[face] : white;
+            const QImage image = source.convertToFormat(QImage::Format_RGBA8888).mirrored(false, true);
+            QRhiTexture *texture = faceTextures[face];
+            const bool mipmapped = image.width() > 1 || image.height() > 1;
+            const QRhiTexture::Flags flags = mipmapped ? QRhiTexture::MipMapped | QRhiTexture::UsedWithGenerateMips
+                                                       : QRhiTexture::Flags();
+            if (texture->pixelSize() != image.size() || texture->flags() != flags) {
+                texture->setPixelSize(image.size());
+                texture->setFlags(flags);
+                texture->create();
+                rebuilt = true;
+            }
+            batch->uploadTexture(texture, image);
+            if (mipmapped) {
+                batch->generateMips(texture);
+            }
+            frameStats.uploadBytes += image.sizeInBytes();
+            textureBytes += GpuMemoryTracker::textureBytes(image.width(), image.height(), 4, mipmapped);
+        }
+        facesPending = false;
+        if (rebuilt) {
+            createBindings();
+        }
+        GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+        if (textureMemory) {
+            memory.resize(textureMemory, textureBytes);
+        } else {
+            textureMemory = memory.registerAllocation(GpuMemoryTracker::Category::Texture, textureBytes,
+                                                      QStringLiteral("RhiCubeRenderer"), QStringLiteral("dice faces"));
+        }
+    }
+
+    if (!ensureUniformCapacity(cubes.size())) {
+        coloredCount = texturedCount = 0;
+        return;
+    }
+
+    // Colored cubes take the first slots, textured ones the rest: record() binds each pipeline once
+    const QMatrix4x4 clipViewProjection = rhi->clipSpaceCorrMatrix() * viewProjection;
+    uniformData.resize(qsizetype(cubes.size()) * uniformSlot);
+    coloredCount = 0;
+    texturedCount = 0;
+    for (const Cube &cube : cubes) {
+        coloredCount += cube.pipeline == Pipeline::Colored ? 1 : 0;
+    }
+    int coloredSlot = 0;
+    int texturedSlot = coloredCount;
+    for (const Cube &cube : cubes) {
+        const int slot = cube.pipeline == Pipeline::Colored ? coloredSlot++ : texturedSlot++;
+        const QMatrix4x4 mvp = clipViewProjection * cube.model;
+        std::memcpy(uniformData.data() + qsizetype(slot) * uniformSlot, mvp.constData(), MatrixBytes);
+    }
+    texturedCount = cubes.size() - coloredCount;
+    if (!cubes.isEmpty()) {
+        batch->updateDynamicBuffer(uniformBuffer, 0, quint32(uniformData.size()), uniformData.constData());
+    }
+    frameStats.uniformBytes = uniformData.size();
+}
+
+void RhiCubeRenderer::record(QRhiCommandBuffer *commandBuffer, const QSize &outputSize)
+{
+    if (!rhi || coloredCount + texturedCount == 0) {
+        return;
+    }
+    const QRhiViewport viewport(0.0f, 0.0f, float(outputSize.width()), float(outputSize.height()));
+
+    if (coloredCount > 0) {
+        commandBuffer->setGraphicsPipeline(coloredPipeline);
+        commandBuffer->setViewport(viewport);
+        const QRhiCommandBuffer::VertexInput vertexInput(coloredMesh.vertexBuffer, 0);
+        commandBuffer->setVertexInput(0, 1, &vertexInput, coloredMesh.indexBuffer, 0,
+                                      QRhiCommandBuffer::IndexUInt32);
+        ++frameStats.pipelineBinds;
+        for (int slot = 0; slot < coloredCount; ++slot) {
+            const QRhiCommandBuffer::DynamicOffset offset(0, quint32(slot * uniformSlot));
+            commandBuffer->setShaderResources(coloredBindings, 1, &offset);
+            commandBuffer->drawIndexed(quint32(coloredMesh.indexCount));
+        }
+        frameStats.resourceBinds += coloredCount;
+        frameStats.draws += coloredCount;
+    }
+
+    if (texturedCount > 0) {
+        commandBuffer->setGraphicsPipeline(texturedPipeline);
+        commandBuffer->setViewport(viewport);
+        const QRhiCommandBuffer::VertexInput vertexInput(texturedMesh.vertexBuffer, 0);
+        commandBuffer->setVertexInput(0, 1, &vertexInput, texturedMesh.indexBuffer, 0,
+                                      QRhiCommandBuffer::IndexUInt32);
+        ++frameStats.pipelineBinds;
+        // Face by face: each face's texture stays bound for all cubes
+        const int end = coloredCount + texturedCount;
+        for (int face = 0; face < FaceCount; ++face) {
+            for (int slot = coloredCount; slot < end; ++slot) {
+                const QRhiCommandBuffer::DynamicOffset offset(0, quint32(slot * uniformSlot));
+                commandBuffer->setShaderResources(faceBindings[face], 1, &offset);
+                commandBuffer->drawIndexed(IndicesPerFace, 1, quint32(face * IndicesPerFace));
+            }
+        }
+        frameStats.resourceBinds += FaceCount * texturedCount;
+        frameStats.draws += FaceCount * texturedCount;
+    }
+}
+
+void RhiCubeRenderer::release()
+{
+    delete coloredPipeline;
+    delete texturedPipeline;
+    coloredPipeline = texturedPipeline = nullptr;
+    delete coloredBindings;
+    coloredBindings = nullptr;
+    qDeleteAll(faceBindings);
+    faceBindings.clear();
+    qDeleteAll(faceTextures);
+    faceTextures.clear();
+    delete sampler;
+    sampler = nullptr;
+    delete uniformBuffer;
+    uniformBuffer = nullptr;
+    uniformCapacity = 0;
+    for (Mesh *mesh : { &coloredMesh, &texturedMesh }) {
+        delete mesh->vertexBuffer;
+        delete mesh->indexBuffer;
+        *mesh = Mesh();
+    }
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    for (GpuMemoryTracker::Handle *handle : { &meshMemory, &uniformMemory, &textureMemory }) {
+        if (*handle) {
+            memory.release(*handle);
+            *handle = 0;
+        }
+    }
+    rhi = nullptr;
+}
@@ -0,0 +1,129 @@
+#ifndef RHICUBE_H
+#define RHICUBE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QMatrix4x4>
+#include <QVector>
+#include <rhi/qrhi.h>
+#include "gpumemory.h"
+
+// ------------------- QRhi Cube Renderer -------------------
+//
+// The cube pipelines of 05 (per-vertex color) and 06 (dice textures, one
+// draw per face) on Qt's rendering hardware interface instead of direct GL
+// calls. Everything the GL stages set with individual calls becomes an object
+// built once: a pipeline state object per pipeline, shader resource bindings
+// per texture, and one dynamic uniform buffer with a 64-byte matrix slot per
+// cube. A frame is two steps:
+//
+//   QRhiResourceUpdateBatch *batch = rhi->nextResourceUpdateBatch();
+//   cubes.prepare(batch, viewProjection, cubeList);   // every upload of the frame, batched
+//   commandBuffer->beginPass(renderTarget, clearColor, { 1.0f, 0 }, batch);
+//   cubes.record(commandBuffer, outputSize);          // state-sorted draws, no uploads
+//   commandBuffer->endPass();
+//
+// All per-cube matrices go up in a single updateDynamicBuffer() call; draws
+// only select their slot with a dynamic offset. Draws are sorted by pipeline,
+// then by dice face, so each pipeline is bound once per frame.
+//
+// Works on every QRhi backend, including OpenGL (also under llvmpipe) and
+// Null, which executes nothing and so measures the CPU side alone. Shaders
+// are common/shaders/rhicube_*, compiled to .qsb by qt_add_shaders() with the
+// resource prefix /shaders.
+
+class RhiCubeRenderer
+{
+public:
+    enum class Pipeline {
+        Colored,                            // 05: 8 corners with colors, 36 indices, one draw
+        Textured                            // 06: 24 vertices with texture coordinates, one draw per face
+    };
+
+    struct Cube {
+        QMatrix4x4 model;
+        Pipeline pipeline = Pipeline::Colored;
+    };
+
+    struct FrameStats {
+        int draws = 0;
+        int pipelineBinds = 0;
+        int resourceBinds = 0;              // setShaderResources() calls
+        qint64 uniformBytes = 0;            // In the single dynamic buffer update
+        qint64 uploadBytes = 0;             // Static buffers and textures queued this frame
+    };
+
+    RhiCubeRenderer() = default;
+    ~RhiCubeRenderer();
+
+    RhiCubeRenderer(const RhiCubeRenderer &) = delete;
+    RhiCubeRenderer &operator=(const RhiCubeRenderer &) = delete;
+
+    /**
+     * @brief Builds buffers, textures and both pipelines for @p renderPass; the first prepare() uploads them.
+     */
+    bool initialize(QRhi *rhi, QRhiRenderPassDescriptor *renderPass, int sampleCount = 1);
+    void release();
+    bool isInitialized() const { return rhi != nullptr; }
+
+    /**
+     * @brief Sets the six dice faces (06's face order), uploaded by the next prepare(); white until then.
+     */
+    void setFaceImages(const QVector<QImage> &faces);
+
+    /**
+     * @brief Records this frame's uploads into @p batch: pending buffers and textures, then all cube matrices.
+     */
+    void prepare(QRhiResourceUpdateBatch *batch, const QMatrix4x4 &viewProjection, const QVector<Cube> &cubes);
+    /**
+     * @brief Records the draws of the last prepare(); call between beginPass() and endPass().
+     */
+    void record(QRhiCommandBuffer *commandBuffer, const QSize &outputSize);
+
+    const FrameStats &stats() const { return frameStats; }
+
+private:
+    struct Mesh {
+        QRhiBuffer *vertexBuffer = nullptr;
+        QRhiBuffer *indexBuffer = nullptr;
+        QByteArray vertices;                // Kept until uploaded
+        QByteArray indices;
+        int indexCount = 0;
+    };
+
+    bool createMesh(Mesh *mesh, const void *vertices, qint64 vertexBytes, const quint32 *indices, int indexCount);
+    QRhiGraphicsPipeline *createPipeline(const QString &vertexShader, const QString &fragmentShader,
+                                         const QRhiVertexInputLayout &layout, QRhiShaderResourceBindings *srb,
+                                         QRhiRenderPassDescriptor *renderPass, int sampleCount);
+    bool createBindings();
+    bool ensureUniformCapacity(int cubes);
+
+    QRhi *rhi = nullptr;
+    Mesh coloredMesh;
+    Mesh texturedMesh;
+    bool meshesUploaded = false;
+
+    QRhiBuffer *uniformBuffer = nullptr;    // Dynamic, one aligned 4x4 matrix per cube
+    int uniformSlot = 0;                    // Bytes per cube, 64 rounded up to the backend's alignment
+    int uniformCapacity = 0;                // Cubes
+    QByteArray uniformData;                 // Staging for the single update per frame
+
+    QRhiSampler *sampler = nullptr;
+    QVector<QRhiTexture *> faceTextures;    // 6
+    QVector<QImage> faceImages;             // Kept to upload again after a new initialize()
+    bool facesPending = false;
+    QRhiShaderResourceBindings *coloredBindings = nullptr;
+    QVector<QRhiShaderResourceBindings *> faceBindings;
+    QRhiGraphicsPipeline *coloredPipeline = nullptr;
+    QRhiGraphicsPipeline *texturedPipeline = nullptr;
+
+    int coloredCount = 0;                   // Slots [0, coloredCount) are colored cubes, the rest textured
+    int texturedCount = 0;
+    FrameStats frameStats;
+
+    GpuMemoryTracker::Handle meshMemory = 0;
+    GpuMemoryTracker::Handle uniformMemory = 0;
+    GpuMemoryTracker::Handle textureMemory = 0;
+};
+
+#endif // RHICUBE_H
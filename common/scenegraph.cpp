@@ -0,0 +1,555 @@
+#include "scenegraph.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <type_traits>
+
+// ------------------- Helpers -------------------
+
+static SceneGraph::WorldTransform identityWorld()
+{
+    SceneGraph::WorldTransform world = { { { 1.0f, 0.0f, 0.0f, 0.0f },
+                                           { 0.0f, 1.0f, 0.0f, 0.0f },
+                                           { 0.0f, 0.0f, 1.0f, 0.0f } } };
+    return world;
+}
+
+QVector3D SceneGraph::WorldTransform::map(const QVector3D &point) const
+{
+    return QVector3D(rows[0][0] * point.x() + rows[0][1] * point.y() + rows[0][2] * point.z() + rows[0][3],
+                     rows[1][0] * point.x() + rows[1][1] * point.y() + rows[1][2] * point.z() + rows[1][3],
+                     rows[2][0] * point.x() + rows[2][1] * point.y() + rows[2][2] * point.z() + rows[2][3]);
+}
+
+// ------------------- Constructor and Destructor -------------------
+
+SceneGraph::SceneGraph(const Params &params)
+    : parameters(params)
+{
+    threads = parameters.workerThreads > 0 ? parameters.workerThreads : QThread::idealThreadCount();
+    threads = qMax(1, threads);
+    parameters.grainSize = qMax(256, parameters.grainSize);
+    // The calling thread takes a share of every level, so the pool needs one thread less
+    workers.setMaxThreadCount(qMax(1, threads - 1));
+    levelStarts = { 0 };
+}
+
+SceneGraph::~SceneGraph()
+{
+    workers.waitForDone();
+}
+
+// ------------------- Entities -------------------
+
+void SceneGraph::reserve(int entities)
+{
+    slots.reserve(entities);
+    generations.reserve(entities);
+    sortedEntities.reserve(entities);
+    parentEntities.reserve(entities);
+    parentSlots.reserve(entities);
+    childCounts.reserve(entities);
+    locals.reserve(entities);
+    worlds.reserve(entities);
+    localBoxes.reserve(entities);
+    worldBoxes.reserve(entities);
+    meshIds.reserve(entities);
+    materialIds.reserve(entities);
+    depths.reserve(entities);
+    localDirty.reserve(entities);
+    changed.reserve(entities);
+    removed.reserve(entities);
+}
+
+SceneGraph::Entity SceneGraph::create(Entity parentEntity, int mesh, int material)
+{
+    if (parentEntity != NoEntity && !isAlive(parentEntity)) {
+        qWarning() << "SceneGraph: parent" << parentEntity << "does not exist";
+        return NoEntity;
+    }
+    quint32 id;
+    if (!freeIds.isEmpty()) {
+        id = freeIds.takeLast();
+        ++generations[id];                  // Handles to the previous entity with this id stay dead
+    } else if (slots.size() < MaxEntities) {
+        id = quint32(slots.size());
+        slots.append(-1);
+        generations.append(0);
+    } else {
+        qWarning() << "SceneGraph: out of entity ids, at most" << MaxEntities << "entities";
+        return NoEntity;
+    }
+    const Entity entity = id | (Entity(generations[id]) << 24);
+    if (parentEntity != NoEntity) {
+        ++childCounts[slots[idOf(parentEntity)]];
+    }
+
+    // Appended unsorted; rebuild() moves it into place
+    slots[id] = sortedEntities.size();
+    sortedEntities.append(entity);
+    parentEntities.append(parentEntity);
+    parentSlots.append(-1);
+    childCounts.append(0);
+    locals.append({ { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } });
+    worlds.append(identityWorld());
+    localBoxes.append(Bounds());
+    worldBoxes.append(Bounds());
+    meshIds.append(mesh);
+    materialIds.append(material);
+    depths.append(0);
+    localDirty.append(1);
+    changed.append(0);
+    removed.append(0);
+
+    ++aliveCount;
+    structureDirty = true;
+    return entity;
+}
+
+void SceneGraph::destroy(Entity entity)
+{
+    if (!isAlive(entity)) {
+        return;
+    }
+    const int slot = slots[idOf(entity)];
+    removed[slot] = 1;
+    --aliveCount;
+    structureDirty = true;
+    if (parentEntities[slot] != NoEntity) {
+        --childCounts[slots[idOf(parentEntities[slot])]];
+    }
+    if (childCounts[slot] == 0) {
+        return;
+    }
+
+    // There are no child lists: every slot walks up to the first ancestor whose answer is known, as in rebuild()
+    const int count = sortedEntities.size();
+    QVector<qint8> inSubtree(count, -1);    // -1 unknown, 0 no, 1 yes
+    inSubtree[slot] = 1;
+    QVector<int> chain;
+    for (int s = 0; s < count; ++s) {
+        int current = s;
+        chain.clear();
+        while (inSubtree[current] < 0) {
+            if (removed[current] || parentEntities[current] == NoEntity) {
+                inSubtree[current] = 0;
+                break;
+            }
+            chain.append(current);
+            current = slots[idOf(parentEntities[current])];
+        }
+        const qint8 inside = inSubtree[current];
+        for (int c : std::as_const(chain)) {
+            inSubtree[c] = inside;
+            if (inside) {
+                removed[c] = 1;
+                --aliveCount;
+            }
+        }
+    }
+}
+
+bool SceneGraph::setParent(Entity entity, Entity parentEntity)
+{
+    if (!isAlive(entity) || (parentEntity != NoEntity && !isAlive(parentEntity))) {
+        return false;
+    }
+    for (Entity ancestor = parentEntity; ancestor != NoEntity; ancestor = parentEntities[slots[idOf(ancestor)]]) {
+        if (ancestor == entity) {
+            qWarning() << "SceneGraph: making" << parentEntity << "the parent of" << entity << "would create a cycle";
+            return false;
+        }
+    }
+    const int slot = slots[idOf(entity)];
+    if (parentEntities[slot] != parentEntity) {
+        if (parentEntities[slot] != NoEntity) {
+            --childCounts[slots[idOf(parentEntities[slot])]];
+        }
+        if (parentEntity != NoEntity) {
+            ++childCounts[slots[idOf(parentEntity)]];
+        }
+        parentEntities[slot] = parentEntity;
+        localDirty[slot] = 1;
+        structureDirty = true;
+    }
+    return true;
+}
+
+bool SceneGraph::isAlive(Entity entity) const
+{
+    const quint32 id = idOf(entity);
+    return id < quint32(slots.size()) && generations[id] == entity >> 24 && slots[id] >= 0 && !removed[slots[id]];
+}
+
+SceneGraph::Entity SceneGraph::parent(Entity entity) const
+{
+    return isAlive(entity) ? parentEntities[slots[idOf(entity)]] : NoEntity;
+}
+
+int SceneGraph::slotOf(Entity entity) const
+{
+    return isAlive(entity) ? slots[idOf(entity)] : -1;
+}
+
+// ------------------- Components -------------------
+
+void SceneGraph::markDirty(int slot)
+{
+    localDirty[slot] = 1;
+    if (!structureDirty) {
+        levelDirty[depths[slot]] = 1;
+    }
+}
+
+void SceneGraph::setTransform(Entity entity, const Transform &transform)
+{
+    if (!isAlive(entity)) {
+        return;
+    }
+    const int slot = slots[idOf(entity)];
+    const QQuaternion rotation = transform.rotation.normalized();
+    locals[slot] = { { transform.translation.x(), transform.translation.y(), transform.translation.z() },
+                     { rotation.x(), rotation.y(), rotation.z(), rotation.scalar() },
+                     { transform.scale.x(), transform.scale.y(), transform.scale.z() } };
+    markDirty(slot);
+}
+
+void SceneGraph::setTranslation(Entity entity, const QVector3D &translation)
+{
+    if (!isAlive(entity)) {
+        return;
+    }
+    const int slot = slots[idOf(entity)];
+    locals[slot].translation[0] = translation.x();
+    locals[slot].translation[1] = translation.y();
+    locals[slot].translation[2] = translation.z();
+    markDirty(slot);
+}
+
+void SceneGraph::setRotation(Entity entity, const QQuaternion &rotation)
+{
+    if (!isAlive(entity)) {
+        return;
+    }
+    const int slot = slots[idOf(entity)];
+    const QQuaternion q = rotation.normalized();
+    locals[slot].rotation[0] = q.x();
+    locals[slot].rotation[1] = q.y();
+    locals[slot].rotation[2] = q.z();
+    locals[slot].rotation[3] = q.scalar();
+    markDirty(slot);
+}
+
+void SceneGraph::setScale(Entity entity, const QVector3D &scale)
+{
+    if (!isAlive(entity)) {
+        return;
+    }
+    const int slot = slots[idOf(entity)];
+    locals[slot].scale[0] = scale.x();
+    locals[slot].scale[1] = scale.y();
+    locals[slot].scale[2] = scale.z();
+    markDirty(slot);
+}
+
+SceneGraph::Transform SceneGraph::transform(Entity entity) const
+{
+    Transform transform;
+    if (!isAlive(entity)) {
+        return transform;
+    }
+    const LocalTransform &local = locals[slots[idOf(entity)]];
+    transform.translation = QVector3D(local.translation[0], local.translation[1], local.translation[2]);
+    transform.rotation = QQuaternion(local.rotation[3], local.rotation[0], local.rotation[1], local.rotation[2]);
+    transform.scale = QVector3D(local.scale[0], local.scale[1], local.scale[2]);
+    return transform;
+}
+
+void SceneGraph::setLocalBounds(Entity entity, const Bounds &bounds)
+{
+    if (!isAlive(entity)) {
+        return;
+    }
+    const int slot = slots[idOf(entity)];
+    localBoxes[slot] = bounds;
+    markDirty(slot);
+}
+
+void SceneGraph::setMesh(Entity entity, int mesh)
+{
+    if (isAlive(entity) && meshIds[slots[idOf(entity)]] != mesh) {
+        meshIds[slots[idOf(entity)]] = mesh;
+        structureDirty = true;              // Batches are runs of equal meshes
+    }
+}
+
+void SceneGraph::setMaterial(Entity entity, int material)
+{
+    if (isAlive(entity) && materialIds[slots[idOf(entity)]] != material) {
+        materialIds[slots[idOf(entity)]] = material;
+        structureDirty = true;
+    }
+}
+
+// ------------------- Sorting -------------------
+
+void SceneGraph::rebuild()
+{
+    const int count = sortedEntities.size();
+
+    // Depth of every slot, walking up to the first known ancestor; below a removed entity is removed too
+    static const qint32 Unknown = -1;
+    static const qint32 Removed = -2;
+    QVector<qint32> depth(count, Unknown);
+    QVector<int> chain;
+    for (int s = 0; s < count; ++s) {
+        int current = s;
+        qint32 base = Unknown;
+        chain.clear();
+        for (;;) {
+            if (depth[current] != Unknown) {
+                base = depth[current];
+                break;
+            }
+            if (removed[current]) {
+                base = depth[current] = Removed;
+                break;
+            }
+            const Entity parentEntity = parentEntities[current];
+            if (parentEntity == NoEntity) {
+                base = depth[current] = 0;
+                break;
+            }
+            chain.append(current);
+            current = slots[idOf(parentEntity)];
+        }
+        for (int i = chain.size() - 1; i >= 0; --i) {
+            base = base == Removed ? Removed : base + 1;
+            depth[chain[i]] = base;
+        }
+    }
+
+    QVector<int> order;
+    order.reserve(count);
+    for (int s = 0; s < count; ++s) {
+        if (depth[s] != Removed) {
+            order.append(s);
+        } else {
+            // Freed now: nothing refers to it after the permutation
+            slots[idOf(sortedEntities[s])] = -1;
+            freeIds.append(idOf(sortedEntities[s]));
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        if (depth[a] != depth[b]) {
+            return depth[a] < depth[b];
+        }
+        if (meshIds[a] != meshIds[b]) {
+            return meshIds[a] < meshIds[b];
+        }
+        if (materialIds[a] != materialIds[b]) {
+            return materialIds[a] < materialIds[b];
+        }
+        return a < b;                       // Keeps the order stable between rebuilds
+    });
+
+    const int alive = order.size();
+    const auto permute = [&](auto &array) {
+        std::remove_reference_t<decltype(array)> sorted;
+        sorted.resize(alive);
+        for (int i = 0; i < alive; ++i) {
+            sorted[i] = array[order[i]];
+        }
+        array.swap(sorted);
+    };
+    permute(sortedEntities);
+    permute(parentEntities);
+    permute(childCounts);
+    permute(locals);
+    permute(worlds);
+    permute(localBoxes);
+    permute(worldBoxes);
+    permute(meshIds);
+    permute(materialIds);
+    permute(localDirty);
+
+    parentSlots.resize(alive);
+    depths.resize(alive);
+    for (int i = 0; i < alive; ++i) {
+        const int old = order[i];
+        depths[i] = depth[old];
+        slots[idOf(sortedEntities[i])] = i;
+    }
+    for (int i = 0; i < alive; ++i) {
+        parentSlots[i] = parentEntities[i] == NoEntity ? -1 : slots[idOf(parentEntities[i])];
+    }
+    changed.fill(0, alive);
+    removed.fill(0, alive);
+
+    const int levels = alive > 0 ? depths[alive - 1] + 1 : 0;
+    levelStarts.fill(0, levels + 1);
+    levelDirty.fill(0, levels);
+    levelChanged.fill(0, levels);
+    batchList.clear();
+    for (int i = 0; i < alive; ++i) {
+        levelStarts[depths[i] + 1] = i + 1;
+        levelDirty[depths[i]] |= localDirty[i];
+        if (batchList.isEmpty() || batchList.last().depth != depths[i] || batchList.last().mesh != meshIds[i]
+            || batchList.last().material != materialIds[i]) {
+            batchList.append({ i, 0, depths[i], meshIds[i], materialIds[i] });
+        }
+        ++batchList.last().count;
+    }
+    aliveCount = alive;
+    structureDirty = false;
+}
+
+// ------------------- Update -------------------
+
+void SceneGraph::parallelFor(int begin, int end, const std::function<void(int, int)> &work)
+{
+    const int grain = parameters.grainSize;
+    const int items = (end - begin + grain - 1) / grain;
+    if (threads <= 1 || items <= 1) {
+        work(begin, end);
+        return;
+    }
+
+    // Work items are claimed from a shared counter, so a slow thread never holds up the others
+    std::atomic<int> next{ 0 };
+    const auto run = [&]() {
+        for (int item = next.fetch_add(1); item < items; item = next.fetch_add(1)) {
+            const int first = begin + item * grain;
+            work(first, qMin(end, first + grain));
+        }
+    };
+    QSemaphore finished;
+    const int helpers = qMin(threads - 1, items - 1);
+    for (int i = 0; i < helpers; ++i) {
+        workers.start([&run, &finished]() {
+            run();
+            finished.release();
+        });
+    }
+    run();
+    finished.acquire(helpers);
+}
+
+void SceneGraph::updateRange(int begin, int end, qint64 *changedCount)
+{
+    qint64 count = 0;
+    for (int s = begin; s < end; ++s) {
+        const qint32 p = parentSlots[s];
+        // Parents sit in earlier levels, which are complete: reading their flags and matrices needs no lock
+        if (!localDirty[s] && (p < 0 || !changed[p])) {
+            changed[s] = 0;
+            continue;
+        }
+
+        // Local = translation * rotation * scale
+        const LocalTransform &local = locals[s];
+        const float x = local.rotation[0];
+        const float y = local.rotation[1];
+        const float z = local.rotation[2];
+        const float w = local.rotation[3];
+        const float rotation[3][3] = {
+            { 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z), 2.0f * (x * z + w * y) },
+            { 2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x) },
+            { 2.0f * (x * z - w * y), 2.0f * (y * z + w * x), 1.0f - 2.0f * (x * x + y * y) },
+        };
+        float matrix[3][4];
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                matrix[r][c] = rotation[r][c] * local.scale[c];
+            }
+            matrix[r][3] = local.translation[r];
+        }
+
+        WorldTransform &world = worlds[s];
+        if (p < 0) {
+            std::copy(&matrix[0][0], &matrix[0][0] + 12, &world.rows[0][0]);
+        } else {
+            const WorldTransform &parentWorld = worlds[p];
+            for (int r = 0; r < 3; ++r) {
+                const float *row = parentWorld.rows[r];
+                for (int c = 0; c < 4; ++c) {
+                    world.rows[r][c] = row[0] * matrix[0][c] + row[1] * matrix[1][c] + row[2] * matrix[2][c];
+                }
+                world.rows[r][3] += row[3];
+            }
+        }
+
+        // World box around the transformed local box: center mapped, extent through |M|
+        const Bounds &box = localBoxes[s];
+        Bounds &worldBox = worldBoxes[s];
+        worldBox.center = world.map(box.center);
+        for (int r = 0; r < 3; ++r) {
+            worldBox.extent[r] = std::fabs(world.rows[r][0]) * box.extent.x()
+                                 + std::fabs(world.rows[r][1]) * box.extent.y()
+                                 + std::fabs(world.rows[r][2]) * box.extent.z();
+        }
+
+        localDirty[s] = 0;
+        changed[s] = 1;
+        ++count;
+    }
+    *changedCount = count;
+}
+
+SceneGraph::UpdateStats SceneGraph::update()
+{
+    UpdateStats stats;
+    QElapsedTimer timer;
+    timer.start();
+    if (structureDirty) {
+        rebuild();
+        stats.rebuilt = true;
+        stats.rebuildMilliseconds = timer.nsecsElapsed() / 1.0e6;
+        timer.restart();
+    }
+
+    stats.levels = depthCount();
+    for (int level = 0; level < stats.levels; ++level) {
+        const int begin = levelStarts[level];
+        const int end = levelStarts[level + 1];
+        const bool parentsChanged = level > 0 && levelChanged[level - 1];
+        if (!levelDirty[level] && !parentsChanged) {
+            // Untouched subtree levels: only last update's flags need clearing
+            if (levelChanged[level]) {
+                std::fill(changed.begin() + begin, changed.begin() + end, quint8(0));
+                levelChanged[level] = 0;
+            }
+            ++stats.levelsSkipped;
+            continue;
+        }
+
+        std::atomic<qint64> levelCount{ 0 };
+        parallelFor(begin, end, [this, &levelCount](int first, int last) {
+            qint64 count = 0;
+            updateRange(first, last, &count);
+            levelCount.fetch_add(count, std::memory_order_relaxed);
+        });
+        levelDirty[level] = 0;
+        levelChanged[level] = levelCount.load() > 0 ? 1 : 0;
+        stats.entitiesChanged += levelCount.load();
+    }
+
+    stats.updateMilliseconds = timer.nsecsElapsed() / 1.0e6;
+    return stats;
+}
+
+qint64 SceneGraph::memoryBytes() const
+{
+    return slots.capacity() * qint64(sizeof(qint32)) + generations.capacity()
+           + freeIds.capacity() * qint64(sizeof(quint32)) + childCounts.capacity() * qint64(sizeof(qint32))
+           + sortedEntities.capacity() * qint64(sizeof(Entity)) + parentEntities.capacity() * qint64(sizeof(Entity))
+           + parentSlots.capacity() * qint64(sizeof(qint32)) + locals.capacity() * qint64(sizeof(LocalTransform))
+           + worlds.capacity() * qint64(sizeof(WorldTransform)) + localBoxes.capacity() * qint64(sizeof(Bounds))
+           + worldBoxes.capacity() * qint64(sizeof(Bounds)) + meshIds.capacity() * qint64(sizeof(qint32))
+           + materialIds.capacity() * qint64(sizeof(qint32)) + depths.capacity() * qint64(sizeof(qint32))
+           + localDirty.capacity() + changed.capacity() + removed.capacity();
+}
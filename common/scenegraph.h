@@ -0,0 +1,179 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <QQuaternion>
+#include <QThreadPool>
+#include <QVector>
+#include <QVector3D>
+#include <functional>
+
+// ------------------- Scene Graph -------------------
+
+/**
+ * @brief Data-oriented entity hierarchy: components in parallel arrays, world transforms updated level by level.
+ *
+ * Every component lives in its own contiguous array indexed by slot:
+ * local transform, world transform (3 x 4 affine, row-major, ready to be
+ * uploaded as three vec4 instance attributes), local and world bounds, mesh,
+ * material and parent. Slots are sorted by (depth, mesh, material), so
+ *
+ *  - the parents of level d all sit in levels < d: update() walks one level
+ *    at a time and splits each level across worker threads with no locks,
+ *  - every run of slots with the same depth, mesh and material is one
+ *    instanced draw (batches()), read straight from worldTransforms().
+ *
+ * Changing a local transform sets a dirty flag; update() recomputes only the
+ * dirty entities and the subtrees below them, and skips levels with nothing
+ * dirty. changedFlags() tells the renderer which slots moved.
+ *
+ * Structural changes (create, destroy, setParent, setMesh, setMaterial)
+ * re-sort the arrays at the next update(), so slots are only stable between
+ * structural changes; entities are stable handles. A handle packs a 24-bit id
+ * with an 8-bit generation that changes whenever destroy() frees the id for
+ * reuse, so a handle kept past destroy() stays dead (until the generation
+ * wraps 256 reuses later). Not thread-safe: edit the graph and call update()
+ * from one thread.
+ */
+class SceneGraph
+{
+public:
+    using Entity = quint32;
+    static constexpr Entity NoEntity = 0xffffffffu;
+    static constexpr int MaxEntities = 0xffffff;   // Ids 0 .. 0xfffffe; 0xffffff is left for NoEntity
+
+    struct Transform {
+        QVector3D translation;
+        QQuaternion rotation;
+        QVector3D scale = QVector3D(1.0f, 1.0f, 1.0f);
+    };
+
+    struct WorldTransform {
+        float rows[3][4];                   // Affine rows; the fourth row is (0, 0, 0, 1)
+
+        QVector3D map(const QVector3D &point) const;
+    };
+
+    struct Bounds {
+        QVector3D center;
+        QVector3D extent;                   // Half size
+    };
+
+    // Consecutive slots sharing depth, mesh and material
+    struct Batch {
+        int first = 0;
+        int count = 0;
+        int depth = 0;
+        int mesh = -1;
+        int material = -1;
+    };
+
+    struct Params {
+        int workerThreads = 0;              // Including the caller; 0 picks QThread::idealThreadCount(), 1 is serial
+        int grainSize = 16384;              // Slots per parallel work item
+    };
+
+    struct UpdateStats {
+        int levels = 0;
+        int levelsSkipped = 0;              // Nothing dirty in the level or above it
+        qint64 entitiesChanged = 0;         // World transforms recomputed
+        bool rebuilt = false;               // The arrays were re-sorted after structural changes
+        double rebuildMilliseconds = 0.0;
+        double updateMilliseconds = 0.0;    // Transform propagation, without the rebuild
+    };
+
+    SceneGraph() : SceneGraph(Params()) {}
+    explicit SceneGraph(const Params &params);
+    ~SceneGraph();
+
+    void reserve(int entities);
+    Entity create(Entity parent = NoEntity, int mesh = -1, int material = -1);
+    /**
+     * @brief Removes @p entity and all its descendants.
+     *
+     * They are dead for isAlive() and entityCount() at once; their slots are freed at the next update().
+     */
+    void destroy(Entity entity);
+    /**
+     * @brief Moves @p entity (and its subtree) under @p parent; refuses to create a cycle.
+     */
+    bool setParent(Entity entity, Entity parent);
+
+    bool isAlive(Entity entity) const;
+    int entityCount() const { return aliveCount; }
+    Entity parent(Entity entity) const;
+
+    void setTransform(Entity entity, const Transform &transform);
+    void setTranslation(Entity entity, const QVector3D &translation);
+    void setRotation(Entity entity, const QQuaternion &rotation);
+    void setScale(Entity entity, const QVector3D &scale);
+    Transform transform(Entity entity) const;
+    void setLocalBounds(Entity entity, const Bounds &bounds);
+    void setMesh(Entity entity, int mesh);
+    void setMaterial(Entity entity, int material);
+
+    /**
+     * @brief Re-sorts after structural changes, then recomputes dirty world transforms and bounds.
+     */
+    UpdateStats update();
+
+    // Valid after update(), indexed by slot in (depth, mesh, material) order
+    int slotCount() const { return sortedEntities.size(); }
+    int slotOf(Entity entity) const;
+    const Entity *entities() const { return sortedEntities.constData(); }
+    const WorldTransform *worldTransforms() const { return worlds.constData(); }
+    const Bounds *worldBounds() const { return worldBoxes.constData(); }
+    const qint32 *meshes() const { return meshIds.constData(); }
+    const qint32 *materials() const { return materialIds.constData(); }
+    const quint8 *changedFlags() const { return changed.constData(); }   // 1 where the last update() moved the slot
+    const QVector<Batch> &batches() const { return batchList; }
+    int depthCount() const { return levelStarts.size() - 1; }
+
+    qint64 memoryBytes() const;
+
+private:
+    struct LocalTransform {
+        float translation[3];
+        float rotation[4];                  // x, y, z, w
+        float scale[3];
+    };
+
+    static quint32 idOf(Entity entity) { return entity & 0xffffffu; }
+    void markDirty(int slot);
+    void rebuild();
+    void updateRange(int begin, int end, qint64 *changedCount);
+    void parallelFor(int begin, int end, const std::function<void(int, int)> &work);
+
+    Params parameters;
+    QThreadPool workers;
+    int threads = 1;
+
+    // Per entity id
+    QVector<qint32> slots;                  // -1 when free
+    QVector<quint8> generations;            // Upper 8 bits of the live handle of each id
+    QVector<quint32> freeIds;
+    int aliveCount = 0;
+
+    // Per slot; while structureDirty, new entities are appended unsorted and removed ones stay until rebuild()
+    QVector<Entity> sortedEntities;
+    QVector<Entity> parentEntities;
+    QVector<qint32> parentSlots;            // -1 for roots
+    QVector<qint32> childCounts;            // Live children; destroy() skips the subtree search for leaves
+    QVector<LocalTransform> locals;
+    QVector<WorldTransform> worlds;
+    QVector<Bounds> localBoxes;
+    QVector<Bounds> worldBoxes;
+    QVector<qint32> meshIds;
+    QVector<qint32> materialIds;
+    QVector<qint32> depths;
+    QVector<quint8> localDirty;
+    QVector<quint8> changed;
+    QVector<quint8> removed;
+
+    QVector<int> levelStarts;               // Level d is [levelStarts[d], levelStarts[d + 1])
+    QVector<quint8> levelDirty;             // A slot of the level has a dirty local transform
+    QVector<quint8> levelChanged;           // The last update() changed a slot of the level
+    QVector<Batch> batchList;
+    bool structureDirty = false;
+};
+
+#endif // SCENEGRAPH_H
@@ -0,0 +1,551 @@
+#include "sdftext.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFontMetricsF>
+#include <QOpenGLShaderProgram>
+#include <QPainter>
+#include <QVector2D>
+#include <QVector4D>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// ------------------- Shader Source Code (Embedded) -------------------
+
+// One instance per glyph; the 4 corners of its quad come from gl_VertexID
+static const char *vertexShaderSource = R"glsl(
+#version 330 core
+layout (location = 0) in vec4 rect;      // x0, y0, x1, y1 in pixels
+layout (location = 1) in vec4 uvRect;
+layout (location = 2) in vec4 color;
+
+out vec2 uv;
+out vec4 textColor;
+
+uniform vec2 viewportSize;
+
+void main()
+{
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 position = mix(rect.xy, rect.zw, corner);
+    uv = mix(uvRect.xy, uvRect.zw, corner);
+    textColor = color;
+
+    vec2 ndc = position / viewportSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+}
+)glsl";
+
+static const char *fragmentShaderSource = R"glsl(
+#version 330 core
+in vec2 uv;
+in vec4 textColor;
+out vec4 FragColor;
+
+uniform sampler2D atlas;
+uniform float outlineWidth;   // In distance units, 0 to 0.5
+uniform vec4 outlineColor;
+
+void main()
+{
+    float distance = texture(atlas, uv).r;
+    // One screen pixel of antialiasing whatever the magnification
+    float w = max(fwidth(distance) * 0.5, 1.0e-4);
+    float fill = smoothstep(0.5 - w, 0.5 + w, distance);
+    float shape = smoothstep(0.5 - outlineWidth - w, 0.5 - outlineWidth + w, distance);
+    vec4 color = mix(outlineColor, textColor, fill);
+    FragColor = vec4(color.rgb, color.a * shape);
+}
+)glsl";
+
+// ------------------- Distance Transform -------------------
+
+static const double Far = 1.0e20;
+
+// Felzenszwalb & Huttenlocher: exact squared distance transform of a sampled function, in linear time
+static void distanceTransform1D(const double *f, double *d, int *v, double *z, int n)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -Far;
+    z[1] = Far;
+    for (int q = 1; q < n; ++q) {
+        double s = ((f[q] + double(q) * q) - (f[v[k]] + double(v[k]) * v[k])) / (2.0 * q - 2.0 * v[k]);
+        while (s <= z[k]) {
+            --k;
+            s = ((f[q] + double(q) * q) - (f[v[k]] + double(v[k]) * v[k])) / (2.0 * q - 2.0 * v[k]);
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = Far;
+    }
+    k = 0;
+    for (int q = 0; q < n; ++q) {
+        while (z[k + 1] < q) {
+            ++k;
+        }
+        d[q] = double(q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+// In place: grid holds 0 on the feature pixels and Far elsewhere, and gets the squared distances
+static void distanceTransform2D(QVector<double> &grid, int width, int height)
+{
+    const int n = qMax(width, height);
+    QVector<double> f(n);
+    QVector<double> d(n);
+    QVector<int> v(n);
+    QVector<double> z(n + 1);
+
+    for (int x = 0; x < width; ++x) {
+        for (int y = 0; y < height; ++y) {
+            f[y] = grid[y * width + x];
+        }
+        distanceTransform1D(f.constData(), d.data(), v.data(), z.data(), height);
+        for (int y = 0; y < height; ++y) {
+            grid[y * width + x] = d[y];
+        }
+    }
+    for (int y = 0; y < height; ++y) {
+        distanceTransform1D(grid.constData() + y * width, d.data(), v.data(), z.data(), width);
+        std::copy(d.constBegin(), d.constBegin() + width, grid.begin() + y * width);
+    }
+}
+
+// ------------------- Atlas -------------------
+
+namespace {
+struct RasterGlyph {
+    char16_t code = 0;
+    SdfFontAtlas::Glyph glyph;
+    QImage field;        // Grayscale8, null for blank glyphs
+    QPoint atlasPosition;
+};
+}
+
+bool SdfFontAtlas::build(const QFont &font, const Params &params)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    parameters = params;
+    parameters.glyphSize = qMax(8, parameters.glyphSize);
+    parameters.spread = qMax(1, parameters.spread);
+    parameters.supersample = qMax(1, parameters.supersample);
+    parameters.atlasWidth = (qMax(64, parameters.atlasWidth) + 3) & ~3;
+
+    QString characters = parameters.characters;
+    if (characters.isEmpty()) {
+        for (char16_t c = 32; c < 127; ++c) {
+            characters.append(QChar(c));
+        }
+        for (char16_t c = 160; c < 256; ++c) {
+            characters.append(QChar(c));
+        }
+    }
+    if (!characters.contains('?')) {
+        characters.append('?');
+    }
+
+    const int ss = parameters.supersample;
+    QFont hiFont(font);
+    hiFont.setPixelSize(parameters.glyphSize * ss);
+    hiFont.setStyleStrategy(QFont::NoAntialias);   // Thresholded anyway; the distance field does the smoothing
+    const QFontMetricsF metrics(hiFont);
+    fontAscent = float(metrics.ascent() / ss);
+    lineSpacing = float(metrics.lineSpacing() / ss);
+
+    const int pad = parameters.spread * ss;
+    QVector<RasterGlyph> rasters;
+    for (QChar c : characters) {
+        RasterGlyph raster;
+        raster.code = c.unicode();
+        raster.glyph.advance = float(metrics.horizontalAdvance(c) / ss);
+
+        const QRectF ink = metrics.boundingRect(c);
+        if (!ink.isEmpty() && !c.isSpace()) {
+            // Whole atlas pixels, with the spread on every side
+            const int originX = pad - int(std::floor(ink.left()));
+            const int originY = pad - int(std::floor(ink.top()));
+            const int hiWidth = (int(std::ceil(ink.right())) + originX + pad + ss - 1) / ss * ss;
+            const int hiHeight = (int(std::ceil(ink.bottom())) + originY + pad + ss - 1) / ss * ss;
+
+            QImage hi(hiWidth, hiHeight, QImage::Format_ARGB32_Premultiplied);
+            hi.fill(Qt::black);
+            QPainter painter(&hi);
+            painter.setFont(hiFont);
+            painter.setPen(Qt::white);
+            painter.drawText(QPointF(originX, originY), QString(c));
+            painter.end();
+
+            // Squared distances to the nearest inside pixel, and to the nearest outside one
+            QVector<double> toInside(hiWidth * hiHeight);
+            QVector<double> toOutside(hiWidth * hiHeight);
+            for (int y = 0; y < hiHeight; ++y) {
+                const QRgb *line = reinterpret_cast<const QRgb *>(hi.constScanLine(y));
+                for (int x = 0; x < hiWidth; ++x) {
+                    const bool inside = qRed(line[x]) >= 128;
+                    toInside[y * hiWidth + x] = inside ? 0.0 : Far;
+                    toOutside[y * hiWidth + x] = inside ? Far : 0.0;
+                }
+            }
+            distanceTransform2D(toInside, hiWidth, hiHeight);
+            distanceTransform2D(toOutside, hiWidth, hiHeight);
+
+            const int width = hiWidth / ss;
+            const int height = hiHeight / ss;
+            raster.field = QImage(width, height, QImage::Format_Grayscale8);
+            for (int y = 0; y < height; ++y) {
+                uchar *out = raster.field.scanLine(y);
+                for (int x = 0; x < width; ++x) {
+                    const int i = (y * ss + ss / 2) * hiWidth + x * ss + ss / 2;
+                    // Pixel centers are half a pixel from the edge they border
+                    const double distance = toInside[i] == 0.0 ? std::sqrt(toOutside[i]) - 0.5
+                                                               : 0.5 - std::sqrt(toInside[i]);
+                    const double value = 0.5 + distance / ss / (2.0 * parameters.spread);
+                    out[x] = uchar(qBound(0.0, value, 1.0) * 255.0 + 0.5);
+                }
+            }
+            raster.glyph.quad = QRectF(-double(originX) / ss, -double(originY) / ss, width, height);
+        }
+        rasters.append(raster);
+    }
+
+    // Shelf packing, tallest first, one pixel apart so bilinear filtering does not bleed
+    QVector<int> order;
+    for (int i = 0; i < rasters.size(); ++i) {
+        if (!rasters[i].field.isNull()) {
+            order.append(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&rasters](int a, int b) {
+        return rasters[a].field.height() > rasters[b].field.height();
+    });
+    int x = 1;
+    int y = 1;
+    int shelfHeight = 0;
+    for (int i : order) {
+        const QImage &field = rasters[i].field;
+        if (x + field.width() + 1 > parameters.atlasWidth) {
+            x = 1;
+            y += shelfHeight + 1;
+            shelfHeight = 0;
+        }
+        rasters[i].atlasPosition = QPoint(x, y);
+        x += field.width() + 1;
+        shelfHeight = qMax(shelfHeight, field.height());
+    }
+    const int atlasHeight = (y + shelfHeight + 1 + 3) & ~3;
+
+    atlas = QImage(parameters.atlasWidth, atlasHeight, QImage::Format_Grayscale8);
+    atlas.fill(0);
+    for (int i : order) {
+        const QImage &field = rasters[i].field;
+        const QPoint p = rasters[i].atlasPosition;
+        for (int row = 0; row < field.height(); ++row) {
+            std::copy(field.constScanLine(row), field.constScanLine(row) + field.width(), atlas.scanLine(p.y() + row) + p.x());
+        }
+    }
+
+    others.clear();
+    for (Glyph &g : latin) {
+        g = Glyph();
+    }
+    for (RasterGlyph &raster : rasters) {
+        if (!raster.field.isNull()) {
+            const QPoint p = raster.atlasPosition;
+            raster.glyph.uv = QRectF(double(p.x()) / atlas.width(), double(p.y()) / atlas.height(),
+                                     double(raster.field.width()) / atlas.width(),
+                                     double(raster.field.height()) / atlas.height());
+        }
+        if (raster.code < 256) {
+            latin[raster.code] = raster.glyph;
+        } else {
+            others.insert(raster.code, raster.glyph);
+        }
+    }
+    missing = latin[int('?')];
+
+    buildMs = timer.elapsed();
+    qDebug() << "SdfFontAtlas:" << rasters.size() << "glyphs of" << font.family() << "in a" << atlas.width() << "x"
+             << atlas.height() << "atlas," << buildMs << "ms";
+    return true;
+}
+
+const SdfFontAtlas::Glyph &SdfFontAtlas::glyph(QChar c) const
+{
+    const char16_t code = c.unicode();
+    if (code < 256) {
+        const Glyph &g = latin[code];
+        return g.advance > 0.0f ? g : missing;
+    }
+    auto it = others.constFind(code);
+    return it != others.constEnd() ? *it : missing;
+}
+
+float SdfFontAtlas::textWidth(const QString &text, float pixelSize) const
+{
+    const float scale = pixelSize / parameters.glyphSize;
+    float width = 0.0f;
+    float line = 0.0f;
+    for (QChar c : text) {
+        if (c == '\n') {
+            width = qMax(width, line);
+            line = 0.0f;
+            continue;
+        }
+        line += glyph(c).advance * scale;
+    }
+    return qMax(width, line);
+}
+
+// ------------------- Renderer Setup -------------------
+
+bool TextRenderer::initialize(const SdfFontAtlas *atlas, int initialGlyphs)
+{
+    if (!initializeOpenGLFunctions()) {
+        qWarning() << "TextRenderer: needs an OpenGL 3.3 context";
+        return false;
+    }
+    release();
+
+    if (!atlas || !atlas->isValid()) {
+        qWarning() << "TextRenderer: the font atlas has not been built";
+        return false;
+    }
+    font = atlas;
+
+    program = new QOpenGLShaderProgram;
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource)
+        || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource)
+        || !program->link()) {
+        qWarning() << "TextRenderer: program failed:" << program->log();
+        release();
+        return false;
+    }
+
+    const QImage image = font->image();
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, GLint(image.bytesPerLine()));
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, image.width(), image.height(), 0, GL_RED, GL_UNSIGNED_BYTE,
+                 image.constBits());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // Linear, no mipmaps: the distance field is meant to be interpolated
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &instanceBuffer);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    const GLsizei stride = sizeof(GlyphInstance);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GlyphInstance, rect));
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(GlyphInstance, uv));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(GlyphInstance, color));
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    const QString owner = QString("TextRenderer@%1").arg(quintptr(this), 0, 16);
+    textureMemory = memory.registerAllocation(GpuMemoryTracker::Category::Texture,
+                                              qint64(image.width()) * image.height(), owner, "SDF glyph atlas");
+    bufferMemory = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, 0, owner, "glyph instances");
+    capacity = 0;
+    reserve(qMax(1, initialGlyphs));
+
+    lastFlush = Stats();
+    initialized = true;
+    return true;
+}
+
+void TextRenderer::release()
+{
+    delete program;
+    program = nullptr;
+    if (texture != 0) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+    if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+        vao = 0;
+    }
+    if (instanceBuffer != 0) {
+        glDeleteBuffers(1, &instanceBuffer);
+        instanceBuffer = 0;
+    }
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    memory.release(textureMemory);
+    memory.release(bufferMemory);
+    textureMemory = bufferMemory = 0;
+
+    capacity = 0;
+    instances.clear();
+    font = nullptr;
+    initialized = false;
+}
+
+void TextRenderer::reserve(int glyphs)
+{
+    if (glyphs <= capacity) {
+        return;
+    }
+    // The storage itself is (re)specified by every flush()
+    capacity = qMax(glyphs, capacity * 2);
+    instances.reserve(capacity);
+    GpuMemoryTracker::instance().resize(bufferMemory, qint64(capacity) * sizeof(GlyphInstance));
+}
+
+void TextRenderer::setOutline(float width, const QColor &color)
+{
+    outlineWidth = width;
+    outlineColor = color;
+}
+
+// ------------------- Queueing Text -------------------
+
+void TextRenderer::addText(const QString &text, const QPointF &position, float pixelSize, const QColor &color,
+                           Qt::Alignment alignment)
+{
+    if (!font) {
+        return;
+    }
+    const float scale = pixelSize / font->glyphSize();
+    const float lineHeight = font->lineHeight() * scale;
+    const int lines = int(text.count('\n')) + 1;
+
+    float top = float(position.y());
+    if (alignment & Qt::AlignVCenter) {
+        top -= 0.5f * lines * lineHeight;
+    } else if (alignment & Qt::AlignBottom) {
+        top -= lines * lineHeight;
+    }
+
+    const quint8 rgba[4] = { quint8(color.red()), quint8(color.green()), quint8(color.blue()), quint8(color.alpha()) };
+    float baseline = top + font->ascent() * scale;
+    qsizetype lineStart = 0;
+    while (lineStart <= text.size()) {
+        qsizetype lineEnd = text.indexOf('\n', lineStart);
+        if (lineEnd < 0) {
+            lineEnd = text.size();
+        }
+        const QStringView line = QStringView(text).mid(lineStart, lineEnd - lineStart);
+
+        float penX = float(position.x());
+        if (alignment & (Qt::AlignHCenter | Qt::AlignRight)) {
+            float width = 0.0f;
+            for (QChar c : line) {
+                width += font->glyph(c).advance * scale;
+            }
+            penX -= (alignment & Qt::AlignRight) ? width : 0.5f * width;
+        }
+
+        for (QChar c : line) {
+            const SdfFontAtlas::Glyph &g = font->glyph(c);
+            if (!g.uv.isEmpty()) {
+                GlyphInstance instance;
+                instance.rect[0] = penX + float(g.quad.left()) * scale;
+                instance.rect[1] = baseline + float(g.quad.top()) * scale;
+                instance.rect[2] = penX + float(g.quad.right()) * scale;
+                instance.rect[3] = baseline + float(g.quad.bottom()) * scale;
+                instance.uv[0] = quint16(g.uv.left() * 65535.0 + 0.5);
+                instance.uv[1] = quint16(g.uv.top() * 65535.0 + 0.5);
+                instance.uv[2] = quint16(g.uv.right() * 65535.0 + 0.5);
+                instance.uv[3] = quint16(g.uv.bottom() * 65535.0 + 0.5);
+                std::copy(rgba, rgba + 4, instance.color);
+                instances.append(instance);
+            }
+            penX += g.advance * scale;
+        }
+
+        baseline += lineHeight;
+        lineStart = lineEnd + 1;
+    }
+}
+
+bool TextRenderer::addLabel(const QString &text, const QVector3D &worldPosition, const QMatrix4x4 &viewProjection,
+                            const QSize &viewport, float pixelSize, const QColor &color)
+{
+    if (!font) {
+        return false;
+    }
+    const QVector4D clip = viewProjection * QVector4D(worldPosition, 1.0f);
+    if (clip.w() <= 0.0f) {
+        return false;
+    }
+    const float x = (clip.x() / clip.w() * 0.5f + 0.5f) * viewport.width();
+    const float y = (0.5f - clip.y() / clip.w() * 0.5f) * viewport.height();
+
+    // Cheap reject before any glyph is looked up twice
+    if (y + pixelSize < 0.0f || y - pixelSize > viewport.height()) {
+        return false;
+    }
+    const float halfWidth = 0.5f * font->textWidth(text, pixelSize);
+    if (x + halfWidth < 0.0f || x - halfWidth > viewport.width()) {
+        return false;
+    }
+    addText(text, QPointF(x, y), pixelSize, color, Qt::AlignHCenter | Qt::AlignVCenter);
+    return true;
+}
+
+// ------------------- Drawing -------------------
+
+void TextRenderer::flush(const QSize &viewport)
+{
+    lastFlush = Stats();
+    if (!initialized || instances.isEmpty()) {
+        instances.clear();
+        return;
+    }
+
+    reserve(instances.size());
+    const qint64 bytes = qint64(instances.size()) * sizeof(GlyphInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    // Orphan: the driver hands out fresh storage instead of waiting for the previous frame's draw
+    glBufferData(GL_ARRAY_BUFFER, qint64(capacity) * sizeof(GlyphInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instances.constData());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    program->bind();
+    program->setUniformValue("viewportSize", QVector2D(viewport.width(), viewport.height()));
+    program->setUniformValue("atlas", 0);
+    program->setUniformValue("outlineWidth", qBound(0.0f, outlineWidth / (2.0f * font->spread()), 0.5f));
+    program->setUniformValue("outlineColor", outlineColor);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindVertexArray(vao);
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instances.size());
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    program->release();
+    glDisable(GL_BLEND);
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    lastFlush.glyphs = instances.size();
+    lastFlush.drawCalls = 1;
+    lastFlush.uploadedBytes = bytes;
+    instances.clear();
+}
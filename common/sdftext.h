@@ -0,0 +1,175 @@
+#ifndef SDFTEXT_H
+#define SDFTEXT_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QMatrix4x4>
+#include <QPointF>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include "gpumemory.h"
+
+class QOpenGLShaderProgram;
+
+/**
+ * @brief Signed-distance-field glyph atlas, built once from a font.
+ *
+ * Every glyph is rasterized at supersample x glyphSize pixels, an exact
+ * Euclidean distance transform is run on the inside and the outside, and the
+ * result is sampled down into a single-channel atlas: 0.5 is the outline,
+ * larger is inside, and +-spread atlas pixels span [0, 1]. Bilinear samples
+ * of such an atlas stay sharp at any magnification, so one atlas serves every
+ * text size.
+ *
+ * Metrics are in atlas pixels at glyphSize; a renderer scales them by
+ * pixelSize / glyphSize. Characters missing from the atlas draw as '?'.
+ */
+class SdfFontAtlas
+{
+public:
+    struct Params {
+        int glyphSize = 32;        // Em size of a glyph in the atlas, in pixels
+        int spread = 4;            // Distance range on each side of the outline, in atlas pixels
+        int supersample = 4;       // Rasterization scale of the distance transform
+        int atlasWidth = 512;
+        QString characters;        // Empty: printable ASCII and Latin-1
+    };
+
+    struct Glyph {
+        float advance = 0.0f;
+        QRectF quad;               // Relative to the pen on the baseline, y down
+        QRectF uv;                 // Normalized atlas rectangle (empty for blank glyphs)
+    };
+
+    /**
+     * @brief Rasterizes the glyphs and packs the atlas; needs a QGuiApplication for the font.
+     */
+    bool build(const QFont &font) { return build(font, Params()); }
+    bool build(const QFont &font, const Params &params);
+    bool isValid() const { return !atlas.isNull(); }
+
+    /**
+     * @brief Glyph of @p c, or of '?' when @p c was not built.
+     */
+    const Glyph &glyph(QChar c) const;
+
+    QImage image() const { return atlas; }   // Grayscale8
+    int glyphSize() const { return parameters.glyphSize; }
+    int spread() const { return parameters.spread; }
+    float ascent() const { return fontAscent; }
+    float lineHeight() const { return lineSpacing; }
+    qint64 buildMilliseconds() const { return buildMs; }
+
+    /**
+     * @brief Advance width of @p text drawn at @p pixelSize.
+     */
+    float textWidth(const QString &text, float pixelSize) const;
+
+private:
+    QImage atlas;
+    Params parameters;
+    Glyph latin[256];              // Direct lookup for the common case
+    QHash<char16_t, Glyph> others;
+    Glyph missing;
+    float fontAscent = 0.0f;
+    float lineSpacing = 0.0f;
+    qint64 buildMs = 0;
+};
+
+/**
+ * @brief Batched text drawing from an SdfFontAtlas.
+ *
+ * addText() and addLabel() only append one instance per visible glyph (screen
+ * rectangle, atlas rectangle, RGBA8 color: 28 bytes) to a CPU array. flush()
+ * streams the array into an orphaned vertex buffer and draws every glyph of
+ * the frame with a single instanced draw; the quad corners come from
+ * gl_VertexID. The distance-field shader antialiases over one screen pixel
+ * (fwidth) and can add an outline.
+ *
+ * Positions are in pixels of the viewport passed to flush(), origin top-left.
+ * All GL calls must be made with the owning context current.
+ */
+class TextRenderer : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Stats {
+        int glyphs = 0;            // Drawn by the last flush()
+        int drawCalls = 0;
+        qint64 uploadedBytes = 0;
+    };
+
+    TextRenderer() = default;
+
+    /**
+     * @brief Uploads @p atlas and builds the program. @p atlas must outlive the renderer.
+     * @param initialGlyphs Instance capacity; the buffer grows when a frame needs more.
+     */
+    bool initialize(const SdfFontAtlas *atlas, int initialGlyphs = 4096);
+    /**
+     * @brief Deletes the texture, buffer and program; call with the context current.
+     */
+    void release();
+    bool isInitialized() const { return initialized; }
+
+    /**
+     * @brief Queues @p text; \n starts a new line.
+     * @param position Anchor in pixels; @p alignment picks which point of the text block it is
+     *        (Qt::AlignLeft / AlignHCenter / AlignRight and AlignTop / AlignVCenter / AlignBottom).
+     */
+    void addText(const QString &text, const QPointF &position, float pixelSize, const QColor &color,
+                 Qt::Alignment alignment = Qt::AlignLeft | Qt::AlignTop);
+    /**
+     * @brief Queues @p text centered on the projection of @p worldPosition.
+     * @return false if the point is behind the camera or the text is off screen.
+     */
+    bool addLabel(const QString &text, const QVector3D &worldPosition, const QMatrix4x4 &viewProjection,
+                  const QSize &viewport, float pixelSize, const QColor &color);
+
+    /**
+     * @brief Outline drawn around every glyph; @p width in atlas pixels, at most the atlas spread.
+     */
+    void setOutline(float width, const QColor &color);
+
+    int pendingGlyphs() const { return instances.size(); }
+
+    /**
+     * @brief Draws everything queued since the last flush() in one call and clears the queue.
+     *
+     * Blends over the bound framebuffer with depth testing off, then restores the depth test.
+     */
+    void flush(const QSize &viewport);
+
+    Stats stats() const { return lastFlush; }
+
+private:
+    struct GlyphInstance {
+        float rect[4];             // x0, y0, x1, y1 in pixels
+        quint16 uv[4];             // u0, v0, u1, v1, normalized
+        quint8 color[4];
+    };
+
+    void reserve(int glyphs);
+
+    bool initialized = false;
+    const SdfFontAtlas *font = nullptr;
+    QOpenGLShaderProgram *program = nullptr;
+    GLuint texture = 0;
+    GLuint vao = 0;
+    GLuint instanceBuffer = 0;
+    int capacity = 0;
+    float outlineWidth = 0.0f;
+    QColor outlineColor = Qt::black;
+
+    QVector<GlyphInstance> instances;
+    Stats lastFlush;
+
+    GpuMemoryTracker::Handle textureMemory = 0;
+    GpuMemoryTracker::Handle bufferMemory = 0;
+};
+
+#endif // SDFTEXT_H
@@ -0,0 +1,18 @@
+#version 440
+
+// 05's pipeline on QRhi: position + per-vertex color, one model-view-projection per draw
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+
+layout(location = 0) out vec3 vertexColor;
+
+// One slot per cube in a dynamic buffer, selected with a dynamic offset
+layout(std140, binding = 0) uniform Object {
+    mat4 mvp;
+};
+
+void main()
+{
+    vertexColor = color;
+    gl_Position = mvp * vec4(position, 1.0);
+}
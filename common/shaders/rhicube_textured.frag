@@ -0,0 +1,13 @@
+#version 440
+
+layout(location = 0) in vec2 vertexTexCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+// The dice face of the current draw
+layout(binding = 1) uniform sampler2D faceTexture;
+
+void main()
+{
+    fragColor = texture(faceTexture, vertexTexCoord);
+}
@@ -0,0 +1,17 @@
+#version 440
+
+// 06's pipeline on QRhi: position + texture coordinates, one model-view-projection per draw
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 texCoord;
+
+layout(location = 0) out vec2 vertexTexCoord;
+
+layout(std140, binding = 0) uniform Object {
+    mat4 mvp;
+};
+
+void main()
+{
+    vertexTexCoord = texCoord;
+    gl_Position = mvp * vec4(position, 1.0);
+}
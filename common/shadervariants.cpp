@@ -0,0 +1,164 @@
+#include "shadervariants.h"
+#include <QDebug>
+
+// ------------------- Shader Source -------------------
+// One source for both stages; VERTEX_SHADER or FRAGMENT_SHADER and a
+// #define per feature bit are prepended. Keep the feature names in step
+// with featureDefines below.
+static const char *shaderSource = R"glsl(
+#ifdef VERTEX_SHADER
+layout(location = 0) in vec3 position;
+#ifdef VERTEX_COLOR
+layout(location = 1) in vec3 color;
+out vec3 vertexColor;
+#endif
+#ifdef TEXCOORD
+layout(location = 2) in vec2 texCoord;
+out vec2 vertexTexCoord;
+#endif
+#ifdef TRANSFORM
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+#endif
+
+void main()
+{
+#ifdef TRANSFORM
+    gl_Position = projection * view * model * vec4(position, 1.0);
+#else
+    gl_Position = vec4(position, 1.0);
+#endif
+#ifdef VERTEX_COLOR
+    vertexColor = color;
+#endif
+#ifdef TEXCOORD
+#ifdef FLIP_V
+    vertexTexCoord = vec2(texCoord.x, 1.0 - texCoord.y);
+#else
+    vertexTexCoord = texCoord;
+#endif
+#endif
+}
+#endif
+
+#ifdef FRAGMENT_SHADER
+#ifdef VERTEX_COLOR
+in vec3 vertexColor;
+#endif
+#ifdef TEXCOORD
+in vec2 vertexTexCoord;
+uniform sampler2D textureSampler;
+#endif
+out vec4 fragColor;
+
+void main()
+{
+    vec4 color = vec4(1.0);
+#ifdef VERTEX_COLOR
+    color.rgb = vertexColor;
+#endif
+#ifdef TEXCOORD
+    color *= texture(textureSampler, vertexTexCoord);
+#endif
+    fragColor = color;
+}
+#endif
+)glsl";
+
+namespace {
+
+struct FeatureDefine {
+    ShaderFeatures::Bit bit;
+    const char *name;
+};
+
+constexpr FeatureDefine featureDefines[ShaderFeatures::BitCount] = {
+    { ShaderFeatures::VertexColor, "VERTEX_COLOR" },
+    { ShaderFeatures::TexCoord, "TEXCOORD" },
+    { ShaderFeatures::Transform, "TRANSFORM" },
+    { ShaderFeatures::FlipV, "FLIP_V" },
+};
+
+QString featureNames(ShaderFeatures features)
+{
+    QStringList names;
+    for (const FeatureDefine &define : featureDefines) {
+        if (features.has(define.bit)) {
+            names << define.name;
+        }
+    }
+    return names.isEmpty() ? QString("(none)") : names.join('|');
+}
+
+} // namespace
+
+// ------------------- Variant Cache -------------------
+
+QByteArray ShaderVariantCache::source(ShaderFeatures features, QOpenGLShader::ShaderType type)
+{
+    QByteArray text = "#version 330 core\n";
+    text += type == QOpenGLShader::Vertex ? "#define VERTEX_SHADER\n" : "#define FRAGMENT_SHADER\n";
+    for (const FeatureDefine &define : featureDefines) {
+        if (features.has(define.bit)) {
+            text += "#define ";
+            text += define.name;
+            text += '\n';
+        }
+    }
+    // Compiler messages then give line numbers of the source above
+    text += "#line 0\n";
+    text += shaderSource;
+    return text;
+}
+
+const ShaderVariant *ShaderVariantCache::variant(ShaderFeatures features)
+{
+    if (features.bits() >= quint32(ShaderFeatures::VariantCount)) {
+        qWarning() << "ShaderVariantCache: unknown feature bits" << features.bits();
+        return nullptr;
+    }
+    Entry &entry = entries[features.bits()];
+    if (entry.program) {
+        return &entry.variant;
+    }
+    if (entry.failed) {
+        return nullptr;
+    }
+
+    auto program = std::make_unique<QOpenGLShaderProgram>();
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, source(features, QOpenGLShader::Vertex))
+        || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, source(features, QOpenGLShader::Fragment))
+        || !program->link()) {
+        qWarning().noquote() << "ShaderVariantCache: variant" << featureNames(features) << "does not build:"
+                             << program->log();
+        entry.failed = true;
+        return nullptr;
+    }
+
+    ShaderVariant &variant = entry.variant;
+    variant.program = program.get();
+    variant.features = features;
+    if (features.has(ShaderFeatures::Transform)) {
+        variant.model = program->uniformLocation("model");
+        variant.view = program->uniformLocation("view");
+        variant.projection = program->uniformLocation("projection");
+    }
+    if (features.has(ShaderFeatures::TexCoord)) {
+        variant.textureSampler = program->uniformLocation("textureSampler");
+    }
+    entry.program = std::move(program);
+    ++compiled;
+    qDebug().noquote() << "ShaderVariantCache: built variant" << featureNames(features);
+    return &variant;
+}
+
+void ShaderVariantCache::release()
+{
+    for (Entry &entry : entries) {
+        entry.program.reset();
+        entry.variant = ShaderVariant();
+        entry.failed = false;
+    }
+    compiled = 0;
+}
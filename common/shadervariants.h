@@ -0,0 +1,125 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <QOpenGLShaderProgram>
+#include <QtGlobal>
+#include <array>
+#include <memory>
+
+/**
+ * @brief Feature bits of a shader variant.
+ *
+ * A literal type: a stage's variant is a constexpr value built from its
+ * vertex layout and material flags, and the bits themselves index the
+ * variant cache, so selecting a program per draw is an array lookup.
+ */
+class ShaderFeatures
+{
+public:
+    enum Bit : quint32 {
+        VertexColor = 1u << 0,      // vec3 color at location 1, the base color
+        TexCoord = 1u << 1,         // vec2 texCoord at location 2, multiplies in textureSampler
+        Transform = 1u << 2,        // projection * view * model; without it positions are in clip space
+        FlipV = 1u << 3             // v = 1 - v, for textures uploaded top row first (TextureUploader)
+    };
+    static constexpr int BitCount = 4;
+    static constexpr int VariantCount = 1 << BitCount;
+
+    constexpr ShaderFeatures() = default;
+    constexpr ShaderFeatures(Bit bit) : value(bit) {}
+
+    constexpr ShaderFeatures operator|(ShaderFeatures other) const { return ShaderFeatures(value | other.value); }
+    constexpr bool has(Bit bit) const { return (value & bit) != 0; }
+    constexpr quint32 bits() const { return value; }
+    constexpr bool operator==(ShaderFeatures other) const { return value == other.value; }
+    constexpr bool operator!=(ShaderFeatures other) const { return value != other.value; }
+
+private:
+    constexpr explicit ShaderFeatures(quint32 bits) : value(bits) {}
+
+    quint32 value = 0;
+};
+
+constexpr ShaderFeatures operator|(ShaderFeatures::Bit a, ShaderFeatures::Bit b)
+{
+    return ShaderFeatures(a) | ShaderFeatures(b);
+}
+
+/**
+ * @brief The attribute features of a meshgen vertex layout (meshgen::Pos, PosColor, PosUv).
+ */
+template <typename Layout>
+constexpr ShaderFeatures vertexFeatures()
+{
+    ShaderFeatures features;
+    if constexpr (Layout::HasColor) {
+        features = features | ShaderFeatures::VertexColor;
+    }
+    if constexpr (Layout::HasUv) {
+        features = features | ShaderFeatures::TexCoord;
+    }
+    return features;
+}
+
+/**
+ * @brief A linked variant and its uniform locations (-1 for those its features leave out).
+ */
+struct ShaderVariant {
+    QOpenGLShaderProgram *program = nullptr;
+    ShaderFeatures features;
+    int model = -1;
+    int view = -1;
+    int projection = -1;
+    int textureSampler = -1;
+};
+
+/**
+ * @brief Programs specialized from one annotated GLSL source, compiled on first use and kept.
+ *
+ * The source (see shadervariants.cpp) covers what stages 04-06 used to
+ * embed as near-identical strings. Attributes are at fixed locations:
+ * position 0, color 1, texture coordinates 2. Each feature bit turns into a
+ * #define in front of the source, so the compiler removes what a variant
+ * does not use. A variant that fails to build is logged once and returns
+ * nullptr from then on.
+ *
+ * All calls must be made with the owning context current.
+ */
+class ShaderVariantCache
+{
+public:
+    ShaderVariantCache() = default;
+
+    /**
+     * @brief The variant for @p features, compiling and linking it on the first request.
+     */
+    const ShaderVariant *variant(ShaderFeatures features);
+    QOpenGLShaderProgram *program(ShaderFeatures features)
+    {
+        const ShaderVariant *v = variant(features);
+        return v ? v->program : nullptr;
+    }
+
+    /**
+     * @brief The specialized source of one stage of a variant, as handed to the compiler.
+     */
+    static QByteArray source(ShaderFeatures features, QOpenGLShader::ShaderType type);
+
+    int compiledCount() const { return compiled; }
+    /**
+     * @brief Deletes every program; call with the context current before it goes away.
+     */
+    void release();
+
+private:
+    struct Entry {
+        std::unique_ptr<QOpenGLShaderProgram> program;
+        ShaderVariant variant;
+        bool failed = false;
+    };
+
+    std::array<Entry, ShaderFeatures::VariantCount> entries;
+    int compiled = 0;
+};
+
+#endif // SHADERVARIANTS_H
@@ -0,0 +1,953 @@
+#include "softrasterizer.h"
+#include "perftrace.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTRASTER_SSE2
+#endif
+
+namespace {
+
+constexpr float SubpixelSteps = 16.0f;
+constexpr float GuardBand = 8.0f;           // x and y are clipped only beyond 8x the viewport
+constexpr int ChunkTriangles = 8192;
+constexpr int VertexGrain = 16384;
+constexpr quint32 ClippedVertex = 0x80000000u;
+constexpr int AttributeCount = 6;
+
+// Clip-space outcodes: outside the view volume, and outside the guard band where x / y get clipped
+constexpr quint32 OutLeft = 1u << 0;
+constexpr quint32 OutRight = 1u << 1;
+constexpr quint32 OutBottom = 1u << 2;
+constexpr quint32 OutTop = 1u << 3;
+constexpr quint32 OutNear = 1u << 4;
+constexpr quint32 OutFar = 1u << 5;
+constexpr quint32 GuardLeft = 1u << 6;
+constexpr quint32 GuardRight = 1u << 7;
+constexpr quint32 GuardBottom = 1u << 8;
+constexpr quint32 GuardTop = 1u << 9;
+constexpr quint32 OutsideBits = OutLeft | OutRight | OutBottom | OutTop | OutNear | OutFar;
+constexpr quint32 ClipBits = OutNear | GuardLeft | GuardRight | GuardBottom | GuardTop;
+
+// ------------------- Four Lanes -------------------
+// One 2x2 quad: lanes (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1). Comparisons return a 4-bit lane mask.
+
+#ifdef SOFTRASTER_SSE2
+struct F4 {
+    __m128 v;
+};
+
+inline F4 splat(float a) { return { _mm_set1_ps(a) }; }
+inline F4 lanes(float a, float b, float c, float d) { return { _mm_setr_ps(a, b, c, d) }; }
+inline F4 load(const float *p) { return { _mm_loadu_ps(p) }; }
+inline void store(float *p, F4 a) { _mm_storeu_ps(p, a.v); }
+inline F4 operator+(F4 a, F4 b) { return { _mm_add_ps(a.v, b.v) }; }
+inline F4 operator-(F4 a, F4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline F4 operator*(F4 a, F4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline F4 operator/(F4 a, F4 b) { return { _mm_div_ps(a.v, b.v) }; }
+inline int greater(F4 a, F4 b) { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, b.v)); }
+inline int equal(F4 a, F4 b) { return _mm_movemask_ps(_mm_cmpeq_ps(a.v, b.v)); }
+inline int less(F4 a, F4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+inline int lessEqual(F4 a, F4 b) { return _mm_movemask_ps(_mm_cmple_ps(a.v, b.v)); }
+#else
+struct F4 {
+    float v[4];
+};
+
+inline F4 splat(float a) { return { { a, a, a, a } }; }
+inline F4 lanes(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+inline F4 load(const float *p) { return { { p[0], p[1], p[2], p[3] } }; }
+inline void store(float *p, F4 a)
+{
+    for (int i = 0; i < 4; ++i) {
+        p[i] = a.v[i];
+    }
+}
+
+template <typename Op>
+inline F4 apply(F4 a, F4 b, Op op)
+{
+    return { { op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3]) } };
+}
+
+template <typename Op>
+inline int compare(F4 a, F4 b, Op op)
+{
+    return (op(a.v[0], b.v[0]) ? 1 : 0) | (op(a.v[1], b.v[1]) ? 2 : 0) | (op(a.v[2], b.v[2]) ? 4 : 0)
+           | (op(a.v[3], b.v[3]) ? 8 : 0);
+}
+
+inline F4 operator+(F4 a, F4 b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+inline F4 operator-(F4 a, F4 b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+inline F4 operator*(F4 a, F4 b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+inline F4 operator/(F4 a, F4 b) { return apply(a, b, [](float x, float y) { return x / y; }); }
+inline int greater(F4 a, F4 b) { return compare(a, b, [](float x, float y) { return x > y; }); }
+inline int equal(F4 a, F4 b) { return compare(a, b, [](float x, float y) { return x == y; }); }
+inline int less(F4 a, F4 b) { return compare(a, b, [](float x, float y) { return x < y; }); }
+inline int lessEqual(F4 a, F4 b) { return compare(a, b, [](float x, float y) { return x <= y; }); }
+#endif
+
+// ------------------- Edge Functions -------------------
+
+/**
+ * Edge from p to q, stored in a canonical direction (lower y, then lower x first) so that the two triangles
+ * sharing an edge compute bit-identical values with opposite signs: no pixel is covered twice or dropped.
+ */
+struct Edge {
+    float px, py;                           // Canonical start
+    float dx, dy;                           // Canonical end - start
+    float sign;                             // +1 or -1: makes the value positive inside
+    bool topLeft;                           // Pixels exactly on the edge belong to this triangle
+
+    void setup(float x0, float y0, float x1, float y1)
+    {
+        sign = 1.0f;
+        if (y1 < y0 || (y1 == y0 && x1 < x0)) {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+            sign = -1.0f;
+        }
+        px = x0;
+        py = y0;
+        dx = x1 - x0;
+        dy = y1 - y0;
+    }
+
+    float at(float x, float y) const { return sign * (dx * (y - py) - dy * (x - px)); }
+
+    // Gradient of at() is (-sign * dy, sign * dx); with y down, left edges have the inside to the right (+x)
+    // and top edges have it below (+y)
+    void orient(float orientation)
+    {
+        sign *= orientation;
+        const float gradientX = -sign * dy;
+        const float gradientY = sign * dx;
+        topLeft = gradientX > 0.0f || (gradientX == 0.0f && gradientY > 0.0f);
+    }
+};
+
+struct EdgeLanes {
+    F4 px, py, dx, dy, sign;
+    int onEdgeMask;                         // 0xf for top-left edges
+
+    explicit EdgeLanes(const Edge &edge)
+        : px(splat(edge.px)), py(splat(edge.py)), dx(splat(edge.dx)), dy(splat(edge.dy)), sign(splat(edge.sign)),
+          onEdgeMask(edge.topLeft ? 0xf : 0)
+    {
+    }
+
+    // Same operations in the same order as Edge::at(), lane by lane
+    F4 at(F4 x, F4 y) const { return sign * (dx * (y - py) - dy * (x - px)); }
+    int inside(F4 value, F4 zero) const { return greater(value, zero) | (equal(value, zero) & onEdgeMask); }
+};
+
+inline float snap(float value)
+{
+    return std::floor(value * SubpixelSteps + 0.5f) * (1.0f / SubpixelSteps);
+}
+
+inline float clampUnit(float value)
+{
+    return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+inline quint32 packPixel(const float rgba[4])
+{
+    return 0xff000000u | (quint32(clampUnit(rgba[0]) * 255.0f + 0.5f) << 16)
+           | (quint32(clampUnit(rgba[1]) * 255.0f + 0.5f) << 8) | quint32(clampUnit(rgba[2]) * 255.0f + 0.5f);
+}
+
+float planeDistance(quint32 plane, const float clip[4])
+{
+    switch (plane) {
+    case OutNear:
+        return clip[2] + clip[3];
+    case GuardLeft:
+        return GuardBand * clip[3] + clip[0];
+    case GuardRight:
+        return GuardBand * clip[3] - clip[0];
+    case GuardBottom:
+        return GuardBand * clip[3] + clip[1];
+    default:
+        return GuardBand * clip[3] - clip[1];
+    }
+}
+
+} // namespace
+
+// ------------------- Soft Texture -------------------
+
+bool SoftTexture::setImage(const QImage &image, bool mipmaps)
+{
+    levels.clear();
+    if (image.isNull()) {
+        qWarning() << "SoftTexture: null image";
+        return false;
+    }
+
+    const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+    Level base;
+    base.width = argb.width();
+    base.height = argb.height();
+    base.texels.resize(qsizetype(base.width) * base.height);
+    for (int y = 0; y < base.height; ++y) {
+        const quint32 *row = reinterpret_cast<const quint32 *>(argb.constScanLine(base.height - 1 - y));
+        std::copy(row, row + base.width, base.texels.data() + qsizetype(y) * base.width);
+    }
+    levels.append(base);
+
+    // Box filter; odd sizes reuse their last row / column
+    while (mipmaps && (levels.last().width > 1 || levels.last().height > 1)) {
+        const Level &source = levels.last();
+        Level level;
+        level.width = qMax(1, source.width / 2);
+        level.height = qMax(1, source.height / 2);
+        level.texels.resize(qsizetype(level.width) * level.height);
+        for (int y = 0; y < level.height; ++y) {
+            const quint32 *row0 = source.texels.constData() + qsizetype(qMin(2 * y, source.height - 1)) * source.width;
+            const quint32 *row1 = source.texels.constData()
+                                  + qsizetype(qMin(2 * y + 1, source.height - 1)) * source.width;
+            for (int x = 0; x < level.width; ++x) {
+                const int x0 = qMin(2 * x, source.width - 1);
+                const int x1 = qMin(2 * x + 1, source.width - 1);
+                const quint32 texels[4] = { row0[x0], row0[x1], row1[x0], row1[x1] };
+                quint32 texel = 0;
+                for (int shift = 0; shift < 32; shift += 8) {
+                    quint32 sum = 2;
+                    for (quint32 t : texels) {
+                        sum += (t >> shift) & 0xff;
+                    }
+                    texel |= (sum / 4) << shift;
+                }
+                level.texels[qsizetype(y) * level.width + x] = texel;
+            }
+        }
+        levels.append(level);
+    }
+    return true;
+}
+
+qint64 SoftTexture::memoryBytes() const
+{
+    qint64 bytes = 0;
+    for (const Level &level : levels) {
+        bytes += level.texels.size() * qint64(sizeof(quint32));
+    }
+    return bytes;
+}
+
+void SoftTexture::sampleLevel(const Level &level, float u, float v, float rgba[4]) const
+{
+    // Wrap to [0, 1) first: the texel coordinates then stay in [-0.5, size - 0.5)
+    const float s = (u - std::floor(u)) * float(level.width) - 0.5f;
+    const float t = (v - std::floor(v)) * float(level.height) - 0.5f;
+    const float sFloor = std::floor(s);
+    const float tFloor = std::floor(t);
+    const float fx = s - sFloor;
+    const float fy = t - tFloor;
+    int x0 = int(sFloor);
+    int y0 = int(tFloor);
+    int x1 = x0 + 1;
+    int y1 = y0 + 1;
+    if (x0 < 0) {
+        x0 = level.width - 1;
+    }
+    if (x1 >= level.width) {
+        x1 = 0;
+    }
+    if (y0 < 0) {
+        y0 = level.height - 1;
+    }
+    if (y1 >= level.height) {
+        y1 = 0;
+    }
+
+    const quint32 *texels = level.texels.constData();
+    const quint32 t00 = texels[qsizetype(y0) * level.width + x0];
+    const quint32 t10 = texels[qsizetype(y0) * level.width + x1];
+    const quint32 t01 = texels[qsizetype(y1) * level.width + x0];
+    const quint32 t11 = texels[qsizetype(y1) * level.width + x1];
+    const float w00 = (1.0f - fx) * (1.0f - fy);
+    const float w10 = fx * (1.0f - fy);
+    const float w01 = (1.0f - fx) * fy;
+    const float w11 = fx * fy;
+    // 0xAARRGGBB to red, green, blue, alpha
+    static constexpr int Shifts[4] = { 16, 8, 0, 24 };
+    for (int c = 0; c < 4; ++c) {
+        const int shift = Shifts[c];
+        rgba[c] = (w00 * float((t00 >> shift) & 0xff) + w10 * float((t10 >> shift) & 0xff)
+                   + w01 * float((t01 >> shift) & 0xff) + w11 * float((t11 >> shift) & 0xff))
+                  * (1.0f / 255.0f);
+    }
+}
+
+void SoftTexture::sample(float u, float v, float lod, float rgba[4]) const
+{
+    if (levels.isEmpty()) {
+        rgba[0] = rgba[1] = rgba[2] = rgba[3] = 1.0f;
+        return;
+    }
+    // GL_LINEAR_MIPMAP_LINEAR, as the stages set up their textures
+    const int last = levels.size() - 1;
+    if (!(lod > 0.0f)) {
+        sampleLevel(levels.first(), u, v, rgba);
+        return;
+    }
+    if (lod >= float(last)) {
+        sampleLevel(levels[last], u, v, rgba);
+        return;
+    }
+    const int level = int(lod);
+    const float blend = lod - float(level);
+    float next[4];
+    sampleLevel(levels[level], u, v, rgba);
+    sampleLevel(levels[level + 1], u, v, next);
+    for (int c = 0; c < 4; ++c) {
+        rgba[c] += (next[c] - rgba[c]) * blend;
+    }
+}
+
+// ------------------- Tile Queue -------------------
+
+/**
+ * Each thread owns a run of tiles [begin, end), packed into one 64-bit atomic: the owner takes tiles from the
+ * front, a thread whose run is empty takes the back half of the longest run. Runs only shrink or move to
+ * tiles nobody has taken, so a compare-and-swap cannot succeed on a stale value.
+ */
+class SoftRasterizer::TileQueue
+{
+public:
+    TileQueue(int tiles, int threadCount) : runs(new std::atomic<quint64>[size_t(threadCount)]), count(threadCount)
+    {
+        for (int i = 0; i < threadCount; ++i) {
+            runs[size_t(i)].store(pack(quint32(qint64(tiles) * i / threadCount),
+                                       quint32(qint64(tiles) * (i + 1) / threadCount)));
+        }
+    }
+
+    int next(int thread, int *steals)
+    {
+        std::atomic<quint64> &own = runs[size_t(thread)];
+        quint64 run = own.load();
+        while (first(run) < last(run)) {
+            if (own.compare_exchange_weak(run, pack(first(run) + 1, last(run)))) {
+                return int(first(run));
+            }
+        }
+
+        for (;;) {
+            int victim = -1;
+            quint32 longest = 0;
+            for (int i = 0; i < count; ++i) {
+                const quint64 other = runs[size_t(i)].load();
+                if (first(other) < last(other) && last(other) - first(other) > longest) {
+                    longest = last(other) - first(other);
+                    victim = i;
+                }
+            }
+            if (victim < 0) {
+                return -1;
+            }
+            quint64 other = runs[size_t(victim)].load();
+            if (first(other) >= last(other)) {
+                continue;
+            }
+            const quint32 middle = last(other) - (last(other) - first(other) + 1) / 2;
+            if (!runs[size_t(victim)].compare_exchange_strong(other, pack(first(other), middle))) {
+                continue;
+            }
+            // [middle, end) is ours now: run the first tile, queue the rest where others can steal them back
+            own.store(pack(middle + 1, last(other)));
+            ++*steals;
+            return int(middle);
+        }
+    }
+
+private:
+    static quint64 pack(quint32 begin, quint32 end) { return (quint64(begin) << 32) | end; }
+    static quint32 first(quint64 run) { return quint32(run >> 32); }
+    static quint32 last(quint64 run) { return quint32(run); }
+
+    std::unique_ptr<std::atomic<quint64>[]> runs;
+    int count = 0;
+};
+
+// ------------------- Software Rasterizer -------------------
+
+SoftRasterizer::SoftRasterizer(const Params &params) : parameters(params)
+{
+    parameters.tileSize = qBound(8, parameters.tileSize & ~1, 1024);
+    threads = parameters.workerThreads > 0 ? parameters.workerThreads : QThread::idealThreadCount();
+    threads = qMax(1, threads);
+    workers.setMaxThreadCount(qMax(1, threads - 1));
+}
+
+SoftRasterizer::~SoftRasterizer()
+{
+    workers.waitForDone();
+}
+
+void SoftRasterizer::parallelFor(int begin, int end, int grain, const std::function<void(int, int)> &work)
+{
+    const int items = (end - begin + grain - 1) / grain;
+    if (threads <= 1 || items <= 1) {
+        if (end > begin) {
+            work(begin, end);
+        }
+        return;
+    }
+
+    std::atomic<int> next{ 0 };
+    const auto run = [&]() {
+        for (int item = next.fetch_add(1); item < items; item = next.fetch_add(1)) {
+            const int first = begin + item * grain;
+            work(first, qMin(end, first + grain));
+        }
+    };
+    QSemaphore finished;
+    const int helpers = qMin(threads - 1, items - 1);
+    for (int i = 0; i < helpers; ++i) {
+        workers.start([&run, &finished]() {
+            run();
+            finished.release();
+        });
+    }
+    run();
+    finished.acquire(helpers);
+}
+
+void SoftRasterizer::beginFrame(const QSize &size, const QColor &clearColor)
+{
+    const int tile = parameters.tileSize;
+    frameSize = size.expandedTo(QSize(1, 1));
+    tilesX = (frameSize.width() + tile - 1) / tile;
+    tilesY = (frameSize.height() + tile - 1) / tile;
+    paddedWidth = tilesX * tile;
+    paddedHeight = tilesY * tile;
+    // Tiles clear their own pixels in endFrame(), on the thread that then draws them
+    colorBuffer.resize(qsizetype(paddedWidth) * paddedHeight);
+    depthBuffer.resize(qsizetype(paddedWidth) * paddedHeight);
+    clearPixel = 0xff000000u | clearColor.rgb();
+    frame = QImage();
+
+    drawCount = 0;
+    chunkCount = 0;
+    frameStats = FrameStats();
+    frameStats.tiles = tilesX * tilesY;
+    frameOpen = true;
+}
+
+bool SoftRasterizer::draw(const DrawCall &call)
+{
+    PERFTRACE_SCOPE("SoftRasterizer::draw");
+    if (!frameOpen) {
+        qWarning() << "SoftRasterizer: draw() outside beginFrame() / endFrame()";
+        return false;
+    }
+    if (!call.vertices || call.vertexCount <= 0 || call.stride < 3 || call.indexCount % 3 != 0
+        || (call.colorOffset >= 0 && (call.colorComponents < 3 || call.colorComponents > 4
+                                      || call.colorOffset + call.colorComponents > call.stride))
+        || (call.uvOffset >= 0 && call.uvOffset + 2 > call.stride) || (call.texture && call.uvOffset < 0)
+        || (!call.indices && call.indexCount > call.vertexCount)) {
+        qWarning() << "SoftRasterizer: invalid draw call";
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (drawCount == draws.size()) {
+        draws.resize(drawCount + 1);
+    }
+    DrawState &state = draws[drawCount];
+    state.texture = call.texture && !call.texture->isNull() ? call.texture : nullptr;
+    state.depthTest = call.depthTest;
+    state.depthWrite = call.depthWrite;
+    state.vertices.resize(call.vertexCount);
+
+    Vertex *vertices = state.vertices.data();
+    const QSize size = frameSize;
+    parallelFor(0, call.vertexCount, VertexGrain, [&call, size, vertices](int first, int last) {
+        PERFTRACE_SCOPE("transform vertices");
+        transformRange(call, size, vertices, first, last);
+    });
+
+    const int triangles = call.indexCount / 3;
+    const int newChunks = (triangles + ChunkTriangles - 1) / ChunkTriangles;
+    if (chunks.size() < chunkCount + newChunks) {
+        chunks.resize(chunkCount + newChunks);
+    }
+    Chunk *chunkData = chunks.data() + chunkCount;
+    const int drawIndex = drawCount;
+    parallelFor(0, newChunks, 1, [&](int first, int last) {
+        PERFTRACE_SCOPE("bin triangles");
+        for (int c = first; c < last; ++c) {
+            binRange(call, drawIndex, chunkData + c, c * ChunkTriangles, qMin(triangles, (c + 1) * ChunkTriangles));
+        }
+    });
+
+    frameStats.trianglesSubmitted += triangles;
+    for (int c = 0; c < newChunks; ++c) {
+        const Chunk &chunk = chunkData[c];
+        frameStats.trianglesClipped += chunk.clipped;
+        frameStats.trianglesCulled += chunk.culled;
+        frameStats.trianglesBinned += chunk.triangles.size();
+        frameStats.binEntries += chunk.bins.size();
+    }
+    chunkCount += newChunks;
+    ++drawCount;
+    frameStats.drawMilliseconds += timer.nsecsElapsed() / 1.0e6;
+    return true;
+}
+
+void SoftRasterizer::transformRange(const DrawCall &call, const QSize &size, Vertex *out, int begin, int end)
+{
+    const float *m = call.mvp.constData();  // Column-major
+    for (int i = begin; i < end; ++i) {
+        const float *source = call.vertices + qsizetype(i) * call.stride;
+        Vertex &vertex = out[i];
+        for (int row = 0; row < 4; ++row) {
+            vertex.clip[row] = m[row] * source[0] + m[4 + row] * source[1] + m[8 + row] * source[2] + m[12 + row];
+        }
+
+        float *attributes = vertex.attributes;
+        if (call.colorOffset >= 0) {
+            const float *color = source + call.colorOffset;
+            attributes[0] = color[0];
+            attributes[1] = color[1];
+            attributes[2] = color[2];
+            attributes[3] = call.colorComponents == 4 ? color[3] : 1.0f;
+        } else {
+            attributes[0] = call.constantColor.x();
+            attributes[1] = call.constantColor.y();
+            attributes[2] = call.constantColor.z();
+            attributes[3] = call.constantColor.w();
+        }
+        attributes[4] = call.uvOffset >= 0 ? source[call.uvOffset] : 0.0f;
+        attributes[5] = call.uvOffset >= 0 ? source[call.uvOffset + 1] : 0.0f;
+
+        const float x = vertex.clip[0];
+        const float y = vertex.clip[1];
+        const float z = vertex.clip[2];
+        const float w = vertex.clip[3];
+        quint32 code = 0;
+        code |= x < -w ? OutLeft : 0;
+        code |= x > w ? OutRight : 0;
+        code |= y < -w ? OutBottom : 0;
+        code |= y > w ? OutTop : 0;
+        code |= (z < -w || w <= 0.0f) ? OutNear : 0;
+        code |= z > w ? OutFar : 0;
+        code |= x < -GuardBand * w ? GuardLeft : 0;
+        code |= x > GuardBand * w ? GuardRight : 0;
+        code |= y < -GuardBand * w ? GuardBottom : 0;
+        code |= y > GuardBand * w ? GuardTop : 0;
+        vertex.outcode = code;
+
+        // Vertices behind the eye only occur in triangles that are clipped, which computes their own
+        if (w > 0.0f) {
+            vertex.invW = 1.0f / w;
+            vertex.x = snap((x * vertex.invW * 0.5f + 0.5f) * float(size.width()));
+            vertex.y = snap((0.5f - y * vertex.invW * 0.5f) * float(size.height()));
+            vertex.z = z * vertex.invW * 0.5f + 0.5f;
+        }
+    }
+}
+
+int SoftRasterizer::clipTriangle(const Vertex *const input[3], quint32 planes, const QSize &size, Chunk *chunk)
+{
+    // Sutherland-Hodgman in clip space; each plane adds at most one vertex
+    Vertex polygons[2][8];
+    int count = 3;
+    for (int i = 0; i < 3; ++i) {
+        polygons[0][i] = *input[i];
+    }
+    int current = 0;
+    for (quint32 plane : { OutNear, GuardLeft, GuardRight, GuardBottom, GuardTop }) {
+        if (!(planes & plane)) {
+            continue;
+        }
+        const Vertex *in = polygons[current];
+        Vertex *out = polygons[current ^ 1];
+        int outCount = 0;
+        for (int i = 0; i < count; ++i) {
+            const Vertex &a = in[i];
+            const Vertex &b = in[(i + 1) % count];
+            const float da = planeDistance(plane, a.clip);
+            const float db = planeDistance(plane, b.clip);
+            if (da >= 0.0f) {
+                out[outCount++] = a;
+            }
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                const float t = da / (da - db);
+                Vertex &v = out[outCount++];
+                for (int k = 0; k < 4; ++k) {
+                    v.clip[k] = a.clip[k] + (b.clip[k] - a.clip[k]) * t;
+                }
+                for (int k = 0; k < AttributeCount; ++k) {
+                    v.attributes[k] = a.attributes[k] + (b.attributes[k] - a.attributes[k]) * t;
+                }
+            }
+        }
+        count = outCount;
+        current ^= 1;
+        if (count < 3) {
+            return 0;
+        }
+    }
+
+    const int first = chunk->clippedVertices.size();
+    for (int i = 0; i < count; ++i) {
+        Vertex v = polygons[current][i];
+        const float w = v.clip[3];
+        if (!(w > 1.0e-6f)) {
+            chunk->clippedVertices.resize(first);
+            return 0;
+        }
+        v.invW = 1.0f / w;
+        v.x = snap((v.clip[0] * v.invW * 0.5f + 0.5f) * float(size.width()));
+        v.y = snap((0.5f - v.clip[1] * v.invW * 0.5f) * float(size.height()));
+        v.z = v.clip[2] * v.invW * 0.5f + 0.5f;
+        v.outcode = 0;
+        chunk->clippedVertices.append(v);
+    }
+    return count;
+}
+
+void SoftRasterizer::binRange(const DrawCall &call, int drawIndex, Chunk *chunk, int begin, int end) const
+{
+    const Vertex *vertices = draws.at(drawIndex).vertices.constData();
+    const int tile = parameters.tileSize;
+    const int tiles = tilesX * tilesY;
+    chunk->draw = drawIndex;
+    chunk->triangles.resize(0);
+    chunk->clippedVertices.resize(0);
+    chunk->culled = 0;
+    chunk->clipped = 0;
+    chunk->binStarts.fill(0, tiles + 1);
+    quint32 *binStarts = chunk->binStarts.data();
+
+    const auto vertexAt = [chunk, vertices](quint32 index) {
+        return index & ClippedVertex ? chunk->clippedVertices.constData() + (index & ~ClippedVertex)
+                                     : vertices + index;
+    };
+
+    const auto add = [&](quint32 i0, quint32 i1, quint32 i2) {
+        const Vertex *a = vertexAt(i0);
+        const Vertex *b = vertexAt(i1);
+        const Vertex *c = vertexAt(i2);
+        // Counter-clockwise (front) in GL's y-up window space is negative here, with y down
+        const float area = (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+        if (area == 0.0f || (call.cullBackFaces && area > 0.0f)) {
+            ++chunk->culled;
+            return;
+        }
+        const int x0 = qMax(0, int(std::floor(qMin(a->x, qMin(b->x, c->x)))));
+        const int y0 = qMax(0, int(std::floor(qMin(a->y, qMin(b->y, c->y)))));
+        const int x1 = qMin(frameSize.width() - 1, int(std::ceil(qMax(a->x, qMax(b->x, c->x)))));
+        const int y1 = qMin(frameSize.height() - 1, int(std::ceil(qMax(a->y, qMax(b->y, c->y)))));
+        if (x0 > x1 || y0 > y1) {
+            ++chunk->culled;
+            return;
+        }
+        Triangle triangle;
+        triangle.vertices[0] = i0;
+        triangle.vertices[1] = i1;
+        triangle.vertices[2] = i2;
+        triangle.tileX0 = quint16(x0 / tile);
+        triangle.tileY0 = quint16(y0 / tile);
+        triangle.tileX1 = quint16(x1 / tile);
+        triangle.tileY1 = quint16(y1 / tile);
+        for (int ty = triangle.tileY0; ty <= triangle.tileY1; ++ty) {
+            for (int tx = triangle.tileX0; tx <= triangle.tileX1; ++tx) {
+                ++binStarts[ty * tilesX + tx + 1];
+            }
+        }
+        chunk->triangles.append(triangle);
+    };
+
+    for (int t = begin; t < end; ++t) {
+        quint32 index[3];
+        for (int k = 0; k < 3; ++k) {
+            index[k] = call.indices ? call.indices[qsizetype(t) * 3 + k] : quint32(t * 3 + k);
+        }
+        if (index[0] >= quint32(call.vertexCount) || index[1] >= quint32(call.vertexCount)
+            || index[2] >= quint32(call.vertexCount)) {
+            ++chunk->culled;
+            continue;
+        }
+        const Vertex *corners[3] = { vertices + index[0], vertices + index[1], vertices + index[2] };
+        if (corners[0]->outcode & corners[1]->outcode & corners[2]->outcode & OutsideBits) {
+            ++chunk->culled;
+            continue;
+        }
+        const quint32 planes = (corners[0]->outcode | corners[1]->outcode | corners[2]->outcode) & ClipBits;
+        if (!planes) {
+            add(index[0], index[1], index[2]);
+            continue;
+        }
+        ++chunk->clipped;
+        const quint32 first = quint32(chunk->clippedVertices.size());
+        const int count = clipTriangle(corners, planes, frameSize, chunk);
+        for (int k = 1; k + 1 < count; ++k) {
+            add(ClippedVertex | first, ClippedVertex | (first + k), ClippedVertex | (first + k + 1));
+        }
+    }
+
+    // Counts to starts, then place each triangle and shift the starts back
+    for (int i = 0; i < tiles; ++i) {
+        binStarts[i + 1] += binStarts[i];
+    }
+    chunk->bins.resize(binStarts[tiles]);
+    quint32 *bins = chunk->bins.data();
+    const Triangle *triangles = chunk->triangles.constData();
+    for (int i = 0; i < chunk->triangles.size(); ++i) {
+        const Triangle &triangle = triangles[i];
+        for (int ty = triangle.tileY0; ty <= triangle.tileY1; ++ty) {
+            for (int tx = triangle.tileX0; tx <= triangle.tileX1; ++tx) {
+                bins[binStarts[ty * tilesX + tx]++] = quint32(i);
+            }
+        }
+    }
+    for (int i = tiles; i > 0; --i) {
+        binStarts[i] = binStarts[i - 1];
+    }
+    binStarts[0] = 0;
+}
+
+const QImage &SoftRasterizer::endFrame()
+{
+    PERFTRACE_SCOPE("SoftRasterizer::endFrame");
+    if (!frameOpen) {
+        qWarning() << "SoftRasterizer: endFrame() without beginFrame()";
+        return frame;
+    }
+    QElapsedTimer timer;
+    timer.start();
+
+    const int tiles = tilesX * tilesY;
+    const int helpers = qMin(threads - 1, tiles - 1);
+    TileQueue queue(tiles, helpers + 1);
+    std::atomic<qint64> quads{ 0 };
+    std::atomic<int> steals{ 0 };
+    const auto run = [&](int thread) {
+        PERFTRACE_SCOPE("rasterize tiles");
+        qint64 threadQuads = 0;
+        int threadSteals = 0;
+        for (int tile = queue.next(thread, &threadSteals); tile >= 0; tile = queue.next(thread, &threadSteals)) {
+            rasterizeTile(tile, &threadQuads);
+        }
+        quads.fetch_add(threadQuads, std::memory_order_relaxed);
+        steals.fetch_add(threadSteals, std::memory_order_relaxed);
+    };
+    QSemaphore finished;
+    for (int i = 0; i < helpers; ++i) {
+        workers.start([&run, &finished, i]() {
+            run(i + 1);
+            finished.release();
+        });
+    }
+    run(0);
+    finished.acquire(helpers);
+
+    frame = QImage(reinterpret_cast<const uchar *>(colorBuffer.constData()), frameSize.width(), frameSize.height(),
+                   qsizetype(paddedWidth) * 4, QImage::Format_RGB32);
+    frameOpen = false;
+    frameStats.quadsShaded = quads.load();
+    frameStats.steals = steals.load();
+    frameStats.rasterMilliseconds = timer.nsecsElapsed() / 1.0e6;
+    return frame;
+}
+
+void SoftRasterizer::rasterizeTile(int tile, qint64 *quads)
+{
+    const int size = parameters.tileSize;
+    const int tileX = (tile % tilesX) * size;
+    const int tileY = (tile / tilesX) * size;
+
+    // Color rows are row-major; depth keeps each 2x2 quad contiguous, so a tile's quads are size / 2 runs
+    for (int y = tileY; y < tileY + size; ++y) {
+        quint32 *row = colorBuffer.data() + qsizetype(y) * paddedWidth + tileX;
+        std::fill(row, row + size, clearPixel);
+    }
+    for (int y = tileY; y < tileY + size; y += 2) {
+        float *depth = depthBuffer.data() + (qsizetype(y / 2) * (paddedWidth / 2) + tileX / 2) * 4;
+        std::fill(depth, depth + size * 2, 1.0f);
+    }
+
+    for (int c = 0; c < chunkCount; ++c) {
+        const Chunk &chunk = chunks.at(c);
+        const quint32 first = chunk.binStarts[tile];
+        const quint32 last = chunk.binStarts[tile + 1];
+        if (first == last) {
+            continue;
+        }
+        const DrawState &state = draws.at(chunk.draw);
+        const Vertex *vertices = state.vertices.constData();
+        const Vertex *clippedVertices = chunk.clippedVertices.constData();
+        const Triangle *triangles = chunk.triangles.constData();
+        const quint32 *bins = chunk.bins.constData();
+        for (quint32 i = first; i < last; ++i) {
+            const Triangle &triangle = triangles[bins[i]];
+            const Vertex *v[3];
+            for (int k = 0; k < 3; ++k) {
+                const quint32 index = triangle.vertices[k];
+                v[k] = index & ClippedVertex ? clippedVertices + (index & ~ClippedVertex) : vertices + index;
+            }
+            rasterizeTriangle(state, v, tileX, tileY, quads);
+        }
+    }
+}
+
+void SoftRasterizer::rasterizeTriangle(const DrawState &state, const Vertex *const v[3], int tileX, int tileY,
+                                       qint64 *quads)
+{
+    // Edge k is opposite vertex k, so its value over the doubled area is vertex k's barycentric weight
+    Edge edges[3];
+    edges[0].setup(v[1]->x, v[1]->y, v[2]->x, v[2]->y);
+    edges[1].setup(v[2]->x, v[2]->y, v[0]->x, v[0]->y);
+    edges[2].setup(v[0]->x, v[0]->y, v[1]->x, v[1]->y);
+    float area = edges[0].at(v[0]->x, v[0]->y);
+    if (area == 0.0f) {
+        return;
+    }
+    const float orientation = area < 0.0f ? -1.0f : 1.0f;
+    area *= orientation;
+    for (Edge &edge : edges) {
+        edge.orient(orientation);
+    }
+
+    const float minX = qMin(v[0]->x, qMin(v[1]->x, v[2]->x));
+    const float minY = qMin(v[0]->y, qMin(v[1]->y, v[2]->y));
+    const float maxX = qMax(v[0]->x, qMax(v[1]->x, v[2]->x));
+    const float maxY = qMax(v[0]->y, qMax(v[1]->y, v[2]->y));
+    const int size = parameters.tileSize;
+    const int xBegin = qMax(tileX, int(std::floor(minX))) & ~1;
+    const int yBegin = qMax(tileY, int(std::floor(minY))) & ~1;
+    const int xEnd = qMin(qMin(tileX + size, frameSize.width()), int(std::ceil(maxX)) + 1);
+    const int yEnd = qMin(qMin(tileY + size, frameSize.height()), int(std::ceil(maxY)) + 1);
+    if (xBegin >= xEnd || yBegin >= yEnd) {
+        return;
+    }
+
+    const EdgeLanes e0(edges[0]);
+    const EdgeLanes e1(edges[1]);
+    const EdgeLanes e2(edges[2]);
+    const F4 zero = splat(0.0f);
+    const F4 one = splat(1.0f);
+    const F4 inverseArea = splat(1.0f / area);
+    const F4 quadX = lanes(0.5f, 1.5f, 0.5f, 1.5f);
+    const F4 quadY = lanes(0.5f, 0.5f, 1.5f, 1.5f);
+    const F4 z0 = splat(v[0]->z);
+    const F4 z1 = splat(v[1]->z);
+    const F4 z2 = splat(v[2]->z);
+    const F4 w0 = splat(v[0]->invW);
+    const F4 w1 = splat(v[1]->invW);
+    const F4 w2 = splat(v[2]->invW);
+
+    // Attributes divided by w interpolate linearly in screen space; dividing by the interpolated 1 / w
+    // makes them perspective-correct. Without a texture, u and v are not needed.
+    const SoftTexture *texture = state.texture;
+    const int attributeCount = texture ? AttributeCount : 4;
+    F4 q[3][AttributeCount];
+    for (int k = 0; k < 3; ++k) {
+        for (int a = 0; a < attributeCount; ++a) {
+            q[k][a] = splat(v[k]->attributes[a] * v[k]->invW);
+        }
+    }
+
+    qint64 shaded = 0;
+    for (int y = yBegin; y < yEnd; y += 2) {
+        const F4 py = splat(float(y)) + quadY;
+        quint32 *row = colorBuffer.data() + qsizetype(y) * paddedWidth;
+        float *depthRow = depthBuffer.data() + qsizetype(y / 2) * (paddedWidth / 2) * 4;
+        for (int x = xBegin; x < xEnd; x += 2) {
+            const F4 px = splat(float(x)) + quadX;
+            const F4 b0 = e0.at(px, py);
+            const F4 b1 = e1.at(px, py);
+            const F4 b2 = e2.at(px, py);
+            int mask = e0.inside(b0, zero) & e1.inside(b1, zero) & e2.inside(b2, zero);
+            if (!mask) {
+                continue;
+            }
+
+            const F4 l0 = b0 * inverseArea;
+            const F4 l1 = b1 * inverseArea;
+            const F4 l2 = b2 * inverseArea;
+            const F4 z = l0 * z0 + l1 * z1 + l2 * z2;
+            float *depth = depthRow + (x / 2) * 4;
+            if (state.depthTest) {
+                mask &= less(z, load(depth));
+            }
+            mask &= lessEqual(z, one);              // Beyond the far plane, which is not clipped
+            if (!mask) {
+                continue;
+            }
+            ++shaded;
+
+            const F4 w = one / (l0 * w0 + l1 * w1 + l2 * w2);
+            float attributes[AttributeCount][4];
+            for (int a = 0; a < attributeCount; ++a) {
+                store(attributes[a], (l0 * q[0][a] + l1 * q[1][a] + l2 * q[2][a]) * w);
+            }
+            float depths[4];
+            store(depths, z);
+
+            // Level of detail from the quad's u / v differences, helper lanes included
+            float lod = 0.0f;
+            if (texture) {
+                const float *u = attributes[4];
+                const float *t = attributes[5];
+                const float width = float(texture->width());
+                const float height = float(texture->height());
+                const float dudx = (u[1] - u[0]) * width;
+                const float dvdx = (t[1] - t[0]) * height;
+                const float dudy = (u[2] - u[0]) * width;
+                const float dvdy = (t[2] - t[0]) * height;
+                const float rho = qMax(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+                lod = rho > 0.0f ? 0.5f * std::log2(rho) : 0.0f;
+            }
+
+            for (int lane = 0; lane < 4; ++lane) {
+                if (!(mask & (1 << lane))) {
+                    continue;
+                }
+                float rgba[4] = { attributes[0][lane], attributes[1][lane], attributes[2][lane],
+                                  attributes[3][lane] };
+                if (texture) {
+                    float texel[4];
+                    texture->sample(attributes[4][lane], attributes[5][lane], lod, texel);
+                    for (int c = 0; c < 4; ++c) {
+                        rgba[c] *= texel[c];
+                    }
+                }
+                row[qsizetype(lane >> 1) * paddedWidth + x + (lane & 1)] = packPixel(rgba);
+                if (state.depthWrite) {
+                    depth[lane] = depths[lane];
+                }
+            }
+        }
+    }
+    *quads += shaded;
+}
+
+qint64 SoftRasterizer::memoryBytes() const
+{
+    qint64 bytes = colorBuffer.capacity() * qint64(sizeof(quint32)) + depthBuffer.capacity() * qint64(sizeof(float));
+    for (const DrawState &state : draws) {
+        bytes += state.vertices.capacity() * qint64(sizeof(Vertex));
+    }
+    for (const Chunk &chunk : chunks) {
+        bytes += chunk.triangles.capacity() * qint64(sizeof(Triangle))
+                 + chunk.clippedVertices.capacity() * qint64(sizeof(Vertex))
+                 + (chunk.binStarts.capacity() + chunk.bins.capacity()) * qint64(sizeof(quint32));
+    }
+    return bytes;
+}
@@ -0,0 +1,209 @@
+#ifndef SOFTRASTERIZER_H
+#define SOFTRASTERIZER_H
+
+#include <QColor>
+#include <QImage>
+#include <QMatrix4x4>
+#include <QThreadPool>
+#include <QVector>
+#include <QVector4D>
+#include <functional>
+
+// ------------------- Software Rasterizer -------------------
+//
+// A CPU renderer for hosts without a GPU, drawing the same scenes as the
+// stages: indexed triangles with per-vertex color, one texture per draw and a
+// depth test, into a QImage.
+//
+//   SoftRasterizer rasterizer;
+//   rasterizer.beginFrame(QSize(800, 600), QColor(230, 230, 230));
+//   rasterizer.draw(call);                      // as many as needed
+//   const QImage &frame = rasterizer.endFrame();
+//
+// draw() transforms, clips and bins right away, spread over the worker
+// threads: triangles land in the bins of the screen tiles (64 x 64 pixels by
+// default) their bounds touch. endFrame() then rasterizes the tiles, each one
+// start to finish (clear, every triangle of its bin in submission order) by a
+// single thread, so tiles need no locks and stay in cache. Threads start on
+// contiguous runs of tiles and steal half of another thread's remaining run
+// when theirs is done.
+//
+// Pixels are processed as 2x2 quads, one per SSE2 register (scalar fallback
+// elsewhere): edge functions, depth and perspective-correct attributes for
+// four pixels at once, texture LOD from the differences inside the quad, as
+// GPUs do. Vertices are snapped to 1/16 pixel and every edge is evaluated in
+// one canonical direction, so triangles sharing an edge cover each pixel on it
+// exactly once (top-left rule).
+//
+// Conventions follow OpenGL: clip space in, counter-clockwise front faces,
+// depth test GL_LESS, z in [0, 1] after the viewport transform, v = 0 at the
+// bottom of a texture. No blending: fragments are opaque.
+
+/**
+ * @brief An RGBA texture with its mip chain, sampled trilinearly with GL_REPEAT wrapping.
+ */
+class SoftTexture
+{
+public:
+    /**
+     * @brief Copies @p image (flipped so that v = 0 is its bottom row) and box-filters the mip chain.
+     */
+    bool setImage(const QImage &image, bool mipmaps = true);
+    void clear() { levels.clear(); }
+
+    bool isNull() const { return levels.isEmpty(); }
+    int width() const { return levels.isEmpty() ? 0 : levels.first().width; }
+    int height() const { return levels.isEmpty() ? 0 : levels.first().height; }
+    int levelCount() const { return levels.size(); }
+    qint64 memoryBytes() const;
+
+    /**
+     * @brief Texel at (@p u, @p v), blending the two mip levels around @p lod (log2 of texels per pixel).
+     * @param rgba Receives red, green, blue and alpha in [0, 1].
+     */
+    void sample(float u, float v, float lod, float rgba[4]) const;
+
+private:
+    struct Level {
+        int width = 0;
+        int height = 0;
+        QVector<quint32> texels;            // 0xAARRGGBB, bottom row first
+    };
+
+    void sampleLevel(const Level &level, float u, float v, float rgba[4]) const;
+
+    QVector<Level> levels;
+};
+
+/**
+ * @brief Tile-based binned rasterizer; see the comment at the top of softrasterizer.h.
+ */
+class SoftRasterizer
+{
+public:
+    struct Params {
+        int workerThreads = 0;              // Including the caller; 0 = QThread::idealThreadCount()
+        int tileSize = 64;                  // Pixels, even
+    };
+
+    /**
+     * @brief One draw: a triangle list, its transform and fixed-function state.
+     *
+     * Vertex data is read during draw() only; the texture must stay alive until endFrame().
+     */
+    struct DrawCall {
+        const float *vertices = nullptr;
+        int vertexCount = 0;
+        int stride = 3;                     // Floats per vertex; the position is the first three
+        int colorOffset = -1;               // Floats into the vertex, -1 for none (constantColor)
+        int colorComponents = 3;            // 3 or 4
+        int uvOffset = -1;                  // Floats into the vertex, -1 for none
+        const quint32 *indices = nullptr;   // nullptr: non-indexed, like glDrawArrays()
+        int indexCount = 0;                 // Indices, or vertices when non-indexed; a multiple of 3
+        QMatrix4x4 mvp;
+        QVector4D constantColor = QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
+        const SoftTexture *texture = nullptr;   // Modulates the vertex color, needs uvOffset
+        bool cullBackFaces = false;
+        bool depthTest = true;
+        bool depthWrite = true;
+    };
+
+    struct FrameStats {
+        qint64 trianglesSubmitted = 0;
+        qint64 trianglesClipped = 0;        // Crossing the near plane or the guard band, split in place
+        qint64 trianglesCulled = 0;         // Off screen, back-facing or without area
+        qint64 trianglesBinned = 0;
+        qint64 binEntries = 0;              // Triangle-tile pairs
+        qint64 quadsShaded = 0;             // 2x2 quads with at least one pixel passing the depth test
+        int tiles = 0;
+        int steals = 0;                     // Tile runs taken over by an idle thread
+        double drawMilliseconds = 0.0;      // Transform, clipping and binning, summed over draw()
+        double rasterMilliseconds = 0.0;    // endFrame()
+    };
+
+    SoftRasterizer() : SoftRasterizer(Params()) {}
+    explicit SoftRasterizer(const Params &params);
+    ~SoftRasterizer();
+
+    SoftRasterizer(const SoftRasterizer &) = delete;
+    SoftRasterizer &operator=(const SoftRasterizer &) = delete;
+
+    /**
+     * @brief Starts a frame of @p size pixels; every pixel is cleared to @p clearColor and depth 1.
+     */
+    void beginFrame(const QSize &size, const QColor &clearColor);
+    bool draw(const DrawCall &call);
+    /**
+     * @brief Rasterizes everything drawn since beginFrame().
+     * @return The frame, a view of internal memory valid until the next beginFrame().
+     */
+    const QImage &endFrame();
+
+    const QImage &image() const { return frame; }
+    const FrameStats &stats() const { return frameStats; }
+    int threadCount() const { return threads; }
+    qint64 memoryBytes() const;
+
+private:
+    struct Vertex {
+        float clip[4];
+        float x, y, z, invW;                // Window position (y down, snapped to 1/16 pixel), depth, 1 / w
+        float attributes[6];                // Red, green, blue, alpha, u, v
+        quint32 outcode;
+    };
+
+    struct Triangle {
+        quint32 vertices[3];                // ClippedVertex set: index into the chunk's own vertices
+        quint16 tileX0, tileY0, tileX1, tileY1;
+    };
+
+    // Binning output for up to ChunkTriangles consecutive triangles of one draw, written by one thread
+    struct Chunk {
+        int draw = 0;
+        QVector<Triangle> triangles;
+        QVector<Vertex> clippedVertices;    // Made by clipping, referenced with ClippedVertex
+        QVector<quint32> binStarts;         // Per tile, plus the end: the tile's triangles in bins
+        QVector<quint32> bins;
+        qint64 culled = 0;
+        qint64 clipped = 0;
+    };
+
+    struct DrawState {
+        const SoftTexture *texture = nullptr;
+        bool depthTest = true;
+        bool depthWrite = true;
+        QVector<Vertex> vertices;
+    };
+
+    class TileQueue;
+
+    void parallelFor(int begin, int end, int grain, const std::function<void(int, int)> &work);
+    static void transformRange(const DrawCall &call, const QSize &size, Vertex *out, int begin, int end);
+    void binRange(const DrawCall &call, int drawIndex, Chunk *chunk, int begin, int end) const;
+    static int clipTriangle(const Vertex *const input[3], quint32 planes, const QSize &size, Chunk *chunk);
+    void rasterizeTile(int tile, qint64 *quads);
+    void rasterizeTriangle(const DrawState &state, const Vertex *const v[3], int tileX, int tileY, qint64 *quads);
+
+    Params parameters;
+    int threads = 1;
+    QThreadPool workers;
+
+    QSize frameSize;
+    int paddedWidth = 0;                    // Buffers are padded to whole tiles
+    int paddedHeight = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    quint32 clearPixel = 0;
+    QVector<quint32> colorBuffer;           // Row-major, 0xffRRGGBB (QImage::Format_RGB32)
+    QVector<float> depthBuffer;             // 2x2 quads stored contiguously
+    QImage frame;
+
+    bool frameOpen = false;
+    QVector<DrawState> draws;               // Both grow and are reused across frames; the first
+    int drawCount = 0;                      // drawCount / chunkCount are in use
+    QVector<Chunk> chunks;
+    int chunkCount = 0;
+    FrameStats frameStats;
+};
+
+#endif // SOFTRASTERIZER_H
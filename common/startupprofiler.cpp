@@ -0,0 +1,264 @@
+#include "startupprofiler.h"
+#include "perftrace.h"
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+// Age of the current process in milliseconds, or 0 if the platform does not tell
+static double processAgeMs()
+{
+#ifdef Q_OS_LINUX
+    // starttime (field 22 of /proc/self/stat) is in clock ticks since boot, like /proc/uptime in seconds
+    QFile stat("/proc/self/stat");
+    QFile uptime("/proc/uptime");
+    if (!stat.open(QIODevice::ReadOnly) || !uptime.open(QIODevice::ReadOnly)) {
+        return 0.0;
+    }
+    const QByteArray statLine = stat.readAll();
+    const int commEnd = statLine.lastIndexOf(')');   // The command name may contain spaces
+    if (commEnd < 0) {
+        return 0.0;
+    }
+    const QList<QByteArray> fields = statLine.mid(commEnd + 2).split(' ');   // fields[0] is field 3
+    bool ok = false;
+    const double startTicks = fields.value(19).toDouble(&ok);
+    const double uptimeSeconds = uptime.readAll().split(' ').value(0).toDouble();
+    const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    if (!ok || ticksPerSecond <= 0 || uptimeSeconds <= 0.0) {
+        return 0.0;
+    }
+    return qMax(0.0, (uptimeSeconds - startTicks / double(ticksPerSecond)) * 1000.0);
+#else
+    return 0.0;
+#endif
+}
+
+StartupProfiler::StartupProfiler()
+{
+    clock.start();
+    processAge = processAgeMs();
+}
+
+StartupProfiler &StartupProfiler::instance()
+{
+    static StartupProfiler profiler;
+    return profiler;
+}
+
+double StartupProfiler::elapsedMs() const
+{
+    return processAge + clock.nsecsElapsed() / 1.0e6;
+}
+
+// ------------------- Recording -------------------
+
+StartupProfiler::Scope::Scope(const QString &name)
+    : name(name), startMs(StartupProfiler::instance().elapsedMs())
+{
+}
+
+StartupProfiler::Scope::~Scope()
+{
+    StartupProfiler &profiler = StartupProfiler::instance();
+    Phase phase;
+    phase.name = name;
+    phase.startMs = startMs;
+    phase.endMs = profiler.elapsedMs();
+    phase.activeMs = phase.endMs - phase.startMs;
+    phase.deferred = profiler.timeToFirstFrameMs() >= 0.0;
+    profiler.addPhase(phase);
+}
+
+void StartupProfiler::mark(const QString &name)
+{
+    Phase phase;
+    phase.name = name;
+    phase.startMs = phase.endMs = elapsedMs();
+    phase.activeMs = 0.0;
+    phase.deferred = firstFrameMs >= 0.0;
+    addPhase(phase);
+}
+
+void StartupProfiler::addPhase(const Phase &phase)
+{
+    phases.append(phase);
+}
+
+void StartupProfiler::markFirstFrame()
+{
+    if (firstFrameMs < 0.0) {
+        firstFrameMs = elapsedMs();
+        if (fullyInitializedPending) {
+            fullyInitializedMs = firstFrameMs;
+        }
+    }
+}
+
+void StartupProfiler::markFullyInitialized()
+{
+    if (firstFrameMs < 0.0) {
+        fullyInitializedPending = true;
+    } else if (fullyInitializedMs < 0.0) {
+        fullyInitializedMs = elapsedMs();
+    }
+}
+
+// ------------------- Reporting -------------------
+
+QString StartupProfiler::report() const
+{
+    auto milestone = [](double ms) { return ms < 0.0 ? QString("n/a") : QString("%1 ms").arg(ms, 0, 'f', 1); };
+
+    QStringList lines;
+    lines << QString("Startup: first frame %1, fully initialized %2 (since process start, %3 ms before the clock started)")
+                 .arg(milestone(firstFrameMs), milestone(fullyInitializedMs))
+                 .arg(processAge, 0, 'f', 1);
+
+    QVector<Phase> sorted = phases;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Phase &a, const Phase &b) { return a.startMs < b.startMs; });
+    for (const Phase &phase : sorted) {
+        QString line = QString("  %1 ms  %2 ms  %3")
+                           .arg(phase.startMs, 8, 'f', 1)
+                           .arg(phase.activeMs, 7, 'f', 2)
+                           .arg(phase.name);
+        if (phase.deferred) {
+            line += phase.steps > 1 ? QString("  (deferred, %1 frames)").arg(phase.steps) : QString("  (deferred)");
+        }
+        lines << line;
+    }
+    return lines.join('\n');
+}
+
+QByteArray StartupProfiler::toJson() const
+{
+    QJsonArray list;
+    for (const Phase &phase : phases) {
+        QJsonObject entry;
+        entry.insert("name", phase.name);
+        entry.insert("startMs", phase.startMs);
+        entry.insert("endMs", phase.endMs);
+        entry.insert("activeMs", phase.activeMs);
+        entry.insert("steps", phase.steps);
+        entry.insert("deferred", phase.deferred);
+        list.append(entry);
+    }
+
+    QJsonObject root;
+    root.insert("processAgeAtClockStartMs", processAge);
+    root.insert("timeToFirstFrameMs", firstFrameMs);
+    root.insert("timeToFullyInitializedMs", fullyInitializedMs);
+    root.insert("phases", list);
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+bool StartupProfiler::dumpJson(const QString &filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "StartupProfiler: cannot write" << filePath;
+        return false;
+    }
+    return file.write(toJson()) >= 0;
+}
+
+// ------------------- Deferred Initialization -------------------
+
+void InitQueue::add(const QString &name, Priority priority, StepFunction step)
+{
+    Task task;
+    task.name = name;
+    task.priority = priority;
+    task.step = std::move(step);
+    task.id = nextId++;
+
+    // After every task of the same or higher priority
+    auto it = std::upper_bound(tasks.begin(), tasks.end(), priority,
+                               [](Priority p, const Task &t) { return p < t.priority; });
+    tasks.insert(it, task);
+}
+
+bool InitQueue::runStep(int index, bool deferred)
+{
+    StartupProfiler &profiler = StartupProfiler::instance();
+    const double startMs = profiler.elapsedMs();
+    if (tasks[index].firstStepMs < 0.0) {
+        tasks[index].firstStepMs = startMs;
+        tasks[index].deferred = deferred;
+    }
+
+    // The step may add tasks, which moves this one: find it again by id afterwards
+    const quint64 id = tasks[index].id;
+    const StepFunction step = tasks[index].step;
+    bool finished = false;
+    {
+        PERFTRACE_SCOPE_STRING(tasks[index].name);
+        finished = step();
+    }
+    const double endMs = profiler.elapsedMs();
+
+    index = int(std::find_if(tasks.cbegin(), tasks.cend(), [id](const Task &t) { return t.id == id; }) - tasks.cbegin());
+    Task &task = tasks[index];
+    task.activeMs += endMs - startMs;
+    ++task.steps;
+    if (!finished) {
+        return false;
+    }
+
+    StartupProfiler::Phase phase;
+    phase.name = task.name;
+    phase.startMs = task.firstStepMs;
+    phase.endMs = endMs;
+    phase.activeMs = task.activeMs;
+    phase.steps = task.steps;
+    phase.deferred = task.deferred;
+    profiler.addPhase(phase);
+
+    tasks.removeAt(index);
+    return true;
+}
+
+void InitQueue::runCritical()
+{
+    while (!tasks.isEmpty() && tasks.first().priority == Priority::Critical) {
+        runStep(0, false);
+    }
+}
+
+bool InitQueue::runFor(double budgetMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Every unfinished task gets at most one step per call, so a task waiting on
+    // a background job does not spin, and lower priorities still get a turn.
+    // Steps may add tasks anywhere in the queue, so positions are not stable:
+    // each call marks the tasks it has stepped and always takes the first
+    // unmarked one, which also gives tasks added by a step their turn in order.
+    const quint64 call = ++runCalls;
+    for (;;) {
+        const auto next = std::find_if(tasks.begin(), tasks.end(),
+                                       [call](const Task &t) { return t.lastCall != call; });
+        if (next == tasks.end()) {
+            break;
+        }
+        next->lastCall = call;
+        runStep(int(next - tasks.begin()), true);
+        if (timer.nsecsElapsed() / 1.0e6 >= budgetMs) {
+            break;
+        }
+    }
+    return tasks.isEmpty();
+}
+
+void InitQueue::runAll()
+{
+    while (!tasks.isEmpty()) {
+        runStep(0, false);
+    }
+}
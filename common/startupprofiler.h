@@ -0,0 +1,147 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+/**
+ * @brief Wall-clock breakdown of application startup, from process start to a fully initialized scene.
+ *
+ * Times are milliseconds since the process was created: on Linux the age of
+ * the process is read from /proc when the profiler is first used, so dynamic
+ * loading and static initialization before main() are included; elsewhere the
+ * clock starts at the first call to instance(), which main() makes first thing.
+ *
+ * Two milestones are recorded once each: the first frame presented
+ * (markFirstFrame(), typically from QOpenGLWidget::frameSwapped) and the end
+ * of all deferred initialization work (markFullyInitialized()). Everything in
+ * between is a list of named phases and instantaneous marks.
+ *
+ * Only used from the GUI thread.
+ */
+class StartupProfiler
+{
+public:
+    struct Phase {
+        QString name;
+        double startMs = 0.0;       // Since process start
+        double endMs = 0.0;
+        double activeMs = 0.0;      // Time actually spent in the phase (< end - start for deferred work)
+        int steps = 1;              // Frames a deferred task was spread over
+        bool deferred = false;      // Ran after the first frame was requested
+    };
+
+    /**
+     * @brief Times the enclosing block as one phase.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(const QString &name);
+        ~Scope();
+
+    private:
+        QString name;
+        double startMs;
+    };
+
+    static StartupProfiler &instance();
+
+    double elapsedMs() const;                 // Since process start
+    void mark(const QString &name);           // Zero-length phase, e.g. "main()" or "window shown"
+    void addPhase(const Phase &phase);
+
+    void markFirstFrame();
+    /**
+     * @brief Records the end of deferred initialization (taken as the first frame if that comes later).
+     */
+    void markFullyInitialized();
+    double timeToFirstFrameMs() const { return firstFrameMs; }           // < 0 until reached
+    double timeToFullyInitializedMs() const { return fullyInitializedMs; }
+    bool isFullyInitialized() const { return fullyInitializedMs >= 0.0; }
+
+    QString report() const;
+    QByteArray toJson() const;
+    bool dumpJson(const QString &filePath) const;
+
+private:
+    StartupProfiler();
+
+    QElapsedTimer clock;
+    double processAge = 0.0;       // Process age (ms) when the clock started
+    double firstFrameMs = -1.0;
+    double fullyInitializedMs = -1.0;
+    bool fullyInitializedPending = false;   // Everything ran before the first frame was presented
+    QVector<Phase> phases;
+};
+
+/**
+ * @brief Initialization split into prioritized tasks, run partly before and partly after the first frame.
+ *
+ * Critical tasks are what the first frame cannot be drawn without (functions,
+ * shaders, geometry, placeholders); runCritical() runs them to completion in
+ * initializeGL(). Everything else is drained by runFor() at the start of
+ * later frames, highest priority first, within a per-frame time budget.
+ *
+ * A task's step function returns true once the task is finished; returning
+ * false keeps it queued so long work can be sliced across frames (or a task
+ * can simply wait for a background job). At least one step runs per call, so
+ * the queue always progresses even when a single step exceeds the budget.
+ * Steps may add further tasks. Each finished task is recorded as a
+ * StartupProfiler phase.
+ */
+class InitQueue
+{
+public:
+    enum class Priority {
+        Critical,   // Before the first frame
+        High,       // Visible content (e.g. the textures the first frame shows placeholders for)
+        Normal,
+        Low         // Warm-up work nothing is waiting for
+    };
+
+    using StepFunction = std::function<bool()>;
+
+    void add(const QString &name, Priority priority, StepFunction step);
+
+    /**
+     * @brief Runs every Critical task to completion.
+     */
+    void runCritical();
+    /**
+     * @brief Runs pending tasks in priority order for about @p budgetMs.
+     * @return true once the queue is empty.
+     */
+    bool runFor(double budgetMs);
+    /**
+     * @brief Runs everything now, e.g. when recording a trace that must contain all resources.
+     */
+    void runAll();
+
+    bool isDone() const { return tasks.isEmpty(); }
+    int pending() const { return int(tasks.size()); }
+
+private:
+    struct Task {
+        QString name;
+        Priority priority = Priority::Normal;
+        StepFunction step;
+        double firstStepMs = -1.0;
+        double activeMs = 0.0;
+        int steps = 0;
+        bool deferred = false;
+        quint64 id = 0;
+        quint64 lastCall = 0;   // runFor() call that last stepped it
+    };
+
+    bool runStep(int index, bool deferred);   // true if the task finished and was removed
+
+    QVector<Task> tasks;   // Kept sorted by priority, insertion order within a priority
+    quint64 nextId = 1;
+    quint64 runCalls = 0;
+};
+
+#endif // STARTUPPROFILER_H
@@ -0,0 +1,824 @@
+#include "terrain.h"
+#include "heightmap.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QOpenGLShaderProgram>
+#include <QThread>
+#include <QVector2D>
+#include <QVector4D>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// ------------------- Shader Source Code (Embedded) -------------------
+
+// x and z come from the vertex index: the chunk's grid first, then its skirt ring
+static const char *vertexShaderSource = R"glsl(
+#version 330 core
+layout (location = 0) in float height;
+layout (location = 1) in vec4 normal;
+
+out vec3 worldPosition;
+out vec3 worldNormal;
+
+uniform mat4 viewProjection;
+uniform int baseVertex;
+uniform int chunkSize;
+uniform vec2 chunkOrigin;
+uniform float sampleSpacing;
+uniform float skirtDepth;
+
+void main()
+{
+    int local = gl_VertexID - baseVertex;
+    int last = chunkSize - 1;
+    ivec2 grid;
+    float drop = 0.0;
+    if (local < chunkSize * chunkSize) {
+        grid = ivec2(local % chunkSize, local / chunkSize);
+    } else {
+        // Skirt ring, walked z = 0, x = last, z = last, x = 0
+        int k = local - chunkSize * chunkSize;
+        int side = k / last;
+        int t = k % last;
+        if (side == 0) {
+            grid = ivec2(t, 0);
+        } else if (side == 1) {
+            grid = ivec2(last, t);
+        } else if (side == 2) {
+            grid = ivec2(last - t, last);
+        } else {
+            grid = ivec2(0, last - t);
+        }
+        drop = skirtDepth;
+    }
+
+    worldPosition = vec3(chunkOrigin.x + float(grid.x) * sampleSpacing, height - drop,
+                         chunkOrigin.y + float(grid.y) * sampleSpacing);
+    worldNormal = normal.xyz;
+    gl_Position = viewProjection * vec4(worldPosition, 1.0);
+}
+)glsl";
+
+static const char *fragmentShaderSource = R"glsl(
+#version 330 core
+in vec3 worldPosition;
+in vec3 worldNormal;
+out vec4 FragColor;
+
+uniform vec3 cameraPosition;
+uniform vec3 lightDirection;
+uniform float heightScale;
+uniform float fogDistance;
+uniform vec3 fogColor;
+uniform vec4 tint;   // rgb, a = strength
+
+void main()
+{
+    vec3 n = normalize(worldNormal);
+    float h = worldPosition.y / heightScale;
+    float slope = 1.0 - n.y;
+
+    vec3 grass = vec3(0.28, 0.38, 0.16);
+    vec3 rock = vec3(0.42, 0.38, 0.34);
+    vec3 snow = vec3(0.92, 0.93, 0.96);
+    vec3 albedo = mix(grass, rock, smoothstep(0.15, 0.35, slope));
+    albedo = mix(albedo, snow, smoothstep(0.62, 0.7, h) * (1.0 - smoothstep(0.3, 0.5, slope)));
+    albedo = mix(albedo, tint.rgb, tint.a);
+
+    float diffuse = max(dot(n, -lightDirection), 0.0);
+    vec3 color = albedo * (0.25 + 0.75 * diffuse);
+
+    float fog = smoothstep(0.6 * fogDistance, fogDistance, distance(worldPosition, cameraPosition));
+    FragColor = vec4(mix(color, fogColor, fog), 1.0);
+}
+)glsl";
+
+// Per vertex: height in meters, then the normal as four signed bytes
+struct TerrainVertex {
+    float height;
+    qint8 normal[4];
+};
+static_assert(sizeof(TerrainVertex) == 8, "TerrainVertex must stay tightly packed");
+
+// Variants are indexed by these bits: edges meeting a coarser neighbour
+static const int EdgeMinZ = 1;
+static const int EdgeMaxX = 2;
+static const int EdgeMaxZ = 4;
+static const int EdgeMinX = 8;
+
+static const QVector4D lodTints[TerrainRenderer::MaxLods] = {
+    QVector4D(1.0f, 0.1f, 0.1f, 0.5f), QVector4D(1.0f, 0.6f, 0.1f, 0.5f), QVector4D(0.9f, 0.9f, 0.1f, 0.5f),
+    QVector4D(0.1f, 0.9f, 0.2f, 0.5f), QVector4D(0.1f, 0.8f, 0.9f, 0.5f), QVector4D(0.2f, 0.3f, 1.0f, 0.5f),
+    QVector4D(0.6f, 0.2f, 1.0f, 0.5f), QVector4D(1.0f, 0.2f, 0.8f, 0.5f),
+};
+
+// ------------------- Setup -------------------
+
+TerrainRenderer::TerrainRenderer() = default;
+
+TerrainRenderer::~TerrainRenderer()
+{
+    // GL objects must have been released through release() while the context was current.
+    workers.clear();
+    workers.waitForDone();
+}
+
+bool TerrainRenderer::buildProgram()
+{
+    program = new QOpenGLShaderProgram;
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource)
+        || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource)
+        || !program->link()) {
+        qWarning() << "TerrainRenderer: program failed:" << program->log();
+        return false;
+    }
+    return true;
+}
+
+bool TerrainRenderer::initialize(const Heightmap *heightmap, const Params &params)
+{
+    initializeOpenGLFunctions();
+    release();
+
+    const int n = params.chunkSize;
+    if (n < 17 || n > 129 || ((n - 1) & (n - 2)) != 0) {
+        // 129 keeps a chunk, skirt included, addressable with 16-bit indices
+        qWarning() << "TerrainRenderer: chunkSize must be 2^k + 1 between 17 and 129, not" << n;
+        return false;
+    }
+    if (!heightmap || !heightmap->isOpen() || heightmap->width() < n || heightmap->height() < n) {
+        qWarning() << "TerrainRenderer: the heightmap is missing or smaller than one chunk";
+        return false;
+    }
+
+    map = heightmap;
+    parameters = params;
+    parameters.unloadDistance = qMax(parameters.unloadDistance, parameters.loadDistance);
+    lods = 1;
+    while ((1 << lods) <= n - 1 && lods < qMin(parameters.lodCount, int(MaxLods))) {
+        ++lods;
+    }
+    parameters.lodCount = lods;
+
+    chunksX = (map->width() - 1) / (n - 1);
+    chunksZ = (map->height() - 1) / (n - 1);
+    chunks = QVector<Chunk>(chunksX * chunksZ);
+
+    const bool skirts = parameters.stitching == Stitching::Skirts;
+    verticesPerChunk = n * n + (skirts ? 4 * (n - 1) : 0);
+    chunkBytes = qint64(verticesPerChunk) * sizeof(TerrainVertex);
+    const int slots = int(qMin(parameters.poolBytes / chunkBytes, qint64(chunks.size())));
+    if (slots < 1) {
+        qWarning() << "TerrainRenderer: a pool of" << parameters.poolBytes << "bytes cannot hold one chunk of"
+                   << chunkBytes << "bytes";
+        return false;
+    }
+
+    if (!buildProgram()) {
+        release();
+        return false;
+    }
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    // Allocation is the only place a GL error is expected (GL_OUT_OF_MEMORY for a large pool);
+    // at most 32 stale errors are cleared first, a lost context would never run out of them
+    for (int i = 0; i < 32 && glGetError() != GL_NO_ERROR; ++i) {
+    }
+    const qint64 poolSize = qint64(slots) * chunkBytes;
+    glGenBuffers(1, &vertexPool);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexPool);
+    glBufferData(GL_ARRAY_BUFFER, poolSize, nullptr, GL_DYNAMIC_DRAW);
+    if (glGetError() == GL_OUT_OF_MEMORY) {
+        qWarning() << "TerrainRenderer: out of GPU memory for a" << poolSize / (1024 * 1024) << "MiB chunk pool";
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        release();
+        return false;
+    }
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(TerrainVertex), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_BYTE, GL_TRUE, sizeof(TerrainVertex), (void*)offsetof(TerrainVertex, normal));
+
+    buildIndices();   // Binds the index buffer while the VAO is bound
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    slotChunks = QVector<int>(slots, -1);
+    freeSlots.clear();
+    for (int s = slots - 1; s >= 0; --s) {
+        freeSlots.append(s);
+    }
+
+    int threads = parameters.workerThreads;
+    if (threads <= 0) {
+        threads = qMax(1, QThread::idealThreadCount() - 1);
+    }
+    workers.setMaxThreadCount(threads);
+    // Enough builds to keep every worker busy while the previous results are uploaded
+    maxInFlight = qMax(threads * 2, parameters.uploadsPerFrame * 2);
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    poolMemory = memory.registerAllocation(GpuMemoryTracker::Category::VertexBuffer, poolSize, "TerrainRenderer",
+                                           "terrain chunk pool");
+    indexMemory = memory.registerAllocation(GpuMemoryTracker::Category::IndexBuffer, indexBufferBytes,
+                                            "TerrainRenderer", "terrain LOD indices");
+
+    counters = Stats();
+    counters.chunksTotal = chunks.size();
+    counters.poolSlots = slots;
+    counters.poolBytes = poolSize;
+    counters.indexBytes = indexBufferBytes;
+    lastFrame = FrameStats();
+    frame = 0;
+    initialized = true;
+
+    qDebug() << "TerrainRenderer:" << chunksX << "x" << chunksZ << "chunks of" << n << "x" << n << "," << lods
+             << "LODs," << slots << "pool slots (" << poolSize / (1024 * 1024) << "MiB ),"
+             << (skirts ? "skirts" : "edge variants");
+    return true;
+}
+
+void TerrainRenderer::release()
+{
+    workers.clear();
+    workers.waitForDone();
+    {
+        QMutexLocker locker(&builtMutex);
+        built.clear();
+    }
+    ready.clear();
+    inFlight = 0;
+
+    delete program;
+    program = nullptr;
+    if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+        vao = 0;
+    }
+    if (vertexPool != 0) {
+        glDeleteBuffers(1, &vertexPool);
+        vertexPool = 0;
+    }
+    if (indexBuffer != 0) {
+        glDeleteBuffers(1, &indexBuffer);
+        indexBuffer = 0;
+    }
+    indexBufferBytes = 0;
+    gridRanges.clear();
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    memory.release(poolMemory);
+    memory.release(indexMemory);
+    poolMemory = indexMemory = 0;
+
+    chunks.clear();
+    slotChunks.clear();
+    freeSlots.clear();
+    map = nullptr;
+    initialized = false;
+}
+
+// ------------------- Shared Index Buffer -------------------
+
+int TerrainRenderer::perimeterIndex(int x, int z) const
+{
+    const int last = parameters.chunkSize - 1;
+    if (z == 0 && x < last) {
+        return x;
+    }
+    if (x == last && z < last) {
+        return last + z;
+    }
+    if (z == last && x > 0) {
+        return 2 * last + (last - x);
+    }
+    return 3 * last + (last - z);
+}
+
+int TerrainRenderer::variantIndex(int lod, int variant) const
+{
+    const int variants = parameters.stitching == Stitching::EdgeVariants ? 16 : 1;
+    return lod * variants + (variants > 1 ? variant : 0);
+}
+
+void TerrainRenderer::buildIndices()
+{
+    const int n = parameters.chunkSize;
+    const int last = n - 1;
+    const bool skirts = parameters.stitching == Stitching::Skirts;
+    const int variants = skirts ? 1 : 16;
+
+    QVector<quint16> indices;
+    gridRanges.clear();
+    for (int lod = 0; lod < lods; ++lod) {
+        const int step = 1 << lod;
+        for (int variant = 0; variant < variants; ++variant) {
+            // The coarsest LOD never has a coarser neighbour
+            const int edges = lod + 1 < lods ? variant : 0;
+
+            // On an edge that meets a coarser neighbour, odd vertices collapse onto the previous even one
+            auto vertex = [&](int x, int z) {
+                if (z == 0 && (edges & EdgeMinZ) && (x / step) % 2) {
+                    x -= step;
+                } else if (x == last && (edges & EdgeMaxX) && (z / step) % 2) {
+                    z -= step;
+                } else if (z == last && (edges & EdgeMaxZ) && (x / step) % 2) {
+                    x -= step;
+                } else if (x == 0 && (edges & EdgeMinX) && (z / step) % 2) {
+                    z -= step;
+                }
+                return quint16(z * n + x);
+            };
+            auto triangle = [&](quint16 a, quint16 b, quint16 c) {
+                if (a != b && b != c && a != c) {
+                    indices << a << b << c;
+                }
+            };
+
+            IndexRange range;
+            range.offset = qint64(indices.size()) * sizeof(quint16);
+            for (int z = 0; z < last; z += step) {
+                for (int x = 0; x < last; x += step) {
+                    // Split along (x, z) - (x + step, z + step); the error estimate assumes this diagonal
+                    const quint16 a = vertex(x, z);
+                    const quint16 b = vertex(x + step, z);
+                    const quint16 c = vertex(x, z + step);
+                    const quint16 d = vertex(x + step, z + step);
+                    triangle(a, b, d);
+                    triangle(a, d, c);
+                }
+            }
+
+            if (skirts) {
+                // A wall from each border segment down to its copy in the skirt ring
+                auto wall = [&](int x0, int z0, int x1, int z1) {
+                    const quint16 p = quint16(z0 * n + x0);
+                    const quint16 q = quint16(z1 * n + x1);
+                    const quint16 ps = quint16(n * n + perimeterIndex(x0, z0));
+                    const quint16 qs = quint16(n * n + perimeterIndex(x1, z1));
+                    triangle(p, q, qs);
+                    triangle(p, qs, ps);
+                };
+                for (int t = 0; t < last; t += step) {
+                    wall(t, 0, t + step, 0);
+                    wall(last, t, last, t + step);
+                    wall(last - t, last, last - t - step, last);
+                    wall(0, last - t, 0, last - t - step);
+                }
+            }
+            range.count = indices.size() - int(range.offset / sizeof(quint16));
+            gridRanges.append(range);
+        }
+    }
+
+    indexBufferBytes = qint64(indices.size()) * sizeof(quint16);
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferBytes, indices.constData(), GL_STATIC_DRAW);
+}
+
+// ------------------- Chunk Building (worker threads) -------------------
+
+void TerrainRenderer::submit(int chunk)
+{
+    chunks[chunk].state = ChunkState::Loading;
+    ++inFlight;
+    workers.start([this, chunk]() {
+        Built result = buildChunk(chunk);
+        QMutexLocker locker(&builtMutex);
+        built.append(std::move(result));
+    });
+}
+
+TerrainRenderer::Built TerrainRenderer::buildChunk(int chunk) const
+{
+    const int n = parameters.chunkSize;
+    const int last = n - 1;
+    const int originX = (chunk % chunksX) * last;
+    const int originZ = (chunk / chunksX) * last;
+    const float scale = parameters.heightScale;
+
+    QVector<float> heights(n * n);
+    for (int z = 0; z < n; ++z) {
+        for (int x = 0; x < n; ++x) {
+            heights[z * n + x] = map->value(originX + x, originZ + z) * scale;
+        }
+    }
+
+    Built result;
+    result.chunk = chunk;
+    result.vertices.resize(verticesPerChunk * int(sizeof(TerrainVertex)));
+    TerrainVertex *vertices = reinterpret_cast<TerrainVertex *>(result.vertices.data());
+
+    result.minHeight = result.maxHeight = heights[0];
+    for (int z = 0; z < n; ++z) {
+        for (int x = 0; x < n; ++x) {
+            const float h = heights[z * n + x];
+            result.minHeight = qMin(result.minHeight, h);
+            result.maxHeight = qMax(result.maxHeight, h);
+
+            // Central differences on the whole map, so normals match across chunk borders
+            const int gx = originX + x;
+            const int gz = originZ + z;
+            const float dx = (map->value(gx + 1, gz) - map->value(gx - 1, gz)) * scale;
+            const float dz = (map->value(gx, gz + 1) - map->value(gx, gz - 1)) * scale;
+            const QVector3D normal = QVector3D(-dx, 2.0f * parameters.sampleSpacing, -dz).normalized();
+
+            TerrainVertex &v = vertices[z * n + x];
+            v.height = h;
+            v.normal[0] = qint8(std::lround(normal.x() * 127.0f));
+            v.normal[1] = qint8(std::lround(normal.y() * 127.0f));
+            v.normal[2] = qint8(std::lround(normal.z() * 127.0f));
+            v.normal[3] = 0;
+        }
+    }
+    // Skirt vertices copy their border vertex; the shader lowers them
+    for (int k = n * n; k < verticesPerChunk; ++k) {
+        const int p = k - n * n;
+        const int side = p / last;
+        const int t = p % last;
+        const int x = side == 0 ? t : (side == 1 ? last : (side == 2 ? last - t : 0));
+        const int z = side == 0 ? 0 : (side == 1 ? t : (side == 2 ? last : last - t));
+        vertices[k] = vertices[z * n + x];
+    }
+
+    // Largest distance between the full-resolution surface and each LOD's triangles
+    result.errors[0] = 0.0f;
+    for (int lod = 1; lod < lods; ++lod) {
+        const int step = 1 << lod;
+        float error = 0.0f;
+        for (int z = 0; z < n; ++z) {
+            const int z0 = qMin(z / step * step, last - step);
+            const float fz = float(z - z0) / step;
+            for (int x = 0; x < n; ++x) {
+                const int x0 = qMin(x / step * step, last - step);
+                const float fx = float(x - x0) / step;
+                const float h00 = heights[z0 * n + x0];
+                const float h10 = heights[z0 * n + x0 + step];
+                const float h01 = heights[(z0 + step) * n + x0];
+                const float h11 = heights[(z0 + step) * n + x0 + step];
+                const float surface = fx >= fz ? h00 + fx * (h10 - h00) + fz * (h11 - h10)
+                                               : h00 + fz * (h01 - h00) + fx * (h11 - h01);
+                error = qMax(error, std::abs(heights[z * n + x] - surface));
+            }
+        }
+        result.errors[lod] = qMax(error, result.errors[lod - 1]);
+    }
+    return result;
+}
+
+// ------------------- Streaming (render thread) -------------------
+
+float TerrainRenderer::horizontalDistance(int chunk, const QVector3D &position) const
+{
+    const float size = (parameters.chunkSize - 1) * parameters.sampleSpacing;
+    const float minX = (chunk % chunksX) * size;
+    const float minZ = (chunk / chunksX) * size;
+    const float dx = qMax(qMax(minX - position.x(), position.x() - (minX + size)), 0.0f);
+    const float dz = qMax(qMax(minZ - position.z(), position.z() - (minZ + size)), 0.0f);
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+void TerrainRenderer::evict(int chunk)
+{
+    Chunk &c = chunks[chunk];
+    slotChunks[c.slot] = -1;
+    freeSlots.append(c.slot);
+    c.slot = -1;
+    c.state = ChunkState::Unloaded;
+    ++counters.chunksEvicted;
+    --counters.chunksResident;
+}
+
+void TerrainRenderer::update(const QVector3D &cameraPosition)
+{
+    if (!initialized) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&builtMutex);
+        for (Built &result : built) {
+            chunks[result.chunk].state = ChunkState::Ready;
+            ready.append(std::move(result));
+            --inFlight;
+        }
+        built.clear();
+    }
+
+    // Release what the camera has left behind
+    for (int slot = 0; slot < slotChunks.size(); ++slot) {
+        const int chunk = slotChunks[slot];
+        if (chunk >= 0 && horizontalDistance(chunk, cameraPosition) > parameters.unloadDistance) {
+            evict(chunk);
+        }
+    }
+    for (int i = ready.size() - 1; i >= 0; --i) {
+        if (horizontalDistance(ready[i].chunk, cameraPosition) > parameters.unloadDistance) {
+            chunks[ready[i].chunk].state = ChunkState::Unloaded;
+            ready.remove(i);
+            ++counters.chunksDiscarded;
+        }
+    }
+
+    uploadReady(cameraPosition);
+
+    float farthestResident = 0.0f;
+    for (int chunk : slotChunks) {
+        if (chunk >= 0) {
+            farthestResident = qMax(farthestResident, horizontalDistance(chunk, cameraPosition));
+        }
+    }
+
+    // Request everything in range that is not resident or on its way, nearest first
+    const float size = (parameters.chunkSize - 1) * parameters.sampleSpacing;
+    const int radius = int(std::ceil(parameters.loadDistance / size)) + 1;
+    const int centerX = int(std::floor(cameraPosition.x() / size));
+    const int centerZ = int(std::floor(cameraPosition.z() / size));
+    QVector<QPair<float, int>> wanted;
+    for (int cz = qMax(0, centerZ - radius); cz <= qMin(chunksZ - 1, centerZ + radius); ++cz) {
+        for (int cx = qMax(0, centerX - radius); cx <= qMin(chunksX - 1, centerX + radius); ++cx) {
+            const int chunk = cz * chunksX + cx;
+            if (chunks[chunk].state != ChunkState::Unloaded) {
+                continue;
+            }
+            const float distance = horizontalDistance(chunk, cameraPosition);
+            if (distance <= parameters.loadDistance) {
+                wanted.append(qMakePair(distance, chunk));
+            }
+        }
+    }
+    std::sort(wanted.begin(), wanted.end());
+
+    int capacity = freeSlots.size() - ready.size() - inFlight;
+    for (const auto &candidate : wanted) {
+        if (inFlight >= maxInFlight) {
+            break;
+        }
+        // A full pool still takes chunks nearer than its farthest one, which gives up its slot
+        if (capacity <= 0 && candidate.first >= farthestResident) {
+            break;
+        }
+        submit(candidate.second);
+        --capacity;
+    }
+}
+
+void TerrainRenderer::uploadReady(const QVector3D &cameraPosition)
+{
+    if (ready.isEmpty()) {
+        return;
+    }
+    std::sort(ready.begin(), ready.end(), [this, &cameraPosition](const Built &a, const Built &b) {
+        return horizontalDistance(a.chunk, cameraPosition) < horizontalDistance(b.chunk, cameraPosition);
+    });
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertexPool);
+    int uploaded = 0;
+    int next = 0;
+    for (; next < ready.size() && uploaded < parameters.uploadsPerFrame; ++next) {
+        const Built &result = ready[next];
+        if (freeSlots.isEmpty()) {
+            // Only trade a resident chunk for a nearer one
+            const float distance = horizontalDistance(result.chunk, cameraPosition);
+            int farthest = -1;
+            float farthestDistance = distance;
+            for (int chunk : slotChunks) {
+                const float d = chunk >= 0 ? horizontalDistance(chunk, cameraPosition) : 0.0f;
+                if (d > farthestDistance) {
+                    farthest = chunk;
+                    farthestDistance = d;
+                }
+            }
+            if (farthest < 0) {
+                break;
+            }
+            evict(farthest);
+        }
+
+        const int slot = freeSlots.takeLast();
+        glBufferSubData(GL_ARRAY_BUFFER, slot * chunkBytes, result.vertices.size(), result.vertices.constData());
+
+        Chunk &c = chunks[result.chunk];
+        c.state = ChunkState::Resident;
+        c.slot = slot;
+        c.minHeight = result.minHeight;
+        c.maxHeight = result.maxHeight;
+        std::memcpy(c.errors, result.errors, sizeof(c.errors));
+        slotChunks[slot] = result.chunk;
+        ++counters.chunksLoaded;
+        ++counters.chunksResident;
+        ++uploaded;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    ready.remove(0, next);
+}
+
+// ------------------- Rendering -------------------
+
+void TerrainRenderer::render(const QMatrix4x4 &view, const QMatrix4x4 &projection, const QVector3D &cameraPosition,
+                             int viewportHeight, float fovYDegrees)
+{
+    if (!initialized) {
+        return;
+    }
+    ++frame;
+    FrameStats stats;
+
+    // Frustum planes (Gribb / Hartmann), pointing inwards
+    const QMatrix4x4 viewProjection = projection * view;
+    QVector4D planes[6];
+    for (int i = 0; i < 3; ++i) {
+        planes[2 * i] = viewProjection.row(3) + viewProjection.row(i);
+        planes[2 * i + 1] = viewProjection.row(3) - viewProjection.row(i);
+    }
+
+    // Screen pixels covered by one meter of error at a distance of one meter
+    const float errorToPixels = viewportHeight / (2.0f * std::tan(qDegreesToRadians(fovYDegrees) * 0.5f));
+    const float size = (parameters.chunkSize - 1) * parameters.sampleSpacing;
+    const int radius = int(std::ceil(parameters.loadDistance / size)) + 1;
+    const int centerX = int(std::floor(cameraPosition.x() / size));
+    const int centerZ = int(std::floor(cameraPosition.z() / size));
+
+    QVector<int> drawList;
+    for (int cz = qMax(0, centerZ - radius); cz <= qMin(chunksZ - 1, centerZ + radius); ++cz) {
+        for (int cx = qMax(0, centerX - radius); cx <= qMin(chunksX - 1, centerX + radius); ++cx) {
+            const int index = cz * chunksX + cx;
+            if (horizontalDistance(index, cameraPosition) > parameters.loadDistance) {
+                continue;
+            }
+            Chunk &chunk = chunks[index];
+            const bool resident = chunk.state == ChunkState::Resident;
+            const QVector3D lo(cx * size, resident ? chunk.minHeight : 0.0f, cz * size);
+            const QVector3D hi(lo.x() + size, resident ? chunk.maxHeight : parameters.heightScale, lo.z() + size);
+
+            bool inside = true;
+            for (const QVector4D &plane : planes) {
+                const QVector3D positive(plane.x() >= 0.0f ? hi.x() : lo.x(), plane.y() >= 0.0f ? hi.y() : lo.y(),
+                                         plane.z() >= 0.0f ? hi.z() : lo.z());
+                if (QVector3D::dotProduct(plane.toVector3D(), positive) + plane.w() < 0.0f) {
+                    inside = false;
+                    break;
+                }
+            }
+            if (!inside) {
+                continue;
+            }
+            ++stats.chunksInRange;
+            if (!resident) {
+                ++stats.chunksMissing;
+                continue;
+            }
+
+            // Coarsest LOD whose error stays under the threshold at the chunk's nearest point
+            const QVector3D nearest(qBound(lo.x(), cameraPosition.x(), hi.x()), qBound(lo.y(), cameraPosition.y(), hi.y()),
+                                    qBound(lo.z(), cameraPosition.z(), hi.z()));
+            const float distance = qMax((nearest - cameraPosition).length(), 1.0e-3f);
+            chunk.lod = 0;
+            for (int lod = lods - 1; lod > 0; --lod) {
+                if (chunk.errors[lod] * errorToPixels / distance <= parameters.pixelError) {
+                    chunk.lod = lod;
+                    break;
+                }
+            }
+            chunk.drawnFrame = frame;
+            drawList.append(index);
+        }
+    }
+
+    auto drawnNeighbour = [this](int cx, int cz) -> const Chunk * {
+        if (cx < 0 || cz < 0 || cx >= chunksX || cz >= chunksZ) {
+            return nullptr;
+        }
+        const Chunk &c = chunks[cz * chunksX + cx];
+        return c.drawnFrame == frame ? &c : nullptr;
+    };
+
+    const bool variants = parameters.stitching == Stitching::EdgeVariants;
+    if (variants) {
+        // Neighbours may differ by one LOD at most: refine whatever is two or more coarser than a neighbour
+        bool changed = true;
+        for (int pass = 0; changed && pass < lods; ++pass) {
+            changed = false;
+            for (int index : drawList) {
+                Chunk &chunk = chunks[index];
+                const int cx = index % chunksX;
+                const int cz = index / chunksX;
+                const Chunk *neighbours[4] = { drawnNeighbour(cx, cz - 1), drawnNeighbour(cx + 1, cz),
+                                               drawnNeighbour(cx, cz + 1), drawnNeighbour(cx - 1, cz) };
+                for (const Chunk *neighbour : neighbours) {
+                    if (neighbour && chunk.lod > neighbour->lod + 1) {
+                        chunk.lod = neighbour->lod + 1;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    QVector3D lightDirection(-0.4f, -0.8f, -0.3f);
+    program->bind();
+    program->setUniformValue("viewProjection", viewProjection);
+    program->setUniformValue("chunkSize", parameters.chunkSize);
+    program->setUniformValue("sampleSpacing", parameters.sampleSpacing);
+    program->setUniformValue("cameraPosition", cameraPosition);
+    program->setUniformValue("lightDirection", lightDirection.normalized());
+    program->setUniformValue("heightScale", parameters.heightScale);
+    program->setUniformValue("fogDistance", parameters.loadDistance);
+    program->setUniformValue("fogColor", QVector3D(0.62f, 0.72f, 0.85f));
+    program->setUniformValue("tint", QVector4D(0.0f, 0.0f, 0.0f, 0.0f));
+    const int baseVertexLocation = program->uniformLocation("baseVertex");
+    const int originLocation = program->uniformLocation("chunkOrigin");
+    const int skirtLocation = program->uniformLocation("skirtDepth");
+    const int tintLocation = program->uniformLocation("tint");
+
+    if (wireframe) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    }
+    glBindVertexArray(vao);
+    for (int index : drawList) {
+        const Chunk &chunk = chunks[index];
+        const int cx = index % chunksX;
+        const int cz = index / chunksX;
+
+        int edges = 0;
+        if (variants) {
+            const Chunk *minZ = drawnNeighbour(cx, cz - 1);
+            const Chunk *maxX = drawnNeighbour(cx + 1, cz);
+            const Chunk *maxZ = drawnNeighbour(cx, cz + 1);
+            const Chunk *minX = drawnNeighbour(cx - 1, cz);
+            edges |= minZ && minZ->lod > chunk.lod ? EdgeMinZ : 0;
+            edges |= maxX && maxX->lod > chunk.lod ? EdgeMaxX : 0;
+            edges |= maxZ && maxZ->lod > chunk.lod ? EdgeMaxZ : 0;
+            edges |= minX && minX->lod > chunk.lod ? EdgeMinX : 0;
+        }
+        const IndexRange &range = gridRanges[variantIndex(chunk.lod, edges)];
+        const GLint baseVertex = GLint(chunk.slot) * verticesPerChunk;
+
+        program->setUniformValue(baseVertexLocation, baseVertex);
+        program->setUniformValue(originLocation, QVector2D(cx * size, cz * size));
+        // Deep enough to cover the gap to any coarser neighbour
+        program->setUniformValue(skirtLocation, chunk.errors[lods - 1] + parameters.sampleSpacing);
+        if (lodTint) {
+            program->setUniformValue(tintLocation, lodTints[chunk.lod]);
+        }
+        glDrawElementsBaseVertex(GL_TRIANGLES, range.count, GL_UNSIGNED_SHORT, (void*)range.offset, baseVertex);
+
+        ++stats.chunksDrawn;
+        stats.triangles += range.count / 3;
+        ++stats.lodHistogram[chunk.lod];
+    }
+    glBindVertexArray(0);
+    if (wireframe) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+    program->release();
+
+    lastFrame = stats;
+}
+
+// ------------------- Queries -------------------
+
+float TerrainRenderer::heightAt(float x, float z) const
+{
+    if (!map) {
+        return 0.0f;
+    }
+    return map->interpolated(x / parameters.sampleSpacing, z / parameters.sampleSpacing) * parameters.heightScale;
+}
+
+QVector3D TerrainRenderer::extent() const
+{
+    const float size = (parameters.chunkSize - 1) * parameters.sampleSpacing;
+    return QVector3D(chunksX * size, parameters.heightScale, chunksZ * size);
+}
+
+TerrainRenderer::Stats TerrainRenderer::stats() const
+{
+    Stats s = counters;
+    s.residentBytes = qint64(s.chunksResident) * chunkBytes;
+    s.pendingLoads = inFlight + ready.size();
+    return s;
+}
+
+QString TerrainRenderer::report() const
+{
+    const Stats s = stats();
+    return QString("TerrainRenderer: %1 / %2 chunks resident (%3 / %4 MiB, indices %5 KiB), %6 loaded, %7 evicted, "
+                   "%8 discarded, %9 pending")
+        .arg(s.chunksResident)
+        .arg(s.chunksTotal)
+        .arg(s.residentBytes / (1024.0 * 1024.0), 0, 'f', 2)
+        .arg(s.poolBytes / (1024.0 * 1024.0), 0, 'f', 2)
+        .arg(s.indexBytes / 1024.0, 0, 'f', 1)
+        .arg(s.chunksLoaded)
+        .arg(s.chunksEvicted)
+        .arg(s.chunksDiscarded)
+        .arg(s.pendingLoads);
+}
@@ -0,0 +1,214 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QByteArray>
+#include <QMatrix4x4>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <QVector3D>
+#include "gpumemory.h"
+
+class Heightmap;
+class QOpenGLShaderProgram;
+
+/**
+ * @brief Chunked heightmap terrain with geomipmapping and streaming.
+ *
+ * The heightmap is split into square chunks of chunkSize x chunkSize vertices
+ * (2^n + 1, neighbours share their border row). Every chunk has the same
+ * vertex layout, so one index buffer holds the triangles of every LOD for
+ * all of them: LOD l uses every 2^l-th vertex. A chunk's vertices are only
+ * its heights and normals (8 bytes each); x and z come from gl_VertexID.
+ *
+ * Resident chunks live in slots of one pooled vertex buffer and are drawn
+ * with glDrawElementsBaseVertex, so a frame binds one VAO and one program.
+ *
+ * Each chunk picks the coarsest LOD whose geometric error (the largest
+ * height difference between that LOD and the full-resolution surface,
+ * measured when the chunk is built) projects to at most pixelError pixels.
+ * Cracks between LODs are closed in one of two ways:
+ * - Skirts: every chunk has a strip of vertices hanging below its border.
+ * - EdgeVariants: neighbouring LODs are limited to differ by one, and every
+ *   LOD has 16 index ranges, one per combination of edges that meet a
+ *   coarser neighbour. On those edges every other vertex is collapsed onto
+ *   the next, so the edge matches the neighbour exactly.
+ *
+ * update() streams chunks: the ones within loadDistance of the camera are
+ * built on worker threads from the memory-mapped heightmap and uploaded a
+ * few per frame, nearest first. Chunks beyond unloadDistance, or the
+ * farthest ones when the pool is full, give their slot back.
+ *
+ * All GL calls must be made with the owning context current.
+ */
+class TerrainRenderer : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    enum class Stitching {
+        Skirts,
+        EdgeVariants
+    };
+
+    static const int MaxLods = 8;
+
+    struct Params {
+        int chunkSize = 65;                    // Vertices per chunk edge, 2^n + 1, 17..129
+        int lodCount = 6;                      // Clamped to log2(chunkSize - 1) + 1
+        float sampleSpacing = 1.0f;            // Meters between heightmap samples
+        float heightScale = 600.0f;            // Meters spanned by the 16-bit range
+        float pixelError = 2.0f;               // Largest screen-space error of a chosen LOD
+        Stitching stitching = Stitching::Skirts;
+        float loadDistance = 4000.0f;          // Chunks closer than this (horizontally) are streamed in
+        float unloadDistance = 4800.0f;        // ...and released beyond this
+        qint64 poolBytes = 128 * 1024 * 1024;  // Vertex memory for resident chunks
+        int uploadsPerFrame = 8;               // Chunks uploaded by one update()
+        int workerThreads = 0;                 // 0 picks QThread::idealThreadCount() - 1
+    };
+
+    // Counters of the last render()
+    struct FrameStats {
+        int chunksInRange = 0;                 // Within loadDistance and in the frustum
+        int chunksDrawn = 0;
+        int chunksMissing = 0;                 // In range and visible but not resident yet
+        qint64 triangles = 0;
+        int lodHistogram[MaxLods] = {};
+    };
+
+    struct Stats {
+        int chunksTotal = 0;
+        int chunksResident = 0;
+        int poolSlots = 0;
+        qint64 residentBytes = 0;              // Vertex data of the resident chunks
+        qint64 poolBytes = 0;                  // Allocated vertex pool
+        qint64 indexBytes = 0;                 // Shared index buffer
+        quint64 chunksLoaded = 0;
+        quint64 chunksEvicted = 0;
+        quint64 chunksDiscarded = 0;           // Built but out of range when they arrived
+        int pendingLoads = 0;
+    };
+
+    TerrainRenderer();
+    ~TerrainRenderer();
+
+    /**
+     * @brief Builds the shared index buffer, the vertex pool and the program.
+     * @param heightmap Must stay open until release().
+     * @return false if a shader does not build, the parameters are invalid or the pool cannot be allocated.
+     */
+    bool initialize(const Heightmap *heightmap, const Params &params);
+    /**
+     * @brief Deletes the GL objects and waits for the workers; call with the context current.
+     */
+    void release();
+    bool isInitialized() const { return initialized; }
+    Params params() const { return parameters; }
+
+    /**
+     * @brief Uploads finished chunks, releases far ones and requests the ones now in range.
+     */
+    void update(const QVector3D &cameraPosition);
+
+    /**
+     * @brief Picks the LODs and draws the resident chunks in the frustum.
+     * @param viewportHeight Height of the target in pixels, for the screen-space error.
+     * @param fovYDegrees Vertical field of view of @p projection.
+     */
+    void render(const QMatrix4x4 &view, const QMatrix4x4 &projection, const QVector3D &cameraPosition,
+                int viewportHeight, float fovYDegrees);
+
+    void setWireframe(bool enabled) { wireframe = enabled; }
+    void setLodTint(bool enabled) { lodTint = enabled; }
+
+    /**
+     * @brief Terrain height in meters at world (@p x, @p z), straight from the heightmap.
+     */
+    float heightAt(float x, float z) const;
+    /**
+     * @brief World size of the chunked area (x, max height, z); it starts at the origin.
+     */
+    QVector3D extent() const;
+
+    FrameStats frameStats() const { return lastFrame; }
+    Stats stats() const;
+    QString report() const;
+
+private:
+    enum class ChunkState : quint8 {
+        Unloaded,
+        Loading,
+        Ready,          // Built, waiting for an upload
+        Resident
+    };
+
+    struct Chunk {
+        ChunkState state = ChunkState::Unloaded;
+        int slot = -1;
+        float minHeight = 0.0f;
+        float maxHeight = 0.0f;
+        float errors[MaxLods] = {};    // Geometric error of each LOD in meters
+        quint64 drawnFrame = 0;        // Frame the LOD below was chosen in
+        int lod = 0;
+    };
+
+    struct Built {
+        int chunk = 0;
+        float minHeight = 0.0f;
+        float maxHeight = 0.0f;
+        float errors[MaxLods] = {};
+        QByteArray vertices;
+    };
+
+    struct IndexRange {
+        qint64 offset = 0;             // Bytes into the index buffer
+        int count = 0;
+    };
+
+    bool buildProgram();
+    void buildIndices();
+    void submit(int chunk);
+    Built buildChunk(int chunk) const;
+    void uploadReady(const QVector3D &cameraPosition);
+    void evict(int chunk);
+    float horizontalDistance(int chunk, const QVector3D &position) const;
+    int perimeterIndex(int x, int z) const;
+    int variantIndex(int lod, int variant) const;
+
+    bool initialized = false;
+    const Heightmap *map = nullptr;
+    Params parameters;
+    int chunksX = 0;
+    int chunksZ = 0;
+    int lods = 0;
+    int verticesPerChunk = 0;
+    qint64 chunkBytes = 0;
+    quint64 frame = 0;
+
+    QVector<Chunk> chunks;
+    QVector<int> slotChunks;           // Chunk in each pool slot, -1 if free
+    QVector<int> freeSlots;
+    QVector<Built> ready;              // Built on a worker, not uploaded yet
+
+    QOpenGLShaderProgram *program = nullptr;
+    GLuint vao = 0;
+    GLuint vertexPool = 0;
+    GLuint indexBuffer = 0;
+    qint64 indexBufferBytes = 0;
+    QVector<IndexRange> gridRanges;    // [lod * variants + variant]
+    bool wireframe = false;
+    bool lodTint = false;
+
+    QThreadPool workers;
+    int maxInFlight = 0;
+    int inFlight = 0;
+    QMutex builtMutex;
+    QVector<Built> built;              // Filled by the workers, drained by update()
+
+    Stats counters;
+    FrameStats lastFrame;
+    GpuMemoryTracker::Handle poolMemory = 0;
+    GpuMemoryTracker::Handle indexMemory = 0;
+};
+
+#endif // TERRAIN_H
@@ -0,0 +1,490 @@
+#include "texturestreamer.h"
+#include "perftrace.h"
+#include "textureupload.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtMath>
+#include <algorithm>
+#include <limits>
+
+// A texture that has not been reported for this many frames counts as off screen
+static const quint64 VisibleGraceFrames = 30;
+
+// Every level of a texture must share the RGBA8 internal format; 32-bit Qt layouts upload as-is
+static QImage toUploadFormat(QImage image)
+{
+    TextureUploader::PixelFormat format;
+    if (!TextureUploader::pixelFormat(image.format(), &format) || format.internalFormat != GL_RGBA8) {
+        image.convertTo(QImage::Format_RGBA8888);
+    }
+    return image;
+}
+
+// ------------------- Construction -------------------
+
+TextureStreamer::TextureStreamer() = default;
+
+TextureStreamer::~TextureStreamer()
+{
+    // GL objects must have been released through release() while the context was current.
+    workers.clear();
+    workers.waitForDone();
+}
+
+void TextureStreamer::initialize(qint64 poolBytes, int tailSize, qint64 uploadBytesPerFrame, int workerThreads)
+{
+    initializeOpenGLFunctions();
+
+    pool = poolBytes;
+    tail = qMax(1, tailSize);
+    uploadBudget = uploadBytesPerFrame;
+
+    if (workerThreads <= 0) {
+        workerThreads = qMax(1, QThread::idealThreadCount() - 1);
+    }
+    workers.setMaxThreadCount(workerThreads);
+    // Enough requests to keep every worker busy while the previous results are uploaded
+    maxInFlight = workerThreads * 2;
+
+    counters.poolBytes = pool;
+    initialized = true;
+}
+
+int TextureStreamer::addTexture(const QString &filePath, FallbackFunction fallback, const QByteArray &encoded)
+{
+    if (!initialized) {
+        qWarning() << "TextureStreamer: addTexture() called before initialize()";
+        return -1;
+    }
+
+    // Only the header is read here; the pixels are decoded on a worker
+    QSize size;
+    if (encoded.isEmpty()) {
+        size = QImageReader(filePath).size();
+    } else {
+        QBuffer buffer;
+        buffer.setData(encoded);
+        buffer.open(QIODevice::ReadOnly);
+        size = QImageReader(&buffer).size();
+    }
+    if (!size.isValid() && fallback) {
+        qWarning() << "TextureStreamer: cannot read" << filePath << ", streaming the fallback image";
+        size = fallback().size();
+    }
+    if (!size.isValid() || size.isEmpty()) {
+        qWarning() << "TextureStreamer: no image for" << filePath;
+        return -1;
+    }
+
+    Entry entry;
+    entry.path = filePath;
+    entry.encoded = encoded;
+    entry.fallback = std::move(fallback);
+    entry.width = size.width();
+    entry.height = size.height();
+    entry.levelCount = 1 + int(std::floor(std::log2(qMax(entry.width, entry.height))));
+    entry.tailLevel = entry.levelCount - 1;
+    while (entry.tailLevel > 0 && qMax(levelWidth(entry, entry.tailLevel - 1), levelHeight(entry, entry.tailLevel - 1)) <= tail) {
+        --entry.tailLevel;
+    }
+    entry.wantedBase = entry.tailLevel;
+
+    GLint previousTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry.levelCount - 1);
+    glBindTexture(GL_TEXTURE_2D, GLuint(previousTexture));
+
+    entry.memory = GpuMemoryTracker::instance().registerAllocation(GpuMemoryTracker::Category::Texture, 0,
+                                                                   "TextureStreamer", filePath);
+
+    const int id = entries.size();
+    entries.append(entry);
+    ++counters.textures;
+
+    // Tails go ahead of detail requests and are not limited by maxInFlight
+    submit(id, entries[id].tailLevel, entries[id].levelCount - 1, 1);
+    return id;
+}
+
+void TextureStreamer::waitForTails()
+{
+    workers.waitForDone();
+    drainDecoded(-1);
+}
+
+// ------------------- Worker Side -------------------
+
+void TextureStreamer::submit(int id, int level, int coarsestLevel, int poolPriority)
+{
+    Entry &entry = entries[id];
+    entry.requestInFlight = true;
+    ++inFlight;
+
+    const QString path = entry.path;
+    const QByteArray encoded = entry.encoded;   // Shallow: points into the caller's data
+    const FallbackFunction fallback = entry.fallback;
+    QVector<QSize> sizes;
+    for (int l = level; l <= coarsestLevel; ++l) {
+        sizes.append(QSize(levelWidth(entry, l), levelHeight(entry, l)));
+    }
+
+    workers.start([this, id, level, path, encoded, fallback, sizes]() {
+        PERFTRACE_SCOPE("decode texture level");
+        Decoded result;
+        result.id = id;
+        result.level = level;
+        result.images.append(decodeLevel(path, encoded, fallback, sizes[0].width(), sizes[0].height()));
+        // Coarser tail levels are filtered down from the previous one rather than decoded again
+        for (int i = 1; i < sizes.size(); ++i) {
+            // (Smooth scaling may hand back a premultiplied format)
+            result.images.append(toUploadFormat(result.images.last().scaled(sizes[i], Qt::IgnoreAspectRatio,
+                                                                             Qt::SmoothTransformation)));
+        }
+
+        QMutexLocker locker(&decodedMutex);
+        decoded.append(std::move(result));
+    }, poolPriority);
+}
+
+QImage TextureStreamer::decodeLevel(const QString &path, const QByteArray &encoded, const FallbackFunction &fallback,
+                                    int width, int height)
+{
+    const QSize size(width, height);
+    QImage image;
+
+    QBuffer buffer;
+    QImageReader reader;
+    if (encoded.isEmpty()) {
+        reader.setFileName(path);
+    } else {
+        buffer.setData(encoded);
+        buffer.open(QIODevice::ReadOnly);
+        reader.setDevice(&buffer);
+    }
+    if (reader.canRead()) {
+        // JPEG (and a few other) decoders can skip most of the work when asked for a smaller image
+        if (reader.supportsOption(QImageIOHandler::ScaledSize)) {
+            reader.setScaledSize(size);
+        }
+        image = reader.read();
+    }
+    if (image.isNull() && fallback) {
+        image = fallback();
+    }
+    if (image.isNull()) {
+        image = QImage(size, QImage::Format_RGBA8888);
+        image.fill(Qt::gray);
+    }
+
+    if (image.size() != size) {
+        image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    // Rows stay top-down (see TextureUploader)
+    return toUploadFormat(std::move(image));
+}
+
+// ------------------- GL Side (render thread) -------------------
+
+void TextureStreamer::requestScreenSize(int id, float screenPixels)
+{
+    if (id < 0 || id >= entries.size()) {
+        return;
+    }
+    Entry &entry = entries[id];
+    entry.lastRequestedFrame = frame;
+    entry.screenPixels = screenPixels;
+
+    if (screenPixels <= 0.0f) {
+        entry.wantedBase = entry.tailLevel;
+        return;
+    }
+    // One texel per pixel: every halving of the footprint drops one level
+    const float ratio = float(qMax(entry.width, entry.height)) / screenPixels;
+    const int level = ratio <= 1.0f ? 0 : int(std::floor(std::log2(ratio)));
+    entry.wantedBase = qBound(0, level, entry.tailLevel);
+}
+
+void TextureStreamer::update()
+{
+    if (!initialized) {
+        return;
+    }
+    PERFTRACE_SCOPE("TextureStreamer::update");
+
+    for (Entry &entry : entries) {
+        if (entry.lastRequestedFrame + VisibleGraceFrames < frame) {
+            entry.screenPixels = 0.0f;
+            entry.wantedBase = entry.tailLevel;
+        }
+    }
+
+    drainDecoded(uploadBudget);
+
+    // Next level for every texture that wants more detail, largest on-screen deficit first
+    QVector<int> wanting;
+    for (int id = 0; id < entries.size(); ++id) {
+        const Entry &entry = entries[id];
+        if (!entry.requestInFlight && entry.residentBase > entry.wantedBase) {
+            wanting.append(id);
+        }
+    }
+    std::sort(wanting.begin(), wanting.end(), [this](int a, int b) {
+        const Entry &ea = entries[a];
+        const Entry &eb = entries[b];
+        return ea.screenPixels * (ea.residentBase - ea.wantedBase) > eb.screenPixels * (eb.residentBase - eb.wantedBase);
+    });
+
+    for (int id : wanting) {
+        if (inFlight >= maxInFlight) {
+            break;
+        }
+        Entry &entry = entries[id];
+        const int level = entry.residentBase - 1;
+        // Only decode what could be uploaded; eviction itself waits until the data has arrived
+        if (makeRoom(levelBytes(entry, level), id, entry.screenPixels, false)) {
+            submit(id, level, level, 0);
+        }
+    }
+
+    ++frame;
+}
+
+void TextureStreamer::drainDecoded(qint64 budget)
+{
+    QVector<Decoded> ready;
+    {
+        QMutexLocker locker(&decodedMutex);
+        ready.swap(decoded);
+    }
+    if (ready.isEmpty()) {
+        return;
+    }
+
+    GLint previousTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    qint64 spent = 0;
+    int next = 0;
+    for (; next < ready.size(); ++next) {
+        const Decoded &result = ready[next];
+        qint64 bytes = 0;
+        for (const QImage &image : result.images) {
+            bytes += image.sizeInBytes();
+        }
+        // Always make progress, even if a single level is larger than the budget
+        if (budget >= 0 && spent > 0 && spent + bytes > budget) {
+            break;
+        }
+
+        Entry &entry = entries[result.id];
+        entry.requestInFlight = false;
+        --inFlight;
+        if (upload(entry, result)) {
+            spent += bytes;
+        } else {
+            ++counters.requestsDiscarded;
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, GLuint(previousTexture));
+
+    if (next < ready.size()) {
+        // Over this frame's budget: keep the rest, ahead of anything finished meanwhile
+        QMutexLocker locker(&decodedMutex);
+        ready.remove(0, next);
+        ready.append(decoded);
+        decoded.swap(ready);
+    }
+}
+
+bool TextureStreamer::upload(Entry &entry, const Decoded &result)
+{
+    const int id = result.id;
+
+    if (entry.residentBase < 0) {
+        // The tail is mandatory: it is what gets sampled while nothing finer is resident
+        qint64 bytes = 0;
+        for (int i = 0; i < result.images.size(); ++i) {
+            bytes += levelBytes(entry, result.level + i);
+        }
+        makeRoom(bytes, id, std::numeric_limits<float>::max(), true);
+        if (resident + bytes > pool) {
+            qWarning() << "TextureStreamer: mip tails alone exceed the pool of" << pool << "bytes";
+        }
+    } else {
+        // Still wanted, and still the next level down from what is resident?
+        if (result.level != entry.residentBase - 1 || result.level < entry.wantedBase) {
+            return false;
+        }
+        if (!makeRoom(levelBytes(entry, result.level), id, entry.screenPixels, true)) {
+            return false;
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    for (int i = 0; i < result.images.size(); ++i) {
+        const QImage &image = result.images[i];
+        TextureUploader::PixelFormat format;
+        TextureUploader::pixelFormat(image.format(), &format);
+        glTexImage2D(GL_TEXTURE_2D, result.level + i, GL_RGBA8, image.width(), image.height(), 0,
+                     format.format, format.type, image.constBits());
+        ++counters.levelsUploaded;
+        counters.bytesUploaded += image.sizeInBytes();
+        setTrackedBytes(entry, entry.bytes + levelBytes(entry, result.level + i));
+    }
+    // Only now that the level is defined may sampling reach it
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, result.level);
+    entry.residentBase = result.level;
+    return true;
+}
+
+void TextureStreamer::dropLevel(Entry &entry)
+{
+    const int level = entry.residentBase;
+    if (level < 0 || level >= entry.tailLevel) {
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    // Clamp first so the texture never references the level being freed
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    entry.residentBase = level + 1;
+    setTrackedBytes(entry, entry.bytes - levelBytes(entry, level));
+    ++counters.levelsEvicted;
+}
+
+float TextureStreamer::neededPixels(const Entry &entry) const
+{
+    // Detail finer than wanted, or on a texture nobody looked at lately, is free to take
+    if (entry.screenPixels <= 0.0f || entry.residentBase < entry.wantedBase) {
+        return 0.0f;
+    }
+    return entry.screenPixels;
+}
+
+bool TextureStreamer::makeRoom(qint64 bytes, int requester, float requesterPixels, bool evict)
+{
+    if (resident + bytes <= pool) {
+        return true;
+    }
+
+    // Victims: textures whose finest level matters less than the request, least needed and oldest first
+    QVector<int> victims;
+    for (int id = 0; id < entries.size(); ++id) {
+        const Entry &entry = entries[id];
+        if (id != requester && entry.residentBase >= 0 && entry.residentBase < entry.tailLevel
+            && neededPixels(entry) < requesterPixels) {
+            victims.append(id);
+        }
+    }
+    std::sort(victims.begin(), victims.end(), [this](int a, int b) {
+        const float na = neededPixels(entries[a]);
+        const float nb = neededPixels(entries[b]);
+        if (na != nb) {
+            return na < nb;
+        }
+        return entries[a].lastRequestedFrame < entries[b].lastRequestedFrame;
+    });
+
+    qint64 freed = 0;
+    for (int id : victims) {
+        Entry &entry = entries[id];
+        for (int level = entry.residentBase; level < entry.tailLevel; ++level) {
+            if (resident - freed + bytes <= pool) {
+                break;
+            }
+            if (evict) {
+                dropLevel(entry);
+            } else {
+                freed += levelBytes(entry, level);
+            }
+        }
+        if (resident - freed + bytes <= pool) {
+            return true;
+        }
+    }
+    return resident - freed + bytes <= pool;
+}
+
+void TextureStreamer::setTrackedBytes(Entry &entry, qint64 bytes)
+{
+    resident += bytes - entry.bytes;
+    entry.bytes = bytes;
+    GpuMemoryTracker::instance().resize(entry.memory, bytes);
+}
+
+// ------------------- Queries -------------------
+
+GLuint TextureStreamer::textureId(int id) const
+{
+    if (id < 0 || id >= entries.size() || entries[id].residentBase < 0) {
+        return 0;
+    }
+    return entries[id].texture;
+}
+
+int TextureStreamer::residentLevel(int id) const
+{
+    if (id < 0 || id >= entries.size()) {
+        return -1;
+    }
+    return entries[id].residentBase;
+}
+
+void TextureStreamer::release()
+{
+    workers.clear();
+    workers.waitForDone();
+    {
+        QMutexLocker locker(&decodedMutex);
+        decoded.clear();
+    }
+
+    GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+    for (Entry &entry : entries) {
+        if (entry.texture != 0) {
+            glDeleteTextures(1, &entry.texture);
+            entry.texture = 0;
+        }
+        memory.release(entry.memory);
+    }
+    entries.clear();
+    resident = 0;
+    inFlight = 0;
+    initialized = false;
+}
+
+TextureStreamer::Stats TextureStreamer::stats() const
+{
+    Stats result = counters;
+    result.residentBytes = resident;
+    result.pendingRequests = inFlight;
+    return result;
+}
+
+QString TextureStreamer::report() const
+{
+    const Stats s = stats();
+    return QString("TextureStreamer: %1 textures, %2 / %3 MiB resident, %4 levels uploaded (%5 MiB), "
+                   "%6 evicted, %7 discarded, %8 pending")
+        .arg(s.textures)
+        .arg(s.residentBytes / (1024.0 * 1024.0), 0, 'f', 2)
+        .arg(s.poolBytes / (1024.0 * 1024.0), 0, 'f', 2)
+        .arg(s.levelsUploaded)
+        .arg(s.bytesUploaded / (1024.0 * 1024.0), 0, 'f', 2)
+        .arg(s.levelsEvicted)
+        .arg(s.requestsDiscarded)
+        .arg(s.pendingRequests);
+}
@@ -0,0 +1,164 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
+#include "gpumemory.h"
+
+/**
+ * @brief Mip-level texture streaming under a fixed GPU memory pool.
+ *
+ * Each texture starts with only its low-resolution mip tail (every level no
+ * larger than tailSize) resident. Finer levels are streamed in one at a time,
+ * coarse to fine, for textures whose projected screen size asks for them:
+ * the owner reports that size every frame with requestScreenSize().
+ *
+ * Only the resident levels are ever defined. GL_TEXTURE_BASE_LEVEL is clamped
+ * to the finest resident level, so the texture stays complete while levels
+ * come and go, and evicting a level redefines it as 0x0 to free its storage.
+ *
+ * Decoding and downsampling run on a worker pool. The GL uploads they produce
+ * are applied in update() on the render thread, limited to a byte budget per
+ * frame, in priority order (largest on-screen deficit first). When the pool is
+ * full, levels of textures that are off screen, or want less detail than they
+ * have, are evicted first; a request that would only fit by evicting
+ * higher-priority detail waits instead.
+ *
+ * All GL calls must be made with the owning context current.
+ */
+class TextureStreamer : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    // Builds the full-resolution source on a worker thread when the file cannot be read
+    using FallbackFunction = std::function<QImage()>;
+
+    struct Stats {
+        int textures = 0;
+        qint64 residentBytes = 0;
+        qint64 poolBytes = 0;
+        quint64 levelsUploaded = 0;
+        quint64 levelsEvicted = 0;
+        qint64 bytesUploaded = 0;
+        quint64 requestsDiscarded = 0;   // Decoded but no longer wanted when they arrived
+        int pendingRequests = 0;
+    };
+
+    TextureStreamer();
+    ~TextureStreamer();
+
+    /**
+     * @brief Sets up the worker pool. Context must be current.
+     * @param poolBytes GPU memory available to all streamed textures, tails included.
+     * @param tailSize Levels whose larger side is at most this many texels stay resident.
+     * @param uploadBytesPerFrame Upload budget of a single update() call.
+     * @param workerThreads Decoder threads; 0 picks QThread::idealThreadCount() - 1.
+     */
+    void initialize(qint64 poolBytes, int tailSize = 32, qint64 uploadBytesPerFrame = 4 * 1024 * 1024,
+                    int workerThreads = 0);
+
+    /**
+     * @brief Registers a texture and queues the decode of its mip tail.
+     * @param encoded If not empty, the encoded image (e.g. an AssetPack view) used instead of
+     *        reading @p filePath; it must stay valid until release().
+     * @return Id used by the other calls, or -1 if the source has no size.
+     */
+    int addTexture(const QString &filePath, FallbackFunction fallback = {}, const QByteArray &encoded = QByteArray());
+
+    /**
+     * @brief Blocks until every registered texture has its tail uploaded.
+     */
+    void waitForTails();
+
+    /**
+     * @brief Reports how large texture @p id appears this frame.
+     * @param screenPixels Larger side of its projected footprint, in device pixels.
+     */
+    void requestScreenSize(int id, float screenPixels);
+
+    /**
+     * @brief Applies finished decodes, evicts unneeded levels and issues new requests.
+     *
+     * Call once per frame, after the requestScreenSize() calls of the previous frame.
+     */
+    void update();
+
+    /**
+     * @brief GL name to bind for texture @p id (0 until its tail has been uploaded).
+     */
+    GLuint textureId(int id) const;
+    int residentLevel(int id) const;   // Finest resident level, 0 = full resolution
+
+    /**
+     * @brief Deletes all textures and waits for the workers. Context must be current.
+     */
+    void release();
+
+    Stats stats() const;
+    QString report() const;
+
+private:
+    struct Entry {
+        QString path;
+        QByteArray encoded;
+        FallbackFunction fallback;
+        GLuint texture = 0;
+        int width = 0;            // Level 0
+        int height = 0;
+        int levelCount = 0;
+        int tailLevel = 0;        // Finest level of the always-resident tail
+        int residentBase = -1;    // -1 until the tail is uploaded
+        int wantedBase = 0;
+        float screenPixels = 0.0f;
+        quint64 lastRequestedFrame = 0;
+        bool requestInFlight = false;
+        qint64 bytes = 0;
+        GpuMemoryTracker::Handle memory = 0;
+    };
+
+    struct Decoded {
+        int id = 0;
+        int level = 0;             // Finest level in images
+        QVector<QImage> images;   // images[i] is level (level + i)
+    };
+
+    void submit(int id, int level, int coarsestLevel, int poolPriority);
+    static QImage decodeLevel(const QString &path, const QByteArray &encoded, const FallbackFunction &fallback,
+                              int width, int height);
+    void drainDecoded(qint64 budget);   // budget < 0 applies everything
+    bool upload(Entry &entry, const Decoded &result);
+    void dropLevel(Entry &entry);
+    bool makeRoom(qint64 bytes, int requester, float requesterPixels, bool evict);
+    float neededPixels(const Entry &entry) const;   // How much the finest resident level is worth keeping
+    void setTrackedBytes(Entry &entry, qint64 bytes);
+    int levelWidth(const Entry &entry, int level) const { return qMax(1, entry.width >> level); }
+    int levelHeight(const Entry &entry, int level) const { return qMax(1, entry.height >> level); }
+    qint64 levelBytes(const Entry &entry, int level) const
+    {
+        return qint64(levelWidth(entry, level)) * levelHeight(entry, level) * 4;
+    }
+
+    bool initialized = false;
+    qint64 pool = 0;
+    int tail = 32;
+    qint64 uploadBudget = 0;
+    int maxInFlight = 0;
+    int inFlight = 0;
+    quint64 frame = 0;
+    qint64 resident = 0;
+
+    QVector<Entry> entries;
+    QThreadPool workers;
+
+    // Filled by the workers, drained by update()
+    QMutex decodedMutex;
+    QVector<Decoded> decoded;
+
+    Stats counters;
+};
+
+#endif // TEXTURESTREAMER_H
@@ -0,0 +1,225 @@
+#include "textureupload.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QImageReader>
+#include <cstring>
+
+void TextureUploader::initialize()
+{
+    initializeOpenGLFunctions();
+}
+
+void TextureUploader::release()
+{
+    if (staging != 0) {
+        glDeleteBuffers(1, &staging);
+        staging = 0;
+    }
+    stagingCapacity = 0;
+    counters.stagingBytes = 0;
+    GpuMemoryTracker::instance().release(stagingMemory);
+    stagingMemory = 0;
+}
+
+bool TextureUploader::pixelFormat(QImage::Format format, PixelFormat *out)
+{
+    switch (format) {
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBX8888:
+        *out = { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4 };
+        return true;
+    case QImage::Format_ARGB32:
+    case QImage::Format_RGB32:
+        // 0xAARRGGBB words (alpha 0xff for RGB32) in native byte order
+        *out = { GL_RGBA8, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 4 };
+        return true;
+    case QImage::Format_RGB888:
+        *out = { GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 3 };
+        return true;
+    case QImage::Format_Grayscale8:
+        *out = { GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1 };
+        return true;
+    default:
+        return false;
+    }
+}
+
+// ------------------- Upload -------------------
+
+uchar *TextureUploader::mapStaging(qint64 bytes)
+{
+    if (staging == 0) {
+        glGenBuffers(1, &staging);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+
+    if (bytes > stagingCapacity) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        stagingCapacity = bytes;
+        counters.stagingBytes = bytes;
+
+        GpuMemoryTracker &memory = GpuMemoryTracker::instance();
+        if (stagingMemory == 0) {
+            stagingMemory = memory.registerAllocation(GpuMemoryTracker::Category::PixelBuffer, bytes,
+                                                      "TextureUploader", "staging PBO");
+        } else {
+            memory.resize(stagingMemory, bytes);
+        }
+    }
+
+    // Invalidating lets the driver hand out fresh storage if the previous upload is still reading
+    return static_cast<uchar *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+}
+
+GLuint TextureUploader::uploadFile(const QString &filePath, bool mipmaps, QSize *size)
+{
+    QImageReader reader(filePath);
+    return uploadFromReader(reader, filePath, mipmaps, size);
+}
+
+GLuint TextureUploader::uploadData(const QByteArray &encoded, bool mipmaps, QSize *size)
+{
+    // QBuffer shares the bytes (no copy), so the decoder reads the mapping directly
+    QBuffer buffer;
+    buffer.setData(encoded);
+    if (!buffer.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QImageReader reader(&buffer);
+    return uploadFromReader(reader, "<memory>", mipmaps, size);
+}
+
+GLuint TextureUploader::uploadFromReader(QImageReader &reader, const QString &source, bool mipmaps, QSize *size)
+{
+    const QSize imageSize = reader.size();
+    const QImage::Format imageFormat = reader.imageFormat();
+
+    PixelFormat format;
+    if (!imageSize.isValid() || !pixelFormat(imageFormat, &format)) {
+        // Unknown size or a layout GL cannot take (e.g. palette PNGs): decode, convert once
+        QImage image = reader.read();
+        if (image.isNull()) {
+            return 0;
+        }
+        if (size) {
+            *size = image.size();
+        }
+        return uploadImage(image, mipmaps);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // QImage scanlines are 32-bit aligned, which is also GL's default unpack alignment
+    const int bytesPerLine = (imageSize.width() * format.bytesPerPixel + 3) & ~3;
+    const qint64 bytes = qint64(bytesPerLine) * imageSize.height();
+    uchar *mapped = mapStaging(bytes);
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        qWarning() << "TextureUploader: glMapBufferRange failed for" << source;
+        return 0;
+    }
+
+    // A QImage over the mapped memory: the decoder fills it in place as long as
+    // the size and format it produces are the ones the header announced.
+    QImage target(mapped, imageSize.width(), imageSize.height(), bytesPerLine, imageFormat);
+    bool ok = reader.read(&target);
+    if (ok && target.constBits() != mapped) {
+        // The decoder allocated its own image after all: one conversion + copy
+        target.convertTo(imageFormat);
+        if (target.size() == imageSize) {
+            for (int y = 0; y < imageSize.height(); ++y) {
+                std::memcpy(mapped + qsizetype(bytesPerLine) * y, target.constScanLine(y), size_t(bytesPerLine));
+            }
+            ++counters.converted;
+        } else {
+            ok = false;
+        }
+    } else if (ok) {
+        ++counters.decodedInPlace;
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    counters.lastDecodeMs = timer.nsecsElapsed() / 1.0e6;
+
+    GLuint texture = 0;
+    if (ok) {
+        // With an unpack buffer bound, the pixel pointer is an offset into it
+        texture = createTexture(format, imageSize.width(), imageSize.height(), nullptr, mipmaps);
+        if (size) {
+            *size = imageSize;
+        }
+    } else {
+        qWarning() << "TextureUploader: cannot decode" << source << ":" << reader.errorString();
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return texture;
+}
+
+GLuint TextureUploader::uploadImage(const QImage &image, bool mipmaps)
+{
+    if (image.isNull()) {
+        return 0;
+    }
+
+    PixelFormat format;
+    if (pixelFormat(image.format(), &format)) {
+        counters.lastDecodeMs = 0.0;
+        return createTexture(format, image.width(), image.height(), image.constBits(), mipmaps);
+    }
+
+    const QImage converted = image.convertToFormat(QImage::Format_RGBA8888);
+    pixelFormat(converted.format(), &format);
+    ++counters.converted;
+    counters.lastDecodeMs = 0.0;
+    return createTexture(format, converted.width(), converted.height(), converted.constBits(), mipmaps);
+}
+
+GLuint TextureUploader::createTexture(const PixelFormat &pixelFormat, int width, int height, const void *pixels,
+                                      bool mipmaps)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    GLint previousTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, pixelFormat.internalFormat, width, height, 0,
+                 pixelFormat.format, pixelFormat.type, pixels);
+
+    if (pixelFormat.format == GL_RED) {
+        // Sample grayscale as (l, l, l, 1) like the RGBA texture it replaces
+        const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    if (mipmaps) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, GLuint(previousTexture));
+
+    ++counters.uploads;
+    counters.bytesUploaded += qint64(width) * height * pixelFormat.bytesPerPixel;
+    counters.lastUploadMs = timer.nsecsElapsed() / 1.0e6;
+    return texture;
+}
+
+QString TextureUploader::report() const
+{
+    return QString("TextureUploader: %1 uploads (%2 decoded in place, %3 converted), %4 MiB uploaded, "
+                   "staging buffer %5 MiB")
+        .arg(counters.uploads)
+        .arg(counters.decodedInPlace)
+        .arg(counters.converted)
+        .arg(counters.bytesUploaded / (1024.0 * 1024.0), 0, 'f', 2)
+        .arg(counters.stagingBytes / (1024.0 * 1024.0), 0, 'f', 2);
+}
@@ -0,0 +1,97 @@
+#ifndef TEXTUREUPLOAD_H
+#define TEXTUREUPLOAD_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include "gpumemory.h"
+
+class QImageReader;
+
+/**
+ * @brief Texture upload path without intermediate QImage copies.
+ *
+ * uploadFile() asks QImageReader for the size and pixel format up front,
+ * maps a GL_PIXEL_UNPACK_BUFFER of exactly that layout and lets the decoder
+ * write its scanlines straight into the mapped memory. The texture is then
+ * created from the buffer, so the only CPU-side copy of the pixels is the
+ * one the decoder produces. The staging buffer is kept and reused (orphaned
+ * on every map) for the next upload.
+ *
+ * No format conversion happens on the CPU: Qt's 32-bit ARGB layout is handed
+ * to GL as GL_BGRA / GL_UNSIGNED_INT_8_8_8_8_REV, RGB888 as GL_RGB and
+ * Grayscale8 as a swizzled GL_RED texture. Only formats GL cannot take
+ * directly (indexed, premultiplied, 16-bit ...) are converted, once.
+ *
+ * Rows are not flipped either: row 0 of the texture is the top of the image.
+ * Shaders sample it with v = 1.0 - v instead of the image being mirrored.
+ *
+ * All GL calls must be made with the owning context current.
+ */
+class TextureUploader : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Stats {
+        int uploads = 0;
+        int decodedInPlace = 0;   // Decoder wrote straight into the staging buffer
+        int converted = 0;        // Needed one conversion / copy on the CPU
+        qint64 stagingBytes = 0;  // Current size of the staging buffer
+        qint64 bytesUploaded = 0;
+        double lastDecodeMs = 0.0;
+        double lastUploadMs = 0.0;   // glTexImage2D (+ glGenerateMipmap) submission
+    };
+
+    struct PixelFormat {
+        GLint internalFormat = GL_RGBA8;
+        GLenum format = GL_RGBA;
+        GLenum type = GL_UNSIGNED_BYTE;
+        int bytesPerPixel = 4;
+    };
+
+    TextureUploader() = default;
+
+    void initialize();
+    /**
+     * @brief Deletes the staging buffer. Textures already created are owned by the caller.
+     */
+    void release();
+
+    /**
+     * @brief Decodes @p filePath into the staging buffer and creates a 2D texture from it.
+     * @param size Receives the texture size if not null.
+     * @return Texture name, or 0 if the file cannot be decoded.
+     */
+    GLuint uploadFile(const QString &filePath, bool mipmaps, QSize *size = nullptr);
+
+    /**
+     * @brief Same as uploadFile() for an encoded image already in memory (e.g. an AssetPack view).
+     */
+    GLuint uploadData(const QByteArray &encoded, bool mipmaps, QSize *size = nullptr);
+
+    /**
+     * @brief Creates a 2D texture straight from the pixels of @p image (top row first).
+     */
+    GLuint uploadImage(const QImage &image, bool mipmaps);
+
+    Stats stats() const { return counters; }
+    QString report() const;
+
+    /**
+     * @brief GL upload parameters for pixels already in Qt format @p format.
+     * @return false if GL cannot consume that layout directly.
+     */
+    static bool pixelFormat(QImage::Format format, PixelFormat *out);
+
+private:
+    GLuint uploadFromReader(QImageReader &reader, const QString &source, bool mipmaps, QSize *size);
+    uchar *mapStaging(qint64 bytes);
+    GLuint createTexture(const PixelFormat &pixelFormat, int width, int height, const void *pixels, bool mipmaps);
+
+    GLuint staging = 0;
+    qint64 stagingCapacity = 0;
+    GpuMemoryTracker::Handle stagingMemory = 0;
+    Stats counters;
+};
+
+#endif // TEXTUREUPLOAD_H
@@ -0,0 +1,194 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QVector>
+#include <algorithm>
+#include "assetpackformat.h"
+
+// Packs loose asset files into one archive read by common/assetpack.h.
+// Asset names are the paths relative to <root>, with '/' separators, so a stage
+// looks up "textures/dice_face_1.png" exactly as it used to open it.
+
+using namespace assetpack;
+
+struct Input {
+    QString name;
+    QString filePath;
+    QByteArray utf8;
+    quint64 size = 0;
+    Type type = Type::Other;
+};
+
+static Type typeForSuffix(const QString &suffix)
+{
+    static const QStringList textures = { "png", "jpg", "jpeg", "bmp", "tga", "ktx", "dds", "webp" };
+    static const QStringList shaders = { "vert", "frag", "geom", "glsl", "comp" };
+    static const QStringList meshes = { "obj", "mesh", "gltf", "glb", "ply" };
+    const QString key = suffix.toLower();
+    if (textures.contains(key)) {
+        return Type::Texture;
+    }
+    if (shaders.contains(key)) {
+        return Type::Shader;
+    }
+    if (meshes.contains(key)) {
+        return Type::Mesh;
+    }
+    return Type::Other;
+}
+
+static quint64 alignUp(quint64 value, quint64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool collect(const QDir &root, const QString &path, QVector<Input> *inputs)
+{
+    const QFileInfo info(root.filePath(path));
+    QStringList files;
+    if (info.isDir()) {
+        QDirIterator it(info.filePath(), QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            files << it.next();
+        }
+    } else if (info.isFile()) {
+        files << info.filePath();
+    } else {
+        qWarning() << "assetpacker: no such file or directory:" << info.filePath();
+        return false;
+    }
+
+    for (const QString &file : files) {
+        Input input;
+        input.filePath = file;
+        input.name = root.relativeFilePath(file);
+        input.utf8 = input.name.toUtf8();
+        input.size = quint64(QFileInfo(file).size());
+        input.type = typeForSuffix(QFileInfo(file).suffix());
+        inputs->append(input);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Packs asset files into a memory-mappable archive.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("output", "Archive to write, e.g. assets.pak.");
+    parser.addPositionalArgument("root", "Directory the asset names are relative to.");
+    parser.addPositionalArgument("paths", "Files or directories under <root> to pack (default: all of it).", "[paths...]");
+    parser.process(app);
+
+    QStringList args = parser.positionalArguments();
+    if (args.size() < 2) {
+        parser.showHelp(1);
+    }
+    const QString outputPath = args.takeFirst();
+    const QDir root(args.takeFirst());
+    if (args.isEmpty()) {
+        args << ".";
+    }
+
+    QVector<Input> inputs;
+    for (const QString &path : args) {
+        if (!collect(root, path, &inputs)) {
+            return 1;
+        }
+    }
+    // Sorted names make the archive reproducible and keep related assets next to each other
+    std::sort(inputs.begin(), inputs.end(), [](const Input &a, const Input &b) { return a.name < b.name; });
+    inputs.erase(std::unique(inputs.begin(), inputs.end(),
+                             [](const Input &a, const Input &b) { return a.name == b.name; }),
+                 inputs.end());
+    const QString outputName = root.relativeFilePath(QFileInfo(outputPath).absoluteFilePath());
+    inputs.erase(std::remove_if(inputs.begin(), inputs.end(),
+                                [&outputName](const Input &input) { return input.name == outputName; }),
+                 inputs.end());
+
+    // ---- Index ----
+    PackHeader header;
+    header.entryCount = quint32(inputs.size());
+    header.bucketCount = 1;
+    while (header.bucketCount < 2 * header.entryCount) {
+        header.bucketCount *= 2;
+    }
+
+    QVector<PackEntry> entries(inputs.size());
+    QVector<quint32> buckets(int(header.bucketCount), EmptyBucket);
+    QByteArray names;
+    for (int i = 0; i < inputs.size(); ++i) {
+        PackEntry &entry = entries[i];
+        entry.nameHash = hashName(inputs[i].utf8.constData(), inputs[i].utf8.size());
+        entry.nameOffset = quint32(names.size());
+        entry.nameSize = quint32(inputs[i].utf8.size());
+        entry.size = inputs[i].size;
+        entry.type = inputs[i].type;
+        names += inputs[i].utf8;
+
+        quint32 b = quint32(entry.nameHash) & (header.bucketCount - 1);
+        while (buckets[int(b)] != EmptyBucket) {
+            b = (b + 1) & (header.bucketCount - 1);
+        }
+        buckets[int(b)] = quint32(i);
+    }
+
+    header.namesOffset = sizeof(PackHeader) + quint64(entries.size()) * sizeof(PackEntry)
+                         + quint64(buckets.size()) * sizeof(quint32);
+    header.namesSize = quint64(names.size());
+
+    quint64 cursor = header.namesOffset + header.namesSize;
+    for (PackEntry &entry : entries) {
+        entry.offset = alignUp(cursor, BlobAlignment);
+        cursor = entry.offset + entry.size;
+    }
+    header.fileSize = cursor;
+
+    // ---- Write ----
+    QSaveFile out(outputPath);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << "assetpacker: cannot write" << outputPath;
+        return 1;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(entries.constData()), qint64(entries.size()) * sizeof(PackEntry));
+    out.write(reinterpret_cast<const char *>(buckets.constData()), qint64(buckets.size()) * sizeof(quint32));
+    out.write(names);
+
+    quint64 written = header.namesOffset + header.namesSize;
+    for (int i = 0; i < inputs.size(); ++i) {
+        out.write(QByteArray(int(entries[i].offset - written), '\0'));
+        QFile file(inputs[i].filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "assetpacker: cannot read" << inputs[i].filePath;
+            out.cancelWriting();
+            return 1;
+        }
+        const QByteArray bytes = file.readAll();
+        if (quint64(bytes.size()) != entries[i].size) {
+            qWarning() << "assetpacker:" << inputs[i].filePath << "changed while packing";
+            out.cancelWriting();
+            return 1;
+        }
+        out.write(bytes);
+        written = entries[i].offset + entries[i].size;
+    }
+
+    if (!out.commit()) {
+        qWarning() << "assetpacker: cannot write" << outputPath << ":" << out.errorString();
+        return 1;
+    }
+
+    qInfo().noquote() << QString("assetpacker: %1 assets, %2 KiB -> %3")
+                             .arg(inputs.size())
+                             .arg(header.fileSize / 1024.0, 0, 'f', 1)
+                             .arg(outputPath);
+    return 0;
+}
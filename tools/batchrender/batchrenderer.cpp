@@ -0,0 +1,793 @@
+#include "batchrenderer.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMatrix4x4>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QSemaphore>
+#include <QSet>
+#include <QSurfaceFormat>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include "meshfile.h"
+#include "meshgen.h"
+#include "shadervariants.h"
+#include "textureupload.h"
+
+// Textured meshes: TextureUploader keeps rows top first, hence FlipV (as in 06)
+static constexpr ShaderFeatures texturedFeatures =
+    vertexFeatures<meshgen::PosUv>() | ShaderFeatures::Transform | ShaderFeatures::FlipV;
+// Mesh files without texture coordinates: their colors (or normals) at location 1, as in 05
+static constexpr ShaderFeatures coloredFeatures = ShaderFeatures::VertexColor | ShaderFeatures::Transform;
+
+static const char *const builtInMeshes[] = { "cube", "sphere", "torus", "plane" };
+
+static bool isBuiltInMesh(const QString &mesh)
+{
+    for (const char *name : builtInMeshes) {
+        if (mesh == QLatin1String(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Where render threads hand their images: the encoder pool and its bounded queue.
+ */
+struct EncodeQueue {
+    BatchRenderer *owner = nullptr;
+    QString outputDir;
+    int pngQuality = 80;
+    QThreadPool encoders;
+    QSemaphore freeSlots;                       // One per image that may wait for an encoder
+};
+
+// ------------------- Render Worker -------------------
+
+/**
+ * @brief The GL side of one render thread; lives and dies on that thread.
+ */
+class RenderWorker : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    RenderWorker(EncodeQueue &queue, const BatchRenderer::Params &params) : queue(queue), params(params) {}
+
+    bool initialize(QOffscreenSurface *surface);
+    void render(const BatchJob &job);
+    /**
+     * @brief Hands the last readback to the encoders, deletes every GL object and reports.
+     */
+    void finish();
+
+private:
+    struct GpuMesh {
+        GLuint vao = 0;
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+        GLsizei indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+        int faces = 1;                          // Equal index ranges drawn with their own texture (cube: 6)
+        ShaderFeatures features = texturedFeatures;
+        bool constantColor = false;             // No color stream: location 1 is a constant
+        QMatrix4x4 fit;                         // Into the unit box; identity for the built-in meshes
+        bool failed = false;
+    };
+
+    struct CachedTexture {
+        GLuint texture = 0;
+        quint64 lastUse = 0;
+    };
+
+    struct Readback {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        QString path;
+        int width = 0;
+        int height = 0;
+    };
+
+    const GpuMesh &mesh(const QString &name);
+    bool uploadMesh(const QString &name, GpuMesh *gpu);
+    GLuint texture(const QString &path);
+    bool ensureTargets(const QSize &size);
+    void releaseTargets();
+    void retire(Readback &readback);
+
+    EncodeQueue &queue;
+    BatchRenderer::Params params;
+    std::unique_ptr<QOpenGLContext> context;
+    QOffscreenSurface *surface = nullptr;
+
+    ShaderVariantCache shaderVariants;
+    TextureUploader uploader;
+    QHash<QString, GpuMesh> meshes;
+    QHash<QString, CachedTexture> textures;
+    QSet<QString> missingTextures;
+    GLuint checkerTexture = 0;
+    quint64 useCounter = 0;
+
+    QSize targetSize;
+    GLuint multisampleFramebuffer = 0;
+    GLuint multisampleColor = 0;
+    GLuint multisampleDepth = 0;
+    GLuint resolveFramebuffer = 0;
+    GLuint resolveColor = 0;
+    GLuint resolveDepth = 0;
+    Readback readbacks[2];
+    int nextReadback = 0;
+
+    BatchRenderer::Stats counters;
+};
+
+bool RenderWorker::initialize(QOffscreenSurface *offscreen)
+{
+    surface = offscreen;
+    context.reset(new QOpenGLContext);
+    context->setFormat(surface->format());
+    if (!context->create() || !context->makeCurrent(surface)) {
+        qWarning() << "BatchRenderer: cannot create an OpenGL 3.3 core context on a render thread";
+        context.reset();
+        return false;
+    }
+    initializeOpenGLFunctions();
+    uploader.initialize();
+
+    // Jobs without textures, and textures that do not load, get a checkerboard
+    QImage checker(64, 64, QImage::Format_RGB32);
+    for (int y = 0; y < checker.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(checker.scanLine(y));
+        for (int x = 0; x < checker.width(); ++x) {
+            line[x] = ((x / 8 + y / 8) & 1) ? qRgb(200, 200, 200) : qRgb(120, 120, 120);
+        }
+    }
+    checkerTexture = uploader.uploadImage(checker, true);
+
+    for (Readback &readback : readbacks) {
+        glGenBuffers(1, &readback.pbo);
+    }
+    glEnable(GL_DEPTH_TEST);
+    counters.renderThreads = 1;
+    return true;
+}
+
+void RenderWorker::render(const BatchJob &job)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const GpuMesh &gpu = mesh(job.mesh);
+    const ShaderVariant *variant = gpu.failed ? nullptr : shaderVariants.variant(gpu.features);
+    if (!variant || !ensureTargets(job.size)) {
+        ++counters.failed;
+        return;
+    }
+
+    const int width = job.size.width();
+    const int height = job.size.height();
+    glBindFramebuffer(GL_FRAMEBUFFER, multisampleFramebuffer ? multisampleFramebuffer : resolveFramebuffer);
+    glViewport(0, 0, width, height);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glClearColor(0.9f, 0.9f, 0.9f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Alpha stays 1, so the pixels are valid QImage::Format_RGBX8888
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
+
+    // Upside down (y flipped in clip space): glReadPixels() then returns the top row first
+    QMatrix4x4 projection;
+    projection.scale(1.0f, -1.0f, 1.0f);
+    projection.perspective(job.fieldOfView, float(width) / float(height), 0.05f, 100.0f);
+    QMatrix4x4 view;
+    view.lookAt(job.eye, job.target, QVector3D(0.0f, 1.0f, 0.0f));
+    QMatrix4x4 model;
+    model.rotate(job.rotation.x(), 1.0f, 0.0f, 0.0f);
+    model.rotate(job.rotation.y(), 0.0f, 1.0f, 0.0f);
+    model.rotate(job.rotation.z(), 0.0f, 0.0f, 1.0f);
+    model *= gpu.fit;
+
+    QOpenGLShaderProgram *program = variant->program;
+    program->bind();
+    program->setUniformValue(variant->projection, projection);
+    program->setUniformValue(variant->view, view);
+    program->setUniformValue(variant->model, model);
+    glBindVertexArray(gpu.vao);
+    if (gpu.constantColor) {
+        glVertexAttrib3f(1, 0.6f, 0.6f, 0.6f);
+    }
+
+    const GLsizei faceIndices = gpu.indexCount / gpu.faces;
+    const size_t indexBytes = gpu.indexType == GL_UNSIGNED_SHORT ? sizeof(quint16) : sizeof(quint32);
+    if (gpu.features.has(ShaderFeatures::TexCoord)) {
+        program->setUniformValue(variant->textureSampler, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    for (int face = 0; face < gpu.faces; ++face) {
+        if (gpu.features.has(ShaderFeatures::TexCoord)) {
+            const GLuint faceTexture = job.textures.isEmpty()
+                                           ? checkerTexture
+                                           : texture(job.textures.at(face % job.textures.size()));
+            glBindTexture(GL_TEXTURE_2D, faceTexture);
+        }
+        glDrawElements(GL_TRIANGLES, faceIndices, gpu.indexType,
+                       reinterpret_cast<const void *>(face * faceIndices * indexBytes));
+    }
+    glBindVertexArray(0);
+    program->release();
+
+    if (multisampleFramebuffer) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampleFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+
+    // Read back into this job's PBO; the previous job's is mapped only once this one is queued
+    Readback &readback = readbacks[nextReadback];
+    nextReadback = 1 - nextReadback;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFramebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(width) * height * 4, nullptr, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.path = queue.outputDir + '/' + job.name + ".png";
+    readback.width = width;
+    readback.height = height;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    counters.renderMilliseconds += timer.nsecsElapsed() / 1.0e6;
+
+    retire(readbacks[nextReadback]);
+}
+
+void RenderWorker::retire(Readback &readback)
+{
+    if (!readback.fence) {
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    while (glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    const double waitMs = timer.nsecsElapsed() / 1.0e6;
+
+    // Bounded: with the encoders behind, rendering further would only pile up pixels
+    timer.restart();
+    queue.freeSlots.acquire();
+    counters.queueWaitMilliseconds += timer.nsecsElapsed() / 1.0e6;
+
+    timer.restart();
+    const qsizetype bytes = qsizetype(readback.width) * readback.height * 4;
+    QByteArray pixels(bytes, Qt::Uninitialized);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    const bool ok = mapped != nullptr;
+    if (ok) {
+        std::memcpy(pixels.data(), mapped, size_t(bytes));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    counters.readbackMilliseconds += waitMs + timer.nsecsElapsed() / 1.0e6;
+    if (!ok) {
+        qWarning() << "BatchRenderer: glMapBufferRange failed for" << readback.path;
+        ++counters.failed;
+        queue.freeSlots.release();
+        return;
+    }
+
+    EncodeQueue *target = &queue;
+    const QString path = readback.path;
+    const int width = readback.width;
+    const int height = readback.height;
+    queue.encoders.start([target, pixels, path, width, height]() {
+        QElapsedTimer encodeTimer;
+        encodeTimer.start();
+        // Wraps the pixels without a copy
+        const QImage image(reinterpret_cast<const uchar *>(pixels.constData()), width, height, width * 4,
+                           QImage::Format_RGBX8888);
+        const bool written = image.save(path, "PNG", target->pngQuality);
+        if (!written) {
+            qWarning() << "BatchRenderer: cannot write" << path;
+        }
+        const qint64 fileBytes = written ? QFileInfo(path).size() : 0;
+        target->owner->addEncoded(written, fileBytes, encodeTimer.nsecsElapsed() / 1.0e6);
+        target->freeSlots.release();
+    });
+}
+
+void RenderWorker::finish()
+{
+    if (!context) {
+        return;
+    }
+    retire(readbacks[nextReadback]);
+    retire(readbacks[1 - nextReadback]);
+
+    for (const GpuMesh &gpu : std::as_const(meshes)) {
+        glDeleteVertexArrays(1, &gpu.vao);
+        glDeleteBuffers(1, &gpu.vertexBuffer);
+        glDeleteBuffers(1, &gpu.indexBuffer);
+    }
+    meshes.clear();
+    for (const CachedTexture &cached : std::as_const(textures)) {
+        glDeleteTextures(1, &cached.texture);
+    }
+    textures.clear();
+    glDeleteTextures(1, &checkerTexture);
+    for (Readback &readback : readbacks) {
+        glDeleteBuffers(1, &readback.pbo);
+    }
+    releaseTargets();
+    uploader.release();
+    shaderVariants.release();
+
+    const QString name = QString::fromLatin1(reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+    context->doneCurrent();
+    context.reset();
+    queue.owner->addWorkerStats(counters, name);
+}
+
+const RenderWorker::GpuMesh &RenderWorker::mesh(const QString &name)
+{
+    auto it = meshes.find(name);
+    if (it == meshes.end()) {
+        it = meshes.insert(name, GpuMesh());
+        if (!uploadMesh(name, &it.value())) {
+            it->failed = true;
+        }
+        ++counters.meshLoads;
+    }
+    return it.value();
+}
+
+bool RenderWorker::uploadMesh(const QString &name, GpuMesh *gpu)
+{
+    glGenVertexArrays(1, &gpu->vao);
+    glGenBuffers(1, &gpu->vertexBuffer);
+    glGenBuffers(1, &gpu->indexBuffer);
+    glBindVertexArray(gpu->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, gpu->vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu->indexBuffer);
+
+    if (isBuiltInMesh(name)) {
+        meshgen::Mesh<meshgen::PosUv> generated;
+        if (name == QLatin1String("cube")) {
+            generated = meshgen::makeCube<meshgen::PosUv>(1);
+            gpu->faces = 6; // 6 indices per face, faces in meshgen order
+        } else if (name == QLatin1String("sphere")) {
+            generated = meshgen::makeUvSphere<meshgen::PosUv>(48, 24);
+        } else if (name == QLatin1String("torus")) {
+            generated = meshgen::makeTorus<meshgen::PosUv>(48, 24);
+        } else {
+            generated = meshgen::makeGrid<meshgen::PosUv>(1, 1);
+        }
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(generated.vertexBytes()), generated.vertices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(generated.indexBytes()), generated.indices.data(),
+                     GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, generated.stride(), nullptr);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, generated.stride(),
+                              reinterpret_cast<const void *>(meshgen::PosUv::UvOffset * sizeof(float)));
+        gpu->indexCount = GLsizei(generated.indexCount());
+        glBindVertexArray(0);
+        return true;
+    }
+
+    using namespace meshfile;
+    MeshFile file;
+    const VertexAttribute *position = nullptr;
+    if (!file.open(name) || !(position = file.attribute(Semantic::Position))) {
+        qWarning() << "BatchRenderer: cannot load the mesh" << name;
+        glBindVertexArray(0);
+        return false;
+    }
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(file.vertexDataSize()), file.vertexData(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(file.indexDataSize()), file.indexData(), GL_STATIC_DRAW);
+
+    file.bindAttribute<QOpenGLFunctions_3_3_Core>(this, 0, *position);
+    if (const VertexAttribute *texCoord = file.attribute(Semantic::TexCoord0)) {
+        file.bindAttribute<QOpenGLFunctions_3_3_Core>(this, 2, *texCoord);
+    } else {
+        if (const VertexAttribute *color = file.colorAttribute()) {
+            file.bindAttribute<QOpenGLFunctions_3_3_Core>(this, 1, *color);
+        } else {
+            gpu->constantColor = true;
+        }
+        gpu->features = coloredFeatures;
+    }
+    glBindVertexArray(0);
+
+    gpu->indexType = file.glIndexType();
+    gpu->indexCount = GLsizei(file.drawIndexCount());
+    gpu->fit = file.fitTransform();
+    return true;
+}
+
+GLuint RenderWorker::texture(const QString &path)
+{
+    auto it = textures.find(path);
+    if (it != textures.end()) {
+        it->lastUse = ++useCounter;
+        return it->texture;
+    }
+    if (missingTextures.contains(path)) {
+        return checkerTexture;
+    }
+
+    if (textures.size() >= params.maxCachedTextures) {
+        auto oldest = textures.begin();
+        for (auto candidate = textures.begin(); candidate != textures.end(); ++candidate) {
+            if (candidate->lastUse < oldest->lastUse) {
+                oldest = candidate;
+            }
+        }
+        glDeleteTextures(1, &oldest->texture);
+        textures.erase(oldest);
+        ++counters.textureEvictions;
+    }
+
+    const GLuint name = uploader.uploadFile(path, true);
+    if (name == 0) {
+        qWarning() << "BatchRenderer: cannot load the texture" << path << "- using a checkerboard";
+        missingTextures.insert(path);
+        return checkerTexture;
+    }
+    ++counters.textureLoads;
+    textures.insert(path, CachedTexture{ name, ++useCounter });
+    return name;
+}
+
+bool RenderWorker::ensureTargets(const QSize &size)
+{
+    if (targetSize.width() >= size.width() && targetSize.height() >= size.height()) {
+        return true;
+    }
+    // Grows to cover every job seen so far; smaller jobs use the lower left corner
+    const QSize grown = targetSize.expandedTo(size);
+    releaseTargets();
+
+    const auto create = [this, &grown](GLuint *framebuffer, GLuint *color, GLuint *depth, int samples) {
+        glGenFramebuffers(1, framebuffer);
+        glGenRenderbuffers(1, color);
+        glGenRenderbuffers(1, depth);
+        glBindFramebuffer(GL_FRAMEBUFFER, *framebuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, *color);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, grown.width(), grown.height());
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, *color);
+        glBindRenderbuffer(GL_RENDERBUFFER, *depth);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, grown.width(),
+                                         grown.height());
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, *depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return complete;
+    };
+    if (params.samples > 0
+        && !create(&multisampleFramebuffer, &multisampleColor, &multisampleDepth, params.samples)) {
+        qWarning() << "BatchRenderer:" << params.samples << "samples not supported - rendering without";
+        params.samples = 0;
+        releaseTargets();
+    }
+    if (!create(&resolveFramebuffer, &resolveColor, &resolveDepth, 0)) {
+        qWarning() << "BatchRenderer: cannot create a" << grown << "framebuffer";
+        releaseTargets();
+        return false;
+    }
+    targetSize = grown;
+    return true;
+}
+
+void RenderWorker::releaseTargets()
+{
+    for (GLuint *framebuffer : { &multisampleFramebuffer, &resolveFramebuffer }) {
+        glDeleteFramebuffers(1, framebuffer);
+        *framebuffer = 0;
+    }
+    for (GLuint *renderbuffer : { &multisampleColor, &multisampleDepth, &resolveColor, &resolveDepth }) {
+        glDeleteRenderbuffers(1, renderbuffer);
+        *renderbuffer = 0;
+    }
+    targetSize = QSize();
+}
+
+// ------------------- Batch -------------------
+
+bool BatchRenderer::run(const QVector<BatchJob> &jobs, const QString &outputDir, const Params &params)
+{
+    {
+        QMutexLocker locker(&statsMutex);
+        counters = Stats();
+    }
+    QElapsedTimer wall;
+    wall.start();
+
+    // Every directory an image goes to, made once here instead of by the encoders
+    QSet<QString> directories;
+    for (const BatchJob &job : jobs) {
+        directories.insert(QFileInfo(outputDir + '/' + job.name).absolutePath());
+    }
+    for (const QString &directory : std::as_const(directories)) {
+        if (!QDir().mkpath(directory)) {
+            qWarning() << "BatchRenderer: cannot create" << directory;
+            return false;
+        }
+    }
+
+    const int renderThreads = params.renderThreads > 0 ? params.renderThreads : QThread::idealThreadCount();
+    const int encoderThreads = params.encoderThreads > 0 ? params.encoderThreads : QThread::idealThreadCount();
+    EncodeQueue queue;
+    queue.owner = this;
+    queue.outputDir = outputDir;
+    queue.pngQuality = params.pngQuality;
+    queue.encoders.setMaxThreadCount(encoderThreads);
+    queue.freeSlots.release(params.maxQueuedImages > 0 ? params.maxQueuedImages : encoderThreads * 2);
+
+    // QOffscreenSurface::create() belongs on the GUI thread; the contexts are made on their own threads
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    std::vector<std::unique_ptr<QOffscreenSurface>> surfaces;
+    for (int i = 0; i < renderThreads; ++i) {
+        surfaces.emplace_back(new QOffscreenSurface);
+        surfaces.back()->setFormat(format);
+        surfaces.back()->create();
+    }
+
+    std::atomic<int> nextJob{ 0 };
+    QThreadPool renderPool;
+    renderPool.setMaxThreadCount(renderThreads);
+    for (int i = 0; i < renderThreads; ++i) {
+        QOffscreenSurface *surface = surfaces[size_t(i)].get();
+        renderPool.start([this, &queue, &params, &jobs, &nextJob, surface]() {
+            RenderWorker worker(queue, params);
+            if (!worker.initialize(surface)) {
+                return;
+            }
+            for (int job = nextJob.fetch_add(1); job < jobs.size(); job = nextJob.fetch_add(1)) {
+                worker.render(jobs[job]);
+            }
+            worker.finish();
+        });
+    }
+    renderPool.waitForDone();
+    queue.encoders.waitForDone();
+    surfaces.clear();
+
+    QMutexLocker locker(&statsMutex);
+    counters.wallMilliseconds = wall.nsecsElapsed() / 1.0e6;
+    if (counters.renderThreads == 0) {
+        qWarning() << "BatchRenderer: no render thread got an OpenGL context";
+        return false;
+    }
+    return true;
+}
+
+void BatchRenderer::addWorkerStats(const Stats &worker, const QString &name)
+{
+    QMutexLocker locker(&statsMutex);
+    counters.renderThreads += worker.renderThreads;
+    counters.failed += worker.failed;
+    counters.meshLoads += worker.meshLoads;
+    counters.textureLoads += worker.textureLoads;
+    counters.textureEvictions += worker.textureEvictions;
+    counters.renderMilliseconds += worker.renderMilliseconds;
+    counters.readbackMilliseconds += worker.readbackMilliseconds;
+    counters.queueWaitMilliseconds += worker.queueWaitMilliseconds;
+    renderer = name;
+}
+
+void BatchRenderer::addEncoded(bool written, qint64 bytes, double milliseconds)
+{
+    QMutexLocker locker(&statsMutex);
+    if (written) {
+        ++counters.images;
+        counters.bytesWritten += bytes;
+    } else {
+        ++counters.failed;
+    }
+    counters.encodeMilliseconds += milliseconds;
+}
+
+BatchRenderer::Stats BatchRenderer::stats() const
+{
+    QMutexLocker locker(&statsMutex);
+    return counters;
+}
+
+QString BatchRenderer::rendererName() const
+{
+    QMutexLocker locker(&statsMutex);
+    return renderer;
+}
+
+QString BatchRenderer::report() const
+{
+    const Stats s = stats();
+    const double images = qMax(1, s.images);
+    return QString("BatchRenderer: %1 images (%2 failed) in %3 s = %4 images/s on %5 render threads, %6 MiB written\n"
+                   "  per image: render %7 ms, readback %8 ms, queue wait %9 ms, encode %10 ms\n"
+                   "  loads: %11 meshes, %12 textures (%13 evicted)")
+        .arg(s.images)
+        .arg(s.failed)
+        .arg(s.wallMilliseconds / 1000.0, 0, 'f', 2)
+        .arg(s.imagesPerSecond(), 0, 'f', 1)
+        .arg(s.renderThreads)
+        .arg(s.bytesWritten / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(s.renderMilliseconds / images, 0, 'f', 2)
+        .arg(s.readbackMilliseconds / images, 0, 'f', 2)
+        .arg(s.queueWaitMilliseconds / images, 0, 'f', 2)
+        .arg(s.encodeMilliseconds / images, 0, 'f', 2)
+        .arg(s.meshLoads)
+        .arg(s.textureLoads)
+        .arg(s.textureEvictions);
+}
+
+// ------------------- Job Lists -------------------
+
+static QVector3D vectorValue(const QJsonValue &value, const QVector3D &fallback)
+{
+    const QJsonArray array = value.toArray();
+    if (array.size() != 3) {
+        return fallback;
+    }
+    return QVector3D(float(array[0].toDouble()), float(array[1].toDouble()), float(array[2].toDouble()));
+}
+
+static QJsonArray vectorJson(const QVector3D &vector)
+{
+    return QJsonArray{ vector.x(), vector.y(), vector.z() };
+}
+
+static BatchJob parseJob(const QJsonObject &object, const BatchJob &defaults)
+{
+    BatchJob job = defaults;
+    job.name = object.value("name").toString(defaults.name);
+    job.mesh = object.value("mesh").toString(defaults.mesh);
+    job.eye = vectorValue(object.value("eye"), defaults.eye);
+    job.target = vectorValue(object.value("target"), defaults.target);
+    job.fieldOfView = float(object.value("fov").toDouble(defaults.fieldOfView));
+    job.rotation = vectorValue(object.value("rotation"), defaults.rotation);
+    const QJsonArray size = object.value("size").toArray();
+    if (size.size() == 2) {
+        job.size = QSize(size[0].toInt(), size[1].toInt());
+    }
+    return job;
+}
+
+bool BatchRenderer::loadJobs(const QString &filePath, QVector<BatchJob> *jobs)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "BatchRenderer: cannot open" << filePath;
+        return false;
+    }
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (!document.isObject()) {
+        qWarning() << "BatchRenderer:" << filePath << "is not a JSON object:" << error.errorString();
+        return false;
+    }
+    const QJsonObject root = document.object();
+    const QDir base = QFileInfo(filePath).absoluteDir();
+    const auto resolve = [&base](const QString &path) { return QDir::cleanPath(base.absoluteFilePath(path)); };
+    const auto pathList = [&resolve](const QJsonArray &array) {
+        QStringList paths;
+        for (const QJsonValue &value : array) {
+            paths << resolve(value.toString());
+        }
+        return paths;
+    };
+
+    QHash<QString, QStringList> textureSets;
+    const QJsonObject sets = root.value("textureSets").toObject();
+    for (auto it = sets.begin(); it != sets.end(); ++it) {
+        textureSets.insert(it.key(), pathList(it.value().toArray()));
+    }
+
+    // A set name or a list of paths; absent keeps @p fallback
+    const auto texturesOf = [&](const QJsonObject &object, const QStringList &fallback, bool *ok) {
+        const QJsonValue textures = object.value("textures");
+        *ok = !textures.isString() || textureSets.contains(textures.toString());
+        if (!*ok) {
+            qWarning() << "BatchRenderer: unknown texture set" << textures.toString();
+        }
+        return textures.isString() ? textureSets.value(textures.toString())
+                                   : textures.isArray() ? pathList(textures.toArray()) : fallback;
+    };
+    bool ok = true;
+    const QJsonObject defaultsObject = root.value("defaults").toObject();
+    BatchJob defaults = parseJob(defaultsObject, BatchJob());
+    defaults.textures = texturesOf(defaultsObject, QStringList(), &ok);
+    if (!ok) {
+        return false;
+    }
+
+    QSet<QString> names;
+    jobs->clear();
+    for (const QJsonValue &value : root.value("jobs").toArray()) {
+        const QJsonObject object = value.toObject();
+        BatchJob job = parseJob(object, defaults);
+        job.textures = texturesOf(object, defaults.textures, &ok);
+        if (!ok) {
+            return false;
+        }
+        if (!isBuiltInMesh(job.mesh)) {
+            job.mesh = resolve(job.mesh);
+        }
+
+        if (job.name.isEmpty() || names.contains(job.name)) {
+            qWarning() << "BatchRenderer: job" << jobs->size() << "needs a name of its own, has" << job.name;
+            return false;
+        }
+        if (job.size.width() <= 0 || job.size.height() <= 0 || job.size.width() > 16384 || job.size.height() > 16384
+            || job.fieldOfView <= 0.0f || job.fieldOfView >= 180.0f) {
+            qWarning() << "BatchRenderer: job" << job.name << "has an invalid size or field of view";
+            return false;
+        }
+        names.insert(job.name);
+        jobs->append(job);
+    }
+    return true;
+}
+
+bool BatchRenderer::saveJobs(const QString &filePath, const QVector<BatchJob> &jobs)
+{
+    QJsonArray list;
+    for (const BatchJob &job : jobs) {
+        QJsonObject object;
+        object.insert("name", job.name);
+        object.insert("mesh", job.mesh);
+        object.insert("textures", QJsonArray::fromStringList(job.textures));
+        object.insert("eye", vectorJson(job.eye));
+        object.insert("target", vectorJson(job.target));
+        object.insert("fov", job.fieldOfView);
+        object.insert("rotation", vectorJson(job.rotation));
+        object.insert("size", QJsonArray{ job.size.width(), job.size.height() });
+        list.append(object);
+    }
+    QJsonObject root;
+    root.insert("jobs", list);
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(QJsonDocument(root).toJson(QJsonDocument::Indented)) < 0) {
+        qWarning() << "BatchRenderer: cannot write" << filePath;
+        return false;
+    }
+    return true;
+}
+
+QVector<BatchJob> BatchRenderer::generateJobs(int count, const QStringList &textures, const QSize &size)
+{
+    QVector<BatchJob> jobs;
+    jobs.reserve(count);
+    const int meshCount = int(std::size(builtInMeshes));
+    for (int i = 0; i < count; ++i) {
+        BatchJob job;
+        job.mesh = builtInMeshes[i % meshCount];
+        job.name = QString("%1/%2").arg(job.mesh).arg(i, 6, 10, QChar('0'));
+        job.textures = textures;
+        // Golden-angle turns, so neighbouring thumbnails do not repeat a view
+        job.rotation = QVector3D(float((i * 37) % 360), float(std::fmod(i * 137.508, 360.0)), 0.0f);
+        job.size = size;
+        jobs.append(job);
+    }
+    return jobs;
+}
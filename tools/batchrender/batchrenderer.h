@@ -0,0 +1,113 @@
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include <QMutex>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector3D>
+#include <QVector>
+
+/**
+ * @brief One thumbnail: what to draw, from where and at what size.
+ */
+struct BatchJob {
+    QString name;                               // Output path under the output directory, without ".png"
+    QString mesh = "cube";                      // cube, sphere, torus, plane, or a mesh file (tools/meshconv)
+    QStringList textures;                       // Texture set: cube faces take one each, other meshes the first
+    QVector3D eye = QVector3D(1.1f, 0.9f, 1.5f);
+    QVector3D target;
+    float fieldOfView = 45.0f;                  // Vertical, in degrees
+    QVector3D rotation;                         // Of the model, degrees about x, then y, then z
+    QSize size = QSize(256, 256);
+};
+
+/**
+ * @brief Renders a list of jobs headless on several threads and writes one PNG per job.
+ *
+ * Every render thread owns an offscreen QOpenGLContext, a framebuffer that
+ * grows to the largest job it meets (multisampled, with a resolve target)
+ * and two pixel pack buffers: a job's glReadPixels() goes into one of them
+ * while the next job is drawn, and is mapped only after that. Threads take
+ * the next job from a shared counter, so slow jobs do not hold up a thread's
+ * share. Meshes and textures are loaded once per thread and kept, textures
+ * up to maxCachedTextures, least recently used first out.
+ *
+ * The scene is drawn upside down, so the rows glReadPixels() returns bottom
+ * up are the image top row first and go to the PNG encoders without a flip.
+ * The encoders are a separate pool; when maxQueuedImages images wait for
+ * them, render threads block instead of reading back more.
+ *
+ * run() must be called on the GUI thread, which creates the offscreen
+ * surfaces. Everything else happens on the pools' threads.
+ */
+class BatchRenderer
+{
+public:
+    struct Params {
+        int renderThreads = 0;                  // 0: QThread::idealThreadCount()
+        int encoderThreads = 0;                 // 0: QThread::idealThreadCount()
+        int samples = 4;                        // Multisampling; 0 renders straight into the resolve target
+        int maxQueuedImages = 0;                // Read back and waiting for an encoder; 0: two per encoder
+        int maxCachedTextures = 64;             // Per render thread
+        int pngQuality = 80;                    // 0 (slow, small) to 100 (fast, large); 80 compresses lightly
+    };
+
+    struct Stats {
+        int renderThreads = 0;                  // That got a context
+        int images = 0;                         // Written
+        int failed = 0;                         // Jobs without an image: mesh not loadable, or the write failed
+        int meshLoads = 0;                      // Summed over threads, as are the times below
+        int textureLoads = 0;
+        int textureEvictions = 0;
+        qint64 bytesWritten = 0;
+        double wallMilliseconds = 0.0;
+        double renderMilliseconds = 0.0;        // Loading, drawing and issuing the readback
+        double readbackMilliseconds = 0.0;      // Waiting for a readback to finish, and the copy out of the PBO
+        double queueWaitMilliseconds = 0.0;     // Render threads blocked on a full encoder queue
+        double encodeMilliseconds = 0.0;
+
+        double imagesPerSecond() const { return wallMilliseconds > 0.0 ? images * 1000.0 / wallMilliseconds : 0.0; }
+    };
+
+    BatchRenderer() = default;
+
+    bool run(const QVector<BatchJob> &jobs, const QString &outputDir) { return run(jobs, outputDir, Params()); }
+    /**
+     * @brief Renders every job and returns once all images are on disk.
+     * @return false if no render thread could create a context or the output directory cannot be made.
+     */
+    bool run(const QVector<BatchJob> &jobs, const QString &outputDir, const Params &params);
+
+    Stats stats() const;
+    QString report() const;
+    QString rendererName() const;
+
+    /**
+     * @brief Reads a job list. Relative mesh and texture paths are taken from the list's directory.
+     *
+     * { "textureSets": { "dice": [ "1.png", ... ] },
+     *   "defaults": { "size": [256, 256], "eye": [1.1, 0.9, 1.5], "target": [0, 0, 0], "fov": 45 },
+     *   "jobs": [ { "name": "dice/front", "mesh": "cube", "textures": "dice", "rotation": [0, 30, 0] } ] }
+     *
+     * A job's "textures" is a set name or a list of paths. Names must be unique.
+     */
+    static bool loadJobs(const QString &filePath, QVector<BatchJob> *jobs);
+    static bool saveJobs(const QString &filePath, const QVector<BatchJob> &jobs);
+    /**
+     * @brief @p count jobs cycling through the built-in meshes, each from its own camera angle.
+     */
+    static QVector<BatchJob> generateJobs(int count, const QStringList &textures, const QSize &size);
+
+private:
+    friend class RenderWorker;
+
+    void addWorkerStats(const Stats &worker, const QString &renderer);
+    void addEncoded(bool written, qint64 bytes, double milliseconds);
+
+    mutable QMutex statsMutex;
+    Stats counters;
+    QString renderer;
+};
+
+#endif // BATCHRENDERER_H
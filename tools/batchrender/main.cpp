@@ -0,0 +1,125 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include "batchrenderer.h"
+
+// Renders a job list of thumbnails (BatchRenderer::loadJobs() describes the format) or --generate n
+// synthetic jobs into --output, once per --threads count, and reports images per second for each.
+// Every run writes the same files. Without a GPU the driver is Mesa llvmpipe, which also spreads each
+// context over LP_NUM_THREADS threads of its own: LP_NUM_THREADS=1 leaves the scaling to the render
+// threads, otherwise they compete with llvmpipe's.
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless thumbnail renderer: one offscreen context per render thread.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("jobs", "Job list (JSON). Not needed with --generate.");
+    QCommandLineOption generateOption("generate", "Render n generated jobs instead of a job list.", "n");
+    QCommandLineOption texturesOption("textures", "With --generate: every image in <dir> forms the texture set.",
+                                      "dir");
+    QCommandLineOption sizeOption("size", "With --generate: thumbnail size.", "WxH", "256x256");
+    QCommandLineOption outputOption("output", "Directory receiving the PNGs.", "dir", "thumbnails");
+    const QString allThreads = QString::number(QThread::idealThreadCount());
+    QCommandLineOption threadsOption("threads", "Comma-separated render thread counts.", "list", "1,2,4," + allThreads);
+    QCommandLineOption encodersOption("encoders", "PNG encoder threads; 0 for one per core.", "n", "0");
+    QCommandLineOption samplesOption("samples", "Multisampling; 0 for none.", "n", "4");
+    QCommandLineOption qualityOption("png-quality",
+                                     "PNG quality, 0 (slow, small) to 100 (fast, large); 80 compresses lightly.",
+                                     "n", "80");
+    QCommandLineOption writeJobsOption("write-jobs", "Also save the job list as JSON, e.g. to edit it.", "file");
+    parser.addOptions({ generateOption, texturesOption, sizeOption, outputOption, threadsOption, encodersOption,
+                        samplesOption, qualityOption, writeJobsOption });
+    parser.process(app);
+
+    QVector<BatchJob> jobs;
+    if (parser.isSet(generateOption)) {
+        const int count = parser.value(generateOption).toInt();
+        if (count <= 0) {
+            qWarning() << "batchrender: invalid job count" << parser.value(generateOption);
+            return 1;
+        }
+        QStringList textures;
+        if (parser.isSet(texturesOption)) {
+            const QDir directory(parser.value(texturesOption));
+            for (const QString &file : directory.entryList({ "*.png", "*.jpg", "*.jpeg" }, QDir::Files, QDir::Name)) {
+                textures << directory.absoluteFilePath(file);
+            }
+            if (textures.isEmpty()) {
+                qWarning() << "batchrender: no images in" << parser.value(texturesOption);
+                return 1;
+            }
+        }
+        const QStringList sizeText = parser.value(sizeOption).split('x');
+        const QSize size(qMax(1, sizeText.value(0).toInt()), qMax(1, sizeText.value(1).toInt()));
+        jobs = BatchRenderer::generateJobs(count, textures, size);
+    } else if (parser.positionalArguments().size() == 1) {
+        if (!BatchRenderer::loadJobs(parser.positionalArguments().first(), &jobs)) {
+            return 1;
+        }
+    } else {
+        parser.showHelp(1);
+    }
+    if (parser.isSet(writeJobsOption) && !BatchRenderer::saveJobs(parser.value(writeJobsOption), jobs)) {
+        return 1;
+    }
+
+    QVector<int> threadCounts;
+    for (const QString &text : parser.value(threadsOption).split(',')) {
+        const int threads = text.toInt();
+        if (threads <= 0) {
+            qWarning() << "batchrender: invalid thread count" << text;
+            return 1;
+        }
+        if (!threadCounts.contains(threads)) {
+            threadCounts.append(threads);
+        }
+    }
+
+    BatchRenderer::Params params;
+    params.encoderThreads = qMax(0, parser.value(encodersOption).toInt());
+    params.samples = qMax(0, parser.value(samplesOption).toInt());
+    params.pngQuality = qBound(0, parser.value(qualityOption).toInt(), 100);
+    const QString outputDir = parser.value(outputOption);
+
+    qInfo().noquote() << QString("%1 jobs into %2, %3 encoder threads, %4x MSAA")
+                             .arg(jobs.size())
+                             .arg(QDir(outputDir).absolutePath())
+                             .arg(params.encoderThreads > 0 ? params.encoderThreads : QThread::idealThreadCount())
+                             .arg(params.samples);
+    qInfo().noquote() << "  threads | images | failed | wall s | images/s | speedup | per image ms: render | "
+                         "readback | queue wait | encode";
+
+    double firstRate = 0.0;
+    for (int threads : std::as_const(threadCounts)) {
+        params.renderThreads = threads;
+        BatchRenderer renderer;
+        if (!renderer.run(jobs, outputDir, params)) {
+            return 1;
+        }
+        const BatchRenderer::Stats stats = renderer.stats();
+        if (firstRate == 0.0) {
+            firstRate = stats.imagesPerSecond();
+            qInfo().noquote() << "  Renderer:" << renderer.rendererName();
+        }
+        const double images = qMax(1, stats.images);
+        qInfo().noquote() << QString("  %1 | %2 | %3 | %4 | %5 | %6x | %7 | %8 | %9 | %10")
+                                 .arg(threads, 7)
+                                 .arg(stats.images, 6)
+                                 .arg(stats.failed, 6)
+                                 .arg(stats.wallMilliseconds / 1000.0, 6, 'f', 2)
+                                 .arg(stats.imagesPerSecond(), 8, 'f', 1)
+                                 .arg(firstRate > 0.0 ? stats.imagesPerSecond() / firstRate : 0.0, 6, 'f', 2)
+                                 .arg(stats.renderMilliseconds / images, 20, 'f', 2)
+                                 .arg(stats.readbackMilliseconds / images, 8, 'f', 2)
+                                 .arg(stats.queueWaitMilliseconds / images, 10, 'f', 2)
+                                 .arg(stats.encodeMilliseconds / images, 6, 'f', 2);
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QSurfaceFormat>
+#include <algorithm>
+#include "tracereplayer.h"
+
+// Replays a trace recorded with GLTraceFunctions (see common/gltrace.h) headless and
+// prints per-frame CPU submission and GPU times. Run with QT_QPA_PLATFORM=offscreen
+// on machines without a display.
+
+static double percentile(QVector<double> values, double p)
+{
+    if (values.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const int index = qBound(0, int(p * (values.size() - 1) + 0.5), int(values.size() - 1));
+    return values[index];
+}
+
+static void printSeries(const char *label, const QVector<double> &values)
+{
+    double sum = 0.0;
+    for (double v : values) {
+        sum += v;
+    }
+    qInfo().noquote() << QString("%1 avg %2 ms  p50 %3  p95 %4  max %5")
+                             .arg(label, -10)
+                             .arg(sum / qMax<qsizetype>(1, values.size()), 0, 'f', 3)
+                             .arg(percentile(values, 0.50), 0, 'f', 3)
+                             .arg(percentile(values, 0.95), 0, 'f', 3)
+                             .arg(percentile(values, 1.00), 0, 'f', 3);
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Deterministic headless replay of a recorded GL trace.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("trace", "Trace file written by GLTraceFunctions.");
+    QCommandLineOption loopsOption("loops", "Replay the recorded frames <n> times.", "n", "10");
+    QCommandLineOption finishOption("finish", "glFinish() after every frame (CPU time includes GPU wait).");
+    QCommandLineOption dumpOption("dump", "Save the last replayed frame as an image.", "file");
+    parser.addOptions({ loopsOption, finishOption, dumpOption });
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create()) {
+        qWarning() << "glreplay: cannot create an OpenGL 3.3 core context";
+        return 1;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        qWarning() << "glreplay: cannot make the context current";
+        return 1;
+    }
+
+    TraceReplayer replayer;
+    if (!replayer.load(parser.positionalArguments().first()) || !replayer.initialize()) {
+        return 1;
+    }
+
+    const int loops = qMax(1, parser.value(loopsOption).toInt());
+    qInfo().noquote() << "Renderer:" << reinterpret_cast<const char *>(context.functions()->glGetString(GL_RENDERER));
+    qInfo() << "Replaying" << replayer.frameCount() << "frames x" << loops << "at" << replayer.frameSize();
+
+    QElapsedTimer wall;
+    wall.start();
+    const QVector<TraceReplayer::FrameTiming> timings = replayer.replay(loops, parser.isSet(finishOption));
+    const double wallMs = wall.nsecsElapsed() / 1.0e6;
+
+    QVector<double> cpu;
+    QVector<double> gpu;
+    for (const auto &t : timings) {
+        cpu.append(t.cpuMs);
+        gpu.append(t.gpuMs);
+    }
+    printSeries("CPU submit", cpu);
+    printSeries("GPU", gpu);
+    qInfo().noquote() << QString("Total %1 frames in %2 ms (%3 fps)")
+                             .arg(timings.size())
+                             .arg(wallMs, 0, 'f', 1)
+                             .arg(timings.size() * 1000.0 / qMax(0.001, wallMs), 0, 'f', 1);
+
+    if (parser.isSet(dumpOption)) {
+        replayer.grabFrame().save(parser.value(dumpOption));
+    }
+
+    replayer.destroy();
+    context.doneCurrent();
+    return 0;
+}
@@ -0,0 +1,568 @@
+#include "tracereplayer.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <cstring>
+#include <utility>
+
+using gltrace::Op;
+
+namespace {
+
+// Sequential reader over the mapped trace. Any read past the end clears ok and returns zeros.
+struct Reader {
+    const uchar *p;
+    const uchar *end;
+    bool ok = true;
+
+    template <typename T> T get()
+    {
+        T value{};
+        if (end - p < qptrdiff(sizeof(T))) {
+            ok = false;
+            p = end;
+            return value;
+        }
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    // Returns a pointer into the mapping; the payload is never copied
+    const uchar *blob(quint32 *size)
+    {
+        *size = get<quint32>();
+        if (!ok || quint64(end - p) < *size) {
+            ok = false;
+            p = end;
+            *size = 0;
+            return nullptr;
+        }
+        const uchar *data = p;
+        p += *size;
+        return data;
+    }
+};
+
+} // namespace
+
+TraceReplayer::~TraceReplayer()
+{
+    file.close();
+}
+
+// ------------------- Loading -------------------
+
+bool TraceReplayer::load(const QString &filePath)
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "glreplay: cannot open" << filePath;
+        return false;
+    }
+
+    begin = file.map(0, file.size());
+    if (!begin || file.size() < qint64(sizeof(gltrace::TraceHeader))) {
+        qWarning() << "glreplay: cannot map" << filePath;
+        return false;
+    }
+    end = begin + file.size();
+
+    gltrace::TraceHeader header;
+    std::memcpy(&header, begin, sizeof(header));
+    if (header.magic != gltrace::Magic || header.version != gltrace::Version) {
+        qWarning() << "glreplay:" << filePath << "is not a version" << gltrace::Version << "GL trace";
+        return false;
+    }
+
+    setupStart = begin + sizeof(header);
+    if (!scan()) {
+        return false;
+    }
+    if (frameOffsets.size() != int(header.frameCount)) {
+        qWarning() << "glreplay: header announces" << header.frameCount << "frames, found" << frameOffsets.size();
+    }
+    return true;
+}
+
+bool TraceReplayer::scan()
+{
+    // Walk the whole file once without executing, to validate it and index the frames
+    const uchar *p = setupStart;
+    Op op = Op::End;
+    do {
+        const uchar *record = p;
+        p = step(p, false, &op);
+        if (!p) {
+            qWarning() << "glreplay: corrupt trace at offset" << (record - begin);
+            return false;
+        }
+        if (op == Op::FrameBegin) {
+            frameOffsets.append(record);
+            Reader reader{record + 1, end};
+            reader.get<quint32>();
+            maxWidth = qMax(maxWidth, int(reader.get<qint32>()));
+            maxHeight = qMax(maxHeight, int(reader.get<qint32>()));
+        }
+    } while (op != Op::End);
+
+    if (frameOffsets.isEmpty() || maxWidth <= 0 || maxHeight <= 0) {
+        qWarning() << "glreplay: trace contains no frames";
+        return false;
+    }
+    return true;
+}
+
+// ------------------- Object Translation -------------------
+
+GLuint TraceReplayer::mapBuffer(quint32 id)
+{
+    if (id == 0) {
+        return 0;
+    }
+    GLuint &name = buffers[id];
+    if (name == 0) {
+        glGenBuffers(1, &name);
+    }
+    return name;
+}
+
+GLuint TraceReplayer::mapTexture(quint32 id)
+{
+    if (id == 0) {
+        return 0;
+    }
+    GLuint &name = textures[id];
+    if (name == 0) {
+        glGenTextures(1, &name);
+    }
+    return name;
+}
+
+GLuint TraceReplayer::mapVertexArray(quint32 id)
+{
+    if (id == 0) {
+        return 0;
+    }
+    GLuint &name = vertexArrays[id];
+    if (name == 0) {
+        glGenVertexArrays(1, &name);
+    }
+    return name;
+}
+
+GLint TraceReplayer::uniformLocation(quint32 nameId)
+{
+    const QPair<GLuint, quint32> key(currentProgram, nameId);
+    auto it = uniformLocations.constFind(key);
+    if (it != uniformLocations.constEnd()) {
+        return it.value();
+    }
+    const GLint location = glGetUniformLocation(currentProgram, strings.value(nameId).constData());
+    uniformLocations.insert(key, location);
+    return location;
+}
+
+GLuint TraceReplayer::compileProgram(const QByteArray &vertexSource, const QByteArray &fragmentSource)
+{
+    const auto compile = [this](GLenum type, const QByteArray &source) -> GLuint {
+        const GLuint shader = glCreateShader(type);
+        const char *text = source.constData();
+        const GLint length = GLint(source.size());
+        glShaderSource(shader, 1, &text, &length);
+        glCompileShader(shader);
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (status != GL_TRUE) {
+            char log[1024] = {};
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            qWarning() << "glreplay: shader compilation failed:" << log;
+        }
+        return shader;
+    };
+
+    const GLuint program = glCreateProgram();
+    const GLuint vs = compile(GL_VERTEX_SHADER, vertexSource);
+    const GLuint fs = compile(GL_FRAGMENT_SHADER, fragmentSource);
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[1024] = {};
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        qWarning() << "glreplay: program link failed:" << log;
+    }
+    return program;
+}
+
+// ------------------- Execution -------------------
+
+const uchar *TraceReplayer::step(const uchar *p, bool run, Op *opOut)
+{
+    Reader r{p, end};
+    const auto op = Op(r.get<quint8>());
+    *opOut = op;
+    quint32 size = 0;
+
+    switch (op) {
+    case Op::End:
+    case Op::FrameEnd:
+        break;
+    case Op::FrameBegin: {
+        r.get<quint32>();
+        const qint32 w = r.get<qint32>();
+        const qint32 h = r.get<qint32>();
+        if (run) {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glViewport(0, 0, w, h);
+        }
+        break;
+    }
+    case Op::String: {
+        const quint32 id = r.get<quint32>();
+        const uchar *text = r.blob(&size);
+        if (run) {
+            strings.insert(id, QByteArray(reinterpret_cast<const char *>(text), size));
+        }
+        break;
+    }
+    case Op::Program: {
+        const quint32 id = r.get<quint32>();
+        quint32 fragmentSize = 0;
+        const uchar *vertex = r.blob(&size);
+        const uchar *fragment = r.blob(&fragmentSize);
+        if (run) {
+            programs.insert(id, compileProgram(QByteArray(reinterpret_cast<const char *>(vertex), size),
+                                               QByteArray(reinterpret_cast<const char *>(fragment), fragmentSize)));
+        }
+        break;
+    }
+    case Op::UseProgram: {
+        const quint32 id = r.get<quint32>();
+        if (run) {
+            currentProgram = programs.value(id);
+            glUseProgram(currentProgram);
+        }
+        break;
+    }
+    case Op::Uniform1i: {
+        const quint32 name = r.get<quint32>();
+        const qint32 value = r.get<qint32>();
+        if (run) {
+            glUniform1i(uniformLocation(name), value);
+        }
+        break;
+    }
+    case Op::Uniform1f: {
+        const quint32 name = r.get<quint32>();
+        const float value = r.get<float>();
+        if (run) {
+            glUniform1f(uniformLocation(name), value);
+        }
+        break;
+    }
+    case Op::Uniform4f: {
+        const quint32 name = r.get<quint32>();
+        float v[4];
+        for (float &f : v) {
+            f = r.get<float>();
+        }
+        if (run) {
+            glUniform4f(uniformLocation(name), v[0], v[1], v[2], v[3]);
+        }
+        break;
+    }
+    case Op::UniformMatrix4fv: {
+        const quint32 name = r.get<quint32>();
+        float m[16];
+        for (float &f : m) {
+            f = r.get<float>();
+        }
+        if (run) {
+            glUniformMatrix4fv(uniformLocation(name), 1, GL_FALSE, m);
+        }
+        break;
+    }
+    case Op::BindBuffer: {
+        const quint32 target = r.get<quint32>();
+        const quint32 id = r.get<quint32>();
+        if (run) {
+            glBindBuffer(target, mapBuffer(id));
+        }
+        break;
+    }
+    case Op::BufferData: {
+        const quint32 target = r.get<quint32>();
+        const quint32 usage = r.get<quint32>();
+        const uchar *data = r.blob(&size);
+        if (run) {
+            glBufferData(target, size, data, usage);
+        }
+        break;
+    }
+    case Op::BufferSubData: {
+        const quint32 target = r.get<quint32>();
+        const quint64 offset = r.get<quint64>();
+        const uchar *data = r.blob(&size);
+        if (run) {
+            glBufferSubData(target, GLintptr(offset), size, data);
+        }
+        break;
+    }
+    case Op::BindVertexArray: {
+        const quint32 id = r.get<quint32>();
+        if (run) {
+            glBindVertexArray(mapVertexArray(id));
+        }
+        break;
+    }
+    case Op::EnableVertexAttribArray: {
+        const quint32 index = r.get<quint32>();
+        if (run) {
+            glEnableVertexAttribArray(index);
+        }
+        break;
+    }
+    case Op::DisableVertexAttribArray: {
+        const quint32 index = r.get<quint32>();
+        if (run) {
+            glDisableVertexAttribArray(index);
+        }
+        break;
+    }
+    case Op::VertexAttribPointer: {
+        const quint32 index = r.get<quint32>();
+        const qint32 components = r.get<qint32>();
+        const quint32 type = r.get<quint32>();
+        const quint8 normalized = r.get<quint8>();
+        const qint32 stride = r.get<qint32>();
+        const quint64 offset = r.get<quint64>();
+        if (run) {
+            glVertexAttribPointer(index, components, type, normalized ? GL_TRUE : GL_FALSE, stride,
+                                  reinterpret_cast<const void *>(quintptr(offset)));
+        }
+        break;
+    }
+    case Op::ActiveTexture: {
+        const quint32 unit = r.get<quint32>();
+        if (run) {
+            glActiveTexture(unit);
+        }
+        break;
+    }
+    case Op::BindTexture: {
+        const quint32 target = r.get<quint32>();
+        const quint32 id = r.get<quint32>();
+        if (run) {
+            glBindTexture(target, mapTexture(id));
+        }
+        break;
+    }
+    case Op::TexImage2D: {
+        const quint32 target = r.get<quint32>();
+        const qint32 level = r.get<qint32>();
+        const qint32 internalFormat = r.get<qint32>();
+        const qint32 w = r.get<qint32>();
+        const qint32 h = r.get<qint32>();
+        const quint32 format = r.get<quint32>();
+        const quint32 type = r.get<quint32>();
+        const uchar *pixels = r.blob(&size);
+        if (run) {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexImage2D(target, level, internalFormat, w, h, 0, format, type, pixels);
+        }
+        break;
+    }
+    case Op::TexParameteri: {
+        const quint32 target = r.get<quint32>();
+        const quint32 pname = r.get<quint32>();
+        const qint32 value = r.get<qint32>();
+        if (run) {
+            glTexParameteri(target, pname, value);
+        }
+        break;
+    }
+    case Op::GenerateMipmap: {
+        const quint32 target = r.get<quint32>();
+        if (run) {
+            glGenerateMipmap(target);
+        }
+        break;
+    }
+    case Op::Enable: {
+        const quint32 cap = r.get<quint32>();
+        if (run) {
+            glEnable(cap);
+        }
+        break;
+    }
+    case Op::Disable: {
+        const quint32 cap = r.get<quint32>();
+        if (run) {
+            glDisable(cap);
+        }
+        break;
+    }
+    case Op::ClearColor: {
+        float c[4];
+        for (float &f : c) {
+            f = r.get<float>();
+        }
+        if (run) {
+            glClearColor(c[0], c[1], c[2], c[3]);
+        }
+        break;
+    }
+    case Op::Clear: {
+        const quint32 mask = r.get<quint32>();
+        if (run) {
+            glClear(mask);
+        }
+        break;
+    }
+    case Op::Viewport: {
+        qint32 v[4];
+        for (qint32 &i : v) {
+            i = r.get<qint32>();
+        }
+        if (run) {
+            glViewport(v[0], v[1], v[2], v[3]);
+        }
+        break;
+    }
+    case Op::DrawArrays: {
+        const quint32 mode = r.get<quint32>();
+        const qint32 first = r.get<qint32>();
+        const qint32 count = r.get<qint32>();
+        if (run) {
+            glDrawArrays(mode, first, count);
+        }
+        break;
+    }
+    case Op::DrawElements: {
+        const quint32 mode = r.get<quint32>();
+        const qint32 count = r.get<qint32>();
+        const quint32 type = r.get<quint32>();
+        const quint64 offset = r.get<quint64>();
+        if (run) {
+            glDrawElements(mode, count, type, reinterpret_cast<const void *>(quintptr(offset)));
+        }
+        break;
+    }
+    default:
+        return nullptr;
+    }
+
+    return r.ok ? r.p : nullptr;
+}
+
+bool TraceReplayer::initialize()
+{
+    initializeOpenGLFunctions();
+
+    glGenRenderbuffers(1, &colorRbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, maxWidth, maxHeight);
+    glGenRenderbuffers(1, &depthRbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, maxWidth, maxHeight);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRbo);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        qWarning() << "glreplay: replay framebuffer incomplete";
+        return false;
+    }
+    glViewport(0, 0, maxWidth, maxHeight);
+
+    // Setup section: shaders, buffers, textures created before the first frame
+    const uchar *p = setupStart;
+    Op op = Op::End;
+    while (p && p != frameOffsets.first()) {
+        p = step(p, true, &op);
+    }
+    glFinish();
+    return p != nullptr;
+}
+
+QVector<TraceReplayer::FrameTiming> TraceReplayer::replay(int loops, bool finishEachFrame)
+{
+    QVector<FrameTiming> timings;
+    QVector<GLuint> queries(loops * frameOffsets.size());
+    glGenQueries(queries.size(), queries.data());
+
+    QElapsedTimer timer;
+    int index = 0;
+    for (int loop = 0; loop < loops; ++loop) {
+        for (const uchar *frame : frameOffsets) {
+            timer.start();
+            glBeginQuery(GL_TIME_ELAPSED, queries[index]);
+
+            const uchar *p = frame;
+            Op op = Op::End;
+            do {
+                p = step(p, true, &op);
+            } while (p && op != Op::FrameEnd);
+
+            glEndQuery(GL_TIME_ELAPSED);
+            if (finishEachFrame) {
+                glFinish();
+            }
+
+            FrameTiming timing;
+            timing.cpuMs = timer.nsecsElapsed() / 1.0e6;
+            timings.append(timing);
+            ++index;
+        }
+    }
+
+    // Results are collected at the end so reading them never stalls the replay loop
+    glFinish();
+    for (int i = 0; i < queries.size(); ++i) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+        timings[i].gpuMs = ns / 1.0e6;
+    }
+    glDeleteQueries(queries.size(), queries.data());
+    return timings;
+}
+
+QImage TraceReplayer::grabFrame()
+{
+    QImage image(maxWidth, maxHeight, QImage::Format_RGBA8888);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, maxWidth, maxHeight, GL_RGBA, GL_UNSIGNED_BYTE, image.bits());
+    return image.mirrored();
+}
+
+void TraceReplayer::destroy()
+{
+    for (GLuint name : std::as_const(buffers)) {
+        glDeleteBuffers(1, &name);
+    }
+    for (GLuint name : std::as_const(textures)) {
+        glDeleteTextures(1, &name);
+    }
+    for (GLuint name : std::as_const(vertexArrays)) {
+        glDeleteVertexArrays(1, &name);
+    }
+    for (GLuint name : std::as_const(programs)) {
+        glDeleteProgram(name);
+    }
+    buffers.clear();
+    textures.clear();
+    vertexArrays.clear();
+    programs.clear();
+
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &colorRbo);
+    glDeleteRenderbuffers(1, &depthRbo);
+    fbo = colorRbo = depthRbo = 0;
+}
@@ -0,0 +1,78 @@
+#ifndef TRACEREPLAYER_H
+#define TRACEREPLAYER_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QPair>
+#include <QVector>
+#include "gltraceformat.h"
+
+/**
+ * @brief Re-executes a trace written by GLTraceFunctions against the current context.
+ *
+ * The trace file is memory-mapped; buffer and texture payloads are passed to
+ * GL straight from the mapping. Frames render into a private FBO sized to the
+ * largest recorded frame, so no window is needed.
+ */
+class TraceReplayer : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct FrameTiming {
+        double cpuMs = 0.0;   // Time to submit the frame's commands
+        double gpuMs = 0.0;   // GL_TIME_ELAPSED for the frame
+    };
+
+    ~TraceReplayer();
+
+    bool load(const QString &filePath);
+    int frameCount() const { return frameOffsets.size(); }
+    QSize frameSize() const { return QSize(maxWidth, maxHeight); }
+
+    /**
+     * @brief Creates the render target and runs the setup section. Context must be current.
+     */
+    bool initialize();
+
+    /**
+     * @brief Replays every recorded frame @p loops times.
+     * @param finishEachFrame Call glFinish() after each frame so CPU timings include the GPU wait.
+     */
+    QVector<FrameTiming> replay(int loops, bool finishEachFrame);
+
+    QImage grabFrame();
+    void destroy();
+
+private:
+    const uchar *step(const uchar *p, bool run, gltrace::Op *opOut);
+    bool scan();
+
+    GLuint mapBuffer(quint32 id);
+    GLuint mapTexture(quint32 id);
+    GLuint mapVertexArray(quint32 id);
+    GLint uniformLocation(quint32 nameId);
+    GLuint compileProgram(const QByteArray &vertexSource, const QByteArray &fragmentSource);
+
+    QFile file;
+    const uchar *begin = nullptr;
+    const uchar *end = nullptr;
+    const uchar *setupStart = nullptr;
+    QVector<const uchar *> frameOffsets;
+    int maxWidth = 0;
+    int maxHeight = 0;
+
+    GLuint fbo = 0;
+    GLuint colorRbo = 0;
+    GLuint depthRbo = 0;
+
+    QHash<quint32, GLuint> buffers;
+    QHash<quint32, GLuint> textures;
+    QHash<quint32, GLuint> vertexArrays;
+    QHash<quint32, GLuint> programs;
+    QHash<quint32, QByteArray> strings;
+    QHash<QPair<GLuint, quint32>, GLint> uniformLocations;
+    GLuint currentProgram = 0;
+};
+
+#endif // TRACEREPLAYER_H
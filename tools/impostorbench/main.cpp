@@ -0,0 +1,464 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QRandomGenerator>
+#include <QSurfaceFormat>
+#include <QVector>
+#include <QtMath>
+#include <cmath>
+#include <memory>
+#include "impostor.h"
+#include "meshgen.h"
+
+// Draws a dense field of tori (--objects n, 100k and up) from a camera turning in its middle, once as
+// instanced meshes only and then with ImpostorCache at several switch sizes: objects that cover fewer than
+// --pixels p on screen become one quad each. Reports ms per frame (until glFinish() returns), how many
+// instances stayed meshes, the CPU time of the near / far split, and the share of pixels that differ from
+// the mesh-only frame. On a host without a GPU the driver is Mesa llvmpipe; elsewhere LIBGL_ALWAYS_SOFTWARE=1
+// selects it.
+
+// Flat shading from the object-space position: the impostors bake the same lighting the meshes get
+static const char *vertexShaderSource = R"(
+#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 row0;
+layout(location = 2) in vec4 row1;
+layout(location = 3) in vec4 row2;
+uniform mat4 viewProjection;
+uniform bool instanced;
+out vec3 localPosition;
+void main()
+{
+    vec4 local = vec4(position, 1.0);
+    vec3 world = instanced ? vec3(dot(row0, local), dot(row1, local), dot(row2, local)) : position;
+    localPosition = position;
+    gl_Position = viewProjection * vec4(world, 1.0);
+}
+)";
+
+static const char *fragmentShaderSource = R"(
+#version 330 core
+in vec3 localPosition;
+out vec4 fragColor;
+void main()
+{
+    vec3 normal = normalize(cross(dFdx(localPosition), dFdy(localPosition)));
+    float light = 0.3 + 0.7 * abs(dot(normal, normalize(vec3(0.4, 0.8, 0.45))));
+    fragColor = vec4(vec3(0.95, 0.65, 0.25) * light, 1.0);
+}
+)";
+
+static const int TransformFloats = 12;
+static const float ObjectSpacing = 2.0f;    // Average distance between neighbours
+static const float FieldOfView = 45.0f;
+static const QVector3D CameraPosition(0.0f, 3.0f, 0.0f);
+
+struct FrameResult {
+    double milliseconds = 0.0;              // Until glFinish() returns
+    double partitionMilliseconds = 0.0;     // CPU near / far split and upload
+    int meshes = 0;
+    int impostors = 0;
+};
+
+// Random positions on a square field around the camera, random orientations, 3 x 4 row-major rows each
+static QVector<float> makeField(int count)
+{
+    QRandomGenerator random(7);
+    const float side = std::sqrt(float(count)) * ObjectSpacing;
+    QVector<float> transforms;
+    transforms.reserve(count * TransformFloats);
+    for (int i = 0; i < count; ++i) {
+        QMatrix4x4 model;
+        model.translate((float(random.generateDouble()) - 0.5f) * side, 0.5f,
+                        (float(random.generateDouble()) - 0.5f) * side);
+        model.rotate(float(random.bounded(360.0)), 0.0f, 1.0f, 0.0f);
+        model.rotate(float(random.bounded(90.0)), 1.0f, 0.0f, 0.0f);
+        for (int row = 0; row < 3; ++row) {
+            for (int column = 0; column < 4; ++column) {
+                transforms.append(model(row, column));
+            }
+        }
+    }
+    return transforms;
+}
+
+/**
+ * @brief The field drawn into a framebuffer object, as meshes or as meshes plus impostors.
+ */
+class FieldRenderer : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    ~FieldRenderer() { release(); }
+
+    bool initialize(const QSize &frameSize, int rings, int sides, const ImpostorCache::Params &params)
+    {
+        context.reset(new QOpenGLContext);
+        QSurfaceFormat format;
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        context->setFormat(format);
+        if (!context->create()) {
+            qWarning() << "impostorbench: cannot create an OpenGL 3.3 core context";
+            return false;
+        }
+        surface.setFormat(context->format());
+        surface.create();
+        if (!context->makeCurrent(&surface)) {
+            qWarning() << "impostorbench: cannot make the context current";
+            return false;
+        }
+        initializeOpenGLFunctions();
+        renderer = QString::fromLatin1(reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+        size = frameSize;
+        target.reset(new QOpenGLFramebufferObject(size, QOpenGLFramebufferObject::Depth));
+        program.reset(new QOpenGLShaderProgram);
+        if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource)
+            || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource)
+            || !program->link()) {
+            qWarning() << "impostorbench: shader error" << program->log();
+            return false;
+        }
+
+        const meshgen::Mesh<meshgen::Pos> torus = meshgen::makeTorus<meshgen::Pos>(rings, sides);
+        indexCount = GLsizei(torus.indexCount());
+        float radius = 0.0f;
+        for (size_t i = 0; i < torus.vertices.size(); i += 3) {
+            radius = qMax(radius, QVector3D(torus.vertices[i], torus.vertices[i + 1], torus.vertices[i + 2]).length());
+        }
+        objectRadius = radius;
+
+        glGenVertexArrays(1, &vao);
+        glGenVertexArrays(1, &bakeVao);
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &indexBuffer);
+        glGenBuffers(1, &fieldBuffer);
+        glGenBuffers(1, &nearBuffer);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(torus.vertexBytes()), torus.vertices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, torus.stride(), nullptr);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(torus.indices.size() * sizeof(unsigned int)),
+                     torus.indices.data(), GL_STATIC_DRAW);
+        for (int row = 0; row < 3; ++row) {
+            glEnableVertexAttribArray(GLuint(1 + row));
+            glVertexAttribDivisor(GLuint(1 + row), 1);
+        }
+        // The same mesh without the instance attributes, for baking
+        glBindVertexArray(bakeVao);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, torus.stride(), nullptr);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBindVertexArray(0);
+
+        if (!impostors.initialize(params)) {
+            return false;
+        }
+        // Baked with the same program and mesh, drawn once in object space per view
+        torusObject = impostors.addObject(QVector3D(0.0f, 0.0f, 0.0f), objectRadius,
+                                          [this](const QMatrix4x4 &viewProjection) {
+                                              program->bind();
+                                              program->setUniformValue("viewProjection", viewProjection);
+                                              program->setUniformValue("instanced", false);
+                                              glBindVertexArray(bakeVao);
+                                              glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+                                              glBindVertexArray(0);
+                                          });
+        return torusObject >= 0;
+    }
+
+    QString rendererName() const { return renderer; }
+    float radius() const { return objectRadius; }
+    int triangles() const { return indexCount / 3; }
+    ImpostorCache::Stats impostorStats() const { return impostors.stats(); }
+    double lastBakeMilliseconds() const { return bakeMilliseconds; }
+
+    void setField(const QVector<float> &transforms)
+    {
+        field = transforms;
+        glBindBuffer(GL_ARRAY_BUFFER, fieldBuffer);
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(field.size() * sizeof(float)), field.constData(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    /**
+     * @brief One frame looking along @p heading degrees; @p switchDistance <= 0 draws meshes only.
+     */
+    FrameResult render(float heading, float switchDistance, QImage *image)
+    {
+        FrameResult result;
+        QElapsedTimer timer;
+        timer.start();
+
+        const float extent = std::sqrt(float(field.size() / TransformFloats)) * ObjectSpacing;
+        QMatrix4x4 viewProjection;
+        viewProjection.perspective(FieldOfView, float(size.width()) / float(size.height()), 0.1f, extent);
+        const float radians = qDegreesToRadians(heading);
+        viewProjection.lookAt(CameraPosition,
+                              CameraPosition + QVector3D(std::sin(radians), -0.12f, std::cos(radians)),
+                              QVector3D(0.0f, 1.0f, 0.0f));
+
+        target->bind();
+        glViewport(0, 0, size.width(), size.height());
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(0.55f, 0.7f, 0.85f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        const int count = field.size() / TransformFloats;
+        if (switchDistance <= 0.0f) {
+            drawMeshes(viewProjection, fieldBuffer, count);
+            result.meshes = count;
+        } else {
+            if (impostors.bake() > 0) {
+                bakeMilliseconds = impostors.stats().bakeMilliseconds;
+            }
+            QElapsedTimer partitionTimer;
+            partitionTimer.start();
+            nearTransforms.clear();
+            farTransforms.clear();
+            impostors.partition(torusObject, field.constData(), count, CameraPosition, switchDistance,
+                                &nearTransforms, &farTransforms);
+            glBindBuffer(GL_ARRAY_BUFFER, nearBuffer);
+            glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(nearTransforms.size() * sizeof(float)),
+                         nearTransforms.constData(), GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            result.partitionMilliseconds = partitionTimer.nsecsElapsed() / 1.0e6;
+
+            result.meshes = nearTransforms.size() / TransformFloats;
+            drawMeshes(viewProjection, nearBuffer, result.meshes);
+            result.impostors = farTransforms.size() / TransformFloats;
+            if (!impostors.draw(torusObject, viewProjection, CameraPosition, farTransforms.constData(),
+                                result.impostors)) {
+                // Not baked yet: the next bake() will be, until then these stay meshes
+                glBindBuffer(GL_ARRAY_BUFFER, nearBuffer);
+                glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(farTransforms.size() * sizeof(float)),
+                             farTransforms.constData(), GL_STREAM_DRAW);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                drawMeshes(viewProjection, nearBuffer, result.impostors);
+                result.meshes += result.impostors;
+                result.impostors = 0;
+            }
+        }
+        glFinish();
+        result.milliseconds = timer.nsecsElapsed() / 1.0e6;
+
+        if (image) {
+            if (image->size() != size) {
+                *image = QImage(size, QImage::Format_RGB32);
+            }
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glReadPixels(0, 0, size.width(), size.height(), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, image->bits());
+        }
+        return result;
+    }
+
+private:
+    void drawMeshes(const QMatrix4x4 &viewProjection, GLuint transforms, int count)
+    {
+        if (count <= 0) {
+            return;
+        }
+        program->bind();
+        program->setUniformValue("viewProjection", viewProjection);
+        program->setUniformValue("instanced", true);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, transforms);
+        for (int row = 0; row < 3; ++row) {
+            glVertexAttribPointer(GLuint(1 + row), 4, GL_FLOAT, GL_FALSE, TransformFloats * sizeof(float),
+                                  reinterpret_cast<void *>(quintptr(row * 4 * sizeof(float))));
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr, count);
+        glBindVertexArray(0);
+        program->release();
+    }
+
+    void release()
+    {
+        if (!context || !context->makeCurrent(&surface)) {
+            return;
+        }
+        impostors.release();
+        if (vao) {
+            glDeleteVertexArrays(1, &vao);
+            glDeleteVertexArrays(1, &bakeVao);
+            for (GLuint *buffer : { &vertexBuffer, &indexBuffer, &fieldBuffer, &nearBuffer }) {
+                glDeleteBuffers(1, buffer);
+            }
+        }
+        program.reset();
+        target.reset();
+        context->doneCurrent();
+    }
+
+    std::unique_ptr<QOpenGLContext> context;
+    QOffscreenSurface surface;
+    QString renderer;
+    QSize size;
+    std::unique_ptr<QOpenGLFramebufferObject> target;
+    std::unique_ptr<QOpenGLShaderProgram> program;
+    GLuint vao = 0;
+    GLuint bakeVao = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLuint fieldBuffer = 0;                 // Every transform, static
+    GLuint nearBuffer = 0;                  // The transforms drawn as meshes this frame
+    GLsizei indexCount = 0;
+    float objectRadius = 0.0f;
+
+    ImpostorCache impostors;
+    int torusObject = -1;
+    double bakeMilliseconds = 0.0;          // Of the last bake() that baked anything
+    QVector<float> field;
+    QVector<float> nearTransforms;
+    QVector<float> farTransforms;
+};
+
+// Share of pixels where a channel differs by more than @p tolerance
+static double differingPixels(const QImage &a, const QImage &b, int tolerance)
+{
+    qint64 differing = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        const QRgb *lineA = reinterpret_cast<const QRgb *>(a.constScanLine(y));
+        const QRgb *lineB = reinterpret_cast<const QRgb *>(b.constScanLine(y));
+        for (int x = 0; x < a.width(); ++x) {
+            if (qAbs(qRed(lineA[x]) - qRed(lineB[x])) > tolerance
+                || qAbs(qGreen(lineA[x]) - qGreen(lineB[x])) > tolerance
+                || qAbs(qBlue(lineA[x]) - qBlue(lineB[x])) > tolerance) {
+                ++differing;
+            }
+        }
+    }
+    return 100.0 * double(differing) / double(qMax(1, a.width() * a.height()));
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Instanced meshes versus octahedral impostors on dense fields of objects.");
+    parser.addHelpOption();
+    QCommandLineOption objectsOption("objects", "Comma-separated object counts.", "list", "100000,250000");
+    QCommandLineOption pixelsOption("pixels", "Comma-separated switch sizes: objects smaller than this on screen "
+                                    "become impostors.", "list", "64,32,16");
+    QCommandLineOption framesOption("frames", "Timed frames per configuration.", "n", "10");
+    QCommandLineOption sizeOption("size", "Frame size.", "WxH", "1280x720");
+    QCommandLineOption ringsOption("rings", "Torus tessellation around the hole.", "n", "24");
+    QCommandLineOption sidesOption("sides", "Torus tessellation around the tube.", "n", "12");
+    QCommandLineOption viewsOption("views", "Impostor views per side of the octahedral grid.", "n", "8");
+    QCommandLineOption viewSizeOption("view-size", "Impostor pixels per view, a power of two.", "n", "64");
+    QCommandLineOption saveOption("save", "Write the last frame of every configuration as PNG into <dir>.", "dir");
+    parser.addOptions({ objectsOption, pixelsOption, framesOption, sizeOption, ringsOption, sidesOption,
+                        viewsOption, viewSizeOption, saveOption });
+    parser.process(app);
+
+    QVector<int> objectCounts;
+    for (const QString &text : parser.value(objectsOption).split(',')) {
+        const int count = text.toInt();
+        if (count <= 0) {
+            qWarning() << "impostorbench: invalid object count" << text;
+            return 1;
+        }
+        objectCounts.append(count);
+    }
+    QVector<float> pixelList;
+    for (const QString &text : parser.value(pixelsOption).split(',')) {
+        pixelList.append(qMax(1.0f, text.toFloat()));
+    }
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    const QStringList sizeText = parser.value(sizeOption).split('x');
+    const QSize size(qMax(1, sizeText.value(0).toInt()), qMax(1, sizeText.value(1).toInt()));
+    const QString saveDirectory = parser.value(saveOption);
+
+    ImpostorCache::Params params;
+    params.maxObjects = 1;
+    params.viewsPerSide = qMax(1, parser.value(viewsOption).toInt());
+    params.viewSize = parser.value(viewSizeOption).toInt();
+    FieldRenderer renderer;
+    if (!renderer.initialize(size, qMax(3, parser.value(ringsOption).toInt()),
+                             qMax(3, parser.value(sidesOption).toInt()), params)) {
+        return 1;
+    }
+    qInfo().noquote() << "Renderer:" << renderer.rendererName();
+    qInfo().noquote() << QString("%1x%2 pixels, %3 frames each, %4 triangles per torus, impostors %5x%5 views of "
+                                 "%6 px")
+                             .arg(size.width())
+                             .arg(size.height())
+                             .arg(frames)
+                             .arg(renderer.triangles())
+                             .arg(params.viewsPerSide)
+                             .arg(params.viewSize);
+    qInfo().noquote() << "  objects | switch  |  meshes | impostors | split ms | frame ms | speedup | differing px";
+
+    for (int count : objectCounts) {
+        renderer.setField(makeField(count));
+
+        // The camera turns a little every frame; all configurations see the same frames
+        const auto run = [&](float switchDistance, QImage *lastImage) {
+            renderer.render(0.0f, switchDistance, nullptr);
+            renderer.render(0.0f, switchDistance, nullptr);
+            FrameResult total;
+            for (int frame = 1; frame <= frames; ++frame) {
+                const FrameResult result = renderer.render(frame * 3.0f, switchDistance,
+                                                           frame == frames ? lastImage : nullptr);
+                total.milliseconds += result.milliseconds;
+                total.partitionMilliseconds += result.partitionMilliseconds;
+                total.meshes = result.meshes;
+                total.impostors = result.impostors;
+            }
+            total.milliseconds /= frames;
+            total.partitionMilliseconds /= frames;
+            return total;
+        };
+
+        QImage meshImage;
+        const FrameResult meshes = run(0.0f, &meshImage);
+        qInfo().noquote() << QString("  %1 | meshes  | %2 | %3 |        - | %4 |   1.00x |            -")
+                                 .arg(count, 7)
+                                 .arg(meshes.meshes, 7)
+                                 .arg(0, 9)
+                                 .arg(meshes.milliseconds, 8, 'f', 1);
+        if (!saveDirectory.isEmpty()) {
+            QDir().mkpath(saveDirectory);
+            meshImage.mirrored(false, true).save(QDir(saveDirectory).filePath(QString("%1_meshes.png").arg(count)));
+        }
+
+        for (float pixels : pixelList) {
+            const float distance = ImpostorCache::switchDistance(renderer.radius(), FieldOfView, size.height(),
+                                                                 pixels);
+            QImage image;
+            const FrameResult mixed = run(distance, &image);
+            qInfo().noquote() << QString("  %1 | <%2 px | %3 | %4 | %5 | %6 | %7x | %8 %")
+                                     .arg(count, 7)
+                                     .arg(pixels, 3, 'f', 0)
+                                     .arg(mixed.meshes, 7)
+                                     .arg(mixed.impostors, 9)
+                                     .arg(mixed.partitionMilliseconds, 8, 'f', 2)
+                                     .arg(mixed.milliseconds, 8, 'f', 1)
+                                     .arg(meshes.milliseconds / qMax(0.001, mixed.milliseconds), 6, 'f', 2)
+                                     .arg(differingPixels(meshImage, image, 24), 10, 'f', 2);
+            if (!saveDirectory.isEmpty()) {
+                image.mirrored(false, true).save(
+                    QDir(saveDirectory).filePath(QString("%1_impostors_%2px.png").arg(count).arg(pixels)));
+            }
+        }
+    }
+
+    const ImpostorCache::Stats stats = renderer.impostorStats();
+    qInfo().noquote() << QString("Impostor atlas: %1 KiB, bake %2 ms")
+                             .arg(stats.atlasBytes / 1024)
+                             .arg(renderer.lastBakeMilliseconds(), 0, 'f', 2);
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <cstring>
+#include "meshfile.h"
+#include "objreader.h"
+
+// Converts Wavefront OBJ models into the mesh container of common/meshfileformat.h,
+// and compares loading both:
+//   meshconv convert model.obj model.qmesh [--compress]
+//   meshconv generate 4000000 torus.obj
+//   meshconv bench model.obj [--runs n]
+
+using namespace meshfile;
+
+static double megabytes(qint64 bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+static int convert(const QString &input, const QString &output, bool compress)
+{
+    MeshData mesh;
+    ObjStats stats;
+    if (!readObj(input, &mesh, &stats)) {
+        return 1;
+    }
+    if (!MeshFile::write(output, mesh, compress ? Encoding::DeltaZigzagPlanes : Encoding::Raw)) {
+        return 1;
+    }
+    qInfo().noquote() << QString("meshconv: %1 positions, %2 faces -> %3 vertices (%4 bytes each), %5 triangles, "
+                                 "%6-bit indices")
+                             .arg(stats.positions)
+                             .arg(stats.faces)
+                             .arg(mesh.vertexCount)
+                             .arg(mesh.vertexStride)
+                             .arg(mesh.indexCount() / 3)
+                             .arg(mesh.indexSize * 8);
+    qInfo().noquote() << QString("meshconv: %1 MiB OBJ -> %2 MiB %3")
+                             .arg(megabytes(stats.fileBytes), 0, 'f', 1)
+                             .arg(megabytes(QFileInfo(output).size()), 0, 'f', 1)
+                             .arg(output);
+    return 0;
+}
+
+// Open plus one copy of both streams, standing in for glBufferData(): the pages are really read
+static double loadMeshFile(const QString &filePath, QByteArray *sink, double *decodeMilliseconds)
+{
+    QElapsedTimer timer;
+    timer.start();
+    MeshFile mesh;
+    if (!mesh.open(filePath)) {
+        return -1.0;
+    }
+    sink->resize(mesh.vertexDataSize() + mesh.indexDataSize());
+    std::memcpy(sink->data(), mesh.vertexData(), size_t(mesh.vertexDataSize()));
+    std::memcpy(sink->data() + mesh.vertexDataSize(), mesh.indexData(), size_t(mesh.indexDataSize()));
+    *decodeMilliseconds = mesh.decodeMilliseconds();
+    return timer.nsecsElapsed() / 1.0e6;
+}
+
+static int bench(const QString &input, int runs)
+{
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        qWarning() << "meshconv: cannot create a temporary directory";
+        return 1;
+    }
+    const QString rawPath = directory.filePath("raw.qmesh");
+    const QString compressedPath = directory.filePath("compressed.qmesh");
+
+    // Best of several runs each: the files sit in the page cache after the first, so this compares parsing and
+    // decoding, not the disk
+    MeshData mesh;
+    ObjStats best;
+    for (int run = 0; run < runs; ++run) {
+        ObjStats stats;
+        if (!readObj(input, &mesh, &stats)) {
+            return 1;
+        }
+        if (run == 0 || stats.readMilliseconds + stats.parseMilliseconds
+                            < best.readMilliseconds + best.parseMilliseconds) {
+            best = stats;
+        }
+    }
+    if (!MeshFile::write(rawPath, mesh, Encoding::Raw)
+        || !MeshFile::write(compressedPath, mesh, Encoding::DeltaZigzagPlanes)) {
+        return 1;
+    }
+
+    const qint64 payload = qint64(mesh.vertices.size()) + mesh.indices.size();
+    QByteArray reference = mesh.vertices + mesh.indices;
+    QByteArray sink;
+    double rawMilliseconds = 1.0e9;
+    double compressedMilliseconds = 1.0e9;
+    double decodeMilliseconds = 1.0e9;
+    for (int run = 0; run < runs; ++run) {
+        double decode = 0.0;
+        const double raw = loadMeshFile(rawPath, &sink, &decode);
+        if (raw < 0.0 || sink != reference) {
+            qWarning() << "meshconv: raw mesh file does not round-trip";
+            return 1;
+        }
+        rawMilliseconds = qMin(rawMilliseconds, raw);
+        const double compressed = loadMeshFile(compressedPath, &sink, &decode);
+        if (compressed < 0.0 || sink != reference) {
+            qWarning() << "meshconv: compressed mesh file does not round-trip";
+            return 1;
+        }
+        compressedMilliseconds = qMin(compressedMilliseconds, compressed);
+        decodeMilliseconds = qMin(decodeMilliseconds, decode);
+    }
+
+    qInfo().noquote() << QString("%1: %2 vertices, %3 triangles, %4 MiB of vertex and index data, best of %5")
+                             .arg(QFileInfo(input).fileName())
+                             .arg(mesh.vertexCount)
+                             .arg(mesh.indexCount() / 3)
+                             .arg(megabytes(payload), 0, 'f', 1)
+                             .arg(runs);
+    qInfo().noquote() << "  format           | file MiB | load ms | of which decode | GB/s of mesh data";
+    const auto row = [payload](const char *name, qint64 bytes, double milliseconds, double decode) {
+        qInfo().noquote() << QString("  %1 | %2 | %3 | %4 | %5")
+                                 .arg(QLatin1String(name), -16)
+                                 .arg(megabytes(bytes), 8, 'f', 1)
+                                 .arg(milliseconds, 7, 'f', 1)
+                                 .arg(decode >= 0.0 ? QString::number(decode, 'f', 1) : QString("-"), 15)
+                                 .arg(payload / (milliseconds * 1.0e6), 17, 'f', 2);
+    };
+    row("OBJ (text)", best.fileBytes, best.readMilliseconds + best.parseMilliseconds, best.parseMilliseconds);
+    row("qmesh raw", QFileInfo(rawPath).size(), rawMilliseconds, -1.0);
+    row("qmesh compressed", QFileInfo(compressedPath).size(), compressedMilliseconds, decodeMilliseconds);
+    qInfo().noquote() << "  (OBJ: decode column is parsing; loads copy both streams once, like glBufferData)";
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts OBJ models to memory-mappable mesh files and benchmarks loading.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "convert <input.obj> <output.qmesh> | generate <triangles> <output.obj> | "
+                                            "bench <input.obj>");
+    QCommandLineOption compressOption("compress", "convert: delta + zigzag + byte-plane encode both streams.");
+    QCommandLineOption runsOption("runs", "bench: runs per format, the best one is reported.", "n", "3");
+    parser.addOptions({ compressOption, runsOption });
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    const QString command = args.value(0);
+    if (command == "convert" && args.size() == 3) {
+        return convert(args[1], args[2], parser.isSet(compressOption));
+    }
+    if (command == "generate" && args.size() == 3) {
+        const qint64 triangles = args[1].toLongLong();
+        if (triangles <= 0) {
+            qWarning() << "meshconv: invalid triangle count" << args[1];
+            return 1;
+        }
+        return writeGeneratedObj(args[2], triangles) ? 0 : 1;
+    }
+    if (command == "bench" && args.size() == 2) {
+        return bench(args[1], qMax(1, parser.value(runsOption).toInt()));
+    }
+    parser.showHelp(1);
+}
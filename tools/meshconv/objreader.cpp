@@ -0,0 +1,356 @@
+#include "objreader.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QVector3D>
+#include <QtMath>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+// ------------------- Parsing Helpers -------------------
+
+// A face corner: 0-based position, texture coordinate and normal, -1 where absent
+struct Corner {
+    int position = -1;
+    int texCoord = -1;
+    int normal = -1;
+};
+
+static bool operator==(const Corner &a, const Corner &b)
+{
+    return a.position == b.position && a.texCoord == b.texCoord && a.normal == b.normal;
+}
+
+static size_t qHash(const Corner &corner, size_t seed = 0)
+{
+    return qHashMulti(seed, corner.position, corner.texCoord, corner.normal);
+}
+
+static const char *skipSpaces(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        ++p;
+    }
+    return p;
+}
+
+// std::from_chars does not depend on the C locale, unlike strtof()
+static bool parseFloats(const char *p, const char *end, float *values, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        p = skipSpaces(p, end);
+        if (p < end && *p == '+') {
+            ++p;
+        }
+        const std::from_chars_result result = std::from_chars(p, end, values[i]);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+    }
+    return true;
+}
+
+// One OBJ index: 1-based, or negative counting back from the last element read so far; 0 if absent
+static const char *parseIndex(const char *p, const char *end, int *index)
+{
+    *index = 0;
+    const bool negative = p < end && *p == '-';
+    if (negative) {
+        ++p;
+    }
+    int value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+    *index = negative ? -value : value;
+    return p;
+}
+
+static int resolveIndex(int index, int count)
+{
+    if (index > 0) {
+        return index <= count ? index - 1 : -2;
+    }
+    if (index < 0) {
+        return count + index >= 0 ? count + index : -2;
+    }
+    return -1;
+}
+
+// ------------------- Reading -------------------
+
+bool readObj(const QString &filePath, MeshData *mesh, ObjStats *stats)
+{
+    using namespace meshfile;
+    ObjStats local;
+    ObjStats &s = stats ? *stats : local;
+    s = ObjStats();
+
+    QElapsedTimer timer;
+    timer.start();
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "readObj: cannot open" << filePath;
+        return false;
+    }
+    const QByteArray text = file.readAll();
+    s.fileBytes = text.size();
+    s.readMilliseconds = timer.nsecsElapsed() / 1.0e6;
+    timer.restart();
+
+    QVector<float> positions;
+    QVector<float> normals;
+    QVector<float> texCoords;
+    QVector<Corner> corners;                // One per output vertex
+    QHash<Corner, quint32> cornerIds;
+    QVector<quint32> indices;
+    QVector<quint32> face;
+    positions.reserve(int(text.size() / 40));
+    indices.reserve(int(text.size() / 10));
+
+    const char *p = text.constData();
+    const char *const end = p + text.size();
+    int lineNumber = 0;
+    while (p < end) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', size_t(end - p)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        ++lineNumber;
+        const char *q = skipSpaces(p, lineEnd);
+        bool ok = true;
+        if (lineEnd - q >= 2 && q[0] == 'v' && (q[1] == ' ' || q[1] == '\t')) {
+            float value[3];
+            ok = parseFloats(q + 2, lineEnd, value, 3);
+            positions.append(value[0]);
+            positions.append(value[1]);
+            positions.append(value[2]);
+        } else if (lineEnd - q >= 3 && q[0] == 'v' && q[1] == 'n') {
+            float value[3];
+            ok = parseFloats(q + 2, lineEnd, value, 3);
+            normals.append(value[0]);
+            normals.append(value[1]);
+            normals.append(value[2]);
+        } else if (lineEnd - q >= 3 && q[0] == 'v' && q[1] == 't') {
+            float value[2];
+            ok = parseFloats(q + 2, lineEnd, value, 2);
+            texCoords.append(value[0]);
+            texCoords.append(value[1]);
+        } else if (lineEnd - q >= 2 && q[0] == 'f' && (q[1] == ' ' || q[1] == '\t')) {
+            face.clear();
+            q = skipSpaces(q + 2, lineEnd);
+            while (ok && q < lineEnd) {
+                int index[3] = { 0, 0, 0 };
+                q = parseIndex(q, lineEnd, &index[0]);
+                for (int part = 1; part < 3 && q < lineEnd && *q == '/'; ++part) {
+                    q = parseIndex(q + 1, lineEnd, &index[part]);
+                }
+                Corner corner;
+                corner.position = resolveIndex(index[0], positions.size() / 3);
+                corner.texCoord = resolveIndex(index[1], texCoords.size() / 2);
+                corner.normal = resolveIndex(index[2], normals.size() / 3);
+                ok = corner.position >= 0 && corner.texCoord != -2 && corner.normal != -2;
+                if (ok) {
+                    auto it = cornerIds.constFind(corner);
+                    if (it == cornerIds.constEnd()) {
+                        it = cornerIds.insert(corner, quint32(corners.size()));
+                        corners.append(corner);
+                    }
+                    face.append(it.value());
+                }
+                q = skipSpaces(q, lineEnd);
+            }
+            ok = ok && face.size() >= 3;
+            for (int k = 1; ok && k + 1 < face.size(); ++k) {
+                indices.append(face[0]);
+                indices.append(face[k]);
+                indices.append(face[k + 1]);
+            }
+            ++s.faces;
+        }
+        if (!ok) {
+            qWarning() << "readObj: cannot parse line" << lineNumber << "of" << filePath;
+            return false;
+        }
+        p = lineEnd + 1;
+    }
+    s.positions = positions.size() / 3;
+    s.normals = normals.size() / 3;
+    s.texCoords = texCoords.size() / 2;
+    if (indices.isEmpty()) {
+        qWarning() << "readObj: no faces in" << filePath;
+        return false;
+    }
+
+    // Area-weighted normals for the corners the file gave none
+    const int vertexCount = corners.size();
+    QVector<QVector3D> computed;
+    bool anyMissing = false;
+    for (const Corner &corner : std::as_const(corners)) {
+        anyMissing = anyMissing || corner.normal < 0;
+    }
+    if (anyMissing) {
+        computed.fill(QVector3D(), vertexCount);
+        const auto position = [&](quint32 vertex) {
+            const float *v = positions.constData() + 3 * corners[int(vertex)].position;
+            return QVector3D(v[0], v[1], v[2]);
+        };
+        for (int i = 0; i + 2 < indices.size(); i += 3) {
+            const QVector3D a = position(indices[i]);
+            const QVector3D n = QVector3D::crossProduct(position(indices[i + 1]) - a, position(indices[i + 2]) - a);
+            computed[int(indices[i])] += n;
+            computed[int(indices[i + 1])] += n;
+            computed[int(indices[i + 2])] += n;
+        }
+    }
+
+    // Interleave: position, normal, texture coordinate
+    const bool hasTexCoords = !texCoords.isEmpty();
+    mesh->attributes = { { Semantic::Position, ComponentType::Float32, 3, 0, 0 },
+                         { Semantic::Normal, ComponentType::Float32, 3, 0, 12 } };
+    if (hasTexCoords) {
+        mesh->attributes.append({ Semantic::TexCoord0, ComponentType::Float32, 2, 0, 24 });
+    }
+    mesh->vertexStride = hasTexCoords ? 32 : 24;
+    mesh->vertexCount = quint32(vertexCount);
+    mesh->vertices.resize(qsizetype(vertexCount) * mesh->vertexStride);
+    float *out = reinterpret_cast<float *>(mesh->vertices.data());
+    for (int i = 0; i < 3; ++i) {
+        mesh->boundsMin[i] = positions[corners[0].position * 3 + i];
+        mesh->boundsMax[i] = mesh->boundsMin[i];
+    }
+    for (int v = 0; v < vertexCount; ++v) {
+        const Corner &corner = corners[v];
+        const float *position = positions.constData() + 3 * corner.position;
+        for (int i = 0; i < 3; ++i) {
+            *out++ = position[i];
+            mesh->boundsMin[i] = qMin(mesh->boundsMin[i], position[i]);
+            mesh->boundsMax[i] = qMax(mesh->boundsMax[i], position[i]);
+        }
+        const QVector3D normal = corner.normal >= 0
+                                     ? QVector3D(normals[3 * corner.normal], normals[3 * corner.normal + 1],
+                                                 normals[3 * corner.normal + 2])
+                                     : computed[v].normalized();
+        *out++ = normal.x();
+        *out++ = normal.y();
+        *out++ = normal.z();
+        if (hasTexCoords) {
+            *out++ = corner.texCoord >= 0 ? texCoords[2 * corner.texCoord] : 0.0f;
+            *out++ = corner.texCoord >= 0 ? texCoords[2 * corner.texCoord + 1] : 0.0f;
+        }
+    }
+
+    // 16-bit indices when every vertex fits
+    mesh->indexSize = vertexCount <= 0x10000 ? 2 : 4;
+    mesh->indices.resize(qsizetype(indices.size()) * mesh->indexSize);
+    if (mesh->indexSize == 2) {
+        quint16 *target = reinterpret_cast<quint16 *>(mesh->indices.data());
+        for (quint32 index : std::as_const(indices)) {
+            *target++ = quint16(index);
+        }
+    } else {
+        std::memcpy(mesh->indices.data(), indices.constData(), size_t(mesh->indices.size()));
+    }
+    mesh->lods.clear();
+
+    s.parseMilliseconds = timer.nsecsElapsed() / 1.0e6;
+    return true;
+}
+
+// ------------------- Generating -------------------
+
+bool writeGeneratedObj(const QString &filePath, qint64 triangles)
+{
+    // rows x (2 rows) quads, two triangles each
+    const int rows = qMax(2, int(std::sqrt(double(triangles) / 4.0)));
+    const int columns = 2 * rows;
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "writeGeneratedObj: cannot write" << filePath;
+        return false;
+    }
+
+    QByteArray buffer;
+    buffer.reserve(1 << 22);
+    const auto flush = [&]() {
+        file.write(buffer);
+        buffer.clear();
+    };
+    const auto number = [&](float value) {
+        char digits[32];
+        const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr - digits);
+    };
+    const auto integer = [&](qint64 value) {
+        char digits[24];
+        const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr - digits);
+    };
+
+    buffer.append("# Bumpy torus, ");
+    integer(qint64(rows) * columns * 2);
+    buffer.append(" triangles\n");
+    const float major = 1.0f;
+    const float minor = 0.35f;
+    for (int r = 0; r <= rows; ++r) {
+        const float v = 2.0f * float(M_PI) * r / rows;
+        for (int c = 0; c <= columns; ++c) {
+            const float u = 2.0f * float(M_PI) * c / columns;
+            const float bump = 1.0f + 0.06f * std::sin(13.0f * u) * std::sin(7.0f * v);
+            const QVector3D ring(std::cos(u), 0.0f, std::sin(u));
+            const QVector3D normal = ring * std::cos(v) + QVector3D(0.0f, std::sin(v), 0.0f);
+            const QVector3D position = ring * major + normal * (minor * bump);
+            buffer.append("v ");
+            number(position.x());
+            buffer.append(' ');
+            number(position.y());
+            buffer.append(' ');
+            number(position.z());
+            buffer.append("\nvt ");
+            number(float(c) / columns);
+            buffer.append(' ');
+            number(float(r) / rows);
+            buffer.append("\nvn ");
+            number(normal.x());
+            buffer.append(' ');
+            number(normal.y());
+            buffer.append(' ');
+            number(normal.z());
+            buffer.append('\n');
+        }
+        if (buffer.size() > (1 << 22) - 4096) {
+            flush();
+        }
+    }
+    const auto corner = [&](qint64 index) {
+        integer(index);
+        buffer.append('/');
+        integer(index);
+        buffer.append('/');
+        integer(index);
+    };
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            const qint64 a = qint64(r) * (columns + 1) + c + 1;
+            const qint64 b = a + columns + 1;
+            const qint64 quad[2][3] = { { a, b, a + 1 }, { a + 1, b, b + 1 } };
+            for (const auto &triangle : quad) {
+                buffer.append('f');
+                for (qint64 index : triangle) {
+                    buffer.append(' ');
+                    corner(index);
+                }
+                buffer.append('\n');
+            }
+        }
+        if (buffer.size() > (1 << 22) - 4096) {
+            flush();
+        }
+    }
+    flush();
+    return file.error() == QFileDevice::NoError;
+}
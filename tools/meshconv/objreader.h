@@ -0,0 +1,35 @@
+#ifndef OBJREADER_H
+#define OBJREADER_H
+
+#include <QString>
+#include "meshfile.h"
+
+/**
+ * @brief What readObj() found and how long it took.
+ */
+struct ObjStats {
+    qint64 fileBytes = 0;
+    int positions = 0;
+    int normals = 0;
+    int texCoords = 0;
+    int faces = 0;
+    double readMilliseconds = 0.0;          // Whole file into memory
+    double parseMilliseconds = 0.0;         // Parsing, vertex deduplication and normals
+};
+
+/**
+ * @brief Reads a Wavefront OBJ into one interleaved mesh.
+ *
+ * Vertices are position, normal and, when the file has any, a texture
+ * coordinate (all float), one per distinct v/vt/vn triple. Polygons are
+ * triangulated as fans. Missing normals are computed, area-weighted. Groups,
+ * objects and materials are ignored: everything becomes one LOD.
+ */
+bool readObj(const QString &filePath, MeshData *mesh, ObjStats *stats = nullptr);
+
+/**
+ * @brief Writes a tessellated, bumpy torus with about @p triangles triangles as OBJ, for benchmarks.
+ */
+bool writeGeneratedObj(const QString &filePath, qint64 triangles);
+
+#endif // OBJREADER_H
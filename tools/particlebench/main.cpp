@@ -0,0 +1,140 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QSurfaceFormat>
+#include <QVector>
+#include "countarg.h"
+#include "particlesystem.h"
+
+// Simulates the GPU particle system (common/particlesystem.h) headless at several
+// particle counts and reports particles simulated per second, measured with
+// GL_TIME_ELAPSED queries around each update (and draw, with --render).
+// Emission is set so every slot is alive at steady state, which the warm-up reaches.
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Transform feedback particle simulation benchmark.");
+    parser.addHelpOption();
+    QCommandLineOption countsOption("counts", "Comma-separated particle counts.", "list", "1M,2M,5M,10M");
+    QCommandLineOption framesOption("frames", "Timed frames per count.", "n", "200");
+    QCommandLineOption warmupOption("warmup", "Untimed frames first (fills the particle slots).", "n", "300");
+    QCommandLineOption dtOption("dt", "Simulation step in seconds.", "s", "0.016");
+    QCommandLineOption renderOption("render", "Also draw the particles into a <WxH> framebuffer every frame.", "WxH");
+    parser.addOptions({ countsOption, framesOption, warmupOption, dtOption, renderOption });
+    parser.process(app);
+
+    QVector<int> counts;
+    for (const QString &text : parser.value(countsOption).split(',')) {
+        const int count = parseCount(text);
+        if (count <= 0) {
+            qWarning() << "particlebench: invalid count" << text;
+            return 1;
+        }
+        counts.append(count);
+    }
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    const int warmup = qMax(0, parser.value(warmupOption).toInt());
+    const float dt = parser.value(dtOption).toFloat();
+
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create()) {
+        qWarning() << "particlebench: cannot create an OpenGL 3.3 core context";
+        return 1;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        qWarning() << "particlebench: cannot make the context current";
+        return 1;
+    }
+
+    QOpenGLFunctions_3_3_Core gl;
+    gl.initializeOpenGLFunctions();
+    qInfo().noquote() << "Renderer:" << reinterpret_cast<const char *>(gl.glGetString(GL_RENDERER));
+
+    QOpenGLFramebufferObject *target = nullptr;
+    QMatrix4x4 view;
+    QMatrix4x4 projection;
+    if (parser.isSet(renderOption)) {
+        const QStringList size = parser.value(renderOption).split('x');
+        const int width = qMax(1, size.value(0).toInt());
+        const int height = qMax(1, size.value(1).toInt());
+        target = new QOpenGLFramebufferObject(width, height, QOpenGLFramebufferObject::Depth);
+        target->bind();
+        gl.glViewport(0, 0, width, height);
+        view.lookAt(QVector3D(0.0f, 0.4f, 3.0f), QVector3D(0.0f, 0.2f, 0.0f), QVector3D(0.0f, 1.0f, 0.0f));
+        projection.perspective(45.0f, float(width) / float(height), 0.05f, 100.0f);
+    }
+
+    QVector<GLuint> queries(frames);
+    gl.glGenQueries(frames, queries.data());
+
+    int failures = 0;
+    for (int count : counts) {
+        ParticleSystem particles;
+        ParticleSystem::Params params;
+        params.maxParticles = count;
+        params.emitRate = count / (0.5f * (params.lifetimeMin + params.lifetimeMax));
+        if (!particles.initialize(params)) {
+            qInfo().noquote() << QString("%1 particles: cannot initialize (see above)").arg(count);
+            ++failures;
+            continue;
+        }
+
+        for (int i = 0; i < warmup; ++i) {
+            particles.update(dt);
+        }
+        gl.glFinish();
+
+        QElapsedTimer wall;
+        wall.start();
+        for (int i = 0; i < frames; ++i) {
+            gl.glBeginQuery(GL_TIME_ELAPSED, queries[i]);
+            particles.update(dt);
+            if (target) {
+                gl.glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                particles.render(view, projection);
+            }
+            gl.glEndQuery(GL_TIME_ELAPSED);
+        }
+        gl.glFinish();
+        const double wallSeconds = wall.nsecsElapsed() / 1.0e9;
+
+        double gpuSeconds = 0.0;
+        for (GLuint query : queries) {
+            GLuint64 ns = 0;
+            gl.glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+            gpuSeconds += ns / 1.0e9;
+        }
+
+        const double simulated = double(count) * frames;
+        qInfo().noquote() << QString("%1 particles: %2 ms/frame GPU, %3 ms/frame wall, %4 M particles/s (GPU), %5 M/s (wall)%6")
+                                 .arg(count, 9)
+                                 .arg(gpuSeconds * 1000.0 / frames, 0, 'f', 3)
+                                 .arg(wallSeconds * 1000.0 / frames, 0, 'f', 3)
+                                 .arg(simulated / qMax(gpuSeconds, 1.0e-9) / 1.0e6, 0, 'f', 1)
+                                 .arg(simulated / qMax(wallSeconds, 1.0e-9) / 1.0e6, 0, 'f', 1)
+                                 .arg(target ? ", update + draw" : "");
+        particles.release();
+    }
+
+    gl.glDeleteQueries(frames, queries.data());
+    delete target;
+    context.doneCurrent();
+    return failures == counts.size() ? 1 : 0;
+}
@@ -0,0 +1,1078 @@
+#include "cloudbuilder.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QVector>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace pointcloud;
+
+static const int MaxLevel = 20;                 // Deeper cells keep whatever they get: duplicates
+static const int MaxBucketLevel = 3;            // 512 bucket files open at most in pass 2
+static const qint64 ReadBatch = 65536;
+static const int BucketFlushPoints = 65536;
+
+// ------------------- Point Reader -------------------
+
+namespace {
+
+/**
+ * @brief Streams the points of a PLY or XYZ file, in batches, as many times as needed.
+ */
+class PointReader
+{
+public:
+    bool open(const QString &filePath);
+    bool rewind()
+    {
+        pointsRead = 0;
+        return file.seek(dataStart);
+    }
+    /**
+     * @return Points read into @p points, 0 at the end, -1 on a read error.
+     */
+    qint64 read(Point *points, qint64 maxPoints);
+    bool hasColor() const { return color; }
+    qint64 fileBytes() const { return file.size(); }
+
+private:
+    enum class Format { Xyz, PlyAscii, PlyBinary };
+    enum class Type { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+    struct Property {
+        Type type = Type::Float32;
+        int offset = 0;                         // In a binary record
+        int role = -1;                          // 0-2: x y z, 3-5: red green blue, -1: ignored
+    };
+
+    bool readHeader();
+    bool readLine();
+    static bool parseNumbers(const char *p, const char *end, double *values, int maxValues, int *count);
+    static int typeSize(Type type);
+    static double value(const uchar *data, Type type);
+    static quint8 colorValue(double value, Type type);
+
+    QFile file;
+    Format format = Format::Xyz;
+    qint64 dataStart = 0;
+    qint64 vertexCount = -1;                    // Unknown for XYZ
+    qint64 pointsRead = 0;
+    int recordSize = 0;
+    QVector<Property> properties;
+    bool color = false;
+    QByteArray line;
+    QByteArray records;
+};
+
+int PointReader::typeSize(Type type)
+{
+    static const int sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+    return sizes[int(type)];
+}
+
+template <typename T>
+static double load(const uchar *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return double(value);
+}
+
+double PointReader::value(const uchar *data, Type type)
+{
+    switch (type) {
+    case Type::Int8:
+        return load<qint8>(data);
+    case Type::UInt8:
+        return load<quint8>(data);
+    case Type::Int16:
+        return load<qint16>(data);
+    case Type::UInt16:
+        return load<quint16>(data);
+    case Type::Int32:
+        return load<qint32>(data);
+    case Type::UInt32:
+        return load<quint32>(data);
+    case Type::Float32:
+        return load<float>(data);
+    case Type::Float64:
+        return load<double>(data);
+    }
+    return 0.0;
+}
+
+// 8-bit colors as they are, 16-bit scaled down, floating point taken as 0..1
+quint8 PointReader::colorValue(double value, Type type)
+{
+    if (type == Type::UInt16 || type == Type::Int16) {
+        value /= 257.0;
+    } else if (type == Type::Float32 || type == Type::Float64) {
+        value *= 255.0;
+    }
+    return quint8(qBound(0.0, value + 0.5, 255.0));
+}
+
+bool PointReader::readLine()
+{
+    line = file.readLine();
+    return !line.isEmpty();
+}
+
+// std::from_chars does not depend on the C locale, unlike strtod()
+bool PointReader::parseNumbers(const char *p, const char *end, double *values, int maxValues, int *count)
+{
+    *count = 0;
+    while (*count < maxValues) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r' || *p == '\n')) {
+            ++p;
+        }
+        if (p == end) {
+            return true;
+        }
+        if (*p == '+') {
+            ++p;
+        }
+        const std::from_chars_result result = std::from_chars(p, end, values[*count]);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+        ++*count;
+    }
+    return true;
+}
+
+bool PointReader::open(const QString &filePath)
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "buildCloud: cannot open" << filePath;
+        return false;
+    }
+    if (file.peek(4) == "ply\n" || file.peek(5) == "ply\r\n") {
+        return readHeader();
+    }
+
+    // XYZ: the first line with numbers tells whether there are colors
+    format = Format::Xyz;
+    dataStart = 0;
+    while (readLine()) {
+        double values[6];
+        int count = 0;
+        if (parseNumbers(line.constData(), line.constData() + line.size(), values, 6, &count) && count >= 3) {
+            color = count >= 6;
+            break;
+        }
+    }
+    return file.seek(0);
+}
+
+bool PointReader::readHeader()
+{
+    static const QHash<QByteArray, Type> types = {
+        { "char", Type::Int8 }, { "int8", Type::Int8 }, { "uchar", Type::UInt8 }, { "uint8", Type::UInt8 },
+        { "short", Type::Int16 }, { "int16", Type::Int16 }, { "ushort", Type::UInt16 }, { "uint16", Type::UInt16 },
+        { "int", Type::Int32 }, { "int32", Type::Int32 }, { "uint", Type::UInt32 }, { "uint32", Type::UInt32 },
+        { "float", Type::Float32 }, { "float32", Type::Float32 }, { "double", Type::Float64 },
+        { "float64", Type::Float64 }
+    };
+    static const QList<QByteArray> roles = { "x", "y", "z", "red", "green", "blue" };
+
+    bool inVertex = false;
+    bool roleFound[6] = {};
+    readLine();
+    while (readLine()) {
+        const QList<QByteArray> words = line.simplified().split(' ');
+        if (words.isEmpty() || words[0] == "comment" || words[0] == "obj_info") {
+            continue;
+        }
+        if (words[0] == "end_header") {
+            dataStart = file.pos();
+            if (!roleFound[0] || !roleFound[1] || !roleFound[2]) {
+                qWarning() << "buildCloud:" << file.fileName() << "has no x, y and z vertex properties";
+                return false;
+            }
+            color = roleFound[3] && roleFound[4] && roleFound[5];
+            if (!color) {
+                for (Property &property : properties) {
+                    property.role = property.role >= 3 ? -1 : property.role;
+                }
+            }
+            return true;
+        }
+        if (words[0] == "format" && words.size() >= 2) {
+            if (words[1] == "ascii") {
+                format = Format::PlyAscii;
+            } else if (words[1] == "binary_little_endian") {
+                format = Format::PlyBinary;
+            } else {
+                qWarning() << "buildCloud:" << file.fileName() << "is" << words[1] << ", not ASCII or little endian";
+                return false;
+            }
+        } else if (words[0] == "element" && words.size() == 3) {
+            // Only a leading vertex element can be streamed without reading the others
+            if (vertexCount >= 0) {
+                inVertex = false;
+            } else if (words[1] == "vertex") {
+                inVertex = true;
+                vertexCount = words[2].toLongLong();
+            } else {
+                qWarning() << "buildCloud:" << file.fileName() << "does not start with the vertex element";
+                return false;
+            }
+        } else if (words[0] == "property" && inVertex) {
+            if (words.size() != 3 || !types.contains(words[1])) {
+                qWarning() << "buildCloud: unsupported vertex property in" << file.fileName() << ":" << line.trimmed();
+                return false;
+            }
+            Property property;
+            property.type = types.value(words[1]);
+            property.offset = recordSize;
+            property.role = int(roles.indexOf(words[2]));
+            if (property.role >= 0) {
+                roleFound[property.role] = true;
+            }
+            recordSize += typeSize(property.type);
+            properties.append(property);
+        }
+    }
+    qWarning() << "buildCloud:" << file.fileName() << "has no end_header";
+    return false;
+}
+
+qint64 PointReader::read(Point *points, qint64 maxPoints)
+{
+    qint64 count = 0;
+    if (format == Format::PlyBinary) {
+        const qint64 wanted = qMin(maxPoints, vertexCount - pointsRead);
+        if (wanted <= 0) {
+            return 0;
+        }
+        records.resize(qsizetype(wanted * recordSize));
+        if (file.read(records.data(), records.size()) != records.size()) {
+            qWarning() << "buildCloud:" << file.fileName() << "ends early";
+            return -1;
+        }
+        const uchar *record = reinterpret_cast<const uchar *>(records.constData());
+        for (; count < wanted; ++count, record += recordSize) {
+            Point &point = points[count];
+            for (const Property &property : std::as_const(properties)) {
+                if (property.role >= 3) {
+                    point.color[property.role - 3] = colorValue(value(record + property.offset, property.type),
+                                                                property.type);
+                } else if (property.role >= 0) {
+                    point.position[property.role] = float(value(record + property.offset, property.type));
+                }
+            }
+        }
+        pointsRead += count;
+        return count;
+    }
+
+    double values[64];
+    while (count < maxPoints && (vertexCount < 0 || pointsRead < vertexCount) && readLine()) {
+        int found = 0;
+        if (!parseNumbers(line.constData(), line.constData() + line.size(), values, 64, &found)) {
+            found = 0;
+        }
+        Point &point = points[count];
+        if (format == Format::Xyz) {
+            if (found < 3) {
+                continue;                       // Comments, headers and blank lines
+            }
+            for (int i = 0; i < 3; ++i) {
+                point.position[i] = float(values[i]);
+                point.color[i] = color && found >= 6 ? quint8(qBound(0.0, values[3 + i] + 0.5, 255.0)) : 0;
+            }
+        } else {
+            if (found < properties.size()) {
+                qWarning() << "buildCloud: short vertex line in" << file.fileName() << ":" << line.trimmed();
+                return -1;
+            }
+            for (int i = 0; i < properties.size(); ++i) {
+                const Property &property = properties[i];
+                if (property.role >= 3) {
+                    point.color[property.role - 3] = colorValue(values[i], property.type);
+                } else if (property.role >= 0) {
+                    point.position[property.role] = float(values[i]);
+                }
+            }
+        }
+        ++count;
+        ++pointsRead;
+    }
+    if (vertexCount >= 0 && count == 0 && pointsRead < vertexCount) {
+        qWarning() << "buildCloud:" << file.fileName() << "ends early";
+        return -1;
+    }
+    return count;
+}
+
+// ------------------- Octree Builder -------------------
+
+/**
+ * @brief A node while the tree is built; the on-disk Node is derived from its cell.
+ */
+struct BuildNode {
+    int level = 0;
+    quint32 cell[3] = { 0, 0, 0 };          // At its level
+    quint64 offset = 0;
+    quint32 pointCount = 0;
+    int children[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+    // Upper levels only, until they are written
+    QVector<Point> points;
+    std::vector<quint64> occupied;
+};
+
+/**
+ * @brief The points of one bucketLevel cell that no upper node took, spilled to a file.
+ */
+struct Bucket {
+    quint32 cell[3] = { 0, 0, 0 };
+    int parent = -1;                        // Upper node, -1 without upper levels
+    int octant = 0;                         // In the parent
+    quint64 order = 0;                      // Morton code: neighbouring subtrees end up near each other
+    QString name;                           // Of its file in the spill directory
+    std::unique_ptr<QFile> file;
+    QVector<Point> pending;
+};
+
+class OctreeBuilder
+{
+public:
+    OctreeBuilder(const CloudBuildParams &params, const CloudHeader &header, QFile *output)
+        : params(params), header(header), output(output), scratch(gridWords())
+    {
+    }
+
+    int addNode(int level, const quint32 cell[3], int parent, int octant);
+    // Cell of @p point at @p level; the cells of a level are exactly the halves of the level above
+    void cellOf(const Point &point, int level, quint32 cell[3]) const;
+    // Sampling grid cell of @p point in the node at @p level, @p cell
+    quint32 gridIndex(const Point &point, int level, const quint32 cell[3]) const;
+    bool writeChunk(int node, const QVector<Point> &points);
+    int buildSubtree(int level, const quint32 cell[3], QVector<Point> &points);
+    bool writeTable(quint64 *tableOffset, quint32 *maxNodePoints, quint32 *depth);
+
+    size_t gridWords() const { return (size_t(params.gridSize) * params.gridSize * params.gridSize + 63) / 64; }
+
+    QVector<BuildNode> nodes;
+    bool ok = true;
+
+private:
+    const CloudBuildParams &params;
+    const CloudHeader &header;
+    QFile *output;
+    std::vector<quint64> scratch;           // Sampling grid of the subtree node being split
+};
+
+int OctreeBuilder::addNode(int level, const quint32 cell[3], int parent, int octant)
+{
+    BuildNode node;
+    node.level = level;
+    std::copy(cell, cell + 3, node.cell);
+    nodes.append(std::move(node));
+    if (parent >= 0) {
+        nodes[parent].children[octant] = nodes.size() - 1;
+    }
+    return nodes.size() - 1;
+}
+
+void OctreeBuilder::cellOf(const Point &point, int level, quint32 cell[3]) const
+{
+    const float cells = float(1u << level);
+    for (int i = 0; i < 3; ++i) {
+        const float t = (point.position[i] - header.boundsMin[i]) / header.size * cells;
+        cell[i] = quint32(qBound(0.0f, std::floor(t), cells - 1.0f));
+    }
+}
+
+quint32 OctreeBuilder::gridIndex(const Point &point, int level, const quint32 cell[3]) const
+{
+    const float nodeSize = header.size / float(1u << level);
+    const int grid = params.gridSize;
+    quint32 index = 0;
+    for (int i = 2; i >= 0; --i) {
+        const float origin = header.boundsMin[i] + float(cell[i]) * nodeSize;
+        const int g = qBound(0, int((point.position[i] - origin) / nodeSize * float(grid)), grid - 1);
+        index = index * quint32(grid) + quint32(g);
+    }
+    return index;
+}
+
+bool OctreeBuilder::writeChunk(int node, const QVector<Point> &points)
+{
+    // Pad up to the next chunk boundary
+    const qint64 position = output->pos();
+    const qint64 aligned = (position + ChunkAlignment - 1) / ChunkAlignment * ChunkAlignment;
+    if (aligned > position) {
+        ok = ok && output->write(QByteArray(int(aligned - position), '\0')) == aligned - position;
+    }
+    const qint64 bytes = qint64(points.size()) * qint64(sizeof(Point));
+    ok = ok && output->write(reinterpret_cast<const char *>(points.constData()), bytes) == bytes;
+    nodes[node].offset = quint64(aligned);
+    nodes[node].pointCount = quint32(points.size());
+    return ok;
+}
+
+int OctreeBuilder::buildSubtree(int level, const quint32 cell[3], QVector<Point> &points)
+{
+    const int index = addNode(level, cell, -1, 0);
+    if (points.size() <= params.nodePoints || level >= MaxLevel) {
+        writeChunk(index, points);
+        points = QVector<Point>();
+        return index;
+    }
+
+    // One point per grid cell stays here, the rest is sorted into the octants
+    QVector<Point> kept;
+    QVector<quint32> taken;
+    QVector<Point> octants[8];
+    quint32 childCell[3];
+    for (const Point &point : std::as_const(points)) {
+        const quint32 g = gridIndex(point, level, cell);
+        quint64 &word = scratch[g / 64];
+        const quint64 bit = quint64(1) << (g % 64);
+        if (!(word & bit)) {
+            word |= bit;
+            taken.append(g);
+            kept.append(point);
+            continue;
+        }
+        cellOf(point, level + 1, childCell);
+        int octant = 0;
+        for (int i = 0; i < 3; ++i) {
+            childCell[i] = qBound(cell[i] * 2, childCell[i], cell[i] * 2 + 1);
+            octant |= int(childCell[i] & 1) << i;
+        }
+        octants[octant].append(point);
+    }
+    for (quint32 g : std::as_const(taken)) {
+        scratch[g / 64] = 0;
+    }
+    points = QVector<Point>();
+    writeChunk(index, kept);
+    kept = QVector<Point>();
+
+    for (int octant = 0; octant < 8; ++octant) {
+        if (octants[octant].isEmpty()) {
+            continue;
+        }
+        for (int i = 0; i < 3; ++i) {
+            childCell[i] = cell[i] * 2 + ((octant >> i) & 1);
+        }
+        const int child = buildSubtree(level + 1, childCell, octants[octant]);
+        nodes[index].children[octant] = child;
+    }
+    return index;
+}
+
+bool OctreeBuilder::writeTable(quint64 *tableOffset, quint32 *maxNodePoints, quint32 *depth)
+{
+    // Breadth first from the root (node 0), so the children of a node get consecutive indices
+    QVector<int> order = { 0 };
+    QVector<Node> table;
+    table.reserve(nodes.size());
+    *maxNodePoints = 0;
+    *depth = 0;
+    for (int i = 0; i < order.size(); ++i) {
+        const BuildNode &b = nodes[order[i]];
+        const float nodeSize = header.size / float(1u << b.level);
+        Node node;
+        for (int axis = 0; axis < 3; ++axis) {
+            node.center[axis] = header.boundsMin[axis] + (float(b.cell[axis]) + 0.5f) * nodeSize;
+        }
+        node.halfSize = nodeSize * 0.5f;
+        node.offset = b.offset;
+        node.pointCount = b.pointCount;
+        node.level = quint8(b.level);
+        node.spacing = nodeSize / float(params.gridSize);
+        node.firstChild = 0;
+        for (int octant = 0; octant < 8; ++octant) {
+            if (b.children[octant] >= 0) {
+                if (node.childMask == 0) {
+                    node.firstChild = quint32(order.size());
+                }
+                node.childMask |= quint8(1 << octant);
+                order.append(b.children[octant]);
+            }
+        }
+        *maxNodePoints = qMax(*maxNodePoints, node.pointCount);
+        *depth = qMax(*depth, quint32(b.level));
+        table.append(node);
+    }
+    if (order.size() != nodes.size()) {
+        qWarning() << "buildCloud:" << nodes.size() - order.size() << "nodes are not linked to the root";
+        return false;
+    }
+
+    const qint64 position = output->pos();
+    const qint64 aligned = (position + ChunkAlignment - 1) / ChunkAlignment * ChunkAlignment;
+    ok = ok && output->write(QByteArray(int(aligned - position), '\0')) == aligned - position;
+    const qint64 bytes = qint64(table.size()) * qint64(sizeof(Node));
+    ok = ok && output->write(reinterpret_cast<const char *>(table.constData()), bytes) == bytes;
+    *tableOffset = quint64(aligned);
+    return ok;
+}
+
+// Height ramp for clouds without colors: blue low, through green and yellow, to white high
+void colorByHeight(Point *point, float low, float high)
+{
+    static const float stops[][3] = { { 40, 70, 160 }, { 60, 150, 80 }, { 220, 200, 90 }, { 245, 245, 245 } };
+    const float t = high > low ? qBound(0.0f, (point->position[2] - low) / (high - low), 1.0f) * 3.0f : 0.0f;
+    const int stop = qMin(2, int(t));
+    const float f = t - float(stop);
+    for (int i = 0; i < 3; ++i) {
+        point->color[i] = quint8(stops[stop][i] + (stops[stop + 1][i] - stops[stop][i]) * f);
+    }
+}
+
+quint64 mortonCode(const quint32 cell[3])
+{
+    quint64 code = 0;
+    for (int bit = 0; bit < 21; ++bit) {
+        for (int axis = 0; axis < 3; ++axis) {
+            code |= quint64((cell[axis] >> bit) & 1) << (bit * 3 + axis);
+        }
+    }
+    return code;
+}
+
+bool readBucket(Bucket &bucket, QVector<Point> *points)
+{
+    const qint64 spilled = bucket.file ? bucket.file->size() / qint64(sizeof(Point)) : 0;
+    points->resize(qsizetype(spilled + bucket.pending.size()));
+    if (bucket.file) {
+        const qint64 bytes = spilled * qint64(sizeof(Point));
+        if (!bucket.file->seek(0) || bucket.file->read(reinterpret_cast<char *>(points->data()), bytes) != bytes) {
+            qWarning() << "buildCloud: cannot read back" << bucket.file->fileName();
+            return false;
+        }
+        bucket.file->remove();
+        bucket.file.reset();
+    }
+    std::copy(bucket.pending.cbegin(), bucket.pending.cend(), points->begin() + spilled);
+    bucket.pending = QVector<Point>();
+    return true;
+}
+
+qint64 bucketPoints(const Bucket &bucket)
+{
+    return (bucket.file ? bucket.file->size() / qint64(sizeof(Point)) : 0) + bucket.pending.size();
+}
+
+bool flushBucket(Bucket &bucket, const QTemporaryDir &spill)
+{
+    if (!bucket.file) {
+        bucket.file.reset(new QFile(spill.filePath(bucket.name + ".points")));
+        if (!bucket.file->open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+            qWarning() << "buildCloud: cannot write" << bucket.file->fileName();
+            return false;
+        }
+    }
+    const qint64 bytes = qint64(bucket.pending.size()) * qint64(sizeof(Point));
+    if (!bucket.file->seek(bucket.file->size())
+        || bucket.file->write(reinterpret_cast<const char *>(bucket.pending.constData()), bytes) != bytes) {
+        qWarning() << "buildCloud: cannot write" << bucket.file->fileName();
+        return false;
+    }
+    bucket.pending.clear();
+    return true;
+}
+
+/**
+ * @brief Builds the subtree of @p bucket, a cell at @p level, and returns its top node in @p root.
+ *
+ * A bucket of at most memoryPoints points is read back and built in memory.
+ * A larger one (its points crowd into few cells, as flat aerial scans do, or
+ * the bucket level was capped) is streamed from its file instead: its node
+ * keeps one point per grid cell and the rest are spilled into one bucket per
+ * octant, each built the same way. Memory stays bounded by memoryPoints
+ * whatever the input size and distribution.
+ */
+bool buildBucket(OctreeBuilder &builder, const CloudBuildParams &params, Bucket &bucket, int level,
+                 const QTemporaryDir &spill, int *root, int *respilled)
+{
+    if (bucketPoints(bucket) <= params.memoryPoints || level >= MaxLevel) {
+        QVector<Point> points;
+        if (!readBucket(bucket, &points)) {
+            return false;
+        }
+        *root = builder.buildSubtree(level, bucket.cell, points);
+        return true;
+    }
+
+    ++*respilled;
+    const int node = builder.addNode(level, bucket.cell, -1, 0);
+    std::vector<quint64> occupied(builder.gridWords(), 0);
+    QVector<Point> kept;
+    Bucket children[8];
+    for (int octant = 0; octant < 8; ++octant) {
+        for (int i = 0; i < 3; ++i) {
+            children[octant].cell[i] = bucket.cell[i] * 2 + ((octant >> i) & 1);
+        }
+        children[octant].name = bucket.name + '-' + QString::number(octant);
+    }
+    const auto distribute = [&](const Point *points, qint64 count) {
+        quint32 childCell[3];
+        for (qint64 p = 0; p < count; ++p) {
+            const Point &point = points[p];
+            const quint32 g = builder.gridIndex(point, level, bucket.cell);
+            quint64 &word = occupied[g / 64];
+            const quint64 bit = quint64(1) << (g % 64);
+            if (!(word & bit)) {
+                word |= bit;
+                kept.append(point);
+                continue;
+            }
+            builder.cellOf(point, level + 1, childCell);
+            int octant = 0;
+            for (int i = 0; i < 3; ++i) {
+                childCell[i] = qBound(bucket.cell[i] * 2, childCell[i], bucket.cell[i] * 2 + 1);
+                octant |= int(childCell[i] & 1) << i;
+            }
+            Bucket &child = children[octant];
+            child.pending.append(point);
+            if (child.pending.size() >= BucketFlushPoints && !flushBucket(child, spill)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if (!distribute(bucket.pending.constData(), bucket.pending.size())) {
+        return false;
+    }
+    bucket.pending = QVector<Point>();
+    if (bucket.file) {
+        QVector<Point> batch(ReadBatch);
+        if (!bucket.file->seek(0)) {
+            qWarning() << "buildCloud: cannot read back" << bucket.file->fileName();
+            return false;
+        }
+        for (;;) {
+            const qint64 bytes = bucket.file->read(reinterpret_cast<char *>(batch.data()),
+                                                   ReadBatch * qint64(sizeof(Point)));
+            if (bytes < 0) {
+                qWarning() << "buildCloud: cannot read back" << bucket.file->fileName();
+                return false;
+            }
+            if (bytes == 0) {
+                break;
+            }
+            if (!distribute(batch.constData(), bytes / qint64(sizeof(Point)))) {
+                return false;
+            }
+        }
+        bucket.file->remove();
+        bucket.file.reset();
+    }
+    builder.writeChunk(node, kept);
+    kept = QVector<Point>();
+    occupied = std::vector<quint64>();
+
+    for (int octant = 0; octant < 8; ++octant) {
+        Bucket &child = children[octant];
+        // Points of a spilled child go to its file, so siblings do not hold them while it is built
+        if (child.file && !child.pending.isEmpty() && !flushBucket(child, spill)) {
+            return false;
+        }
+    }
+    for (int octant = 0; octant < 8; ++octant) {
+        if (bucketPoints(children[octant]) == 0) {
+            continue;
+        }
+        int child = -1;
+        if (!buildBucket(builder, params, children[octant], level + 1, spill, &child, respilled)) {
+            return false;
+        }
+        builder.nodes[node].children[octant] = child;
+    }
+    *root = node;
+    return true;
+}
+
+} // namespace
+
+// ------------------- Build -------------------
+
+bool buildCloud(const QString &inputPath, const QString &outputPath, const CloudBuildParams &settings,
+                CloudBuildStats *stats)
+{
+    CloudBuildParams params = settings;
+    params.nodePoints = qMax(1, params.nodePoints);
+    params.gridSize = qBound(8, params.gridSize, 256);   // Upper nodes keep a gridSize^3 bit grid each
+    params.memoryPoints = qMax<qint64>(params.nodePoints, params.memoryPoints);
+    CloudBuildStats result;
+    QElapsedTimer timer;
+
+    PointReader reader;
+    if (!reader.open(inputPath)) {
+        return false;
+    }
+    result.inputBytes = reader.fileBytes();
+    result.hasColor = reader.hasColor();
+
+    // Pass 1: count and bounds
+    timer.start();
+    QVector<Point> batch(ReadBatch);
+    CloudHeader header;
+    float low[3] = { INFINITY, INFINITY, INFINITY };
+    float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (;;) {
+        const qint64 count = reader.read(batch.data(), ReadBatch);
+        if (count < 0) {
+            return false;
+        }
+        if (count == 0) {
+            break;
+        }
+        for (qint64 p = 0; p < count; ++p) {
+            for (int i = 0; i < 3; ++i) {
+                low[i] = qMin(low[i], batch[p].position[i]);
+                high[i] = qMax(high[i], batch[p].position[i]);
+            }
+        }
+        result.points += count;
+    }
+    result.scanMilliseconds = timer.nsecsElapsed() / 1.0e6;
+    if (result.points == 0) {
+        qWarning() << "buildCloud: no points in" << inputPath;
+        return false;
+    }
+
+    // The root is the bounding cube, a little larger so the maximum falls inside its last cell
+    float extent = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = low[i];
+        header.pointMin[i] = low[i];
+        header.pointMax[i] = high[i];
+        extent = qMax(extent, high[i] - low[i]);
+    }
+    header.size = extent > 0.0f ? extent * 1.0001f : 1.0f;
+    header.pointCount = quint64(result.points);
+    header.gridSize = quint32(params.gridSize);
+    // As if the points filled the cube evenly; buckets that end up larger are split again in pass 3
+    while (result.bucketLevel < MaxBucketLevel
+           && result.points > params.memoryPoints * (qint64(1) << (3 * result.bucketLevel))) {
+        ++result.bucketLevel;
+    }
+    const int bucketLevel = result.bucketLevel;
+
+    QFile output(outputPath);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "buildCloud: cannot write" << outputPath;
+        return false;
+    }
+    QTemporaryDir spill(QFileInfo(outputPath).absolutePath() + "/pointcloud-XXXXXX");
+    if (bucketLevel > 0 && !spill.isValid()) {
+        qWarning() << "buildCloud: cannot create a temporary directory next to" << outputPath;
+        return false;
+    }
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));   // Rewritten at the end
+
+    // Pass 2: the levels above bucketLevel, sampled while streaming; the rest into the buckets
+    timer.restart();
+    OctreeBuilder builder(params, header, &output);
+    QHash<quint64, int> upperNodes;           // (level, Morton code of the cell) -> node
+    QHash<quint64, int> bucketIndex;
+    std::vector<Bucket> buckets;
+    if (!reader.rewind()) {
+        return false;
+    }
+    for (;;) {
+        const qint64 count = reader.read(batch.data(), ReadBatch);
+        if (count < 0) {
+            return false;
+        }
+        if (count == 0) {
+            break;
+        }
+        for (qint64 p = 0; p < count; ++p) {
+            Point &point = batch[p];
+            if (!result.hasColor) {
+                colorByHeight(&point, low[2], high[2]);
+            }
+            point.color[3] = 255;
+
+            int parent = -1;
+            int octant = 0;
+            bool taken = false;
+            quint32 cell[3];
+            for (int level = 0; level < bucketLevel && !taken; ++level) {
+                builder.cellOf(point, level, cell);
+                const quint64 key = (quint64(level) << 60) | mortonCode(cell);
+                int node = upperNodes.value(key, -1);
+                if (node < 0) {
+                    node = builder.addNode(level, cell, parent, octant);
+                    builder.nodes[node].occupied.assign(builder.gridWords(), 0);
+                    upperNodes.insert(key, node);
+                }
+                BuildNode &upper = builder.nodes[node];
+                const quint32 g = builder.gridIndex(point, level, cell);
+                quint64 &word = upper.occupied[g / 64];
+                const quint64 bit = quint64(1) << (g % 64);
+                if (!(word & bit)) {
+                    word |= bit;
+                    upper.points.append(point);
+                    taken = true;
+                }
+                parent = node;
+                quint32 childCell[3];
+                builder.cellOf(point, level + 1, childCell);
+                octant = 0;
+                for (int i = 0; i < 3; ++i) {
+                    octant |= int(childCell[i] & 1) << i;
+                }
+            }
+            if (taken) {
+                continue;
+            }
+
+            builder.cellOf(point, bucketLevel, cell);
+            const quint64 key = mortonCode(cell);
+            auto found = bucketIndex.constFind(key);
+            if (found == bucketIndex.constEnd()) {
+                Bucket bucket;
+                std::copy(cell, cell + 3, bucket.cell);
+                bucket.parent = parent;
+                bucket.octant = octant;
+                bucket.order = key;
+                bucket.name = QString::number(key);
+                found = bucketIndex.insert(key, int(buckets.size()));
+                buckets.push_back(std::move(bucket));
+            }
+            Bucket &bucket = buckets[size_t(found.value())];
+            bucket.pending.append(point);
+            // Without upper levels the one bucket is the whole cloud, which fits in memory
+            if (bucketLevel > 0 && bucket.pending.size() >= BucketFlushPoints && !flushBucket(bucket, spill)) {
+                return false;
+            }
+        }
+    }
+    batch = QVector<Point>();
+
+    // The upper levels are final now: written first, coarse to fine
+    for (int level = 0; level < bucketLevel; ++level) {
+        for (int node = 0; node < builder.nodes.size(); ++node) {
+            BuildNode &upper = builder.nodes[node];
+            if (upper.level == level) {
+                builder.writeChunk(node, upper.points);
+                upper.points = QVector<Point>();
+                upper.occupied = std::vector<quint64>();
+            }
+        }
+    }
+    result.distributeMilliseconds = timer.nsecsElapsed() / 1.0e6;
+
+    // Pass 3: one subtree per bucket
+    timer.restart();
+    std::sort(buckets.begin(), buckets.end(), [](const Bucket &a, const Bucket &b) { return a.order < b.order; });
+    for (Bucket &bucket : buckets) {
+        int root = -1;
+        if (!buildBucket(builder, params, bucket, bucketLevel, spill, &root, &result.respilledBuckets)) {
+            return false;
+        }
+        if (bucket.parent >= 0) {
+            builder.nodes[bucket.parent].children[bucket.octant] = root;
+        }
+    }
+    result.buckets = int(buckets.size());
+
+    if (!builder.writeTable(&header.nodeTableOffset, &header.maxNodePoints, &header.depth) || !builder.ok) {
+        qWarning() << "buildCloud: cannot write" << outputPath;
+        return false;
+    }
+    header.nodeCount = quint32(builder.nodes.size());
+    header.fileSize = quint64(output.pos());
+    if (!output.seek(0) || output.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)) {
+        qWarning() << "buildCloud: cannot write" << outputPath;
+        return false;
+    }
+    output.close();
+    result.buildMilliseconds = timer.nsecsElapsed() / 1.0e6;
+
+    result.nodes = int(header.nodeCount);
+    result.depth = int(header.depth);
+    result.outputBytes = qint64(header.fileSize);
+    if (stats) {
+        *stats = result;
+    }
+    return true;
+}
+
+// ------------------- Generated Scan -------------------
+
+namespace {
+
+const float SceneSize = 1000.0f;
+
+float terrainHeight(float x, float y)
+{
+    return 12.0f * std::sin(x * 0.006f) * std::cos(y * 0.008f) + 4.0f * std::sin(x * 0.021f + y * 0.017f)
+           + 1.5f * std::sin(x * 0.11f) * std::sin(y * 0.09f);
+}
+
+struct Building {
+    float center[2];
+    float half[2];
+    float base;
+    float height;
+    quint8 roof[3];
+};
+
+struct Tree {
+    float center[3];                            // Of the crown
+    float radius;
+};
+
+} // namespace
+
+bool writeGeneratedCloud(const QString &filePath, qint64 points)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "writeGeneratedCloud: cannot write" << filePath;
+        return false;
+    }
+    const bool text = filePath.endsWith(".xyz", Qt::CaseInsensitive);
+
+    // The scene is fixed; only its sampling density follows the point count
+    QRandomGenerator layout(11);
+    QVector<Building> buildings(300);
+    for (Building &b : buildings) {
+        b.center[0] = 50.0f + float(layout.generateDouble()) * (SceneSize - 100.0f);
+        b.center[1] = 50.0f + float(layout.generateDouble()) * (SceneSize - 100.0f);
+        b.half[0] = 5.0f + float(layout.generateDouble()) * 15.0f;
+        b.half[1] = 5.0f + float(layout.generateDouble()) * 15.0f;
+        b.base = terrainHeight(b.center[0], b.center[1]) - 1.0f;
+        b.height = 8.0f + float(layout.generateDouble() * layout.generateDouble()) * 60.0f;
+        const bool red = layout.bounded(3) == 0;
+        b.roof[0] = red ? 160 : 110;
+        b.roof[1] = red ? 70 : 110;
+        b.roof[2] = red ? 55 : 115;
+    }
+    QVector<Tree> trees(2000);
+    for (Tree &t : trees) {
+        t.center[0] = float(layout.generateDouble()) * SceneSize;
+        t.center[1] = float(layout.generateDouble()) * SceneSize;
+        t.radius = 2.5f + float(layout.generateDouble()) * 4.0f;
+        t.center[2] = terrainHeight(t.center[0], t.center[1]) + 4.0f + t.radius;
+    }
+
+    QByteArray buffer;
+    buffer.reserve(1 << 22);
+    if (!text) {
+        buffer.append("ply\nformat binary_little_endian 1.0\ncomment synthetic aerial scan, z up\nelement vertex ");
+        buffer.append(QByteArray::number(points));
+        buffer.append("\nproperty float x\nproperty float y\nproperty float z\n"
+                      "property uchar red\nproperty uchar green\nproperty uchar blue\nend_header\n");
+    }
+    const auto number = [&](float value) {
+        char digits[32];
+        const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value,
+                                                          std::chars_format::fixed, 3);
+        buffer.append(digits, result.ptr - digits);
+    };
+    const auto integer = [&](int value) {
+        char digits[16];
+        const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr - digits);
+    };
+
+    QRandomGenerator random(5);
+    const auto uniform = [&random]() { return float(random.generateDouble()); };
+    for (qint64 i = 0; i < points; ++i) {
+        float p[3];
+        int c[3];
+        const float kind = uniform();
+        const float shade = 0.85f + 0.15f * uniform();
+        if (kind < 0.7f) {
+            p[0] = uniform() * SceneSize;
+            p[1] = uniform() * SceneSize;
+            p[2] = terrainHeight(p[0], p[1]) + 0.05f * uniform();
+            const float dry = 0.5f + 0.5f * std::sin(p[0] * 0.013f) * std::sin(p[1] * 0.011f);
+            c[0] = int((70 + 70 * dry) * shade);
+            c[1] = int((125 + 20 * dry) * shade);
+            c[2] = int((55 + 15 * dry) * shade);
+        } else if (kind < 0.9f) {
+            const Building &b = buildings[int(random.bounded(buildings.size()))];
+            const float roofArea = 4.0f * b.half[0] * b.half[1];
+            const float wallArea = 4.0f * (b.half[0] + b.half[1]) * b.height;
+            const float u = uniform() * 2.0f - 1.0f;
+            if (uniform() * (roofArea + wallArea) < roofArea) {
+                p[0] = b.center[0] + u * b.half[0];
+                p[1] = b.center[1] + (uniform() * 2.0f - 1.0f) * b.half[1];
+                p[2] = b.base + b.height;
+                std::copy(b.roof, b.roof + 3, c);
+            } else {
+                // One of the four walls, chosen by length
+                const bool alongX = uniform() * (b.half[0] + b.half[1]) < b.half[0];
+                const float side = uniform() < 0.5f ? -1.0f : 1.0f;
+                p[0] = b.center[0] + (alongX ? u * b.half[0] : side * b.half[0]);
+                p[1] = b.center[1] + (alongX ? side * b.half[1] : u * b.half[1]);
+                p[2] = b.base + uniform() * b.height;
+                c[0] = 205;
+                c[1] = 198;
+                c[2] = 185;
+            }
+            for (int k = 0; k < 3; ++k) {
+                c[k] = int(c[k] * shade);
+            }
+        } else {
+            const Tree &t = trees[int(random.bounded(trees.size()))];
+            float d[3];
+            float length = 0.0f;
+            do {
+                for (float &v : d) {
+                    v = uniform() * 2.0f - 1.0f;
+                }
+                length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            } while (length > 1.0f || length < 0.05f);
+            const float r = t.radius * (0.8f + 0.2f * uniform()) / length;
+            for (int k = 0; k < 3; ++k) {
+                p[k] = t.center[k] + d[k] * r;
+            }
+            c[0] = int(45 * shade);
+            c[1] = int((95 + 45 * uniform()) * shade);
+            c[2] = int(40 * shade);
+        }
+
+        if (text) {
+            for (int k = 0; k < 3; ++k) {
+                number(p[k]);
+                buffer.append(' ');
+            }
+            for (int k = 0; k < 3; ++k) {
+                integer(c[k]);
+                buffer.append(k < 2 ? ' ' : '\n');
+            }
+        } else {
+            buffer.append(reinterpret_cast<const char *>(p), sizeof(p));
+            for (int k = 0; k < 3; ++k) {
+                buffer.append(char(quint8(c[k])));
+            }
+        }
+        if (buffer.size() >= (1 << 22) - 64) {
+            if (file.write(buffer) != buffer.size()) {
+                qWarning() << "writeGeneratedCloud: cannot write" << filePath;
+                return false;
+            }
+            buffer.clear();
+        }
+    }
+    if (file.write(buffer) != buffer.size()) {
+        qWarning() << "writeGeneratedCloud: cannot write" << filePath;
+        return false;
+    }
+    return true;
+}
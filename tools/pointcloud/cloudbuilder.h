@@ -0,0 +1,66 @@
+#ifndef CLOUDBUILDER_H
+#define CLOUDBUILDER_H
+
+#include <QString>
+#include "pointcloudformat.h"
+
+/**
+ * @brief Settings of buildCloud().
+ */
+struct CloudBuildParams {
+    int nodePoints = 20000;                 // A node with more points than this is split
+    int gridSize = 128;                     // Sampling grid cells per node side
+    qint64 memoryPoints = 16 * 1024 * 1024; // Points sorted in memory at once
+};
+
+/**
+ * @brief What buildCloud() did and how long it took.
+ */
+struct CloudBuildStats {
+    qint64 inputBytes = 0;
+    qint64 points = 0;
+    bool hasColor = false;                  // Otherwise the points are colored by height
+    int nodes = 0;
+    int depth = 0;
+    int bucketLevel = 0;                    // Level of the subtrees built one at a time in memory
+    int buckets = 0;
+    int respilledBuckets = 0;               // Buckets, or their octants, split again while streaming
+    qint64 outputBytes = 0;
+    double scanMilliseconds = 0.0;          // Pass 1: count and bounds
+    double distributeMilliseconds = 0.0;    // Pass 2: upper levels, and the rest into bucket files
+    double buildMilliseconds = 0.0;         // Pass 3: subtrees of the buckets, and writing
+};
+
+/**
+ * @brief Builds the octree file of common/pointcloudformat.h out of a PLY or XYZ point file.
+ *
+ * PLY may be ASCII or binary little endian; the vertex element needs x, y
+ * and z (float or double) and may have red, green and blue (uchar). XYZ is
+ * text, one point per line: x y z, optionally followed by r g b in 0..255.
+ *
+ * The input is read three times and never held in memory as a whole:
+ * 1. Count and bounds.
+ * 2. Every point walks down the levels above bucketLevel and is kept by the
+ *    first node whose sampling grid cell it finds empty. Points no upper node
+ *    takes are appended to one temporary file per bucketLevel cell. The
+ *    level is chosen so that a bucket holds about memoryPoints points.
+ * 3. Each bucket is read back and its subtree built top down the same way:
+ *    a node keeps one point per grid cell, the rest go to its children,
+ *    until a node has at most nodePoints points. A bucket with more than
+ *    memoryPoints points (the level assumes the points fill the cube evenly,
+ *    and is capped at 3) is not read back whole: its node samples while
+ *    streaming the file and the rest is spilled again, one file per octant.
+ *
+ * Chunks are written as soon as they are final, coarse levels first; the node
+ * table follows, breadth first, so every node's children are adjacent.
+ */
+bool buildCloud(const QString &inputPath, const QString &outputPath, const CloudBuildParams &params,
+                CloudBuildStats *stats = nullptr);
+
+/**
+ * @brief Writes @p points of a synthetic aerial scan (terrain, buildings, trees) as binary PLY or, for a
+ * ".xyz" path, as text. Z is up; the points are generated in batches, so any count fits in memory.
+ */
+bool writeGeneratedCloud(const QString &filePath, qint64 points);
+
+#endif // CLOUDBUILDER_H
@@ -0,0 +1,295 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QSurfaceFormat>
+#include <QtMath>
+#include <cmath>
+#include <memory>
+#include "cloudbuilder.h"
+#include "pointcloud.h"
+
+// Builds out-of-core point cloud octrees (common/pointcloudformat.h) and flies a camera through them:
+//   pointcloud generate 50000000 scan.ply
+//   pointcloud build scan.ply scan.qpc [--node-points n] [--grid n] [--memory-points n]
+//   pointcloud fly scan.qpc [--frames n] [--budget n] [--pool MiB]
+// fly renders offscreen as fast as it can along a loop over the cloud (z up), swooping between low and high
+// altitude, and reports per interval the frame time, the points drawn and the bytes streamed per second.
+// The chunks come from the OS page cache after the first run; a cold run needs a cloud larger than RAM or
+// a dropped cache. On a host without a GPU the driver is Mesa llvmpipe; elsewhere LIBGL_ALWAYS_SOFTWARE=1
+// selects it.
+
+static double megabytes(qint64 bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+static int build(const QString &input, const QString &output, const CloudBuildParams &params)
+{
+    CloudBuildStats stats;
+    if (!buildCloud(input, output, params, &stats)) {
+        return 1;
+    }
+    qInfo().noquote() << QString("pointcloud: %1 points%2 -> %3 nodes, %4 levels, %5 buckets at level %6, "
+                                 "%7 split again")
+                             .arg(stats.points)
+                             .arg(stats.hasColor ? "" : " (colored by height)")
+                             .arg(stats.nodes)
+                             .arg(stats.depth + 1)
+                             .arg(stats.buckets)
+                             .arg(stats.bucketLevel)
+                             .arg(stats.respilledBuckets);
+    qInfo().noquote() << QString("pointcloud: %1 MiB -> %2 MiB %3; scan %4 s, distribute %5 s, build %6 s")
+                             .arg(megabytes(stats.inputBytes), 0, 'f', 1)
+                             .arg(megabytes(stats.outputBytes), 0, 'f', 1)
+                             .arg(output)
+                             .arg(stats.scanMilliseconds / 1000.0, 0, 'f', 2)
+                             .arg(stats.distributeMilliseconds / 1000.0, 0, 'f', 2)
+                             .arg(stats.buildMilliseconds / 1000.0, 0, 'f', 2);
+    return 0;
+}
+
+/**
+ * @brief Where the camera is at @p t (0..1 around the loop) over the cloud of @p header, z up.
+ */
+static void flightPath(const pointcloud::CloudHeader &header, double t, QVector3D *eye, QVector3D *target)
+{
+    const QVector3D low(header.pointMin[0], header.pointMin[1], header.pointMin[2]);
+    const QVector3D high(header.pointMax[0], header.pointMax[1], header.pointMax[2]);
+    const QVector3D center = (low + high) * 0.5f;
+    const QVector3D extent = high - low;
+    const float horizontal = qMax(extent.x(), extent.y());
+    const auto onLoop = [&](double at) {
+        const float angle = float(2.0 * M_PI * at);
+        // Low over the roofs, then up for an overview, three times per loop
+        const float altitude = 0.02f + 0.12f * (0.5f + 0.5f * std::sin(3.0f * angle));
+        return QVector3D(center.x() + 0.38f * extent.x() * std::cos(angle),
+                         center.y() + 0.38f * extent.y() * std::sin(angle), high.z() + altitude * horizontal);
+    };
+    *eye = onLoop(t);
+    *target = onLoop(t + 0.04);
+    target->setZ(center.z());
+}
+
+static int fly(const QString &cloudPath, const PointCloudRenderer::Params &params, int frames, int reportEvery,
+               const QSize &size, const QString &snapshotPath)
+{
+    QOpenGLContext context;
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    context.setFormat(format);
+    if (!context.create()) {
+        qWarning() << "pointcloud: cannot create an OpenGL 3.3 core context";
+        return 1;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        qWarning() << "pointcloud: cannot make the context current";
+        return 1;
+    }
+    QOpenGLFunctions_3_3_Core gl;
+    gl.initializeOpenGLFunctions();
+
+    std::unique_ptr<QOpenGLFramebufferObject> target(
+        new QOpenGLFramebufferObject(size, QOpenGLFramebufferObject::Depth));
+    PointCloudRenderer renderer;
+    if (!renderer.initialize(cloudPath, params)) {
+        return 1;
+    }
+    const pointcloud::CloudHeader &header = renderer.cloud().header();
+    const QVector3D extent(header.pointMax[0] - header.pointMin[0], header.pointMax[1] - header.pointMin[1],
+                           header.pointMax[2] - header.pointMin[2]);
+    const float reach = qMax(extent.length(), 1.0e-3f);
+    QMatrix4x4 projection;
+    projection.perspective(60.0f, float(size.width()) / float(size.height()), reach * 5.0e-4f, reach * 2.0f);
+
+    qInfo().noquote() << QString("%1: %2 points in %3 nodes; budget %4 points, %5 MiB pool, %6x%7, %8 frames")
+                             .arg(QFileInfo(cloudPath).fileName())
+                             .arg(header.pointCount)
+                             .arg(header.nodeCount)
+                             .arg(params.pointBudget)
+                             .arg(megabytes(params.poolBytes), 0, 'f', 0)
+                             .arg(size.width())
+                             .arg(size.height())
+                             .arg(frames);
+    qInfo().noquote() << "  Renderer:" << reinterpret_cast<const char *>(gl.glGetString(GL_RENDERER));
+    qInfo().noquote() << "  frames | ms/frame | max ms | select ms | points drawn | nodes | MiB/s streamed | "
+                         "resident MiB | pending";
+
+    target->bind();
+    gl.glViewport(0, 0, size.width(), size.height());
+    gl.glEnable(GL_DEPTH_TEST);
+    gl.glClearColor(0.55f, 0.68f, 0.85f, 1.0f);
+
+    QElapsedTimer wall;
+    wall.start();
+    QElapsedTimer interval;
+    interval.start();
+    double intervalMilliseconds = 0.0;
+    double intervalMax = 0.0;
+    double intervalSelect = 0.0;
+    qint64 intervalPoints = 0;
+    qint64 intervalNodes = 0;
+    qint64 intervalStart = 0;
+    double totalMilliseconds = 0.0;
+    qint64 totalPoints = 0;
+    for (int frame = 1; frame <= frames; ++frame) {
+        QVector3D eye;
+        QVector3D lookAt;
+        flightPath(header, double(frame - 1) / frames, &eye, &lookAt);
+        QMatrix4x4 view;
+        view.lookAt(eye, lookAt, QVector3D(0.0f, 0.0f, 1.0f));
+
+        QElapsedTimer timer;
+        timer.start();
+        renderer.update(view, projection, size);
+        gl.glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderer.render(view, projection);
+        gl.glFinish();
+        const double milliseconds = timer.nsecsElapsed() / 1.0e6;
+
+        const PointCloudRenderer::Stats stats = renderer.stats();
+        intervalMilliseconds += milliseconds;
+        intervalMax = qMax(intervalMax, milliseconds);
+        intervalSelect += stats.selectMilliseconds;
+        intervalPoints += stats.renderedPoints;
+        intervalNodes += stats.renderedNodes;
+        totalMilliseconds += milliseconds;
+        totalPoints += stats.renderedPoints;
+
+        if (frame % reportEvery == 0 || frame == frames) {
+            const int count = (frame - 1) % reportEvery + 1;
+            const double seconds = qMax(interval.nsecsElapsed() / 1.0e9, 1.0e-9);
+            qInfo().noquote() << QString("  %1 | %2 | %3 | %4 | %5 | %6 | %7 | %8 | %9")
+                                     .arg(frame, 6)
+                                     .arg(intervalMilliseconds / count, 8, 'f', 2)
+                                     .arg(intervalMax, 6, 'f', 2)
+                                     .arg(intervalSelect / count, 9, 'f', 3)
+                                     .arg(intervalPoints / count, 12)
+                                     .arg(intervalNodes / count, 5)
+                                     .arg(megabytes(stats.bytesStreamed - intervalStart) / seconds, 14, 'f', 1)
+                                     .arg(megabytes(stats.residentBytes), 12, 'f', 1)
+                                     .arg(stats.pendingLoads, 7);
+            intervalMilliseconds = 0.0;
+            intervalMax = 0.0;
+            intervalSelect = 0.0;
+            intervalPoints = 0;
+            intervalNodes = 0;
+            intervalStart = stats.bytesStreamed;
+            interval.restart();
+        }
+    }
+
+    const PointCloudRenderer::Stats stats = renderer.stats();
+    const double seconds = wall.nsecsElapsed() / 1.0e9;
+    qInfo().noquote() << QString("  %1 frames in %2 s: %3 ms/frame, %4 points/frame, %5 MiB streamed (%6 MiB/s)")
+                             .arg(frames)
+                             .arg(seconds, 0, 'f', 2)
+                             .arg(totalMilliseconds / frames, 0, 'f', 2)
+                             .arg(totalPoints / frames)
+                             .arg(megabytes(stats.bytesStreamed), 0, 'f', 1)
+                             .arg(megabytes(stats.bytesStreamed) / seconds, 0, 'f', 1);
+    qInfo().noquote() << " " << renderer.report();
+
+    bool ok = true;
+    if (!snapshotPath.isEmpty()) {
+        // Last frame, with everything it asked for loaded
+        renderer.waitForLoads();
+        gl.glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        QVector3D eye;
+        QVector3D lookAt;
+        flightPath(header, double(frames - 1) / frames, &eye, &lookAt);
+        QMatrix4x4 view;
+        view.lookAt(eye, lookAt, QVector3D(0.0f, 0.0f, 1.0f));
+        renderer.render(view, projection);
+        ok = target->toImage().save(snapshotPath);
+        if (!ok) {
+            qWarning() << "pointcloud: cannot write" << snapshotPath;
+        }
+    }
+    target->release();
+    renderer.release();
+    target.reset();
+    context.doneCurrent();
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Builds point cloud octrees and streams them during a camera fly-through.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "generate <points> <output.ply|.xyz> | build <input.ply|.xyz> "
+                                            "<output.qpc> | fly <cloud.qpc>");
+    const CloudBuildParams buildDefaults;
+    QCommandLineOption nodePointsOption("node-points", "build: split nodes with more points.", "n",
+                                        QString::number(buildDefaults.nodePoints));
+    QCommandLineOption gridOption("grid", "build: sampling grid cells per node side (8-256).", "n",
+                                  QString::number(buildDefaults.gridSize));
+    QCommandLineOption memoryOption("memory-points", "build: points sorted in memory at once.", "n",
+                                    QString::number(buildDefaults.memoryPoints));
+    const PointCloudRenderer::Params flyDefaults;
+    QCommandLineOption framesOption("frames", "fly: frames along the loop.", "n", "600");
+    QCommandLineOption reportOption("report-every", "fly: frames per table row.", "n", "60");
+    QCommandLineOption sizeOption("size", "fly: frame size.", "WxH", "1280x720");
+    QCommandLineOption budgetOption("budget", "fly: points drawn per frame, at most.", "n",
+                                    QString::number(flyDefaults.pointBudget));
+    QCommandLineOption poolOption("pool", "fly: vertex buffer pool.", "MiB",
+                                  QString::number(flyDefaults.poolBytes / (1024 * 1024)));
+    QCommandLineOption uploadOption("upload", "fly: upload budget per frame.", "MiB",
+                                    QString::number(flyDefaults.uploadBytesPerFrame / (1024 * 1024)));
+    QCommandLineOption spacingOption("spacing", "fly: refine while a node's point spacing covers more pixels.", "px",
+                                     QString::number(flyDefaults.pixelSpacing));
+    QCommandLineOption pointSizeOption("point-size", "fly: point size in pixels.", "px",
+                                       QString::number(flyDefaults.pointSize));
+    QCommandLineOption loadersOption("loaders", "fly: chunk loader threads.", "n",
+                                     QString::number(flyDefaults.loaderThreads));
+    QCommandLineOption snapshotOption("snapshot", "fly: save the last frame, fully loaded, as an image.", "file");
+    parser.addOptions({ nodePointsOption, gridOption, memoryOption, framesOption, reportOption, sizeOption,
+                        budgetOption, poolOption, uploadOption, spacingOption, pointSizeOption, loadersOption,
+                        snapshotOption });
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    const QString command = args.value(0);
+    if (command == "generate" && args.size() == 3) {
+        const qint64 points = args[1].toLongLong();
+        if (points <= 0) {
+            qWarning() << "pointcloud: invalid point count" << args[1];
+            return 1;
+        }
+        return writeGeneratedCloud(args[2], points) ? 0 : 1;
+    }
+    if (command == "build" && args.size() == 3) {
+        CloudBuildParams params;
+        params.nodePoints = parser.value(nodePointsOption).toInt();
+        params.gridSize = parser.value(gridOption).toInt();
+        params.memoryPoints = parser.value(memoryOption).toLongLong();
+        return build(args[1], args[2], params);
+    }
+    if (command == "fly" && args.size() == 2) {
+        PointCloudRenderer::Params params;
+        params.pointBudget = qMax(1ll, parser.value(budgetOption).toLongLong());
+        params.poolBytes = qMax(1ll, parser.value(poolOption).toLongLong()) * 1024 * 1024;
+        params.uploadBytesPerFrame = qMax(1ll, parser.value(uploadOption).toLongLong()) * 1024 * 1024;
+        params.pixelSpacing = qMax(0.1f, parser.value(spacingOption).toFloat());
+        params.pointSize = qMax(1.0f, parser.value(pointSizeOption).toFloat());
+        params.loaderThreads = qMax(1, parser.value(loadersOption).toInt());
+        const QStringList sizeText = parser.value(sizeOption).split('x');
+        const QSize size(qMax(1, sizeText.value(0).toInt()), qMax(1, sizeText.value(1).toInt()));
+        return fly(args[1], params, qMax(1, parser.value(framesOption).toInt()),
+                   qMax(1, parser.value(reportOption).toInt()), size, parser.value(snapshotOption));
+    }
+    parser.showHelp(1);
+}
@@ -0,0 +1,508 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QSurfaceFormat>
+#include <QVector>
+#include <memory>
+#include "dicefaces.h"
+#include "meshgen.h"
+#include "perftrace.h"
+#include "softrasterizer.h"
+
+// Renders the scenes of stages 04-06 (colored cube drawn with glDrawArrays, colored cube drawn with
+// glDrawElements, textured dice) with SoftRasterizer at several thread counts and with the current OpenGL
+// driver, at increasing tessellations, and reports ms per frame. Both produce an image in memory: the GL
+// time includes glReadPixels(). On a host without a GPU the driver is Mesa llvmpipe; elsewhere
+// LIBGL_ALWAYS_SOFTWARE=1 selects it. Without any OpenGL the software rows are still reported.
+
+static const char *vertexShaderSource = R"(
+#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 texCoord;
+uniform mat4 mvp;
+out vec3 vertexColor;
+out vec2 vertexTexCoord;
+void main()
+{
+    gl_Position = mvp * vec4(position, 1.0);
+    vertexColor = color;
+    vertexTexCoord = texCoord;
+}
+)";
+
+static const char *fragmentShaderSource = R"(
+#version 330 core
+in vec3 vertexColor;
+in vec2 vertexTexCoord;
+uniform sampler2D tex;
+uniform bool textured;
+out vec4 fragColor;
+void main()
+{
+    vec4 color = vec4(vertexColor, 1.0);
+    if (textured) {
+        color *= texture(tex, vertexTexCoord);
+    }
+    fragColor = color;
+}
+)";
+
+/**
+ * @brief One stage scene at one tessellation: the mesh, its camera and its draws (one per face for 06).
+ */
+struct Scene {
+    QString stage;
+    int subdivisions = 1;
+    std::vector<float> vertices;
+    std::vector<quint32> indices;           // Empty: drawn like glDrawArrays()
+    int stride = 6;
+    int colorOffset = 3;
+    int uvOffset = -1;
+    int draws = 1;                          // Equal slices of the indices / vertices
+    QColor clearColor;
+
+    int vertexCount() const { return int(vertices.size()) / stride; }
+    int elementCount() const { return indices.empty() ? vertexCount() : int(indices.size()); }
+    int triangles() const { return elementCount() / 3; }
+
+    // The stages' cameras, with the rotation they reach after @p frame frames at one degree per frame
+    QMatrix4x4 mvp(const QSize &size, int frame) const
+    {
+        QMatrix4x4 projection;
+        projection.perspective(45.0f, float(size.width()) / float(size.height()), 0.1f, 100.0f);
+        QMatrix4x4 view;
+        QMatrix4x4 model;
+        const float angle = 30.0f + float(frame);
+        if (stage == "06") {
+            view.lookAt(QVector3D(0.0f, 0.0f, 3.0f), QVector3D(0.0f, 0.0f, 0.0f), QVector3D(0.0f, 1.0f, 0.0f));
+            model.rotate(angle, 0.0f, 1.0f, 0.0f);
+            model.rotate(angle / 2.0f, 1.0f, 0.0f, 0.0f);
+        } else {
+            view.translate(0.0f, 0.0f, -3.0f);
+            model.rotate(angle, QVector3D(0.5f, 1.0f, 0.0f));
+        }
+        return projection * view * model;
+    }
+};
+
+static Scene makeScene(const QString &stage, int subdivisions)
+{
+    Scene scene;
+    scene.stage = stage;
+    scene.subdivisions = subdivisions;
+    if (stage == "06") {
+        const meshgen::Mesh<meshgen::PosUv> cube = meshgen::makeCube<meshgen::PosUv>(subdivisions);
+        scene.vertices = cube.vertices;
+        scene.indices.assign(cube.indices.begin(), cube.indices.end());
+        scene.stride = meshgen::PosUv::Floats;
+        scene.colorOffset = -1;
+        scene.uvOffset = 3;
+        scene.draws = 6;
+        scene.clearColor = QColor::fromRgbF(0.2f, 0.3f, 0.3f);
+        return scene;
+    }
+
+    const meshgen::Mesh<meshgen::PosColor> cube = meshgen::makeCube<meshgen::PosColor>(subdivisions);
+    scene.stride = meshgen::PosColor::Floats;
+    scene.colorOffset = meshgen::PosColor::ColorOffset;
+    scene.clearColor = QColor::fromRgbF(0.9f, 0.9f, 0.9f);
+    if (stage == "05") {
+        scene.vertices = cube.vertices;
+        scene.indices.assign(cube.indices.begin(), cube.indices.end());
+    } else {
+        // 04 draws unindexed: every triangle has its own three vertices
+        scene.vertices.reserve(cube.indices.size() * size_t(scene.stride));
+        for (unsigned int index : cube.indices) {
+            const float *vertex = cube.vertices.data() + size_t(index) * size_t(scene.stride);
+            scene.vertices.insert(scene.vertices.end(), vertex, vertex + scene.stride);
+        }
+    }
+    return scene;
+}
+
+// ------------------- OpenGL -------------------
+
+/**
+ * @brief The same scenes through the OpenGL driver, into a framebuffer object read back every frame.
+ */
+class GLRenderer : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    ~GLRenderer() { release(); }
+
+    bool initialize(const QSize &frameSize, const QVector<QImage> &faces)
+    {
+        context.reset(new QOpenGLContext);
+        QSurfaceFormat format;
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        context->setFormat(format);
+        if (!context->create()) {
+            qWarning() << "rasterbench: cannot create an OpenGL 3.3 core context, reporting the software renderer only";
+            return false;
+        }
+        surface.setFormat(context->format());
+        surface.create();
+        if (!context->makeCurrent(&surface)) {
+            qWarning() << "rasterbench: cannot make the context current, reporting the software renderer only";
+            return false;
+        }
+        initializeOpenGLFunctions();
+        renderer = QString::fromLatin1(reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+        size = frameSize;
+        target.reset(new QOpenGLFramebufferObject(size, QOpenGLFramebufferObject::Depth));
+        program.reset(new QOpenGLShaderProgram);
+        if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource)
+            || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource)
+            || !program->link()) {
+            qWarning() << "rasterbench: shader error" << program->log();
+            return false;
+        }
+
+        // Same upload as the stages: flipped so that v = 0 is the bottom row, mipmapped, trilinear, repeating
+        for (const QImage &face : faces) {
+            const QImage image = face.convertToFormat(QImage::Format_RGBA8888).mirrored(false, true);
+            GLuint texture = 0;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width(), image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         image.constBits());
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            textures.append(texture);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ibo);
+        if (perftrace::isRecording() && !timeline.initialize()) {
+            qWarning() << "rasterbench: timeline trace without GPU spans";
+        }
+        return true;
+    }
+
+    // Waits for the GPU spans still in flight so that they reach the timeline trace
+    void finishTrace() { timeline.flush(); }
+
+    bool isValid() const { return vao != 0; }
+    QString rendererName() const { return renderer; }
+
+    void upload(const Scene &scene)
+    {
+        const GLsizei stride = GLsizei(scene.stride * sizeof(float));
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(scene.vertices.size() * sizeof(float)), scene.vertices.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(scene.indices.size() * sizeof(quint32)),
+                     scene.indices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
+        if (scene.colorOffset >= 0) {
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride,
+                                  reinterpret_cast<void *>(quintptr(scene.colorOffset * sizeof(float))));
+        } else {
+            glDisableVertexAttribArray(1);
+            glVertexAttrib3f(1, 1.0f, 1.0f, 1.0f);
+        }
+        if (scene.uvOffset >= 0) {
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride,
+                                  reinterpret_cast<void *>(quintptr(scene.uvOffset * sizeof(float))));
+        } else {
+            glDisableVertexAttribArray(2);
+        }
+        glBindVertexArray(0);
+    }
+
+    // One frame, read back into @p image (bottom row first, as GL returns it)
+    void render(const Scene &scene, int frame, QImage *image)
+    {
+        PERFTRACE_SCOPE("GL frame");
+        timeline.collect();
+        PERFTRACE_GPU_BEGIN(timeline, "draw");
+        target->bind();
+        glViewport(0, 0, size.width(), size.height());
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(scene.clearColor.redF(), scene.clearColor.greenF(), scene.clearColor.blueF(), 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        program->bind();
+        program->setUniformValue("mvp", scene.mvp(size, frame));
+        program->setUniformValue("tex", 0);
+        program->setUniformValue("textured", GLint(scene.uvOffset >= 0));
+        glBindVertexArray(vao);
+        const int perDraw = scene.elementCount() / scene.draws;
+        for (int draw = 0; draw < scene.draws; ++draw) {
+            if (scene.uvOffset >= 0) {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, textures.value(draw % qMax(1, textures.size())));
+            }
+            if (scene.indices.empty()) {
+                glDrawArrays(GL_TRIANGLES, draw * perDraw, perDraw);
+            } else {
+                glDrawElements(GL_TRIANGLES, perDraw, GL_UNSIGNED_INT,
+                               reinterpret_cast<void *>(quintptr(draw * perDraw * sizeof(quint32))));
+            }
+        }
+        glBindVertexArray(0);
+        program->release();
+        PERFTRACE_GPU_END(timeline);
+
+        PERFTRACE_SCOPE("glReadPixels");
+        PERFTRACE_GPU_SCOPE(timeline, "readback");
+        if (image->size() != size) {
+            *image = QImage(size, QImage::Format_RGB32);
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, size.width(), size.height(), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, image->bits());
+    }
+
+private:
+    void release()
+    {
+        if (!context || !context->makeCurrent(&surface)) {
+            return;
+        }
+        if (!textures.isEmpty()) {
+            glDeleteTextures(GLsizei(textures.size()), textures.constData());
+        }
+        if (vao) {
+            glDeleteVertexArrays(1, &vao);
+            glDeleteBuffers(1, &vbo);
+            glDeleteBuffers(1, &ibo);
+        }
+        timeline.release();
+        program.reset();
+        target.reset();
+        context->doneCurrent();
+    }
+
+    std::unique_ptr<QOpenGLContext> context;
+    QOffscreenSurface surface;
+    QString renderer;
+    QSize size;
+    std::unique_ptr<QOpenGLFramebufferObject> target;
+    std::unique_ptr<QOpenGLShaderProgram> program;
+    QVector<GLuint> textures;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ibo = 0;
+    perftrace::GpuTimeline timeline;        // Only initialized while a timeline trace is recording
+};
+
+// ------------------- Software -------------------
+
+static void renderSoft(SoftRasterizer *rasterizer, const Scene &scene, const QVector<SoftTexture> &faces,
+                       const QSize &size, int frame)
+{
+    PERFTRACE_SCOPE("soft frame");
+    rasterizer->beginFrame(size, scene.clearColor);
+    SoftRasterizer::DrawCall call;
+    call.vertices = scene.vertices.data();
+    call.vertexCount = scene.vertexCount();
+    call.stride = scene.stride;
+    call.colorOffset = scene.colorOffset;
+    call.uvOffset = scene.uvOffset;
+    call.mvp = scene.mvp(size, frame);
+    const int perDraw = scene.elementCount() / scene.draws;
+    for (int draw = 0; draw < scene.draws; ++draw) {
+        if (scene.indices.empty()) {
+            // Non-indexed slices: offset the vertices instead
+            call.vertices = scene.vertices.data() + size_t(draw) * perDraw * scene.stride;
+            call.vertexCount = perDraw;
+        } else {
+            call.indices = scene.indices.data() + size_t(draw) * perDraw;
+        }
+        call.indexCount = perDraw;
+        call.texture = scene.uvOffset >= 0 && !faces.isEmpty() ? &faces[draw % faces.size()] : nullptr;
+        rasterizer->draw(call);
+    }
+    rasterizer->endFrame();
+}
+
+// Share of pixels where a channel differs by more than @p tolerance; @p glImage is bottom row first
+static double differingPixels(const QImage &softImage, const QImage &glImage, int tolerance)
+{
+    qint64 differing = 0;
+    const int width = softImage.width();
+    const int height = softImage.height();
+    for (int y = 0; y < height; ++y) {
+        const QRgb *soft = reinterpret_cast<const QRgb *>(softImage.constScanLine(y));
+        const QRgb *gl = reinterpret_cast<const QRgb *>(glImage.constScanLine(height - 1 - y));
+        for (int x = 0; x < width; ++x) {
+            if (qAbs(qRed(soft[x]) - qRed(gl[x])) > tolerance || qAbs(qGreen(soft[x]) - qGreen(gl[x])) > tolerance
+                || qAbs(qBlue(soft[x]) - qBlue(gl[x])) > tolerance) {
+                ++differing;
+            }
+        }
+    }
+    return 100.0 * double(differing) / double(qint64(width) * height);
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Software rasterizer versus the OpenGL driver on the stage 04-06 scenes.");
+    parser.addHelpOption();
+    QCommandLineOption stagesOption("stages", "Comma-separated subset of 04, 05, 06.", "list", "04,05,06");
+    QCommandLineOption subdivisionsOption("subdivisions", "Comma-separated cube subdivisions (12 n^2 triangles).",
+                                          "list", "1,16,64,256");
+    QCommandLineOption threadsOption("threads", "Comma-separated software thread counts, 0 = all cores.", "list",
+                                     "1,0");
+    QCommandLineOption framesOption("frames", "Timed frames per configuration.", "n", "30");
+    QCommandLineOption sizeOption("size", "Frame size.", "WxH", "800x600");
+    QCommandLineOption texturesOption("textures", "Directory with the dice_face_N.png files of 06.", "dir",
+                                      "../../06_3D_TexturedCube/textures");
+    QCommandLineOption noGlOption("no-gl", "Skip the OpenGL driver.");
+    QCommandLineOption saveOption("save", "Write the last frame of every configuration as PNG into <dir>.", "dir");
+    QCommandLineOption perfTraceOption("perf-trace", "Write a CPU/GPU timeline (Chrome trace JSON) to <file>.", "file");
+    parser.addOptions({ stagesOption, subdivisionsOption, threadsOption, framesOption, sizeOption, texturesOption,
+                        noGlOption, saveOption, perfTraceOption });
+    parser.process(app);
+
+    const QStringList stages = parser.value(stagesOption).split(',');
+    QVector<int> subdivisionList;
+    for (const QString &text : parser.value(subdivisionsOption).split(',')) {
+        const int subdivisions = text.toInt();
+        if (subdivisions <= 0) {
+            qWarning() << "rasterbench: invalid subdivision count" << text;
+            return 1;
+        }
+        subdivisionList.append(subdivisions);
+    }
+    QVector<int> threadList;
+    for (const QString &text : parser.value(threadsOption).split(',')) {
+        threadList.append(qMax(0, text.toInt()));
+    }
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    const QStringList sizeText = parser.value(sizeOption).split('x');
+    const QSize size(qMax(1, sizeText.value(0).toInt()), qMax(1, sizeText.value(1).toInt()));
+    const QString saveDirectory = parser.value(saveOption);
+
+    const QVector<QImage> faceImages = loadDiceFaces(parser.value(texturesOption));
+    QVector<SoftTexture> faces(faceImages.size());
+    for (int i = 0; i < faceImages.size(); ++i) {
+        faces[i].setImage(faceImages[i]);
+    }
+
+    // Before the GL renderer, which adds its GPU track only while recording
+    const QString perfTracePath = parser.value(perfTraceOption);
+    if (!perfTracePath.isEmpty()) {
+        perftrace::start();
+    }
+
+    GLRenderer gl;
+    const bool useGl = !parser.isSet(noGlOption) && gl.initialize(size, faceImages);
+    qInfo().noquote() << "OpenGL:" << (useGl ? gl.rendererName() : QString("not used"));
+
+    std::vector<std::unique_ptr<SoftRasterizer>> rasterizers;
+    QString header = "  stage | triangles | GL ms";
+    for (int threads : threadList) {
+        SoftRasterizer::Params params;
+        params.workerThreads = threads;
+        rasterizers.emplace_back(new SoftRasterizer(params));
+        header += QString(" | soft x%1 ms").arg(rasterizers.back()->threadCount(), -2);
+    }
+    header += " | best soft / GL | differing px";
+    qInfo().noquote() << QString("%1x%2 pixels, %3 frames each; GL includes glReadPixels")
+                             .arg(size.width())
+                             .arg(size.height())
+                             .arg(frames);
+    qInfo().noquote() << header;
+
+    for (const QString &stage : stages) {
+        if (stage != "04" && stage != "05" && stage != "06") {
+            qWarning() << "rasterbench: unknown stage" << stage;
+            return 1;
+        }
+        for (int subdivisions : subdivisionList) {
+            const Scene scene = makeScene(stage, subdivisions);
+            PERFTRACE_SCOPE_STRING(QString("stage %1, %2 triangles").arg(stage).arg(scene.triangles()));
+            QString line = QString("  %1    | %2").arg(stage).arg(scene.triangles(), 9);
+
+            // One untimed frame each first: allocations, shader compilation, first touch of the buffers
+            QImage glImage;
+            double glMilliseconds = -1.0;
+            if (useGl) {
+                gl.upload(scene);
+                gl.render(scene, 0, &glImage);
+                QElapsedTimer timer;
+                timer.start();
+                for (int frame = 1; frame <= frames; ++frame) {
+                    gl.render(scene, frame, &glImage);
+                }
+                glMilliseconds = timer.nsecsElapsed() / 1.0e6 / frames;
+                line += QString(" | %1").arg(glMilliseconds, 5, 'f', 1);
+            } else {
+                line += " |     -";
+            }
+
+            double bestSoft = 1.0e9;
+            for (const std::unique_ptr<SoftRasterizer> &rasterizer : rasterizers) {
+                renderSoft(rasterizer.get(), scene, faces, size, 0);
+                QElapsedTimer timer;
+                timer.start();
+                for (int frame = 1; frame <= frames; ++frame) {
+                    renderSoft(rasterizer.get(), scene, faces, size, frame);
+                }
+                const double milliseconds = timer.nsecsElapsed() / 1.0e6 / frames;
+                bestSoft = qMin(bestSoft, milliseconds);
+                line += QString(" | %1").arg(milliseconds, 11, 'f', 1);
+            }
+
+            // Both renderers finished on the same frame
+            const QImage &softImage = rasterizers.back()->image();
+            if (useGl) {
+                line += QString(" | %1x | %2 %")
+                            .arg(bestSoft / glMilliseconds, 13, 'f', 2)
+                            .arg(differingPixels(softImage, glImage, 16), 9, 'f', 2);
+            } else {
+                line += " |             - |           -";
+            }
+            qInfo().noquote() << line;
+
+            if (!saveDirectory.isEmpty()) {
+                QDir().mkpath(saveDirectory);
+                const QString name = QString("%1_%2").arg(stage).arg(subdivisions);
+                softImage.save(QDir(saveDirectory).filePath(name + "_soft.png"));
+                if (useGl) {
+                    glImage.mirrored(false, true).save(QDir(saveDirectory).filePath(name + "_gl.png"));
+                }
+            }
+        }
+    }
+
+    if (!perfTracePath.isEmpty()) {
+        if (useGl) {
+            gl.finishTrace();
+        }
+        perftrace::stop();
+        const perftrace::Stats stats = perftrace::stats();
+        if (!perftrace::writeJson(perfTracePath)) {
+            return 1;
+        }
+        qInfo().noquote() << QString("Timeline: %1 events from %2 threads written to %3")
+                                 .arg(stats.events)
+                                 .arg(stats.threads)
+                                 .arg(perfTracePath);
+    }
+    return 0;
+}
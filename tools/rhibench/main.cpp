@@ -0,0 +1,526 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QSurfaceFormat>
+#include <QVector>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include "dicefaces.h"
+#include "meshgen.h"
+#include "rhicube.h"
+
+// Draws the same grid of cubes (05's colored ones, 06's textured dice with one draw per face, or both) three
+// ways and reports the CPU time spent submitting a frame next to the time for the whole frame:
+//   gl        direct OpenGL 3.3 calls as in the stages: a uniform, a texture bind and a draw call each
+//   rhi-gl    RhiCubeRenderer on QRhi's OpenGL backend: one batched matrix upload, state-sorted draws
+//   rhi-null  RhiCubeRenderer on QRhi's Null backend, which executes nothing: submission overhead alone
+// All three render offscreen. Without a GPU the OpenGL driver is Mesa llvmpipe; elsewhere
+// LIBGL_ALWAYS_SOFTWARE=1 selects it.
+
+static const char *coloredVertexShaderSource = R"(
+#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+uniform mat4 mvp;
+out vec3 vertexColor;
+void main()
+{
+    gl_Position = mvp * vec4(position, 1.0);
+    vertexColor = color;
+}
+)";
+
+static const char *coloredFragmentShaderSource = R"(
+#version 330 core
+in vec3 vertexColor;
+out vec4 fragColor;
+void main()
+{
+    fragColor = vec4(vertexColor, 1.0);
+}
+)";
+
+static const char *texturedVertexShaderSource = R"(
+#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 texCoord;
+uniform mat4 mvp;
+out vec2 vertexTexCoord;
+void main()
+{
+    gl_Position = mvp * vec4(position, 1.0);
+    vertexTexCoord = texCoord;
+}
+)";
+
+static const char *texturedFragmentShaderSource = R"(
+#version 330 core
+in vec2 vertexTexCoord;
+uniform sampler2D faceTexture;
+out vec4 fragColor;
+void main()
+{
+    fragColor = texture(faceTexture, vertexTexCoord);
+}
+)";
+
+static constexpr auto coloredCube = meshgen::cubeCorners<meshgen::PosColor>();
+static constexpr auto texturedCube = meshgen::cube<meshgen::PosUv>();
+static const float CubeSpacing = 2.0f;
+
+// ------------------- Scene -------------------
+
+struct Scene {
+    QVector<RhiCubeRenderer::Cube> cubes;
+    QMatrix4x4 viewProjection;
+    int gridSize = 1;
+};
+
+static Scene makeScene(int count, const QString &pipeline)
+{
+    Scene scene;
+    scene.gridSize = int(std::ceil(std::sqrt(double(count))));
+    scene.cubes.resize(count);
+    for (int i = 0; i < count; ++i) {
+        const bool colored = pipeline == "colored" || (pipeline == "mixed" && i % 2 == 0);
+        scene.cubes[i].pipeline = colored ? RhiCubeRenderer::Pipeline::Colored : RhiCubeRenderer::Pipeline::Textured;
+    }
+    return scene;
+}
+
+// Every cube turns every frame, so each frame carries a full set of new matrices
+static void animate(Scene *scene, const QSize &size, int frame)
+{
+    const float extent = scene->gridSize * CubeSpacing;
+    scene->viewProjection.setToIdentity();
+    scene->viewProjection.perspective(45.0f, float(size.width()) / float(size.height()), 0.1f, extent * 4.0f);
+    scene->viewProjection.lookAt(QVector3D(0.0f, 0.0f, qMax(3.0f, extent * 1.3f)), QVector3D(0.0f, 0.0f, 0.0f),
+                                 QVector3D(0.0f, 1.0f, 0.0f));
+    const float origin = -(scene->gridSize - 1) * CubeSpacing * 0.5f;
+    for (int i = 0; i < scene->cubes.size(); ++i) {
+        const float angle = frame * 2.0f + i * 7.0f;
+        QMatrix4x4 &model = scene->cubes[i].model;
+        model.setToIdentity();
+        model.translate(origin + (i % scene->gridSize) * CubeSpacing, origin + (i / scene->gridSize) * CubeSpacing,
+                        0.0f);
+        model.rotate(angle, 0.0f, 1.0f, 0.0f);
+        model.rotate(angle / 2.0f, 1.0f, 0.0f, 0.0f);
+    }
+}
+
+struct FrameResult {
+    double submitMilliseconds = 0.0;        // CPU time to record or issue the frame
+    double frameMilliseconds = 0.0;         // Until the frame has finished executing
+    int draws = 0;
+    int stateChanges = 0;                   // Program or pipeline, texture or shader resource binds
+};
+
+// ------------------- OpenGL -------------------
+
+/**
+ * @brief The stages' way of drawing: per cube a uniform upload, and for a die a texture bind and draw per face.
+ */
+class GLCubes : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    ~GLCubes() { release(); }
+
+    bool initialize(const QSize &frameSize, const QVector<QImage> &faces)
+    {
+        context.reset(new QOpenGLContext);
+        QSurfaceFormat format;
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        context->setFormat(format);
+        if (!context->create()) {
+            qWarning() << "rhibench: cannot create an OpenGL 3.3 core context";
+            return false;
+        }
+        surface.setFormat(context->format());
+        surface.create();
+        if (!context->makeCurrent(&surface)) {
+            qWarning() << "rhibench: cannot make the OpenGL context current";
+            return false;
+        }
+        initializeOpenGLFunctions();
+        renderer = QString::fromLatin1(reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+        size = frameSize;
+        target.reset(new QOpenGLFramebufferObject(size, QOpenGLFramebufferObject::Depth));
+        coloredProgram = buildProgram(coloredVertexShaderSource, coloredFragmentShaderSource);
+        texturedProgram = buildProgram(texturedVertexShaderSource, texturedFragmentShaderSource);
+        if (!coloredProgram || !texturedProgram) {
+            return false;
+        }
+        coloredMvp = coloredProgram->uniformLocation("mvp");
+        texturedMvp = texturedProgram->uniformLocation("mvp");
+        texturedProgram->bind();
+        texturedProgram->setUniformValue("faceTexture", 0);
+        texturedProgram->release();
+
+        for (const QImage &face : faces) {
+            const QImage image = face.convertToFormat(QImage::Format_RGBA8888).mirrored(false, true);
+            GLuint texture = 0;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width(), image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         image.constBits());
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            textures.append(texture);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        coloredMesh = buildMesh(coloredCube.vertices.data(), coloredCube.vertexBytes(), coloredCube.indices.data(),
+                                coloredCube.indices.size(), coloredCube.stride());
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, GLsizei(coloredCube.stride()),
+                              reinterpret_cast<void *>(quintptr(meshgen::PosColor::ColorOffset * sizeof(float))));
+        texturedMesh = buildMesh(texturedCube.vertices.data(), texturedCube.vertexBytes(),
+                                 texturedCube.indices.data(), texturedCube.indices.size(), texturedCube.stride());
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, GLsizei(texturedCube.stride()),
+                              reinterpret_cast<void *>(quintptr(3 * sizeof(float))));
+        glBindVertexArray(0);
+        return true;
+    }
+
+    QString rendererName() const { return renderer; }
+
+    FrameResult render(const Scene &scene)
+    {
+        FrameResult result;
+        QElapsedTimer timer;
+        timer.start();
+
+        target->bind();
+        glViewport(0, 0, size.width(), size.height());
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Cube by cube in scene order, as the stages draw
+        QMatrix4x4 mvp;
+        for (const RhiCubeRenderer::Cube &cube : scene.cubes) {
+            mvp = scene.viewProjection * cube.model;
+            if (cube.pipeline == RhiCubeRenderer::Pipeline::Colored) {
+                coloredProgram->bind();
+                glUniformMatrix4fv(coloredMvp, 1, GL_FALSE, mvp.constData());
+                glBindVertexArray(coloredMesh.vao);
+                glDrawElements(GL_TRIANGLES, coloredMesh.indexCount, GL_UNSIGNED_INT, nullptr);
+                result.draws += 1;
+                result.stateChanges += 1;
+            } else {
+                texturedProgram->bind();
+                glUniformMatrix4fv(texturedMvp, 1, GL_FALSE, mvp.constData());
+                glBindVertexArray(texturedMesh.vao);
+                glActiveTexture(GL_TEXTURE0);
+                for (int face = 0; face < textures.size(); ++face) {
+                    glBindTexture(GL_TEXTURE_2D, textures[face]);
+                    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT,
+                                   reinterpret_cast<void *>(quintptr(face * 6 * sizeof(quint32))));
+                }
+                result.draws += textures.size();
+                result.stateChanges += 1 + textures.size();
+            }
+        }
+        glBindVertexArray(0);
+        result.submitMilliseconds = timer.nsecsElapsed() / 1.0e6;
+
+        glFinish();
+        result.frameMilliseconds = timer.nsecsElapsed() / 1.0e6;
+        return result;
+    }
+
+private:
+    struct Mesh {
+        GLuint vao = 0;
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+        GLsizei indexCount = 0;
+    };
+
+    std::unique_ptr<QOpenGLShaderProgram> buildProgram(const char *vertexSource, const char *fragmentSource)
+    {
+        std::unique_ptr<QOpenGLShaderProgram> program(new QOpenGLShaderProgram);
+        if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource)
+            || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource) || !program->link()) {
+            qWarning() << "rhibench: shader error" << program->log();
+            return nullptr;
+        }
+        return program;
+    }
+
+    // Leaves the VAO bound with attribute 0 (position) set up; the caller adds the rest
+    Mesh buildMesh(const float *vertices, size_t vertexBytes, const unsigned int *indices, size_t indexCount,
+                   size_t stride)
+    {
+        Mesh mesh;
+        mesh.indexCount = GLsizei(indexCount);
+        glGenVertexArrays(1, &mesh.vao);
+        glGenBuffers(1, &mesh.vertexBuffer);
+        glGenBuffers(1, &mesh.indexBuffer);
+        glBindVertexArray(mesh.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(vertexBytes), vertices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(indexCount * sizeof(unsigned int)), indices,
+                     GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, GLsizei(stride), nullptr);
+        return mesh;
+    }
+
+    void release()
+    {
+        if (!context || !context->makeCurrent(&surface)) {
+            return;
+        }
+        if (!textures.isEmpty()) {
+            glDeleteTextures(GLsizei(textures.size()), textures.constData());
+        }
+        for (Mesh *mesh : { &coloredMesh, &texturedMesh }) {
+            if (mesh->vao) {
+                glDeleteVertexArrays(1, &mesh->vao);
+                glDeleteBuffers(1, &mesh->vertexBuffer);
+                glDeleteBuffers(1, &mesh->indexBuffer);
+            }
+        }
+        coloredProgram.reset();
+        texturedProgram.reset();
+        target.reset();
+        context->doneCurrent();
+    }
+
+    std::unique_ptr<QOpenGLContext> context;
+    QOffscreenSurface surface;
+    QString renderer;
+    QSize size;
+    std::unique_ptr<QOpenGLFramebufferObject> target;
+    std::unique_ptr<QOpenGLShaderProgram> coloredProgram;
+    std::unique_ptr<QOpenGLShaderProgram> texturedProgram;
+    int coloredMvp = -1;
+    int texturedMvp = -1;
+    Mesh coloredMesh;
+    Mesh texturedMesh;
+    QVector<GLuint> textures;
+};
+
+// ------------------- QRhi -------------------
+
+/**
+ * @brief RhiCubeRenderer into an offscreen color texture and depth buffer, on the OpenGL or the Null backend.
+ */
+class RhiCubes
+{
+public:
+    ~RhiCubes() { release(); }
+
+    bool initialize(QRhi::Implementation backend, const QSize &frameSize, const QVector<QImage> &faces)
+    {
+        if (backend == QRhi::OpenGLES2) {
+            QRhiGles2InitParams params;
+            params.format = QSurfaceFormat::defaultFormat();
+            fallbackSurface.reset(QRhiGles2InitParams::newFallbackSurface(params.format));
+            params.fallbackSurface = fallbackSurface.get();
+            rhi.reset(QRhi::create(QRhi::OpenGLES2, &params));
+        } else {
+            QRhiNullInitParams params;
+            rhi.reset(QRhi::create(QRhi::Null, &params));
+        }
+        if (!rhi) {
+            qWarning() << "rhibench: cannot create the" << (backend == QRhi::Null ? "Null" : "OpenGL")
+                       << "QRhi backend";
+            return false;
+        }
+
+        size = frameSize;
+        colorTexture.reset(rhi->newTexture(QRhiTexture::RGBA8, size, 1, QRhiTexture::RenderTarget));
+        depthBuffer.reset(rhi->newRenderBuffer(QRhiRenderBuffer::DepthStencil, size));
+        if (!colorTexture->create() || !depthBuffer->create()) {
+            qWarning() << "rhibench: cannot create the offscreen target";
+            return false;
+        }
+        target.reset(rhi->newTextureRenderTarget({ QRhiColorAttachment(colorTexture.get()), depthBuffer.get() }));
+        renderPass.reset(target->newCompatibleRenderPassDescriptor());
+        target->setRenderPassDescriptor(renderPass.get());
+        if (!target->create()) {
+            qWarning() << "rhibench: cannot create the offscreen target";
+            return false;
+        }
+
+        cubes.setFaceImages(faces);
+        return cubes.initialize(rhi.get(), renderPass.get());
+    }
+
+    QString rendererName() const
+    {
+        return QString("%1 - %2").arg(QString::fromLatin1(rhi->backendName()),
+                                      QString::fromLatin1(rhi->driverInfo().deviceName));
+    }
+
+    FrameResult render(const Scene &scene)
+    {
+        FrameResult result;
+        QElapsedTimer timer;
+        timer.start();
+
+        QRhiCommandBuffer *commandBuffer = nullptr;
+        if (rhi->beginOffscreenFrame(&commandBuffer) != QRhi::FrameOpSuccess) {
+            qWarning() << "rhibench: beginOffscreenFrame() failed";
+            return result;
+        }
+        QRhiResourceUpdateBatch *batch = rhi->nextResourceUpdateBatch();
+        cubes.prepare(batch, scene.viewProjection, scene.cubes);
+        commandBuffer->beginPass(target.get(), QColor::fromRgbF(0.2f, 0.3f, 0.3f, 1.0f), { 1.0f, 0 }, batch);
+        cubes.record(commandBuffer, size);
+        commandBuffer->endPass();
+        result.submitMilliseconds = timer.nsecsElapsed() / 1.0e6;
+
+        // Offscreen frames are synchronous: this returns once the backend has executed the frame
+        rhi->endOffscreenFrame();
+        result.frameMilliseconds = timer.nsecsElapsed() / 1.0e6;
+        result.draws = cubes.stats().draws;
+        result.stateChanges = cubes.stats().pipelineBinds + cubes.stats().resourceBinds;
+        return result;
+    }
+
+private:
+    void release()
+    {
+        // QRhi resources go before the QRhi itself
+        cubes.release();
+        target.reset();
+        renderPass.reset();
+        depthBuffer.reset();
+        colorTexture.reset();
+        rhi.reset();
+        fallbackSurface.reset();
+    }
+
+    std::unique_ptr<QOffscreenSurface> fallbackSurface;
+    std::unique_ptr<QRhi> rhi;
+    std::unique_ptr<QRhiTexture> colorTexture;
+    std::unique_ptr<QRhiRenderBuffer> depthBuffer;
+    std::unique_ptr<QRhiTextureRenderTarget> target;
+    std::unique_ptr<QRhiRenderPassDescriptor> renderPass;
+    RhiCubeRenderer cubes;
+    QSize size;
+};
+
+// ------------------- Main -------------------
+
+int main(int argc, char *argv[])
+{
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Direct OpenGL versus QRhi (OpenGL and Null backends) on grids of cubes.");
+    parser.addHelpOption();
+    QCommandLineOption backendsOption("backends", "Comma-separated subset of gl, rhi-gl, rhi-null.", "list",
+                                      "gl,rhi-gl,rhi-null");
+    QCommandLineOption cubesOption("cubes", "Comma-separated cube counts.", "list", "100,1000,10000");
+    QCommandLineOption pipelineOption("pipeline", "colored (05), textured (06, one draw per face) or mixed.", "name",
+                                      "mixed");
+    QCommandLineOption framesOption("frames", "Timed frames per configuration.", "n", "100");
+    QCommandLineOption sizeOption("size", "Frame size.", "WxH", "800x600");
+    QCommandLineOption texturesOption("textures", "Directory with the dice_face_N.png files of 06.", "dir",
+                                      "../../06_3D_TexturedCube/textures");
+    parser.addOptions({ backendsOption, cubesOption, pipelineOption, framesOption, sizeOption, texturesOption });
+    parser.process(app);
+
+    const QStringList backends = parser.value(backendsOption).split(',');
+    QVector<int> cubeCounts;
+    for (const QString &text : parser.value(cubesOption).split(',')) {
+        const int count = text.toInt();
+        if (count <= 0) {
+            qWarning() << "rhibench: invalid cube count" << text;
+            return 1;
+        }
+        cubeCounts.append(count);
+    }
+    const QString pipeline = parser.value(pipelineOption);
+    if (pipeline != "colored" && pipeline != "textured" && pipeline != "mixed") {
+        qWarning() << "rhibench: unknown pipeline" << pipeline;
+        return 1;
+    }
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    const QStringList sizeText = parser.value(sizeOption).split('x');
+    const QSize size(qMax(1, sizeText.value(0).toInt()), qMax(1, sizeText.value(1).toInt()));
+    const QVector<QImage> faces = loadDiceFaces(parser.value(texturesOption));
+
+    qInfo().noquote() << QString("%1x%2 pixels, %3 frames each, %4 cubes")
+                             .arg(size.width())
+                             .arg(size.height())
+                             .arg(frames)
+                             .arg(pipeline);
+    qInfo().noquote() << "  backend  |  cubes | draws/frame | binds/frame | submit ms | frame ms | submit us/draw";
+
+    for (const QString &backend : backends) {
+        std::function<FrameResult(const Scene &)> render;
+        std::unique_ptr<GLCubes> gl;
+        std::unique_ptr<RhiCubes> rhiCubes;
+        if (backend == "gl") {
+            gl.reset(new GLCubes);
+            if (!gl->initialize(size, faces)) {
+                continue;
+            }
+            qInfo().noquote() << "  gl:" << gl->rendererName();
+            render = [&gl](const Scene &scene) { return gl->render(scene); };
+        } else if (backend == "rhi-gl" || backend == "rhi-null") {
+            rhiCubes.reset(new RhiCubes);
+            if (!rhiCubes->initialize(backend == "rhi-gl" ? QRhi::OpenGLES2 : QRhi::Null, size, faces)) {
+                continue;
+            }
+            qInfo().noquote() << QString("  %1:").arg(backend) << rhiCubes->rendererName();
+            render = [&rhiCubes](const Scene &scene) { return rhiCubes->render(scene); };
+        } else {
+            qWarning() << "rhibench: unknown backend" << backend;
+            return 1;
+        }
+
+        for (int count : cubeCounts) {
+            Scene scene = makeScene(count, pipeline);
+            // One untimed frame first: texture and buffer uploads, pipeline and uniform buffer creation
+            animate(&scene, size, 0);
+            render(scene);
+
+            FrameResult total;
+            for (int frame = 1; frame <= frames; ++frame) {
+                animate(&scene, size, frame);
+                const FrameResult result = render(scene);
+                total.submitMilliseconds += result.submitMilliseconds;
+                total.frameMilliseconds += result.frameMilliseconds;
+                total.draws = result.draws;
+                total.stateChanges = result.stateChanges;
+            }
+            const double submit = total.submitMilliseconds / frames;
+            qInfo().noquote() << QString("  %1 | %2 | %3 | %4 | %5 | %6 | %7")
+                                     .arg(backend, -8)
+                                     .arg(count, 6)
+                                     .arg(total.draws, 11)
+                                     .arg(total.stateChanges, 11)
+                                     .arg(submit, 9, 'f', 3)
+                                     .arg(total.frameMilliseconds / frames, 8, 'f', 3)
+                                     .arg(submit * 1000.0 / qMax(1, total.draws), 14, 'f', 3);
+        }
+    }
+    return 0;
+}
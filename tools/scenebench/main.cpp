@@ -0,0 +1,136 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include "countarg.h"
+#include "scenegraph.h"
+
+// Builds a forest in common/scenegraph.h and times SceneGraph::update() while a
+// fraction of the entities gets a new local transform every frame, for several
+// thread counts. Entity i (past the roots) is a child of entity
+// (i - roots) / branching, so every tree is complete down to the last level.
+// Changed entities are spread over all levels: an edited parent also moves its
+// whole subtree, which is why "moved" exceeds "edited".
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Scene graph transform update benchmark.");
+    parser.addHelpOption();
+    QCommandLineOption entitiesOption("entities", "Entity count.", "n", "1M");
+    QCommandLineOption branchingOption("branching", "Children per entity.", "n", "8");
+    QCommandLineOption levelsOption("levels", "Levels per tree; sets the number of roots.", "n", "4");
+    QCommandLineOption changingOption("changing", "Comma-separated fractions edited per frame.", "list",
+                                      "0,0.01,0.1,1");
+    const QString allThreads = QString::number(QThread::idealThreadCount());
+    QCommandLineOption threadsOption("threads", "Comma-separated thread counts.", "list", "1," + allThreads);
+    QCommandLineOption framesOption("frames", "Timed frames per configuration.", "n", "100");
+    parser.addOptions({ entitiesOption, branchingOption, levelsOption, changingOption, threadsOption, framesOption });
+    parser.process(app);
+
+    const int entities = parseCount(parser.value(entitiesOption));
+    const int branching = qMax(1, parser.value(branchingOption).toInt());
+    const int levels = qMax(1, parser.value(levelsOption).toInt());
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    if (entities <= 0) {
+        qWarning() << "scenebench: invalid entity count" << parser.value(entitiesOption);
+        return 1;
+    }
+    QVector<double> fractions;
+    for (const QString &text : parser.value(changingOption).split(',')) {
+        bool ok = false;
+        const double fraction = text.toDouble(&ok);
+        if (!ok || fraction < 0.0 || fraction > 1.0) {
+            qWarning() << "scenebench: invalid fraction" << text;
+            return 1;
+        }
+        fractions.append(fraction);
+    }
+    QVector<int> threadCounts;
+    for (const QString &text : parser.value(threadsOption).split(',')) {
+        const int threads = text.toInt();
+        if (threads <= 0) {
+            qWarning() << "scenebench: invalid thread count" << text;
+            return 1;
+        }
+        threadCounts.append(threads);
+    }
+
+    // Entities per tree: 1 + b + b^2 + ... over the requested levels
+    double treeSize = 0.0;
+    for (int level = 0; level < levels; ++level) {
+        treeSize += std::pow(double(branching), level);
+    }
+    const int roots = qMax(1, int(entities / treeSize));
+
+    qInfo().noquote() << QString("%1 entities, %2 roots, branching %3").arg(entities).arg(roots).arg(branching);
+    qInfo().noquote() << "  threads | edited % | update ms avg / min | edit ms | moved/frame | M moved/s";
+
+    for (int threads : std::as_const(threadCounts)) {
+        SceneGraph::Params params;
+        params.workerThreads = threads;
+        SceneGraph scene(params);
+        scene.reserve(entities);
+
+        QElapsedTimer timer;
+        timer.start();
+        QVector<SceneGraph::Entity> ids(entities);
+        for (int i = 0; i < entities; ++i) {
+            const SceneGraph::Entity parent = i < roots ? SceneGraph::NoEntity : ids[(i - roots) / branching];
+            ids[i] = scene.create(parent, i % 3, i % 4);
+            scene.setTransform(ids[i], { QVector3D(float(i % 7), 0.5f, 0.0f),
+                                         QQuaternion::fromAxisAndAngle(0.0f, 1.0f, 0.0f, float(i % 360)),
+                                         QVector3D(0.9f, 0.9f, 0.9f) });
+            scene.setLocalBounds(ids[i], { QVector3D(), QVector3D(0.5f, 0.5f, 0.5f) });
+        }
+        const double createMs = timer.nsecsElapsed() / 1.0e6;
+        const SceneGraph::UpdateStats first = scene.update();
+        qInfo().noquote() << QString("  %1 threads: create %2 ms, sort %3 ms, first update %4 ms, %5 levels, "
+                                     "%6 batches, %7 MiB")
+                                 .arg(threads)
+                                 .arg(createMs, 0, 'f', 1)
+                                 .arg(first.rebuildMilliseconds, 0, 'f', 1)
+                                 .arg(first.updateMilliseconds, 0, 'f', 1)
+                                 .arg(first.levels)
+                                 .arg(scene.batches().size())
+                                 .arg(scene.memoryBytes() / (1024.0 * 1024.0), 0, 'f', 1);
+
+        for (double fraction : std::as_const(fractions)) {
+            // Every step-th entity, shifted each frame so the edits rotate through the scene
+            const int step = fraction > 0.0 ? qMax(1, int(std::lround(1.0 / fraction))) : 0;
+            double updateMs = 0.0;
+            double minUpdateMs = 1.0e9;
+            double editMs = 0.0;
+            qint64 moved = 0;
+            for (int frame = 0; frame < frames; ++frame) {
+                timer.restart();
+                if (step > 0) {
+                    const float angle = float(frame % 360);
+                    for (int i = frame % step; i < entities; i += step) {
+                        scene.setRotation(ids[i], QQuaternion::fromAxisAndAngle(0.0f, 1.0f, 0.0f, angle));
+                    }
+                }
+                editMs += timer.nsecsElapsed() / 1.0e6;
+                const SceneGraph::UpdateStats stats = scene.update();
+                updateMs += stats.updateMilliseconds;
+                minUpdateMs = qMin(minUpdateMs, stats.updateMilliseconds);
+                moved += stats.entitiesChanged;
+            }
+            qInfo().noquote() << QString("  %1 | %2 | %3 / %4 | %5 | %6 | %7")
+                                     .arg(threads, 7)
+                                     .arg(fraction * 100.0, 8, 'f', 1)
+                                     .arg(updateMs / frames, 10, 'f', 3)
+                                     .arg(minUpdateMs, 6, 'f', 3)
+                                     .arg(editMs / frames, 7, 'f', 3)
+                                     .arg(moved / frames, 11)
+                                     .arg(updateMs > 0.0 ? moved / updateMs / 1.0e3 : 0.0, 9, 'f', 1);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFontDatabase>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLPaintDevice>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QSurfaceFormat>
+#include <QVector>
+#include "sdftext.h"
+
+// Draws the same set of object labels every frame three ways and reports glyphs per millisecond:
+//   sdf       TextRenderer: glyph instances streamed into one buffer, one instanced draw
+//   painter   QPainter on the GL paint engine (what a QPainter overlay on a QOpenGLWidget does)
+//   raster    QPainter into a QImage overlay, uploaded as a texture every frame
+// Every frame ends with glFinish(), so the times include the GPU work.
+
+struct Label {
+    QVector3D position;
+    QString text;
+};
+
+static QPointF project(const QMatrix4x4 &viewProjection, const QVector3D &position, const QSize &size, bool *visible)
+{
+    const QVector4D clip = viewProjection * QVector4D(position, 1.0f);
+    *visible = clip.w() > 0.0f;
+    if (!*visible) {
+        return QPointF();
+    }
+    return QPointF((clip.x() / clip.w() * 0.5 + 0.5) * size.width(), (0.5 - clip.y() / clip.w() * 0.5) * size.height());
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("SDF text versus QPainter overlay benchmark.");
+    parser.addHelpOption();
+    QCommandLineOption labelsOption("labels", "Comma-separated label counts.", "list", "100,1000,10000");
+    QCommandLineOption framesOption("frames", "Timed frames per count and method.", "n", "60");
+    QCommandLineOption sizeOption("size", "Framebuffer size.", "WxH", "1920x1080");
+    QCommandLineOption pixelOption("pixel-size", "Text size in pixels.", "px", "14");
+    QCommandLineOption methodOption("methods", "Comma-separated subset of sdf, painter, raster.", "list",
+                                    "sdf,painter,raster");
+    parser.addOptions({ labelsOption, framesOption, sizeOption, pixelOption, methodOption });
+    parser.process(app);
+
+    QVector<int> labelCounts;
+    for (const QString &text : parser.value(labelsOption).split(',')) {
+        const int count = text.toInt();
+        if (count <= 0) {
+            qWarning() << "textbench: invalid label count" << text;
+            return 1;
+        }
+        labelCounts.append(count);
+    }
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    const QStringList sizeText = parser.value(sizeOption).split('x');
+    const QSize size(qMax(1, sizeText.value(0).toInt()), qMax(1, sizeText.value(1).toInt()));
+    const float pixelSize = parser.value(pixelOption).toFloat();
+    const QStringList methods = parser.value(methodOption).split(',');
+
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create()) {
+        qWarning() << "textbench: cannot create an OpenGL 3.3 core context";
+        return 1;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        qWarning() << "textbench: cannot make the context current";
+        return 1;
+    }
+
+    QOpenGLFunctions_3_3_Core gl;
+    gl.initializeOpenGLFunctions();
+    qInfo().noquote() << "Renderer:" << reinterpret_cast<const char *>(gl.glGetString(GL_RENDERER));
+
+    QOpenGLFramebufferObject target(size, QOpenGLFramebufferObject::CombinedDepthStencil);
+    target.bind();
+    gl.glViewport(0, 0, size.width(), size.height());
+
+    const QFont font = QFontDatabase::systemFont(QFontDatabase::GeneralFont);
+    QFont painterFont(font);
+    painterFont.setPixelSize(qRound(pixelSize));
+
+    SdfFontAtlas atlas;
+    atlas.build(font);
+    qInfo().noquote() << QString("SDF atlas: %1 x %2, built in %3 ms")
+                             .arg(atlas.image().width())
+                             .arg(atlas.image().height())
+                             .arg(atlas.buildMilliseconds());
+    TextRenderer text;
+    if (!text.initialize(&atlas)) {
+        return 1;
+    }
+    text.setOutline(1.0f, Qt::black);
+
+    // Overlay texture of the raster method
+    GLuint overlay = 0;
+    gl.glGenTextures(1, &overlay);
+    gl.glBindTexture(GL_TEXTURE_2D, overlay);
+    gl.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.width(), size.height(), 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    gl.glBindTexture(GL_TEXTURE_2D, 0);
+    QImage overlayImage(size, QImage::Format_ARGB32_Premultiplied);
+
+    QMatrix4x4 viewProjection;
+    viewProjection.perspective(60.0f, float(size.width()) / size.height(), 0.1f, 100.0f);
+    viewProjection.lookAt(QVector3D(0.0f, 0.0f, 3.0f), QVector3D(0.0f, 0.0f, 0.0f), QVector3D(0.0f, 1.0f, 0.0f));
+
+    QRandomGenerator random(7);
+    GLuint query = 0;
+    gl.glGenQueries(1, &query);
+
+    qInfo().noquote() << "  labels | glyphs | method  | ms/frame | GPU ms | glyphs/ms";
+    for (int count : labelCounts) {
+        QVector<Label> labels(count);
+        int glyphs = 0;
+        for (int i = 0; i < count; ++i) {
+            Label &label = labels[i];
+            label.position = QVector3D(float(random.bounded(2.0) - 1.0), float(random.bounded(2.0) - 1.0),
+                                       float(random.bounded(2.0) - 1.0));
+            label.text = QString("#%1 %2 m").arg(i).arg(random.bounded(1000.0), 0, 'f', 1);
+            for (QChar c : label.text) {
+                glyphs += c.isSpace() ? 0 : 1;
+            }
+        }
+
+        for (const QString &method : methods) {
+            double wallMs = 0.0;
+            double gpuMs = 0.0;
+            for (int frame = 0; frame < frames; ++frame) {
+                gl.glClearColor(0.2f, 0.3f, 0.4f, 1.0f);
+                gl.glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                gl.glFinish();
+
+                QElapsedTimer timer;
+                timer.start();
+                gl.glBeginQuery(GL_TIME_ELAPSED, query);
+                if (method == "sdf") {
+                    for (const Label &label : labels) {
+                        text.addLabel(label.text, label.position, viewProjection, size, pixelSize, Qt::white);
+                    }
+                    text.flush(size);
+                } else if (method == "painter") {
+                    QOpenGLPaintDevice device(size);
+                    QPainter painter(&device);
+                    painter.setFont(painterFont);
+                    painter.setPen(Qt::white);
+                    for (const Label &label : labels) {
+                        bool visible = false;
+                        const QPointF at = project(viewProjection, label.position, size, &visible);
+                        if (visible) {
+                            painter.drawText(QRectF(at.x() - 200.0, at.y() - pixelSize, 400.0, 2.0 * pixelSize),
+                                             Qt::AlignCenter, label.text);
+                        }
+                    }
+                } else if (method == "raster") {
+                    overlayImage.fill(Qt::transparent);
+                    QPainter painter(&overlayImage);
+                    painter.setFont(painterFont);
+                    painter.setPen(Qt::white);
+                    for (const Label &label : labels) {
+                        bool visible = false;
+                        const QPointF at = project(viewProjection, label.position, size, &visible);
+                        if (visible) {
+                            painter.drawText(QRectF(at.x() - 200.0, at.y() - pixelSize, 400.0, 2.0 * pixelSize),
+                                             Qt::AlignCenter, label.text);
+                        }
+                    }
+                    painter.end();
+                    // The upload is what it costs to get the overlay to the GPU; compositing it is not timed
+                    gl.glBindTexture(GL_TEXTURE_2D, overlay);
+                    gl.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.width(), size.height(), GL_BGRA,
+                                       GL_UNSIGNED_INT_8_8_8_8_REV, overlayImage.constBits());
+                    gl.glBindTexture(GL_TEXTURE_2D, 0);
+                } else {
+                    qWarning() << "textbench: unknown method" << method;
+                    return 1;
+                }
+                gl.glEndQuery(GL_TIME_ELAPSED);
+                gl.glFinish();
+                wallMs += timer.nsecsElapsed() / 1.0e6;
+
+                GLuint64 ns = 0;
+                gl.glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+                gpuMs += ns / 1.0e6;
+
+                // QPainter on the GL paint engine leaves its own state behind
+                target.bind();
+                gl.glViewport(0, 0, size.width(), size.height());
+            }
+
+            qInfo().noquote() << QString("  %1 | %2 | %3 | %4 | %5 | %6")
+                                     .arg(count, 6)
+                                     .arg(glyphs, 6)
+                                     .arg(method, -7)
+                                     .arg(wallMs / frames, 8, 'f', 3)
+                                     .arg(gpuMs / frames, 6, 'f', 3)
+                                     .arg(glyphs / qMax(wallMs / frames, 1.0e-6), 9, 'f', 0);
+        }
+    }
+
+    gl.glDeleteQueries(1, &query);
+    gl.glDeleteTextures(1, &overlay);
+    text.release();
+    target.release();
+    context.doneCurrent();
+    return 0;
+}
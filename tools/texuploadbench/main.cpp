@@ -0,0 +1,171 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLTexture>
+#include <QPainter>
+#include <QSurfaceFormat>
+#include "textureupload.h"
+
+// Compares the old texture loading path of the stages (QImage::load, mirrored(),
+// QOpenGLTexture::setData) with TextureUploader on one large image, reporting
+// decode / upload time and the peak resident memory of the process.
+// Run each path in its own process: peak RSS cannot be reset.
+
+// VmRSS / VmHWM from /proc/self/status in KiB, -1 where unavailable
+static qint64 procStatusKiB(const char *key)
+{
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+    const QByteArray prefix = QByteArray(key) + ':';
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith(prefix)) {
+            return line.mid(prefix.size()).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+    return -1;
+}
+
+static bool generateImage(const QString &path, int size)
+{
+    QImage image(size, size, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size, size);
+    gradient.setColorAt(0.0, QColor(30, 60, 200));
+    gradient.setColorAt(1.0, QColor(240, 200, 40));
+    painter.fillRect(image.rect(), gradient);
+    painter.setPen(QPen(Qt::white, size / 256));
+    for (int i = 0; i < size; i += size / 32) {
+        painter.drawLine(i, 0, i, size);
+        painter.drawLine(0, i, size, i);
+    }
+    painter.end();
+    return image.save(path);
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Texture upload benchmark: legacy QImage path vs. TextureUploader.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("image", "Image file to upload.");
+    QCommandLineOption pathOption("path", "Upload path to measure: legacy or direct.", "path", "direct");
+    QCommandLineOption repeatOption("repeat", "Number of uploads.", "n", "5");
+    QCommandLineOption generateOption("generate", "Write a <size> x <size> test image to <image> and exit.", "size");
+    parser.addOptions({ pathOption, repeatOption, generateOption });
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+    const QString imagePath = parser.positionalArguments().first();
+
+    if (parser.isSet(generateOption)) {
+        const int size = parser.value(generateOption).toInt();
+        if (size <= 0 || !generateImage(imagePath, size)) {
+            qWarning() << "texuploadbench: cannot write" << imagePath;
+            return 1;
+        }
+        return 0;
+    }
+
+    const QString path = parser.value(pathOption);
+    if (path != "legacy" && path != "direct") {
+        qWarning() << "texuploadbench: unknown path" << path;
+        return 1;
+    }
+
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create()) {
+        qWarning() << "texuploadbench: cannot create an OpenGL 3.3 core context";
+        return 1;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        qWarning() << "texuploadbench: cannot make the context current";
+        return 1;
+    }
+
+    QOpenGLFunctions_3_3_Core gl;
+    gl.initializeOpenGLFunctions();
+    qInfo().noquote() << "Renderer:" << reinterpret_cast<const char *>(gl.glGetString(GL_RENDERER));
+
+    TextureUploader uploader;
+    uploader.initialize();
+
+    const qint64 baselineKiB = procStatusKiB("VmRSS");
+    const int repeat = qMax(1, parser.value(repeatOption).toInt());
+    double totalMs = 0.0;
+    double worstMs = 0.0;
+    QSize size;
+
+    for (int i = 0; i < repeat; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+
+        if (path == "legacy") {
+            // What 06_3D_TexturedCube did: decode, mirror (copy), setData (converts to RGBA8888 again)
+            QImage image;
+            if (!image.load(imagePath)) {
+                qWarning() << "texuploadbench: cannot load" << imagePath;
+                return 1;
+            }
+            image = image.mirrored(false, true);
+            QOpenGLTexture texture(QOpenGLTexture::Target2D);
+            texture.setData(image);
+            texture.generateMipMaps();
+            gl.glFinish();
+            size = image.size();
+        } else {
+            const GLuint texture = uploader.uploadFile(imagePath, true, &size);
+            if (texture == 0) {
+                return 1;
+            }
+            gl.glFinish();
+            gl.glDeleteTextures(1, &texture);
+        }
+
+        const double ms = timer.nsecsElapsed() / 1.0e6;
+        totalMs += ms;
+        worstMs = qMax(worstMs, ms);
+    }
+
+    const qint64 peakKiB = procStatusKiB("VmHWM");
+    qInfo().noquote() << QString("%1 path, %2x%3, %4 uploads: avg %5 ms, max %6 ms (load + upload + mipmaps, glFinish)")
+                             .arg(path)
+                             .arg(size.width())
+                             .arg(size.height())
+                             .arg(repeat)
+                             .arg(totalMs / repeat, 0, 'f', 1)
+                             .arg(worstMs, 0, 'f', 1);
+    if (peakKiB >= 0 && baselineKiB >= 0) {
+        qInfo().noquote() << QString("Peak RSS %1 MiB (%2 MiB above the baseline after context creation)")
+                                 .arg(peakKiB / 1024.0, 0, 'f', 1)
+                                 .arg((peakKiB - baselineKiB) / 1024.0, 0, 'f', 1);
+    } else {
+        qInfo() << "Peak RSS: not available on this platform";
+    }
+    if (path == "direct") {
+        qInfo().noquote() << uploader.report();
+    }
+
+    uploader.release();
+    context.doneCurrent();
+    return 0;
+}